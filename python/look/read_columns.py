@@ -0,0 +1,123 @@
+#!/usr/bin/env python
+#
+# read_columns.py reads the binary tables made by `report format=columns`
+#
+# F. Nedelec, 2021
+
+"""
+    Read the tables saved by `report WHAT format=columns output=FILE`
+
+Syntax:
+
+    read_columns.py FILE
+
+Description:
+
+    Prints a summary of the tables found in the file.
+    Within a script, `read_columns(FILE)` returns a list of tables, each
+    being a dictionary with keys 'frame', 'time' and 'columns', where
+    'columns' maps the name of each column to a list of values,
+    or to a numpy array if numpy is available.
+
+    `run_report(WHAT, ARGS)` runs `report WHAT ARGS format=columns` in the
+    current directory, and returns its tables in the same way, reading them
+    directly from the output of `report`, without an intermediate file.
+    Example:
+
+        tabs = run_report('fiber:points', 'frame=10')
+"""
+
+import sys, struct, subprocess
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+
+def read_table(file):
+    """
+        Read one table, returning None at the end of the file
+    """
+    head = file.read(24)
+    if len(head) < 24:
+        return None
+    tag, frame, time, nrows, ncols = struct.unpack('=IIdII', head)
+    if tag != 0x42415443:
+        raise IOError("invalid table tag")
+    names = []
+    types = []
+    for c in range(ncols):
+        n, = struct.unpack('=H', file.read(2))
+        names.append(file.read(n).decode())
+        t, = struct.unpack('=B', file.read(1))
+        types.append(t)
+    cols = {}
+    for name, t in zip(names, types):
+        if t == 0:
+            data = file.read(8*nrows)
+            if numpy:
+                cols[name] = numpy.frombuffer(data, dtype=numpy.float64)
+            else:
+                cols[name] = list(struct.unpack('=%id' % nrows, data))
+        else:
+            val = []
+            for r in range(nrows):
+                n, = struct.unpack('=H', file.read(2))
+                val.append(file.read(n).decode())
+            cols[name] = val
+    return { 'frame': frame, 'time': time, 'columns': cols }
+
+
+def read_stream(file, name):
+    """
+        Read all the tables from the binary stream `file`
+    """
+    res = []
+    if not file.readline().startswith(b'#cytosim columns'):
+        raise IOError("`%s' is not a file of columns" % name)
+    tab = read_table(file)
+    while tab:
+        res.append(tab)
+        tab = read_table(file)
+    return res
+
+
+def read_columns(path):
+    """
+        Read all the tables from file `path`
+    """
+    with open(path, 'rb') as file:
+        return read_stream(file, path)
+
+
+def run_report(what, *args, report='report', cwd=None):
+    """
+        Run `report WHAT ARGS format=columns` in directory `cwd`,
+        and return the tables read from its standard output
+    """
+    cmd = [report, what] + list(args) + ['format=columns']
+    sub = subprocess.Popen(cmd, stdout=subprocess.PIPE, cwd=cwd)
+    try:
+        res = read_stream(sub.stdout, ' '.join(cmd))
+    finally:
+        sub.stdout.close()
+        code = sub.wait()
+    if code:
+        raise IOError("`%s' failed" % ' '.join(cmd))
+    return res
+
+
+def main(args):
+    for path in args:
+        for tab in read_columns(path):
+            cols = tab['columns']
+            rows = len(next(iter(cols.values()))) if cols else 0
+            print("frame %4i  time %9.3f  %6i rows : %s" % (tab['frame'], tab['time'], rows, ' '.join(cols)))
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2 or sys.argv[1].endswith("help"):
+        print(__doc__)
+    else:
+        main(sys.argv[1:])
@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+# A script to measure the performance of cytosim on reference configurations
+# Copyright Cambridge University, 2021
+
+"""
+Synopsis:
+
+    Run benchmark simulations, and record their performance in a file.
+    Each config file is run in a separate temporary directory, and the
+    following values are measured:
+        - steps: number of calls to the solver, read from `solver.txt`
+        - seconds: wall-time of the run
+        - steps_per_second: steps / seconds
+        - iterations: average number of iterations of the solver per step
+        - memory: peak resident memory of the process, in kilobytes
+    The config files should specify `solver_log = 1` and `random_seed`
+    such that the runs are reproducible.
+
+    One line is appended to the output file in JSON format, for each config,
+    with the commit of the source code, such that the performance of different
+    versions of cytosim can be compared. Use `compare` to print the last two
+    measures of each config.
+
+Syntax:
+
+    bench.py [executable] [out=FILE] [keep=1] config_file [config_file]
+    bench.py compare [out=FILE]
+
+    The default executable is `bin/sim`, and the default output is `bench.json`.
+    With `keep=1`, the directories of the runs are not deleted.
+
+Example:
+
+    make bench
+    bench.py compare
+
+F. Nedelec, 2021
+"""
+
+try:
+    import os, sys, time, json, shutil, tempfile, subprocess
+except ImportError:
+    sys.stderr.write("bench.py could not load necessary python modules\n")
+    sys.exit()
+
+err = sys.stderr
+
+#------------------------------------------------------------------------
+
+def git_commit():
+    """return hash of the current commit and True if the sources were modified"""
+    # the repository is the one containing this script:
+    top = os.path.dirname(os.path.abspath(__file__))
+    try:
+        sha = subprocess.check_output(['git', 'rev-parse', '--short', 'HEAD'], cwd=top, stderr=subprocess.DEVNULL)
+        dif = subprocess.call(['git', 'diff', '--quiet', 'HEAD', '--', '../../src'], cwd=top, stderr=subprocess.DEVNULL)
+        return sha.decode().strip(), dif != 0
+    except (OSError, subprocess.CalledProcessError):
+        return 'unknown', False
+
+
+def read_solver(path):
+    """return number of steps and average number of iterations in `solver.txt`"""
+    steps = 0
+    count = 0
+    col = 5
+    with open(path) as f:
+        for line in f:
+            s = line.split()
+            if not s:
+                continue
+            if s[0] == '%':
+                # locate the column of iterations in the header:
+                if 'count' in s:
+                    col = s.index('count') - 1
+                continue
+            if s[0].startswith('%'):
+                continue
+            steps += 1
+            count += int(s[col])
+    if steps > 0:
+        return steps, count / float(steps)
+    return 0, 0
+
+#------------------------------------------------------------------------
+
+def run(executable, conf, keep):
+    """run `conf` in a temporary directory and return the measures"""
+    name = os.path.splitext(os.path.basename(conf))[0]
+    wdir = tempfile.mkdtemp(prefix='bench_'+name+'_')
+    shutil.copyfile(conf, os.path.join(wdir, 'config.cym'))
+    # the output of sim is discarded, but not the error messages:
+    start = time.time()
+    pid = subprocess.Popen(executable, cwd=wdir, stdout=subprocess.DEVNULL)
+    # wait4() provides the resources used by this process only:
+    _, sta, use = os.wait4(pid.pid, 0)
+    secs = time.time() - start
+    val = os.WEXITSTATUS(sta) if os.WIFEXITED(sta) else -1
+    pid.returncode = val
+    if val != 0:
+        err.write("%s returned %i in %s\n" % (name, val, wdir))
+        return None
+    # ru_maxrss is given in kilobytes on Linux, but in bytes on macOS:
+    mem = use.ru_maxrss
+    if sys.platform == 'darwin':
+        mem = mem // 1024
+    try:
+        steps, iter = read_solver(os.path.join(wdir, 'solver.txt'))
+    except IOError:
+        err.write("%s did not produce `solver.txt': add `solver_log = 1`\n" % name)
+        steps, iter = 0, 0
+    if not keep:
+        shutil.rmtree(wdir)
+    res = { 'config': name, 'steps': steps, 'seconds': round(secs, 3) }
+    res['steps_per_second'] = round(steps / secs, 2) if secs > 0 else 0
+    res['iterations'] = round(iter, 2)
+    res['memory'] = mem
+    return res
+
+#------------------------------------------------------------------------
+
+def compare(out):
+    """print the last two measures of each config found in `out`"""
+    last = {}
+    with open(out) as f:
+        for line in f:
+            try:
+                r = json.loads(line)
+            except ValueError:
+                continue
+            last.setdefault(r['config'], []).append(r)
+    print("%-16s %10s %10s %10s %9s %10s %9s" % ('config', 'commit', 'steps/s', 'commit', 'steps/s', 'ratio', 'memory'))
+    for name, rs in sorted(last.items()):
+        a = rs[-2] if len(rs) > 1 else rs[-1]
+        b = rs[-1]
+        ratio = b['steps_per_second'] / a['steps_per_second'] if a['steps_per_second'] > 0 else 0
+        print("%-16s %10s %10.2f %10s %9.2f %10.3f %9i" % (name, a['commit'], a['steps_per_second'],
+              b['commit'], b['steps_per_second'], ratio, b['memory']))
+
+#------------------------------------------------------------------------
+
+def main(args):
+    executable = ['bin/sim']
+    out = 'bench.json'
+    keep = False
+    files = []
+    mode = 'run'
+
+    for arg in args:
+        if arg == 'compare':
+            mode = arg
+        elif arg.startswith('out='):
+            out = arg[4:]
+        elif arg.startswith('keep='):
+            keep = bool(int(arg[5:]))
+        elif os.path.isfile(arg) and os.access(arg, os.X_OK):
+            executable = [os.path.abspath(arg)]
+        elif os.path.isfile(arg):
+            files.append(os.path.abspath(arg))
+        else:
+            err.write("  Error: I do not understand `%s'\n" % arg)
+            sys.exit()
+
+    if mode == 'compare':
+        compare(out)
+        return
+
+    if not files:
+        err.write("You should specify config files on the command line\n")
+        sys.exit()
+
+    executable[0] = os.path.abspath(executable[0])
+    if not os.access(executable[0], os.X_OK):
+        err.write("Error: could not find executable `%s'\n" % executable[0])
+        sys.exit()
+
+    commit, modified = git_commit()
+    date = time.strftime('%Y-%m-%d %H:%M:%S')
+    with open(out, 'a') as f:
+        for conf in files:
+            res = run(executable, conf, keep)
+            if res:
+                res['commit'] = commit + ( '+' if modified else '' )
+                res['date'] = date
+                f.write(json.dumps(res, sort_keys=True)+'\n')
+                f.flush()
+                print("%-16s %8i steps %9.2f steps/s %7.2f iterations %9i KB" % (res['config'],
+                      res['steps'], res['steps_per_second'], res['iterations'], res['memory']))
+
+
+#------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2 or sys.argv[1].endswith("help"):
+        print(__doc__)
+    else:
+        main(sys.argv[1:])
+
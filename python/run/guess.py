@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+# A script to check that `simul:initial_guess` works with dynamic fibers
+# Copyright Cambridge University, 2021
+
+"""
+Synopsis:
+
+    Check that a simulation with dynamic fibers runs to completion with every
+    value of `simul:initial_guess`.
+
+    The synthetic system contains an aster of microtubules undergoing dynamic
+    instability, such that the number of points of the fibers changes frequently,
+    and new fibers are created by nucleation. These events invalidate the
+    solutions kept by Meca from the previous steps, which must then be ignored
+    when the initial guess of the solver is calculated.
+    The system is run in a temporary directory for each value of `initial_guess`,
+    and the run must exit normally and write all the frames.
+
+Syntax:
+
+    guess.py [executable] [steps=INT] [frames=INT] [keep]
+
+    The default executable is `bin/sim`, and `report` is expected in the same
+    directory. With `keep`, the temporary directories are not deleted.
+
+Example:
+
+    guess.py bin/sim steps=3000
+
+F. Nedelec, 2021
+"""
+
+try:
+    import os, sys, shutil, tempfile, subprocess
+except ImportError:
+    sys.stderr.write("guess.py could not load necessary python modules\n")
+    sys.exit()
+
+err = sys.stderr
+
+# values of `simul:initial_guess` that are tested
+GUESSES = (0, 1, 2)
+
+#------------------------------------------------------------------------
+
+def config(pam, guess):
+    """return config file of the synthetic system"""
+    return """set simul system
+{
+    time_step = 0.005
+    viscosity = 0.05
+    random_seed = 1
+    initial_guess = %i
+}
+
+set space cell
+{
+    shape = sphere
+}
+
+new cell
+{
+    radius = 8
+}
+
+set fiber microtubule
+{
+    rigidity = 30
+    segmentation = 0.5
+    confine = inside, 100
+    activity = classic
+    growing_speed = 0.5
+    shrinking_speed = -1
+    catastrophe_rate = 0.2
+    rescue_rate = 0.1
+    growing_force = 1.7
+    min_length = 0.5
+    persistent = 0
+}
+
+set solid core
+{
+    display = ( style=3 )
+}
+
+set aster star
+{
+    stiffness = 1000, 500
+    nucleate = 1, microtubule, ( length = 0.5; plus_end = grow; minus_end = static )
+}
+
+new star
+{
+    solid = core
+    radius = 0.5
+    fibers = 64, microtubule, ( length = 1; plus_end = grow; minus_end = static )
+}
+
+run %i system
+{
+    nb_frames = %i
+}
+""" % (guess, pam['steps'], pam['frames'])
+
+
+def frames(executable, wdir):
+    """return number of frames in the trajectory file"""
+    exe = os.path.join(os.path.dirname(executable[0]), 'report')
+    out = subprocess.check_output([exe, 'fiber:length'], cwd=wdir, stderr=subprocess.DEVNULL)
+    return sum(1 for line in out.decode().splitlines() if line.startswith('% frame'))
+
+#------------------------------------------------------------------------
+
+def main(args):
+    executable = ['bin/sim']
+    keep = False
+    pam = { 'steps': 3000, 'frames': 10 }
+
+    for arg in args:
+        key, _, val = arg.partition('=')
+        if key in pam and val:
+            pam[key] = int(val)
+        elif arg == 'keep':
+            keep = True
+        elif os.path.isfile(arg) and os.access(arg, os.X_OK):
+            executable = [arg]
+        else:
+            err.write("  Error: I do not understand `%s'\n" % arg)
+            sys.exit(1)
+
+    executable[0] = os.path.abspath(executable[0])
+    if not os.access(executable[0], os.X_OK):
+        err.write("Error: could not find executable `%s'\n" % executable[0])
+        sys.exit(1)
+
+    root = tempfile.mkdtemp(prefix='guess_')
+    failed = 0
+    for guess in GUESSES:
+        wdir = os.path.join(root, 'guess%i' % guess)
+        os.mkdir(wdir)
+        with open(os.path.join(wdir, 'config.cym'), 'w') as f:
+            f.write(config(pam, guess))
+        code = subprocess.call(executable, cwd=wdir, stdout=subprocess.DEVNULL)
+        if code:
+            print("`initial_guess = %i' failed with exit code %i" % (guess, code))
+            failed += 1
+            continue
+        nbf = frames(executable, wdir)
+        if nbf < pam['frames']:
+            print("`initial_guess = %i' wrote %i frames instead of %i" % (guess, nbf, pam['frames']))
+            failed += 1
+        else:
+            print("`initial_guess = %i' completed" % guess)
+
+    if keep or failed:
+        print("trajectories kept in %s" % root)
+    else:
+        shutil.rmtree(root)
+    sys.exit(failed > 0)
+
+
+#------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    if len(sys.argv) > 1 and sys.argv[1].endswith("help"):
+        print(__doc__)
+    else:
+        main(sys.argv[1:])
@@ -0,0 +1,208 @@
+#!/usr/bin/env python3
+# A script to compare the time spent in the phases of the steps by two versions of cytosim
+# Copyright Cambridge University, 2021
+
+"""
+Synopsis:
+
+    Run the same config file with two executables, check that they produced
+    the same trajectory, and compare the time spent in each phase of the steps.
+
+    The config is copied in temporary directories, adding `simul:profile` and
+    `simul:profile_random` before the first `run` command. With the same
+    `random_seed`, the runs are identical if the executables draw the same
+    random numbers. This is checked by comparing, after each phase of each step,
+    the fingerprints of the random generator written in `profile_random.txt`.
+    Since Meca may generate its Brownian noise concurrently with the first phases
+    of the solve, the runs are compared at the end of each step.
+    If they differ, the first step and phase at which the runs diverged is printed,
+    and the comparison of the profiles is less precise since the runs simulate
+    different systems after this point.
+
+    Each executable is run `repeat` times, alternating between the executables,
+    and the minimum of the times is used for each phase, since the noise of the
+    measures always makes them longer. The phases for which the ratio of times
+    is above `1+threshold` are highlighted, if they take more than 1% of the step.
+
+Syntax:
+
+    regress.py EXECUTABLE1 EXECUTABLE2 CONFIG [repeat=INT] [threshold=REAL] [keep=1]
+
+    The config file should specify `random_seed`. By default `repeat=3` and
+    `threshold=0.05`. With `keep=1`, the directories of the runs are not deleted.
+
+Example:
+
+    regress.py old/sim bin/sim cym/bench_aster.cym
+
+F. Nedelec, 2021
+"""
+
+try:
+    import os, re, sys, shutil, tempfile, subprocess
+except ImportError:
+    sys.stderr.write("regress.py could not load necessary python modules\n")
+    sys.exit()
+
+err = sys.stderr
+
+#------------------------------------------------------------------------
+
+def instrument(conf):
+    """return the config, with profiling enabled before the first `run`"""
+    with open(conf) as f:
+        code = f.read()
+    m = re.search(r'^\s*set\s+simul\s+(\w+)', code, re.M)
+    if not m:
+        err.write("Error: `%s' does not define the simul object\n" % conf)
+        sys.exit()
+    if not re.search(r'random_seed', code):
+        err.write("Warning: `%s' does not specify `random_seed'\n" % conf)
+    add = "change %s\n{\n    profile = 1000000000\n    profile_random = 1\n}\n\n" % m.group(1)
+    r = re.search(r'^\s*run\b', code, re.M)
+    if not r:
+        err.write("Error: `%s' does not contain a `run' command\n" % conf)
+        sys.exit()
+    code = code[:r.start()] + '\n' + add + code[r.start():].lstrip('\n')
+    return code + "\nreport simul:profile profile.txt\n"
+
+
+def read_profile(path):
+    """return dictionary of milliseconds per step, and the list of phases"""
+    res = {}
+    order = []
+    with open(path) as f:
+        for line in f:
+            s = line.split()
+            if len(s) < 5 or s[0].startswith('%'):
+                continue
+            res[s[0]] = float(s[3])
+            order.append(s[0])
+    return res, order
+
+
+def read_random(path):
+    """return list of phase names and list of lines of fingerprints"""
+    names = []
+    lines = []
+    with open(path) as f:
+        for line in f:
+            s = line.split()
+            if not s:
+                continue
+            if s[0] == '%':
+                names = s[2:]
+            else:
+                lines.append(s)
+    return names, lines
+
+
+def last_value(s):
+    """return the last fingerprint recorded in a step"""
+    for x in reversed(s[1:]):
+        if x != '-':
+            return x
+    return '-'
+
+
+def divergence(A, B):
+    """return the first step and phase where the fingerprints differ, or None"""
+    names, a = A
+    _, b = B
+    for x, y in zip(a, b):
+        # the noise of Meca may be generated concurrently with some phases,
+        # and the runs are only compared at the end of each step:
+        if last_value(x) != last_value(y):
+            for i in range(1, min(len(x), len(y))):
+                if x[i] != y[i]:
+                    return x[0], names[i-1] if i-1 < len(names) else '?'
+            return x[0], '?'
+    if len(a) != len(b):
+        return str(min(len(a), len(b))), 'end'
+    return None
+
+#------------------------------------------------------------------------
+
+def run(executable, code, keep):
+    """run config `code` in a temporary directory, and return its profile and fingerprints"""
+    wdir = tempfile.mkdtemp(prefix='regress_')
+    with open(os.path.join(wdir, 'config.cym'), 'w') as f:
+        f.write(code)
+    val = subprocess.call([executable], cwd=wdir, stdout=subprocess.DEVNULL)
+    if val != 0:
+        err.write("%s returned %i in %s\n" % (executable, val, wdir))
+        sys.exit()
+    pro = read_profile(os.path.join(wdir, 'profile.txt'))
+    rnd = read_random(os.path.join(wdir, 'profile_random.txt'))
+    if not keep:
+        shutil.rmtree(wdir)
+    return pro, rnd
+
+
+def main(args):
+    files = []
+    repeat = 3
+    threshold = 0.05
+    keep = False
+    for arg in args:
+        if arg.startswith('repeat='):
+            repeat = max(1, int(arg[7:]))
+        elif arg.startswith('threshold='):
+            threshold = float(arg[10:])
+        elif arg.startswith('keep='):
+            keep = bool(int(arg[5:]))
+        elif os.path.isfile(arg):
+            files.append(os.path.abspath(arg))
+        else:
+            err.write("  Error: I do not understand `%s'\n" % arg)
+            sys.exit()
+    if len(files) != 3:
+        err.write("Syntax: regress.py EXECUTABLE1 EXECUTABLE2 CONFIG\n")
+        sys.exit()
+    exe = files[0:2]
+    code = instrument(files[2])
+
+    best = [{}, {}]
+    order = []
+    rand = [None, None]
+    for n in range(repeat):
+        for i in (0, 1):
+            (pro, phases), rnd = run(exe[i], code, keep)
+            order = order or phases
+            for k, v in pro.items():
+                best[i][k] = min(v, best[i].get(k, v))
+            if rand[i] is None:
+                rand[i] = rnd
+            elif divergence(rand[i], rnd):
+                err.write("Warning: the runs of %s are not reproducible\n" % exe[i])
+
+    div = divergence(rand[0], rand[1])
+    if div:
+        print("% trajectories diverged at step "+div[0]+" in phase `"+div[1]+"'")
+    else:
+        print("%% trajectories are identical over %i steps" % len(rand[0][1]))
+
+    total = best[0].get('total', 0)
+    print("%% %14s %12s %12s %9s" % ('phase', 'ms_per_step1', 'ms_per_step2', 'ratio'))
+    for k in order:
+        a = best[0].get(k, 0)
+        b = best[1].get(k, 0)
+        if a == 0 and b == 0:
+            continue
+        ratio = b / a if a > 0 else float('inf')
+        mark = ''
+        if ratio > 1 + threshold and ( b - a ) > 0.01 * total:
+            mark = '  <<< slower'
+        elif ratio < 1 - threshold and ( a - b ) > 0.01 * total:
+            mark = '  faster'
+        print("  %14s %12.3f %12.3f %9.3f%s" % (k, a, b, ratio, mark))
+
+
+#------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2 or sys.argv[1].endswith("help"):
+        print(__doc__)
+    else:
+        main(sys.argv[1:])
+
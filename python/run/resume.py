@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+# A script to check that a simulation resumed from a checkpoint is exact
+# Copyright Cambridge University, 2021
+
+"""
+Synopsis:
+
+    Check that a simulation interrupted and resumed from its checkpoint
+    produces the same trajectory as the same simulation run without interruption.
+
+    The synthetic system contains an aster of dynamic microtubules, and motors
+    stepping along them. It is first run to completion in a temporary directory.
+    It is then run in another directory with `checkpoint = 1`, killed with SIGKILL
+    after the checkpoint of the middle frame was written, and resumed with
+    `sim resume`.
+    The reports `fiber:points`, `couple:state` and `solid` of the two trajectories
+    must be identical, and any difference is printed with the frame at which it
+    first occurs.
+
+Syntax:
+
+    resume.py [executable] [steps=INT] [frames=INT] [motors=INT] [keep]
+
+    The default executable is `bin/sim`, and `report` is expected in the same
+    directory. With `keep`, the temporary directories are not deleted.
+
+Example:
+
+    resume.py bin/sim steps=2000 frames=20
+
+F. Nedelec, 2021
+"""
+
+try:
+    import os, sys, time, shutil, signal, tempfile, subprocess
+except ImportError:
+    sys.stderr.write("resume.py could not load necessary python modules\n")
+    sys.exit()
+
+err = sys.stderr
+
+# reports that are compared between the two trajectories
+REPORTS = ('fiber:points', 'couple:state', 'solid')
+
+#------------------------------------------------------------------------
+
+def config(pam):
+    """return config file of the synthetic system"""
+    return """set simul system
+{
+    time_step = 0.005
+    viscosity = 0.05
+    random_seed = 1
+}
+
+set space cell
+{
+    shape = sphere
+}
+
+new cell
+{
+    radius = 8
+}
+
+set fiber microtubule
+{
+    rigidity = 30
+    segmentation = 0.5
+    confine = inside, 100
+    activity = classic
+    growing_speed = 0.2
+    shrinking_speed = -0.5
+    catastrophe_rate = 0.05
+    rescue_rate = 0
+    growing_force = 1.7
+    min_length = 0.5
+}
+
+set solid core
+{
+    display = ( style=3 )
+}
+
+set aster star
+{
+    stiffness = 1000, 500
+}
+
+new star
+{
+    solid = core
+    radius = 0.5
+    fibers = 32, microtubule, ( length = 3; plus_end = grow; minus_end = static )
+}
+
+set hand kinesin
+{
+    binding = 10, 0.05
+    unbinding = 0.1, 3
+    activity = walk
+    step_size = 0.008
+    unloaded_speed = 0.8
+    stall_force = 6
+}
+
+set couple motor
+{
+    hand1 = kinesin
+    hand2 = kinesin
+    stiffness = 100
+    diffusion = 10
+}
+
+new %i motor
+
+run %i system
+{
+    nb_frames = %i
+    checkpoint = 1
+}
+""" % (pam['motors'], pam['steps'], pam['frames'])
+
+
+def prepare(wdir, pam):
+    """create directory with config file"""
+    os.mkdir(wdir)
+    with open(os.path.join(wdir, 'config.cym'), 'w') as f:
+        f.write(config(pam))
+
+
+def checkpoint(path):
+    """return first line of checkpoint file, and the frame at which it was written"""
+    try:
+        with open(path, 'rb') as f:
+            line = f.readline().decode().strip()
+        s = line.split()
+        return line, int(s[s.index('frame')+1])
+    except (IOError, ValueError, IndexError):
+        return '', 0
+
+
+def interrupt(executable, wdir, frame):
+    """run simulation, and kill it after a checkpoint was written at `frame` or later"""
+    proc = subprocess.Popen(executable, cwd=wdir, stdout=subprocess.DEVNULL)
+    path = os.path.join(wdir, 'checkpoint.cmo')
+    while proc.poll() is None:
+        if os.path.isfile(path) and checkpoint(path)[1] >= frame:
+            proc.send_signal(signal.SIGKILL)
+            proc.wait()
+            return checkpoint(path)[0]
+        time.sleep(0.01)
+    return ''
+
+
+def report(executable, wdir, what):
+    """return output of `report what` as a list of lines"""
+    exe = os.path.join(os.path.dirname(executable[0]), 'report')
+    out = subprocess.check_output([exe, what], cwd=wdir, stderr=subprocess.DEVNULL)
+    return out.decode().splitlines()
+
+
+def compare(ref, res, what):
+    """return description of the first difference, or empty string"""
+    frame = 0
+    for i, (a, b) in enumerate(zip(ref, res)):
+        if a.startswith('% frame'):
+            frame = a.split()[2]
+        if a != b:
+            return "`%s' differs at frame %s, line %i:\n  < %s\n  > %s" % (what, frame, i+1, a, b)
+    if len(ref) != len(res):
+        return "`%s' differs in length: %i != %i lines" % (what, len(ref), len(res))
+    return ''
+
+#------------------------------------------------------------------------
+
+def main(args):
+    executable = ['bin/sim']
+    keep = False
+    pam = { 'steps': 2000, 'frames': 20, 'motors': 1000 }
+
+    for arg in args:
+        key, _, val = arg.partition('=')
+        if key in pam and val:
+            pam[key] = int(val)
+        elif arg == 'keep':
+            keep = True
+        elif os.path.isfile(arg) and os.access(arg, os.X_OK):
+            executable = [arg]
+        else:
+            err.write("  Error: I do not understand `%s'\n" % arg)
+            sys.exit(1)
+
+    executable[0] = os.path.abspath(executable[0])
+    if not os.access(executable[0], os.X_OK):
+        err.write("Error: could not find executable `%s'\n" % executable[0])
+        sys.exit(1)
+
+    root = tempfile.mkdtemp(prefix='resume_')
+    ref = os.path.join(root, 'ref')
+    res = os.path.join(root, 'res')
+    prepare(ref, pam)
+    prepare(res, pam)
+
+    if subprocess.call(executable, cwd=ref, stdout=subprocess.DEVNULL):
+        err.write("Error: uninterrupted run failed in %s\n" % ref)
+        sys.exit(1)
+    line = interrupt(executable, res, pam['frames']//2)
+    if not line:
+        err.write("Error: the simulation completed before a checkpoint was written\n")
+        sys.exit(1)
+    print("killed after `%s'" % line)
+    if subprocess.call(executable+['resume'], cwd=res, stdout=subprocess.DEVNULL):
+        err.write("Error: resumed run failed in %s\n" % res)
+        sys.exit(1)
+
+    failed = 0
+    for what in REPORTS:
+        msg = compare(report(executable, ref, what), report(executable, res, what), what)
+        if msg:
+            print(msg)
+            failed += 1
+        else:
+            print("`%s' is identical" % what)
+
+    if keep or failed:
+        print("trajectories kept in %s" % root)
+    else:
+        shutil.rmtree(root)
+    sys.exit(failed > 0)
+
+
+#------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    if len(sys.argv) > 1 and sys.argv[1].endswith("help"):
+        print(__doc__)
+    else:
+        main(sys.argv[1:])
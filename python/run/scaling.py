@@ -0,0 +1,248 @@
+#!/usr/bin/env python3
+# A script to measure how the performance of cytosim scales with the number of threads
+# Copyright Cambridge University, 2021
+
+"""
+Synopsis:
+
+    Run synthetic systems of increasing size with different numbers of threads,
+    and print tables of strong and weak scaling.
+
+    The synthetic system contains `fibers` filaments of `points` vertices,
+    and `couples` crosslinkers, in a cell whose volume is proportional to the
+    size of the system, such that the density remains the same. For a size `S`,
+    the numbers of fibers and couples are multiplied by `S`.
+    Each system is run for `steps` time steps in a temporary directory, with
+    `simul:profile` enabled, and the time spent in each step is separated in:
+        - solve: the phases of Meca::solve (prepare, interactions, steric,
+          precondition, iterations, apply)
+        - step: the other phases of Simul::step
+
+    Strong scaling: for each size, the speedup and efficiency relative to 1 thread.
+    Weak scaling: with N threads the size is multiplied by N, and the efficiency
+                  is the time of 1 thread at size 1, divided by the time with N threads.
+
+Syntax:
+
+    scaling.py [executable] [threads=LIST] [sizes=LIST] [mode=strong|weak|both]
+               [fibers=INT] [points=INT] [couples=INT] [steps=INT] [out=FILE]
+
+    The default executable is `bin/sim`. LIST is a comma-separated list of integers.
+    By default, `threads` are the powers of 2 up to the number of processors, and
+    `sizes=1,2,4`. With `out=FILE`, one line is appended to FILE in JSON format
+    for each run.
+
+Example:
+
+    scaling.py threads=1,2,4,8 sizes=1,4 fibers=200 couples=4000
+
+F. Nedelec, 2021
+"""
+
+try:
+    import os, sys, json, shutil, tempfile, subprocess
+except ImportError:
+    sys.stderr.write("scaling.py could not load necessary python modules\n")
+    sys.exit()
+
+err = sys.stderr
+
+# phases of the profile that belong to Meca::solve
+SOLVE = ('prepare', 'interactions', 'steric', 'precondition', 'iterations', 'apply')
+
+#------------------------------------------------------------------------
+
+def dimension(executable):
+    """return the dimension of the simulation, reading the output of `sim info`"""
+    try:
+        out = subprocess.check_output(executable+['info'], stderr=subprocess.DEVNULL)
+    except (OSError, subprocess.CalledProcessError):
+        return 3
+    for line in out.decode().splitlines():
+        s = line.split()
+        if 'Dimension:' in s:
+            return int(s[s.index('Dimension:')+1])
+    return 3
+
+
+def config(size, threads, pam, dim):
+    """return config file for a synthetic system of given size"""
+    length = 0.5 * ( pam['points'] - 1 )
+    # the volume is proportional to the size of the system:
+    radius = pam['radius'] * size ** ( 1.0 / dim )
+    return """set simul system
+{
+    time_step = 0.01
+    viscosity = 0.1
+    random_seed = 1
+    threads = %i
+    profile = %i
+}
+
+set space cell
+{
+    shape = sphere
+}
+
+new cell
+{
+    radius = %.3f
+}
+
+set fiber filament
+{
+    rigidity = 20
+    segmentation = 0.5
+    confine = inside, 100
+}
+
+set hand binder
+{
+    binding = 10, 0.05
+    unbinding = 0.1, 3
+}
+
+set couple crosslinker
+{
+    hand1 = binder
+    hand2 = binder
+    stiffness = 100
+    diffusion = 10
+}
+
+new %i filament
+{
+    length = %.3f
+}
+
+new %i crosslinker
+
+run %i system
+
+report simul:profile profile.txt
+""" % (threads, pam['steps'], radius, pam['fibers']*size, length, pam['couples']*size, pam['steps'])
+
+
+def read_profile(path):
+    """return milliseconds per step spent in solve, in the other phases, and in total"""
+    solve = 0
+    total = 0
+    output = 0
+    with open(path) as f:
+        for line in f:
+            s = line.split()
+            if len(s) < 5 or s[0].startswith('%'):
+                continue
+            ms = float(s[3])
+            if s[0] == 'total':
+                total = ms
+            elif s[0] == 'output':
+                output = ms
+            elif s[0] in SOLVE:
+                solve += ms
+    return solve, total - solve - output, total
+
+#------------------------------------------------------------------------
+
+def run(executable, size, threads, pam, dim):
+    """run the synthetic system in a temporary directory and return the measures"""
+    wdir = tempfile.mkdtemp(prefix='scaling_')
+    with open(os.path.join(wdir, 'config.cym'), 'w') as f:
+        f.write(config(size, threads, pam, dim))
+    val = subprocess.call(executable, cwd=wdir, stdout=subprocess.DEVNULL)
+    if val != 0:
+        err.write("run of size %i with %i threads returned %i in %s\n" % (size, threads, val, wdir))
+        return None
+    try:
+        solve, step, total = read_profile(os.path.join(wdir, 'profile.txt'))
+    except IOError:
+        err.write("run of size %i with %i threads did not produce `profile.txt'\n" % (size, threads))
+        return None
+    shutil.rmtree(wdir)
+    return { 'size': size, 'threads': threads, 'solve': round(solve, 3), 'step': round(step, 3), 'total': round(total, 3) }
+
+
+def table(title, rows, ref):
+    """print measures, with speedup and efficiency relative to `ref(row)`"""
+    print("\n%% %s" % title)
+    print("%6s %8s %10s %10s %10s %9s %11s" % ('size', 'threads', 'solve_ms', 'step_ms', 'total_ms', 'speedup', 'efficiency'))
+    for r in rows:
+        r0 = ref(r)
+        speed = r0['total'] / r['total'] if r0 and r['total'] > 0 else 0
+        if title.startswith('weak'):
+            eff = speed
+            speed *= r['threads']
+        else:
+            eff = speed / r['threads']
+        print("%6i %8i %10.3f %10.3f %10.3f %9.2f %10.1f%%" % (r['size'], r['threads'],
+              r['solve'], r['step'], r['total'], speed, 100*eff))
+
+#------------------------------------------------------------------------
+
+def main(args):
+    executable = ['bin/sim']
+    ncpu = os.cpu_count() or 1
+    threads = [ 1<<n for n in range(ncpu.bit_length()) if 1<<n <= ncpu ]
+    sizes = [1, 2, 4]
+    mode = 'both'
+    out = ''
+    pam = { 'fibers': 100, 'points': 11, 'couples': 2000, 'steps': 100, 'radius': 5.0 }
+
+    for arg in args:
+        key, _, val = arg.partition('=')
+        if key in pam and val:
+            pam[key] = int(val)
+        elif key == 'threads' and val:
+            threads = [ int(x) for x in val.split(',') ]
+        elif key == 'sizes' and val:
+            sizes = [ int(x) for x in val.split(',') ]
+        elif key == 'mode' and val in ('strong', 'weak', 'both'):
+            mode = val
+        elif key == 'out' and val:
+            out = val
+        elif os.path.isfile(arg) and os.access(arg, os.X_OK):
+            executable = [os.path.abspath(arg)]
+        else:
+            err.write("  Error: I do not understand `%s'\n" % arg)
+            sys.exit()
+
+    executable[0] = os.path.abspath(executable[0])
+    if not os.access(executable[0], os.X_OK):
+        err.write("Error: could not find executable `%s'\n" % executable[0])
+        sys.exit()
+    dim = dimension(executable)
+
+    # list the runs, without repetition:
+    todo = []
+    if mode != 'weak':
+        todo += [ (s, t) for s in sizes for t in threads ]
+    if mode != 'strong':
+        todo += [ (t, t) for t in threads ]
+        todo.append((1, 1))
+    res = {}
+    for key in todo:
+        if key not in res:
+            res[key] = run(executable, key[0], key[1], pam, dim)
+            if res[key] and out:
+                with open(out, 'a') as f:
+                    r = dict(res[key], **pam)
+                    f.write(json.dumps(r, sort_keys=True)+'\n')
+
+    print("%% %iD, %i fibers of %i points and %i couples per unit of size, %i steps" % (dim,
+          pam['fibers'], pam['points'], pam['couples'], pam['steps']))
+    if mode != 'weak':
+        rows = [ res[(s, t)] for s in sizes for t in threads if res[(s, t)] ]
+        table('strong scaling', rows, lambda r: res.get((r['size'], 1)))
+    if mode != 'strong':
+        rows = [ res[(t, t)] for t in threads if res[(t, t)] ]
+        table('weak scaling', rows, lambda r: res.get((1, 1)))
+
+
+#------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    if len(sys.argv) > 1 and sys.argv[1].endswith("help"):
+        print(__doc__)
+    else:
+        main(sys.argv[1:])
+
@@ -0,0 +1,58 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#include "anomaly_monitor.h"
+#include <algorithm>
+
+// definition needed since std::min() takes WINDOW by reference:
+constexpr size_t AnomalyMonitor::WINDOW;
+
+
+AnomalyMonitor::AnomalyMonitor(double factor, size_t limit, size_t gap)
+: factor_(factor), limit_(limit), gap_(gap), cnt_(0), last_(0), reports_(0), skipped_(0)
+{
+    med_[0] = 0;
+    med_[1] = 0;
+}
+
+
+double AnomalyMonitor::median(int k) const
+{
+    const size_t n = std::min(cnt_, WINDOW);
+    if ( n == 0 )
+        return 0;
+    double tmp[WINDOW];
+    std::copy(val_[k], val_[k]+n, tmp);
+    std::nth_element(tmp, tmp+n/2, tmp+n);
+    return tmp[n/2];
+}
+
+
+int AnomalyMonitor::check(double iterations, double time)
+{
+    int res = 0;
+    if ( cnt_ >= WINDOW/2 )
+    {
+        med_[0] = median(0);
+        med_[1] = median(1);
+        // the iterations are compared with a minimum of 1, to ignore direct solves:
+        if ( iterations > factor_ * std::max(med_[0], 1.0) )
+            res |= ITERATIONS;
+        if ( time > factor_ * med_[1] )
+            res |= TIME;
+    }
+    val_[0][cnt_%WINDOW] = iterations;
+    val_[1][cnt_%WINDOW] = time;
+    ++cnt_;
+    
+    if ( res )
+    {
+        if ( reports_ >= limit_ || ( reports_ > 0 && cnt_ < last_ + gap_ ) )
+        {
+            ++skipped_;
+            return 0;
+        }
+        last_ = cnt_;
+        ++reports_;
+    }
+    return res;
+}
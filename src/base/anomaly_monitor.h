@@ -0,0 +1,85 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef ANOMALY_MONITOR_H
+#define ANOMALY_MONITOR_H
+
+#include <cstddef>
+
+
+/// Detects the steps that are much slower than the recent ones
+/**
+ The number of iterations of the solver and the wall-time of each step are
+ kept for the last WINDOW steps, and a step is anomalous if one of these values
+ exceeds `factor` times the median of the previous steps.
+ No step is flagged until the window is half full.
+
+ The reports are rate-limited: after a report, the anomalies of the next `gap`
+ steps are only counted, and at most `limit` reports are made in total.
+ */
+class AnomalyMonitor
+{
+public:
+
+    /// number of steps used to calculate the medians
+    static constexpr size_t WINDOW = 64;
+
+    /// bit field returned by check()
+    enum { ITERATIONS = 1, TIME = 2 };
+
+private:
+
+    /// threshold relative to the median
+    double factor_;
+
+    /// maximum number of reports
+    size_t limit_;
+
+    /// minimum number of steps between two reports
+    size_t gap_;
+
+    /// circular buffers of the values of the last steps
+    double val_[2][WINDOW];
+
+    /// number of steps recorded
+    size_t cnt_;
+
+    /// step of the last report
+    size_t last_;
+
+    /// number of reports made
+    size_t reports_;
+
+    /// number of anomalies that were not reported
+    size_t skipped_;
+
+    /// medians calculated by the last call to check()
+    double med_[2];
+
+    /// calculate the median of the values of kind `k`
+    double median(int k) const;
+
+public:
+
+    /// constructor
+    AnomalyMonitor(double factor, size_t limit, size_t gap);
+
+    /// record a step, returning a combination of ITERATIONS and TIME if it should be reported
+    int check(double iterations, double time);
+
+    /// median of the number of iterations, before the last step
+    double medianIterations() const { return med_[0]; }
+
+    /// median of the wall-time of the steps, before the last step
+    double medianTime() const { return med_[1]; }
+
+    /// number of steps recorded
+    size_t steps() const { return cnt_; }
+
+    /// number of reports made
+    size_t reports() const { return reports_; }
+
+    /// number of anomalies that were not reported, because of the rate limit
+    size_t skipped() const { return skipped_; }
+};
+
+#endif
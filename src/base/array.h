@@ -6,6 +6,7 @@
 #include "assert_macro.h"
 #include "random.h"
 #include <iostream>
+#include <utility>
 
 
 /**
@@ -35,6 +36,9 @@
  
  Allocation when it is done exceeds what is requested, to ensure that allocation
  only occurs from time-to-time, even if objects are added one by one to the array.
+ When values are added one by one, the capacity is at least doubled, such that
+ the cost of filling the array remains linear with the number of values.
+ See SmallArray for an array of a few values that usually avoids allocation.
  */
 
 /// Dynamically allocated array of VAL
@@ -75,6 +79,12 @@ private:
         return ( s + chk_ - 1 ) & ~( chk_ - 1 );
     }
     
+    /// capacity to hold `s` objects, at least twice the current capacity
+    size_t grown(size_t s)
+    {
+        return chunked(std::max(s, 2*alc_));
+    }
+    
     /// return smallest power of 2 that is greater or equal to `s`
     size_t next_power(size_t s)
     {
@@ -131,6 +141,15 @@ public:
         }
     }
 
+    /// Move constructor, taking the memory of `o`
+    Array(Array<VAL>&& o)
+    : val_(o.val_), alc_(o.alc_), nbo_(o.nbo_), chk_(o.chk_)
+    {
+        o.val_ = nullptr;
+        o.alc_ = 0;
+        o.nbo_ = 0;
+    }
+
     /// Destructor
     virtual ~Array()
     {
@@ -151,6 +170,17 @@ public:
         return *this;
     }
     
+    /// Move assignment, exchanging memory with `o`
+    Array& operator =(Array<VAL>&& o)
+    {
+        std::swap(val_, o.val_);
+        std::swap(alc_, o.alc_);
+        std::swap(nbo_, o.nbo_);
+        std::swap(chk_, o.chk_);
+        o.nbo_ = 0;
+        return *this;
+    }
+    
 #pragma mark -
     
     /// Number of objects
@@ -171,6 +201,12 @@ public:
         return alc_;
     }
     
+    /// Size of the memory allocated, in bytes
+    size_t memory() const
+    {
+        return alc_ * sizeof(VAL);
+    }
+    
     /// Address of the underlying C-array
     VAL * data()
     {
@@ -328,7 +364,7 @@ public:
     VAL & new_val()
     {
         if ( nbo_ >= alc_ )
-            reallocate(chunked(nbo_+1));
+            reallocate(grown(nbo_+1));
         VAL& res = val_[nbo_++];
         return res;
     }
@@ -337,10 +373,21 @@ public:
     void push_back(VAL const& v)
     {
         if ( nbo_ >= alc_ )
-            reallocate(chunked(nbo_+1));
+            reallocate(grown(nbo_+1));
         val_[nbo_++] = v;
     }
     
+    /// Add a value constructed from `args` at the end of this Array
+    template < typename... Args >
+    VAL & emplace_back(Args&&... args)
+    {
+        if ( nbo_ >= alc_ )
+            reallocate(grown(nbo_+1));
+        VAL& res = val_[nbo_++];
+        res = VAL(std::forward<Args>(args)...);
+        return res;
+    }
+    
     /// remove last element
     void pop_back()
     {
@@ -348,7 +395,7 @@ public:
     }
 
     /// Add the elements of `array` at the end of this Array
-    void append(const Array<VAL> array)
+    void append(Array<VAL> const& array)
     {
         allocate(nbo_+array.nbo_);
         for ( size_t ii = 0; ii < array.nbo_; ++ii )
@@ -357,7 +404,7 @@ public:
     }
     
     /// Add the elements of `array` at the end of this Array
-    void append_except(const Array<VAL> array, VAL const& v)
+    void append_except(Array<VAL> const& array, VAL const& v)
     {
         allocate(nbo_+array.nbo_);
         for ( size_t ii = 0; ii < array.nbo_; ++ii )
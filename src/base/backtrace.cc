@@ -46,3 +46,60 @@ void print_backtrace(int out)
 
 #endif
 
+//------------------------------------------------------------------------------
+// collecting the addresses is kept available, to locate allocations in operator_new.cc
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+
+#include <execinfo.h>
+#include <cxxabi.h>
+#include <stdlib.h>
+
+int collect_backtrace(void** buffer, int size)
+{
+    return backtrace(buffer, size);
+}
+
+/**
+ The symbol is found by backtrace_symbols(), which only knows the names that are
+ exported: link with `-rdynamic` to get the names of all the functions of cytosim.
+ Otherwise the offset in the executable can be given to `addr2line -f -C -e`.
+ */
+std::string backtrace_symbol(void* ptr)
+{
+    std::string res;
+    char** strs = backtrace_symbols(&ptr, 1);
+    if ( strs )
+    {
+        res = strs[0];
+        free(strs);
+    }
+    // the mangled name is between '(' and '+' on Linux:
+    size_t a = res.find('(');
+    size_t b = res.find('+', a);
+    if ( a != std::string::npos && b != std::string::npos && b > a+1 )
+    {
+        int status = 0;
+        char * dem = abi::__cxa_demangle(res.substr(a+1, b-a-1).c_str(), nullptr, nullptr, &status);
+        if ( dem && status == 0 )
+            res = res.substr(0, a+1) + dem + res.substr(b);
+        free(dem);
+    }
+    return res;
+}
+
+#else
+
+int collect_backtrace(void**, int)
+{
+    return 0;
+}
+
+std::string backtrace_symbol(void* ptr)
+{
+    char str[32];
+    snprintf(str, sizeof(str), "%p", ptr);
+    return str;
+}
+
+#endif
@@ -19,11 +19,18 @@
 
 
 #include <cstdio>
+#include <string>
 
 
 /// print the stack of function calls for the current thread
 void print_backtrace(int fildes = 2);
 
+/// store up to `size` return addresses of the current call-stack in `buffer`, and return their number
+int collect_backtrace(void** buffer, int size);
+
+/// name of the function containing the address `ptr`, demangled if possible
+std::string backtrace_symbol(void* ptr);
+
 
 #endif
 
@@ -0,0 +1,145 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#include "column_writer.h"
+#include <sstream>
+#include <cstdlib>
+#include <map>
+
+
+/// split `str` into words separated by white space
+static void split(std::vector<std::string>& res, std::string const& str)
+{
+    res.clear();
+    std::istringstream iss(str);
+    std::string w;
+    while ( iss >> w )
+        res.push_back(w);
+}
+
+
+/// true if the entire string `str` is a number
+static bool is_number(std::string const& str)
+{
+    char * end = nullptr;
+    strtod(str.c_str(), &end);
+    return end != str.c_str() && *end == 0;
+}
+
+
+void ColumnWriter::add_row(std::vector<Table>& tables, std::string const& header,
+                           std::vector<std::string> const& words)
+{
+    Table * tab = nullptr;
+    for ( Table & t : tables )
+        if ( t.header == header && t.cols.size() == words.size() )
+            tab = &t;
+    if ( !tab )
+    {
+        tables.push_back(Table());
+        tab = &tables.back();
+        tab->header = header;
+        tab->rows = 0;
+        std::vector<std::string> names;
+        split(names, header);
+        tab->cols.resize(words.size());
+        for ( size_t i = 0; i < words.size(); ++i )
+        {
+            if ( i < names.size() )
+                tab->cols[i].name = names[i];
+            else
+                tab->cols[i].name = "col" + std::to_string(i);
+        }
+    }
+    for ( size_t i = 0; i < words.size(); ++i )
+        tab->cols[i].cells.push_back(words[i]);
+    ++tab->rows;
+}
+
+
+void ColumnWriter::write_table(Table const& tab, uint32_t frame, double time)
+{
+    uint32_t u = TAG;
+    put(&u, 4);
+    put(&frame, 4);
+    put(&time, 8);
+    u = (uint32_t)tab.rows;
+    put(&u, 4);
+    u = (uint32_t)tab.cols.size();
+    put(&u, 4);
+
+    std::vector<uint8_t> types;
+    for ( Column const& col : tab.cols )
+    {
+        uint16_t n = (uint16_t)col.name.size();
+        put(&n, 2);
+        put(col.name.data(), n);
+        uint8_t t = 0;
+        for ( std::string const& s : col.cells )
+            if ( !is_number(s) )
+            {
+                t = 1;
+                break;
+            }
+        put(&t, 1);
+        types.push_back(t);
+    }
+
+    for ( size_t c = 0; c < tab.cols.size(); ++c )
+    {
+        Column const& col = tab.cols[c];
+        if ( types[c] == 0 )
+        {
+            std::vector<double> val(col.cells.size());
+            for ( size_t i = 0; i < val.size(); ++i )
+                val[i] = strtod(col.cells[i].c_str(), nullptr);
+            put(val.data(), 8*val.size());
+        }
+        else
+        {
+            for ( std::string const& s : col.cells )
+            {
+                uint16_t n = (uint16_t)s.size();
+                put(&n, 2);
+                put(s.data(), n);
+            }
+        }
+    }
+}
+
+
+/**
+ Lines starting with '%' are comments, and the comments found after the last
+ `% report` line are candidate headers for the following lines of data.
+ Empty lines are skipped.
+ */
+void ColumnWriter::write_frame(uint32_t frame, double time, std::string const& text)
+{
+    std::vector<Table> tables;
+    // last comment for each number of words:
+    std::map<size_t, std::string> comments;
+    std::vector<std::string> words;
+    std::istringstream iss(text);
+    std::string line;
+
+    while ( std::getline(iss, line) )
+    {
+        size_t s = line.find_first_not_of(" \t");
+        if ( s == std::string::npos )
+            continue;
+        if ( line[s] == '%' )
+        {
+            std::string com = line.substr(s+1);
+            split(words, com);
+            if ( words.size() && words[0] == "report" )
+                comments.clear();
+            else if ( words.size() )
+                comments[words.size()] = com;
+            continue;
+        }
+        split(words, line);
+        add_row(tables, comments[words.size()], words);
+    }
+
+    for ( Table const& tab : tables )
+        write_table(tab, frame, time);
+}
@@ -0,0 +1,83 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef COLUMN_WRITER_H
+#define COLUMN_WRITER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+/// Converts reports into tables of typed columns, saved in binary format
+/**
+ ColumnWriter reads the text generated by Simul::report() for one frame,
+ and saves the data as tables made of typed columns, which can be loaded
+ directly by analysis scripts (see `python/look/read_columns.py`).
+
+ The lines of data that follow the same header are collected in one table,
+ whose columns are named after the words of the header. The header of a line
+ of data is the last line of comment that has the same number of words as the
+ line has values. A column is numeric if all its values are numbers, and
+ otherwise it is a column of strings.
+
+ The file starts with the line "#cytosim columns 1\n", and holds one table per
+ frame and header, in the native byte order (little-endian on common machines):
+
+     uint32  tag = 'CTAB'
+     uint32  frame
+     double  time
+     uint32  number of rows
+     uint32  number of columns
+     for each column:
+       uint16  length of name, followed by name
+       uint8   type: 0 = float64, 1 = string
+     for each column:
+       float64 values, or for strings: uint16 length followed by the characters
+ */
+class ColumnWriter
+{
+    /// a column under construction
+    struct Column
+    {
+        std::string name;
+        std::vector<std::string> cells;
+    };
+
+    /// a table under construction
+    struct Table
+    {
+        std::string header;
+        std::vector<Column> cols;
+        size_t rows;
+    };
+
+    /// destination
+    std::ostream& out_;
+
+    /// add the line of `words` to the table of given `header` in `tables`
+    static void add_row(std::vector<Table>&, std::string const& header,
+                        std::vector<std::string> const& words);
+
+    /// save one table
+    void write_table(Table const&, uint32_t frame, double time);
+
+    /// write binary data
+    void put(const void * ptr, size_t size) { out_.write((const char*)ptr, size); }
+
+public:
+
+    /// tag at the start of a table
+    static const uint32_t TAG = 0x42415443;  // "CTAB"
+
+    /// constructor
+    ColumnWriter(std::ostream& os) : out_(os) {}
+
+    /// write the first line of the file
+    void start() { out_ << "#cytosim columns 1\n"; }
+
+    /// parse the report `text`, and save its tables
+    void write_frame(uint32_t frame, double time, std::string const& text);
+};
+
+#endif
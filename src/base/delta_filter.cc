@@ -0,0 +1,113 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#include "delta_filter.h"
+#include "iowrapper.h"
+#include "exceptions.h"
+#include <cstdlib>
+
+
+/// FNV-1a hash of `len` bytes
+static uint64_t hash_bytes(const char * ptr, size_t len)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for ( size_t i = 0; i < len; ++i )
+    {
+        h ^= (unsigned char)ptr[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+
+DeltaFilter::DeltaFilter()
+: scratch_(nullptr), buf_(nullptr), len_(0), output_(nullptr), key_(0),
+  binary_(true), count_(0), key_frame_(true), skipped_(0)
+{
+}
+
+
+DeltaFilter::~DeltaFilter()
+{
+    if ( scratch_ )
+        fclose(scratch_);
+    free(buf_);
+}
+
+
+int DeltaFilter::start(std::string const& path, bool append, bool binary, unsigned period)
+{
+    if ( path_.empty() )
+        path_ = path;
+    else if ( path != path_ )
+        return -1;
+
+    key_frame_ = ( !append || binary != binary_ || count_ == 0 || count_ >= period );
+    if ( key_frame_ )
+        count_ = 0;
+    binary_ = binary;
+    skipped_ = 0;
+    next_.clear();
+    next_.reserve(last_.size());
+    return count_;
+}
+
+
+void DeltaFilter::begin(Outputter& out, uint64_t key)
+{
+    if ( !scratch_ )
+    {
+        scratch_ = open_memstream(&buf_, &len_);
+        if ( !scratch_ )
+            throw InvalidIO("could not allocate memory for delta frames");
+    }
+    rewind(scratch_);
+    key_ = key;
+    output_ = out.redirect(scratch_);
+}
+
+
+void DeltaFilter::end(Outputter& out)
+{
+    out.redirect(output_);
+    off_t size = ftello(scratch_);
+    fflush(scratch_);
+    Print p(size, hash_bytes(buf_, size));
+    next_[key_] = p;
+    if ( !key_frame_ )
+    {
+        auto i = last_.find(key_);
+        if ( i != last_.end() && i->second == p )
+        {
+            ++skipped_;
+            return;
+        }
+    }
+    if ( size != (off_t)fwrite(buf_, 1, size, output_) )
+        throw InvalidIO("failed to write delta frame");
+}
+
+
+void DeltaFilter::deleted(std::vector<uint64_t>& res) const
+{
+    res.clear();
+    if ( key_frame_ )
+        return;
+    for ( auto const& i : last_ )
+        if ( !next_.count(i.first) )
+            res.push_back(i.first);
+}
+
+
+void DeltaFilter::finish()
+{
+    last_.swap(next_);
+    next_.clear();
+    ++count_;
+}
+
+
+void DeltaFilter::cancel()
+{
+    next_.clear();
+    count_ = 0;
+}
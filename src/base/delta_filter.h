@@ -0,0 +1,119 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef DELTA_FILTER_H
+#define DELTA_FILTER_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class Outputter;
+
+
+/// Omits the records that are identical to those written in the previous frame
+/**
+ DeltaFilter is used to write 'delta frames' to a trajectory file, containing
+ only the objects that have changed since the previous frame. Each record is
+ first written to a buffer in memory, and it is copied to the output only if
+ it differs from the record written with the same key in the previous frame.
+ The records are compared using their size and a 64-bit hash value.
+
+ One frame in `period` is a 'keyframe', in which all records are written, and
+ the other frames are relative to the previous one, such that the complete
+ state can be reconstructed from the keyframe by applying the delta frames in
+ order. The keys of the previous frame that are not written in the current
+ frame are given by deleted().
+
+ A DeltaFilter follows one file: frames written to other files are not filtered.
+ */
+class DeltaFilter
+{
+    /// size and hash value of a record
+    typedef std::pair<size_t, uint64_t> Print;
+
+    /// records of the previous frame
+    std::unordered_map<uint64_t, Print> last_;
+
+    /// records of the current frame
+    std::unordered_map<uint64_t, Print> next_;
+
+    /// buffer in which records are written
+    FILE *   scratch_;
+
+    /// memory of scratch_
+    char *   buf_;
+
+    /// size of buf_
+    size_t   len_;
+
+    /// the output into which records are copied
+    FILE *   output_;
+
+    /// key of the current record
+    uint64_t key_;
+
+    /// file followed by the filter
+    std::string path_;
+
+    /// format of the file
+    bool     binary_;
+
+    /// number of frames written since the last keyframe
+    unsigned count_;
+
+    /// true if all records are written in the current frame
+    bool     key_frame_;
+
+    /// number of records that were omitted in the current frame
+    size_t   skipped_;
+
+    /// disabled copy constructor
+    DeltaFilter(DeltaFilter const&);
+
+    /// disabled assignment operator
+    DeltaFilter& operator = (DeltaFilter const&);
+
+public:
+
+    /// constructor
+    DeltaFilter();
+
+    /// destructor
+    ~DeltaFilter();
+
+    /**
+     Prepare for a frame written to file `path`, returning the frame's distance
+     to its keyframe: 0 if the frame should be complete, or a positive number.
+     Returns -1 if this file is not followed, in which case the filter should not
+     be used for this frame.
+     */
+    int      start(std::string const& path, bool append, bool binary, unsigned period);
+
+    /// true if the current frame is complete
+    bool     keyFrame() const { return key_frame_; }
+    
+    /// number of frames between the current frame and the last keyframe
+    unsigned count() const { return count_; }
+
+    /// redirect the output of `out` to the buffer, for the record identified by `key`
+    void     begin(Outputter& out, uint64_t key);
+
+    /// restore the output of `out`, and copy the record to it, if it has changed
+    void     end(Outputter& out);
+
+    /// keys of the previous frame that were not written in the current frame
+    void     deleted(std::vector<uint64_t>&) const;
+
+    /// conclude the current frame
+    void     finish();
+
+    /// cancel the current frame, such that the next frame will be a keyframe
+    void     cancel();
+
+    /// number of records that were omitted in the current frame
+    size_t   skipped() const { return skipped_; }
+};
+
+#endif
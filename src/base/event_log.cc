@@ -0,0 +1,112 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#include "event_log.h"
+#include <chrono>
+
+
+EventLog::EventLog()
+: head_(0), tail_(0), stop_(false), file_(nullptr)
+{
+    for ( size_t i = 0; i < SIZE; ++i )
+        seq_[i].store(i, std::memory_order_relaxed);
+}
+
+
+bool EventLog::open(const char* filename)
+{
+    close();
+    file_ = fopen(filename, "wb");
+    if ( !file_ )
+        return false;
+    if ( ferror(file_) )
+    {
+        fclose(file_);
+        file_ = nullptr;
+        return false;
+    }
+    fputs(MAGIC, file_);
+    stop_.store(false);
+    writer_ = std::thread(&EventLog::run, this);
+    return true;
+}
+
+
+/**
+ This follows the bounded queue of D. Vyukov: a producer reserves a slot
+ by incrementing `head_`, and releases it to the writer by updating
+ the sequence number of this slot.
+ */
+void EventLog::record(EventRecord const& rec)
+{
+    if ( !file_ )
+        return;
+    size_t pos = head_.load(std::memory_order_relaxed);
+    while ( 1 )
+    {
+        size_t seq = seq_[pos%SIZE].load(std::memory_order_acquire);
+        if ( seq == pos )
+        {
+            if ( head_.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed) )
+                break;
+        }
+        else
+        {
+            // the buffer is full, or another thread took the slot
+            if ( seq < pos )
+                std::this_thread::yield();
+            pos = head_.load(std::memory_order_relaxed);
+        }
+    }
+    slot_[pos%SIZE] = rec;
+    seq_[pos%SIZE].store(pos+1, std::memory_order_release);
+}
+
+
+size_t EventLog::drain()
+{
+    EventRecord buf[256];
+    size_t cnt = 0, res = 0;
+    while ( 1 )
+    {
+        size_t pos = tail_;
+        if ( seq_[pos%SIZE].load(std::memory_order_acquire) != pos+1 )
+            break;
+        buf[cnt++] = slot_[pos%SIZE];
+        // release the slot for the next round:
+        seq_[pos%SIZE].store(pos+SIZE, std::memory_order_release);
+        tail_ = pos+1;
+        if ( cnt == 256 )
+        {
+            fwrite(buf, sizeof(EventRecord), cnt, file_);
+            res += cnt;
+            cnt = 0;
+        }
+    }
+    if ( cnt )
+        fwrite(buf, sizeof(EventRecord), cnt, file_);
+    return res + cnt;
+}
+
+
+void EventLog::run()
+{
+    while ( !stop_.load(std::memory_order_acquire) )
+    {
+        if ( 0 == drain() )
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+
+void EventLog::close()
+{
+    if ( file_ )
+    {
+        stop_.store(true, std::memory_order_release);
+        if ( writer_.joinable() )
+            writer_.join();
+        drain();
+        fclose(file_);
+        file_ = nullptr;
+    }
+}
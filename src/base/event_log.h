@@ -0,0 +1,109 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <atomic>
+#include <thread>
+#include <cstdio>
+#include <cstdint>
+
+
+/// A compact record of an event affecting a fiber, as stored in the binary file
+struct EventRecord
+{
+    /// types of events
+    enum { BREAK = 1, SEVER = 2 };
+
+    /// simulated time
+    double   time;
+
+    /// abscissa of the event along the fiber
+    double   abscissa;
+
+    /// tension of the fiber at the site of the event
+    float    tension;
+
+    /// type of event (BREAK or SEVER)
+    uint32_t kind;
+
+    /// identity of the fiber
+    uint32_t fiber;
+
+    /// identity of the fragment created by the event, or zero
+    uint32_t fragment;
+};
+
+
+/// Records EventRecord in a binary file, using a background thread
+/**
+ record() places the event in a ring buffer, without locking, and can be
+ called by multiple threads concurrently. A separate thread empties the buffer
+ regularly and writes the records to file, such that the simulation does not
+ wait for the disk. If the buffer is full, record() waits for the writer.
+
+ The file starts with the line `EventLog::MAGIC`, followed by the records.
+ They can be converted to text with `tools/events.cc`.
+ */
+class EventLog
+{
+public:
+
+    /// first line of the file
+    static constexpr const char* MAGIC = "cytosim events 1\n";
+
+private:
+
+    /// number of slots in the ring buffer (a power of 2)
+    static constexpr size_t SIZE = 1 << 12;
+
+    /// slots of the ring buffer
+    EventRecord slot_[SIZE];
+
+    /// sequence numbers synchronizing the producers with the writer
+    std::atomic<size_t> seq_[SIZE];
+
+    /// position where the next record will be added
+    std::atomic<size_t> head_;
+
+    /// position of the next record to be written, only used by the writer
+    size_t tail_;
+
+    /// flag to stop the writer
+    std::atomic<bool> stop_;
+
+    /// the writer thread
+    std::thread writer_;
+
+    /// destination file
+    FILE * file_;
+
+    /// write all records that are available, and return their number
+    size_t drain();
+
+    /// loop of the writer thread
+    void run();
+
+public:
+
+    /// constructor
+    EventLog();
+
+    /// destructor, which writes all pending records
+    ~EventLog() { close(); }
+
+    /// open file and start writer thread
+    bool open(const char* filename);
+
+    /// true if the file is open
+    bool is_open() const { return file_; }
+
+    /// add one record, that will be written later
+    void record(EventRecord const&);
+
+    /// write all pending records, stop the writer and close the file
+    void close();
+};
+
+#endif
+
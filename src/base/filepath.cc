@@ -102,6 +102,18 @@ void FilePath::change_dir(int file)
 }
 
 
+/// subdirectories are not deleted, in which case `path` remains and -1 is returned
+int FilePath::remove_dir(const char path[])
+{
+    for ( std::string const& s : list_dir(path) )
+    {
+        if ( s != "." && s != ".." )
+            unlink((std::string(path)+"/"+s).c_str());
+    }
+    return rmdir(path);
+}
+
+
 std::vector<std::string> FilePath::list_dir(const char path[])
 {
     std::vector<std::string> res;
@@ -43,6 +43,9 @@ namespace FilePath
     /// create new directory, if it does not exists already
     int make_dir(const char name[]);
     
+    /// delete the files in directory `path`, and the directory itself
+    int remove_dir(const char path[]);
+    
     /// list content of directory
     std::vector<std::string> list_dir(const char path[]);
     
@@ -2,6 +2,7 @@
 
 #include "filewrapper.h"
 #include "exceptions.h"
+#include <cstdlib>
 #include <sys/param.h>
 #include <libgen.h>
 
@@ -10,12 +11,14 @@
 FileWrapper::FileWrapper()
 {
     mFile = nullptr;
+    mBuffer = nullptr;
 }
 
 
 FileWrapper::FileWrapper(FILE * f, const char *path)
 {
     mFile = f;
+    mBuffer = nullptr;
     if ( path )
         mPath = path;
 }
@@ -24,6 +27,7 @@ FileWrapper::FileWrapper(FILE * f, const char *path)
 FileWrapper::FileWrapper(const char* name, const char* mode)
 {
     mFile = nullptr;
+    mBuffer = nullptr;
     open(name, mode);
 }
 
@@ -91,6 +95,26 @@ void FileWrapper::close()
         }
         mFile = nullptr;
     }
+    free(mBuffer);
+    mBuffer = nullptr;
+}
+
+
+/**
+ A large buffer reduces the number of system calls made to write a file.
+ The buffer is released when the file is closed.
+ */
+void FileWrapper::buffer(size_t size)
+{
+    if ( mFile && !mBuffer && mFile!=stdout && mFile!=stderr )
+    {
+        mBuffer = (char*)malloc(size);
+        if ( mBuffer && setvbuf(mFile, mBuffer, _IOFBF, size) )
+        {
+            free(mBuffer);
+            mBuffer = nullptr;
+        }
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -33,6 +33,9 @@ protected:
     /// the name of the file or some other information:
     std::string mPath;
     
+    /// memory used to buffer the file, or null if the default is used
+    char*       mBuffer;
+    
 public:
     
     /// constructor - no file
@@ -56,6 +59,9 @@ public:
     /// open a file
     int     open(const char* name, const char* mode);
     
+    /// use a buffer of `size` bytes, which must be called before any input/output
+    void    buffer(size_t size);
+    
     /// rewind file
     void    rewind()                 { if ( mFile ) { clearerr(mFile); std::rewind(mFile); } }
 
@@ -0,0 +1,318 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef FRAME_INDEX_H
+#define FRAME_INDEX_H
+
+#ifndef _FILE_OFFSET_BITS
+#  define _FILE_OFFSET_BITS 64
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+
+/// Positions of the frames in a trajectory file, saved in a 'sidecar' file
+/**
+ FrameIndex records, for each frame of a trajectory file (usually "objects.cmo"),
+ the position in the file at which the frame starts, its time and its number of objects.
+ This is saved as text in a file with the same name followed by ".idx",
+ holding one line per frame:
+
+     frame  offset  time  objects
+
+ The offset is the position at which Simul::writeObjects() started to write the frame,
+ which can be followed by blank lines before the "#Cytosim" tag.
+ The sidecar file is extended by Simul::writeObjects() after each frame.
+
+ load() reads the sidecar file, checks that it is consistent with the trajectory,
+ and scans the frames that were added to the trajectory after the last entry.
+ If the sidecar file is missing or incoherent, the index is rebuilt by scanning
+ the entire trajectory, and saved. Any frame can then be accessed directly.
+
+ Only complete frames, ending with "#end cytosim", are indexed.
+ The number of objects is not known for the frames that were found by scanning.
+ */
+class FrameIndex
+{
+public:
+
+    /// information about one frame
+    struct Entry
+    {
+        off_t  offset;   ///< position in the trajectory file
+        double time;     ///< time of the frame
+        size_t objects;  ///< number of objects, or 0 if unknown
+    };
+
+private:
+
+    /// the frames
+    std::vector<Entry> frames_;
+
+    /// position following the last complete frame found by scan()
+    off_t end_;
+
+    /// read one line of `file` into `buf`, returning its first character or EOF
+    static int read_line(FILE * file, char buf[], size_t len)
+    {
+        char * ptr = buf;
+        char *const end = buf + len - 1;
+        int c = getc_unlocked(file);
+        int res = c;
+        while ( c != EOF && c != '\n' )
+        {
+            if ( ptr < end )
+                *ptr++ = (char)c;
+            c = getc_unlocked(file);
+        }
+        *ptr = 0;
+        return res;
+    }
+
+    /// parse line written by write_line(), returning the frame index or -1
+    static long parse(const char str[], Entry& e)
+    {
+        char * ptr = nullptr;
+        long frm = strtol(str, &ptr, 10);
+        if ( ptr == str )
+            return -1;
+        const char * s = ptr;
+        e.offset = (off_t)strtoll(s, &ptr, 10);
+        if ( ptr == s )
+            return -1;
+        e.time = strtod(ptr, &ptr);
+        e.objects = strtoul(ptr, &ptr, 10);
+        return frm;
+    }
+
+    /// print one line to `file`
+    static void write_line(FILE * file, size_t frm, Entry const& e)
+    {
+        fprintf(file, "%lu %lli %.6f %lu\n", frm, (long long)e.offset, e.time, e.objects);
+    }
+
+public:
+
+    /// name of the sidecar file of the trajectory file `path`
+    static std::string sidecar(std::string const& path) { return path + ".idx"; }
+
+    /// constructor
+    FrameIndex() : end_(0) {}
+
+    /// number of frames
+    size_t size() const { return frames_.size(); }
+
+    /// true if no frame is known
+    bool empty() const { return frames_.empty(); }
+
+    /// information about frame `i`
+    Entry const& operator[](size_t i) const { return frames_[i]; }
+
+    /// position of frame `i` in the trajectory file
+    off_t offset(size_t i) const { return frames_[i].offset; }
+
+    /// position following frame `i` in the trajectory file
+    off_t end(size_t i) const { return i+1 < frames_.size() ? frames_[i+1].offset : end_; }
+
+    /// forget all frames
+    void clear() { frames_.clear(); end_ = 0; }
+    
+    /// forget the frames that start at position `off` or after
+    void trim(off_t off)
+    {
+        while ( frames_.size() && frames_.back().offset >= off )
+            frames_.pop_back();
+    }
+
+    /// add a frame at the end
+    void push_back(off_t off, double time, size_t objs)
+    {
+        Entry e = { off, time, objs };
+        frames_.push_back(e);
+    }
+
+    /// read the sidecar file of `path`, returning the number of frames
+    size_t read(std::string const& path)
+    {
+        frames_.clear();
+        FILE * file = fopen(sidecar(path).c_str(), "r");
+        if ( !file )
+            return 0;
+        char buf[256];
+        while ( EOF != read_line(file, buf, sizeof(buf)) )
+        {
+            Entry e;
+            if ( *buf == '%' || *buf == 0 )
+                continue;
+            long frm = parse(buf, e);
+            // the frames must be listed in order, and the rest will be scanned by load():
+            if ( frm != (long)frames_.size() || ( frm > 0 && e.offset <= frames_.back().offset ))
+                break;
+            frames_.push_back(e);
+        }
+        fclose(file);
+        return frames_.size();
+    }
+
+    /// write the sidecar file of `path`, returning 0 if successful
+    int write(std::string const& path) const
+    {
+        FILE * file = fopen(sidecar(path).c_str(), "w");
+        if ( !file )
+            return 1;
+        for ( size_t i = 0; i < frames_.size(); ++i )
+            write_line(file, i, frames_[i]);
+        int err = ferror(file);
+        fclose(file);
+        return err;
+    }
+
+    /// true if the frame tag is found at position `off` in `file`
+    static bool check(FILE * file, off_t off)
+    {
+        if ( fseeko(file, off, SEEK_SET) )
+            return false;
+        int c = getc_unlocked(file);
+        while ( c == '\n' || c == ' ' )
+            c = getc_unlocked(file);
+        char buf[8] = { 0 };
+        buf[0] = (char)c;
+        return fread(buf+1, 1, 7, file) == 7 && 0 == strncmp(buf, "#Cytosim", 8);
+    }
+
+    /// register the complete frames found in `file` from position `off`, returning the number added
+    size_t scan(FILE * file, off_t off)
+    {
+        if ( fseeko(file, off, SEEK_SET) )
+            return 0;
+        size_t cnt = 0;
+        Entry e = { off, 0, 0 };
+        bool open = false;
+        char buf[128];
+        while ( 1 )
+        {
+            off_t pos = ftello(file);
+            int c = read_line(file, buf, sizeof(buf));
+            if ( c == EOF )
+                break;
+            if ( c != '#' )
+                continue;
+            if ( 0 == strncmp(buf, "#Cytosim ", 9) )
+            {
+                // an incomplete frame is skipped:
+                if ( open )
+                    e.offset = pos;
+                open = true;
+            }
+            else if ( open && 0 == strncmp(buf, "#time ", 6) )
+                e.time = strtod(buf+6, nullptr);
+            else if ( open && 0 == strncmp(buf, "#deflate ", 9) )
+            {
+                // skip the compressed chunk, which is preceded by its size:
+                char * ptr = nullptr;
+                strtoul(buf+9, &ptr, 10);
+                fseeko(file, (off_t)strtoull(ptr, nullptr, 10), SEEK_CUR);
+            }
+            else if ( open && 0 == strncmp(buf, "#end cytosim", 12) )
+            {
+                frames_.push_back(e);
+                ++cnt;
+                open = false;
+                // the next frame starts after this line:
+                e.offset = ftello(file);
+                e.time = 0;
+                end_ = e.offset;
+            }
+        }
+        clearerr(file);
+        return cnt;
+    }
+
+    /**
+     Build the index of the trajectory `path` opened as `file`, using the sidecar
+     file if it is valid. The sidecar file is updated if frames were added.
+     The position in `file` is not preserved.
+     @return number of frames
+     */
+    size_t load(FILE * file, std::string const& path)
+    {
+        bool dirty = false;
+        read(path);
+        // the last indexed frame should be found at the recorded position:
+        if ( frames_.size() && !check(file, frames_.back().offset) )
+            frames_.clear();
+        if ( frames_.size() )
+        {
+            // scan again the last indexed frame, and any frame after it:
+            Entry e = frames_.back();
+            frames_.pop_back();
+            size_t cnt = scan(file, e.offset);
+            if ( cnt > 0 && frames_[frames_.size()-cnt].offset == e.offset )
+            {
+                frames_[frames_.size()-cnt].objects = e.objects;
+                dirty = ( cnt > 1 );
+            }
+            else
+                frames_.clear();
+        }
+        if ( frames_.empty() )
+            dirty = scan(file, 0);
+        if ( dirty )
+            write(path);
+        clearerr(file);
+        return frames_.size();
+    }
+
+    /**
+     Add one frame to the sidecar file of trajectory `path`, given the position
+     `off` at which the frame was written. If `off > 0`, the file is extended
+     only if it exists and if its last entry precedes `off`; otherwise the
+     sidecar file is deleted, such that the index is rebuilt when it is read.
+     */
+    static void append(std::string const& path, off_t off, double time, size_t objs)
+    {
+        std::string name = sidecar(path);
+        size_t frm = 0;
+        if ( off > 0 )
+        {
+            FILE * file = fopen(name.c_str(), "r");
+            if ( !file )
+                return;
+            // find the last entry, from the end of the file:
+            Entry e = { 0, 0, 0 };
+            long last = -1;
+            char buf[256];
+            if ( 0 == fseeko(file, -(off_t)sizeof(buf), SEEK_END) )
+                read_line(file, buf, sizeof(buf));
+            else
+                rewind(file);
+            while ( EOF != read_line(file, buf, sizeof(buf)) )
+            {
+                Entry x;
+                long f = parse(buf, x);
+                if ( f >= 0 ) { last = f; e = x; }
+            }
+            fclose(file);
+            if ( last < 0 || off <= e.offset )
+            {
+                remove(name.c_str());
+                return;
+            }
+            frm = last + 1;
+        }
+        FILE * file = fopen(name.c_str(), off > 0 ? "a" : "w");
+        if ( file )
+        {
+            Entry e = { off, time, objs };
+            write_line(file, frm, e);
+            fclose(file);
+        }
+    }
+};
+
+#endif
+
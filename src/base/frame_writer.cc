@@ -0,0 +1,126 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#include "frame_writer.h"
+#include "frame_index.h"
+#include "zipper.h"
+#include <cstdlib>
+
+
+FrameWriter::FrameWriter()
+: head_(0), count_(0), stop_(false)
+{
+    for ( unsigned i = 0; i < SIZE; ++i )
+    {
+        slot_[i].data = nullptr;
+        slot_[i].size = 0;
+    }
+    writer_ = std::thread(&FrameWriter::run, this);
+}
+
+
+FrameWriter::~FrameWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all();
+    if ( writer_.joinable() )
+        writer_.join();
+}
+
+
+void FrameWriter::save(Frame const& frm)
+{
+    FILE * file = fopen(frm.path.c_str(), frm.append ? "ab" : "wb");
+    if ( !file )
+    {
+        fprintf(stderr, "Error: could not open `%s' for writing\n", frm.path.c_str());
+        return;
+    }
+    fseeko(file, 0, SEEK_END);
+    off_t pos = ftello(file);
+    bool err = false;
+    if ( frm.level > 0 )
+    {
+        // compress the content, as done by Simul::writeCompressed():
+        const size_t len = frm.size - frm.head - frm.tail;
+        std::string zip;
+        err = Zipper::deflate(zip, frm.data + frm.head, len, frm.level);
+        if ( !err )
+        {
+            err |= ( frm.head != fwrite(frm.data, 1, frm.head, file) );
+            fprintf(file, "\n#time %.6f sec", frm.time);
+            fprintf(file, "\n#deflate %lu %lu\n", len, zip.size());
+            err |= ( zip.size() != fwrite(zip.data(), 1, zip.size(), file) );
+            err |= ( frm.tail != fwrite(frm.data + frm.size - frm.tail, 1, frm.tail, file) );
+        }
+    }
+    else
+        err = ( frm.size != fwrite(frm.data, 1, frm.size, file) );
+    if ( fclose(file) || err )
+        fprintf(stderr, "Error writing trajectory file `%s'\n", frm.path.c_str());
+    else if ( pos >= 0 )
+        FrameIndex::append(frm.path, pos, frm.time, frm.objects);
+}
+
+
+/**
+ The frames are written in the order in which they were submitted.
+ The writer only stops after all the pending frames were written.
+ */
+void FrameWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while ( 1 )
+    {
+        cond_.wait(lock, [this]{ return count_ > 0 || stop_; });
+        if ( count_ == 0 )
+            break;
+        Frame & frm = slot_[head_];
+        // the slot is not modified by submit() until `count_` is decreased:
+        lock.unlock();
+        save(frm);
+        free(frm.data);
+        frm.data = nullptr;
+        lock.lock();
+        head_ = ( head_ + 1 ) % SIZE;
+        --count_;
+        cond_.notify_all();
+    }
+}
+
+
+void FrameWriter::submit(std::string const& path, bool append, char * data, size_t size, double time, size_t objects)
+{
+    submit(path, append, data, size, time, objects, 0, 0, 0);
+}
+
+
+void FrameWriter::submit(std::string const& path, bool append, char * data, size_t size, double time, size_t objects,
+                         size_t head, size_t tail, int level)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    // wait for a free slot:
+    cond_.wait(lock, [this]{ return count_ < SIZE; });
+    Frame & frm = slot_[( head_ + count_ ) % SIZE];
+    frm.path = path;
+    frm.data = data;
+    frm.size = size;
+    frm.time = time;
+    frm.objects = objects;
+    frm.append = append;
+    frm.head = head;
+    frm.tail = tail;
+    frm.level = level;
+    ++count_;
+    lock.unlock();
+    cond_.notify_all();
+}
+
+
+void FrameWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]{ return count_ == 0; });
+}
@@ -0,0 +1,100 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef FRAME_WRITER_H
+#define FRAME_WRITER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <cstdio>
+
+
+/// Appends frames to trajectory files, using a background thread
+/**
+ The simulation thread serializes a frame into a buffer in memory,
+ which is fast compared to writing to disk, and submit() hands this buffer
+ to a writer thread that appends it to the file, and records the position
+ of the frame in the index file (see FrameIndex).
+
+ There are two slots: while the writer saves one frame, the simulation can
+ prepare the next one. If both slots are occupied, submit() waits for the writer,
+ such that at most two frames are held in memory.
+
+ A frame can also be submitted with its content not compressed yet, as a
+ snapshot of the simulation state: the writer thread then compresses the
+ content, and the simulation continues without waiting for the compression.
+ */
+class FrameWriter
+{
+    /// a frame waiting to be written
+    struct Frame
+    {
+        std::string path;     ///< name of the file
+        char *      data;     ///< serialized frame, allocated with malloc()
+        size_t      size;     ///< number of bytes in `data`
+        double      time;     ///< time of the frame
+        size_t      objects;  ///< number of objects in the frame
+        bool        append;   ///< if false, the file is cleared
+        size_t      head;     ///< bytes before the content to be compressed
+        size_t      tail;     ///< bytes after the content to be compressed
+        int         level;    ///< compression level, or 0 if `data` is complete
+    };
+
+    /// number of slots
+    static constexpr unsigned SIZE = 2;
+
+    /// slots
+    Frame     slot_[SIZE];
+
+    /// index of the next frame to be written
+    unsigned  head_;
+
+    /// number of frames waiting
+    unsigned  count_;
+
+    /// flag to stop the writer
+    bool      stop_;
+
+    /// protects the variables above
+    std::mutex mutex_;
+
+    /// signals changes of `count_` and `stop_`
+    std::condition_variable cond_;
+
+    /// the writer thread
+    std::thread writer_;
+
+    /// write one frame to disk
+    static void save(Frame const&);
+
+    /// loop of the writer thread
+    void run();
+
+    /// disabled copy constructor
+    FrameWriter(FrameWriter const&);
+
+    /// disabled assignment operator
+    FrameWriter& operator = (FrameWriter const&);
+
+public:
+
+    /// constructor, which starts the writer thread
+    FrameWriter();
+
+    /// destructor, which writes all pending frames
+    ~FrameWriter();
+
+    /// queue `size` bytes of `data` for `path`; FrameWriter will call free(data)
+    void submit(std::string const& path, bool append, char * data, size_t size, double time, size_t objects);
+
+    /// queue `data` for `path`, compressing the bytes within [head, size-tail[ at `level`
+    void submit(std::string const& path, bool append, char * data, size_t size, double time, size_t objects,
+                size_t head, size_t tail, int level);
+
+    /// wait until all pending frames are written
+    void flush();
+};
+
+#endif
+
@@ -281,12 +281,10 @@ bool Glossary::value_is(key_type const& key, size_t inx, std::string const& val)
 */
 int Glossary::read_key(Glossary::pair_type& res, std::istream& is)
 {
-    std::string k = Tokenizer::get_symbol(is, false);
+    res.first = Tokenizer::get_symbol(is, false);
 
-    if ( k.empty() )
+    if ( res.first.empty() )
         return 1;
-
-    res.first = k;
     
     int op = Tokenizer::get_character(is);
 
@@ -311,7 +309,7 @@ void Glossary::add_value(Glossary::pair_type& res, std::string& str, bool def)
     
     VLOG2("Glossary::SET" << std::setw(20) << res.first << "[" << res.second.size() << "] = |" << val << "|\n");
 
-    res.second.emplace_back(val, def);
+    res.second.emplace_back(std::move(val), def);
 }
 
 
@@ -342,13 +340,16 @@ int Glossary::read_value(Glossary::pair_type& res, std::istream& is)
         k = Tokenizer::get_block_text(is, 0, Tokenizer::block_delimiter(c));
         c = Tokenizer::get_character(is);
     }
-    else
+    else if ( valid_value(c) )
     {
-        while ( valid_value(c) )
-        {
+        // read directly from the buffer of the stream:
+        std::streambuf * buf = is.rdbuf();
+        do {
             k.push_back(char(c));
-            c = is.get();
-        }
+            c = buf->sbumpc();
+        } while ( valid_value(c) );
+        if ( c == EOF )
+            is.setstate(std::ios::eofbit|std::ios::failbit);
     }
     //std::clog << (char)c << "|";
         
@@ -407,7 +408,7 @@ void Glossary::add_entry(Glossary::pair_type& pair, int no_overwrite)
     
     if ( w == mTerms.end() )
     {
-        mTerms.insert(pair);
+        mTerms.insert(w, std::move(pair));
     }
     else
     {
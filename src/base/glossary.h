@@ -66,7 +66,10 @@ public:
         val_type()     { defined_=false; count_=0; }
         
         /// constructor with initialization
-        val_type(std::string const& s, bool d) { value_=s; defined_=d; count_=0; }
+        val_type(std::string const& s, bool d) : value_(s), defined_(d), count_(0) {}
+        
+        /// constructor taking the string
+        val_type(std::string&& s, bool d) : value_(std::move(s)), defined_(d), count_(0) {}
     };
    
     /// a record is a set of values associated with a key
@@ -3,32 +3,36 @@
 #include "inventory.h"
 #include "assert_macro.h"
 #include "exceptions.h"
+#include <algorithm>
 
 
 Inventory::Inventory()
 {
     lowest_    = 1;
     highest_   = 0;
-    allocated_ = 8;
-    byNames    = new Inventoried*[allocated_];
-    
-    for ( ObjectID n = 0; n < allocated_; ++n )
-        byNames[n] = nullptr;
+    count_     = 0;
+    allocated_ = 0;
+    byNames    = nullptr;
+    used_      = nullptr;
+    allocate(64);
 }
 
 
 Inventory::~Inventory()
 {
     delete[] byNames;
+    delete[] used_;
 }
 
 
 void Inventory::allocate(size_t sz)
 {
-    constexpr size_t chunk = 32;
+    // a multiple of 64, for the bitmap:
+    constexpr size_t chunk = 64;
     sz = ( sz + chunk - 1 ) & ~( chunk -1 );
     
     Inventoried ** byNames_new = new Inventoried*[sz];
+    uint64_t * used_new = new uint64_t[sz/64];
     
     ObjectID n = 0;
     for ( ; n < allocated_; ++n )
@@ -36,69 +40,106 @@ void Inventory::allocate(size_t sz)
     while ( n < sz )
         byNames_new[n++] = nullptr;
     
+    size_t w = 0;
+    for ( ; w < allocated_/64; ++w )
+        used_new[w] = used_[w];
+    while ( w < sz/64 )
+        used_new[w++] = 0;
+
     delete[] byNames;
+    delete[] used_;
     byNames    = byNames_new;
+    used_      = used_new;
     allocated_ = sz;
 }
 
 
-//------------------------------------------------------------------------------
+/**
+ Allocate memory for `cnt` new objects, to be assigned consecutive numbers
+ */
+void Inventory::reserve(size_t cnt)
+{
+    if ( highest_ + cnt >= allocated_ )
+        allocate(highest_ + cnt + 1);
+}
 
-ObjectID Inventory::first_assigned() const
+//------------------------------------------------------------------------------
+/**
+ The bitmap is scanned 64 numbers at a time, using the instruction that
+ counts the trailing zeros of a word.
+ */
+ObjectID Inventory::next_used(ObjectID n) const
 {
-    ObjectID n = 1;
-    while ( n < allocated_ )
+    const size_t end = allocated_ / 64;
+    size_t w = n / 64;
+    if ( w >= end )
+        return 0;
+    uint64_t b = used_[w] & ( ~0ULL << ( n % 64 ));
+    while ( !b )
     {
-        if ( byNames[n] )
-            return n;
-        ++n;
+        if ( ++w >= end )
+            return 0;
+        b = used_[w];
     }
-    return 0;
+    return ObjectID( 64 * w + __builtin_ctzll(b) );
 }
 
 
-ObjectID Inventory::last_assigned() const
+ObjectID Inventory::prev_used(ObjectID n) const
 {
-    ObjectID n = allocated_-1;
-    while ( n > 0 )
+    if ( n >= allocated_ )
+        n = ObjectID( allocated_ - 1 );
+    size_t w = n / 64;
+    uint64_t b = used_[w] & ( ~0ULL >> ( 63 - n % 64 ));
+    while ( !b )
     {
-        if ( byNames[n] )
-            return n;
-        --n;
+        if ( w == 0 )
+            return 0;
+        b = used_[--w];
     }
-    return 0;
+    return ObjectID( 64 * w + 63 - __builtin_clzll(b) );
 }
 
 
-ObjectID Inventory::next_assigned(ObjectID n) const
+ObjectID Inventory::next_free(ObjectID n) const
 {
-    ++n;
-    while ( n < allocated_ )
+    const size_t end = allocated_ / 64;
+    size_t w = n / 64;
+    if ( w >= end )
+        return n;
+    uint64_t b = ~used_[w] & ( ~0ULL << ( n % 64 ));
+    while ( !b )
     {
-        if ( byNames[n] )
-            return n;
-        ++n;
+        if ( ++w >= end )
+            return ObjectID( allocated_ );
+        b = ~used_[w];
     }
-    return 0;
+    return ObjectID( 64 * w + __builtin_ctzll(b) );
+}
+
+
+ObjectID Inventory::first_assigned() const
+{
+    return next_used(1);
+}
+
+
+ObjectID Inventory::last_assigned() const
+{
+    return prev_used(highest_);
+}
+
+
+ObjectID Inventory::next_assigned(ObjectID n) const
+{
+    return next_used(n+1);
 }
 
 
 ObjectID Inventory::first_unassigned()
 {
-    ObjectID n = lowest_;
-    
-    if ( n < allocated_ )
-    {
-        if ( !byNames[n] )
-            return n;
-    
-        while ( n < allocated_  &&  byNames[n] )
-            ++n;
-    
-        lowest_ = n;
-    }
-    
-    return n;
+    lowest_ = next_free(lowest_);
+    return lowest_;
 }
 
 //------------------------------------------------------------------------------
@@ -115,12 +156,15 @@ void Inventory::assign(Inventoried * obj)
     else if ( highest_ < n )
         highest_ = n;
     
+    // the array grows geometrically, to limit the number of copies:
     if ( n >= allocated_ )
-        allocate(n+1);
+        allocate(std::max(size_t(n+1), 2*allocated_));
     
     assert_true( !byNames[n] );
     
     byNames[n] = obj;
+    used_[n/64] |= 1ULL << ( n % 64 );
+    ++count_;
     //std::clog << "Inventory::store() assigned " << n << " to " << obj << "\n";
 }
 
@@ -129,13 +173,18 @@ void Inventory::unassign(const Inventoried * obj)
 {
     ObjectID n = obj->identity();
     assert_true( n < allocated_ );
-    byNames[n] = nullptr;
+    if ( byNames[n] )
+    {
+        byNames[n] = nullptr;
+        used_[n/64] &= ~( 1ULL << ( n % 64 ));
+        --count_;
+    }
     
     if ( lowest_ >= n )
         lowest_ = n;
     
-    while ( !byNames[highest_]  &&  highest_ > 0 )
-        --highest_;
+    if ( !byNames[highest_] )
+        highest_ = prev_used(highest_);
 }
 
 
@@ -150,65 +199,34 @@ Inventoried * Inventory::get(const ObjectID n) const
 }
 
 
+/*
+ Since byNames[0] is always null, the functions below return null if
+ next_used() or prev_used() return zero.
+ */
 Inventoried* Inventory::first() const
 {
-    ObjectID n = 1;
-    while ( n < allocated_ )
-    {
-        if ( byNames[n] )
-            return byNames[n];
-        ++n;
-    }
-    return nullptr;
+    return byNames[next_used(1)];
 }
 
 
 Inventoried* Inventory::last() const
 {
-    ObjectID n = highest_;
-    while ( n > 0 )
-    {
-        if ( byNames[n] )
-            return byNames[n];
-        --n;
-    }
-    return nullptr;
+    return byNames[prev_used(highest_)];
 }
 
 
 Inventoried* Inventory::previous(Inventoried const* i) const
 {
-    ObjectID n = i->identity() - 1;
-    while ( n > 0 )
-    {
-        if ( byNames[n] )
-            return byNames[n];
-        --n;
-    }
-    return nullptr;
+    return byNames[prev_used(i->identity()-1)];
 }
 
-#include <iostream>
+
 Inventoried* Inventory::next(Inventoried const* i) const
 {
-    ObjectID n = i->identity() + 1;
-    while ( n < allocated_ )
-    {
-        if ( byNames[n] )
-            return byNames[n];
-        ++n;
-    }
-    return nullptr;
+    return byNames[next_used(i->identity()+1)];
 }
 
 //------------------------------------------------------------------------------
-unsigned Inventory::count() const
-{
-    unsigned cnt = 0;
-    for ( ObjectID n = 0; n < allocated_; ++n )
-        if ( byNames[n] ) ++cnt;
-    return cnt;
-}
 
 
 void Inventory::reassign()
@@ -235,6 +253,11 @@ void Inventory::reassign()
     
     lowest_ = next;
     highest_ = next-1;
+    
+    for ( size_t w = 0; w < allocated_/64; ++w )
+        used_[w] = 0;
+    for ( ObjectID n = 1; n < next; ++n )
+        used_[n/64] |= 1ULL << ( n % 64 );
 }
 
 
@@ -242,6 +265,9 @@ void Inventory::clear()
 {
     for ( ObjectID n = 0; n < allocated_; ++n )
         byNames[n] = nullptr;
+    for ( size_t w = 0; w < allocated_/64; ++w )
+        used_[w] = 0;
+    count_ = 0;
     //std::clog << "Inventory::forgetAll() removed " << cnt << "numbers\n";
     lowest_ = 1;
     highest_ = 0;
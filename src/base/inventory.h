@@ -5,6 +5,7 @@
 
 #include "inventoried.h"
 #include "assert_macro.h"
+#include <stdint.h>
 #include <ostream>
 
 /// Attributes and remember serial-numbers to Inventoried
@@ -13,6 +14,9 @@ A Inventory assigns serial-numbers (of type ObjectID) to Inventoried,
 and it records a pointer to these objects.
  
 The pointers can be recovered from their 'number' in constant time.
+A bitmap of the assigned numbers, with one bit per number, is used to skip
+quickly over the unassigned numbers, which can be the majority if many objects
+have been created and deleted.
 
 \author Nedelec, August 2003. EMBL Heidelberg. nedelec@embl.de
 */
@@ -29,9 +33,15 @@ private:
     Inventoried ** byNames;
     
     
+    /// bit `i` is set if byNames[i] != 0
+    uint64_t * used_;
+    
     /// size of memory allocated
     size_t    allocated_;
     
+    /// number of assigned numbers
+    size_t    count_;
+    
     /// lowest i > 0 for which byNames[i] == 0
     ObjectID  lowest_;
     
@@ -41,8 +51,14 @@ private:
     /// memory allocation function
     void      allocate(size_t size);
     
-    ///update available when the spot has been taken
-    void      updateFirstFree(ObjectID start = 0);
+    /// smallest assigned number >= n, or 0 if none
+    ObjectID  next_used(ObjectID n) const;
+    
+    /// largest assigned number <= n, or 0 if none
+    ObjectID  prev_used(ObjectID n) const;
+    
+    /// smallest unassigned number >= n
+    ObjectID  next_free(ObjectID n) const;
     
     /// Disabled copy constructor
     Inventory(Inventory const&);
@@ -73,6 +89,9 @@ public:
     /// current size of array
     size_t         capacity() const { return allocated_; }
     
+    /// allocate memory to assign `cnt` new numbers
+    void           reserve(size_t cnt);
+    
     /// remember `obj`, assign a new ObjectID if necessary
     void           assign(Inventoried * obj);
     
@@ -98,7 +117,7 @@ public:
     Inventoried*   operator[](ObjectID n) const { assert_true(n<allocated_); return byNames[n]; }
 
     /// number of non-zero entries in the registry
-    unsigned int   count() const;
+    unsigned int   count() const { return (unsigned)count_; }
 
     /// reattribute all serial numbers consecutively and pack the array
     void           reassign();
@@ -2,6 +2,12 @@
 
 #include "iowrapper.h"
 #include "exceptions.h"
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 
 ///check the size of the type, as we rely on them to write byte-by-byte
@@ -16,6 +22,67 @@ int nonStandardTypes()
 }
 
 
+/**
+ Write `n` bytes without locking the file, returning false if this fails.
+ This is faster than fwrite() for the few bytes of a single value.
+ */
+static inline bool put_bytes(FILE * file, const void * ptr, size_t n)
+{
+    const char * c = static_cast<const char*>(ptr);
+    for ( size_t i = 0; i < n; ++i )
+        if ( EOF == putc_unlocked(c[i], file) )
+            return false;
+    return true;
+}
+
+
+/// print `n` in decimal after character `before` (if not zero), returning the end of the string
+static char * print_uint(char * ptr, char before, uint64_t n)
+{
+    char tmp[24];
+    int i = 0;
+    do {
+        tmp[i++] = (char)('0' + n % 10);
+        n /= 10;
+    } while ( n > 0 );
+    if ( before )
+        *ptr++ = before;
+    while ( i > 0 )
+        *ptr++ = tmp[--i];
+    return ptr;
+}
+
+
+/**
+ Print `x` as printf(" %.6f", x) would, returning the end of the string, or
+ nullptr if the value is not finite or too large. For any float, the product
+ `x * 1e6` is exact in double precision, and rounding it to the nearest integer,
+ with ties to even, gives the same digits as printf in the default rounding mode.
+ */
+static char * print_fixed6(char * ptr, float x)
+{
+    double d = 1e6 * (double)x;
+    if ( !( std::fabs(d) < 0x1p62 ) )
+        return nullptr;
+    uint64_t i = (uint64_t)std::nearbyint(std::fabs(d));
+    *ptr++ = ' ';
+    if ( std::signbit(x) )
+        *ptr++ = '-';
+    char tmp[24];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + i % 10);
+        i /= 10;
+    } while ( i > 0 || n < 7 );
+    while ( n > 6 )
+        *ptr++ = tmp[--n];
+    *ptr++ = '.';
+    while ( n > 0 )
+        *ptr++ = tmp[--n];
+    return ptr;
+}
+
+
 //==============================================================================
 #pragma mark - INPUT
 
@@ -24,6 +91,7 @@ void Inputter::reset()
     format_  = 0;
     vecsize_ = 3;
     binary_  = 0;
+    precise_ = false;
     
     if ( nonStandardTypes() )
     {
@@ -33,6 +101,274 @@ void Inputter::reset()
 }
 
 
+//------------------------------------------------------------------------------
+#pragma mark - Memory
+
+/**
+ The file is mapped in read-only mode, and the reading position is preserved.
+ This fails if the file is not a regular file, for example a pipe.
+ */
+bool Inputter::map()
+{
+    if ( !mFile || mSize )
+        return mSize;
+    struct stat s;
+    if ( fstat(fileno(mFile), &s) || !S_ISREG(s.st_mode) || s.st_size <= 0 )
+        return false;
+    off_t pos = ftello(mFile);
+    if ( pos < 0 || pos > s.st_size )
+        return false;
+    void * ptr = mmap(nullptr, s.st_size, PROT_READ, MAP_PRIVATE, fileno(mFile), 0);
+    if ( ptr == MAP_FAILED )
+        return false;
+    mSize = s.st_size;
+    mBase = (const char*)ptr;
+    mEnd = mBase + mSize;
+    mPtr = mBase + pos;
+    mEOF = false;
+    return true;
+}
+
+
+/**
+ This is called when reading beyond the mapped memory, since the file may be
+ written by another process, for example if `play` displays a live simulation.
+ */
+bool Inputter::remap(size_t n)
+{
+    if ( !mSize )
+        return false;
+    struct stat s;
+    if ( fstat(fileno(mFile), &s) || (size_t)s.st_size <= mSize )
+        return false;
+    size_t pos = mPtr - mBase;
+    void * ptr = mmap(nullptr, s.st_size, PROT_READ, MAP_PRIVATE, fileno(mFile), 0);
+    if ( ptr == MAP_FAILED )
+        return false;
+    munmap((void*)mBase, mSize);
+    mSize = s.st_size;
+    mBase = (const char*)ptr;
+    mEnd = mBase + mSize;
+    mPtr = mBase + pos;
+    return ( (size_t)( mEnd - mPtr ) >= n );
+}
+
+
+void Inputter::memory(const char* buf, size_t len)
+{
+    unmap();
+    mBase = buf;
+    mPtr = buf;
+    mEnd = buf + len;
+    mEOF = false;
+}
+
+
+void Inputter::unmap()
+{
+    if ( mBase )
+    {
+        if ( mFile )
+            fseeko(mFile, mPtr - mBase, SEEK_SET);
+        if ( mSize )
+            munmap((void*)mBase, mSize);
+        mBase = nullptr;
+        mPtr = nullptr;
+        mEnd = nullptr;
+        mSize = 0;
+        mEOF = false;
+    }
+}
+
+
+long Inputter::pos()
+{
+    if ( mBase )
+        return mPtr - mBase;
+    return FileWrapper::pos();
+}
+
+
+/// the position of the FILE is updated before calling fgetpos()
+int Inputter::get_pos(fpos_t& p)
+{
+    if ( !mFile )
+        return 1;
+    if ( mBase && fseeko(mFile, mPtr - mBase, SEEK_SET) )
+        return 1;
+    return fgetpos(mFile, &p);
+}
+
+
+void Inputter::set_pos(const fpos_t& p)
+{
+    if ( mFile )
+    {
+        fsetpos(mFile, &p);
+        if ( mBase )
+            seek(ftello(mFile));
+    }
+}
+
+
+void Inputter::seek(off_t off)
+{
+    if ( mBase )
+    {
+        mEOF = false;
+        if ( off < 0 || ( off > mEnd - mBase && !remap(off - ( mPtr - mBase ))))
+            off = mEnd - mBase;
+        mPtr = mBase + off;
+    }
+    else if ( mFile )
+        fseeko(mFile, off, SEEK_SET);
+}
+
+
+size_t Inputter::read(void * dst, size_t n)
+{
+    if ( !mBase )
+        return fread(dst, 1, n, mFile);
+    if ( !available(n) )
+    {
+        n = mEnd - mPtr;
+        mEOF = true;
+    }
+    memcpy(dst, mPtr, n);
+    mPtr += n;
+    return n;
+}
+
+
+std::string Inputter::get_line(const char end)
+{
+    if ( !mBase )
+        return FileWrapper::get_line(end);
+    std::string res;
+    const char * m = (const char*)memchr(mPtr, end, mEnd - mPtr);
+    while ( !m && remap(mEnd - mPtr + 1) )
+        m = (const char*)memchr(mPtr, end, mEnd - mPtr);
+    if ( m )
+    {
+        res.assign(mPtr, m);
+        mPtr = m + 1;
+    }
+    else
+    {
+        res.assign(mPtr, mEnd);
+        mPtr = mEnd;
+        mEOF = true;
+    }
+    return res;
+}
+
+
+std::string Inputter::get_characters(size_t cnt)
+{
+    if ( !mBase )
+        return FileWrapper::get_characters(cnt);
+    if ( !available(cnt) )
+    {
+        cnt = mEnd - mPtr;
+        mEOF = true;
+    }
+    std::string res(mPtr, cnt);
+    mPtr += cnt;
+    // trim trailing zeros:
+    std::string::size_type e = res.find((char)0);
+    return res.substr(0, e);
+}
+
+
+std::string Inputter::get_word()
+{
+    std::string res;
+    int c = get_char();
+    while ( isspace(c) )
+        c = get_char();
+    do {
+        res.push_back(c);
+        c = get_char();
+    } while ( c != EOF && !isspace(c) );
+    return res;
+}
+
+
+/**
+ This will search for the string and position the stream
+ at the first character of the match, or at the end of the file.
+ */
+void Inputter::skip_until(const char * str)
+{
+    if ( !mBase )
+        return FileWrapper::skip_until(str);
+    const char * s = std::search(mPtr, mEnd, str, str+strlen(str));
+    mPtr = s;
+    if ( s == mEnd )
+        mEOF = true;
+}
+
+
+void Inputter::token(char buf[], size_t len)
+{
+    while ( available(1) && isspace(*mPtr) )
+        ++mPtr;
+    size_t n = std::min(len-1, (size_t)( mEnd - mPtr ));
+    memcpy(buf, mPtr, n);
+    buf[n] = 0;
+}
+
+
+bool Inputter::scan(long& v)
+{
+    if ( !mBase )
+        return 1 == fscanf(mFile, " %li", &v);
+    char buf[32], * end;
+    token(buf, sizeof(buf));
+    v = strtol(buf, &end, 0);
+    mPtr += end - buf;
+    return end > buf;
+}
+
+
+bool Inputter::scan(unsigned long& v)
+{
+    if ( !mBase )
+        return 1 == fscanf(mFile, " %lu", &v);
+    char buf[32], * end;
+    token(buf, sizeof(buf));
+    v = strtoul(buf, &end, 10);
+    mPtr += end - buf;
+    return end > buf;
+}
+
+
+bool Inputter::scan(float& v)
+{
+    if ( !mBase )
+        return 1 == fscanf(mFile, " %f", &v);
+    char buf[64], * end;
+    token(buf, sizeof(buf));
+    v = strtof(buf, &end);
+    mPtr += end - buf;
+    return end > buf;
+}
+
+
+bool Inputter::scan(double& v)
+{
+    if ( !mBase )
+        return 1 == fscanf(mFile, " %lf", &v);
+    char buf[64], * end;
+    token(buf, sizeof(buf));
+    v = strtod(buf, &end);
+    mPtr += end - buf;
+    return end > buf;
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - Values
+
 /**
  Reads a short and compares with the native storage, to set
  binary_=1, for same-endian or binary_ = 2, for opposite endian
@@ -51,15 +387,15 @@ int16_t Inputter::readInt16()
     int16_t v;
     if ( binary_ )
     {
-        if ( 1 != fread(&v, 2, 1, mFile) )
+        if ( !fetch(&v, 2) )
             throw InvalidIO("readInt16 failed");
         if ( binary_ == 2 )
             swap2(reinterpret_cast<unsigned char*>(&v));
     }
     else
     {
-        int u;
-        if ( 1 != fscanf(mFile, " %i", &u) )
+        long u;
+        if ( !scan(u) )
             throw InvalidIO("readInt16() failed");
         v = (int16_t)u;
         if ( v != u )
@@ -74,15 +410,15 @@ int32_t Inputter::readInt32()
     int32_t v;
     if ( binary_ )
     {
-        if ( 1 != fread(&v, 4, 1, mFile) )
+        if ( !fetch(&v, 4) )
             throw InvalidIO("readInt32 failed");
         if ( binary_ == 2 )
             swap4(reinterpret_cast<unsigned char*>(&v));
     }
     else
     {
-        int u;
-        if ( 1 != fscanf(mFile, " %i", &u) )
+        long u;
+        if ( !scan(u) )
             throw InvalidIO("readInt32() failed");
         v = (int32_t)u;
         if ( v != u )
@@ -101,8 +437,8 @@ uint8_t Inputter::readUInt8()
     }
     else
     {
-        unsigned u;
-        if ( 1 != fscanf(mFile, " %u", &u) )
+        unsigned long u;
+        if ( !scan(u) )
             throw InvalidIO("readUInt8() failed");
         v = (uint8_t)u;
         if ( v != u )
@@ -117,15 +453,15 @@ uint16_t Inputter::readUInt16()
     uint16_t v;
     if ( binary_ )
     {
-        if ( 1 != fread(&v, 2, 1, mFile) )
+        if ( !fetch(&v, 2) )
             throw InvalidIO("readUInt16 failed");
         if ( binary_ == 2 )
             swap2(reinterpret_cast<unsigned char*>(&v));
     }
     else
     {
-        unsigned u;
-        if ( 1 != fscanf(mFile, " %u", &u) )
+        unsigned long u;
+        if ( !scan(u) )
             throw InvalidIO("readUInt16() failed");
         v = (uint16_t)u;
         if ( v != u )
@@ -140,15 +476,15 @@ uint32_t Inputter::readUInt32()
     uint32_t v;
     if ( binary_ )
     {
-        if ( 1 != fread(&v, 4, 1, mFile) )
+        if ( !fetch(&v, 4) )
             throw InvalidIO("readUInt32 failed");
         if ( binary_ == 2 )
             swap4(reinterpret_cast<unsigned char*>(&v));
     }
     else
     {
-        unsigned u;
-        if ( 1 != fscanf(mFile, " %u", &u) )
+        unsigned long u;
+        if ( !scan(u) )
             throw InvalidIO("readUInt32() failed");
         v = (uint32_t)u;
         if ( v != u )
@@ -163,7 +499,7 @@ uint64_t Inputter::readUInt64()
     uint64_t v;
     if ( binary_ )
     {
-        if ( 1 != fread(&v, 8, 1, mFile) )
+        if ( !fetch(&v, 8) )
             throw InvalidIO("readUInt64 failed");
         if ( binary_ == 2 )
             swap8(reinterpret_cast<unsigned char*>(&v));
@@ -171,7 +507,7 @@ uint64_t Inputter::readUInt64()
     else
     {
         unsigned long u;
-        if ( 1 != fscanf(mFile, " %lu", &u) )
+        if ( !scan(u) )
             throw InvalidIO("readUInt64() failed");
         v = (uint64_t)u;
         if ( v != u )
@@ -181,19 +517,44 @@ uint64_t Inputter::readUInt64()
 }
 
 
-float Inputter::readFloat()
+/**
+ In binary mode, the value is stored on 7 bits per byte, starting from the lowest
+ bits, and the highest bit of each byte is set if more bytes follow (LEB128).
+ This does not depend on the byte order of the machine.
+ */
+uint64_t Inputter::readVarUInt()
+{
+    if ( !binary_ )
+        return readUInt64();
+    uint64_t v = 0;
+    for ( int s = 0; s < 64; s += 7 )
+    {
+        int c = get_char();
+        if ( c == EOF )
+            throw InvalidIO("readVarUInt failed");
+        v |= (uint64_t)( c & 127 ) << s;
+        if ( !( c & 128 ) )
+            return v;
+    }
+    throw InvalidIO("invalid varint");
+}
+
+
+double Inputter::readFloat()
 {
     float v;
+    if ( precise_ && binary_ )
+        return readDouble();
     if ( binary_ )
     {
-        if ( 1 != fread(&v, 4, 1, mFile) )
+        if ( !fetch(&v, 4) )
             throw InvalidIO("readFloat failed");
         if ( binary_ == 2 )
             swap4(reinterpret_cast<unsigned char*>(&v));
     }
     else
     {
-        if ( 1 != fscanf(mFile, " %f", &v) )
+        if ( !scan(v) )
             throw InvalidIO("readFloat() failed");
     }
     return v;
@@ -205,14 +566,14 @@ double Inputter::readDouble()
     double v;
     if ( binary_ )
     {
-        if ( 1 != fread(&v, 8, 1, mFile) )
+        if ( !fetch(&v, 8) )
             throw InvalidIO("readDouble failed");
         if ( binary_ == 2 )
             swap8(reinterpret_cast<unsigned char*>(&v));
     }
     else
     {
-        if ( 1 != fscanf(mFile, " %lf", &v) )
+        if ( !scan(v) )
             throw InvalidIO("readDouble() failed");
     }
     return v;
@@ -268,10 +629,44 @@ void Inputter::readFloats(double a[], const unsigned D)
 
 /**
  This will read `n * vecsize_` floats, and store `n * D` values in a[].
+ In memory, the values are converted directly, without intermediate copy.
  */
 void Inputter::readFloats(double a[], const size_t n, const unsigned D)
 {
     const size_t nd = n * vecsize_;
+    const size_t m = ( vecsize_ < D ? vecsize_ : D );
+    
+    if ( precise_ && binary_ )
+    {
+        for ( size_t u = 0; u < n; ++u )
+            readFloats(a+D*u, D);
+        return;
+    }
+
+    if ( binary_ && mBase )
+    {
+        if ( !available(4*nd) )
+            throw InvalidIO("readFloatVector(double) failed");
+        const char * src = mPtr;
+        for ( size_t u = 0; u < n; ++u )
+        {
+            size_t i = 0;
+            for ( ; i < m; ++i )
+            {
+                float x;
+                memcpy(&x, src+4*i, 4);
+                if ( binary_ == 2 )
+                    swap4(reinterpret_cast<unsigned char*>(&x));
+                a[D*u+i] = x;
+            }
+            for ( ; i < D; ++i )
+                a[D*u+i] = 0;
+            src += 4 * vecsize_;
+        }
+        mPtr = src;
+        return;
+    }
+    
     float * v = new float[nd];
     
     if ( binary_ )
@@ -288,15 +683,13 @@ void Inputter::readFloats(double a[], const size_t n, const unsigned D)
     else
     {
         for ( size_t u = 0; u < nd; ++u )
-            if ( 1 != fscanf(mFile, " %f", v+u) )
+            if ( !scan(v[u]) )
             {
                 delete[] v;
                 throw InvalidIO("readFloatVector(double) failed");
             }
     }
 
-    const size_t m = ( vecsize_ < D ? vecsize_ : D );
-    
     for ( size_t u = 0; u < n; ++u )
     {
         size_t i = 0;
@@ -316,6 +709,9 @@ Outputter::Outputter()
 : FileWrapper(stdout) 
 {
     binary_ = false;
+    quantum_ = 0;
+    precise_ = false;
+    filter_ = nullptr;
     
     if ( nonStandardTypes() )
     {
@@ -327,6 +723,9 @@ Outputter::Outputter()
 
 Outputter::Outputter(const char* name, const bool a, const bool b)
 {
+    quantum_ = 0;
+    precise_ = false;
+    filter_ = nullptr;
     open(name, a, b);
     
     if ( nonStandardTypes() )
@@ -352,7 +751,10 @@ int Outputter::open(const char* name, const bool a, const bool b)
     if ( b )
         m[1] = 'b';
         
-    return FileWrapper::open(name, m);
+    int res = FileWrapper::open(name, m);
+    if ( res == 0 )
+        buffer(1<<20);
+    return res;
 }
 
 
@@ -360,7 +762,7 @@ void Outputter::writeEndianess()
 {
     //the value corresponds to the ASCII code of "01"
     uint16_t x = 12592U;
-    if ( 2 != fwrite(&x, 1, 2, mFile) )
+    if ( !put_bytes(mFile, &x, 2) )
         throw InvalidIO("writeEndianess() failed");
 }
 
@@ -374,7 +776,7 @@ void Outputter::writeInt8(const int n, char before)
 
     if ( binary_ )
     {
-        if ( 1 != fwrite(&v, 1, 1, mFile) )
+        if ( !put_bytes(mFile, &v, 1) )
             throw InvalidIO("writeInt8()-binary failed");
     }
     else
@@ -394,7 +796,7 @@ void Outputter::writeInt16(const int n, char before)
 
     if ( binary_ )
     {
-        if ( 2 != fwrite(&v, 1, 2, mFile) )
+        if ( !put_bytes(mFile, &v, 2) )
             throw InvalidIO("writeInt16()-binary failed");
     }
     else
@@ -414,7 +816,7 @@ void Outputter::writeInt32(const int n, char before)
     
     if ( binary_ )
     {
-        if ( 4 != fwrite(&v, 1, 4, mFile) )
+        if ( !put_bytes(mFile, &v, 4) )
             throw InvalidIO("writeInt32()-binary failed");
     }
     else
@@ -434,20 +836,15 @@ void Outputter::writeUInt8(const unsigned n, char before)
     
     if ( binary_ )
     {
-        if ( 1 != fwrite(&v, 1, 1, mFile) )
+        if ( !put_bytes(mFile, &v, 1) )
             throw InvalidIO("writeUInt8()-binary failed");
     }
     else
     {
-        if ( before )
-        {
-            if ( 2 > fprintf(mFile, "%c%u", before, n) )
-                throw InvalidIO("writeUInt8() failed");
-        }
-        else {
-            if ( 1 > fprintf(mFile, "%u", n) )
-                throw InvalidIO("writeUInt8() failed");
-        }
+        char str[32];
+        size_t len = print_uint(str, before, v) - str;
+        if ( !put_bytes(mFile, str, len) )
+            throw InvalidIO("writeUInt8() failed");
     }
 }
 
@@ -461,20 +858,15 @@ void Outputter::writeUInt16(const unsigned n, char before)
 
     if ( binary_ )
     {
-        if ( 2 != fwrite(&v, 1, 2, mFile) )
+        if ( !put_bytes(mFile, &v, 2) )
             throw InvalidIO("writeUInt16()-binary failed");
     }
     else
     {
-        if ( before )
-        {
-            if ( 2 > fprintf(mFile, "%c%u", before, n) )
-                throw InvalidIO("writeUInt16() failed");
-        }
-        else {
-            if ( 1 > fprintf(mFile, "%u", n) )
-                throw InvalidIO("writeUInt16() failed");
-        }
+        char str[32];
+        size_t len = print_uint(str, before, v) - str;
+        if ( !put_bytes(mFile, str, len) )
+            throw InvalidIO("writeUInt16() failed");
     }
 }
 
@@ -488,21 +880,15 @@ void Outputter::writeUInt32(const unsigned n, char before)
     
     if ( binary_ )
     {
-        if ( 4 != fwrite(&v, 1, 4, mFile) )
+        if ( !put_bytes(mFile, &v, 4) )
             throw InvalidIO("writeUInt32()-binary failed");
     }
     else
     {
-        if ( before )
-        {
-            if ( 2 > fprintf(mFile, "%c%u", before, n) )
-                throw InvalidIO("writeUInt32() failed");
-        }
-        else
-        {
-            if ( 1 > fprintf(mFile, "%u", n) )
-                throw InvalidIO("writeUInt32() failed");
-        }
+        char str[32];
+        size_t len = print_uint(str, before, v) - str;
+        if ( !put_bytes(mFile, str, len) )
+            throw InvalidIO("writeUInt32() failed");
     }
 }
 
@@ -516,35 +902,75 @@ void Outputter::writeUInt64(const unsigned long n, char before)
     
     if ( binary_ )
     {
-        if ( 8 != fwrite(&v, 1, 8, mFile) )
+        if ( !put_bytes(mFile, &v, 8) )
             throw InvalidIO("writeUInt64()-binary failed");
     }
     else
     {
-        if ( before )
-        {
-            if ( 2 > fprintf(mFile, "%c%lu", before, n) )
-                throw InvalidIO("writeUInt64() failed");
-        }
-        else
-        {
-            if ( 1 > fprintf(mFile, "%lu", n) )
-                throw InvalidIO("writeUInt64() failed");
-        }
+        char str[32];
+        size_t len = print_uint(str, before, v) - str;
+        if ( !put_bytes(mFile, str, len) )
+            throw InvalidIO("writeUInt64() failed");
+    }
+}
+
+
+/**
+ In binary mode, small values take fewer bytes: 1 byte below 128, 2 bytes below 16384,
+ 3 bytes below 2097152, etc. (see Inputter::readVarUInt)
+ */
+void Outputter::writeVarUInt(const unsigned long n, char before)
+{
+    if ( !binary_ )
+        return writeUInt64(n, before);
+    
+    char str[16];
+    size_t len = 0;
+    uint64_t v = n;
+    while ( v > 127 )
+    {
+        str[len++] = (char)( 128 | ( v & 127 ));
+        v >>= 7;
     }
+    str[len++] = (char)v;
+    if ( !put_bytes(mFile, str, len) )
+        throw InvalidIO("writeVarUInt()-binary failed");
+}
+
+
+/**
+ With a power of 2, the rounded values have trailing zero bits in their mantissa,
+ which improves the compression of the frames (see SimulProp::frame_quantum).
+ */
+void Outputter::quantum(double q)
+{
+    quantum_ = 0;
+    if ( q > 0 )
+        quantum_ = std::exp2(std::floor(std::log2(q)));
 }
 
 
-void Outputter::writeFloat(const float x)
+void Outputter::writeFloat(float x)
 {
+    if ( precise_ && binary_ )
+        return writeDouble(x);
     if ( binary_ )
     {
-        if ( 4 != fwrite(&x, 1, 4, mFile) )
+        if ( quantum_ > 0 )
+            x = quantum_ * std::nearbyint(x / quantum_);
+        if ( !put_bytes(mFile, &x, 4) )
             throw InvalidIO("writeFloat()-binary failed");
     }
     else
     {
-        if ( 6 > fprintf(mFile, " %.6f", x) )
+        char str[32];
+        char * end = print_fixed6(str, x);
+        if ( !end )
+        {
+            if ( 6 > fprintf(mFile, " %.6f", x) )
+                throw InvalidIO("writeFloat() failed");
+        }
+        else if ( !put_bytes(mFile, str, end-str) )
             throw InvalidIO("writeFloat() failed");
     }
 }
@@ -562,6 +988,26 @@ void Outputter::writeFloats(const float* a, const size_t n, char before)
 
 void Outputter::writeFloats(const double* a, const size_t n, char before)
 {
+    if ( binary_ && !precise_ )
+    {
+        // convert by chunks, to write many values at once:
+        float buf[64];
+        for ( size_t s = 0; s < n; s += 64 )
+        {
+            size_t m = std::min(n-s, (size_t)64);
+            for ( size_t d = 0; d < m; ++d )
+                buf[d] = (float)a[s+d];
+            if ( quantum_ > 0 )
+            {
+                for ( size_t d = 0; d < m; ++d )
+                    buf[d] = quantum_ * std::nearbyint(buf[d] / quantum_);
+            }
+            if ( m != fwrite(buf, sizeof(float), m, mFile) )
+                throw InvalidIO("writeFloats()-binary failed");
+        }
+        return;
+    }
+
     if ( before && !binary_ )
         putc(before, mFile);
     
@@ -574,7 +1020,7 @@ void Outputter::writeDouble(const double x)
 {
     if ( binary_ )
     {
-        if ( 8 != fwrite(&x, 1, 8, mFile) )
+        if ( !put_bytes(mFile, &x, 8) )
             throw InvalidIO("writeDouble()-binary failed");
     }
     else
@@ -599,7 +1045,6 @@ void Outputter::writeSoftNewline()
 {
     if ( !binary_ )
         putc('\n', mFile);
-    fflush(mFile);
 }
 
 
@@ -608,7 +1053,7 @@ void Outputter::writeSoftSpace(size_t N)
     if ( !binary_ )
     {
         while ( N > 0 ) {
-            fprintf(mFile, " ");
+            putc(' ', mFile);
             N--;
         }
     }
@@ -4,14 +4,36 @@
 #define  IOWRAPPER_H
 
 #include <cstdio>
+#include <cstring>
 #include <stdint.h>
 #include "filewrapper.h"
 
 /// Input with automatic binary/text mode and byte-swapping for cross-platform compatibility
+/**
+ After map(), the file is mapped in memory, and the values are decoded directly
+ from the memory, which is faster than reading through the C-library.
+ The FILE remains open, and its position is updated only when needed,
+ by get_pos() and pos(). All reads should then be done with the functions of Inputter.
+ */
 class Inputter : public FileWrapper
 {
 private:
-        
+    
+    /// start of the data in memory, or nullptr if reading through the FILE
+    const char * mBase = nullptr;
+    
+    /// current reading position in memory
+    const char * mPtr = nullptr;
+    
+    /// end of the data in memory
+    const char * mEnd = nullptr;
+    
+    /// size of the memory mapping, or zero if the memory is not owned
+    size_t       mSize = 0;
+    
+    /// end-of-file indicator, when reading from memory
+    bool         mEOF = false;
+    
     /// The format ID of the input: this allow backward compatibility with older formats
     unsigned  format_;
     
@@ -25,6 +47,9 @@ private:
         */
     int       binary_;
     
+    /// if true, the floating point values are stored on 8 bytes in binary format
+    bool      precise_;
+    
     /// reverse order of bytes in c[2]
     /**
      Can use the Intel SIMD function _bswap() and _bswap64()
@@ -64,6 +89,40 @@ private:
         c[4] = v;
     }
 
+    /// extend the mapping if the file has grown, returning true if `n` bytes are available
+    bool      remap(size_t n);
+    
+    /// true if `n` bytes are available in memory
+    bool      available(size_t n) { return ( (size_t)( mEnd - mPtr ) >= n ) || remap(n); }
+
+    /// copy `n` bytes to `dst`, returning true if successful
+    bool      fetch(void * dst, size_t n)
+    {
+        if ( !mBase )
+            return 1 == fread(dst, n, 1, mFile);
+        if ( !available(n) )
+        {
+            mPtr = mEnd;
+            mEOF = true;
+            return false;
+        }
+        memcpy(dst, mPtr, n);
+        mPtr += n;
+        return true;
+    }
+    
+    /// skip spaces and copy the next characters into `buf`, for parsing numbers from memory
+    void      token(char buf[], size_t len);
+
+    /// read an integer in text format
+    bool      scan(long&);
+    /// read an integer in text format
+    bool      scan(unsigned long&);
+    /// read a float in text format
+    bool      scan(float&);
+    /// read a double in text format
+    bool      scan(double&);
+
 public:
     
     /// set defaults (not-binary)
@@ -77,6 +136,101 @@ public:
     
     /// constructor which opens a file
     Inputter(unsigned d, const char* name, bool bin) : FileWrapper(name, bin?"rb":"r"), vecsize_(d) { reset(); }
+    
+    /// destructor
+    ~Inputter() { unmap(); }
+    
+    /// open a file
+    int       open(const char* name, const char* mode) { unmap(); return FileWrapper::open(name, mode); }
+    
+    /// map the open file in memory, returning true if this succeeded
+    bool      map();
+    
+    /// read from `len` bytes at `buf`, which must remain valid, instead of the FILE
+    void      memory(const char* buf, size_t len);
+    
+    /// release the memory and read from the FILE, at the same position
+    void      unmap();
+    
+    /// current position in memory, or nullptr if reading through the FILE
+    const char* cursor()        const { return mBase ? mPtr : nullptr; }
+    
+    /// end of the data in memory
+    const char* bound()         const { return mEnd; }
+    
+    /// use the same format, dimensionality, byte order and precision as `in`
+    void      configure(Inputter const& in) { format_ = in.format_; vecsize_ = in.vecsize_; binary_ = in.binary_; precise_ = in.precise_; }
+    
+    /// true if reading from memory
+    bool      mapped()          const { return mBase; }
+    
+    /// true if at end of file
+    bool      eof()             const { return mBase ? mEOF : FileWrapper::eof(); }
+    
+    /// return the value of ferror()
+    int       error()           const { return mFile ? ferror(mFile) : 0; }
+    
+    /// true if file is good for reading
+    bool      good()            const { return mFile ? !ferror(mFile) : (bool)mBase; }
+
+    /// clear error flag
+    void      clear()                 { mEOF = false; FileWrapper::clear(); }
+    
+    /// rewind file
+    void      rewind()                { mPtr = mBase; mEOF = false; FileWrapper::rewind(); }
+    
+    /// lock file for current thread
+    void      lock()                  { if ( mFile ) flockfile(mFile); }
+    
+    /// unlock file for current thread
+    void      unlock()                { if ( mFile ) funlockfile(mFile); }
+
+    /// return current reading position
+    long      pos();
+    
+    /// set `p` to current reading position of file
+    int       get_pos(fpos_t& p);
+    
+    /// change current reading position to `p`
+    void      set_pos(const fpos_t& p);
+    
+    /// change current reading position to `off` bytes from the start of the file
+    void      seek(off_t off);
+
+    /// report next character to be read
+    int       peek()                  { if ( !mBase ) return FileWrapper::peek(); return available(1) ? (unsigned char)*mPtr : EOF; }
+    
+    /// read a character
+    int       get_char()
+    {
+        if ( !mBase )
+            return getc_unlocked(mFile);
+        if ( available(1) )
+            return (unsigned char)*mPtr++;
+        mEOF = true;
+        return EOF;
+    }
+    
+    /// read a byte
+    uint8_t   get_byte()              { return (uint8_t)get_char(); }
+    
+    /// unget character from input
+    void      unget(int c)            { if ( !mBase ) ungetc(c, mFile); else if ( c != EOF && mPtr > mBase ) --mPtr; }
+    
+    /// read `n` bytes into `dst`, returning the number of bytes read
+    size_t    read(void * dst, size_t n);
+
+    /// read until character `end` is found and set `line`, excluding terminating character
+    std::string get_line(char end='\n');
+    
+    /// read `cnt` characters
+    std::string get_characters(size_t cnt);
+    
+    /// Skip space and read next word separated by space
+    std::string get_word();
+    
+    /// read stream until given string is found
+    void      skip_until(const char * str);
 
     /// return dimensionnally of vectors
     unsigned  vectorSize()      const { return vecsize_; }
@@ -96,6 +250,12 @@ public:
     /// initialize the automatic swapping of bytes in the binary format
     void      setEndianess(const char[2]);
     
+    /// true if the floating point values are stored with double precision
+    bool      precise()         const { return precise_; }
+    
+    /// set to read floating point values stored on 8 bytes in binary format
+    void      precise(bool p)         { precise_ = p; }
+    
     /// Read integer on 2 bytes
     int16_t   readInt16();
     /// Read integer on 4 bytes
@@ -109,9 +269,11 @@ public:
     uint32_t  readUInt32();
     /// Read unsigned integer on 8 bytes
     uint64_t  readUInt64();
+    /// Read unsigned integer stored on a variable number of bytes
+    uint64_t  readVarUInt();
     
-    /// Reads one float on 4 bytes
-    float     readFloat();
+    /// Reads one float on 4 bytes, or on 8 bytes if precise()
+    double    readFloat();
     /// Reads one double on 8 bytes
     double    readDouble();
     
@@ -130,6 +292,7 @@ public:
 
 #pragma mark -
 
+class DeltaFilter;
 
 ///Output with automatic binary/text mode and byte-swapping for cross-platform compatibility
 class Outputter : public FileWrapper
@@ -139,6 +302,15 @@ private:
         
     /// Flag for binary output
     bool    binary_;
+    
+    /// if > 0, the floats are rounded to a multiple of this value in binary output
+    float   quantum_;
+    
+    /// if true, the values given as double are written on 8 bytes in binary output
+    bool    precise_;
+    
+    /// if not null, the records of objects are filtered to write delta frames
+    DeltaFilter * filter_;
 
 public:
 
@@ -146,7 +318,7 @@ public:
     Outputter();
     
     /// constructor which opens a file
-    Outputter(FILE* f, bool b) : FileWrapper(f, nullptr), binary_(b) {};
+    Outputter(FILE* f, bool b) : FileWrapper(f, nullptr), binary_(b), quantum_(0), precise_(false), filter_(nullptr) {};
 
     /// constructor which opens a file where `a` specifies append and `b` binary mode.
     Outputter(const char* name, bool a, bool b=false);
@@ -159,6 +331,24 @@ public:
     
     /// Return the current binary format
     bool    binary() const { return binary_; }
+    
+    /// Round floats in binary output to a multiple of the largest power of 2 below `q` (0 = exact)
+    void    quantum(double q);
+    
+    /// true if double precision values are written on 8 bytes in binary output
+    bool    precise() const { return precise_ && binary_; }
+    
+    /// set to write double precision values without rounding them to float
+    void    precise(bool p) { precise_ = p; }
+    
+    /// return the filter used to write delta frames, or null
+    DeltaFilter * filter() const { return filter_; }
+    
+    /// set the filter used to write delta frames
+    void    filter(DeltaFilter * f) { filter_ = f; }
+    
+    /// write to `f` instead of the current file, returning the current file
+    FILE *  redirect(FILE * f) { FILE * r = mFile; mFile = f; return r; }
 
     /// Puts given string, and '01' or '10', to specify the byte order 
     void    writeEndianess();
@@ -182,17 +372,19 @@ public:
     void    writeUInt16(unsigned, char before=' ');
     /// Write unsigned integer on 4 bytes
     void    writeUInt32(unsigned, char before=' ');
-    /// Write unsigned integer on 4 bytes
+    /// Write unsigned integer on 8 bytes
     void    writeUInt64(unsigned long, char before=' ');
+    /// Write unsigned integer on 1 to 10 bytes, using 7 bits of each byte
+    void    writeVarUInt(unsigned long, char before=' ');
 
-    /// Write value on 4 bytes
+    /// Write value on 4 bytes, or on 8 bytes if precise()
     void    writeFloat(float);
-    /// Write value on 4 bytes
-    void    writeFloat(double x) { writeFloat((float)x); }
+    /// Write value on 4 bytes, or on 8 bytes if precise()
+    void    writeFloat(double x) { if ( precise() ) writeDouble(x); else writeFloat((float)x); }
 
     /// Write `n` values using 4 bytes each
     void    writeFloats(const float*, size_t n, char before=0);
-    /// Write `n` values using 4 bytes each (converted to float)
+    /// Write `n` values using 4 bytes each (converted to float), or 8 bytes if precise()
     void    writeFloats(const double*, size_t n, char before=0);
 
     /// Write value on 8 bytes
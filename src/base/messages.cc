@@ -5,6 +5,9 @@
 
 namespace Cytosim
 {
+    /// no thread has its own destination by default
+    thread_local std::ostream* Output::local_ = nullptr;
+    
     /// alias to standard output
     Output out(std::cout);
     
@@ -28,9 +28,19 @@ namespace Cytosim
 
         /// remaining number of output that will be performed
         unsigned cnt_;
+        
+        /// if not null, destination of all output made by the current thread
+        static thread_local std::ostream* local_;
 
     public:
         
+        /**
+         Send all the output made by the current thread to `os`, instead of the
+         destination of the Output, or restore the destination if `os == nullptr`.
+         A thread running its own simulation can thus collect its messages.
+         */
+        static void local(std::ostream* os) { local_ = os; }
+        
         /// create stream directed to given stream with `max_output` allowed
         Output(std::ostream& os, unsigned n_out = 1<<16, std::string const& p = "") : pref_(p), out_(&os), cnt_(n_out)
         {
@@ -44,6 +54,12 @@ namespace Cytosim
             out_ = &ofs_;
         }
         
+        /// true if output is directed to a file
+        bool is_open() const
+        {
+            return ofs_.is_open();
+        }
+        
         /// close file
         void close()
         {
@@ -55,20 +71,20 @@ namespace Cytosim
         /// return current output stream
         std::ostream* stream() const
         {
-            return out_;
+            return local_ ? local_ : out_;
         }
         
         /// return current output
         operator std::ostream&()
         {
-            return *out_;
+            return *stream();
         }
         
         /// flush
         void flush()
         {
-            if ( out_ != &nul_ )
-                out_->flush();
+            if ( stream() != &nul_ )
+                stream()->flush();
         }
 
         /// direct output to /dev/null
@@ -80,18 +96,25 @@ namespace Cytosim
         /// direct output to given stream
         void redirect(Output const& x)
         {
-            out_ = x.stream();
+            out_ = x.out_;
+        }
+        
+        /// direct output to given std::ostream
+        void redirect(std::ostream& os)
+        {
+            out_ = &os;
         }
         
         /// std::ostream style output operator
         template < typename T >
         std::ostream& operator <<(T const& x)
         {
-            if ( out_!=&nul_ && out_->good() && cnt_ )
+            std::ostream* os = stream();
+            if ( os!=&nul_ && os->good() && cnt_ )
             {
                 --cnt_;
-                (*out_) << pref_ << x;
-                return *out_;
+                (*os) << pref_ << x;
+                return *os;
             }
             return nul_;
         }
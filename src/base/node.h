@@ -3,6 +3,8 @@
 #ifndef NODE_H
 #define NODE_H
 
+#include <stddef.h>
+
 
 /// Can be linked in a NodeList
 /**
@@ -24,11 +26,14 @@ protected:
     
     /// the previous Node in the list
     Node      *nPrev;
+    
+    /// position of the Node in the array of its NodeList
+    size_t     nIndex;
         
 public:
 
     /// constructor set as not linked
-    Node() : nNext(nullptr), nPrev(nullptr) { }
+    Node() : nNext(nullptr), nPrev(nullptr), nIndex(0) { }
     
     /// destructor
     virtual   ~Node() {};
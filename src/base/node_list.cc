@@ -6,6 +6,48 @@
 #include "assert_macro.h"
 #include "random.h"
 #include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+
+/**
+ The array grows geometrically, and is never reduced.
+ */
+void NodeList::record(Node * n)
+{
+    if ( nSize >= nAlloc )
+    {
+        size_t alc = 2 * nAlloc + 16;
+        Node ** mem = new Node*[alc];
+        for ( size_t i = 0; i < nSize; ++i )
+            mem[i] = nArray[i];
+        delete[] nArray;
+        nArray = mem;
+        nAlloc = alc;
+    }
+    n->nIndex = nSize;
+    nArray[nSize] = n;
+}
+
+
+void NodeList::forget(Node * n)
+{
+    assert_true( nSize > 0 );
+    assert_true( nArray[n->nIndex] == n );
+    Node * x = nArray[nSize-1];
+    nArray[n->nIndex] = x;
+    x->nIndex = n->nIndex;
+}
+
+
+Node * NodeList::random() const
+{
+    if ( nSize > UINT32_MAX )
+        return nArray[RNG.pint64(nSize)];
+    if ( nSize > 0 )
+        return nArray[RNG.pint32(nSize)];
+    return nullptr;
+}
 
 
 void NodeList::push_front(Node * n)
@@ -19,6 +61,7 @@ void NodeList::push_front(Node * n)
     else
         nBack = n;
     nFront = n;
+    record(n);
     ++nSize;
 }
 
@@ -34,6 +77,7 @@ void NodeList::push_back(Node * n)
     else
         nFront = n;
     nBack = n;
+    record(n);
     ++nSize;
 }
 
@@ -47,6 +91,15 @@ void NodeList::merge(NodeList& list)
     
     if ( n )
     {
+        // the array is updated using `nSize` as counter:
+        size_t cnt = nSize;
+        for ( Node * x = n; x; x = x->nNext )
+        {
+            record(x);
+            ++nSize;
+        }
+        nSize = cnt;
+
         if ( nBack )
             nBack->nNext = n;
         else
@@ -72,6 +125,7 @@ void NodeList::push_after(Node * p, Node * n)
     else
         nBack = n;
     p->nNext = n;
+    record(n);
     ++nSize;
 }
 
@@ -85,6 +139,7 @@ void NodeList::push_before(Node * p, Node * n)
     else
         nFront = n;
     p->nPrev = n;
+    record(n);
     ++nSize;
 }
 
@@ -93,6 +148,7 @@ void NodeList::pop_front()
 {
     assert_true( nFront );
  
+    forget(nFront);
     Node * n = nFront->nNext;
     nFront = n;
     n->nNext = nullptr;  // unnecessary?
@@ -109,6 +165,7 @@ void NodeList::pop_back()
 {
     assert_true( nBack );
     
+    forget(nBack);
     Node * n = nBack->nPrev;
     nBack = n;
     n->nPrev = nullptr;  // unnecessary?
@@ -124,6 +181,7 @@ void NodeList::pop_back()
 void NodeList::pop(Node * n)
 {
     assert_true( nSize > 0 );
+    forget(n);
     Node * x = n->nNext;
 
     if ( n->nPrev )
@@ -373,6 +431,107 @@ void NodeList::shuffle3()
 }
 
 
+/**
+ This uses the same algorithm as Array::shuffle(), and links the Nodes
+ in the order of the array. The cost is proportional to the number of Nodes,
+ and one random number is used per Node.
+ */
+void NodeList::shuffle_all()
+{
+    if ( nSize < 2 )
+        return;
+    
+    size_t i = nSize-1;
+    while ( i > UINT32_MAX )
+    {
+        size_t j = RNG.pint64(i+1);
+        Node * x = nArray[i];
+        nArray[i] = nArray[j];
+        nArray[j] = x;
+        --i;
+    }
+    while ( i > 0 )
+    {
+        size_t j = RNG.pint32(uint32_t(i+1));
+        Node * x = nArray[i];
+        nArray[i] = nArray[j];
+        nArray[j] = x;
+        --i;
+    }
+    
+    relink_array();
+}
+
+
+void NodeList::relink_array()
+{
+    if ( nSize < 1 )
+        return;
+    Node * p = nullptr;
+    for ( size_t i = 0; i < nSize; ++i )
+    {
+        Node * n = nArray[i];
+        n->nIndex = i;
+        n->nPrev = p;
+        if ( p )
+            p->nNext = n;
+        p = n;
+    }
+    p->nNext = nullptr;
+    nFront = nArray[0];
+    nBack = p;
+}
+
+
+/**
+ The Nodes with equal keys are ordered as in the array.
+ */
+void NodeList::sort_keys(unsigned long long const* key)
+{
+    if ( nSize < 2 )
+        return;
+    
+    std::vector< std::pair<unsigned long long, Node*> > tmp(nSize);
+    for ( size_t i = 0; i < nSize; ++i )
+        tmp[i] = std::make_pair(key[i], nArray[i]);
+    
+    std::stable_sort(tmp.begin(), tmp.end(),
+                     [](std::pair<unsigned long long, Node*> const& a,
+                        std::pair<unsigned long long, Node*> const& b) { return a.first < b.first; });
+    
+    for ( size_t i = 0; i < nSize; ++i )
+        nArray[i] = tmp[i].second;
+    relink_array();
+}
+
+
+/**
+ The list [F--P][X--L] is rearranged into [X--L][F--P], where X is chosen with
+ random(), such that every Node is equally likely to become first.
+ */
+void NodeList::rotate()
+{
+    if ( nSize > 1 )
+        permute(random()->nPrev);
+}
+
+
+void NodeList::reverse()
+{
+    Node * n = nFront;
+    while ( n )
+    {
+        Node * x = n->nNext;
+        n->nNext = n->nPrev;
+        n->nPrev = x;
+        n = x;
+    }
+    n = nFront;
+    nFront = nBack;
+    nBack = n;
+}
+
+
 unsigned int NodeList::count() const
 {
     unsigned int cnt = 0;
@@ -423,6 +582,11 @@ int NodeList::bad() const
     
     if ( cnt != nSize )
         return 75;
+    for ( size_t i = 0; i < nSize; ++i )
+    {
+        if ( nArray[i]->nIndex != i )
+            return 76;
+    }
     return 0;
 }
 
@@ -24,6 +24,12 @@
  for ( Node * n = front(); n ; n = n->next() );
  for ( Node * n = back() ; n ; n = n->prev() );
  
+ The Nodes are also recorded in an array, in which their order is unrelated to
+ the order of the list, since a Node is always added at the end of the array,
+ and the last Node of the array is moved to the place of any removed Node.
+ This gives access to any Node in constant time with node(), and random() picks
+ a Node uniformly in constant time. Finally, shuffle_all() makes a complete
+ Fisher-Yates permutation of the array, and links the Nodes in this order.
  */
 
 class NodeList
@@ -40,6 +46,21 @@ private:
     /// Number of Node in the list
     size_t   nSize;
     
+    /// array of all the Nodes, in arbitrary order
+    Node **  nArray;
+    
+    /// allocated size of nArray
+    size_t   nAlloc;
+    
+    /// add `n` at the end of nArray
+    void     record(Node * n);
+    
+    /// remove `n` from nArray, filling the gap with the last Node
+    void     forget(Node * n);
+    
+    /// link the Nodes in the order of nArray
+    void     relink_array();
+    
     /// Disabled copy constructor
     NodeList(NodeList const&);
     
@@ -49,10 +70,10 @@ private:
 public:
     
     /// default constructor
-    NodeList() : nFront(nullptr), nBack(nullptr), nSize(0) { }
+    NodeList() : nFront(nullptr), nBack(nullptr), nSize(0), nArray(nullptr), nAlloc(0) { }
     
     /// Destructor
-    virtual         ~NodeList()    { clear(); }
+    virtual         ~NodeList()    { clear(); delete[] nArray; }
     
     /// First Node in list
     Node *          front()  const { return nFront; }
@@ -66,6 +87,12 @@ public:
     /// true if list has zero elements
     bool            empty()  const { return nFront == nullptr; }
     
+    /// Node at position `i` of the array, which is not the order of the list
+    Node *          node(size_t i) const { return nArray[i]; }
+    
+    /// a Node chosen randomly with uniform probability, or zero if the list is empty
+    Node *          random() const;
+    
     /// put Node first in the list
     void            push_front(Node *);
     
@@ -117,6 +144,18 @@ public:
     /// call mix() three times
     void            shuffle3();
 
+    /// Randomize the entire list, with a Fisher-Yates permutation of the array
+    void            shuffle_all();
+
+    /// Link the Nodes by increasing values of `key[i]`, which is associated with node(i)
+    void            sort_keys(unsigned long long const* key);
+    
+    /// Start the list at a Node chosen randomly, in constant time
+    void            rotate();
+    
+    /// Invert the order of the list
+    void            reverse();
+
     /// count number of elements in the list
     unsigned int    count() const;
     
@@ -5,6 +5,186 @@
 #include <new>
 #include <cstdio>
 #include <cstdlib>
+#include <atomic>
+#include <iomanip>
+#include <algorithm>
+#include "operator_new.h"
+#include "backtrace.h"
+
+//------------------------------------------------------------------------------
+#pragma mark - Tracking
+
+/// number of return addresses identifying a call-site
+constexpr int SITE_DEPTH = 6;
+
+/// maximum number of call-sites recorded
+constexpr unsigned SITE_MAX = 1024;
+
+/// a call-site, identified by its return addresses and by the phase
+struct AllocSite
+{
+    void *   pc[SITE_DEPTH];
+    unsigned phase;
+    size_t   count;
+    size_t   bytes;
+};
+
+/// all variables are initialized to zero before any constructor is called
+static std::atomic<bool>     track_on(false);
+static std::atomic<unsigned> track_now(0);
+static std::atomic<size_t>   track_cnt[ALLOC_PHASES];
+static std::atomic<size_t>   track_bytes[ALLOC_PHASES];
+static std::atomic<size_t>   track_total(0);
+static unsigned              track_sample = 0;
+
+static AllocSite             sites[SITE_MAX];
+static size_t                sites_lost = 0;
+static std::atomic_flag      sites_lock = ATOMIC_FLAG_INIT;
+
+/// set while a call-stack is recorded, since backtrace() may itself allocate
+static thread_local bool     sites_busy = false;
+
+
+void alloc_tracking(unsigned sample)
+{
+    track_sample = sample;
+    track_on.store(true);
+}
+
+
+bool alloc_tracked()
+{
+    return track_on.load(std::memory_order_relaxed);
+}
+
+
+unsigned alloc_phase(unsigned p)
+{
+    return track_now.exchange(p < ALLOC_PHASES ? p : 0, std::memory_order_relaxed);
+}
+
+
+/// add the sampled allocation to the call-site identified by `pc`
+static void record_site(void * const pc[SITE_DEPTH], unsigned phase, size_t size)
+{
+    size_t h = phase;
+    for ( int d = 0; d < SITE_DEPTH; ++d )
+        h = h * 31 + (size_t)pc[d];
+    h ^= h >> 17;
+
+    while ( sites_lock.test_and_set(std::memory_order_acquire) );
+    // open addressing, with linear probing:
+    for ( unsigned n = 0; n < SITE_MAX; ++n )
+    {
+        AllocSite & s = sites[(h+n)%SITE_MAX];
+        if ( s.count == 0 )
+        {
+            std::copy(pc, pc+SITE_DEPTH, s.pc);
+            s.phase = phase;
+        }
+        else if ( s.phase != phase || !std::equal(pc, pc+SITE_DEPTH, s.pc) )
+            continue;
+        ++s.count;
+        s.bytes += size;
+        sites_lock.clear(std::memory_order_release);
+        return;
+    }
+    ++sites_lost;
+    sites_lock.clear(std::memory_order_release);
+}
+
+
+/// count one allocation, which is never inlined to keep the frames of the call-stack
+__attribute__((noinline))
+static void track(std::size_t size)
+{
+    const unsigned p = track_now.load(std::memory_order_relaxed);
+    track_cnt[p].fetch_add(1, std::memory_order_relaxed);
+    track_bytes[p].fetch_add(size, std::memory_order_relaxed);
+
+    if ( track_sample && !sites_busy )
+    {
+        if ( 0 == track_total.fetch_add(1, std::memory_order_relaxed) % track_sample )
+        {
+            sites_busy = true;
+            // skip track() and operator new:
+            void * buf[SITE_DEPTH+2] = { nullptr };
+            int n = collect_backtrace(buf, SITE_DEPTH+2);
+            if ( n > 2 )
+                record_site(buf+2, p, size);
+            sites_busy = false;
+        }
+    }
+}
+
+
+/**
+ The numbers of the call-sites are estimated by multiplying the sampled counts
+ by the sampling period.
+ */
+void alloc_report(std::ostream& os, const char * const names[], unsigned cnt, size_t steps)
+{
+    if ( !alloc_tracked() )
+    {
+        os << "\n% allocations are not tracked, use `simul:profile_alloc = N` to enable it";
+        return;
+    }
+    const double div = ( steps > 0 ) ? double(steps) : 1.0;
+    const std::ios::fmtflags flags = os.flags();
+    const std::streamsize prec = os.precision();
+    os << "\n% allocations in " << steps << " steps:";
+    os << "\n% " << std::setw(14) << "phase" << std::setw(12) << "count" << std::setw(14) << "bytes";
+    os << std::setw(16) << "count_per_step" << std::setw(16) << "bytes_per_step";
+    size_t sum = 0, tot = 0;
+    for ( unsigned p = 0; p < ALLOC_PHASES && p <= cnt; ++p )
+    {
+        size_t c = track_cnt[p].load(), b = track_bytes[p].load();
+        sum += c;
+        tot += b;
+        if ( c == 0 )
+            continue;
+        os << "\n  " << std::setw(14) << ( p > 0 ? names[p-1] : "other" );
+        os << std::setw(12) << c << std::setw(14) << b;
+        os << std::setw(16) << std::fixed << std::setprecision(1) << c / div;
+        os << std::setw(16) << b / div;
+    }
+    os << "\n  " << std::setw(14) << "total" << std::setw(12) << sum << std::setw(14) << tot;
+    os << std::setw(16) << sum / div << std::setw(16) << tot / div;
+    os.flags(flags);
+    os.precision(prec);
+
+    if ( !track_sample )
+        return;
+
+    // copy the call-sites, and sort them by decreasing count:
+    AllocSite * vec = (AllocSite*)malloc(SITE_MAX*sizeof(AllocSite));
+    if ( !vec )
+        return;
+    unsigned nbs = 0;
+    while ( sites_lock.test_and_set(std::memory_order_acquire) );
+    for ( unsigned i = 0; i < SITE_MAX; ++i )
+        if ( sites[i].count > 0 )
+            vec[nbs++] = sites[i];
+    size_t lost = sites_lost;
+    sites_lock.clear(std::memory_order_release);
+    std::sort(vec, vec+nbs, [](AllocSite const& a, AllocSite const& b) { return a.count > b.count; });
+
+    os << "\n% call-sites sampled every " << track_sample << " allocations:";
+    if ( lost )
+        os << " (" << lost << " samples lost)";
+    for ( unsigned i = 0; i < nbs && i < 16; ++i )
+    {
+        AllocSite const& s = vec[i];
+        os << "\n% site " << i << ": " << s.count * track_sample << " allocations of ";
+        os << s.bytes / s.count << " bytes in " << ( s.phase > 0 && s.phase <= cnt ? names[s.phase-1] : "other" );
+        for ( int d = 0; d < SITE_DEPTH && s.pc[d]; ++d )
+            os << "\n      " << backtrace_symbol(s.pc[d]);
+    }
+    free(vec);
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - Operators
 
 void* operator new(std::size_t size)
 {
@@ -27,6 +207,8 @@ void* operator new(std::size_t size)
 #endif
     if ( ptr == nullptr )
         throw std::bad_alloc();
+    if ( track_on.load(std::memory_order_relaxed) )
+        track(size);
     //std::printf("Cytosim new %5zu %p\n", size, ptr);
     return ptr;
 }
@@ -0,0 +1,35 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef OPERATOR_NEW_H
+#define OPERATOR_NEW_H
+
+#include <iostream>
+
+
+/*
+ Optional tracking of the allocations made by the global operator new
+
+ When tracking is enabled, every allocation is counted, together with the
+ number of bytes requested, in the bucket of the current phase, which is set
+ by alloc_phase(). In addition, the call-stack of one allocation in `sample`
+ is recorded with collect_backtrace(), and the allocations are grouped by
+ call-site, to locate the allocations that are frequent.
+ When tracking is disabled, the only cost is the test of a flag in operator new.
+ */
+
+/// maximum number of phases, including phase 0 that collects unspecified allocations
+constexpr unsigned ALLOC_PHASES = 33;
+
+/// start counting allocations, recording the call-stack of one allocation in `sample`
+void alloc_tracking(unsigned sample);
+
+/// true if allocations are tracked
+bool alloc_tracked();
+
+/// attribute the following allocations to `phase` (< ALLOC_PHASES) and return the previous phase
+unsigned alloc_phase(unsigned phase);
+
+/// print the allocations of each phase called `names[i-1]`, and the most frequent call-sites
+void alloc_report(std::ostream&, const char * const names[], unsigned cnt, size_t steps);
+
+#endif
@@ -0,0 +1,335 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#include "profiler.h"
+#include <iomanip>
+
+#ifdef __linux__
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#  include <cstring>
+#endif
+
+/// kinds of hardware counters, in the order of the columns of report()
+enum { KIND_CYCLES, KIND_INSTRUCTIONS, KIND_CACHE, KIND_BRANCH };
+
+
+Profiler::Profiler()
+: nbp_(0), nct_(0), steps_(0), lastSteps_(0), start_(0), lastTime_(0), period_(1), on_(false), trace_(nullptr),
+  probe_(nullptr), probedMask_(0), probedSteps_(0), probeFile_(nullptr)
+{
+    for ( unsigned i = 0; i < MAX; ++i )
+    {
+        name_[i] = "";
+        probed_[i] = 0;
+        sum_[i] = 0;
+        cnt_[i] = 0;
+        lastSum_[i] = 0;
+        lastCnt_[i] = 0;
+        stepSum_[i] = 0;
+        for ( unsigned k = 0; k < NCT; ++k )
+        {
+            ctr_[i][k] = 0;
+            lastCtr_[i][k] = 0;
+        }
+    }
+    for ( unsigned k = 0; k < NCT; ++k )
+    {
+        fds_[k] = -1;
+        kind_[k] = 0;
+    }
+}
+
+
+Profiler::~Profiler()
+{
+    if ( trace_ )
+    {
+        // the closing bracket is optional in the Trace Event format:
+        fprintf(trace_, "{}]\n");
+        fclose(trace_);
+    }
+    if ( probeFile_ )
+        fclose(probeFile_);
+#ifdef __linux__
+    for ( unsigned k = nct_; k-- > 0; )
+        close(fds_[k]);
+#endif
+}
+
+
+void Profiler::enable(unsigned period, const char * const names[], unsigned cnt, const char trace[])
+{
+    nbp_ = ( cnt < MAX ) ? cnt : MAX;
+    for ( unsigned i = 0; i < nbp_; ++i )
+        name_[i] = names[i];
+    period_ = ( period > 0 ) ? period : 1;
+    origin_ = clock::now();
+    start_ = 0;
+    steps_ = 0;
+    if ( trace && !trace_ )
+    {
+        trace_ = fopen(trace, "w");
+        if ( trace_ )
+            fprintf(trace_, "[\n");
+        else
+            std::cerr << "Warning: could not open `" << trace << "' for writing\n";
+    }
+    on_ = true;
+}
+
+
+/**
+ The file has one column per phase, in which `-` indicates that the phase was
+ not executed during the step. Since enable() sets the names of the columns,
+ it must be called first.
+ */
+void Profiler::enableProbe(probe_t probe, const char path[])
+{
+    if ( !probeFile_ )
+    {
+        probeFile_ = fopen(path, "w");
+        if ( !probeFile_ )
+        {
+            std::cerr << "Warning: could not open `" << path << "' for writing\n";
+            return;
+        }
+        fprintf(probeFile_, "%% step");
+        for ( unsigned i = 0; i < nbp_; ++i )
+            fprintf(probeFile_, " %s", name_[i]);
+        fprintf(probeFile_, "\n");
+    }
+    probe_ = probe;
+    probedMask_ = 0;
+}
+
+
+/**
+ The counters are opened as a group, such that they are read together.
+ This returns the number of counters, which is zero if they are not available.
+ */
+unsigned Profiler::enableCounters(unsigned groups)
+{
+#ifdef __linux__
+    const int kinds[NCT] = { KIND_CYCLES, KIND_INSTRUCTIONS, KIND_CACHE, KIND_BRANCH };
+    const unsigned long configs[NCT] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+    const unsigned need[NCT] = { COUNT_IPC, COUNT_IPC, COUNT_CACHE, COUNT_BRANCH };
+    
+    for ( unsigned k = 0; k < NCT; ++k )
+    {
+        if ( !( groups & need[k] ) || nct_ >= NCT )
+            continue;
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[k];
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // this thread only, on any CPU:
+        int lead = nct_ ? fds_[0] : -1;
+        int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, lead, 0);
+        if ( fd < 0 )
+        {
+            std::cerr << "Warning: hardware counters are not available (see perf_event_paranoid)\n";
+            break;
+        }
+        fds_[nct_] = fd;
+        kind_[nct_] = kinds[k];
+        ++nct_;
+    }
+    if ( nct_ > 0 )
+    {
+        ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#else
+    if ( groups )
+        std::cerr << "Warning: hardware counters are only supported on Linux\n";
+#endif
+    return nct_;
+}
+
+
+void Profiler::readCounters(counter_t res[NCT]) const
+{
+#ifdef __linux__
+    if ( nct_ > 0 )
+    {
+        // with PERF_FORMAT_GROUP, the number of counters precedes their values:
+        counter_t buf[1+NCT];
+        if ( read(fds_[0], buf, sizeof(counter_t)*(1+nct_)) > 0 )
+        {
+            for ( unsigned k = 0; k < nct_; ++k )
+                res[k] = buf[1+k];
+            return;
+        }
+    }
+#endif
+    for ( unsigned k = 0; k < NCT; ++k )
+        res[k] = 0;
+}
+
+
+void Profiler::record(unsigned phase, double start, double time, counter_t const ref[NCT])
+{
+    if ( phase < nbp_ && nct_ > 0 )
+    {
+        counter_t val[NCT];
+        readCounters(val);
+        for ( unsigned k = 0; k < nct_; ++k )
+            ctr_[phase][k] += val[k] - ref[k];
+    }
+    record(phase, start, time);
+}
+
+
+void Profiler::record(unsigned phase, double start, double time)
+{
+    if ( phase < nbp_ )
+    {
+        sum_[phase] += time;
+        stepSum_[phase] += time;
+        ++cnt_[phase];
+        if ( probe_ )
+        {
+            probed_[phase] = probe_();
+            probedMask_ |= 1U << phase;
+        }
+        if ( trace_ )
+            fprintf(trace_, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.1f,\"dur\":%.1f,\"pid\":1,\"tid\":1},\n",
+                    name_[phase], start, time);
+    }
+}
+
+
+void Profiler::step()
+{
+    if ( !on_ )
+        return;
+    if ( probeFile_ && probedMask_ )
+    {
+        fprintf(probeFile_, "%lu", probedSteps_);
+        for ( unsigned i = 0; i < nbp_; ++i )
+        {
+            if ( probedMask_ & ( 1U << i ))
+                fprintf(probeFile_, " %016llx", probed_[i]);
+            else
+                fprintf(probeFile_, " -");
+        }
+        fprintf(probeFile_, "\n");
+        probedMask_ = 0;
+    }
+    ++probedSteps_;
+    for ( unsigned i = 0; i < nbp_; ++i )
+        stepSum_[i] = 0;
+    if ( steps_ >= period_ )
+    {
+        const double t = now();
+        for ( unsigned i = 0; i < nbp_; ++i )
+        {
+            lastSum_[i] = sum_[i];
+            lastCnt_[i] = cnt_[i];
+            sum_[i] = 0;
+            cnt_[i] = 0;
+            for ( unsigned k = 0; k < nct_; ++k )
+            {
+                lastCtr_[i][k] = ctr_[i][k];
+                ctr_[i][k] = 0;
+            }
+        }
+        lastSteps_ = steps_;
+        lastTime_ = t - start_;
+        start_ = t;
+        steps_ = 0;
+    }
+    ++steps_;
+}
+
+
+/**
+ The times are given in milliseconds, and the fraction of the wall-time of the
+ period spent in each phase is given in percent. Phases that are nested within
+ another one are counted in both.
+ */
+void Profiler::report(std::ostream& os) const
+{
+    double const* sum = lastSum_;
+    size_t const* cnt = lastCnt_;
+    counter_t const (*ctr)[NCT] = lastCtr_;
+    size_t steps = lastSteps_;
+    double time = lastTime_;
+    if ( steps == 0 )
+    {
+        sum = sum_;
+        cnt = cnt_;
+        ctr = ctr_;
+        steps = steps_;
+        time = now() - start_;
+    }
+    if ( !on_ || steps == 0 )
+    {
+        os << "\n% profiling is disabled, use `simul:profile = N` to enable it";
+        return;
+    }
+    os << "\n% profile of " << steps << " steps:";
+    os << "\n% " << std::setw(14) << "phase" << std::setw(9) << "calls";
+    os << std::setw(12) << "total_ms" << std::setw(12) << "ms_per_step" << std::setw(9) << "percent";
+    // columns of the hardware counters, in thousands of events per step:
+    int cycles = -1, instructions = -1;
+    for ( unsigned k = 0; k < nct_; ++k )
+    {
+        switch ( kind_[k] )
+        {
+            case KIND_CYCLES: cycles = k; break;
+            case KIND_INSTRUCTIONS: instructions = k; break;
+            case KIND_CACHE: os << std::setw(14) << "cache_miss_k"; break;
+            case KIND_BRANCH: os << std::setw(14) << "branch_miss_k"; break;
+        }
+    }
+    if ( cycles >= 0 && instructions >= 0 )
+        os << std::setw(7) << "ipc";
+    os << std::fixed << std::setprecision(3);
+    for ( unsigned i = 0; i < nbp_; ++i )
+    {
+        os << '\n' << std::setw(16) << name_[i] << std::setw(9) << cnt[i];
+        os << std::setw(12) << 1e-3 * sum[i] << std::setw(12) << 1e-3 * sum[i] / steps;
+        os << std::setw(9) << std::setprecision(1) << 100 * sum[i] / time << std::setprecision(3);
+        for ( unsigned k = 0; k < nct_; ++k )
+            if ( kind_[k] == KIND_CACHE || kind_[k] == KIND_BRANCH )
+                os << std::setw(14) << 1e-3 * ctr[i][k] / steps;
+        if ( cycles >= 0 && instructions >= 0 )
+        {
+            counter_t c = ctr[i][cycles];
+            os << std::setw(7) << std::setprecision(2) << ( c ? double(ctr[i][instructions]) / c : 0.0 );
+            os << std::setprecision(3);
+        }
+    }
+    os << '\n' << std::setw(16) << "total" << std::setw(9) << steps;
+    os << std::setw(12) << 1e-3 * time << std::setw(12) << 1e-3 * time / steps;
+    os << std::setw(9) << std::setprecision(1) << 100.0;
+    os << std::defaultfloat << std::setprecision(6);
+}
+
+
+/**
+ The times are given in milliseconds, for the phases executed since the last
+ call to step(). This is used to describe an anomalous step.
+ */
+void Profiler::reportStep(std::ostream& os) const
+{
+    if ( !on_ )
+    {
+        os << "\n% profiling is disabled, use `simul:profile = N` to enable it";
+        return;
+    }
+    os << "\n% profile of the current step:";
+    os << "\n% " << std::setw(14) << "phase" << std::setw(12) << "ms";
+    os << std::fixed << std::setprecision(3);
+    for ( unsigned i = 0; i < nbp_; ++i )
+        os << '\n' << std::setw(16) << name_[i] << std::setw(12) << 1e-3 * stepSum_[i];
+    os << std::defaultfloat << std::setprecision(6);
+}
@@ -0,0 +1,227 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include "operator_new.h"
+
+
+/// Records the wall-time spent in the phases of the time steps
+/**
+ The phases are identified by their index in a list of names given to enable().
+ The time spent in each phase is accumulated over `period` steps, after which
+ the totals are kept for report() and a new period is started.
+ If a trace file is specified, every measurement is also written to it in
+ the Trace Event format, which can be opened in `chrome://tracing`.
+
+ A phase is timed by creating a Profiler::Scope, which does nothing if the
+ Profiler is not enabled:
+
+     Profiler::Scope scope(profiler, PHASE);
+
+ On Linux, hardware counters can also be attached to the phases with
+ enableCounters(), using the perf_event interface of the kernel. The counters
+ only follow the thread that created the Profiler, and not the OpenMP workers.
+ Their access may be restricted by `/proc/sys/kernel/perf_event_paranoid`.
+
+ The times of the current step are also kept, and printed by reportStep().
+
+ With enableProbe(), a function is called after each phase, and the values are
+ written to a file, to check that two runs followed the same path.
+
+ While a phase is timed, the allocations are attributed to it (see operator_new.h),
+ with the index of the phase plus one.
+ */
+class Profiler
+{
+public:
+
+    /// maximum number of phases
+    static constexpr unsigned MAX = 32;
+
+    /// maximum number of hardware counters
+    static constexpr unsigned NCT = 4;
+
+    /// groups of hardware counters, to be combined in the argument of enableCounters()
+    enum { COUNT_CACHE = 1, COUNT_BRANCH = 2, COUNT_IPC = 4 };
+
+    /// type of the values of the hardware counters
+    typedef unsigned long long counter_t;
+
+    /// function called after each phase by enableProbe()
+    typedef unsigned long long (*probe_t)();
+
+    /// measures the time between its construction and its destruction
+    class Scope
+    {
+        Profiler & pro_;
+        unsigned   phase_;
+        unsigned   alloc_;
+        double     start_;
+        counter_t  count_[NCT];
+    public:
+        /// start timing `phase`
+        Scope(Profiler& p, unsigned phase) : pro_(p), phase_(phase), alloc_(0), start_(0)
+        {
+            if ( p.on_ )
+            {
+                alloc_ = alloc_phase(phase+1);
+                p.readCounters(count_);
+                start_ = p.now();
+            }
+        }
+        /// record the time spent since the construction
+        ~Scope()
+        {
+            if ( pro_.on_ )
+            {
+                double t = pro_.now();
+                pro_.record(phase_, start_, t - start_, count_);
+                alloc_phase(alloc_);
+            }
+        }
+    };
+
+private:
+
+    typedef std::chrono::steady_clock clock;
+
+    /// names of the phases
+    const char * name_[MAX];
+
+    /// number of phases
+    unsigned nbp_;
+
+    /// time accumulated for each phase during the current period, in microseconds
+    double sum_[MAX];
+
+    /// number of measures for each phase during the current period
+    size_t cnt_[MAX];
+
+    /// times of the last complete period
+    double lastSum_[MAX];
+
+    /// number of measures of the last complete period
+    size_t lastCnt_[MAX];
+
+    /// time accumulated for each phase since the start of the current step, in microseconds
+    double stepSum_[MAX];
+
+    /// values of the hardware counters accumulated during the current period
+    counter_t ctr_[MAX][NCT];
+
+    /// values of the hardware counters of the last complete period
+    counter_t lastCtr_[MAX][NCT];
+
+    /// file descriptors of the hardware counters, the first one leading the group
+    int fds_[NCT];
+
+    /// kind of the hardware counters
+    int kind_[NCT];
+
+    /// number of hardware counters
+    unsigned nct_;
+
+    /// number of steps in the current period
+    size_t steps_;
+
+    /// number of steps in the last complete period
+    size_t lastSteps_;
+
+    /// start of the current period, in microseconds
+    double start_;
+
+    /// duration of the last complete period, in microseconds
+    double lastTime_;
+
+    /// number of steps in a period
+    size_t period_;
+
+    /// true if enabled
+    bool on_;
+
+    /// origin of the time
+    clock::time_point origin_;
+
+    /// file in which the trace is written
+    FILE * trace_;
+
+    /// function called after each phase, or nullptr
+    probe_t probe_;
+
+    /// values returned by `probe_` after each phase of the current step
+    unsigned long long probed_[MAX];
+
+    /// bit field of the phases that were probed in the current step
+    unsigned probedMask_;
+
+    /// number of steps written to `probeFile_`
+    size_t probedSteps_;
+
+    /// file in which the probed values are written
+    FILE * probeFile_;
+
+    /// disabled copy constructor
+    Profiler(Profiler const&);
+
+    /// disabled assignment operator
+    Profiler& operator = (Profiler const&);
+
+public:
+
+    /// constructor, disabled
+    Profiler();
+
+    /// destructor, closing the trace file
+    ~Profiler();
+
+    /// start profiling the `cnt` phases called `names`, with periods of `period` steps
+    void enable(unsigned period, const char * const names[], unsigned cnt, const char trace[]);
+
+    /// true if measurements are recorded
+    bool enabled() const { return on_; }
+
+    /// number of phases
+    unsigned nbPhases() const { return nbp_; }
+
+    /// names of the phases
+    const char * const * names() const { return name_; }
+
+    /// time since enable(), in microseconds
+    double now() const { return std::chrono::duration<double, std::micro>(clock::now() - origin_).count(); }
+
+    /// open the hardware counters specified by the bit field `groups`, returning the number of counters
+    unsigned enableCounters(unsigned groups);
+
+    /// number of hardware counters enabled
+    unsigned nbCounters() const { return nct_; }
+
+    /// after each phase, call `probe` and write the values of each step on a line of file `path`
+    void enableProbe(probe_t probe, const char path[]);
+
+    /// set current values of the hardware counters
+    void readCounters(counter_t[NCT]) const;
+
+    /// record that `phase` started at `start` and lasted `time` (in microseconds)
+    void record(unsigned phase, double start, double time);
+
+    /// record `phase`, including the hardware counters from the values `ref` read at its start
+    void record(unsigned phase, double start, double time, counter_t const ref[NCT]);
+
+    /// signal the start of a time step, which may start a new period
+    void step();
+
+    /// print the times of the last complete period, or of the current period
+    void report(std::ostream&) const;
+
+    /// time spent in `phase` since the start of the current step, in microseconds
+    double stepTime(unsigned phase) const { return phase < nbp_ ? stepSum_[phase] : 0; }
+
+    /// print the times of the phases executed since the start of the current step
+    void reportStep(std::ostream&) const;
+};
+
+#endif
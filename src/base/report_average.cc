@@ -0,0 +1,109 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#include "report_average.h"
+#include <fstream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+
+/// number of digits after the decimal point in `str`
+static int count_digits(std::string const& str)
+{
+    size_t p = str.find('.');
+    if ( p == std::string::npos )
+        return 0;
+    size_t e = str.find_first_not_of("0123456789", p+1);
+    if ( e == std::string::npos )
+        e = str.size();
+    return (int)( e - p - 1 );
+}
+
+
+void ReportAverage::addLine(std::vector<Cell>& row, std::string const& str)
+{
+    if ( str.empty() || str[0] == '%' )
+    {
+        if ( row.empty() )
+            row.push_back(Cell{str, false, 0, 0, 0, 0, 0});
+        return;
+    }
+    size_t k = 0, e = 0;
+    while ( e < str.size() )
+    {
+        // the field includes the spaces preceding the word:
+        size_t b = str.find_first_not_of(" \t", e);
+        if ( b == std::string::npos )
+            break;
+        size_t w = e;
+        e = std::min(str.find_first_of(" \t", b), str.size());
+        std::string word = str.substr(b, e-b);
+        char * end = nullptr;
+        double x = strtod(word.c_str(), &end);
+        bool number = ( end > word.c_str() && *end == 0 );
+        if ( k >= row.size() )
+            row.push_back(Cell{word, number, count_digits(word), (int)(e-w), 0, 0, 0});
+        Cell & c = row[k++];
+        if ( number && c.number )
+        {
+            // Welford's online algorithm:
+            c.cnt += 1;
+            double d = x - c.mean;
+            c.mean += d / c.cnt;
+            c.sum2 += d * ( x - c.mean );
+        }
+    }
+}
+
+
+void ReportAverage::add(std::istream& is)
+{
+    std::string str;
+    size_t n = 0;
+    while ( std::getline(is, str) )
+    {
+        if ( n >= lines_.size() )
+            lines_.resize(n+1);
+        addLine(lines_[n++], str);
+    }
+    ++count_;
+}
+
+
+int ReportAverage::add(std::string const& path)
+{
+    std::ifstream is(path.c_str());
+    if ( !is.good() )
+        return 1;
+    add(is);
+    return 0;
+}
+
+
+void ReportAverage::write(std::ostream& os, bool dev) const
+{
+    os << "% " << ( dev ? "standard deviation" : "mean" ) << " of " << count_ << " reports\n";
+    for ( std::vector<Cell> const& row : lines_ )
+    {
+        for ( size_t k = 0; k < row.size(); ++k )
+        {
+            Cell const& c = row[k];
+            int w = c.width;
+            if ( c.number && c.cnt > 0 )
+            {
+                double x = c.mean;
+                if ( dev )
+                    x = ( c.cnt > 1 ) ? std::sqrt(c.sum2 / ( c.cnt - 1 )) : 0;
+                os << std::fixed << std::setprecision(std::max(c.digits, 3))
+                   << std::setw(w) << x;
+            }
+            else if ( k > 0 )
+                os << std::setw(w) << c.word;
+            else
+                os << std::left << std::setw(w) << c.word << std::right;
+        }
+        os << '\n';
+    }
+}
@@ -0,0 +1,62 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef REPORT_AVERAGE_H
+#define REPORT_AVERAGE_H
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+
+/// Calculates the mean and variance of reports made by many simulations
+/**
+ The reports should have the same layout, as made by identical simulations
+ that differ only by their random seed. The numbers found at the same line and
+ the same column are combined online, using Welford's algorithm, such that the
+ reports can be discarded after they were added.
+ Comment lines starting with '%', and words that are not numbers, are copied
+ from the first report. A line or a column that is missing from a report
+ is simply not included in the statistics of this cell.
+ */
+class ReportAverage
+{
+    /// a word of the report, which may be a number
+    struct Cell
+    {
+        std::string word;  ///< characters of the first report
+        bool  number;      ///< true if `word` is a number
+        int   digits;      ///< number of digits after the decimal point
+        int   width;       ///< number of characters, including preceding spaces
+        size_t cnt;        ///< number of values
+        double mean;       ///< mean of the values
+        double sum2;       ///< sum of squared differences to the mean
+    };
+    
+    /// cells of each line of the report
+    std::vector< std::vector<Cell> > lines_;
+    
+    /// number of reports added
+    size_t count_;
+    
+    /// include the words of `str` into line `row`
+    void addLine(std::vector<Cell>& row, std::string const& str);
+
+public:
+    
+    /// constructor
+    ReportAverage() : count_(0) {}
+    
+    /// number of reports added
+    size_t count() const { return count_; }
+    
+    /// include the report read from `is`
+    void add(std::istream& is);
+    
+    /// include the report in file `path`, returning 0 if successful
+    int  add(std::string const& path);
+    
+    /// print the mean, or the standard deviation if `dev`, in the layout of the reports
+    void write(std::ostream&, bool dev) const;
+};
+
+#endif
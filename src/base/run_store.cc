@@ -0,0 +1,144 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#include "run_store.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/uio.h>
+
+
+/**
+ The header and the data are written with one call to writev(), on a file opened
+ with O_APPEND and locked with flock(), to keep the chunks of concurrent runs apart.
+ */
+int RunStore::append(std::string const& path, std::string const& run, const char kind[], const char* data, size_t size)
+{
+    int fd = open(path.c_str(), O_WRONLY|O_APPEND|O_CREAT, 0644);
+    if ( fd < 0 )
+        return 1;
+    char head[256];
+    int len = snprintf(head, sizeof(head), "#run %s %s %zu\n", run.c_str(), kind, size);
+    if ( len <= 0 || len >= (int)sizeof(head) )
+    {
+        close(fd);
+        return 2;
+    }
+    struct iovec vec[3] = { { head, (size_t)len }, { (void*)data, size }, { (void*)"\n", 1 } };
+    size_t all = len + size + 1;
+    int res = 0;
+    flock(fd, LOCK_EX);
+    ssize_t cnt = writev(fd, vec, 3);
+    if ( cnt < 0 || (size_t)cnt != all )
+        res = 3;
+    flock(fd, LOCK_UN);
+    if ( close(fd) )
+        res = 4;
+    return res;
+}
+
+
+/**
+ The chunks are self-contained, and the file `src` is copied as a whole, with
+ the store locked, such that a simulation can write its chunks to a local disk
+ and access the shared store only once, at the end.
+ */
+int RunStore::transfer(std::string const& src, std::string const& path)
+{
+    FILE * in = fopen(src.c_str(), "rb");
+    if ( !in )
+        return 1;
+    int fd = open(path.c_str(), O_WRONLY|O_APPEND|O_CREAT, 0644);
+    if ( fd < 0 )
+    {
+        fclose(in);
+        return 1;
+    }
+    int res = 0;
+    char buf[1<<16];
+    flock(fd, LOCK_EX);
+    size_t cnt;
+    while ( 0 < ( cnt = fread(buf, 1, sizeof(buf), in) ))
+    {
+        if ( write(fd, buf, cnt) != (ssize_t)cnt )
+        {
+            res = 3;
+            break;
+        }
+    }
+    if ( ferror(in) )
+        res = 2;
+    flock(fd, LOCK_UN);
+    if ( close(fd) )
+        res = 4;
+    fclose(in);
+    return res;
+}
+
+
+/**
+ Only the header lines are read, and the data of the chunks are skipped.
+ A chunk that is truncated, at the end of the file, is ignored.
+ */
+size_t RunStore::scan(std::string const& path)
+{
+    path_ = path;
+    chunks_.clear();
+    FILE * file = fopen(path.c_str(), "rb");
+    if ( !file )
+        return 0;
+    fseeko(file, 0, SEEK_END);
+    off_t end = ftello(file);
+    fseeko(file, 0, SEEK_SET);
+    char buf[512];
+    while ( fgets(buf, sizeof(buf), file) )
+    {
+        char run[256], kind[32];
+        size_t size = 0;
+        if ( 3 != sscanf(buf, "#run %255s %31s %zu", run, kind, &size) )
+            continue;
+        Chunk c = { run, kind, ftello(file), size };
+        if ( c.offset + (off_t)size > end )
+            break;
+        chunks_.push_back(c);
+        fseeko(file, c.offset + (off_t)size, SEEK_SET);
+    }
+    fclose(file);
+    return chunks_.size();
+}
+
+
+std::vector<std::string> RunStore::runs() const
+{
+    std::vector<std::string> res;
+    for ( Chunk const& c : chunks_ )
+        if ( std::find(res.begin(), res.end(), c.run) == res.end() )
+            res.push_back(c.run);
+    return res;
+}
+
+
+std::vector<RunStore::Chunk> RunStore::find(std::string const& run, std::string const& kind) const
+{
+    std::vector<Chunk> res;
+    for ( Chunk const& c : chunks_ )
+        if ( c.run == run && c.kind == kind )
+            res.push_back(c);
+    return res;
+}
+
+
+int RunStore::read(Chunk const& c, std::string& res) const
+{
+    FILE * file = fopen(path_.c_str(), "rb");
+    if ( !file )
+        return 1;
+    res.resize(c.size);
+    int err = 0;
+    if ( fseeko(file, c.offset, SEEK_SET) || ( c.size && c.size != fread(&res[0], 1, c.size, file) ))
+        err = 2;
+    fclose(file);
+    return err;
+}
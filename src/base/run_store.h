@@ -0,0 +1,82 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef RUN_STORE_H
+#define RUN_STORE_H
+
+#ifndef _FILE_OFFSET_BITS
+#  define _FILE_OFFSET_BITS 64
+#endif
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+
+/// A file shared by many simulations, holding the output of each run as chunks
+/**
+ A RunStore replaces the small files written by each simulation (objects.cmo,
+ properties.cmo and messages.cmo) by chunks appended to one shared file.
+ This is useful for parameter sweeps, where many simulations are run in the
+ same directory tree. Each chunk is preceded by a line:
+
+     #run RUN KIND SIZE
+
+ where RUN identifies the simulation, KIND is `frame`, `properties` or `messages`,
+ and SIZE is the number of bytes that follow. A `frame` chunk is a complete frame,
+ as it would be written to the trajectory file, and compressed if the
+ simulation specified `frame_compression`.
+
+ Each chunk is written by a single call to write(), with the file locked,
+ such that simulations running concurrently can share the same store.
+ The chunks of a run are in the order in which they were written.
+ See `tools/runs.cc` to extract a run or to report on all runs.
+ */
+class RunStore
+{
+public:
+
+    /// position of a chunk in the store
+    struct Chunk
+    {
+        std::string run;   ///< identity of the run
+        std::string kind;  ///< type of data
+        off_t offset;      ///< position of the data in the file
+        size_t size;       ///< number of bytes of data
+    };
+
+private:
+
+    /// name of the file
+    std::string path_;
+
+    /// all the chunks found in the file
+    std::vector<Chunk> chunks_;
+
+public:
+
+    /// append a chunk to the store `path`, returning 0 if successful
+    static int append(std::string const& path, std::string const& run, const char kind[], const char* data, size_t size);
+
+    /// append all the chunks of the store `src` to the store `path`, returning 0 if successful
+    static int transfer(std::string const& src, std::string const& path);
+
+    /// constructor
+    RunStore() {}
+
+    /// list the chunks of the store `path`, returning their number
+    size_t scan(std::string const& path);
+
+    /// all the chunks, in the order of the file
+    std::vector<Chunk> const& chunks() const { return chunks_; }
+
+    /// identities of the runs, in the order of their first chunk
+    std::vector<std::string> runs() const;
+
+    /// chunks of the given run and kind, in the order of the file
+    std::vector<Chunk> find(std::string const& run, std::string const& kind) const;
+
+    /// read the data of a chunk into `res`, returning 0 if successful
+    int read(Chunk const&, std::string& res) const;
+};
+
+#endif
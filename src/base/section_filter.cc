@@ -0,0 +1,92 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#include "section_filter.h"
+#include "zipper.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cctype>
+#include <cstring>
+
+
+SectionFilter::SectionFilter(std::string const& list, bool keep)
+: keep_(keep)
+{
+    size_t s = 0;
+    while ( s < list.size() )
+    {
+        size_t e = list.find(',', s);
+        if ( e == std::string::npos )
+            e = list.size();
+        if ( e > s )
+            names_.push_back(list.substr(s, e-s));
+        s = e + 1;
+    }
+}
+
+
+bool SectionFilter::pass(const char* str, size_t len) const
+{
+    // the final section marks the end of the content:
+    if ( len == 3 && 0 == strncmp(str, "end", 3) )
+        return true;
+    for ( std::string const& n : names_ )
+        if ( 0 == n.compare(0, std::string::npos, str, len) )
+            return keep_;
+    return !keep_;
+}
+
+
+void SectionFilter::filter(std::string& res, const char* ptr, const char* end) const
+{
+    const char tag[] = "\n#section ";
+    const char del[] = "\n#delete ";
+    while ( ptr < end )
+    {
+        const char * s = std::search(ptr, end, tag, tag+10);
+        if ( s == end )
+            break;
+        const char * n = s + 10;
+        const char * e = n;
+        while ( e < end && !isspace(*e) )
+            ++e;
+        if ( pass(n, e-n) )
+        {
+            res.append(ptr, n-ptr);
+            ptr = n;
+        }
+        else
+        {
+            res.append(ptr, s-ptr);
+            // the section ends with the next section, or the list of deleted objects:
+            ptr = std::min(std::search(e, end, tag, tag+10), std::search(e, end, del, del+9));
+        }
+    }
+    res.append(ptr, end-ptr);
+}
+
+
+int SectionFilter::filterFrame(std::string& res, std::string const& frame) const
+{
+    const char * ptr = frame.data();
+    const char * end = ptr + frame.size();
+    const char def[] = "\n#deflate ";
+    const char * s = std::search(ptr, end, def, def+10);
+    if ( s == end )
+    {
+        filter(res, ptr, end);
+        return 0;
+    }
+    // "#deflate SIZE CHUNK" is followed by the compressed chunk:
+    char * e = nullptr;
+    size_t len = strtoul(s+10, &e, 10);
+    size_t cnt = strtoul(e, &e, 10);
+    if ( *e != '\n' || e + 1 + cnt > end )
+        return 1;
+    std::string tmp(len, 0);
+    if ( Zipper::inflate(&tmp[0], len, e+1, cnt) )
+        return 2;
+    res.append(ptr, s-ptr);
+    filter(res, tmp.data(), tmp.data()+len);
+    res.append(e+1+cnt, end-(e+1+cnt));
+    return 0;
+}
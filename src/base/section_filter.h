@@ -0,0 +1,45 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef SECTION_FILTER_H
+#define SECTION_FILTER_H
+
+#include <string>
+#include <vector>
+
+
+/// Removes the sections of some classes from the frames of a trajectory file
+/**
+ SectionFilter works on the bytes of a frame, as written by Simul::writeObjects(),
+ without decoding the objects: only the "#section" tags are parsed, and
+ a section extends until the next tag "#section" or "#delete".
+ The sections of the listed classes are either kept or removed, and the
+ other lines of the frame (header, time, end) are always kept.
+ The content of a compressed frame is inflated, and written uncompressed.
+ */
+class SectionFilter
+{
+    /// names of the classes
+    std::vector<std::string> names_;
+    
+    /// if true, only the sections of the listed classes are kept
+    bool keep_;
+    
+    /// true if the section named by the `len` characters at `str` should be kept
+    bool pass(const char* str, size_t len) const;
+    
+    /// append to `res` the content in [ptr, end), without the sections that do not pass
+    void filter(std::string& res, const char* ptr, const char* end) const;
+
+public:
+    
+    /// filter the classes in comma-separated `list`, keeping only them if `keep`, or removing them
+    SectionFilter(std::string const& list, bool keep);
+    
+    /// true if no section would be removed
+    bool empty() const { return names_.empty() && !keep_; }
+    
+    /// append to `res` the filtered `frame`, returning 0 if successful
+    int  filterFrame(std::string& res, std::string const& frame) const;
+};
+
+#endif
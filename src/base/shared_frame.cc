@@ -0,0 +1,194 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#include "shared_frame.h"
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/// identifies a segment written by SharedFrame
+static const char MAGIC[8] = "cytoshm";
+
+/// initial size of the slots, in bytes
+static const size_t CAPACITY = 1 << 22;
+
+
+SharedFrame::~SharedFrame()
+{
+    if ( head_ && owner_ )
+    {
+        head_->stale.store(1, std::memory_order_release);
+        unmap();
+        shm_unlink(name_.c_str());
+    }
+    else
+        unmap();
+}
+
+
+/**
+ The writer replaces any segment of the same name, which might remain from a
+ previous simulation. The magic string is written last, such that a reader
+ will not use a segment that is not yet initialized.
+ */
+int SharedFrame::map(size_t capacity)
+{
+    int fd;
+    if ( capacity > 0 )
+    {
+        shm_unlink(name_.c_str());
+        fd = shm_open(name_.c_str(), O_RDWR|O_CREAT|O_EXCL, 0644);
+        if ( fd < 0 )
+            return 1;
+        size_ = sizeof(Header) + 2 * capacity;
+        if ( ftruncate(fd, size_) )
+        {
+            close(fd);
+            shm_unlink(name_.c_str());
+            return 2;
+        }
+    }
+    else
+    {
+        fd = shm_open(name_.c_str(), O_RDONLY, 0);
+        if ( fd < 0 )
+            return 1;
+        struct stat st;
+        if ( fstat(fd, &st) || (size_t)st.st_size < sizeof(Header) )
+        {
+            close(fd);
+            return 2;
+        }
+        size_ = st.st_size;
+    }
+
+    const int prot = capacity ? PROT_READ|PROT_WRITE : PROT_READ;
+    void * ptr = mmap(nullptr, size_, prot, MAP_SHARED, fd, 0);
+    close(fd);
+    if ( ptr == MAP_FAILED )
+        return 3;
+    head_ = static_cast<Header*>(ptr);
+
+    if ( capacity > 0 )
+    {
+        // the memory provided by ftruncate() is filled with zeros:
+        head_->capacity = capacity;
+        memcpy(head_->magic, MAGIC, sizeof(MAGIC));
+    }
+    else if ( memcmp(head_->magic, MAGIC, sizeof(MAGIC)) || size_ < sizeof(Header) + 2 * head_->capacity )
+    {
+        unmap();
+        return 4;
+    }
+    return 0;
+}
+
+
+void SharedFrame::unmap()
+{
+    if ( head_ )
+        munmap(head_, size_);
+    head_ = nullptr;
+    size_ = 0;
+}
+
+
+int SharedFrame::create(std::string const& name)
+{
+    name_ = ( name.size() && name[0] == '/' ) ? name : "/" + name;
+    owner_ = true;
+    return map(CAPACITY);
+}
+
+
+/**
+ The segment might not exist yet, in which case read() will try again to open it
+ */
+int SharedFrame::attach(std::string const& name)
+{
+    name_ = ( name.size() && name[0] == '/' ) ? name : "/" + name;
+    owner_ = false;
+    return map(0);
+}
+
+
+/**
+ This does not wait for the readers, which must check the sequence number
+ of the slot after copying it.
+ */
+int SharedFrame::publish(std::string const& properties, const char* frame, size_t size)
+{
+    if ( !head_ || !owner_ )
+        return 1;
+
+    const size_t all = properties.size() + size;
+    if ( all > head_->capacity )
+    {
+        head_->stale.store(1, std::memory_order_release);
+        unmap();
+        if ( map(2 * all) )
+            return 2;
+    }
+
+    const unsigned s = 1 - head_->latest.load(std::memory_order_relaxed);
+    const uint64_t n = ++count_;
+    head_->seq[s].store(2*n-1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    char * dst = slot(s);
+    memcpy(dst, properties.data(), properties.size());
+    memcpy(dst+properties.size(), frame, size);
+    head_->split[s] = properties.size();
+    head_->size[s] = all;
+
+    head_->seq[s].store(2*n, std::memory_order_release);
+    head_->latest.store(s, std::memory_order_release);
+    return 0;
+}
+
+
+/**
+ The copy is attempted a few times, if the writer modified the slot meanwhile.
+ If the segment was replaced, the new segment is mapped and `stamp` is reset.
+ */
+int SharedFrame::read(uint64_t& stamp, std::string& properties, std::string& frame)
+{
+    if ( head_ && head_->stale.load(std::memory_order_acquire) )
+        unmap();
+
+    if ( !head_ )
+    {
+        if ( map(0) )
+            return 1;
+        stamp = 0;
+    }
+
+    for ( int n = 0; n < 4; ++n )
+    {
+        const unsigned s = head_->latest.load(std::memory_order_acquire);
+        const uint64_t q = head_->seq[s].load(std::memory_order_acquire);
+        if ( q == 0 || q == stamp )
+            return 2;
+        if ( q & 1 )
+            continue;
+
+        const uint64_t split = head_->split[s];
+        const uint64_t size = head_->size[s];
+        if ( split > size || size > head_->capacity )
+            continue;
+
+        const char * src = slot(s);
+        properties.assign(src, split);
+        frame.assign(src+split, size-split);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ( head_->seq[s].load(std::memory_order_relaxed) == q )
+        {
+            stamp = q;
+            return 0;
+        }
+    }
+    return 3;
+}
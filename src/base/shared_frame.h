@@ -0,0 +1,92 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef SHARED_FRAME_H
+#define SHARED_FRAME_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+
+/// A POSIX shared memory segment holding the last state published by a simulation
+/**
+ The segment contains a header and two slots. Each slot holds a snapshot made
+ of the properties, as written in `properties.cmo`, followed by a frame, as
+ written in the trajectory file. The writer fills the slot that was not published
+ last, and then publishes it, such that it never waits for the readers.
+
+ Each slot is protected by a sequence number, which is odd while the slot is
+ being written. A reader copies the last published slot, and discards its copy
+ if the sequence number has changed meanwhile. A snapshot is identified by its
+ sequence number, which increases with each publication.
+
+ If a snapshot does not fit in the slots, the writer creates a new segment with
+ the same name, and marks the old one as stale, such that the readers map the
+ new segment at their next attempt.
+ */
+class SharedFrame
+{
+    /// the start of the segment
+    struct Header
+    {
+        char magic[8];                    ///< identifies the segment
+        std::atomic<uint32_t> stale;      ///< set if the segment was replaced
+        std::atomic<uint32_t> latest;     ///< index of the slot published last
+        uint64_t capacity;                ///< size of each slot in bytes
+        std::atomic<uint64_t> seq[2];     ///< sequence number of each slot, odd during writing
+        uint64_t split[2];                ///< size of the properties in each slot
+        uint64_t size[2];                 ///< total size of the snapshot in each slot
+    };
+
+    /// name of the segment
+    std::string name_;
+
+    /// address of the mapped segment
+    Header * head_;
+
+    /// size of the mapped segment
+    size_t size_;
+
+    /// number of snapshots published
+    uint64_t count_;
+
+    /// true if the segment was created by this object
+    bool owner_;
+
+    /// address of slot `s`
+    char * slot(unsigned s) const { return reinterpret_cast<char*>(head_+1) + s * head_->capacity; }
+
+    /// map the segment, creating it with slots of `capacity` bytes if `capacity > 0`
+    int map(size_t capacity);
+
+    /// unmap the segment
+    void unmap();
+
+    /// disabled copy constructor
+    SharedFrame(SharedFrame const&);
+
+    /// disabled assignment operator
+    SharedFrame& operator = (SharedFrame const&);
+
+public:
+
+    /// constructor
+    SharedFrame() : head_(nullptr), size_(0), count_(0), owner_(false) {}
+
+    /// destructor, which removes the segment if it was created by this object
+    ~SharedFrame();
+
+    /// create the segment `name` to publish snapshots, returning 0 if successful
+    int create(std::string const& name);
+
+    /// open the existing segment `name` to read snapshots, returning 0 if successful
+    int attach(std::string const& name);
+
+    /// publish a snapshot, returning 0 if successful
+    int publish(std::string const& properties, const char* frame, size_t size);
+
+    /// copy the last snapshot if it is newer than `stamp`, returning 0 if a snapshot was copied
+    int read(uint64_t& stamp, std::string& properties, std::string& frame);
+};
+
+#endif
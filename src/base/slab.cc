@@ -0,0 +1,86 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#include "slab.h"
+#include <new>
+#include <iomanip>
+#include <iostream>
+
+
+Slab::Slab(const char name[])
+: name_(name)
+{
+    for ( size_t i = 0; i < NB_SIZES; ++i )
+    {
+        free_[i] = nullptr;
+        used_[i] = 0;
+        made_[i] = 0;
+    }
+}
+
+
+/**
+ If some objects were not released, the blocks are not freed, since these objects
+ might still be deleted later, eg. during the destruction of static variables.
+ */
+Slab::~Slab()
+{
+    for ( size_t i = 0; i < NB_SIZES; ++i )
+        if ( used_[i] )
+            return;
+    for ( void * b : blocks_ )
+        ::operator delete(b);
+}
+
+
+/**
+ The slots of the block are linked in the order of their address,
+ such that consecutive allocations return consecutive slots.
+ */
+void Slab::grow(size_t inx)
+{
+    const size_t size = inx * ALIGN;
+    const size_t cnt = BLOCK / size;
+    char * blk = static_cast<char*>(::operator new(cnt * size));
+    blocks_.push_back(blk);
+    Slot * next = free_[inx];
+    for ( size_t n = cnt; n-- > 0; )
+    {
+        Slot * s = reinterpret_cast<Slot*>(blk + n * size);
+        s->next = next;
+        next = s;
+    }
+    free_[inx] = next;
+    made_[inx] += cnt;
+}
+
+
+size_t Slab::count() const
+{
+    long res = 0;
+    for ( size_t i = 0; i < NB_SIZES; ++i )
+        res += used_[i];
+    return (size_t)res;
+}
+
+
+size_t Slab::memory() const
+{
+    size_t res = 0;
+    for ( size_t i = 0; i < NB_SIZES; ++i )
+        res += made_[i] * i * ALIGN;
+    return res;
+}
+
+
+void Slab::report(std::ostream& os) const
+{
+    for ( size_t i = 0; i < NB_SIZES; ++i )
+    {
+        if ( made_[i] )
+        {
+            os << '\n' << std::left << std::setw(10) << name_ << std::right;
+            os << std::setw(10) << i * ALIGN << std::setw(10) << used_[i];
+            os << std::setw(10) << made_[i] << std::setw(10) << ( made_[i] * i * ALIGN ) / 1024;
+        }
+    }
+}
@@ -0,0 +1,105 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <cstddef>
+#include <vector>
+#include <iosfwd>
+
+
+/// Allocates objects of similar sizes in large blocks, and recycles their memory
+/**
+ The memory is obtained by blocks of 64 KB, divided into slots of one size,
+ which is a multiple of 32 bytes to preserve the alignment of operator new.
+ The slots released are kept in a list for each size, and are reused first,
+ such that objects created together are also close in memory.
+ Objects larger than 2 KB are allocated by the global operator new.
+ 
+ The blocks are only returned to the system when the Slab is destroyed,
+ and only if all its objects were released. A Slab is not thread-safe,
+ and each thread running a simulation should thus use its own Slab.
+
+ A class uses a Slab by defining:
+
+     static void* operator new(size_t s) { return slab.allocate(s); }
+     static void operator delete(void* p, size_t s) { slab.release(p, s); }
+
+ */
+class Slab
+{
+    /// granularity of the sizes
+    static constexpr size_t ALIGN = 32;
+    
+    /// number of sizes handled
+    static constexpr size_t NB_SIZES = 64;
+    
+    /// size of the blocks
+    static constexpr size_t BLOCK = 1 << 16;
+    
+    /// a free slot, holding the address of the next free slot
+    struct Slot { Slot * next; };
+    
+    /// list of free slots, for each size
+    Slot * free_[NB_SIZES];
+    
+    /// number of slots in use, for each size
+    long used_[NB_SIZES];
+    
+    /// number of slots made, for each size
+    size_t made_[NB_SIZES];
+    
+    /// blocks obtained from the system
+    std::vector<void*> blocks_;
+    
+    /// name used in reports
+    const char * name_;
+    
+    /// add a block of slots of size `inx * ALIGN`
+    void grow(size_t inx);
+
+public:
+    
+    /// constructor
+    explicit Slab(const char name[]);
+    
+    /// destructor
+    ~Slab();
+    
+    /// memory for an object of `size` bytes
+    void * allocate(size_t size)
+    {
+        size_t inx = ( size + ALIGN - 1 ) / ALIGN;
+        if ( inx >= NB_SIZES )
+            return ::operator new(size);
+        if ( !free_[inx] )
+            grow(inx);
+        Slot * s = free_[inx];
+        free_[inx] = s->next;
+        ++used_[inx];
+        return s;
+    }
+    
+    /// recycle the memory of an object of `size` bytes
+    void release(void * ptr, size_t size)
+    {
+        size_t inx = ( size + ALIGN - 1 ) / ALIGN;
+        if ( inx >= NB_SIZES )
+            return ::operator delete(ptr);
+        Slot * s = static_cast<Slot*>(ptr);
+        s->next = free_[inx];
+        free_[inx] = s;
+        --used_[inx];
+    }
+    
+    /// number of objects in use, of all sizes
+    size_t count() const;
+    
+    /// size of the memory obtained from the system, in bytes
+    size_t memory() const;
+    
+    /// print the number of objects and the memory used, for each size
+    void report(std::ostream&) const;
+};
+
+#endif
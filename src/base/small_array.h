@@ -0,0 +1,208 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef SMALL_ARRAY_H
+#define SMALL_ARRAY_H
+
+#include "assert_macro.h"
+#include <utility>
+
+
+/// Array of VAL with inline storage for `N` values
+/**
+ SmallArray<VAL, N> holds up to N values in a buffer that is part of the object,
+ and only allocates memory if more values are added. It is meant for temporary
+ lists that are usually short, such as the segments near a position, where
+ an Array would allocate memory every time it is created.
+ When the buffer is exceeded, the capacity is doubled at each allocation.
+
+ The interface is a subset of the one of Array. As for Array, VAL needs to have
+ a public constructor without argument, and is copied by assignment.
+ */
+template < typename VAL, size_t N >
+class SmallArray
+{
+    static_assert(N > 0, "the inline buffer must hold at least one value");
+
+public:
+
+    /// typedef for the template argument
+    typedef VAL value_type;
+
+    /// iterator class type
+    typedef value_type * iterator;
+
+    /// const iterator class type
+    typedef value_type const* const_iterator;
+
+private:
+
+    /// storage used as long as there are no more than N values
+    VAL buf_[N];
+
+    /// C-array holding the values, equal to `buf_` or allocated
+    VAL * val_;
+
+    /// number of values that can be stored in val_[]
+    size_t alc_;
+
+    /// number of values currently present in the array
+    size_t nbo_;
+
+    /// allocate to hold `alc` values, copying the current values
+    void reallocate(size_t alc)
+    {
+        VAL * val = new VAL[alc];
+        for ( size_t n = 0; n < nbo_; ++n )
+            val[n] = std::move(val_[n]);
+        if ( val_ != buf_ )
+            delete[] val_;
+        val_ = val;
+        alc_ = alc;
+    }
+
+    /// copy the values of `o`
+    void copy(SmallArray const& o)
+    {
+        if ( o.nbo_ > alc_ )
+        {
+            nbo_ = 0;
+            reallocate(o.nbo_);
+        }
+        for ( size_t n = 0; n < o.nbo_; ++n )
+            val_[n] = o.val_[n];
+        nbo_ = o.nbo_;
+    }
+
+    /// take the values of `o`, and its memory if it was allocated
+    void take(SmallArray& o)
+    {
+        if ( o.val_ == o.buf_ )
+        {
+            for ( size_t n = 0; n < o.nbo_; ++n )
+                val_[n] = std::move(o.buf_[n]);
+        }
+        else
+        {
+            val_ = o.val_;
+            alc_ = o.alc_;
+            o.val_ = o.buf_;
+            o.alc_ = N;
+        }
+        nbo_ = o.nbo_;
+        o.nbo_ = 0;
+    }
+
+public:
+
+    /// constructor without allocation
+    SmallArray() : val_(buf_), alc_(N), nbo_(0) {}
+
+    /// copy constructor
+    SmallArray(SmallArray const& o) : val_(buf_), alc_(N), nbo_(0) { copy(o); }
+
+    /// move constructor
+    SmallArray(SmallArray&& o) : val_(buf_), alc_(N), nbo_(0) { take(o); }
+
+    /// destructor
+    ~SmallArray() { if ( val_ != buf_ ) delete[] val_; }
+
+    /// assignment operator
+    SmallArray& operator =(SmallArray const& o)
+    {
+        if ( this != &o )
+            copy(o);
+        return *this;
+    }
+
+    /// move assignment
+    SmallArray& operator =(SmallArray&& o)
+    {
+        if ( this != &o )
+        {
+            if ( val_ != buf_ )
+                delete[] val_;
+            val_ = buf_;
+            alc_ = N;
+            take(o);
+        }
+        return *this;
+    }
+
+    /// number of values
+    size_t size() const { return nbo_; }
+
+    /// true if this array holds no value
+    bool empty() const { return ( nbo_ == 0 ); }
+
+    /// number of values that can be stored without allocation
+    size_t capacity() const { return alc_; }
+
+    /// size of the memory allocated outside the object, in bytes
+    size_t memory() const { return ( val_ != buf_ ) ? alc_ * sizeof(VAL) : 0; }
+
+    /// address of the underlying C-array
+    VAL * data() { return val_; }
+
+    /// address of the underlying C-array
+    VAL const* data() const { return val_; }
+
+    /// pointer to first element
+    iterator begin() const { return val_; }
+
+    /// pointer to a position just past the last element
+    iterator end() const { return val_+nbo_; }
+
+    /// reference to value at index ii
+    VAL & operator[](const size_t ii) const
+    {
+        assert_true( ii < nbo_ );
+        return val_[ii];
+    }
+
+    /// return element at index 0
+    VAL const& front() const { assert_true( 0 < nbo_ ); return val_[0]; }
+
+    /// return last element
+    VAL const& back() const { assert_true( 0 < nbo_ ); return val_[nbo_-1]; }
+
+    /// allocate to hold at least `s` values
+    void reserve(size_t s)
+    {
+        if ( s > alc_ )
+            reallocate(s);
+    }
+
+    /// set size to `s`, allocating if necessary
+    void resize(size_t s)
+    {
+        reserve(s);
+        nbo_ = s;
+    }
+
+    /// set the number of values to zero, keeping the memory
+    void clear() { nbo_ = 0; }
+
+    /// add `v` at the end of this array
+    void push_back(VAL const& v)
+    {
+        if ( nbo_ >= alc_ )
+            reallocate(2*alc_);
+        val_[nbo_++] = v;
+    }
+
+    /// add a value constructed from `args` at the end of this array
+    template < typename... Args >
+    VAL & emplace_back(Args&&... args)
+    {
+        if ( nbo_ >= alc_ )
+            reallocate(2*alc_);
+        VAL& res = val_[nbo_++];
+        res = VAL(std::forward<Args>(args)...);
+        return res;
+    }
+
+    /// remove last element
+    void pop_back() { assert_true( 0 < nbo_ ); --nbo_; }
+};
+
+#endif
@@ -0,0 +1,133 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#include "status_writer.h"
+#include <sys/resource.h>
+#include <chrono>
+#include <cstdio>
+
+
+StatusWriter::StatusWriter(std::string const& path, double period)
+: path_(path), period_(period), want_(false), count_(0), stop_(false)
+{
+    status_.time = 0;
+    status_.end = 0;
+    status_.steps = 0;
+    status_.iterations = 0;
+    writer_ = std::thread(&StatusWriter::run, this);
+}
+
+
+StatusWriter::~StatusWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all();
+    if ( writer_.joinable() )
+        writer_.join();
+}
+
+
+void StatusWriter::submit(Status const& s)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        status_ = s;
+        ++count_;
+        want_.store(false, std::memory_order_relaxed);
+    }
+    cond_.notify_all();
+}
+
+
+/**
+ The rates are calculated over the last interval between two updates.
+ The remaining time is estimated from the rate at which simulated time advances.
+ */
+void StatusWriter::save(Status const& s, double rate, double eta) const
+{
+    std::string tmp = path_ + ".tmp";
+    FILE * file = fopen(tmp.c_str(), "w");
+    if ( !file )
+    {
+        fprintf(stderr, "Error: could not open `%s' for writing\n", tmp.c_str());
+        return;
+    }
+    struct rusage use;
+    long mem = 0;
+    if ( 0 == getrusage(RUSAGE_SELF, &use) )
+    {
+        mem = use.ru_maxrss;
+#ifndef __APPLE__
+        // ru_maxrss is in kilobytes on Linux, but in bytes on macOS:
+        mem *= 1024;
+#endif
+    }
+    fprintf(file, "# HELP cytosim_time_seconds simulated time\n");
+    fprintf(file, "# TYPE cytosim_time_seconds gauge\n");
+    fprintf(file, "cytosim_time_seconds %.6f\n", s.time);
+    fprintf(file, "# HELP cytosim_steps_total number of steps performed\n");
+    fprintf(file, "# TYPE cytosim_steps_total counter\n");
+    fprintf(file, "cytosim_steps_total %lu\n", s.steps);
+    fprintf(file, "# HELP cytosim_steps_per_second steps performed per second of wall-time\n");
+    fprintf(file, "# TYPE cytosim_steps_per_second gauge\n");
+    fprintf(file, "cytosim_steps_per_second %.3f\n", rate);
+    fprintf(file, "# HELP cytosim_solver_iterations iterations of the solver in the last step\n");
+    fprintf(file, "# TYPE cytosim_solver_iterations gauge\n");
+    fprintf(file, "cytosim_solver_iterations %u\n", s.iterations);
+    fprintf(file, "# HELP cytosim_objects number of objects in each class\n");
+    fprintf(file, "# TYPE cytosim_objects gauge\n");
+    for ( auto const& i : s.objects )
+        fprintf(file, "cytosim_objects{class=\"%s\"} %lu\n", i.first.c_str(), i.second);
+    fprintf(file, "# HELP cytosim_memory_peak_bytes peak resident memory\n");
+    fprintf(file, "# TYPE cytosim_memory_peak_bytes gauge\n");
+    fprintf(file, "cytosim_memory_peak_bytes %li\n", mem);
+    fprintf(file, "# HELP cytosim_eta_seconds estimated wall-time to complete the current run\n");
+    fprintf(file, "# TYPE cytosim_eta_seconds gauge\n");
+    fprintf(file, "cytosim_eta_seconds %.0f\n", eta);
+    if ( fclose(file) || rename(tmp.c_str(), path_.c_str()) )
+        fprintf(stderr, "Error writing status file `%s'\n", path_.c_str());
+}
+
+
+/**
+ The writer waits for the simulation to provide new values after each period,
+ which may take longer than the period, if a step is long.
+ */
+void StatusWriter::run()
+{
+    typedef std::chrono::steady_clock clock;
+    const clock::time_point origin = clock::now();
+    const auto period = std::chrono::duration<double>(period_);
+    double last_wall = 0, last_time = 0;
+    size_t last_steps = 0;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while ( !stop_ )
+    {
+        if ( cond_.wait_for(lock, period, [this]{ return stop_; }) )
+            break;
+        const size_t cnt = count_;
+        want_.store(true, std::memory_order_relaxed);
+        cond_.wait(lock, [this, cnt]{ return count_ != cnt || stop_; });
+        if ( count_ == cnt )
+            break;
+        Status s = status_;
+        lock.unlock();
+
+        const double wall = std::chrono::duration<double>(clock::now() - origin).count();
+        const double span = wall - last_wall;
+        double rate = 0, eta = 0;
+        if ( span > 0 && s.steps >= last_steps )
+            rate = ( s.steps - last_steps ) / span;
+        if ( s.time > last_time && s.end > s.time )
+            eta = ( s.end - s.time ) * span / ( s.time - last_time );
+        save(s, rate, eta);
+        last_wall = wall;
+        last_time = s.time;
+        last_steps = s.steps;
+
+        lock.lock();
+    }
+}
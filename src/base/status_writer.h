@@ -0,0 +1,97 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef STATUS_WRITER_H
+#define STATUS_WRITER_H
+
+#include <condition_variable>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <vector>
+
+
+/// Periodically rewrites a file describing the progress of a simulation
+/**
+ A background thread wakes up at regular intervals of wall-time, and raises
+ a flag that is checked by the simulation thread after each step. When this
+ flag is set, the simulation thread copies a few numbers with submit(), and
+ the writer thread formats them and replaces the file. Checking the flag is
+ the only cost for the simulation thread between two updates.
+
+ The file is written in the text format of Prometheus, and replaced atomically
+ with rename(), such that it can be read at any time, for example by the
+ 'textfile' collector of `node_exporter`.
+ */
+class StatusWriter
+{
+public:
+
+    /// values provided by the simulation
+    struct Status
+    {
+        double   time;        ///< simulated time
+        double   end;         ///< simulated time at the end of the current run
+        size_t   steps;       ///< number of steps performed
+        unsigned iterations;  ///< number of iterations of the solver in the last step
+        std::vector<std::pair<std::string, size_t>> objects;  ///< number of objects in each class
+    };
+
+private:
+
+    /// name of the file
+    std::string path_;
+
+    /// interval of wall-time between updates, in seconds
+    double period_;
+
+    /// set by the writer thread when new values are needed
+    std::atomic<bool> want_;
+
+    /// last values submitted
+    Status status_;
+
+    /// number of submissions
+    size_t count_;
+
+    /// flag to stop the writer
+    bool stop_;
+
+    /// protects the variables above
+    std::mutex mutex_;
+
+    /// signals changes of `count_` and `stop_`
+    std::condition_variable cond_;
+
+    /// the writer thread
+    std::thread writer_;
+
+    /// write the file
+    void save(Status const&, double rate, double wall) const;
+
+    /// loop of the writer thread
+    void run();
+
+    /// disabled copy constructor
+    StatusWriter(StatusWriter const&);
+
+    /// disabled assignment operator
+    StatusWriter& operator = (StatusWriter const&);
+
+public:
+
+    /// constructor, which starts the writer thread
+    StatusWriter(std::string const& path, double period);
+
+    /// destructor, which stops the writer thread
+    ~StatusWriter();
+
+    /// true if submit() should be called
+    bool wanted() const { return want_.load(std::memory_order_relaxed); }
+
+    /// provide the current values
+    void submit(Status const&);
+};
+
+#endif
+
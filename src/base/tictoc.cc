@@ -48,7 +48,7 @@ void TicToc::get_date(char * buf, size_t buf_size, bool no_year)
 
 char const* TicToc::date()
 {
-    static char buf[32];
+    thread_local static char buf[32];
     get_date(buf, sizeof(buf));
     return buf;
 }
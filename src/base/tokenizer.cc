@@ -28,23 +28,32 @@ char Tokenizer::block_delimiter(char c)
 std::string Tokenizer::get_line(std::istream& is)
 {
     std::string res;
-    res.reserve(1024);
     std::getline(is, res);
     return res;
 }
 
 
+/**
+ The characters are read from the buffer of the stream, which is faster than
+ calling std::istream::get(), and the state of the stream is set as get() would.
+ */
 int Tokenizer::skip_space(std::istream& is, bool eat_line)
 {
-    int c = is.get();
+    if ( !is.good() )
+    {
+        is.setstate(std::ios::failbit);
+        return EOF;
+    }
+    std::streambuf * buf = is.rdbuf();
+    int c = buf->sgetc();
     while ( isspace(c) )
     {
         if ( c == '\n' && ! eat_line )
             break;
-        c = is.get();
+        c = buf->snextc();
     }
-    if ( c != EOF )
-        is.unget();
+    if ( c == EOF )
+        is.setstate(std::ios::eofbit|std::ios::failbit);
     return c;
 }
 
@@ -76,15 +85,20 @@ int Tokenizer::get_character(std::istream& is, bool eat_space, bool eat_line)
 std::string get_stuff(std::istream& is, bool (*valid)(int))
 {
     std::string res;
-    res.reserve(64);
-    int c = is.get();
+    if ( !is.good() )
+    {
+        is.setstate(std::ios::failbit);
+        return res;
+    }
+    std::streambuf * buf = is.rdbuf();
+    int c = buf->sgetc();
     while ( valid(c) )
     {
         res.push_back((char)c);
-        c = is.get();
+        c = buf->snextc();
     }
-    if ( c != EOF )
-        is.unget();
+    if ( c == EOF )
+        is.setstate(std::ios::eofbit|std::ios::failbit);
     return res;
 }
 
@@ -488,6 +502,35 @@ std::string Tokenizer::get_token(std::istream& is, bool eat_line)
 
 //------------------------------------------------------------------------------
 
+/**
+ Append the characters of the block to `res`, until `c_out` is found.
+ The characters are read directly from the buffer of the stream, and nested
+ blocks are appended to the same string, to avoid creating temporary strings.
+ */
+static void append_block(std::istream& is, std::string& res, const char c_in, const char c_out)
+{
+    std::streambuf * buf = is.rdbuf();
+    int c = buf->sbumpc();
+    while ( c != EOF )
+    {
+        if ( c == c_out )
+            return;
+        char d = Tokenizer::block_delimiter((char)c);
+        res.push_back((char)c);
+        if ( d )
+        {
+            append_block(is, res, (char)c, d);
+            res.push_back(d);
+        }
+        else if ( c == ')' || c == '}' )
+            throw InvalidSyntax("unclosed delimiter '"+std::string(1,c_in)+"'");
+        c = buf->sbumpc();
+    }
+    is.setstate(std::ios::eofbit|std::ios::failbit);
+    throw InvalidSyntax("missing '"+std::string(1,c_out)+"'");
+}
+
+
 /**
  This will read a block, assuming that opening delimiter has been read already.
  It will read characters until the given closing delimiter `c_out` is found.
@@ -500,41 +543,18 @@ std::string Tokenizer::get_block_text(std::istream& is, char c_in, const char c_
 {
     assert_true(c_out);
     std::string res;
-    res.reserve(16384);
-    char c = 0;
     
     if ( c_in )
         res.push_back(c_in);
-    is.get(c);
     
-    while ( is.good() )
-    {
-        if ( c == c_out )
-        {
-            if ( c_in )
-                return res+c;
-            else
-                return res;
-        }
-        else if ( block_delimiter(c) )
-            res.append( get_block_text(is, c, block_delimiter(c)) );
-        else if ( c == ')' || c == '}' )
-            throw InvalidSyntax("unclosed delimiter '"+std::string(1,c_in)+"'");
-#if ( 0 )
-        else if ( c == COMMENT_START )
-        {
-            // Read comments as lines, to inactivate symbols within: ')' and '}'
-            std::string line;
-            std::getline(is, line);
-        }
-#endif
-        else
-            res.push_back(c);
-        is.get(c);
-    }
+    std::istream::sentry s(is, true);
+    if ( !s )
+        throw InvalidSyntax("missing '"+std::string(1,c_out)+"'");
+    append_block(is, res, c_in, c_out);
     
-    throw InvalidSyntax("missing '"+std::string(1,c_out)+"'");
-    return "";
+    if ( c_in )
+        res.push_back(c_out);
+    return res;
 }
 
 
@@ -602,7 +622,6 @@ std::string Tokenizer::strip_block(std::string const& arg)
 std::string Tokenizer::get_until(std::istream& is, std::string what)
 {
     std::string res;
-    res.reserve(16384);
     unsigned d = 0;
     char c = 0;
     is.get(c);
@@ -0,0 +1,30 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#include "zipper.h"
+
+// avoid the definitions of `compress` and `uncompress` as macros:
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+#include "miniz.h"
+
+
+int Zipper::deflate(std::string& res, const void* src, size_t size, int level)
+{
+    mz_ulong len = mz_compressBound(size);
+    res.resize(len);
+    int err = mz_compress2((unsigned char*)&res[0], &len, (const unsigned char*)src, size, level);
+    if ( err != MZ_OK )
+    {
+        res.clear();
+        return 1;
+    }
+    res.resize(len);
+    return 0;
+}
+
+
+int Zipper::inflate(void* dst, size_t cap, const void* src, size_t size)
+{
+    mz_ulong len = cap;
+    int err = mz_uncompress((unsigned char*)dst, &len, (const unsigned char*)src, size);
+    return ( err != MZ_OK || len != cap );
+}
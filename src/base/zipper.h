@@ -0,0 +1,19 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef ZIPPER_H
+#define ZIPPER_H
+
+#include <string>
+
+
+/// Compression of buffers with the DEFLATE algorithm, using miniz (src/disp/miniz.c)
+namespace Zipper
+{
+    /// compress `size` bytes of `src` at `level` (1 to 9), setting `res`; returns 0 if successful
+    int deflate(std::string& res, const void* src, size_t size, int level);
+    
+    /// decompress `size` bytes of `src` into `dst` of capacity `cap`; returns 0 if exactly `cap` bytes were produced
+    int inflate(void* dst, size_t cap, const void* src, size_t size);
+}
+
+#endif
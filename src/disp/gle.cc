@@ -28,6 +28,9 @@ namespace gle
     /// vertex buffer objects for icosahedrons
     GLuint ico_buf[8] = { 0 };
     
+    /// vertex buffer object for the disc and the circle
+    GLuint disc_buf[1] = { 0 };
+    
     /// number of faces in icosahedrons
     GLuint ico_nfaces[4] = { 0 };
     
@@ -125,6 +128,7 @@ namespace gle
         circle(ncircle, co_, si_, 1);
         initializeIcoBuffers();
         initializeTubeBuffers();
+        initializeDiscBuffer();
         std::atexit(release);
     }
     
@@ -139,6 +143,9 @@ namespace gle
         if ( hex_buf[0] && glIsBuffer(hex_buf[0]) )
             glDeleteBuffers(2, hex_buf);
         hex_buf[0] = 0;
+        if ( disc_buf[0] && glIsBuffer(disc_buf[0]) )
+            glDeleteBuffers(1, disc_buf);
+        disc_buf[0] = 0;
     }
     
     //-----------------------------------------------------------------------
@@ -490,6 +497,38 @@ namespace gle
         glEnd();
     }
     
+    /// the center followed by the points of the circle, as used by gleDisc()
+    void initializeDiscBuffer()
+    {
+        if ( !glIsBuffer(disc_buf[0]) )
+        {
+            GLfloat pts[2*ncircle+4] = { 0, 0 };
+            for( size_t n = 0; n <= ncircle; ++n )
+            {
+                pts[2*n+2] = co_[n];
+                pts[2*n+3] = si_[n];
+            }
+            glGenBuffers(1, disc_buf);
+            glBindBuffer(GL_ARRAY_BUFFER, disc_buf[0]);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(pts), pts, GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+    }
+    
+    void drawDiscBuffer(GLenum mode, GLint first, GLsizei cnt)
+    {
+        glNormal3f(0, 0, 1);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glBindBuffer(GL_ARRAY_BUFFER, disc_buf[0]);
+        glVertexPointer(2, GL_FLOAT, 0, nullptr);
+        glDrawArrays(mode, first, cnt);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glDisableClientState(GL_VERTEX_ARRAY);
+    }
+    
+    void gleCircleB() { drawDiscBuffer(GL_LINE_LOOP, 1, ncircle+1); }
+    void gleDiscB()   { drawDiscBuffer(GL_TRIANGLE_FAN, 0, ncircle+2); }
+    
     //-----------------------------------------------------------------------
     
     void gleStarS()
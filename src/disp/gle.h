@@ -34,6 +34,9 @@ namespace gle
 
     /// initialize the Vertex Buffer Objects
     void initializeIcoBuffers();
+
+    /// initialize the Vertex Buffer Object of the disc
+    void initializeDiscBuffer();
    
     /// calculate sinus and cosinus for a circle
     void circle(size_t cnt, GLfloat c[], GLfloat s[], GLfloat radius, double start = 0);
@@ -237,8 +240,6 @@ namespace gle
     inline void gleIcosahedronB()  { gleIcosahedron1(); }
     
     inline void gleArrowTailB()    { gleArrowTail1();   }
-    inline void gleCircleB()       { gleCircle();       }
-    inline void gleDiscB()         { gleDisc();         }
     inline void gleCylinderB()     { gleCylinderZ();    }
     inline void gleConeB()         { gleCone1();        }
     inline void gleLongConeB()     { gleLongCone1();    }
@@ -251,6 +252,9 @@ namespace gle
     void gleLongTube2B();
     void gleHexTube1B();
     
+    void gleCircleB();
+    void gleDiscB();
+    
     void gleSphere1B();
     void gleSphere2B();
     void gleSphere4B();
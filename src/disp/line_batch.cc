@@ -0,0 +1,111 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#include "line_batch.h"
+#include "gle_color.h"
+#include "dim.h"
+
+
+LineBatch::~LineBatch()
+{
+    if ( buf_ )
+        glDeleteBuffers(1, &buf_);
+}
+
+
+void LineBatch::clear()
+{
+    pts_.clear();
+    col_.clear();
+    first_.clear();
+    count_.clear();
+}
+
+
+void LineBatch::pack(gle_color const& col, GLubyte res[4])
+{
+    GLfloat const* F = col.data();
+    for ( int d = 0; d < 4; ++d )
+        res[d] = GLubyte(255*F[d]);
+}
+
+
+void LineBatch::add(real const* pts, size_t cnt, gle_color const& color, real tol)
+{
+    GLubyte col[4];
+    pack(color, col);
+    add(pts, cnt, col, 0, tol);
+}
+
+
+void LineBatch::add(real const* pts, size_t cnt, GLubyte const* col, size_t inc, real tol)
+{
+    const size_t n = pts_.size() / 3;
+    pts_.resize(3*(n+cnt));
+    col_.resize(4*(n+cnt));
+    GLfloat * P = pts_.data() + 3 * n;
+    GLubyte * C = col_.data() + 4 * n;
+    const GLfloat tt = GLfloat(tol * tol);
+    
+    size_t k = 0;
+    for ( size_t i = 0; i < cnt; ++i )
+    {
+        GLfloat x = GLfloat(pts[DIM*i]), y = 0, z = 0;
+#if ( DIM > 1 )
+        y = GLfloat(pts[DIM*i+1]);
+#endif
+#if ( DIM > 2 )
+        z = GLfloat(pts[DIM*i+2]);
+#endif
+        // skip the vertices too close to the last one, but not the end of the strip:
+        if ( 0 < k && i+1 < cnt )
+        {
+            GLfloat const* Q = P + 3 * ( k - 1 );
+            GLfloat dx = x - Q[0], dy = y - Q[1], dz = z - Q[2];
+            if ( dx*dx + dy*dy + dz*dz < tt )
+                continue;
+        }
+        P[3*k  ] = x;
+        P[3*k+1] = y;
+        P[3*k+2] = z;
+        GLubyte const* S = col + 4 * inc * i;
+        C[4*k  ] = S[0];
+        C[4*k+1] = S[1];
+        C[4*k+2] = S[2];
+        C[4*k+3] = S[3];
+        ++k;
+    }
+    pts_.truncate(3*(n+k));
+    col_.truncate(4*(n+k));
+    first_.push_back((GLint)n);
+    count_.push_back((GLsizei)k);
+}
+
+
+/**
+ The buffer is reallocated at each frame with GL_STREAM_DRAW, such that the
+ driver does not need to wait for the previous frame to be drawn.
+ */
+void LineBatch::draw()
+{
+    if ( first_.empty() )
+        return;
+    
+    const size_t nbv = pts_.size() / 3;
+    const size_t sep = nbv * 3 * sizeof(GLfloat);
+    
+    if ( !buf_ )
+        glGenBuffers(1, &buf_);
+    glBindBuffer(GL_ARRAY_BUFFER, buf_);
+    glBufferData(GL_ARRAY_BUFFER, sep + nbv * 4 * sizeof(GLubyte), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sep, pts_.data());
+    glBufferSubData(GL_ARRAY_BUFFER, sep, nbv * 4 * sizeof(GLubyte), col_.data());
+    
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, nullptr);
+    glColorPointer(4, GL_UNSIGNED_BYTE, 0, (GLvoid const*)sep);
+    glMultiDrawArrays(GL_LINE_STRIP, first_.data(), count_.data(), (GLsizei)first_.size());
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
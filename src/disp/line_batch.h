@@ -0,0 +1,82 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef LINE_BATCH_H
+#define LINE_BATCH_H
+
+#include "real.h"
+#include "array.h"
+#include "opengl.h"
+
+class gle_color;
+
+
+/// Vertices and colors of many line strips, drawn with a few OpenGL calls
+/**
+ The strips are accumulated in memory by add(), and draw() sends all of them
+ to a vertex buffer object, which is kept from one frame to the next, before
+ drawing them with one call to glMultiDrawArrays(). This replaces the calls
+ glBegin()/glVertex()/glEnd() made for each object, which limit the frame rate
+ in systems with many Fibers. The colors are given per vertex, and the width
+ of the lines must be set before calling draw().
+ When the view is zoomed out, the strips can be simplified by add(), to skip
+ vertices that would be drawn within one pixel of each other.
+ */
+class LineBatch
+{
+    /// coordinates of the vertices, 3 per vertex
+    Array<GLfloat> pts_;
+    
+    /// colors of the vertices, 4 per vertex
+    Array<GLubyte> col_;
+    
+    /// index of the first vertex of each strip
+    Array<GLint>   first_;
+    
+    /// number of vertices of each strip
+    Array<GLsizei> count_;
+    
+    /// name of the OpenGL buffer, or 0 if it was not created yet
+    GLuint         buf_;
+    
+    /// disabled copy constructor
+    LineBatch(LineBatch const&);
+    
+    /// disabled copy assignment
+    LineBatch& operator =(LineBatch const&);
+
+public:
+    
+    /// constructor
+    LineBatch() : buf_(0) {}
+    
+    /// destructor releases the OpenGL buffer
+    ~LineBatch();
+    
+    /// forget all strips, keeping the memory
+    void clear();
+    
+    /// number of strips
+    size_t size() const { return first_.size(); }
+    
+    /// add a strip of `cnt` vertices, stored contiguously in `pts` with DIM values each
+    /**
+     The vertices closer than `tol` from the last vertex added are skipped,
+     except the last one, such that the strip deviates at most by `tol`.
+     */
+    void add(real const* pts, size_t cnt, gle_color const&, real tol = 0);
+    
+    /// add a strip of `cnt` vertices, with the colors of the vertices given in `col`, 4 bytes each
+    /**
+     The color of a skipped vertex is not used. If `inc==0`, all vertices
+     are given the color `col[0,3]`.
+     */
+    void add(real const* pts, size_t cnt, GLubyte const* col, size_t inc, real tol = 0);
+    
+    /// set `res` to the color `col`, as stored in the batch
+    static void pack(gle_color const& col, GLubyte res[4]);
+    
+    /// draw all the strips as GL_LINE_STRIP
+    void draw();
+};
+
+#endif
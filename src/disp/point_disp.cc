@@ -87,7 +87,7 @@ void PointDisp::strokeShape() const
         case 'h': gle::gleHexagonL();   break;
         case 's': gle::gleStarL();      break;
         case '+': gle::glePlusL();      break;
-        case 'c': gle::gleCircle();    break;
+        case 'c': gle::gleCircleB();   break;
         default: break;
     }
 }
@@ -106,7 +106,7 @@ void PointDisp::paintShape() const
         case 's': gle::gleStarS();      break;
         case '+': gle::glePlusS();      break;
         case 'c': break;
-        default:  gle::gleDisc();    break;
+        default:  gle::gleDiscB();   break;
     }
 }
 
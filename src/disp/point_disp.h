@@ -134,7 +134,7 @@ public:
             gle::gleTranslate(pos);
             gle::gleScale(realSize);
             color2.load();
-            gle::gleDisc();
+            gle::gleDiscB();
             glPopMatrix();
         }
     }
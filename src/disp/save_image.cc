@@ -6,6 +6,9 @@
 
 #ifdef DISPLAY
 #  include "opengl.h"
+#  include <string>
+#  include <thread>
+#  include <algorithm>
 #endif
 
 bool SaveImage::supported(const char format[])
@@ -142,6 +145,8 @@ int SaveImage::saveCompositeImage(const int mag,
  This adjusts the Viewport to produce an image with higher resolution.
  The result should be better than saveCompositeImage, but uses more
  memory on the graphic card.
+ The scissor test is enabled with the region of the tile, such that the
+ display function can skip the objects that are outside.
  
  */
 int SaveImage::saveMagnifiedImage(const int mag,
@@ -173,6 +178,9 @@ int SaveImage::saveMagnifiedImage(const int mag,
 
     GLint svp[4];
     glGetIntegerv(GL_VIEWPORT, svp);
+    // the scissor box tells `display` which part of the viewport is visible:
+    glScissor(0, 0, width, height);
+    glEnable(GL_SCISSOR_TEST);
     for ( int iy = 0; iy < mag; ++iy )
         for ( int ix = 0; ix < mag; ++ix )
         {
@@ -185,6 +193,7 @@ int SaveImage::saveMagnifiedImage(const int mag,
                     memcpy(&dst[h*mW*PIX], &sub[h*width*PIX], width*PIX);
             }
         }
+    glDisable(GL_SCISSOR_TEST);
     res = savePixels(filename, format, pixels, mW, mH, downsample);
     free_pixels(pixels);
     //restore original viewport:
@@ -193,6 +202,154 @@ int SaveImage::saveMagnifiedImage(const int mag,
     return res;
 }
 
+//------------------------------------------------------------------------------
+#pragma mark - Asynchronous export
+
+/// an image whose pixels are being transferred to a pixel buffer object
+struct PendingImage
+{
+    FILE *      file;
+    std::string name;
+    std::string format;
+    uint32_t    width, height;
+    int         downsample;
+};
+
+/// two pixel buffer objects, used alternately
+static GLuint pixel_buf[2] = { 0, 0 };
+
+/// size of the pixel buffer objects, in bytes
+static size_t pixel_buf_size[2] = { 0, 0 };
+
+/// images transferred to each pixel buffer object, if `file != nullptr`
+static PendingImage pending[2] = { { nullptr }, { nullptr } };
+
+/// index of the pixel buffer object used next
+static int pixel_buf_next = 0;
+
+/// thread writing the last image
+static std::thread writer;
+
+/// first error encountered by `writer`
+static int writer_error = 0;
+
+
+/// copy the pixels of `img` from pixel buffer `k`, and write them on a thread
+static int writePending(int k)
+{
+    PendingImage img = pending[k];
+    pending[k].file = nullptr;
+    
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buf[k]);
+    void const* ptr = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    uint8_t * pixels = nullptr;
+    if ( ptr )
+    {
+        size_t s = 3 * img.width * img.height;
+        pixels = new_pixels(s);
+        memcpy(pixels, ptr, s);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    if ( !pixels )
+    {
+        fclose(img.file);
+        remove(img.name.c_str());
+        return SaveImage::OPENGL_ERROR;
+    }
+    // only one image is compressed at any time:
+    if ( writer.joinable() )
+        writer.join();
+    writer = std::thread([img, pixels]() mutable
+    {
+        int res = SaveImage::savePixels(img.file, img.format.c_str(), pixels, img.width, img.height, img.downsample);
+        fclose(img.file);
+        free_pixels(pixels);
+        if ( res )
+        {
+            fprintf(SaveImage::err, " error %i while saving %s\n", res, img.name.c_str());
+            remove(img.name.c_str());
+            if ( !writer_error )
+                writer_error = res;
+        }
+    });
+    return 0;
+}
+
+
+/**
+ The pixels are read into one of two pixel buffer objects, such that glReadPixels()
+ returns without waiting for the transfer to complete. The pixels of the previous
+ image are then copied from the other buffer, and written to file by a thread,
+ while the next image is rendered. The file is opened immediately, such that the
+ name is interpreted relative to the current working directory.
+ */
+int SaveImage::saveImageLater(const char * filename,
+                              const char format[],
+                              const int vp[4],
+                              int downsample)
+{
+    FILE * file = openFile(filename);
+    if ( !file )
+        return FILE_ERROR;
+
+    const int k = pixel_buf_next;
+    const size_t s = 3 * vp[2] * vp[3];
+    if ( !pixel_buf[0] )
+        glGenBuffers(2, pixel_buf);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buf[k]);
+    if ( pixel_buf_size[k] != s )
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, s, nullptr, GL_STREAM_READ);
+        pixel_buf_size[k] = s;
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(vp[0], vp[1], vp[2], vp[3], GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    GLenum glError = glGetError();
+    if ( glError != GL_NO_ERROR )
+    {
+        fprintf(err, "Error: could not read pixels (OpenGL error %u)\n", glError);
+        fclose(file);
+        remove(filename);
+        return OPENGL_ERROR;
+    }
+    pending[k] = { file, filename, format, (uint32_t)vp[2], (uint32_t)vp[3], downsample };
+    pixel_buf_next = 1 - k;
+    
+    // write the previous image:
+    if ( pending[1-k].file )
+        return writePending(1-k);
+    return 0;
+}
+
+
+int SaveImage::finishImages()
+{
+    int res = 0;
+    // the older image is in the buffer that is used next:
+    for ( int i = 0; i < 2; ++i )
+    {
+        int k = ( pixel_buf_next + i ) & 1;
+        if ( pending[k].file )
+            res = std::max(res, writePending(k));
+    }
+    if ( writer.joinable() )
+        writer.join();
+    if ( pixel_buf[0] )
+        glDeleteBuffers(2, pixel_buf);
+    pixel_buf[0] = 0;
+    pixel_buf[1] = 0;
+    pixel_buf_size[0] = 0;
+    pixel_buf_size[1] = 0;
+    if ( writer_error )
+        res = writer_error;
+    writer_error = 0;
+    return res;
+}
+
 //------------------------------------------------------------------------------
 #pragma mark - Pixels
 
@@ -86,6 +86,12 @@ namespace SaveImage
     /// save a region of the current buffer in a new file called 'name'. Returns error-code
     int saveImage(const char* name, const char format[], const int viewport[], int downsample=1);
 
+    /// same as saveImage(), but the file is written later, while OpenGL continues. Returns error-code
+    int saveImageLater(const char* name, const char format[], const int viewport[], int downsample=1);
+    
+    /// write the files started by saveImageLater(), which requires the same OpenGL context
+    int finishImages();
+
      /// save an image with higher resolution (better version)
     int saveMagnifiedImage(int mag, const char* name, const char format[], uint32_t width, uint32_t height, void (*display)(int, void *), void* arg, int downsample);
 
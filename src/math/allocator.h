@@ -49,6 +49,9 @@ namespace LinearSolvers
             }
         }
         
+        /// size of the memory allocated, in bytes
+        size_t memory() const { return alc_ * sizeof(real); }
+        
         /// release memory
         void deallocate()
         {
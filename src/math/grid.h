@@ -148,6 +148,7 @@ public:
         
         gCell = new CELL[GRID::nCells];
         GRID::gAllocated = GRID::nCells;
+        advise_huge_pages(gCell, GRID::nCells * sizeof(CELL));
     }
     
     /// returns true if cells have been allocated
@@ -158,6 +159,14 @@ public:
         return 0;
     }
     
+    /// exchange the array of cells with `ptr`, which must have been allocated as in createCells()
+    void swapCells(CELL *& ptr)
+    {
+        CELL * tmp = gCell;
+        gCell = ptr;
+        ptr = tmp;
+    }
+    
     /// deallocate array of cells
     void deleteCells()
     {
@@ -324,6 +324,22 @@ public:
 #endif
     }
     
+    /// true if the grid extends over [inf, sup], with the same edges in the periodic dimensions
+    bool covers(const real inf[ORD], const real sup[ORD]) const
+    {
+        for ( int d = 0; d < ORD; ++d )
+        {
+            if ( isPeriodic(d) )
+            {
+                if ( inf[d] != gInf[d] || sup[d] != gSup[d] )
+                    return false;
+            }
+            else if ( inf[d] < gInf[d] || sup[d] > gSup[d] )
+                return false;
+        }
+        return true;
+    }
+    
     /// true if boundary conditions are periodic
     bool isPeriodic() const
     {
@@ -864,7 +880,7 @@ public:
     /// write some info on the grid
     void printSummary(std::ostream& os, std::string str)
     {
-        os << str << " of dim " << ORD << " has " << gAllocated << " cells:" << std::endl;
+        os << str << " of dim " << ORD << " has " << nbCells() << " cells:" << std::endl;
         for ( unsigned d = 0; d < ORD; ++d )
             os << "     [ " << gInf[d] << " " << gSup[d] << " ] / " << gDim[d] << " = " << cWidth[d] << std::endl;
     }
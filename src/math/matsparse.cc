@@ -121,8 +121,9 @@ real& MatrixSparse::operator()( index_t x, index_t y )
             if ( mxRow[y][ii] == (int)x )
                 return mxCol[y][ii];
         
+        // the column needs space for the new element and the terminal mark:
         if ( mxRow[y][ii] == LAST_IN_COLUMN )
-            allocateColumn( y, ii + 1 );
+            allocateColumn( y, ii + 2 );
         assert_true( mxRow[y][ii] == AVAILABLE_CELL );
         mxRow[y][ii] = x;
         mxCol[y][ii] = 0;
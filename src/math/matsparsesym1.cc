@@ -7,16 +7,17 @@
 #include <iomanip>
 #include <sstream>
 
-#ifdef __SSE3__
+#include "simd.h"
+
+// the 'SSE' code uses vec2, which is also available with ARM's NEON
+#if VEC2_IS_AVAILABLE
 #  define MATRIX1_USES_SSE REAL_IS_DOUBLE
-#  include "simd.h"
 #else
 #  define MATRIX1_USES_SSE 0
 #endif
 
 #ifdef __AVX__
 #  define MATRIX1_USES_AVX REAL_IS_DOUBLE
-#  include "simd.h"
 #else
 #  define MATRIX1_USES_AVX 0
 #endif
@@ -24,10 +25,12 @@
 
 MatrixSparseSymmetric1::MatrixSparseSymmetric1()
 {
+    size_      = 0;
     allocated_ = 0;
     column_    = nullptr;
     col_size_  = nullptr;
     col_max_   = nullptr;
+    kernel_    = 0;
     
 #if MATRIX1_OPTIMIZED_MULTIPLY
     nmax_      = 0;
@@ -332,6 +335,24 @@ bool MatrixSparseSymmetric1::nonZero() const
 }
 
 
+/**
+ Only the columns [start, stop[ of this matrix are modified, such that
+ different threads can add different ranges of columns concurrently.
+ */
+void MatrixSparseSymmetric1::add(MatrixSparseSymmetric1 const& M, index_t start, index_t stop)
+{
+    assert_true( M.size_ <= size_ );
+    stop = std::min(stop, M.size_);
+    for ( index_t jj = start; jj < stop; ++jj )
+    {
+        Element const* col = M.column_[jj];
+        for ( unsigned kk = 0; kk < M.col_size_[jj]; ++kk )
+            if ( col[kk].val != 0 )
+                operator()(col[kk].inx, jj) += col[kk].val;
+    }
+}
+
+
 void MatrixSparseSymmetric1::scale(const real alpha)
 {
     for ( index_t jj = 0; jj < size_; ++jj )
@@ -391,6 +412,33 @@ void MatrixSparseSymmetric1::addDiagonalBlock(real* mat, unsigned ldd,
 }
 
 
+/**
+ This sums the elements of lines and columns that have the same image by `map`,
+ thus reducing the matrix to a smaller one. The result is symmetric and full.
+ */
+void MatrixSparseSymmetric1::addAggregated(real* mat, const unsigned ldd,
+                                           index_t const* map,
+                                           const unsigned dim) const
+{
+    for ( index_t jj = 0; jj < size_; ++jj )
+    {
+        const index_t jm = dim * map[jj];
+        for ( unsigned n = 0; n < col_size_[jj]; ++n )
+        {
+            index_t ii = column_[jj][n].inx;
+            const index_t im = dim * map[ii];
+            const real val = column_[jj][n].val;
+            for ( unsigned d = 0; d < dim; ++d )
+            {
+                mat[im+d+ldd*(jm+d)] += val;
+                if ( jj != ii )
+                    mat[jm+d+ldd*(im+d)] += val;
+            }
+        }
+    }
+}
+
+
 int MatrixSparseSymmetric1::bad() const
 {
     if ( size_ <= 0 ) return 1;
@@ -418,6 +466,65 @@ size_t MatrixSparseSymmetric1::nbElements(index_t start, index_t stop) const
 }
 
 
+/**
+ A column is reduced to twice its size, if it uses less than a quarter of its
+ capacity, such that a column that oscillates in size is not reallocated often.
+ The columns beyond the size of the matrix are released.
+ */
+size_t MatrixSparseSymmetric1::compact()
+{
+    constexpr size_t chunk = 16;
+    size_t res = 0;
+    for ( size_t jj = 0; jj < allocated_; ++jj )
+    {
+        if ( jj >= size_ )
+            col_size_[jj] = 0;
+        size_t cnt = col_size_[jj];
+        if ( col_max_[jj] > chunk && 4 * cnt < col_max_[jj] )
+        {
+            Element * col_new = nullptr;
+            size_t alc = ( 2 * cnt + chunk - 1 ) & ~( chunk - 1 );
+            if ( alc > 0 )
+            {
+                col_new = new Element[alc];
+                copy(cnt, column_[jj], col_new);
+            }
+            delete[] column_[jj];
+            column_[jj]  = col_new;
+            col_max_[jj] = alc;
+            ++res;
+        }
+    }
+#if MATRIX1_OPTIMIZED_MULTIPLY
+    // the compressed storage is made again by prepareForMultiply():
+    if ( nmax_ > 4 * ( nbElements() + size_ ))
+    {
+        delete[] ija_;
+        free_real(sa_);
+        ija_ = nullptr;
+        sa_ = nullptr;
+        nmax_ = 0;
+    }
+#endif
+    return res;
+}
+
+
+size_t MatrixSparseSymmetric1::memory() const
+{
+    size_t res = allocated_ * ( sizeof(Element*) + sizeof(unsigned) + sizeof(size_t) );
+    for ( size_t jj = 0; jj < allocated_; ++jj )
+        res += col_max_[jj] * sizeof(Element);
+#if MATRIX1_USES_COLNEXT
+    res += ( allocated_ + 1 ) * sizeof(index_t);
+#endif
+#if MATRIX1_OPTIMIZED_MULTIPLY
+    res += nmax_ * ( sizeof(index_t) + sizeof(real) );
+#endif
+    return res;
+}
+
+
 std::string MatrixSparseSymmetric1::what() const
 {
     std::ostringstream msg;
@@ -505,6 +612,19 @@ void MatrixSparseSymmetric1::printSparseArray(std::ostream& os) const
 //------------------------------------------------------------------------------
 #pragma mark - Vector Multiplication
 
+bool MatrixSparseSymmetric1::hasKernel(int k)
+{
+    switch ( k )
+    {
+        case 0: return true;
+        case 1: return MATRIX1_OPTIMIZED_MULTIPLY;
+        case 2: return MATRIX1_OPTIMIZED_MULTIPLY && MATRIX1_USES_SSE;
+        case 3: return MATRIX1_OPTIMIZED_MULTIPLY && MATRIX1_USES_AVX;
+    }
+    return false;
+}
+
+
 #if !MATRIX1_OPTIMIZED_MULTIPLY
 
 void MatrixSparseSymmetric1::prepareForMultiply(int)
@@ -999,25 +1119,49 @@ void MatrixSparseSymmetric1::vecMulAdd(const real* X, real* Y, index_t start, in
 }
 
 
-void MatrixSparseSymmetric1::vecMulAddIso2D(const real* X, real* Y, index_t start, index_t stop) const
+template < void (MatrixSparseSymmetric1::*FUNC)(const real*, real*, index_t, real const*, index_t, index_t) const >
+void MatrixSparseSymmetric1::vecMulAddIso2D_(const real* X, real* Y, index_t start, index_t stop) const
 {
-    assert_true( start <= stop );
-    assert_true( stop <= size_ );
-
 #if MATRIX1_USES_COLNEXT
     for ( index_t jj = next_[start]; jj < stop; jj = next_[jj+1] )
 #else
     for ( index_t jj = start; jj < stop; ++jj )
 #endif
     {
+        (this->*FUNC)(X, Y, 2*jj, sa_+jj, ija_[jj], ija_[jj+1]);
+    }
+}
+
+
+/**
+ The kernel is selected by setKernel(). The SIMD kernels are faster for long
+ columns, but the scalar one can win if most columns have few elements.
+ */
+void MatrixSparseSymmetric1::vecMulAddIso2D(const real* X, real* Y, index_t start, index_t stop) const
+{
+    assert_true( start <= stop );
+    assert_true( stop <= size_ );
+
+    switch ( kernel_ )
+    {
+        case 1:
+            return vecMulAddIso2D_<&MatrixSparseSymmetric1::vecMulAddIso2D>(X, Y, start, stop);
+#if MATRIX1_USES_SSE
+        case 2:
+            return vecMulAddIso2D_<&MatrixSparseSymmetric1::vecMulAddIso2D_SSEU>(X, Y, start, stop);
+#endif
 #if MATRIX1_USES_AVX
-        vecMulAddIso2D_AVXU(X, Y, 2*jj, sa_+jj, ija_[jj], ija_[jj+1]);
+        case 3:
+            return vecMulAddIso2D_<&MatrixSparseSymmetric1::vecMulAddIso2D_AVXU>(X, Y, start, stop);
+#endif
+    }
+#if MATRIX1_USES_AVX
+    vecMulAddIso2D_<&MatrixSparseSymmetric1::vecMulAddIso2D_AVXU>(X, Y, start, stop);
 #elif MATRIX1_USES_SSE
-        vecMulAddIso2D_SSEU(X, Y, 2*jj, sa_+jj, ija_[jj], ija_[jj+1]);
+    vecMulAddIso2D_<&MatrixSparseSymmetric1::vecMulAddIso2D_SSEU>(X, Y, start, stop);
 #else
-        vecMulAddIso2D(X, Y, 2*jj, sa_+jj, ija_[jj], ija_[jj+1]);
+    vecMulAddIso2D_<&MatrixSparseSymmetric1::vecMulAddIso2D>(X, Y, start, stop);
 #endif
-    }
 }
 
 
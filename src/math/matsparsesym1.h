@@ -47,6 +47,9 @@ private:
     /// array column_[c][] holds Elements of column 'c'
     Element ** column_;
     
+    /// kernel of the 2D isotropic multiplication, see setKernel()
+    int        kernel_;
+    
     /// col_size_[c] is the number of Elements in column 'c'
     unsigned * col_size_;
     
@@ -110,9 +113,22 @@ private:
 
     /// One column 3D isotropic multiplication of a vector
     void vecMulAddIso3D(const real* X, real* Y, index_t jj, real const* dia, index_t start, index_t stop) const;
+    
+    /// 2D isotropic multiplication of the columns [start, stop[ using `FUNC` for each column
+    template < void (MatrixSparseSymmetric1::*FUNC)(const real*, real*, index_t, real const*, index_t, index_t) const >
+    void vecMulAddIso2D_(const real* X, real* Y, index_t start, index_t stop) const;
 
 public:
     
+    /// true if kernel `k` of the 2D isotropic multiplication is available
+    static bool hasKernel(int k);
+    
+    /// select the 2D isotropic multiplication: 0 = fastest available, 1 = scalar, 2 = SSE, 3 = AVX
+    void setKernel(int k) { kernel_ = hasKernel(k) ? k : 0; }
+    
+    /// kernel of the 2D isotropic multiplication
+    int kernel() const { return kernel_; }
+    
     /// return the size of the matrix
     index_t size() const { return size_; }
     
@@ -146,12 +162,18 @@ public:
     /// scale the matrix by a scalar factor
     void scale(real);
     
+    /// add the non-zero elements of `M` located in the columns [start, stop[
+    void add(MatrixSparseSymmetric1 const& M, index_t start, index_t stop);
+    
     /// add the diagonal block ( x, x, x+sx, x+sx ) from this matrix to M
     void addDiagonalBlock(real* mat, unsigned ldd, index_t si, unsigned nb) const;
     
     /// add upper triangular half of 'this' block ( idx, idx, idx+siz, idx+siz ) to `mat`
     void addTriangularBlock(real* mat, index_t ldd, index_t si, unsigned nb, unsigned dim) const;
     
+    /// add all elements M(i,j) to `mat` at ( dim*map[i], dim*map[j] ), expanded isotropically in `dim` dimensions
+    void addAggregated(real* mat, unsigned ldd, index_t const* map, unsigned dim) const;
+
     /// create compressed storage from column-based data
     void prepareForMultiply(int);
 
@@ -186,6 +208,18 @@ public:
     
     /// number of blocks which are not null
     size_t nbElements() const { return nbElements(0, size_); }
+    
+    /// number of elements in column `j`, including the diagonal
+    size_t columnSize(index_t j) const { return col_size_[j]; }
+    
+    /// line of the n-th element of column `j`, in increasing order
+    index_t columnLine(index_t j, size_t n) const { return column_[j][n].inx; }
+
+    /// size of the memory allocated, in bytes
+    size_t memory() const;
+    
+    /// reduce the memory of the columns that are mostly empty, returning the number of columns changed
+    size_t compact();
 
     /// returns a string which a description of the type of matrix
     std::string what() const;
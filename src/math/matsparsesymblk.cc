@@ -4,6 +4,7 @@
 #include "assert_macro.h"
 #include "vector2.h"
 #include "vector3.h"
+#include "simd.h"
 #include <sstream>
 
 // Flag to enable AVX implementation
@@ -16,6 +17,7 @@
 
 MatrixSparseSymmetricBlock::MatrixSparseSymmetricBlock()
 {
+    size_      = 0;
     allocated_ = 0;
     column_    = nullptr;
     
@@ -66,6 +68,10 @@ void MatrixSparseSymmetricBlock::deallocate()
 }
 
 
+/// size of the memory allocations made for the columns, in number of elements
+constexpr size_t column_chunk = 16;
+
+
 void MatrixSparseSymmetricBlock::Column::allocate(size_t alc)
 {
     if ( alc > allo_ )
@@ -76,9 +82,37 @@ void MatrixSparseSymmetricBlock::Column::allocate(size_t alc)
          'chunk' can be increased, to possibly gain performance:
          more memory will be used, but reallocation will be less frequent
          */
-        constexpr size_t chunk = 16;
-        alc = ( alc + chunk - 1 ) & ~( chunk - 1 );
-        
+        reallocate(( alc + column_chunk - 1 ) & ~( column_chunk - 1 ));
+    }
+}
+
+
+/**
+ A column is reduced to twice its size, if it uses less than a quarter of its
+ capacity, such that a column that oscillates in size is not reallocated often.
+ */
+bool MatrixSparseSymmetricBlock::Column::compact()
+{
+    if ( allo_ > column_chunk && 4 * size_ < allo_ )
+    {
+        if ( size_ == 0 )
+        {
+            deallocate();
+            allo_ = 0;
+            sort_ = 0;
+        }
+        else
+            reallocate(( 2 * size_ + column_chunk - 1 ) & ~( column_chunk - 1 ));
+        return true;
+    }
+    return false;
+}
+
+
+void MatrixSparseSymmetricBlock::Column::reallocate(size_t alc)
+{
+    assert_true( size_ <= alc );
+    {
         // use aligned memory:
         void * ptr = new_real(alc*sizeof(SquareBlock)/sizeof(real));
         SquareBlock * blk_new  = new(ptr) SquareBlock[alc];
@@ -127,11 +161,13 @@ void MatrixSparseSymmetricBlock::Column::operator =(MatrixSparseSymmetricBlock::
     free_real(blk_);
 
     size_ = col.size_;
+    sort_ = col.sort_;
     allo_ = col.allo_;
     inx_ = col.inx_;
     blk_ = col.blk_;
     
     col.size_ = 0;
+    col.sort_ = 0;
     col.allo_ = 0;
     col.inx_ = nullptr;
     col.blk_ = nullptr;
@@ -147,8 +183,13 @@ SquareBlock& MatrixSparseSymmetricBlock::Column::block(index_t ii, index_t jj)
     {
         if ( inx_[0] == ii )
             return blk_[0];
-        /* This is a silly search that could be optimized */
-        for ( index_t n = 1; n < size_; ++n )
+        // binary search within the ordered elements:
+        index_t const* end = inx_ + sort_;
+        index_t const* ptr = std::lower_bound((index_t const*)inx_+1, end, ii);
+        if ( ptr < end && *ptr == ii )
+            return blk_[ptr-inx_];
+        // linear search among the new elements:
+        for ( index_t n = std::max(sort_, 1U); n < size_; ++n )
             if ( inx_[n] == ii )
                 return blk_[n];
     }
@@ -161,12 +202,14 @@ SquareBlock& MatrixSparseSymmetricBlock::Column::block(index_t ii, index_t jj)
         if ( ii == jj )
         {
             size_ = 1;
+            sort_ = 1;
             return blk_[0];
         }
         //add the requested term:
         inx_[1] = ii;
         blk_[1].reset();
         size_ = 2;
+        sort_ = 2;
         return blk_[1];
     }
     
@@ -189,9 +232,45 @@ SquareBlock& MatrixSparseSymmetricBlock::Column::block(index_t ii, index_t jj)
 
 void MatrixSparseSymmetricBlock::Column::reset()
 {
-    size_ = 0;
+    for ( index_t n = 0; n < size_; ++n )
+        blk_[n].reset();
+}
+
+
+/**
+ Elements that remained zero are removed, preserving the order of the others.
+ The diagonal element is kept, unless the column is entirely zero.
+ */
+void MatrixSparseSymmetricBlock::Column::prune()
+{
+    if ( size_ == 0 )
+        return;
+    index_t k = 1, s = 1;
+    for ( index_t n = 1; n < size_; ++n )
+    {
+        if ( blk_[n] != 0.0 )
+        {
+            if ( k < n )
+            {
+                inx_[k] = inx_[n];
+                blk_[k] = blk_[n];
+            }
+            ++k;
+        }
+        // record the number of elements that remain ordered:
+        if ( n+1 == sort_ )
+            s = k;
+    }
+    size_ = k;
+    sort_ = s;
+    if ( size_ == 1 && !( blk_[0] != 0.0 ) )
+    {
+        size_ = 0;
+        sort_ = 0;
+    }
 }
 
+
 SquareBlock& MatrixSparseSymmetricBlock::diag_block(index_t ii)
 {
     assert_true( ii < size_ );
@@ -201,6 +280,7 @@ SquareBlock& MatrixSparseSymmetricBlock::diag_block(index_t ii)
         //fprintf(stderr, "new diagonal element for column %i\n", ii);
         col.allocate(1);
         col.size_ = 1;
+        col.sort_ = 1;
         // put diagonal term always first:
         col.inx_[0] = ii;
         col.blk_[0].reset();
@@ -250,6 +330,16 @@ void MatrixSparseSymmetricBlock::reset()
 }
 
 
+void MatrixSparseSymmetricBlock::clear()
+{
+    for ( index_t n = 0; n < size_; ++n )
+    {
+        column_[n].size_ = 0;
+        column_[n].sort_ = 0;
+    }
+}
+
+
 bool MatrixSparseSymmetricBlock::nonZero() const
 {
     //check for any non-zero sparse term:
@@ -265,6 +355,24 @@ bool MatrixSparseSymmetricBlock::nonZero() const
 }
 
 
+/**
+ Only the columns [start, stop[ of this matrix are modified, such that
+ different threads can add different ranges of columns concurrently.
+ */
+void MatrixSparseSymmetricBlock::add(MatrixSparseSymmetricBlock const& M, index_t start, index_t stop)
+{
+    assert_true( M.size_ <= size_ );
+    stop = std::min(stop, M.size_);
+    for ( index_t jj = start; jj < stop; ++jj )
+    {
+        Column const& col = M.column_[jj];
+        for ( unsigned n = 0 ; n < col.size_ ; ++n )
+            if ( col.blk_[n] != 0.0 )
+                column_[jj].block(col.inx_[n], jj) += col.blk_[n];
+    }
+}
+
+
 void MatrixSparseSymmetricBlock::scale(const real alpha)
 {
     for ( index_t jj = 0; jj < size_; ++jj )
@@ -346,6 +454,31 @@ void MatrixSparseSymmetricBlock::addDiagonalBlock(real* mat, unsigned ldd,
 }
 
 
+/**
+ This sums the blocks of lines and columns that have the same image by `map`,
+ thus reducing the matrix to a smaller one. The result is symmetric and full.
+ */
+void MatrixSparseSymmetricBlock::addAggregated(real* mat, unsigned ldd, index_t const* map) const
+{
+    for ( index_t jj = 0; jj < size_; ++jj )
+    {
+        Column & col = column_[jj];
+        if ( col.size_ > 0 )
+        {
+            assert_true(col.inx_[0] == jj);
+            const index_t jm = BLOCK_SIZE * map[jj/BLOCK_SIZE];
+            col[0].addto_symm(mat+( jm + ldd*jm ), ldd);
+            for ( index_t n = 1; n < col.size_; ++n )
+            {
+                const index_t im = BLOCK_SIZE * map[col.inx_[n]/BLOCK_SIZE];
+                col[n].addto(mat + ( im + ldd*jm ), ldd);
+                col[n].addto_trans(mat + ( jm + ldd*im ), ldd);
+            }
+        }
+    }
+}
+
+
 int MatrixSparseSymmetricBlock::bad() const
 {
     if ( size_ <= 0 ) return 1;
@@ -374,6 +507,29 @@ size_t MatrixSparseSymmetricBlock::nbElements(index_t start, index_t end) const
 }
 
 
+/**
+ The columns beyond the size of the matrix are released.
+ */
+size_t MatrixSparseSymmetricBlock::compact()
+{
+    size_t res = 0;
+    for ( size_t jj = size_; jj < allocated_; ++jj )
+        column_[jj].size_ = 0;
+    for ( size_t jj = 0; jj < allocated_; ++jj )
+        res += column_[jj].compact();
+    return res;
+}
+
+
+size_t MatrixSparseSymmetricBlock::memory() const
+{
+    size_t res = allocated_ * sizeof(Column) + ( allocated_ + 1 ) * sizeof(index_t);
+    for ( size_t jj = 0; jj < allocated_; ++jj )
+        res += column_[jj].allo_ * ( sizeof(SquareBlock) + sizeof(index_t) );
+    return res;
+}
+
+
 //------------------------------------------------------------------------------
 #pragma mark -
 
@@ -383,7 +539,7 @@ std::string MatrixSparseSymmetricBlock::what() const
     std::ostringstream msg;
 #if MATRIXSSB_USES_AVX
     msg << "MSSBx " << SquareBlock::what() << "*" << nbElements();
-#elif defined(__SSE3__) &&  REAL_IS_DOUBLE
+#elif VEC2_IS_AVAILABLE && REAL_IS_DOUBLE
     msg << "MSSBe " << SquareBlock::what() << "*" << nbElements();
 #else
     msg << "MSSB " << SquareBlock::what() << "*" << nbElements();
@@ -488,6 +644,31 @@ void MatrixSparseSymmetricBlock::Column::sort(Element*& tmp, size_t tmp_size)
          blk_[i] = tmp[i].blk;
          inx_[i] = tmp[i].inx;
     }
+    sort_ = size_;
+}
+
+
+/**
+ Insertion sort of the elements added since the last sort,
+ which is efficient if these elements are few.
+ */
+void MatrixSparseSymmetricBlock::Column::insertNew()
+{
+    for ( index_t n = std::max(sort_, 1U); n < size_; ++n )
+    {
+        const index_t ii = inx_[n];
+        const SquareBlock blk = blk_[n];
+        index_t k = n;
+        while ( k > 1 && inx_[k-1] > ii )
+        {
+            inx_[k] = inx_[k-1];
+            blk_[k] = blk_[k-1];
+            --k;
+        }
+        inx_[k] = ii;
+        blk_[k] = blk;
+    }
+    sort_ = size_;
 }
 
 
@@ -511,6 +692,10 @@ size_t newElements(MatrixSparseSymmetricBlock::Element*& ptr, size_t size)
 
 void MatrixSparseSymmetricBlock::prepareForMultiply(int)
 {
+    // remove elements that were not set since the last call:
+    for ( index_t jj = 0; jj < size_; ++jj )
+        column_[jj].prune();
+
     next_[size_] = size_;
     
     if ( size_ > 0 )
@@ -539,12 +724,14 @@ void MatrixSparseSymmetricBlock::prepareForMultiply(int)
         //std::clog << "MSSB column " << jj << " has " << col.size_ << " elements\n";
 
         // order the elements within the column:
-        if ( col.size_ > 2 )
+        if ( col.sort_ + 16 < col.size_ )
         {
             if ( tmp_size < col.size_ )
                 tmp_size = newElements(tmp, col.size_);
             col.sort(tmp, tmp_size);
         }
+        else if ( col.sort_ < col.size_ )
+            col.insertNew();
         
         //++cnt;
         assert_true( jj < size_ );
@@ -559,6 +746,7 @@ void MatrixSparseSymmetricBlock::prepareForMultiply(int)
             const index_t ii = col.inx_[n];
             assert_true( ii < size_ );
             assert_true( ii != jj );
+            assert_true( n < 2 || col.inx_[n-1] < ii );
         }
 #endif
     }
@@ -657,7 +845,7 @@ void MatrixSparseSymmetricBlock::Column::vecMulAdd4D(const real* X, real* Y, ind
 
 void MatrixSparseSymmetricBlock::Column::vecMulAdd2D_SSE(const real* X, real* Y, index_t jj) const
 {
-#if ( BLOCK_SIZE == 2 ) && defined(__SSE3__) && REAL_IS_DOUBLE
+#if ( BLOCK_SIZE == 2 ) && VEC2_IS_AVAILABLE && REAL_IS_DOUBLE
     vec2 x0, x1;
     vec2 yy = load2(Y+jj);
     {
@@ -1135,7 +1323,7 @@ void MatrixSparseSymmetricBlock::Column::vecMulAdd4D_AVX(const real* X, real* Y,
 #   define VECMULADD2D vecMulAdd2D_AVXU
 #   define VECMULADD3D vecMulAdd3D_AVXU
 #   define VECMULADD4D vecMulAdd4D_AVX
-#elif defined(__SSE3__) && REAL_IS_DOUBLE
+#elif VEC2_IS_AVAILABLE && REAL_IS_DOUBLE
 #   define VECMULADD2D vecMulAdd2D_SSE
 #   define VECMULADD3D vecMulAdd3D
 #   define VECMULADD4D vecMulAdd4D
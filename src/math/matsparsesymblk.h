@@ -44,9 +44,16 @@ typedef Matrix44 SquareBlock;
  MatrixSparseSymmetricBlock uses a sparse storage, with arrays of elements for each column.
  Each element is a full square block of size DIM x DIM.
  
- Elements are stored in random order in the column.
+ The diagonal element is first in each column, and the other elements are
+ ordered by increasing line index, followed by any element that was added since
+ the last call to prepareForMultiply(), in random order.
  The lower triangle of the matrix is stored.
  
+ The sparsity pattern is kept by reset(), which only sets the values to zero.
+ Hence if the connectivity changes little between consecutive steps, most elements
+ are found at their previous location, and only the new elements need to be sorted.
+ The elements that remained zero are removed by prepareForMultiply().
+ 
  F. Nedelec, 17--27 March 2017, revised entirely June 2018
  */
 class MatrixSparseSymmetricBlock
@@ -71,6 +78,8 @@ private:
 
         size_t   allo_;
         unsigned size_;
+        /// number of elements ordered by increasing line index, including the diagonal
+        unsigned sort_;
         //Element* elem_;
         index_t     * inx_;
         SquareBlock * blk_;
@@ -78,7 +87,7 @@ private:
     public:
         
         /// constructor
-        Column() { size_ = 0; allo_ = 0; inx_ = nullptr; blk_ = nullptr; }
+        Column() { size_ = 0; sort_ = 0; allo_ = 0; inx_ = nullptr; blk_ = nullptr; }
         
         /// the assignment operator will transfer memory
         void operator =(Column&);
@@ -89,15 +98,27 @@ private:
         /// allocate to hold 'nb' elements
         void allocate(size_t nb);
         
+        /// change the capacity to `alc`, which should be >= size_
+        void reallocate(size_t alc);
+        
+        /// reduce the capacity if less than a quarter of it is used, returning true if done
+        bool compact();
+        
         /// deallocate memory
         void deallocate();
 
-        /// set as zero
+        /// set all values to zero, keeping the elements
         void reset();
         
+        /// remove non-diagonal elements that are zero
+        void prune();
+        
         /// sort element by increasing indices, using provided temporary array
         void sort(Element*&, size_t);
         
+        /// move the elements added since the last sort at their ordered locations
+        void insertNew();
+        
         /// print
         void print(std::ostream&) const;
 
@@ -166,9 +187,12 @@ public:
     /// default destructor
     virtual ~MatrixSparseSymmetricBlock()  { deallocate(); }
     
-    /// set all the element to zero
+    /// set all the element to zero, keeping the sparsity pattern
     void reset();
     
+    /// remove all the elements, keeping the memory
+    void clear();
+    
     /// allocate the matrix to hold ( sz * sz )
     void allocate(size_t alc);
     
@@ -202,12 +226,18 @@ public:
     /// scale the matrix by a scalar factor
     void scale(real);
     
+    /// add the non-zero blocks of `M` located in the columns [start, stop[
+    void add(MatrixSparseSymmetricBlock const& M, index_t start, index_t stop);
+    
     /// add the diagonal block ( x, x, x+sx, x+sx ) from this matrix to M
     void addDiagonalBlock(real* mat, unsigned ldd, index_t si, unsigned nb) const;
     
     /// add upper triangular half of 'this' block ( idx, idx, idx+siz, idx+siz ) to `mat`
     void addTriangularBlock(real* mat, index_t ldd, index_t si, unsigned nb, unsigned dim) const;
     
+
+    /// add all blocks M(i,j) to `mat` at ( BLOCK_SIZE*map[i/BLOCK_SIZE], BLOCK_SIZE*map[j/BLOCK_SIZE] )
+    void addAggregated(real* mat, unsigned ldd, index_t const* map) const;
     
     ///optional optimization that may accelerate multiplications by a vector
     void prepareForMultiply(int dim);
@@ -238,6 +268,18 @@ public:
     
     /// number of blocks which are not null
     size_t nbElements() const { return nbElements(0, size_); }
+    
+    /// number of blocks in column `j`, including the diagonal
+    size_t columnSize(index_t j) const { return column_[j].size_; }
+    
+    /// line of the n-th block of column `j`, not necessarily in order
+    index_t columnLine(index_t j, size_t n) const { return column_[j].inx_[n]; }
+    
+    /// size of the memory allocated, in bytes
+    size_t memory() const;
+    
+    /// reduce the memory of the columns that are mostly empty, returning the number of columns changed
+    size_t compact();
 
     /// returns a string which a description of the type of matrix
     std::string what() const;
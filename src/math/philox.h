@@ -0,0 +1,192 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <stdint.h>
+#include "real.h"
+
+
+/// Counter-based random generator Philox-4x32-10
+/**
+ The generator has no state: 4 random 32-bit integers are obtained by encrypting
+ a counter of 128 bits with a key of 64 bits derived from the seed (Salmon et al.
+ "Parallel random numbers: as easy as 1, 2, 3", SC 2011).
+ The counter is made of ( step, object ID, purpose, index ), such that the random
+ numbers used by one object in one time step do not depend on the order in which
+ the objects are processed, or on the number of threads processing them.
+
+ Usage:
+
+     Philox gen(seed);
+     Philox::Stream rng(gen, step, identity, Philox::DIFFUSION);
+     real x = rng.preal();
+     rng.gauss_set(vec, cnt);
+
+ A Random can also draw its numbers from a Philox (see Random::stream()), such
+ that code calling `RNG` can be given one sequence per object.
+
+ The first 4 values of counter (0,0,0,0) with key (0,0) are
+ 6627e8d5 e169c58d bc57ac4c 9b00dbd8, as given by the reference implementation.
+ */
+class Philox
+{
+public:
+
+    /// purposes of the random numbers, which are part of the counter
+    enum Purpose { ATTACHMENT = 1, DETACHMENT, DIFFUSION, BROWNIAN, MISC, ASSEMBLY };
+
+private:
+
+    /// key derived from the seed
+    uint32_t key_[2];
+
+    /// one round of the encryption
+    static void round(uint32_t c[4], uint32_t k0, uint32_t k1)
+    {
+        uint64_t p0 = (uint64_t)0xD2511F53 * c[0];
+        uint64_t p1 = (uint64_t)0xCD9E8D57 * c[2];
+        uint32_t x0 = (uint32_t)( p1 >> 32 ) ^ c[1] ^ k0;
+        uint32_t x2 = (uint32_t)( p0 >> 32 ) ^ c[3] ^ k1;
+        c[1] = (uint32_t)p1;
+        c[3] = (uint32_t)p0;
+        c[0] = x0;
+        c[2] = x2;
+    }
+
+public:
+
+    /// initialize with given seed
+    explicit Philox(uint64_t seed = 0) { key_[0] = (uint32_t)seed; key_[1] = (uint32_t)( seed >> 32 ); }
+
+    /// replace counter `c` by 4 random integers
+    void encrypt(uint32_t c[4]) const
+    {
+        uint32_t k0 = key_[0], k1 = key_[1];
+        for ( int r = 0; r < 9; ++r )
+        {
+            round(c, k0, k1);
+            k0 += 0x9E3779B9;
+            k1 += 0xBB67AE85;
+        }
+        round(c, k0, k1);
+    }
+
+    /// set 4 random integers for counter ( step, id, purpose, index )
+    void generate(uint32_t res[4], uint32_t step, uint32_t id, uint32_t purpose, uint32_t index) const
+    {
+        res[0] = step;
+        res[1] = id;
+        res[2] = purpose;
+        res[3] = index;
+        encrypt(res);
+    }
+
+    /// Gaussian numbers ~ N(0,v*v) attributed to objects `id+i` for i in [0, cnt-1]
+    /**
+     `vec[D*i]` to `vec[D*i+D-1]` are set for object `id+i`, with D <= 4.
+     The iterations are independent, and can be vectorized by the compiler.
+     */
+    template < int D >
+    void gauss_set(real vec[], size_t cnt, real v, uint32_t step, uint32_t id, uint32_t purpose) const
+    {
+        static_assert(D <= 4, "at most 4 values per object are produced by one block");
+        for ( size_t i = 0; i < cnt; ++i )
+        {
+            uint32_t c[4];
+            generate(c, step, id + (uint32_t)i, purpose, 0);
+            real ang0 = int32_t(c[0]) * ( 0x1p-31 * M_PI );
+            real ang1 = int32_t(c[2]) * ( 0x1p-31 * M_PI );
+            // arguments of the logarithms are in ]0, 1]:
+            real nrm0 = v * std::sqrt( -2 * std::log(( c[1] + 1.0 ) * 0x1p-32 ));
+            real nrm1 = v * std::sqrt( -2 * std::log(( c[3] + 1.0 ) * 0x1p-32 ));
+            real g[4] = { nrm0 * std::cos(ang0), nrm0 * std::sin(ang0),
+                          nrm1 * std::cos(ang1), nrm1 * std::sin(ang1) };
+            for ( int d = 0; d < D; ++d )
+                vec[D*i+d] = g[d];
+        }
+    }
+
+    /// Sequence of random numbers attributed to one object for one purpose
+    class Stream
+    {
+        /// generator
+        Philox const& gen_;
+
+        /// counter ( step, id, purpose, index )
+        uint32_t ctr_[4];
+
+        /// random integers derived from the last counter
+        uint32_t buf_[4];
+
+        /// number of unused values in `buf_`
+        unsigned avail_;
+
+        /// next 32 random bits
+        uint32_t next()
+        {
+            if ( avail_ == 0 )
+            {
+                buf_[0] = ctr_[0];
+                buf_[1] = ctr_[1];
+                buf_[2] = ctr_[2];
+                buf_[3] = ctr_[3]++;
+                gen_.encrypt(buf_);
+                avail_ = 4;
+            }
+            return buf_[--avail_];
+        }
+
+    public:
+
+        /// sequence for object `id` at time step `step`
+        Stream(Philox const& gen, uint32_t step, uint32_t id, uint32_t purpose)
+        : gen_(gen), avail_(0)
+        {
+            ctr_[0] = step;
+            ctr_[1] = id;
+            ctr_[2] = purpose;
+            ctr_[3] = 0;
+        }
+
+        /// unsigned integer in [0, 2^32-1]
+        uint32_t pint32() { return next(); }
+
+        /// positive real number in [0,1[, zero included
+        real preal() { return next() * 0x1p-32; }
+
+        /// signed real number in ]-1,1[
+        real sreal() { return int32_t(next()) * 0x1p-31; }
+
+        /// returns true with probability (p), and false with probability (1-p)
+        bool test(real p) { return preal() < p; }
+
+        /// random in [0, inf[, with P(x) = exp(-x)
+        real exponential() { return -std::log(( next() + 1.0 ) * 0x1p-32); }
+
+        /// set two independent random numbers, both following a normal law N(0,v*v)
+        void gauss_set(real& a, real& b, real v)
+        {
+            real ang = sreal() * M_PI;
+            real nrm = v * std::sqrt( -2 * std::log(( next() + 1.0 ) * 0x1p-32 ));
+            a = nrm * std::cos(ang);
+            b = nrm * std::sin(ang);
+        }
+
+        /// fill array `vec` with independent random numbers following normal law N(0,v*v)
+        void gauss_set(real vec[], size_t cnt, real v = 1)
+        {
+            for ( size_t i = 0; i+1 < cnt; i += 2 )
+                gauss_set(vec[i], vec[i+1], v);
+            if ( cnt & 1 )
+            {
+                real x;
+                gauss_set(vec[cnt-1], x, v);
+            }
+        }
+
+        /// random Gaussian number, following a normal law N(0,1)
+        real gauss() { real a, b; gauss_set(a, b, 1); return a; }
+    };
+};
+
+#endif
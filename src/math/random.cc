@@ -1,6 +1,7 @@
 // Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University.
 
 #include "random.h"
+#include "philox.h"
 
 #include <cstdio>
 #include <cstdlib>
@@ -11,7 +12,10 @@
 
 
 /// static object
-Random RNG;
+Random sharedRNG;
+
+/// generator of the current thread
+thread_local Random * localRNG = &sharedRNG;
 
 
 /// the most significant bit in a 32-bits integer
@@ -50,6 +54,9 @@ Random::Random()
     start_ = integers_;
     end_ = start_;
     next_gaussian_ = gaussians_;
+    bits_ = 0;
+    nbits_ = 0;
+    philox_ = nullptr;
 }
 
 
@@ -61,8 +68,143 @@ Random::~Random()
 
 void Random::seed(const uint32_t s)
 {
+    philox_ = nullptr;
     sfmt_init_gen_rand(&twister_, s);
     refill();
+    nbits_ = 0;
+}
+
+
+/**
+ The state is made of the reserves of numbers ahead of the twister, and the
+ position of the next values in these reserves, such that the sequence of
+ numbers generated after load_state() is the same as after save_state().
+ */
+size_t Random::state_size()
+{
+    return sizeof(integers_) + sizeof(gaussians_) + sizeof(twister_) + 5 * sizeof(uint32_t);
+}
+
+
+void Random::save_state(void * dst) const
+{
+    char * ptr = static_cast<char*>(dst);
+    memcpy(ptr, integers_, sizeof(integers_));
+    ptr += sizeof(integers_);
+    memcpy(ptr, gaussians_, sizeof(gaussians_));
+    ptr += sizeof(gaussians_);
+    memcpy(ptr, &twister_, sizeof(twister_));
+    ptr += sizeof(twister_);
+    uint32_t off[5] = { uint32_t(start_ - integers_), uint32_t(end_ - integers_),
+                        uint32_t(next_gaussian_ - gaussians_), bits_, nbits_ };
+    memcpy(ptr, off, sizeof(off));
+}
+
+
+/**
+ This combines the first word of the twister, which changes every time the
+ reserve is refilled, with the positions in the reserves. Two generators that
+ were seeded identically have the same fingerprint if they have produced the
+ same numbers, and it is very unlikely otherwise.
+ */
+uint64_t Random::fingerprint() const
+{
+    uint64_t h = twister_.state[0].u[0];
+    h = h * 1000003 + uint64_t(start_ - integers_);
+    h = h * 1000003 + uint64_t(end_ - integers_);
+    h = h * 1000003 + uint64_t(next_gaussian_ - gaussians_);
+    return h * 1000003 + nbits_;
+}
+
+
+void Random::load_state(void const* src)
+{
+    char const* ptr = static_cast<char const*>(src);
+    memcpy(integers_, ptr, sizeof(integers_));
+    ptr += sizeof(integers_);
+    memcpy(gaussians_, ptr, sizeof(gaussians_));
+    ptr += sizeof(gaussians_);
+    memcpy(&twister_, ptr, sizeof(twister_));
+    ptr += sizeof(twister_);
+    uint32_t off[5];
+    memcpy(off, ptr, sizeof(off));
+    start_ = integers_ + off[0];
+    end_ = integers_ + off[1];
+    next_gaussian_ = gaussians_ + off[2];
+    bits_ = off[3];
+    nbits_ = off[4];
+    philox_ = nullptr;
+}
+
+
+/**
+ After this call, the numbers are produced by the counter-based generator `gen`,
+ from the counter ( step, id, purpose, index ), where `index` is incremented.
+ The sequence only depends on the arguments, and not on the numbers drawn
+ previously, which gives each object its own sequence in each step, independently
+ of the order in which the objects are processed, or of the number of threads.
+ The reserves are emptied, and the twister is not used until seed() is called.
+ */
+void Random::stream(Philox const& gen, uint32_t step, uint32_t id, uint32_t purpose)
+{
+    philox_ = &gen;
+    counter_[0] = step;
+    counter_[1] = id;
+    counter_[2] = purpose;
+    counter_[3] = 0;
+    start_ = integers_;
+    end_ = start_;
+    next_gaussian_ = gaussians_;
+    nbits_ = 0;
+}
+
+
+/**
+ The blocks are stored in reverse order, since URAND32() reads the reserve from
+ the end, such that the integers come in the same order as from Philox::Stream.
+ */
+void Random::philox_block(uint32_t dst[])
+{
+    for ( unsigned i = 0; i < STREAM_BLOCK; i += 4 )
+    {
+        uint32_t * c = dst + ( STREAM_BLOCK - 4 - i );
+        c[0] = counter_[0];
+        c[1] = counter_[1];
+        c[2] = counter_[2];
+        c[3] = counter_[3]++;
+        philox_->encrypt(c);
+    }
+}
+
+
+void Random::refill_stream()
+{
+    philox_block(integers_);
+    start_ = integers_;
+    end_ = start_ + STREAM_BLOCK;
+}
+
+
+/**
+ The integers are taken directly from the reserve, in the same order as test(),
+ such that the result is the same as calling test() `cnt` times, and the inner
+ loop can be vectorized.
+ */
+void Random::test_many(size_t cnt, real const prob[], bool res[])
+{
+    while ( cnt > 0 )
+    {
+        if ( end_ <= start_ )
+            refill();
+        size_t n = std::min(cnt, size_t(end_ - start_));
+        int32_t const* src = reinterpret_cast<int32_t const*>(end_) - 1;
+        for ( size_t i = 0; i < n; ++i )
+            res[i] = ( std::fabs(static_cast<real>(src[-(long)i])) * TWO_POWER_MINUS_31 < prob[i] );
+        end_ -= n;
+        prob += n;
+        res += n;
+        cnt -= n;
+    }
 }
 
 /**
@@ -265,13 +407,21 @@ real * gauss_fill(real dst[], size_t cnt, const int32_t src[])
 }
 
 /**
- Fill array `gaussians_` with approximately 500 Gaussian values ~ N(0,1).
+ Fill array `gaussians_` with approximately 500 Gaussian values ~ N(0,1),
+ or with approximately 12 values if the numbers are drawn from a stream.
  Set `next_gaussian` past the last position containing a valid number.
  The number of gaussian values set by this function is random,
  and it may even be zero.
  */
 void Random::refill_gaussians()
 {
+    if ( philox_ )
+    {
+        uint32_t tmp[STREAM_BLOCK];
+        philox_block(tmp);
+        next_gaussian_ = gauss_fill(gaussians_, STREAM_BLOCK, (int32_t*)tmp);
+        return;
+    }
     next_gaussian_ = gauss_fill(gaussians_, SFMT_N32, (int32_t*)twister_.state);
     sfmt_gen_rand_all(&twister_);
     //printf("refill_gaussians %lu\n", next_gaussian_ - gaussians_);
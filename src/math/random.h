@@ -12,6 +12,8 @@
 
 #include "SFMT.h"
 
+class Philox;
+
 /// the maximum value of a signed 32-bit integer is 2^31-1
 #define TWO_POWER_MINUS_31 0x1p-31
 /// the maximum value of a unsigned 32-bit integer is 2^32-1
@@ -52,10 +54,33 @@ class alignas(64) Random
     /// pointer to access the next value in `gaussians_[]`
     real *next_gaussian_;
 
+    /// reserve of random bits used by flip()
+    uint32_t bits_;
+
+    /// number of unused bits in `bits_`
+    uint32_t nbits_;
+
+    /// counter-based generator replacing the twister, if not null (see stream())
+    Philox const* philox_;
+
+    /// counter of `philox_`, as ( step, id, purpose, index )
+    uint32_t counter_[4];
+
+    /// number of integers produced by `philox_` at each refill
+    static constexpr unsigned STREAM_BLOCK = 16;
+
+    /// set `STREAM_BLOCK` integers in `dst` from `philox_`, and advance the counter
+    void philox_block(uint32_t dst[]);
+
+    /// replenish integer reserve from `philox_`
+    void refill_stream();
+
 protected:
     /// replenish state vector
     void refill()
     {
+        if ( philox_ )
+            return refill_stream();
         memcpy(integers_, twister_.state, 4 * SFMT_N32);
         start_ = integers_;
         end_ = start_ + SFMT_N32;
@@ -130,6 +155,21 @@ public:
 
     /// seed by reading /dev/random and if this fails using the clock
     uint32_t seed();
+    
+    /// number of bytes needed to store the state of the generator
+    static size_t state_size();
+    
+    /// copy the complete state of the generator, including the reserves, to `dst`
+    void save_state(void * dst) const;
+    
+    /// restore the state of the generator from `src`, written by save_state()
+    void load_state(void const* src);
+    
+    /// a value that changes whenever numbers are drawn from the generator
+    uint64_t fingerprint() const;
+    
+    /// draw the following numbers from `gen`, with counter ( step, id, purpose, 0 )
+    void stream(Philox const& gen, uint32_t step, uint32_t id, uint32_t purpose);
 
     /// signed integer in [-2^31+1, 2^31-1];
     int32_t sint32() { return RAND32(); }
@@ -143,8 +183,23 @@ public:
     /// unsigned integer in [0, 2^64-1]
     uint64_t pint64() { return URAND64(); }
 
-    /// unsigned integer in [0,n-1] for n < 2^32
-    uint32_t pint32(const uint32_t &n) { return uint32_t(ZERO2ONE() * n); }
+    /// unsigned integer in [0,n-1] for n < 2^32, unbiased
+    /**
+     Multiply-and-shift method with rejection of the biased values,
+     from D. Lemire, ACM Transactions on Modeling and Computer Simulation 2019.
+     A second integer is drawn with probability ( 2^32 % n ) / 2^32.
+     */
+    uint32_t pint32(const uint32_t &n)
+    {
+        uint64_t m = uint64_t(URAND32()) * n;
+        if ( uint32_t(m) < n )
+        {
+            const uint32_t t = -n % n;
+            while ( uint32_t(m) < t )
+                m = uint64_t(URAND32()) * n;
+        }
+        return uint32_t(m >> 32);
+    }
 
     /// unsigned integer in [0,n-1] for n < 2^64
     uint64_t pint64(const uint64_t &n) { return uint64_t(ZERO2ONE() * n); }
@@ -179,8 +234,22 @@ public:
     /// returns true with probability (1-p), and false with probability (p)
     bool test_not(real p) { return (ZERO2ONE() >= p); }
 
-    /// 0  or  1  with equal chance
-    int flip() { return URAND32() & 1U; }
+    /// set `res[i] = test(prob[i])` for i in [0, cnt-1]
+    void test_many(size_t cnt, real const prob[], bool res[]);
+
+    /// 0  or  1  with equal chance, using one random bit
+    int flip()
+    {
+        if ( nbits_ == 0 )
+        {
+            bits_ = URAND32();
+            nbits_ = 32;
+        }
+        --nbits_;
+        int res = bits_ & 1U;
+        bits_ >>= 1;
+        return res;
+    }
 
     /// returns -1  or  1 with equal chance
     real flipsign() { return std::copysign(1, RAND32()); }
@@ -297,8 +366,23 @@ public:
     }
 };
 
-/// declaring a global Random Number Generator
-extern Random RNG;
+/// the Random Number Generator shared by all threads
+extern Random sharedRNG;
+
+/// the generator used by the current thread, which is `sharedRNG` by default
+extern thread_local Random * localRNG;
+
+/**
+ `RNG` designates the generator of the current thread. A thread running its own
+ simulation can select its own generator, and restore the previous one after:
+
+     Random rng;
+     Random * old = localRNG;
+     localRNG = &rng;
+     ...
+     localRNG = old;
+ */
+#define RNG (*localRNG)
 
 /**
  Linear congruential random number generator
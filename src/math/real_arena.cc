@@ -0,0 +1,87 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#include "real_arena.h"
+#include <iomanip>
+#include <iostream>
+
+
+RealArena::RealArena(const char name[])
+: inuse_(0), reals_(0), name_(name)
+{
+    for ( int i = 0; i < NB_CLASSES; ++i )
+    {
+        asked_[i] = 0;
+        reused_[i] = 0;
+    }
+}
+
+
+RealArena::~RealArena()
+{
+    for ( int i = 0; i < NB_CLASSES; ++i )
+        for ( real * p : free_[i] )
+            free_real(p - HEAD);
+}
+
+
+real * RealArena::allocate(size_t cnt)
+{
+    int c = MIN_CLASS;
+    while ( ( size_t(1) << c ) < cnt )
+        ++c;
+    ++asked_[c];
+    ++inuse_;
+    reals_ += size_t(1) << c;
+    if ( free_[c].size() )
+    {
+        ++reused_[c];
+        real * res = free_[c].back();
+        free_[c].pop_back();
+        return res;
+    }
+    size_t cap = size_t(1) << c;
+    real * res = new_real(HEAD + cap) + HEAD;
+    reinterpret_cast<size_t*>(res - HEAD)[0] = cap;
+    return res;
+}
+
+
+void RealArena::release(real * ptr)
+{
+    if ( ptr )
+    {
+        size_t cap = capacity(ptr);
+        --inuse_;
+        reals_ -= cap;
+        int c = MIN_CLASS;
+        while ( ( size_t(1) << c ) < cap )
+            ++c;
+        if ( ( free_[c].size() + 1 ) * cap <= KEEP )
+            free_[c].push_back(ptr);
+        else
+            free_real(ptr - HEAD);
+    }
+}
+
+
+size_t RealArena::memory() const
+{
+    size_t res = reals_ + inuse_ * HEAD;
+    for ( int i = 0; i < NB_CLASSES; ++i )
+        res += free_[i].size() * ( HEAD + ( size_t(1) << i ));
+    return res * sizeof(real);
+}
+
+
+void RealArena::report(std::ostream& os) const
+{
+    for ( int i = 0; i < NB_CLASSES; ++i )
+    {
+        if ( asked_[i] )
+        {
+            os << '\n' << std::left << std::setw(10) << name_ << std::right;
+            os << std::setw(10) << ( size_t(1) << i ) << std::setw(10) << asked_[i];
+            os << std::setw(10) << reused_[i] << std::setw(10) << free_[i].size();
+        }
+    }
+}
@@ -0,0 +1,82 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef REAL_ARENA_H
+#define REAL_ARENA_H
+
+#include "real.h"
+#include <vector>
+#include <iosfwd>
+
+
+/// Recycles arrays of reals, in classes of sizes that are powers of 2
+/**
+ An array is returned with a capacity equal to the power of 2 that is equal
+ or greater than the size requested, and aligned to 64 bytes, like new_real().
+ The capacity is recorded in the 64 bytes preceding the array, such that only
+ the address is needed to release it. Released arrays are kept, and given
+ again for a later request of the same class of size, up to `KEEP` reals
+ per class. This is used by the Mecables, which need larger arrays as
+ they grow, and release them when they shrink or are deleted.
+
+ A RealArena is not thread-safe, and each thread should use its own.
+ */
+class RealArena
+{
+    /// number of size classes
+    static constexpr int NB_CLASSES = 40;
+    
+    /// smallest class is 2^MIN_CLASS
+    static constexpr int MIN_CLASS = 4;
+    
+    /// maximum number of reals kept in released arrays, per class (16 MB)
+    static constexpr size_t KEEP = 1 << 21;
+    
+    /// number of reals used to hold the capacity, preserving the alignment
+    static constexpr size_t HEAD = 64 / sizeof(real);
+    
+    /// arrays released, for each class
+    std::vector<real*> free_[NB_CLASSES];
+    
+    /// number of requests, for each class
+    size_t asked_[NB_CLASSES];
+    
+    /// number of requests that could reuse a released array, for each class
+    size_t reused_[NB_CLASSES];
+    
+    /// number of arrays in use
+    size_t inuse_;
+    
+    /// number of reals in the arrays in use
+    size_t reals_;
+    
+    /// name used in reports
+    const char * name_;
+    
+public:
+    
+    /// constructor
+    explicit RealArena(const char name[]);
+    
+    /// destructor frees the arrays that were released
+    ~RealArena();
+    
+    /// capacity of an array given by allocate()
+    static size_t capacity(real const* ptr) { return reinterpret_cast<size_t const*>(ptr - HEAD)[0]; }
+    
+    /// array that can hold at least `cnt` reals
+    real * allocate(size_t cnt);
+    
+    /// return an array given by allocate(), which may be `nullptr`
+    void   release(real * ptr);
+    
+    /// number of arrays in use
+    size_t count() const { return inuse_; }
+    
+    /// size of the arrays in use and of the arrays kept, in bytes
+    size_t memory() const;
+    
+    /// print the number of requests and the fraction reused, for each class
+    void   report(std::ostream&) const;
+};
+
+#endif
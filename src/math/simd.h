@@ -4,6 +4,19 @@
 #ifndef SIMD_H
 #define SIMD_H
 
+/*
+ The type `vec2` and its functions are implemented with SSE3 on x86,
+ and with NEON on 64-bit ARM (Apple M-series, AWS Graviton).
+ Code using only these functions should be guarded by VEC2_IS_AVAILABLE
+ */
+#if defined(__SSE3__)
+#  define VEC2_IS_AVAILABLE 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#  define VEC2_IS_AVAILABLE 1
+#else
+#  define VEC2_IS_AVAILABLE 0
+#endif
+
 //---------------------------------- SSE ---------------------------------------
 
 #if defined(__SSE3__)
@@ -73,6 +86,82 @@ inline static vec2 gethilo2(vec2 a, vec2 b)         { return _mm_shuffle_pd(a, b
 #define shuffle2(a,b,k)   _mm_shuffle_pd(a,b,k)
 #define cmp2(a,b,k)       _mm_cmp_pd(a,b,k)
 
+#endif
+
+//---------------------------------- NEON --------------------------------------
+
+#if defined(__ARM_NEON) && defined(__aarch64__) && !defined(__SSE3__)
+
+#include <arm_neon.h>
+
+/// Vector of 2 doubles
+typedef float64x2_t vec2;
+
+inline static vec2 load1(double const* a)           { return vld1q_dup_f64(a); }
+inline static vec2 load1Z(double const* a)          { return vld1q_lane_f64(a, vdupq_n_f64(0.0), 0); }
+inline static vec2 load2(double const* a)           { return vld1q_f64(a); }
+inline static vec2 loadu2(double const* a)          { return vld1q_f64(a); }
+inline static vec2 loaddup2(double const* a)        { return vld1q_dup_f64(a); }
+
+inline static vec2 loadhi2(vec2 a, double const* b) { return vld1q_lane_f64(b, a, 1); }
+inline static vec2 loadlo2(vec2 a, double const* b) { return vld1q_lane_f64(b, a, 0); }
+
+inline static void store1(double* a, vec2 b)        { vst1q_lane_f64(a, b, 0); }
+inline static void store2(double* a, vec2 b)        { vst1q_f64(a, b); }
+inline static void storedup(double* a, vec2 b)      { vst1q_f64(a, vdupq_laneq_f64(b, 0)); }
+inline static void storelo(double* a, vec2 b)       { vst1q_lane_f64(a, b, 0); }
+inline static void storeu2(double* a, vec2 b)       { vst1q_f64(a, b); }
+
+inline static vec2 movedup2(vec2 a)                 { return vdupq_laneq_f64(a, 0); }
+
+// operations on the low value, keeping the high value of 'a':
+inline static vec2 mul1(vec2 a, vec2 b)             { return vsetq_lane_f64(vgetq_lane_f64(a,0)*vgetq_lane_f64(b,0), a, 0); }
+inline static vec2 div1(vec2 a, vec2 b)             { return vsetq_lane_f64(vgetq_lane_f64(a,0)/vgetq_lane_f64(b,0), a, 0); }
+inline static vec2 add1(vec2 a, vec2 b)             { return vsetq_lane_f64(vgetq_lane_f64(a,0)+vgetq_lane_f64(b,0), a, 0); }
+inline static vec2 sub1(vec2 a, vec2 b)             { return vsetq_lane_f64(vgetq_lane_f64(a,0)-vgetq_lane_f64(b,0), a, 0); }
+
+inline static vec2 mul2(vec2 a, vec2 b)             { return vmulq_f64(a,b); }
+inline static vec2 div2(vec2 a, vec2 b)             { return vdivq_f64(a,b); }
+inline static vec2 add2(vec2 a, vec2 b)             { return vaddq_f64(a,b); }
+inline static vec2 sub2(vec2 a, vec2 b)             { return vsubq_f64(a,b); }
+inline static vec2 hadd2(vec2 a, vec2 b)            { return vpaddq_f64(a,b); }
+
+inline static vec2 sqrt2(vec2 a)                    { return vsqrtq_f64(a); }
+inline static vec2 max2(vec2 a, vec2 b)             { return vmaxq_f64(a,b); }
+inline static vec2 min2(vec2 a, vec2 b)             { return vminq_f64(a,b); }
+inline static vec2 and2(vec2 a, vec2 b)             { return vreinterpretq_f64_u64(vandq_u64(vreinterpretq_u64_f64(a), vreinterpretq_u64_f64(b))); }
+inline static vec2 andnot2(vec2 a, vec2 b)          { return vreinterpretq_f64_u64(vbicq_u64(vreinterpretq_u64_f64(b), vreinterpretq_u64_f64(a))); }
+inline static vec2 abs2(vec2 a)                     { return vabsq_f64(a); }
+inline static vec2 flipsign2(vec2 a)                { return vnegq_f64(a); }
+
+inline static vec2 setr2(double a, double b)        { return vcombine_f64(vdup_n_f64(a), vdup_n_f64(b)); }
+inline static vec2 set2(double a, double b)         { return vcombine_f64(vdup_n_f64(b), vdup_n_f64(a)); }
+inline static vec2 set2(double a)                   { return vdupq_n_f64(a); }
+inline static vec2 setzero2()                       { return vdupq_n_f64(0.0); }
+
+inline static vec2 unpacklo2(vec2 a, vec2 b)        { return vzip1q_f64(a,b); }
+inline static vec2 unpackhi2(vec2 a, vec2 b)        { return vzip2q_f64(a,b); }
+inline static vec2 swap2(vec2 a)                    { return vextq_f64(a, a, 1); }
+
+/// combine and swap to return { low = a[1], high = b[0] }
+inline static vec2 gethilo2(vec2 a, vec2 b)         { return vextq_f64(a, b, 1); }
+
+/// blend to return { low = a[0], high = b[1] }
+inline static vec2 blend11(vec2 a, vec2 b)          { return vcopyq_laneq_f64(a, 1, b, 1); }
+
+/// equivalent to _mm_shuffle_pd(): returns { low = a[k&1], high = b[k>>1] }
+inline static vec2 shuffle2(vec2 a, vec2 b, const int k)
+{
+    return vcombine_f64(( k & 1 ) ? vget_high_f64(a) : vget_low_f64(a),
+                        ( k & 2 ) ? vget_high_f64(b) : vget_low_f64(b));
+}
+
+#endif
+
+//------------------------------- SSE or NEON ----------------------------------
+
+#if VEC2_IS_AVAILABLE
+
 /// returns the sum of the elements, broadcasted
 inline static vec2 esum2(vec2 v)
 {
@@ -347,7 +436,15 @@ inline static vec4 interleave4(vec4 a) { return permute4(permute2f128(a, a, 0x00
 
 //----------------------------------- FMA --------------------------------------
 
-#if defined(__FMA__)
+#if defined(__ARM_NEON) && defined(__aarch64__) && !defined(__SSE3__)
+inline static vec2 fmadd1(vec2 a, vec2 b, vec2 c)  { return vsetq_lane_f64(vgetq_lane_f64(a,0)*vgetq_lane_f64(b,0)+vgetq_lane_f64(c,0), a, 0); }
+inline static vec2 fmsub1(vec2 a, vec2 b, vec2 c)  { return vsetq_lane_f64(vgetq_lane_f64(a,0)*vgetq_lane_f64(b,0)-vgetq_lane_f64(c,0), a, 0); }
+inline static vec2 fnmadd1(vec2 a, vec2 b, vec2 c) { return vsetq_lane_f64(vgetq_lane_f64(c,0)-vgetq_lane_f64(a,0)*vgetq_lane_f64(b,0), a, 0); }
+
+inline static vec2 fmadd2(vec2 a, vec2 b, vec2 c)  { return vfmaq_f64(c,a,b); }  // a * b + c
+inline static vec2 fmsub2(vec2 a, vec2 b, vec2 c)  { return vnegq_f64(vfmsq_f64(c,a,b)); }  // a * b - c
+inline static vec2 fnmadd2(vec2 a, vec2 b, vec2 c) { return vfmsq_f64(c,a,b); }  // c - a * b
+#elif defined(__FMA__)
 inline static vec2 fmadd1(vec2 a, vec2 b, vec2 c)  { return _mm_fmadd_sd(a,b,c); }  // a * b + c
 inline static vec2 fmsub1(vec2 a, vec2 b, vec2 c)  { return _mm_fmsub_sd(a,b,c); }  // a * b - c
 inline static vec2 fnmadd1(vec2 a, vec2 b, vec2 c) { return _mm_fnmadd_sd(a,b,c); } // c - a * b
@@ -0,0 +1,124 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef TILED_INDEX_H
+#define TILED_INDEX_H
+
+#include "assert_macro.h"
+#include <cstdint>
+#include <vector>
+
+
+/// Maps the cells of a grid to compact indices, keeping only the tiles that are occupied
+/**
+ The cells of a grid (see GridBase) are grouped into tiles of TILE cells of
+ consecutive indices. The tiles that contain some object are first marked by mark(),
+ and allocate() then assigns consecutive indices to the cells of these tiles,
+ in the order of the cells. This index is returned by slot().
+
+ All the cells of the empty tiles share the index returned by allocate(), which
+ is also the number of indices. Thus an array of size `allocate()+2`, in which
+ the last two values are equal, can hold the start of the list of each cell,
+ with the list of cell `c` stored at [ start[slot(c)], start[slot(c)+1] [,
+ and the list of the empty cells being empty.
+
+ The memory used is proportional to the number of tiles, plus the number of cells
+ in the occupied tiles, which can be much smaller than the number of cells.
+ */
+class TiledIndex
+{
+public:
+
+    /// type of index
+    typedef unsigned index_t;
+
+    /// log2 of the number of cells in a tile
+    static constexpr unsigned SHIFT = 6;
+
+    /// number of cells in a tile
+    static constexpr index_t TILE = 1 << SHIFT;
+
+private:
+
+    /// value indicating an empty tile
+    static constexpr index_t EMPTY = ~0U;
+
+    /// index of the first cell of each tile, or EMPTY
+    std::vector<index_t> tiles_;
+
+    /// number of indices allocated
+    index_t size_;
+
+public:
+
+    /// constructor
+    TiledIndex() : size_(0) {}
+
+    /// set number of cells, and mark all the tiles as empty
+    void resize(size_t nb_cells)
+    {
+        // EMPTY is passed by value, as it has no definition outside the class:
+        tiles_.assign(( nb_cells + TILE - 1 ) >> SHIFT, index_t(EMPTY));
+        size_ = 0;
+    }
+
+    /// number of tiles
+    size_t nbTiles() const { return tiles_.size(); }
+
+    /// size of the memory allocated, in bytes
+    size_t memory() const { return tiles_.capacity() * sizeof(index_t); }
+
+    /// mark all the tiles as empty
+    void clear()
+    {
+        for ( index_t & t : tiles_ )
+            t = EMPTY;
+        size_ = 0;
+    }
+
+    /// mark the tile containing cell `c` as occupied
+    void mark(index_t c)
+    {
+        assert_true( ( c >> SHIFT ) < tiles_.size() );
+        tiles_[c>>SHIFT] = 0;
+    }
+
+    /// true if the tile containing cell `c` is occupied, valid after allocate()
+    bool occupied(index_t c) const
+    {
+        return tiles_[c>>SHIFT] != EMPTY;
+    }
+
+    /// true if tile `t` is occupied, valid after allocate()
+    bool occupiedTile(index_t t) const
+    {
+        return tiles_[t] != EMPTY;
+    }
+
+    /// assign indices to the cells of the marked tiles, returning the number of indices
+    index_t allocate()
+    {
+        index_t n = 0;
+        for ( index_t & t : tiles_ )
+        {
+            if ( t != EMPTY )
+            {
+                t = n;
+                n += TILE;
+            }
+        }
+        size_ = n;
+        return n;
+    }
+
+    /// number of indices allocated
+    index_t size() const { return size_; }
+
+    /// index of cell `c`, which is `size()` for all the cells of the empty tiles
+    index_t slot(index_t c) const
+    {
+        index_t t = tiles_[c>>SHIFT];
+        return ( t == EMPTY ) ? size_ : t + ( c & ( TILE - 1 ) );
+    }
+};
+
+#endif
@@ -17,8 +17,9 @@
 #include "gle_color_list.h"
 #include "glapp.h"
 #include "glut.h"
+#include "line_batch.h"
 
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 
 //------------------------------------------------------------------------------
@@ -26,13 +27,20 @@ extern Modulo const* modulo;
 
 
 Display::Display(DisplayProp const* dp)
-: pixelSize(1), uFactor(1), sFactor(1), prop(dp)
+: pixelSize(1), uFactor(1), sFactor(1), packLines_(DIM < 3), prop(dp)
 {
     assert_true(dp);
     
     prep_time = -1;
 }
 
+
+Display::~Display()
+{
+    for ( LineBatch * b : lineBatches )
+        delete(b);
+}
+
 void Display::setPixelFactors(GLfloat ps, GLfloat u)
 {
     pixelSize = ps;
@@ -1444,7 +1452,11 @@ void Display::drawFiber(Fiber const& fib)
         else
             fib.prop->disp->back_color.load_back();
         
-        if ( disp->line_style != 1 || disp->style == 0 )
+        if ( packedLines(fib) )
+        {
+            // already drawn by drawFiberLinesPacked()
+        }
+        else if ( disp->line_style != 1 || disp->style == 0 )
             drawFiberLines(fib);
         else if ( disp->style == 1 )
             drawFilament(fib, col1, col2, colE);
@@ -1503,8 +1515,220 @@ void Display::drawFiber(Fiber const& fib)
 }
 
 
+/**
+ This applies to the lines of style 1 to 4, which are drawn by drawFiberLines()
+ without lighting, such that a color can be given for each vertex. The Lines
+ are drawn before all other features of the Fibers, as they would otherwise be.
+ */
+bool Display::packedLines(Fiber const& fib) const
+{
+    FiberDisp const*const disp = fib.prop->disp;
+    if ( !packLines_ || disp->line_style < 1 || disp->line_style > 4 || disp->explode )
+        return false;
+    if ( disp->line_style == 1 && disp->style != 0 )
+        return false;
+#if FIBER_HAS_LATTICE
+    if ( fib.lattice().ready() && disp->lattice_style )
+        return false;
+#endif
+    return true;
+}
+
+
+/**
+ Set `mat` to the product of the current projection and modelview matrices,
+ returning false if the projection is not orthographic.
+ If the scissor test is enabled, as done by SaveImage::saveMagnifiedImage()
+ for each tile of a large image, the scissor box is mapped to [-1, 1],
+ such that only the objects overlapping with the tile are drawn.
+ */
+static bool clipMatrix(GLfloat mat[16])
+{
+    GLfloat mv[16], pj[16];
+    glGetFloatv(GL_MODELVIEW_MATRIX, mv);
+    glGetFloatv(GL_PROJECTION_MATRIX, pj);
+    if ( glIsEnabled(GL_SCISSOR_TEST) )
+    {
+        GLint vp[4], sb[4];
+        glGetIntegerv(GL_VIEWPORT, vp);
+        glGetIntegerv(GL_SCISSOR_BOX, sb);
+        for ( int d = 0; d < 2; ++d )
+        {
+            // the scissor box in normalized device coordinates is [ c-h, c+h ]:
+            GLfloat h = GLfloat(sb[d+2]) / GLfloat(vp[d+2]);
+            GLfloat c = GLfloat(2*(sb[d]-vp[d])+sb[d+2]) / GLfloat(vp[d+2]) - 1;
+            if ( h > 0 )
+            {
+                for ( int k = 0; k < 4; ++k )
+                    pj[4*k+d] = ( pj[4*k+d] - c * pj[4*k+3] ) / h;
+            }
+        }
+    }
+    for ( int c = 0; c < 4; ++c )
+    for ( int r = 0; r < 4; ++r )
+        mat[4*c+r] = pj[r]*mv[4*c] + pj[4+r]*mv[4*c+1] + pj[8+r]*mv[4*c+2] + pj[12+r]*mv[4*c+3];
+    return mat[3] == 0 && mat[7] == 0 && mat[11] == 0 && mat[15] == 1;
+}
+
+
+/// true if the ball of center `cen` and radius `rad` is outside the clip volume
+static bool outsideView(GLfloat const mat[16], Vector const& cen, real rad)
+{
+    GLfloat X = GLfloat(cen.XX), Y = 0, Z = 0;
+#if ( DIM > 1 )
+    Y = GLfloat(cen.YY);
+#endif
+#if ( DIM > 2 )
+    Z = GLfloat(cen.ZZ);
+#endif
+    for ( int r = 0; r < 3; ++r )
+    {
+        GLfloat v = mat[r] * X + mat[4+r] * Y + mat[8+r] * Z + mat[12+r];
+        GLfloat s = GLfloat(rad) * std::sqrt(mat[r]*mat[r] + mat[4+r]*mat[4+r] + mat[8+r]*mat[8+r]);
+        if ( v - s > 1 || v + s < -1 )
+            return true;
+    }
+    return false;
+}
+
+
+/**
+ This follows drawFiberLines(). For the styles 2 and 4, where a color is given
+ for each segment, vertex `n+1` holds the color of segment `n`, as used by OpenGL
+ with GL_FLAT shading, and vertex 0 the color of the first segment.
+ */
+void Display::setLineColors(Fiber const& fib, GLubyte* C) const
+{
+    FiberDisp const*const disp = fib.prop->disp;
+    GLfloat alpha = disp->color.transparency();
+    const unsigned last = fib.lastPoint();
+
+    if ( disp->line_style == 2 )
+    {
+        gle_color col = fib.disp->color;
+        for ( unsigned n = 0; n < last; ++n )
+        {
+            // the Lagrange multipliers are negative under compression
+            real x = fib.tension(n) / disp->tension_scale;
+            if ( x <= 0 )
+                LineBatch::pack(col.inverted().alpha(-x), C+4*n+4);
+            else
+                LineBatch::pack(col.alpha(x), C+4*n+4);
+        }
+        for ( int d = 0; d < 4; ++d )
+            C[d] = C[4+d];
+    }
+    else if ( disp->line_style == 3 )
+    {
+        for ( unsigned n = 1; n < last; ++n )
+            LineBatch::pack(gle_color::jet_color(fib.curvature(n), alpha), C+4*n);
+        if ( last > 1 )
+            LineBatch::pack(gle_color::jet_color(fib.curvature(1), alpha), C);
+        else
+            LineBatch::pack(gle_color::jet_color(0, alpha), C);
+        for ( int d = 0; d < 4; ++d )
+            C[4*last+d] = C[4*last-4+d];
+    }
+    else if ( disp->line_style == 4 )
+    {
+        for ( unsigned n = 0; n < last; ++n )
+            LineBatch::pack(gle::radial_color(fib.dirSegment(n)), C+4*n+4);
+        for ( int d = 0; d < 4; ++d )
+            C[d] = C[4+d];
+    }
+    else
+    {
+        GLubyte col[4];
+        LineBatch::pack(fib.disp->color, col);
+        for ( unsigned n = 0; n <= last; ++n )
+        for ( int d = 0; d < 4; ++d )
+            C[4*n+d] = col[d];
+    }
+}
+
+
+/**
+ The vertices of all the Fibers that share the same FiberDisp are packed
+ in one LineBatch, which is then drawn with one call to glMultiDrawArrays().
+ 
+ The Fibers and the colors of their vertices are first collected in one pass,
+ such that all the properties are read before making the batches.
+ The vertices closer than `DisplayProp::line_error` pixels from the previous one
+ are skipped, and Fibers are culled if their middle is further than half their
+ length from the visible region, using the matrices of OpenGL.
+ */
+void Display::drawFiberLinesPacked(FiberSet const& set)
+{
+    for ( LineBatch * b : lineBatches )
+        b->clear();
+    lineFibers.clear();
+    lineIndex.clear();
+    
+    const real tol = prop->line_error * pixelSize;
+    GLfloat mat[16];
+    const bool cull = ( tol > 0 ) && clipMatrix(mat);
+
+    size_t nbv = 0;
+    for ( Fiber const* fib = set.first(); fib ; fib=fib->next() )
+    {
+        if ( fib->disp->visible && packedLines(*fib) )
+        {
+            if ( cull && outsideView(mat, fib->posMiddle(), 0.5*fib->length()) )
+                continue;
+            FiberDisp const* disp = fib->prop->disp;
+            unsigned i = 0;
+            while ( i < lineDisps.size() && lineDisps[i] != disp )
+                ++i;
+            if ( i == lineDisps.size() )
+            {
+                lineDisps.push_back(disp);
+                lineBatches.push_back(new LineBatch);
+            }
+            lineFibers.push_back(fib);
+            lineIndex.push_back(i);
+            nbv += fib->nbPoints();
+        }
+    }
+    
+    // calculate the colors of all the vertices:
+    lineColors.resize(4*nbv);
+    GLubyte * C = lineColors.data();
+    for ( Fiber const* fib : lineFibers )
+    {
+        setLineColors(*fib, C);
+        C += 4 * fib->nbPoints();
+    }
+    
+    C = lineColors.data();
+    for ( size_t n = 0; n < lineFibers.size(); ++n )
+    {
+        Fiber const* fib = lineFibers[n];
+        lineBatches[lineIndex[n]]->add(fib->data(), fib->nbPoints(), C, 1, tol);
+        C += 4 * fib->nbPoints();
+    }
+    
+    for ( size_t i = 0; i < lineDisps.size(); ++i )
+    {
+        if ( lineBatches[i]->size() )
+        {
+            // the styles 2 and 4 have one color per segment:
+            const bool flat = ( lineDisps[i]->line_style == 2 || lineDisps[i]->line_style == 4 );
+            if ( flat )
+                glShadeModel(GL_FLAT);
+            lineWidth(lineDisps[i]->line_width);
+            lineBatches[i]->draw();
+            if ( flat )
+                glShadeModel(GL_SMOOTH);
+        }
+    }
+}
+
+
 void Display::drawFibers(FiberSet const& set)
 {
+    if ( packLines_ )
+        drawFiberLinesPacked(set);
+    
 #if ( 1 )
     // display Fibers in a random (ever changing) order:
     for ( Fiber const* fib = set.first(); fib ; fib=fib->next() )
@@ -32,6 +32,7 @@ class FiberProp;
 class FiberDisp;
 class PointDisp;
 class LineDisp;
+class LineBatch;
 
 /// defining the DISPLAY keyword enables display code in included files
 #define DISPLAY
@@ -125,6 +126,24 @@ protected:
     
     /// use OpenGL stencil test:
     bool           stencil_;
+    
+    /// if true, the plain lines of Fibers are drawn by drawFiberLinesPacked()
+    bool           packLines_;
+    
+    /// FiberDisp of the lines packed in `lineBatches`, at the same index
+    Array<FiberDisp const*> lineDisps;
+    
+    /// vertices of the Fibers drawn with plain lines, packed for each FiberDisp
+    Array<LineBatch*> lineBatches;
+    
+    /// Fibers whose lines are packed in the current frame
+    Array<Fiber const*> lineFibers;
+    
+    /// index in `lineBatches` of the Fibers in `lineFibers`
+    Array<unsigned> lineIndex;
+    
+    /// colors of the vertices of all Fibers in `lineFibers`, 4 bytes per vertex
+    Array<GLubyte> lineColors;
 
 public:
     
@@ -135,7 +154,7 @@ public:
     Display(DisplayProp const*);
     
     /// virtual destructor needed, as class is base to others
-    virtual ~Display() {}
+    virtual ~Display();
     
     /// display opaque internal objects using OpenGL commands
     virtual void drawSimul(Simul const&);
@@ -228,6 +247,15 @@ public:
     /// display forces acting on the vertices
     void         drawFiberForces(Fiber const&, real scale) const;
     
+    /// true if the backbone of the Fiber is drawn by drawFiberLinesPacked()
+    bool         packedLines(Fiber const&) const;
+    
+    /// set the colors of the vertices of the Fiber, according to `line_style`
+    void         setLineColors(Fiber const&, GLubyte*) const;
+    
+    /// draw the lines of all Fibers, with a few OpenGL calls
+    void         drawFiberLinesPacked(FiberSet const&);
+    
     /// draw all features of Fiber
     virtual void drawFiber(Fiber const&);
     
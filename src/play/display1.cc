@@ -16,7 +16,7 @@
 #include "glut.h"
 
 using namespace gle;
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 //------------------------------------------------------------------------------
 
@@ -17,7 +17,7 @@
 #include "glut.h"
 
 using namespace gle;
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 
 #define ENABLE_EXPLODE_DISPLAY ( DIM < 3 )
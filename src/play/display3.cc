@@ -16,11 +16,13 @@
 #include "gle.h"
 
 using namespace gle;
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 
 Display3::Display3(DisplayProp const* dp) : Display(dp)
 {
+    // fibers are drawn as tubes by Display3::drawFiberLines()
+    packLines_ = false;
 }
 
 //------------------------------------------------------------------------------
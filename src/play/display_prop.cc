@@ -18,6 +18,7 @@ void DisplayProp::clear()
     point_size     = 5;
     link_width     = 4;
     line_width     = 2;
+    line_error     = 0.5;
 }
 
 //------------------------------------------------------------------------------
@@ -45,6 +46,7 @@ void DisplayProp::read(Glossary& glos)
     if ( glos.set(line_width, "line_width") )
         link_width = line_width;
     glos.set(link_width,    "link_width") || glos.set(link_width, "link_size");
+    glos.set(line_error,    "line_error");
 }
 
 
@@ -61,6 +63,7 @@ void DisplayProp::write_values(std::ostream& os) const
     write_value(os, "point_size",    point_size);
     write_value(os, "link_width",    link_width);
     write_value(os, "line_width",    line_width);
+    write_value(os, "line_error",    line_error);
 }
 
 
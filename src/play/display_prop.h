@@ -63,6 +63,17 @@ public:
      */
     float          point_value;
     
+    /// maximum error allowed when simplifying the lines of the Fibers, in pixels
+    /**
+     When the view is zoomed out, the vertices of a Fiber that would be displayed
+     closer than `line_error` pixels from the previous vertex are skipped, and
+     the Fibers that are entirely outside the view are not drawn.
+     This applies to the Fibers displayed with plain lines in 2D.
+     Set to zero to draw all vertices.
+     <em> default = 0.5 </em>
+     */
+    float          line_error;
+    
     /// selection bitfield for Couples
     unsigned       couple_select;
     
@@ -4,6 +4,8 @@
 #include "exceptions.h"
 #include "iowrapper.h"
 #include "simul.h"
+#include <fcntl.h>
+#include <unistd.h>
 
 
 // Use the second definition to get some verbose reports:
@@ -16,6 +18,11 @@ FrameReader::FrameReader() : inputter(DIM)
 {
     frameIndex = 0;
     lastLoaded = ~0;
+    loadMask = ~0U;
+    prefetchCnt = 0;
+    prefetchStop = false;
+    for ( int i = 0; i < 4; ++i )
+        prefetchReq[i] = 0;
 }
 
 
@@ -28,6 +35,7 @@ void FrameReader::clear()
 
 void FrameReader::openFile(std::string const& file)
 {
+    stopPrefetch();
     int error = inputter.open(file.c_str(), "rb");
     
     if ( error )
@@ -53,8 +61,12 @@ void FrameReader::openFile(std::string const& file)
         throw InvalidIO("file `"+file+"' is invalid");
  
     inputter.vectorSize(DIM);
+    // decode the data directly from memory, if possible:
+    inputter.map();
     clearPositions();
     //std::clog << "FrameReader: has openned " << obj_file << std::endl;
+    if ( prefetchCnt > 0 )
+        prefetch(prefetchCnt);
 }
 
 
@@ -102,7 +114,13 @@ void FrameReader::clearPositions()
     {
         framePos[0].status = 1;
         framePos[0].position = pos;
+        // load or build the index of frames:
+        index.load(inputter.file(), inputter.path());
+        VLOG("FrameReader: index has " << index.size() << " frames\n");
+        inputter.set_pos(pos);
     }
+    else
+        index.clear();
 }
 
 
@@ -143,6 +161,21 @@ size_t FrameReader::seekPos(size_t frm)
     if ( inputter.eof() )
         inputter.clear();
     
+    // use the index, unless a closer position is known:
+    size_t sup = std::min(frm, index.size()-1);
+    if ( 0 < sup && sup < index.size() )
+    {
+        size_t inx = framePos.empty() ? 0 : std::min(frm, framePos.size()-1);
+        while ( inx > sup  &&  framePos[inx].status == 0 )
+            --inx;
+        if ( inx <= sup )
+        {
+            VLOG("FrameReader: using indexed position of frame " << sup << '\n');
+            inputter.seek(index.offset(sup));
+            return sup;
+        }
+    }
+
     if ( frm < 1 || framePos.empty() )
     {
         VLOG("FrameReader: seekPos rewind\n");
@@ -172,14 +205,119 @@ size_t FrameReader::seekPos(size_t frm)
 
 size_t FrameReader::lastKnownFrame() const
 {
-    if ( framePos.empty() )
-        return 0;
-    size_t res = framePos.size()-1;
-    while ( 0 < res  &&  framePos[res].status < 2 )
-        --res;
+    size_t res = index.size() ? index.size()-1 : 0;
+    if ( framePos.size() > res + 1 )
+    {
+        size_t i = framePos.size()-1;
+        while ( res < i  &&  framePos[i].status < 2 )
+            --i;
+        res = i;
+    }
     return res;
 }
 
+//------------------------------------------------------------------------------
+#pragma mark - Prefetch
+
+/**
+ The thread uses its own file descriptor, and not the memory mapping of `inputter`,
+ which can be replaced at any time by Inputter::remap(). The pages read here
+ are shared with the mapping, through the page cache of the system.
+ */
+void FrameReader::prefetch(size_t cnt)
+{
+    stopPrefetch();
+    prefetchCnt = cnt;
+    if ( cnt > 0 && inputter.file() )
+    {
+        int fd = open(inputter.path(), O_RDONLY);
+        if ( fd >= 0 )
+        {
+            prefetchStop = false;
+            prefetcher = std::thread(&FrameReader::prefetchLoop, this, fd);
+            if ( frameIndex == lastLoaded )
+                prefetchAround(frameIndex);
+        }
+    }
+}
+
+
+void FrameReader::stopPrefetch()
+{
+    if ( prefetcher.joinable() )
+    {
+        {
+            std::lock_guard<std::mutex> lock(prefetchMutex);
+            prefetchStop = true;
+        }
+        prefetchCond.notify_one();
+        prefetcher.join();
+    }
+    for ( int i = 0; i < 4; ++i )
+        prefetchReq[i] = 0;
+}
+
+
+/**
+ The region ahead of the current frame is read first, by chunks, such that
+ a new request is taken into account quickly.
+ */
+void FrameReader::prefetchLoop(int fd)
+{
+    constexpr size_t CHUNK = 1 << 20;
+    char * buf = new char[CHUNK];
+    std::unique_lock<std::mutex> lock(prefetchMutex);
+    while ( !prefetchStop )
+    {
+        int k = ( prefetchReq[0] < prefetchReq[1] ) ? 0 : 2;
+        if ( prefetchReq[k] >= prefetchReq[k+1] )
+        {
+            prefetchCond.wait(lock);
+            continue;
+        }
+        off_t off = prefetchReq[k];
+        size_t len = std::min(CHUNK, (size_t)( prefetchReq[k+1] - off ));
+        prefetchReq[k] = off + len;
+        lock.unlock();
+        ssize_t n = pread(fd, buf, len, off);
+        lock.lock();
+        // abandon this region on error:
+        if ( n <= 0 )
+            prefetchReq[k] = prefetchReq[k+1];
+    }
+    delete[] buf;
+    close(fd);
+}
+
+
+/**
+ The regions that were partly read for the previous frame are continued,
+ rather than read again from the start.
+ */
+void FrameReader::prefetchAround(size_t frm)
+{
+    // at most this number of bytes is read on each side of the current frame:
+    constexpr off_t LIMIT = 1 << 28;
+    
+    if ( !prefetcher.joinable() || index.empty() || frm >= index.size() )
+        return;
+    const size_t sup = index.size() - 1;
+    off_t a = index.end(frm);
+    off_t b = std::min(index.end(std::min(frm+prefetchCnt, sup)), a + LIMIT);
+    off_t d = index.offset(frm);
+    off_t c = std::max(index.offset(frm > prefetchCnt ? frm-prefetchCnt : 0), d - LIMIT);
+    {
+        std::lock_guard<std::mutex> lock(prefetchMutex);
+        if ( prefetchReq[0] < a || b < prefetchReq[0] )
+            prefetchReq[0] = a;
+        prefetchReq[1] = b;
+        if ( prefetchReq[2] < c || d < prefetchReq[2] )
+            prefetchReq[2] = c;
+        prefetchReq[3] = d;
+    }
+    prefetchCond.notify_one();
+}
+
 //------------------------------------------------------------------------------
 #pragma mark -
 
@@ -270,7 +408,7 @@ int FrameReader::loadFrame(Simul& sim, size_t frm, const bool reload)
     //VLOG("FrameReader: reading frame " << frm << '\n');
     
     // ask cytosim to read the file:
-    if ( !sim.reloadObjects(inputter) )
+    if ( !sim.reloadObjects(inputter, loadMask) )
     {
         VLOG("FrameReader: loadFrame("<< frm <<") successful\n");
         frameIndex = frm;
@@ -280,6 +418,11 @@ int FrameReader::loadFrame(Simul& sim, size_t frm, const bool reload)
         // the next frame should start at the current position:
         if ( 0 == inputter.get_pos(pos) )
             savePos(frameIndex+1, pos, 1);
+        prefetchAround(frameIndex);
+        // a delta frame is applied to the preceding complete frame:
+        size_t del = sim.frameDelta();
+        if ( del > 0 && del <= frm )
+            return loadDeltas(sim, frm-del, frm);
         return SUCCESS;
     }
     else
@@ -290,6 +433,26 @@ int FrameReader::loadFrame(Simul& sim, size_t frm, const bool reload)
 }
 
 
+/**
+ Load the complete frame `key`, and the delta frames that follow it up to `frm`
+ */
+int FrameReader::loadDeltas(Simul& sim, size_t key, size_t frm)
+{
+    int res = loadFrame(sim, key, true);
+    if ( res != SUCCESS )
+        return res;
+    if ( sim.frameDelta() > 0 )
+        throw InvalidIO("missing complete frame before delta frame");
+    while ( frameIndex < frm )
+    {
+        res = loadNextFrame(sim);
+        if ( res != SUCCESS )
+            return res;
+    }
+    return SUCCESS;
+}
+
+
 /**
  returns 0 for success, an error code, or throws an exception
  */
@@ -301,7 +464,7 @@ int FrameReader::loadNextFrame(Simul& sim)
     fpos_t pos;
     bool has_pos = !inputter.get_pos(pos);
 
-    if ( !sim.reloadObjects(inputter) )
+    if ( !sim.reloadObjects(inputter, loadMask) )
     {
         if ( lastLoaded == frameIndex )
             ++frameIndex;
@@ -316,6 +479,7 @@ int FrameReader::loadNextFrame(Simul& sim)
         // the next frame should start from the current position:
         if ( !inputter.get_pos(pos) )
             savePos(frameIndex+1, pos, 1);
+        prefetchAround(frameIndex);
         return SUCCESS;
     }
     else
@@ -335,34 +499,27 @@ int FrameReader::loadLastFrame(Simul& sim, size_t cnt)
         return BAD_FILE;
     
     /// seek last known position:
-    size_t frm = lastKnownFrame();
-    if ( frm > 1 )
-        inputter.set_pos(framePos[frm].position);
-    else
-        inputter.rewind();
+    size_t frm = seekPos(lastKnownFrame());
     
     /// go from here to last frame:
     int res = NOT_FOUND;
-    while ( !sim.reloadObjects(inputter) )
+    bool delta = false;
+    while ( !sim.reloadObjects(inputter, loadMask) )
     {
+        // a delta frame is only valid if the preceding frame was loaded:
+        if ( res != SUCCESS && sim.frameDelta() > 0 )
+            delta = true;
         frameIndex = frm++;
         lastLoaded = frameIndex;
         res = SUCCESS;
     }
     
-    if ( res == SUCCESS && cnt > 0 )
+    // go back up by 'cnt' frames:
+    if ( res == SUCCESS && ( delta || cnt > 0 ))
     {
-        frm = frm - 1 - cnt;
-        // go back up by 'cnt' frames:
-        if ( SUCCESS != seekFrame(frm) )
-            return NOT_FOUND;
-        
-        if ( !sim.reloadObjects(inputter) )
+        if ( cnt > frameIndex )
             return NOT_FOUND;
-
-        frameIndex = frm;
-        lastLoaded = frameIndex;
-        VLOG("FrameReader: loadFrame("<< frm <<") successful\n");
+        return loadFrame(sim, frameIndex-cnt, true);
     }
     
     return res;
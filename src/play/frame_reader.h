@@ -1,7 +1,11 @@
 // Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
 
 #include "iowrapper.h"
+#include "frame_index.h"
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 class Simul;
 
@@ -20,6 +24,18 @@ class Simul;
  - loadFrame() calls Simul::reloadObjects() to read the content of the frame.
  .
  
+ The positions recorded in the index file 'objects.cmo.idx' are loaded when the
+ file is opened, giving direct access to these frames (see FrameIndex).
+ The index file is created if it is missing.
+ 
+ A delta frame (see SimulProp::delta_frames) is only valid if the preceding frame
+ was loaded before. Otherwise, loadFrame() loads the preceding complete frame,
+ and all the delta frames up to the requested one.
+ 
+ After prefetch() is called, a thread reads the frames that follow and precede
+ the last frame loaded, such that their data is in the page cache of the system
+ when they are needed. This avoids waiting for the disk during playback.
+ 
  Frames are recorded starting at index 0.
 */
 class FrameReader
@@ -44,18 +60,54 @@ private:
     /// starting position for each frame
     PosList  framePos;
     
+    /// positions of the frames recorded in the index file
+    FrameIndex index;
+    
     /// index of frame stored currently
     size_t   frameIndex;
     
     /// last frame loaded successfully
     size_t   lastLoaded;
     
+    /// classes of objects that are loaded (see Simul::setMask)
+    unsigned loadMask;
+    
+    /// number of frames read ahead and behind the current frame by `prefetcher`
+    size_t   prefetchCnt;
+    
+    /// thread reading the frames near the current frame
+    std::thread prefetcher;
+    
+    /// protects `prefetchReq` and `prefetchStop`
+    std::mutex prefetchMutex;
+    
+    /// signals a change of `prefetchReq` or `prefetchStop`
+    std::condition_variable prefetchCond;
+    
+    /// regions of the file to be read by `prefetcher`: [0,1[ ahead and [2,3[ behind
+    off_t    prefetchReq[4];
+    
+    /// true when `prefetcher` should terminate
+    bool     prefetchStop;
+    
+    /// function run by `prefetcher`, reading from file descriptor `fd`
+    void     prefetchLoop(int fd);
+    
+    /// request the frames near frame `frm` to be read
+    void     prefetchAround(size_t frm);
+    
+    /// terminate `prefetcher`
+    void     stopPrefetch();
+    
     /// remember position `pos` as the place where frame `frm` should start
     void     savePos(size_t frm, const fpos_t& pos, int status);
    
     /// go to a position where a frame close to `frm` is known to start
     size_t   seekPos(size_t frm);
     
+    /// load complete frame `key` and the delta frames following it, up to `frm`
+    int      loadDeltas(Simul&, size_t key, size_t frm);
+    
     /// check file validity
     void     checkFile();
     
@@ -67,15 +119,24 @@ public:
     /// constructor, after which openFile() should be called
     FrameReader();
     
+    /// destructor
+    ~FrameReader() { stopPrefetch(); }
+    
     /// open file for input
     void     openFile(std::string const& file);
     
     /// clear the buffer
     void     clearPositions();
     
+    /// start reading `cnt` frames ahead and behind the current frame, in the background
+    void     prefetch(size_t cnt);
+    
     /// last frame seen in the file
     size_t   lastKnownFrame() const;
     
+    /// positions of the frames, as recorded in the index file
+    FrameIndex const& frames() const { return index; }
+    
     /// return state of file object
     bool     hasFile() { return inputter.file(); }
     
@@ -91,6 +152,9 @@ public:
     /// dimensionality of vectors
     unsigned vectorSize() const { return inputter.vectorSize(); }
 
+    /// load only the classes of objects selected by `mask` (see Simul::setMask)
+    void     selectClasses(unsigned mask) { loadMask = mask; }
+
     /// rewind file and clear position buffer
     void     clear();
     
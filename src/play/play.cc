@@ -13,6 +13,8 @@
 #include "player.h"
 #include "view.h"
 #include "gle.h"
+#include <unistd.h>
+#include <sys/wait.h>
 
 Player player;
 
@@ -68,6 +70,9 @@ void displayLive(View& view)
         player.prepareDisplay(view, 1);
         player.displayCytosim();
         thread.unlock();
+        // a free simulation continues as soon as it is drawn:
+        if ( thread.freeRunning() )
+            thread.signal();
     }
     else
     {
@@ -106,6 +111,7 @@ void help(std::ostream& os)
 {
     os << "play [OPTIONS] [PATH] [FILE]\n"
           "     live                     enter live simulation mode directly\n"
+          "     attach=NAME              display a simulation publishing to shared memory NAME\n"
           "     PATH                     change working directory as specified\n"
           "     FILE.cym                 specify input configuration file\n"
           "     FILE.cmo                 specify trajectory file\n"
@@ -117,6 +123,7 @@ void help(std::ostream& os)
           "     movie                    render all frames off screen\n"
           "     movie=on                 render all frames on screen\n"
           "     movie period=INT         render one frame every INT frames\n"
+          "     movie jobs=INT           render the movie with INT processes in parallel\n"
           " (there should be no whitespace around the equal sign)\n";
 }
 
@@ -129,6 +136,7 @@ int main(int argc, char* argv[])
 {
     int mode = ONSCREEN;
     int magnify = 1;
+    unsigned jobs = 1, job = 0;
     Glossary arg;
     
     Cytosim::out.silent();
@@ -162,6 +170,10 @@ int main(int argc, char* argv[])
     if ( arg.use_key("live") || arg.has_key(".cym") )
         player.goLive = true;
     
+    // name of the shared memory where a running simulation publishes its state:
+    std::string attach;
+    arg.set(attach, "attach");
+    
     if ( arg.use_key("image") )
         mode = OFFSCREEN_IMAGE;
 
@@ -178,6 +190,11 @@ int main(int argc, char* argv[])
     
     // get image over-sampling:
     arg.set(magnify, "magnify") || arg.set(magnify, "magnification");
+    
+    // number of processes rendering an off-screen movie:
+    arg.set(jobs, "jobs");
+    if ( mode != OFFSCREEN_MOVIE || jobs < 1 )
+        jobs = 1;
 
     // change working directory if specified:
     if ( arg.has_key("directory") )
@@ -224,7 +241,8 @@ int main(int argc, char* argv[])
     try
     {
         // read config file, to get the name of 'simul' and simul:display
-        Parser(simul, 0, 1, 0, 0, 0).readConfig(file);
+        if ( attach.empty() )
+            Parser(simul, 0, 1, 0, 0, 0).readConfig(file);
 
         // check for play's configuration file specified on the command line:
         if ( arg.set(setup, ".cyp") )
@@ -256,7 +274,13 @@ int main(int argc, char* argv[])
     
     //---------Open trajectory file and read state
 
-    if ( ! player.goLive || has_frame )
+    if ( attach.size() )
+    {
+        // the properties and objects are read from the shared memory:
+        thread.attach(attach);
+        thread.loadShared();
+    }
+    else if ( ! player.goLive || has_frame )
     {
         try
         {
@@ -287,6 +311,47 @@ int main(int argc, char* argv[])
         }
     }
     
+    /*
+     The processes are created before any connection to the window system,
+     and each opens the trajectory file again, to read it independently.
+     Process `job` renders the images of index `job`, `job+jobs`, etc.
+     */
+    std::vector<pid_t> children;
+    if ( jobs > 1 )
+    {
+        // a thread would not be duplicated by fork():
+        thread.prefetch(0);
+        fflush(nullptr);
+    }
+    for ( unsigned j = 1; j < jobs; ++j )
+    {
+        pid_t pid = fork();
+        if ( pid < 0 )
+        {
+            std::cerr << "Warning: could only start " << j << " processes\n";
+            jobs = j;
+            break;
+        }
+        if ( pid == 0 )
+        {
+            job = j;
+            children.clear();
+            break;
+        }
+        children.push_back(pid);
+    }
+    if ( jobs > 1 )
+    {
+        try {
+            thread.openFile(simul.prop->trajectory_file);
+        }
+        catch( Exception & e )
+        {
+            print_magenta(std::cerr, e.brief());
+            return EXIT_FAILURE;
+        }
+    }
+
 #ifndef __APPLE__
     // it is necessary under Linux/Windows to initialize GLUT to display fonts
     glutInit(&argc, argv);
@@ -341,6 +406,18 @@ int main(int argc, char* argv[])
                 }
             } while ( arg.set(frm, "frame", ++inx) );
         }
+        else if ( mode == OFFSCREEN_MOVIE && jobs > 1 )
+        {
+            // image `frm+i` is frame `frm+i*period`, and this process renders every `jobs` image:
+            const size_t P = std::max(1U, prop.period);
+            for ( size_t i = job; 0 == thread.loadFrame(frm+i*P); i += jobs )
+            {
+                displayOffscreen(view, magnify);
+                if ( multi )
+                    blitBuffers(fbo, multi, W, H);
+                player.saveViewLater("movie", frm+i, 1);
+            }
+        }
         else if ( mode == OFFSCREEN_MOVIE )
         {
             // save every prop.period
@@ -351,19 +428,29 @@ int main(int argc, char* argv[])
                     displayOffscreen(view, magnify);
                     if ( multi )
                         blitBuffers(fbo, multi, W, H);
-                    player.saveView("movie", frm++, 1);
+                    player.saveViewLater("movie", frm++, 1);
                     s = 0;
                 }
             } while ( 0 == thread.loadNextFrame() );
         }
+        // wait for the files of the last images:
+        int err = SaveImage::finishImages();
         if ( simul.prop->verbose > 0 )
             printf("\n");
         if ( multi )
             OffScreen::releaseBuffer();
         OffScreen::releaseBuffer();
         OffScreen::closeContext();
-        arg.print_warning(std::cerr, 1, "\n");
-        return EXIT_SUCCESS;
+        int res = err ? EXIT_FAILURE : EXIT_SUCCESS;
+        for ( pid_t pid : children )
+        {
+            int status = 0;
+            if ( waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) )
+                res = EXIT_FAILURE;
+        }
+        if ( job == 0 )
+            arg.print_warning(std::cerr, 1, "\n");
+        return res;
     }
     
     arg.print_warning(std::cerr, 1, "\n");
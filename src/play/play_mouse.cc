@@ -77,7 +77,13 @@ void timerCallback(const int value)
             thread.unlock();
         }
         
-        thread.signal();
+        thread.proceed(prop.full_speed);
+    }
+    else if ( thread.attached() )
+    {
+        // display the last state published by the simulation, if it is new:
+        if ( 0 == thread.loadShared() )
+            glApp::postRedisplay();
     }
     else if ( prop.play )
     {
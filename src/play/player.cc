@@ -145,6 +145,7 @@ void Player::accelerate()
 void Player::stop()
 {
     goLive = 0;
+    thread.pause();
     prop.play = 0;
     prop.save_images = 0;
 }
@@ -153,7 +154,11 @@ void Player::stop()
 void Player::startstop()
 {
     if ( thread.alive() )
+    {
         goLive = !goLive;
+        if ( !goLive )
+            thread.pause();
+    }
     else if ( thread.goodFile() )
     {
         if ( !prop.play )
@@ -152,6 +152,9 @@ public:
 
     /// export current viewport to a graphic file
     int  saveView(const char* root, size_t indx, int downsample) const;
+
+    /// export current viewport to a graphic file, written while the next image is rendered
+    int  saveViewLater(const char* root, size_t indx, int downsample) const;
     
     /// save high-resolution image of the current scene
     int  saveScene(int mag, const char* filename, const char* format, int downsample=1);
@@ -17,7 +17,7 @@
 
 extern void helpKeys(std::ostream&);
 
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 //------------------------------------------------------------------------------
 #pragma mark -
@@ -152,11 +152,13 @@ void Player::autoTrack(FiberSet const& fibers, View& view)
     Vector G(0, 0, 0);
     Vector D(0, 0, 0);
     real vec[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+    // collect the fibers once for all the criteria:
+    ObjectList objs = fibers.collect();
     
     if ( view.track_fibers & 1 )
     {
         Vector M, P;
-        FiberSet::infoPosition(fibers.collect(), M, G, P);
+        FiberSet::infoPosition(objs, M, G, P);
         view.move_shift(Vector3(G));
         //std::clog << "auto center: " << G << std::endl;
     }
@@ -164,7 +166,7 @@ void Player::autoTrack(FiberSet const& fibers, View& view)
     if ( view.track_fibers & 2 )
     {
         // align with mean nematic direction
-        FiberSet::infoNematic(fibers.collect(), vec);
+        FiberSet::infoNematic(objs, vec);
         view.align_with(Vector3(vec));
         //view.rotation.setFromMatrix3(vec);
         //view.rotation.conjugate();
@@ -176,7 +178,7 @@ void Player::autoTrack(FiberSet const& fibers, View& view)
         real sum = 0;
         real avg[3] = { 0 };
         real mom[9] = { 0 };
-        FiberSet::infoComponents(fibers.collect(), sum, avg, mom, vec);
+        FiberSet::infoComponents(objs, sum, avg, mom, vec);
         // get rotation from matrix:
         view.rotation.setFromMatrix3(vec);
         // inverse rotation:
@@ -208,6 +210,9 @@ void Player::prepareDisplay(View& view, int mag)
 {    
     //gle::gleReportErrors(stderr, "before prepareDisplay");
     
+    // the simulation may run in another thread, with its own boundary conditions:
+    simul.spaces.setMaster(simul.spaces.master());
+
     //----------------- automatic adjustment of viewing area:
 
     if ( view.auto_scale > 0 )
@@ -360,6 +365,30 @@ int Player::saveView(const char* root, size_t indx, int downsample) const
     return err;
 }
 
+
+/**
+ Same as saveView(), but the pixels are transferred asynchronously, and
+ the file is written by a thread. SaveImage::finishImages() must be called
+ afterwards, while the OpenGL context is still valid.
+ */
+int Player::saveViewLater(const char* root, size_t indx, int downsample) const
+{
+    char const* fmt = prop.image_format.c_str();
+    char str[1024] = { 0 };
+    snprintf(str, sizeof(str), "%s%04lu.%s", root, indx, fmt);
+    GLint vp[4];
+    glGetIntegerv(GL_VIEWPORT, vp);
+    int cwd = FilePath::change_dir(prop.image_dir, true);
+    int err = SaveImage::saveImageLater(str, fmt, vp, downsample);
+    FilePath::change_dir(cwd);
+    if ( err == 0 && simul.prop->verbose > 0 )
+    {
+        printf("\r saving snapshot %s    ", str);
+        fflush(stdout);
+    }
+    return err;
+}
+
 //------------------------------------------------------------------------------
 
 void displayMagnified(int mag, void * arg)
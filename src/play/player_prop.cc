@@ -12,6 +12,7 @@ void PlayerProp::clear()
     exit_at_eof  = false;
     period       = 1;
     delay        = 32;
+    full_speed   = false;
 
     report_index = 0;
 
@@ -42,6 +43,7 @@ void PlayerProp::read(Glossary& glos)
         period = std::max(1u, period);
     if ( glos.set(delay,   "delay") )
         delay = std::max(2u, delay);
+    glos.set(full_speed,   "full_speed");
     glos.set(save_images,  "save_images");
     glos.set(image_format, "image_format");
     glos.set(image_dir,    "image_dir");
@@ -68,6 +70,7 @@ void PlayerProp::write_values(std::ostream& os) const
     write_value(os, "loop",   loop);
     write_value(os, "period", period);
     write_value(os, "delay",  delay);
+    write_value(os, "full_speed", full_speed);
     write_value(os, "report", report);
     write_value(os, "save_images", save_images);
     write_value(os, "image_format", image_format);
@@ -38,6 +38,16 @@ public:
     /// number of milli-seconds between refresh
     unsigned int   delay;
     
+    /// if true, a live simulation is not halted between refreshes
+    /**
+     By default, a live simulation halts every `period` steps until the next
+     refresh, which occurs after `delay` milli-seconds, limiting its speed.
+     If `full_speed` is set, the simulation continues until the display
+     needs to be refreshed, and is only halted while it is drawn.
+     `period` is then the minimum number of steps between two drawings.
+     */
+    bool           full_speed;
+    
     /// specifies information displayed near the bottom left corner of window
     std::string    report;
 
@@ -6,6 +6,7 @@
 #include <cstdio>
 #include <time.h>
 #include "sim_thread.h"
+#include "shared_frame.h"
 #include "exceptions.h"
 #include "print_color.h"
 #include "picket.h"
@@ -20,10 +21,14 @@
 SimThread::SimThread(Simul& sim, void (*callback)(void))
 : Parser(sim, 1, 1, 1, 1, 0), hold_callback(callback)
 {
+    shared_ = nullptr;
+    sharedStamp_ = 0;
     hasChild = false;
     mFlag   = 0;
     mHold   = 0;
     mPeriod = 1;
+    mFree   = false;
+    mRequest = false;
     pthread_mutex_init(&mMutex, nullptr);
     pthread_cond_init(&mCondition, nullptr);
 }
@@ -38,6 +43,7 @@ SimThread::~SimThread()
 {
     //std::cerr << "~SimThread()\n";
     stop();
+    delete(shared_);
     pthread_cond_destroy(&mCondition);
     pthread_mutex_destroy(&mMutex);
 }
@@ -64,6 +70,12 @@ void SimThread::gubed(const char* msg) const
 }
 
 
+/**
+ The thread halts every `period` calls, and waits to be signaled by the display.
+ If the thread was set free by proceed(), it only halts if the display has asked
+ for access to the simulation since the last halt, such that the simulation
+ is not slowed down by the refresh rate of the display.
+ */
 void SimThread::hold()
 {
     assert_true( isChild() );
@@ -73,7 +85,10 @@ void SimThread::hold()
     
     if ( ++mHold >= mPeriod )
     {
+        if ( mFree && !mRequest )
+            return;
         mHold = 0;
+        mRequest = false;
         //debug("holding");
         hold_callback();
         if ( mFlag )
@@ -515,6 +530,51 @@ void SimThread::exportObjects(bool binary)
 }
 
 
+/**
+ The simulation may not have started yet, in which case loadShared() will
+ try again to open the shared memory.
+ */
+void SimThread::attach(std::string const& name)
+{
+    if ( !shared_ )
+        shared_ = new SharedFrame;
+    shared_->attach(name);
+    sharedStamp_ = 0;
+    sharedProps_.clear();
+}
+
+
+/**
+ The properties are only parsed if they differ from those of the last state,
+ and the frame is then read from memory, as it would be read from a file.
+ */
+int SimThread::loadShared()
+{
+    std::string props, frame;
+    if ( !shared_ || shared_->read(sharedStamp_, props, frame) )
+        return 1;
+    int res = 0;
+    lock();
+    try {
+        if ( props != sharedProps_ )
+        {
+            // new properties are created first, and existing ones are changed later:
+            Parser(simul, sharedProps_.empty(), 1, 0, 0, 0).evaluate(props);
+            sharedProps_.swap(props);
+        }
+        Inputter in(DIM);
+        in.memory(frame.data(), frame.size());
+        res = simul.reloadObjects(in);
+    }
+    catch( Exception & e ) {
+        std::cerr << "Error reading shared memory: " << e.what() << '\n';
+        res = 2;
+    }
+    unlock();
+    return res;
+}
+
+
 void SimThread::writeProperties(std::ostream& os, bool prune)
 {
     lock();
@@ -7,6 +7,8 @@
 #include "parser.h"
 #include "frame_reader.h"
 
+class SharedFrame;
+
 
 /// SimThread is used to run a simulation in a dedicated thread
 class SimThread : private Parser
@@ -21,6 +23,15 @@ private:
 
     /// reader used to access frames in a trajectory file
     FrameReader     reader_;
+    
+    /// shared memory from which the states of a running simulation are read
+    SharedFrame   * shared_;
+    
+    /// identifies the last state read from `shared_`
+    uint64_t        sharedStamp_;
+    
+    /// properties of the last state read from `shared_`
+    std::string     sharedProps_;
 
     
     /// callback invoked when the thread is halted, set in constructor
@@ -46,6 +57,12 @@ private:
     
     /// period for hold()
     unsigned int    mPeriod;
+    
+    /// if true, hold() only halts the thread if `mRequest` is set
+    volatile bool   mFree;
+    
+    /// set when the display needs access to the simulation state
+    volatile bool   mRequest;
 
     
     /// the current Single being controlled with the mouse
@@ -128,6 +145,15 @@ public:
     /// set how many 'hold()' are necessary to halt the thread
     void       period(unsigned int c) { mPeriod = c; }
     
+    /// let the thread continue, for `period` steps, or at full speed until the next call if `free`
+    void       proceed(bool free) { mFree = free; mRequest = true; signal(); }
+    
+    /// halt the thread at the next 'hold()', even if it was set free by `proceed()`
+    void       pause() { mFree = false; }
+    
+    /// true if the thread was set free by `proceed()`
+    bool       freeRunning() const { return mFree; }
+    
     /// true if child thread is running
     bool       alive() const { return hasChild; }
     
@@ -169,7 +195,10 @@ public:
 
     
     /// open trajectory file for input
-    void       openFile(std::string const& name) { reader_.openFile(name); }
+    void       openFile(std::string const& name) { reader_.openFile(name); reader_.prefetch(16); }
+    
+    /// read `cnt` frames around the current frame in the background (see FrameReader)
+    void       prefetch(size_t cnt) { reader_.prefetch(cnt); }
     
     /// true if ready to read from file
     bool       goodFile()     const { return reader_.good(); }
@@ -191,6 +220,16 @@ public:
 
     /// index of current frame
     size_t     currentFrame() const { return reader_.currentFrame(); }
+    
+    
+    /// read the states published by a simulation in shared memory `name` (see SimulProp::publish)
+    void       attach(std::string const& name);
+    
+    /// true if attach() was called
+    bool       attached() const { return shared_; }
+    
+    /// load the last state published in shared memory, returning 0 if a new state was loaded
+    int        loadShared();
 
     
     /// return the Single that is manipulated by the User
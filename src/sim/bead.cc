@@ -60,7 +60,7 @@ void Bead::setInteractions(Meca & meca) const
             {
                 // Confine only the center
                 Vector cen(pPos);
-                if ( ! spc->inside(cen) )
+                if ( ! spc->isInside(cen) )
                     spc->setInteraction(cen, Mecapoint(this, 0), meca, prop->confine_stiffness);
             } break;
                 
@@ -68,7 +68,7 @@ void Bead::setInteractions(Meca & meca) const
             {
                 // confine the center outside
                 Vector cen(pPos);
-                if ( spc->inside(cen) )
+                if ( spc->isInside(cen) )
                     spc->setInteraction(cen, Mecapoint(this, 0), meca, prop->confine_stiffness);
             } break;
                 
@@ -18,7 +18,7 @@
 #include "vecprint.h"
 
 
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 /**
  This returns N+1, where N is the integer that minimizes
@@ -52,6 +52,7 @@ real Chain::contourLength(const real* pts, unsigned n_pts)
 Chain::Chain()
 {
     fnCut          = 0;
+    fnCutInv       = 0;
     fnSegmentation = 0;
     fnAbscissaM    = 0;
     fnAbscissaP    = 0;
@@ -1211,6 +1212,9 @@ void Chain::resegment(unsigned ns)
      length / NS < 4/3 * segmentation
      length / NS > 2/3 * segmentation
 
+ The vertices are only recalculated if NS changes. Since all segments have the
+ same length, this displaces all the vertices, even if the length has changed
+ at one end only, and all the Hands are then relocated by updateFiber().
  */
 void Chain::adjustSegmentation()
 {
@@ -1420,7 +1424,7 @@ Interpolation Chain::interpolateCenter() const
  */
 Interpolation Chain::interpolateM(const real ab) const
 {
-    real a = std::max(ab, 0.0) / fnCut;
+    real a = std::max(ab, 0.0) * fnCutInv;
     //beyond the last point, we interpolate the PLUS_END
     unsigned s = std::min((unsigned)a, nPoints-2);
     return Interpolation(this, s, s+1, std::min(a-s, 1.0));
@@ -1459,7 +1463,7 @@ Vector Chain::posM(const real ab) const
     if ( ab <= 0 )
         return posP(0);
     
-    real a = ab / fnCut;
+    real a = ab * fnCutInv;
     unsigned s = (unsigned)a;
     
     // check if PLUS_END is reached:
@@ -1475,7 +1479,7 @@ Vector Chain::dirM(const real ab) const
     if ( ab <= 0 )
         return dirSegment(0);
     
-    real a = ab / fnCut;
+    real a = ab * fnCutInv;
     unsigned s = (unsigned)a;
     
     // check if PLUS_END is reached
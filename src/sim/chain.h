@@ -71,6 +71,9 @@ private:
     /// actual section length: distance between consecutive points
     real         fnCut;
     
+    /// inverse of fnCut, to locate an abscissa without a division
+    real         fnCutInv;
+    
     /// target segmentation length (equal to parameter 'fiber:segmentation')
     real         fnSegmentation;
     
@@ -113,7 +116,7 @@ protected:
     static int   reshape_local(unsigned, const real*, real*, real cut, real* tmp, size_t);
 
     /// change segmentation
-    void         setSegmentation(real c) { fnCut = std::max(c, REAL_EPSILON); }
+    void         setSegmentation(real c) { fnCut = std::max(c, REAL_EPSILON); fnCutInv = 1 / fnCut; }
     
 public:
     
@@ -218,7 +221,7 @@ public:
     
     /// return P where segment [ P, P+1 [ contains point at distance `a` from the MINUS_END
     /** returns 0 if ( a < 0 ) and last point index if ( a > lastSegment() ) */
-    unsigned     clampedIndexM(const real a) const { return std::min((unsigned)(std::max(a,(real)0)/fnCut), lastSegment()); }
+    unsigned     clampedIndexM(const real a) const { return std::min((unsigned)(std::max(a,(real)0)*fnCutInv), lastSegment()); }
 
     //---------------------
     
@@ -287,7 +290,7 @@ public:
 #if ( 1 )
     /// normalized tangent vector to the fiber within segment [p, p+1]
     /** We divide by fnCut, which should be the distance between points */
-    Vector       dirSegment(unsigned p)  const { return diffPoints(p) / fnCut; }
+    Vector       dirSegment(unsigned p)  const { return diffPoints(p) * fnCutInv; }
 #else
     /// normalized tangent vector to the fiber within segment [p, p+1]
     /** Normalizing the difference between points is slow due to sqrt() */
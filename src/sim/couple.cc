@@ -7,6 +7,7 @@
 #include "exceptions.h"
 #include "iowrapper.h"
 #include "hand_prop.h"
+#include "motor.h"
 #include "meca.h"
 #include "simul.h"
 #include "space.h"
@@ -14,7 +15,10 @@
 #include "aster.h"
 #include "aster_prop.h"
 
-extern Modulo const* modulo;
+
+thread_local Slab Couple::slab("couple");
+
+extern thread_local Modulo const* modulo;
 
 //------------------------------------------------------------------------------
 
@@ -26,6 +30,7 @@ Couple::Couple(CoupleProp const* p, Vector const& w)
 
     assert_true(cHand1);
     assert_true(cHand2);
+    monitorKind(MONITOR_COUPLE);
 }
 
 
@@ -105,8 +110,16 @@ void Couple::setInteractions(Meca & meca) const
 void Couple::stepFF(Simul& sim)
 {
     diffuse();
-    
-    // confinement:
+    confineFF();
+    attachFF(sim);
+}
+
+
+/**
+ Apply the confinement to the position of a free Couple
+ */
+void Couple::confineFF()
+{
     if ( prop->confine == CONFINE_INSIDE )
     {
         /**
@@ -114,7 +127,7 @@ void Couple::stepFF(Simul& sim)
          Set concentration of molecules at edges of Space by letting molecules
          out, and put some back at a constant rate
          */
-        if ( !prop->confine_space_ptr->inside(cPos) )
+        if ( !prop->confine_space_ptr->isInside(cPos) )
             cPos = prop->confine_space_ptr->bounce(cPos);
         if ( modulo )
             modulo->fold(cPos);
@@ -123,7 +136,14 @@ void Couple::stepFF(Simul& sim)
     {
         cPos = prop->confine_space_ptr->project(cPos);
     }
+}
+
 
+/**
+ Attempt to attach one of the Hands of a free Couple
+ */
+void Couple::attachFF(Simul& sim)
+{
     /*
      To attachment a Couple, we flip a coin to give equal chance to each Hand,
      as if they were sharing the two half of a spherical cap.
@@ -179,6 +199,55 @@ void Couple::stepAA()
 }
 
 
+/**
+ prestepAA() and poststepAA() are together equivalent to stepAA(),
+ if the Hands are of the basic class Hand, or of class Motor.
+ The bits of `motors` indicate which Hand is a Motor (1:Hand1, 2:Hand2).
+ 
+ prestepAA() calculates the force, advances the detachment counters and
+ calculates the displacement of the Motors, storing new abscissa in `abs`.
+ It only modifies the Couple and its Hands, and can thus be called in parallel
+ for different Couples. The returned bit field indicates which basic Hand
+ should detach, and should be given to poststepAA().
+ */
+int Couple::prestepAA(int motors, real abs[2])
+{
+    Vector f = force();
+    real fn = f.norm();
+    int res = 0;
+    
+    if ( motors & 1 )
+        abs[0] = static_cast<Motor*>(cHand1)->advanceLoaded(f, fn);
+    else if ( cHand1->countdownLoaded(fn) )
+        res = 1;
+    
+    if ( motors & 2 )
+        abs[1] = static_cast<Motor*>(cHand2)->advanceLoaded(-f, fn);
+    else if ( cHand2->countdownLoaded(fn) )
+        res |= 2;
+    
+    return res;
+}
+
+
+/**
+ This detaches the Hands, or moves the Motors, following prestepAA().
+ The Motors may use random numbers, and this should be called sequentially.
+ */
+void Couple::poststepAA(int motors, int detach, real const abs[2])
+{
+    if ( motors & 1 )
+        static_cast<Motor*>(cHand1)->finishLoaded(abs[0]);
+    else if ( detach & 1 )
+        cHand1->detach();
+    
+    if ( motors & 2 )
+        static_cast<Motor*>(cHand2)->finishLoaded(abs[1]);
+    else if ( detach & 2 )
+        cHand2->detach();
+}
+
+
 //------------------------------------------------------------------------------
 #pragma mark -
 
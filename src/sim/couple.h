@@ -7,6 +7,7 @@
 #include "hand_monitor.h"
 #include "couple_prop.h"
 #include "hand.h"
+#include "slab.h"
 
 class Meca;
 
@@ -40,6 +41,9 @@ class Meca;
  */
 class Couple : public Object, public HandMonitor
 {
+    /// to call afterAttachment() and beforeDetachment() without virtual call
+    friend class Hand;
+    
 public:
 
     /// associated properties
@@ -86,6 +90,15 @@ public:
 
     /// destructor
     virtual ~Couple();
+    
+    /// memory of the Couples, which are allocated and deleted frequently
+    static thread_local Slab slab;
+    
+    /// allocate from `slab`
+    static void* operator new(size_t s) { return slab.allocate(s); }
+    
+    /// return memory to `slab`
+    static void operator delete(void* p, size_t s) { slab.release(p, s); }
 
     /// copy operator
     Couple&  operator=(Couple const&);
@@ -149,9 +162,15 @@ public:
    
     //--------------------------------------------------------------------------
 
-    /// simulation step for a free Couple: diffusion
+    /// simulation step for a free Couple: diffusion, confinement and attachment
     virtual void   stepFF(Simul&);
     
+    /// confinement of a free Couple, called by stepFF() after diffusion
+    virtual void   confineFF();
+    
+    /// attachment of a free Couple, called by stepFF() after confinement
+    virtual void   attachFF(Simul&);
+    
     /// simulation step for a Couple attached by Hand1
     virtual void   stepAF(Simul&);
     
@@ -160,6 +179,12 @@ public:
     
     /// simulation step for a doubly-attached Couple
     virtual void   stepAA();
+    
+    /// first part of stepAA() for basic Hands and Motors, which only modifies the Couple
+    int            prestepAA(int motors, real abs[2]);
+    
+    /// second part of stepAA() for basic Hands and Motors, following prestepAA()
+    void           poststepAA(int motors, int detach, real const abs[2]);
 
     //--------------------------------------------------------------------------
 
@@ -36,6 +36,7 @@ void CoupleProp::clear()
     length            = 0;
     diffusion         = 0;
     fast_diffusion    = false;
+    free_pool         = false;
     trans_activated   = 0;
     stiff             = true;
     specificity       = BIND_ALWAYS;
@@ -60,6 +61,7 @@ void CoupleProp::read(Glossary& glos)
     else
         glos.set(diffusion,       "diffusion");
     glos.set(fast_diffusion,  "fast_diffusion");
+    glos.set(free_pool,       "free_pool");
     
     glos.set(trans_activated, "trans_activated");
     glos.set(stiff,           "stiff");
@@ -117,6 +119,9 @@ void CoupleProp::complete(Simul const& sim)
     if ( diffusion < 0 )
         throw InvalidParameter("couple:diffusion must be >= 0");
 
+    if ( free_pool && !fast_diffusion )
+        throw InvalidParameter("couple:free_pool requires couple:fast_diffusion");
+
     /**
      We want for one degree of freedom to fulfill `var(dx) = 2 D dt`
      And we use: dx = diffusion_dt * RNG.sreal()
@@ -167,6 +172,7 @@ void CoupleProp::write_values(std::ostream& os) const
     write_value(os, "length",          length);
     write_value(os, "diffusion",       diffusion);
     write_value(os, "fast_diffusion",  fast_diffusion);
+    write_value(os, "free_pool",       free_pool);
     write_value(os, "trans_activated", trans_activated);
     write_value(os, "stiff",           stiff);
     write_value(os, "specificity",     specificity);
@@ -17,6 +17,7 @@ class Space;
 class CoupleProp : public Property
 {
     friend class Couple;
+    friend class CoupleSet;
     
 public:
     
@@ -100,6 +101,16 @@ public:
      */
     int          fast_diffusion;
     
+    /// if true, free Couples are only counted, and not represented by objects (default=false)
+    /**
+     This requires `fast_diffusion > 0`. The free Couples are then removed from
+     the simulation, and only their number is recorded. The Couple objects are
+     created when they attach, and they are recycled when both Hands detach.
+     This saves memory when most Couples are free, but the free Couples cannot
+     be accessed, and they are not saved in the trajectory file.
+     */
+    bool         free_pool;
+    
     /// if ( trans_activated == 1 ), Hand2 is active only if Hand1 is bound
     /**
      Both Hands of a Couple are normally equally active. With this feature,
@@ -10,6 +10,13 @@
 #include "duo_prop.h"
 #include "glossary.h"
 #include "simul.h"
+#include <algorithm>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+extern thread_local Modulo const* modulo;
 
 
 /**
@@ -82,6 +89,32 @@ Property* CoupleSet::newProperty(const std::string& cat, const std::string& nom,
 void CoupleSet::prepare(PropertyList const& properties)
 {
     uni = uniPrepare(properties);
+    
+    // identify the Couples that can be stepped by stepAABatch():
+    aaKind.clear();
+    for ( Property const* i : properties.find_all("couple") )
+    {
+        CoupleProp const * p = static_cast<CoupleProp const*>(i);
+        std::string const& a1 = p->hand1_prop->activity;
+        std::string const& a2 = p->hand2_prop->activity;
+        int k = 0;
+        if (( p->activity == "diffuse" || p->activity == "crosslink" )
+            && ( a1 == "bind" || a1 == "move" || a1 == "motor" )
+            && ( a2 == "bind" || a2 == "move" || a2 == "motor" ))
+            k = 1 + 2 * ( a1 != "bind" ) + 4 * ( a2 != "bind" );
+        if ( aaKind.size() <= p->number() )
+            aaKind.resize(p->number()+1, 0);
+        aaKind[p->number()] = k;
+    }
+    
+#ifdef _OPENMP
+    aaThreads = simul.prop->threads;
+    if ( aaThreads <= 0 )
+        aaThreads = omp_get_max_threads();
+    aaThreads = std::max(1, aaThreads);
+#else
+    aaThreads = 1;
+#endif
 }
 
 
@@ -120,20 +153,25 @@ void CoupleSet::step()
 
     Couple * obj, * nxt;
     
-    obj = firstAA();
-    // this loop is unrolled, processing objects 2 by 2:
-    if ( aaList.size() & 1 )
-    {
-        nxt = obj->next();
-        obj->stepAA();
-        obj = nxt;
-    }
-    while ( obj )
+    if ( simul.prop->couple_batch || ( aaThreads > 1 && aaList.size() > 1024 ))
+        stepAABatch();
+    else
     {
-        nxt = obj->next();
-        obj->stepAA();
-        obj = nxt->next();
-        nxt->stepAA();
+        obj = firstAA();
+        // this loop is unrolled, processing objects 2 by 2:
+        if ( aaList.size() & 1 )
+        {
+            nxt = obj->next();
+            obj->stepAA();
+            obj = nxt;
+        }
+        while ( obj )
+        {
+            nxt = obj->next();
+            obj->stepAA();
+            obj = nxt->next();
+            nxt->stepAA();
+        }
     }
     
     obj = faHead;
@@ -170,6 +208,13 @@ void CoupleSet::step()
     
     //std::clog << "CoupleSet::step : FF " << ffList.size() << " head " << ffHead << std::endl;
 
+    if ( simul.prop->couple_batch )
+    {
+        // the Couples before ffHead were detached by stepAF() or stepFA()
+        stepFFBatch(ffHead);
+        return;
+    }
+
     obj = ffHead;
     // this loop is unrolled, processing objects 2 by 2:
     if ( ffOdd )
@@ -188,6 +233,127 @@ void CoupleSet::step()
 }
 
 
+/**
+ The free Couples are collected and sorted by property, and their positions are
+ copied to a contiguous array, in which the diffusion of all Couples of the same
+ property is calculated by one loop. The positions of each group are tested with
+ Space::insideMany(), and copied back. The confinement and attachment of the
+ Couples are then processed in two separate passes.
+ */
+/**
+ The Couples made of basic Hands (activity=bind) or Motors (activity=move)
+ are stepped without virtual calls, in two passes.
+ In the first pass, which can be done in parallel, the forces are calculated,
+ the Gillespie counters are advanced and the displacements of the Motors are
+ calculated. This consumes no random number. In the second pass, done by a single
+ thread in the order of the list, the Hands are detached or moved.
+ The other Couples are stepped sequentially in the second pass, such that the
+ random numbers are drawn in the same order as in the sequential loop of step().
+ The result is thus identical to the sequential calculation, for any number
+ of threads.
+ */
+void CoupleSet::stepAABatch()
+{
+    aaBatch.clear();
+    for ( Couple * obj = firstAA(); obj; obj = obj->next() )
+        aaBatch.push_back(obj);
+    
+    const size_t cnt = aaBatch.size();
+    aaDetach.resize(cnt);
+    aaAbs.resize(2*cnt);
+    Couple ** bat = aaBatch.data();
+    int * det = aaDetach.data();
+    real * ab = aaAbs.data();
+    
+    #pragma omp parallel for num_threads(aaThreads)
+    for ( size_t i = 0; i < cnt; ++i )
+    {
+        Couple * obj = bat[i];
+        size_t p = obj->property()->number();
+        int k = ( p < aaKind.size() ) ? aaKind[p] : 0;
+        if ( k )
+            det[i] = obj->prestepAA(k>>1, ab+2*i);
+        else
+            det[i] = -1;
+    }
+    
+    for ( size_t i = 0; i < cnt; ++i )
+    {
+        Couple * obj = bat[i];
+        if ( det[i] < 0 )
+            obj->stepAA();
+        else
+            obj->poststepAA(aaKind[obj->property()->number()]>>1, det[i], ab+2*i);
+    }
+}
+
+
+void CoupleSet::stepFFBatch(Couple * head)
+{
+    ffBatch.clear();
+    for ( Couple * obj = head; obj; obj = obj->next() )
+        ffBatch.push_back(obj);
+    
+    std::stable_sort(ffBatch.begin(), ffBatch.end(), [](Couple const* a, Couple const* b)
+                     { return a->prop->number() < b->prop->number(); });
+    
+    const size_t cnt = ffBatch.size();
+    ffBatchPos.resize(DIM*cnt);
+    real * pos = ffBatchPos.data();
+    for ( size_t i = 0; i < cnt; ++i )
+        ffBatch[i]->posFree().store(pos+DIM*i);
+    
+    // diffusion, as in Couple::diffuse(), for each group with the same property:
+    size_t i = 0;
+    while ( i < cnt )
+    {
+        CoupleProp const* P = ffBatch[i]->prop;
+        size_t j = i + 1;
+        while ( j < cnt  &&  ffBatch[j]->prop == P )
+            ++j;
+        const real dt = P->diffusion_dt;
+        real * ptr = pos + DIM*i;
+        real * end = pos + DIM*j;
+        for ( ; ptr < end; ++ptr )
+            *ptr += dt * RNG.sreal();
+        i = j;
+    }
+    
+    /*
+     The positions of each group confined inside are tested by one call, and
+     confineFF() is then only called for the Couples found outside.
+     With periodic boundaries, confineFF() is always called to fold the position.
+     */
+    ffBatchIn.resize(cnt);
+    bool * ins = ffBatchIn.data();
+    i = 0;
+    while ( i < cnt )
+    {
+        CoupleProp const* P = ffBatch[i]->prop;
+        size_t j = i + 1;
+        while ( j < cnt  &&  ffBatch[j]->prop == P )
+            ++j;
+        if ( P->confine == CONFINE_INSIDE && P->confine_space_ptr && !modulo )
+            P->confine_space_ptr->insideMany(pos+DIM*i, j-i, ins+i);
+        else
+            std::fill(ins+i, ins+j, false);
+        i = j;
+    }
+    
+    // confinement:
+    for ( i = 0; i < cnt; ++i )
+    {
+        ffBatch[i]->setPosition(Vector(pos+DIM*i));
+        if ( !ins[i] )
+            ffBatch[i]->confineFF();
+    }
+    
+    // attachment, which may transfer the Couple to another list:
+    for ( i = 0; i < cnt; ++i )
+        ffBatch[i]->attachFF(simul);
+}
+
+
 //------------------------------------------------------------------------------
 #pragma mark -
 
@@ -381,12 +547,45 @@ void CoupleSet::foldPositions(Modulo const* m) const
 }
 
 
+/**
+ The bridging Couples, and the Couples attached by Hand1 only are grouped by the
+ Fiber to which Hand1 is attached, the Couples attached by Hand2 only by the Fiber
+ of Hand2, and the free Couples by the cell of the FiberGrid containing them.
+ The groups, and the Couples within each group, are in random order.
+ This improves the locality of memory accesses in step().
+ */
+void CoupleSet::sortLists()
+{
+    const uint32_t salt = RNG.pint32() | 1;
+    std::vector<unsigned long long> key(std::max(aaList.size(), std::max(afList.size(), faList.size())));
+    
+    for ( size_t i = 0; i < aaList.size(); ++i )
+        key[i] = sortKey(static_cast<Couple*>(aaList.node(i))->fiber1()->identity(), salt);
+    aaList.sort_keys(key.data());
+    
+    for ( size_t i = 0; i < afList.size(); ++i )
+        key[i] = sortKey(static_cast<Couple*>(afList.node(i))->fiber1()->identity(), salt);
+    afList.sort_keys(key.data());
+    
+    for ( size_t i = 0; i < faList.size(); ++i )
+        key[i] = sortKey(static_cast<Couple*>(faList.node(i))->fiber2()->identity(), salt);
+    faList.sort_keys(key.data());
+    
+    sortByCell(ffList, salt);
+}
+
+
 void CoupleSet::shuffle()
 {
-    ffList.shuffle();
-    afList.shuffle();
-    faList.shuffle();
-    aaList.shuffle();
+    if ( sortNow() )
+        sortLists();
+    else if ( mixNow() )
+    {
+        mix(ffList);
+        mix(afList);
+        mix(faList);
+        mix(aaList);
+    }
 }
 
 
@@ -398,6 +597,15 @@ void CoupleSet::erase()
     ObjectSet::erase(afList);
     ObjectSet::erase(ffList);
     inventory.clear();
+    // delete the spare objects of the pool:
+    for ( CoupleReserveList & reserve : uniLists )
+    {
+        for ( Couple * c : reserve )
+            delete(c);
+    }
+    uniLists.clear();
+    uniProps.clear();
+    poolSize.clear();
 }
 
 
@@ -520,19 +728,21 @@ void CoupleSet::write(Outputter& out) const
 
 void CoupleSet::report(std::ostream& os) const
 {
-    if ( size() > 0 )
+    if ( size() + sizePool() > 0 )
     {
         os << '\n' << title();
         PropertyList plist = simul.properties.find_all(title());
         for ( Property * i : plist )
         {
             CoupleProp * p = static_cast<CoupleProp*>(i);
-            unsigned cnt = count(match_property, p);
+            size_t cnt = count(match_property, p);
+            if ( p->number() < poolSize.size() )
+                cnt += poolSize[p->number()];
             os << '\n' << std::setw(10) << cnt << " " << p->name();
             os << " ( " << p->hand1 << " | " << p->hand2 << " )";
         }
         if ( plist.size() > 1 )
-            os << '\n' << std::setw(10) << size() << " total";
+            os << '\n' << std::setw(10) << size() + sizePool() << " total";
     }
 }
 
@@ -610,6 +820,40 @@ int CoupleSet::bad() const
 #pragma mark - Fast Diffusion
 
 
+/**
+ The Couples recycled from the pool have no identity, and the smallest
+ unused identity is given to them, such that the identities remain bounded.
+ */
+void CoupleSet::uniLink(Couple * c)
+{
+    if ( !c->identity() )
+    {
+        c->identity(inventory.first_unassigned());
+        inventory.assign(c);
+    }
+    link(c);
+}
+
+
+/**
+ The Couples in `can` are recycled, and new Couples are only created if needed.
+ */
+void CoupleSet::poolFill(CoupleReserveList& can, CoupleProp const* p, size_t cnt)
+{
+    while ( can.size() < cnt )
+        can.push_back(p->newCouple());
+}
+
+
+size_t CoupleSet::sizePool() const
+{
+    size_t res = 0;
+    for ( size_t n : poolSize )
+        res += n;
+    return res;
+}
+
+
 /**
 Distribute Hand1 of Couples on the sites specified in `loc`.
  */
@@ -624,7 +868,7 @@ void CoupleSet::uniAttach1(Array<FiberSite>& loc, CoupleReserveList& can)
         {
             can.pop_back();
             c->attach1(i);
-            link(c);
+            uniLink(c);
         }
     }
 }
@@ -644,7 +888,7 @@ void CoupleSet::uniAttach2(Array<FiberSite>& loc, CoupleReserveList& can)
         {
             can.pop_back();
             c->attach2(i);
-            link(c);
+            uniLink(c);
         }
     }
 }
@@ -669,7 +913,7 @@ void CoupleSet::uniAttach12(Array<FiberSite>& loc1, Array<FiberSite>& loc2,
         size_t p = RNG.pint32(nbc);
         c->attach1(loc1[p]);
         c->attach2(loc2[p]);
-        link(c);
+        uniLink(c);
     }
 }
 
@@ -723,14 +967,22 @@ void CoupleSet::uniAttach(FiberSet const& fibers)
 #endif
     
     // uniform attachment for reserved couples:
-    for ( CoupleReserveList & reserve : uniLists )
+    for ( size_t i = 0; i < uniLists.size(); ++i )
     {
-        if ( reserve.empty() )
+        CoupleReserveList & reserve = uniLists[i];
+        CoupleProp const * p = uniProps[i];
+        
+        if ( !p )
             continue;
         
-        CoupleProp const * p = reserve.back()->prop;
+        // with couple:free_pool, `reserve` only holds spare objects:
+        const bool pool = p->free_pool;
+        const size_t cnt = pool ? poolSize[i] : reserve.size();
+        
+        if ( cnt == 0 )
+            continue;
         
-        const real alpha = 2 * p->spaceVolume() / reserve.size();
+        const real alpha = 2 * p->spaceVolume() / cnt;
 
         if ( p->fast_diffusion == 2 )
         {
@@ -743,24 +995,43 @@ void CoupleSet::uniAttach(FiberSet const& fibers)
             fibers.uniFiberSites(loc, dis);
         }
         
+        if ( pool )
+            poolFill(reserve, p, std::min(loc.size(), cnt));
+        size_t sup = reserve.size();
         uniAttach1(loc, reserve);
-        
-        if ( reserve.empty() || p->trans_activated )
-            continue;
+        size_t use = sup - reserve.size();
         
         // if ( couple:trans_activated == true ), Hand2 cannot bind
-        if ( p->fast_diffusion == 2 )
+        if ( use < cnt && ( pool || reserve.size() ) && !p->trans_activated )
         {
-            real dis = alpha / p->hand2_prop->bindingSectionRate();
-            fibers.newFiberSitesP(loc, dis);
+            if ( p->fast_diffusion == 2 )
+            {
+                real dis = alpha / p->hand2_prop->bindingSectionRate();
+                fibers.newFiberSitesP(loc, dis);
+            }
+            else
+            {
+                real dis = alpha / p->hand2_prop->bindingSectionProb();
+                fibers.uniFiberSites(loc, dis);
+            }
+            
+            if ( pool )
+                poolFill(reserve, p, std::min(loc.size(), cnt-use));
+            sup = reserve.size();
+            uniAttach2(loc, reserve);
+            use += sup - reserve.size();
         }
-        else
+        
+        if ( pool )
         {
-            real dis = alpha / p->hand2_prop->bindingSectionProb();
-            fibers.uniFiberSites(loc, dis);
+            poolSize[i] = cnt - use;
+            // keep as many spare objects as were used in this step:
+            while ( reserve.size() > use )
+            {
+                delete(reserve.back());
+                reserve.pop_back();
+            }
         }
-        
-        uniAttach2(loc, reserve);
     }
 }
 
@@ -785,7 +1056,18 @@ bool CoupleSet::uniPrepare(PropertyList const& properties)
     }
     
     if ( res )
+    {
         uniLists.resize(last+1);
+        uniProps.assign(last+1, nullptr);
+        if ( poolSize.size() <= last )
+            poolSize.resize(last+1, 0);
+        for ( Property const* i : properties.find_all("couple") )
+        {
+            CoupleProp const * p = static_cast<CoupleProp const*>(i);
+            if ( p->fast_diffusion )
+                uniProps[p->number()] = p;
+        }
+    }
     
     return res;
 }
@@ -805,6 +1087,13 @@ void CoupleSet::uniCollect()
         {
             unlink(obj);
             assert_true((size_t)p->number() < uniLists.size());
+            if ( p->free_pool )
+            {
+                // the object is kept as a spare, without identity:
+                inventory.unassign(obj);
+                obj->identity(0);
+                ++poolSize[p->number()];
+            }
             uniLists[p->number()].push_back(obj);
         }
         obj = nxt;
@@ -815,11 +1104,15 @@ void CoupleSet::uniCollect()
 /**
  empty uniLists, reversing all Couples in the normal lists.
  This is useful if ( couple:fast_diffusion == true )
+ The Couples of the pool (couple:free_pool) remain counted in poolSize.
  */
 void CoupleSet::uniRelax()
 {
-    for ( CoupleReserveList & reserve : uniLists )
+    for ( size_t i = 0; i < uniLists.size(); ++i )
     {
+        CoupleReserveList & reserve = uniLists[i];
+        if ( uniProps[i] && uniProps[i]->free_pool )
+            continue;
         for ( Couple * c : reserve )
         {
             assert_true(!c->attached1() && !c->attached2());
@@ -906,6 +1199,20 @@ void CoupleSet::equilibrateSym(FiberSet const& fibers, CoupleReserveList& reserv
  it is random, in particular without bundles. The motion of the motor is also ignored.
  */
 void CoupleSet::equilibrate(FiberSet const& fibers, CoupleReserveList& reserve, CoupleProp const* cop)
+{
+    // get all crosspoints:
+    Array<FiberSite> loc1(1024), loc2(1024);
+    fibers.allIntersections(loc1, loc2, std::max(cop->hand1_prop->binding_range, cop->hand2_prop->binding_range));
+    equilibrate(fibers, reserve, cop, loc1, loc2);
+}
+
+
+/**
+ The intersections should be calculated with a threshold equal to the largest
+ binding range of the two Hands, as done by equilibrate(FiberSet, CoupleReserveList, CoupleProp)
+ */
+void CoupleSet::equilibrate(FiberSet const& fibers, CoupleReserveList& reserve, CoupleProp const* cop,
+                            Array<FiberSite>& loc1, Array<FiberSite>& loc2)
 {
     if ( cop->trans_activated )
         throw InvalidParameter("Cannot equilibrate trans_activated Couple");
@@ -921,10 +1228,6 @@ void CoupleSet::equilibrate(FiberSet const& fibers, CoupleReserveList& reserve,
     const real binding_range2 = cop->hand2_prop->binding_range;
     const real unbinding_rate2 = cop->hand2_prop->unbinding_rate;
 
-    
-    // get all crosspoints:
-    Array<FiberSite> loc1(1024), loc2(1024);
-    fibers.allIntersections(loc1, loc2, std::max(binding_range1, binding_range2));
     const size_t nb_crossings = loc1.size();
     
     const real ratio_fibs1 = 2 * total_length * binding_range1 / space_volume;
@@ -979,40 +1282,76 @@ void CoupleSet::equilibrate(FiberSet const& fibers, CoupleReserveList& reserve,
 }
 
 /**
-Distributes Couples for which `trans_activated==true` on the filaments
+Distributes Couples for which `trans_activated==false` on the filaments
+
+ The free Couples are collected in one pass, and the intersections of the fibers
+ are calculated only once, with the largest range needed by any class of Couple.
+ For each class, the intersections are then selected according to its own range.
 */
 void CoupleSet::equilibrate(FiberSet const& fibers, PropertyList const& properties)
 {
-    for ( Property * i : properties.find_all("couple") )
+    PropertyList plist = properties.find_all("couple");
+    unsigned last = 0;
+    for ( Property * i : plist )
+    {
+        static_cast<CoupleProp *>(i)->complete(simul);
+        last = std::max(last, i->number());
+    }
+    
+    // collect all free Couples in lists corresponding to their class:
+    CoupleReserve lists(last+1);
+    Couple * c = firstFF(), * nxt;
+    while ( c )
     {
-        CoupleProp * cop = static_cast<CoupleProp *>(i);
-        cop->complete(simul);
+        nxt = c->next();
+        CoupleProp const* cop = static_cast<CoupleProp const*>(c->property());
+        if ( !cop->trans_activated && cop->number() <= last )
+        {
+            unlink(c);
+            lists[cop->number()].push_back(c);
+        }
+        c = nxt;
+    }
+    
+    // get all crosspoints, within the largest range:
+    real range = -1;
+    for ( Property * i : plist )
+    {
+        CoupleProp const* cop = static_cast<CoupleProp *>(i);
+        if ( lists[cop->number()].size() > 0 )
+            range = std::max(range, std::max(cop->hand1_prop->binding_range, cop->hand2_prop->binding_range));
+    }
+    Array<FiberSite> all1(1024), all2(1024), loc1(1024), loc2(1024);
+    Array<real> dis;
+    if ( range >= 0 )
+        fibers.allIntersections(all1, all2, range, &dis);
+    
+    for ( Property * i : plist )
+    {
+        CoupleProp const* cop = static_cast<CoupleProp *>(i);
+        CoupleReserveList & list = lists[cop->number()];
         
-        if ( !cop->trans_activated )
+        if ( list.size() > 0 )
         {
-            CoupleReserveList list;
-            
-            // collect all Couple of this kind:
-            Couple * c = firstFF(), * nxt;
-            while ( c )
+            // select intersections within range, as allIntersections() would:
+            const real sup = square(std::max(cop->hand1_prop->binding_range, cop->hand2_prop->binding_range));
+            loc1.clear();
+            loc2.clear();
+            for ( size_t n = 0; n < dis.size(); ++n )
             {
-                nxt = c->next();
-                if ( c->property() == cop )
+                if ( dis[n] < sup )
                 {
-                    unlink(c);
-                    list.push_back(c);
+                    loc1.push_back(all1[n]);
+                    loc2.push_back(all2[n]);
                 }
-                c = nxt;
-            }
-            if ( list.size() > 0 )
-            {
-                equilibrate(fibers, list, cop);
-                
-                // release all collected Couple
-                for ( Couple * cx : list )
-                    link(cx);
-                list.clear();
             }
+            
+            equilibrate(fibers, list, cop, loc1, loc2);
+            
+            // release all collected Couple
+            for ( Couple * cx : list )
+                link(cx);
+            list.clear();
         }
     }
     printf("Couple::equilibrate    FF %lu FA %lu AF %lu AA %lu\n", sizeFF(), sizeFA(), sizeAF(), sizeAA());
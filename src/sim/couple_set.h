@@ -6,6 +6,7 @@
 #include "object_set.h"
 #include "couple.h"
 #include "couple_prop.h"
+#include "array.h"
 
 /// Set for Couple
 /**
@@ -59,9 +60,21 @@ private:
     /// uniLists[p] contains the Couples with ( property()->number() == p ) that are diffusing
     CoupleReserve uniLists;
     
+    /// uniProps[p] is the property of number `p`, if it has fast_diffusion
+    std::vector<CoupleProp const*> uniProps;
+    
+    /// poolSize[p] is the number of free Couples of property `p` with couple:free_pool
+    std::vector<size_t> poolSize;
+    
     /// flag to enable couple:fast_diffusion attachment algorithm
     bool          uni;
     
+    /// link Couple, giving it a new identity if it was recycled from the pool
+    void          uniLink(Couple *);
+    
+    /// add new Couples to `can`, such that it contains at least `cnt` Couples
+    void          poolFill(CoupleReserveList& can, CoupleProp const*, size_t cnt);
+    
     /// gather all Couple with fast_diffusion in dedicated lists
     void          uniCollect();
     
@@ -83,10 +96,44 @@ private:
     /// return Couples in uniLists to the normal lists
     void          uniRelax();
     
+    /// free Couples, grouped by property, used by stepFFBatch()
+    Array<Couple*> ffBatch;
+    
+    /// positions of the Couples in `ffBatch`, with DIM values for each Couple
+    Array<real>    ffBatchPos;
+    
+    /// true for the Couples in `ffBatch` that are known to need no confinement
+    Array<bool>    ffBatchIn;
+    
+    /// step free Couples from `head`, in successive passes over contiguous arrays
+    void          stepFFBatch(Couple * head);
+    
+    /// for Couples of property number `p`: 0 if stepAA() should be called, or 1 + 2 * (bits indicating Motor Hands)
+    std::vector<int> aaKind;
+    
+    /// bridging Couples, used by stepAABatch()
+    Array<Couple*> aaBatch;
+    
+    /// Hands to be detached, for each Couple in `aaBatch`
+    Array<int>     aaDetach;
+    
+    /// new abscissa of the Motors, with 2 values for each Couple in `aaBatch`
+    Array<real>    aaAbs;
+    
+    /// number of threads used by stepAABatch()
+    int           aaThreads;
+    
+    /// step bridging Couples in two passes, the first one being done in parallel
+    void          stepAABatch();
+    
+    /// group the Couples of each list by Fiber or by cell of the FiberGrid
+    void          sortLists();
+    
+    
 public:
     
     ///creator
-    CoupleSet(Simul& s) : ObjectSet(s), uni(false) {}
+    CoupleSet(Simul& s) : ObjectSet(s), uni(false), aaThreads(1) {}
     
     //--------------------------
     
@@ -166,6 +213,8 @@ public:
     size_t       sizeFA()      const { return faList.size(); }
     /// number of Couples attached by both hands
     size_t       sizeAA()      const { return aaList.size(); }
+    /// number of free Couples that are only counted (couple:free_pool)
+    size_t       sizePool()    const;
     /// total number of elements
     size_t       size()        const { return ffList.size() + faList.size() + afList.size() + aaList.size(); }
     
@@ -192,6 +241,9 @@ public:
     
     /// mix order of elements
     void         shuffle();
+    
+    /// reverse order of elements
+    void         reverse() { ffList.reverse(); afList.reverse(); faList.reverse(); aaList.reverse(); }
 
     /// distribute the Couple on the fibers to approximate an equilibrated state
     void         equilibrateSym(FiberSet const&, CoupleReserveList&, CoupleProp const*);
@@ -199,6 +251,9 @@ public:
     /// distribute Couples of given class on the fibers to approximate an equilibrated state
     void         equilibrate(FiberSet const&, CoupleReserveList&, CoupleProp const*);
     
+    /// equilibrate() given the intersections of fibers, which are used as buffers and modified
+    void         equilibrate(FiberSet const&, CoupleReserveList&, CoupleProp const*, Array<FiberSite>&, Array<FiberSite>&);
+    
     /// distribute all Couple on the fibers to approximate an equilibrated state
     void         equilibrate(FiberSet const&, PropertyList const&);
     
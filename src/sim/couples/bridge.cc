@@ -7,7 +7,7 @@
 #include "meca.h"
 #include "random.h"
 
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 //------------------------------------------------------------------------------
 
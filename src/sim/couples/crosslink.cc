@@ -8,7 +8,7 @@
 #include "space.h"
 #include "meca.h"
 
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 //------------------------------------------------------------------------------
 Crosslink::Crosslink(CrosslinkProp const* p, Vector const& w)
@@ -27,22 +27,23 @@ Crosslink::~Crosslink()
 #pragma mark -
 
 /**
- Simulates:
- - diffusive motion
- - attachment
- .
+ The Crosslink is always confined inside
  */
-void Crosslink::stepFF(Simul& sim)
+void Crosslink::confineFF()
 {
-    diffuse();
-    
-    // confinement:
-    if ( !prop->confine_space_ptr->inside(cPos) )
+    if ( !prop->confine_space_ptr->isInside(cPos) )
         cPos = prop->confine_space_ptr->bounce(cPos);
     
     if ( modulo )
         modulo->fold(cPos);
-    
+}
+
+
+/**
+ Simulates attachment, with equal chance for each Hand
+ */
+void Crosslink::attachFF(Simul& sim)
+{
     /*
      To attachment a Couple, we flip a coin to give equal chance to each Hand,
      as if they were sharing the two half of a spherical cap.
@@ -28,8 +28,11 @@ public:
     /// destructor
     virtual      ~Crosslink();
     
-    /// simulation step for a free Couple: diffusion
-    virtual void  stepFF(Simul&);
+    /// confinement of a free Couple, always inside
+    virtual void  confineFF();
+    
+    /// attachment of a free Couple
+    virtual void  attachFF(Simul&);
     
     /// add interactions to a Meca
     void          setInteractions(Meca &) const;
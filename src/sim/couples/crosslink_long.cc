@@ -7,7 +7,7 @@
 #include "modulo.h"
 #include "meca.h"
 
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 //------------------------------------------------------------------------------
 
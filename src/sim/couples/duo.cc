@@ -7,7 +7,7 @@
 #include "space.h"
 #include "sim.h"
 
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 //------------------------------------------------------------------------------
 
@@ -36,26 +36,14 @@ void Duo::deactivate()
 
 //------------------------------------------------------------------------------
 
-void Duo::stepFF(Simul& sim)
+/**
+ The diffusion and confinement are done by Couple::stepFF()
+ */
+void Duo::attachFF(Simul& sim)
 {
-    diffuse();
-    
-    // confinement:
-    if ( prop->confine == CONFINE_INSIDE )
-    {
-        if ( !prop->confine_space_ptr->inside(cPos) )
-            cPos = prop->confine_space_ptr->bounce(cPos);
-        if ( modulo )
-            modulo->fold(cPos);
-    }
-    else if ( prop->confine == CONFINE_ON )
-    {
-        cPos = prop->confine_space_ptr->project(cPos);
-    }    
-    
     // check activity
     ///@todo better Duo::activation criteria
-    if ( prop->activation_space_ptr->inside(cPos) )
+    if ( prop->activation_space_ptr->isInside(cPos) )
         activate();
 
     
@@ -154,6 +142,8 @@ void Duo::write(Outputter& out) const
 {
     out.writeUInt8(mActive);
     Couple::write(out);
+    if ( out.precise() )
+        out.writeDouble(gspTime);
 }
 
 
@@ -164,6 +154,8 @@ void Duo::read(Inputter& in, Simul& sim, ObjectTag tag)
 #endif
     mActive = in.readUInt8();
     Couple::read(in, sim, tag);
+    if ( in.precise() )
+        gspTime = in.readDouble();
 }
 
 
@@ -52,8 +52,8 @@ public:
     /// activity flag
     bool    active() const { return mActive; }
     
-    /// simulation step for a free Duo
-    void    stepFF(Simul&);
+    /// activity and attachment of a free Duo, after diffusion and confinement
+    void    attachFF(Simul&);
     
     /// simulation step for a Duo attached by Hand1
     void    stepAF(Simul&);
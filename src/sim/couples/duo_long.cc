@@ -6,7 +6,7 @@
 #include "random.h"
 #include "meca.h"
 
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 //------------------------------------------------------------------------------
 
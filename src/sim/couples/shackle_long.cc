@@ -4,7 +4,7 @@
 #include "modulo.h"
 #include "meca.h"
 
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 //------------------------------------------------------------------------------
 ShackleLong::ShackleLong(ShackleProp const* p, Vector const& w)
@@ -19,10 +19,29 @@ Event * EventSet::findID(ObjectID n) const
     return static_cast<Event*>(inventory.get(n));
 }
 
+void EventSet::link(Object * obj)
+{
+    assert_true( obj->tag() == Event::TAG );
+    ObjectSet::link(obj);
+    nextTime = std::min(nextTime, static_cast<Event*>(obj)->nextTime);
+}
+
+
+/**
+ The Events are only visited if one of them is due, and the time of the next
+ Event is updated during this pass. Events created meanwhile are included by link()
+ */
 void EventSet::step()
 {
+    if ( simul.time() < nextTime )
+        return;
+    
+    nextTime = INFINITY;
     for ( Event * e=first(); e; e=e->next() )
+    {
         e->step(simul);
+        nextTime = std::min(nextTime, e->nextTime);
+    }
 }
 
 
@@ -13,10 +13,13 @@ class Event;
  */
 class EventSet : public ObjectSet
 {
+    /// no Event is due before this time
+    real        nextTime;
+    
 public:
     
     /// creator
-    EventSet(Simul& s) : ObjectSet(s) {}
+    EventSet(Simul& s) : ObjectSet(s), nextTime(0) {}
     
     //--------------------------
     
@@ -46,6 +49,9 @@ public:
     /// return pointer to the Object of given ID, or zero if not found
     Event *     findID(ObjectID n) const;
     
+    /// register an Event, updating the time at which the next Event is due
+    void        link(Object *);
+    
     /// Monte-Carlo simulation step for every Object
     void        step();
 
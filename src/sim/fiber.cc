@@ -15,24 +15,38 @@
 #include "meca.h"
 #include "hand.h"
 #include "sim.h"
-#include <fstream>
-#include <list>
-#include <map>
-#include <functional>
-#include <vector>
-#include <deque>
+#include "event_log.h"
+#include "small_array.h"
 
 #pragma mark - Step
 
-std::ofstream fout("output.txt", std::ios_base::app);
-int cuts = 0;
+/**
+ Hazard of breaking for a segment under tension `ten`, during one time step.
+ The probability of breaking is p = 1 / ( 1 + exp(rate) ), with
+ rate = 100 * ( threshold - ten ), and this returns h = -log( 1 - p )
+ */
+static inline real breaking_hazard(real threshold, real ten)
+{
+    real rate = 100 * (threshold - ten);
+    // for large negative rate, log(1+exp(-rate)) = -rate
+    return (rate > -32) ? std::log1p(std::exp(-rate)) : -rate;
+}
 
 void Fiber::step()
 {
-    std::filebuf *foutbuf;
-    foutbuf = fout.rdbuf();
-    std::clog.rdbuf(foutbuf);
-    // fout << "STEP FUNCTION" << std::endl;
+    if (stepEnds())
+        stepFiber();
+    else
+        delete (this);
+}
+
+/**
+ This breaks the Fiber, performs the cuts that were registered, deletes the
+ Fiber if it is too short, and updates the Hands if the Fiber has changed.
+ These changes may affect other objects, and they are made by only one thread.
+ */
+void Fiber::stepFiber()
+{
     assert_small(length1() - length());
 
     // add single that act like glue
@@ -60,75 +74,42 @@ void Fiber::step()
     }
 #endif
 
-    bool severed = false;
-    bool printed = false;
-
     // Microtubule breaking
-    if (Fiber::prop->breaking)
+    if (prop->breaking && hasTensions())
     {
-        std::map<real, std::deque<int>> segmentmap;
-        std::vector<real> tensionkeys;
-        std::vector<real> unsortedtensionkeys;
-        std::vector<real> tenbeforebreak;
-
-        std::clog << nbSegments() << "\n";
-
-        for (int segment = 0; segment < nbSegments(); ++segment)
+        /*
+         The segments break independently, with hazard `h` given by breaking_hazard().
+         The fiber breaks with probability 1 - exp(-H), where H is the sum of the
+         hazards, and the segment is then chosen with a probability proportional to `h`.
+         A single random number is used to decide the event, the segment, and the
+         position of the cut inside the segment.
+         The tensions are those calculated by Mecafil::computeTensions(),
+         and a fiber that was modified since then cannot break
+         */
+        const unsigned nbs = nbSegments();
+        const real threshold = prop->breaking_threshold;
+        real H = 0;
+        for (unsigned s = 0; s < nbs; ++s)
+            H += breaking_hazard(threshold, std::abs(tension(s)));
+
+        const real P = -std::expm1(-H);
+        real u = RNG.preal();
+        if (u < P)
         {
-            tensionkeys.push_back(abs(tension(segment)));
-            unsortedtensionkeys.push_back(abs(tension(segment)));
-            if (segmentmap[abs(tension(segment))].size() > 0)
-            {
-                segmentmap[abs(tension(segment))].push_back(segment);
-            }
-            else
+            // rescale to a uniform number in [0, H), and find corresponding segment:
+            u *= H / P;
+            unsigned s = 0;
+            real h = breaking_hazard(threshold, std::abs(tension(0)));
+            while (u >= h && s + 1 < nbs)
             {
-                std::deque<int> seg = {segment};
-                segmentmap[abs(tension(segment))] = seg;
+                u -= h;
+                ++s;
+                h = breaking_hazard(threshold, std::abs(tension(s)));
             }
-        }
-        std::sort(tensionkeys.begin(), tensionkeys.end(), std::greater<real>());
-        while (!severed && !tensionkeys.empty())
-        {
-
-            int index = 0;
-            real ten = *tensionkeys.begin();
-
-            // Rate code with threshold 5/2/23
-            real rate = 100 * (Fiber::prop->breaking_threshold - ten);
-            real prob = 1 / (1 + exp(rate));
-
-            // tenbeforebreak = unsortedtensionkeys;
+            const real abscissa = abscissaPoint(s + ((h > 0) ? std::min(u / h, (real)1) : 0.5));
 
-            if (RNG.test(prob))
-            {
-
-                if (segmentmap[ten].size() > 1)
-                {
-                    index = rand() % segmentmap[ten].size();
-                }
-
-                // for (int i = 0; i < tenbeforebreak.size(); i++)
-                // {
-                //     if (i != tenbeforebreak.size() - 1)
-                //     {
-                //         std::clog << tenbeforebreak[i] << ", ";
-                //     }
-                //     else
-                //     {
-                //         std::clog << tenbeforebreak[i] << "\n";
-                //     }
-                // }
-
-                real abscissa = abscissaPoint(segmentmap[ten][index]) + RNG.preal() * Fiber::prop->segmentation;
-                sever(abscissa, STATE_RED, STATE_GREEN);
-                severed = true;
-                int breakloc = segmentmap[ten][index];
-            }
-            else
-            {
-                tensionkeys.erase(tensionkeys.begin());
-            }
+            simul().recordEvent(EventRecord::BREAK, identity(), abscissa, tension(s));
+            sever(abscissa, STATE_RED, STATE_GREEN);
         }
     }
 
@@ -157,7 +138,8 @@ void Fiber::step()
  and other newFiber() functions where the initial length is known.
  */
 Fiber::Fiber(FiberProp const *p)
-    : handListFront(nullptr), handListBack(nullptr), frGlue(nullptr), prop(p), disp(nullptr)
+    : handListFront(nullptr), handListBack(nullptr), frGlue(nullptr),
+      frDrag(0), frDragLength(-1), frDragStamp(0), prop(p), disp(nullptr)
 {
     if (prop)
     {
@@ -323,16 +305,7 @@ Fiber *Fiber::severPoint(unsigned int pti)
     truncateP(pti);
 
     // transfer Hands above point P, at same abscissa
-    Hand *ha = handListFront;
-    while (ha)
-    {
-        Hand *nx = ha->next();
-        if (ha->abscissa() > abs)
-            ha->relocate(fib);
-        else
-            ha->reinterpolate();
-        ha = nx;
-    }
+    transferHands(fib, abs, 0);
 
     resetLattice();
     fib->resetLattice();
@@ -385,17 +358,7 @@ Fiber *Fiber::severM(real abs)
 
     // transfer all Hands above cut to new piece
     // their abscissa should not change in this transfer
-    abs += abscissaM();
-    Hand *ha = handListFront;
-    while (ha)
-    {
-        Hand *nx = ha->next();
-        if (ha->abscissa() >= abs)
-            ha->relocate(fib);
-        else
-            ha->reinterpolate();
-        ha = nx;
-    }
+    transferHands(fib, abs + abscissaM(), 0);
 
     resetLattice();
     fib->resetLattice();
@@ -442,6 +405,9 @@ void Fiber::severNow()
         }
         else
         {
+            // tension of the segment being cut:
+            const unsigned seg = std::min(nbSegments() - 1, (unsigned)((cut.abs - abscissaM()) / segmentation()));
+            const real ten = tension(seg);
             Fiber *frag = severM(cut.abs - abscissaM());
 
             // special case where the PLUS_END section is simply deleted
@@ -456,6 +422,8 @@ void Fiber::severNow()
 
             if (frag)
             {
+                simul().recordEvent(EventRecord::SEVER, identity(), cut.abs, ten, frag->identity());
+
                 // check that ends spatially match:
                 assert_small((frag->posEndM() - posEndP()).norm());
 
@@ -508,7 +476,7 @@ unsigned Fiber::hasKink(const real max_cosine) const
 
 void Fiber::planarCut(Vector const &n, const real a, state_t stateP, state_t stateM)
 {
-    Array<real> cuts;
+    SmallArray<real, 8> cuts;
 
     /*
      The cuts should be processed in order of decreasing abscissa,
@@ -559,13 +527,7 @@ void Fiber::join(Fiber *fib)
     setDynamicStateP(fib->dynamicStateP());
 
     // transfer all Hands
-    Hand *ha = fib->handListFront;
-    while (ha)
-    {
-        Hand *nx = ha->next();
-        ha->relocate(this, ha->abscissa() + shift);
-        ha = nx;
-    }
+    fib->transferHands(this, -INFINITY, shift);
     delete (fib);
 
     resetLattice();
@@ -738,28 +700,36 @@ real Fiber::dragCoefficientSurface(const real len, FiberProp const *prop)
         dragCoefficientEllipsoid();
         dragCoefficientCylinder();
 
+ The drag coefficient is only recalculated if the length of the Fiber or the
+ parameters of its FiberProp have changed since the last call.
  */
 void Fiber::setDragCoefficient()
 {
     const real len = length();
     assert_true(len > 0);
 
-    real drag = 0;
-
-    if (prop->drag_model)
+    if (len != frDragLength || prop->drag_stamp != frDragStamp)
     {
-        drag = dragCoefficientSurface(len, prop);
+        real drag = 0;
+
+        if (prop->drag_model)
+        {
+            drag = dragCoefficientSurface(len, prop);
 #if (0)
-        real d = dragCoefficientCylinder(len, prop);
-        Cytosim::log << "Drag coefficient of Fiber near a planar surface amplified by " << drag / d << std::endl;
+            real d = dragCoefficientCylinder(len, prop);
+            Cytosim::log << "Drag coefficient of Fiber near a planar surface amplified by " << drag / d << std::endl;
 #endif
-    }
-    else
-        drag = dragCoefficientCylinder(len, prop);
+        }
+        else
+            drag = dragCoefficientCylinder(len, prop);
 
-    assert_true(drag > 0);
+        assert_true(drag > 0);
+        frDrag = drag;
+        frDragLength = len;
+        frDragStamp = prop->drag_stamp;
+    }
     // distribute drag equally to all points, to set point's mobility
-    rfPointMobility = nPoints / drag;
+    rfPointMobility = nPoints / frDrag;
 
 #if (0)
     std::ostream &os = std::cerr; // Cytosim::log;
@@ -770,6 +740,7 @@ void Fiber::setDragCoefficient()
 
 void Fiber::prepareMecable()
 {
+    invalidateTensions();
     setDragCoefficient();
     storeDirections();
     makeProjection();
@@ -851,22 +822,20 @@ void Fiber::setInteractions(Meca &meca) const
         switch (prop->confine)
         {
         case CONFINE_INSIDE:
-            for (unsigned i = 0; i < nPoints; ++i)
-            {
-                Vector pos = posP(i);
-                if (spc->outside(pos))
-                    spc->setInteraction(pos, Mecapoint(this, i), meca, prop->confine_stiffness);
-            }
-            break;
-
         case CONFINE_OUTSIDE:
+        {
+            // test all the vertices with one call:
+            SmallArray<bool, 64> ins;
+            ins.resize(nPoints);
+            spc->insideMany(pPos, nPoints, ins.data());
+            const bool out = (prop->confine == CONFINE_OUTSIDE);
             for (unsigned i = 0; i < nPoints; ++i)
             {
-                Vector pos = posP(i);
-                if (spc->inside(pos))
-                    spc->setInteraction(pos, Mecapoint(this, i), meca, prop->confine_stiffness);
+                if (ins[i] == out)
+                    spc->setInteraction(posP(i), Mecapoint(this, i), meca, prop->confine_stiffness);
             }
-            break;
+        }
+        break;
 
         case CONFINE_ON:
             for (unsigned i = 0; i < nPoints; ++i)
@@ -896,7 +865,7 @@ void Fiber::setInteractions(Meca &meca) const
         {
             unsigned L = lastPoint();
             Vector pos = posP(L);
-            if (spc->inside(pos))
+            if (spc->isInside(pos))
                 spc->setInteraction(pos, Mecapoint(this, L), meca, prop->confine_stiffness);
         }
         break;
@@ -947,6 +916,48 @@ void Fiber::removeHand(Hand *n) const
     }
 }
 
+/**
+ Transfer to `fib` the Hands bound at abscissa `abs` or above, adding `shift`
+ to their abscissa, and reinterpolate the Hands that remain on this Fiber.
+ The transferred Hands are unlinked in the same pass, and appended as one block
+ to the list of `fib`, instead of being unlinked and linked one at a time.
+ */
+void Fiber::transferHands(Fiber *fib, real abs, real shift) const
+{
+    assert_true(fib != this);
+    Hand *front = nullptr, *back = nullptr;
+    Hand *ha = handListFront;
+    while (ha)
+    {
+        Hand *nx = ha->next();
+        if (ha->abscissa() >= abs)
+        {
+            removeHand(ha);
+            ha->prev(back);
+            if (back)
+                back->next(ha);
+            else
+                front = ha;
+            back = ha;
+        }
+        else
+            ha->reinterpolate();
+        ha = nx;
+    }
+    if (front)
+    {
+        back->next(nullptr);
+        front->prev(fib->handListBack);
+        if (fib->handListBack)
+            fib->handListBack->next(front);
+        else
+            fib->handListFront = front;
+        fib->handListBack = back;
+        for (ha = front; ha; ha = ha->next())
+            ha->transfer(fib, ha->abscissa() + shift);
+    }
+}
+
 void Fiber::updateHands() const
 {
     for (Hand *ha = handListFront; ha; ha = ha->next())
@@ -977,14 +988,17 @@ int compareAbscissa(const void *a, const void *b)
 
 /**
  This sorts the Hands in order of increasing abscissa
- Sorting is done by copying to temporary array space, using std::qsort
+ Sorting is done by copying to temporary array space, using std::qsort.
+ This space is on the stack, unless there are more than 32 Hands.
  */
 void Fiber::sortHands() const
 {
     size_t cnt = nbHands();
     if (cnt > 1)
     {
-        Hand **tmp = new Hand *[cnt];
+        SmallArray<Hand *, 32> buf;
+        buf.resize(cnt);
+        Hand **tmp = buf.data();
 
         size_t i = 0;
         Hand *n = handListFront;
@@ -1008,8 +1022,6 @@ void Fiber::sortHands() const
         }
         n->next(nullptr);
         handListBack = n;
-
-        delete[] tmp;
     }
 }
 
@@ -1112,6 +1124,7 @@ real Fiber::freshAssembly(const FiberEnd end) const
 void Fiber::updateFiber()
 {
     needUpdate = false;
+    invalidateTensions();
 #if (0)
     Cytosim::log << reference() << " update [ " << std::setw(9) << std::left << abscissaM();
     Cytosim::log << " " << std::setw(9) << std::left << abscissaP() << " ]" << std::endl;
@@ -1380,6 +1393,7 @@ void Fiber::write(Outputter &out) const
 void Fiber::read(Inputter &in, Simul &sim, ObjectTag tag)
 {
 // std::clog << this << " Fiber::read(" << tag << ")\n";
+    invalidateTensions();
 #ifdef BACKWARD_COMPATIBILITY
     if (in.formatID() == 33)
         mark(in.readUInt32());
@@ -84,6 +84,15 @@ private:
     /// a grafted used to immobilize the Fiber
     Single *            frGlue;
     
+    /// drag coefficient, calculated for length `frDragLength`
+    real                frDrag;
+    
+    /// length for which `frDrag` was calculated
+    real                frDragLength;
+    
+    /// value of `prop->drag_stamp` when `frDrag` was calculated
+    unsigned            frDragStamp;
+    
 protected:
 #if NEW_FIBER_CHEW
     /// stored chewing at the end
@@ -163,8 +172,18 @@ public:
     /// call Chain::join(), and transfer Hands (caller should delete `fib`).
     virtual void   join(Fiber * fib);
     
-    /// simulation step
-    virtual void   step();
+    /// simulate the assembly of the ends, returning false if the Fiber should be deleted
+    /**
+     This part of step() only modifies this Fiber, and it can be called for
+     different Fibers in parallel, if each thread uses its own generator `RNG`.
+     */
+    virtual bool   stepEnds() { return true; }
+    
+    /// the part of step() that follows stepEnds()
+    void           stepFiber();
+    
+    /// simulation step, calling stepEnds() and stepFiber()
+    void           step();
     
     /// called if a Fiber tip has elongated or shortened
     void           updateFiber();
@@ -223,6 +242,9 @@ public:
     /// unregister bound Hands (which has detached)
     void           removeHand(Hand*) const;
     
+    /// move the Hands bound above abscissa `abs` to `fib`, shifting their abscissa
+    void           transferHands(Fiber* fib, real abs, real shift) const;
+    
     /// update all Hands bound to this
     void           updateHands() const;
 
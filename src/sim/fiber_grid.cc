@@ -13,7 +13,11 @@
 #include "simul.h"
 #include "sim.h"
 
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 
 #if ( 0 )
@@ -43,6 +47,8 @@ unsigned FiberGrid::setGrid(Space const* space, real max_step)
     space->boundaries(inf, sup);
     
     int n_cell[3] = { 1, 1, 1 };
+    bool periodic[3] = { false, false, false };
+    bool same = fGrid.hasDimensions() && ( max_step == fStep );
     
     for ( unsigned d = 0; d < DIM; ++d )
     {
@@ -51,12 +57,8 @@ unsigned FiberGrid::setGrid(Space const* space, real max_step)
         if ( n_cell[d] < 0 )
             throw InvalidParameter("invalid space:boundaries");
         
-        if ( modulo  &&  modulo->isPeriodic(d) )
-        {
-            //adjust the grid to match the edges exactly
-            fGrid.setPeriodic(d, true);
-        }
-        else
+        periodic[d] = ( modulo  &&  modulo->isPeriodic(d) );
+        if ( !periodic[d] )
         {
             //extend the grid by one cell on each side
             inf[d]    -= max_step;
@@ -66,17 +68,44 @@ unsigned FiberGrid::setGrid(Space const* space, real max_step)
         
         if ( n_cell[d] <= 0 )
             n_cell[d] = 1;
+        
+        same &= ( periodic[d] == fGrid.isPeriodic(d) );
     }
+    
+    /*
+     The current grid is kept if it was made with the same `max_step` and
+     still covers the Space, such that the cells do not change if the Space
+     shrinks, and the results of cellIndex() remain valid.
+     */
+    if ( same && fGrid.covers(inf, sup) )
+        return fGrid.nbCells();
+
+    //adjust the grid to match the edges exactly in the periodic directions
+    for ( unsigned d = 0; d < DIM; ++d )
+        fGrid.setPeriodic(d, periodic[d]);
 
     //create the grid using the calculated dimensions:
     fGrid.setDimensions(inf, sup, n_cell);
+    fStep = max_step;
+    ++fStamp;
     return fGrid.nbCells();
 }
 
 
 void FiberGrid::createCells()
 {
-    fGrid.createCells();
+    if ( fSparse )
+    {
+        // all cells share the empty list at index 0:
+        fTiles.resize(fGrid.nbCells());
+        fStart.resize(2);
+    }
+    else
+        fStart.resize(fGrid.nbCells()+2);
+    for ( index_t i = 0; i < fStart.size(); ++i )
+        fStart[i] = 0;
+    fSegments.clear();
+    paintRange = -1;
 #if ( 0 )
     if ( fGrid.nbCells() > 4096 )
         fGrid.printSummary(std::cerr, "FiberGrid");
@@ -86,7 +115,32 @@ void FiberGrid::createCells()
 
 size_t FiberGrid::hasGrid() const
 {
-    return fGrid.hasCells();
+    if ( fStart.size() )
+        return fGrid.nbCells();
+    return 0;
+}
+
+
+size_t FiberGrid::memory() const
+{
+    size_t res = fStart.memory() + fTiles.memory() + fSegments.memory();
+    for ( PaintBin const& b : fBins )
+        res += b.memory();
+    res += paintRecords.memory() + paintPoints.memory();
+    res += fQueries.memory() + fSorted.memory() + fQueryStart.memory();
+    return res;
+}
+
+
+void FiberGrid::setThreads(int nbt)
+{
+#ifdef _OPENMP
+    if ( nbt <= 0 )
+        nbt = omp_get_max_threads();
+    nbThreads = std::max(1, nbt);
+#else
+    nbThreads = 1;
+#endif
 }
 
 //------------------------------------------------------------------------------
@@ -95,14 +149,14 @@ size_t FiberGrid::hasGrid() const
 /// Structure used by FiberGrid::paintGrid to find Hand's attachement
 struct PaintJob
 {
-    FiberGrid::grid_type * grid;
+    FiberGrid::grid_type const* grid;
+    FiberGrid::PaintBin * bin;
     FiberSegment segment;
 };
 
 
 /**
- paintCell(x,y,z) adds a Segment to the SegmentList associated with
- the grid point (x,y,z).
+ paintCell(x,y,z) records that a Segment covers the cell (x,y,z).
  It is called by the rasterizer function paintFatLine().
  
  This version uses the fact that cells with consecutive
@@ -111,49 +165,88 @@ struct PaintJob
 void paintCell(const int x_inf, const int x_sup, const int y, const int z, void * arg)
 {
     auto* grid = static_cast<PaintJob*>(arg)->grid;
+    auto* bin = static_cast<PaintJob*>(arg)->bin;
     const auto& seg = static_cast<PaintJob*>(arg)->segment;
     //printf("paint %p in (%i to %i, %i, %i)\n", seg, x_inf, x_sup, y, z);
 
 #if   ( DIM == 1 )
-    FiberGrid::SegmentList * inf = & grid->icell1D( x_inf );
-    FiberGrid::SegmentList * sup = & grid->icell1D( x_sup );
+    FiberGrid::index_t inf = grid->pack1D( x_inf );
+    FiberGrid::index_t sup = grid->pack1D( x_sup );
 #elif ( DIM == 2 )
-    FiberGrid::SegmentList * inf = & grid->icell2D( x_inf, y );
-    FiberGrid::SegmentList * sup = & grid->icell2D( x_sup, y );
+    FiberGrid::index_t inf = grid->pack2D( x_inf, y );
+    FiberGrid::index_t sup = grid->pack2D( x_sup, y );
 #else
-    FiberGrid::SegmentList * inf = & grid->icell3D( x_inf, y, z );
-    FiberGrid::SegmentList * sup = & grid->icell3D( x_sup, y, z );
+    FiberGrid::index_t inf = grid->pack3D( x_inf, y, z );
+    FiberGrid::index_t sup = grid->pack3D( x_sup, y, z );
 #endif
     
-    # pragma ivdep
-    for ( FiberGrid::SegmentList * list = inf; list <= sup; ++list )
-        list->push_back(seg);
+    for ( FiberGrid::index_t c = inf; c <= sup; ++c )
+        bin->push_back(FiberGrid::PaintItem(c, seg));
 }
 
 
 /** 
- paintCellPeriodic(x,y,z) adds a Segment in the SegmentList associated with
- the grid point (x,y,z). 
+ paintCellPeriodic(x,y,z) records that a Segment covers the cell (x,y,z).
  It is called by the rasterizer function paintFatLine()
  */
 
 void paintCellPeriodic(const int x_inf, const int x_sup, const int y, const int z, void * arg)
 {
     auto* grid = static_cast<PaintJob*>(arg)->grid;
+    auto* bin = static_cast<PaintJob*>(arg)->bin;
     const auto& seg = static_cast<PaintJob*>(arg)->segment;
     //printf("paint %p in (%i to %i, %i, %i)\n", seg, x_inf, x_sup, y, z);
     
-    # pragma ivdep
     for ( int x = x_inf; x <= x_sup; ++x )
     {
-        //@todo write/call a specialized function for periodic: icellP1D
 #if   ( DIM == 1 )
-        grid->icell1D( x ).push_back(seg);
+        bin->push_back(FiberGrid::PaintItem(grid->pack1D(x), seg));
 #elif ( DIM == 2 )
-        grid->icell2D( x, y ).push_back(seg);
+        bin->push_back(FiberGrid::PaintItem(grid->pack2D(x, y), seg));
 #elif ( DIM == 3 )
-        grid->icell3D( x, y, z ).push_back(seg);
+        bin->push_back(FiberGrid::PaintItem(grid->pack3D(x, y, z), seg));
+#endif
+    }
+}
+
+
+/// paint the segments of the given Fibers, recording the cells in `bin`
+static void paintFibers(Fiber const** first, Fiber const** last, FiberGrid::PaintBin& bin,
+                        FiberGrid::grid_type const& grid, real width)
+{
+    const Vector offset(grid.inf());
+    const Vector deltas(grid.delta());
+    
+    //define the painting function used:
+    void (*paint)(int, int, int, int, void*) = modulo ? paintCellPeriodic : paintCell;
+    
+    PaintJob job;
+    job.grid = &grid;
+    job.bin = &bin;
+    bin.clear();
+    
+    for ( Fiber const** ptr = first; ptr < last; ++ptr )
+    {
+        const Fiber * fib = *ptr;
+        Vector P, Q = fib->posP(0);
+        const real iPQ = 1.0 / fib->segmentation();
+
+        for ( unsigned n = 1; n < fib->nbPoints(); ++n )
+        {
+            P = Q;
+            Q = fib->posP(n);
+            job.segment.set(fib, n-1);
+
+#if   ( DIM == 1 )
+            Rasterizer::paintFatLine1D(paint, &job, P, Q, width, offset, deltas);
+#elif ( DIM == 2 )
+            Rasterizer::paintFatLine2D(paint, &job, P, Q, iPQ, width, offset, deltas);
+#else
+            //Rasterizer::paintHexLine3D(paint, &job, P, Q, iPQ, width, offset, deltas);
+            Rasterizer::paintFatLine3D(paint, &job, P, Q, iPQ, width, offset, deltas);
+            //Rasterizer::paintBox3D(paint, &job, P, Q, width, offset, deltas);
 #endif
+        }
     }
 }
 
@@ -190,38 +283,173 @@ void FiberGrid::paintGrid(const Fiber * first, const Fiber * last, real range)
     assert_true(hasGrid());
     assert_true(range >= 0);
     
-    fGrid.clear();
-    const Vector offset(fGrid.inf());
-    const Vector deltas(fGrid.delta());
+    paintRange = -1;
     const real width = range + 0.5 * fGrid.diagonalLength();
     
-    //define the painting function used:
-    void (*paint)(int, int, int, int, void*) = modulo ? paintCellPeriodic : paintCell;
-    
+    // collect the Fibers, to distribute them between threads:
+    Array<Fiber const*> fibs;
+    size_t pts = 0;
     for ( const Fiber * fib = first; fib != last ; fib=fib->next() )
     {
-        PaintJob job;
-        job.grid = &fGrid;
-        Vector P, Q = fib->posP(0);
-        const real iPQ = 1.0 / fib->segmentation();
-
-        for ( unsigned n = 1; n < fib->nbPoints(); ++n )
+        fibs.push_back(fib);
+        pts += fib->nbPoints();
+    }
+    
+    // give each thread a contiguous range of Fibers, with similar number of points:
+    const int T = std::max(1, std::min(nbThreads, (int)fibs.size()));
+    SmallArray<Fiber const**, 16> lim;
+    lim.resize(T+1);
+    lim[0] = fibs.begin();
+    {
+        size_t cnt = 0;
+        int t = 1;
+        for ( Fiber const** ptr = fibs.begin(); ptr < fibs.end() && t < T; ++ptr )
         {
-            P = Q;
-            Q = fib->posP(n);
-            job.segment.set(fib, n-1);
+            cnt += (*ptr)->nbPoints();
+            if ( cnt * T >= pts * t )
+                lim[t++] = ptr+1;
+        }
+        while ( t <= T )
+            lim[t++] = fibs.end();
+    }
+    if ( fBins.size() < (size_t)T )
+        fBins.resize(T);
 
-#if   ( DIM == 1 )
-            Rasterizer::paintFatLine1D(paint, &job, P, Q, width, offset, deltas);
-#elif ( DIM == 2 )
-            Rasterizer::paintFatLine2D(paint, &job, P, Q, iPQ, width, offset, deltas);
-#else
-            //Rasterizer::paintHexLine3D(paint, &job, P, Q, iPQ, width, offset, deltas);
-            Rasterizer::paintFatLine3D(paint, &job, P, Q, iPQ, width, offset, deltas);
-            //Rasterizer::paintBox3D(paint, &job, P, Q, width, offset, deltas);
+#ifdef _OPENMP
+    if ( T > 1 )
+    {
+        #pragma omp parallel for num_threads(T)
+        for ( int t = 0; t < T; ++t )
+            paintFibers(lim[t], lim[t+1], fBins[t], fGrid, width);
+    }
+    else
 #endif
+        paintFibers(lim[0], lim[1], fBins[0], fGrid, width);
+    
+    // with the sparse layout, only the occupied tiles are allocated:
+    index_t nbc = fGrid.nbCells();
+    if ( fSparse )
+    {
+        fTiles.clear();
+        for ( int t = 0; t < T; ++t )
+        {
+            for ( PaintItem const& i : fBins[t] )
+                fTiles.mark(i.cell);
+        }
+        nbc = fTiles.allocate();
+        for ( int t = 0; t < T; ++t )
+        {
+            for ( PaintItem & i : fBins[t] )
+                i.cell = fTiles.slot(i.cell);
+        }
+        fStart.resize(nbc+2);
+    }
+    
+    // count the segments in each cell:
+    index_t * start = fStart.data();
+    for ( index_t c = 0; c < nbc; ++c )
+        start[c] = 0;
+    for ( int t = 0; t < T; ++t )
+    {
+        for ( PaintItem const& i : fBins[t] )
+            ++start[i.cell];
+    }
+    
+    // calculate the end of each cell by prefix-sum:
+    index_t sum = 0;
+    for ( index_t c = 0; c < nbc; ++c )
+    {
+        sum += start[c];
+        start[c] = sum;
+    }
+    start[nbc] = sum;
+    start[nbc+1] = sum;
+    
+    /*
+     Copy the segments, iterating backward such that the order of the bins
+     is preserved, and such that `start` is finally set to the first segment
+     */
+    fSegments.resize(sum);
+    FiberSegment * dst = fSegments.data();
+    for ( int t = T-1; t >= 0; --t )
+    {
+        PaintItem const* inf = fBins[t].begin();
+        for ( PaintItem const* i = fBins[t].end(); i-- > inf; )
+            dst[--start[i->cell]] = i->seg;
+    }
+}
+
+
+void FiberGrid::recordPositions(const Fiber * first, const Fiber * last)
+{
+    size_t cnt = 0, sup = 0, pts = 0;
+    for ( const Fiber * fib = first; fib != last ; fib=fib->next() )
+    {
+        sup = std::max(sup, (size_t)fib->identity());
+        pts += fib->nbPoints();
+        ++cnt;
+    }
+    paintRecords.resize(sup+1);
+    paintPoints.resize(DIM*pts);
+    paintCount = cnt;
+    
+    index_t off = 0;
+    for ( const Fiber * fib = first; fib != last ; fib=fib->next() )
+    {
+        PaintRecord & rec = paintRecords[fib->identity()];
+        rec.fib = fib;
+        rec.off = off;
+        rec.cnt = fib->nbPoints();
+        copy_real(DIM*rec.cnt, fib->data(), paintPoints.data()+off);
+        off += DIM * rec.cnt;
+    }
+}
+
+
+bool FiberGrid::checkPositions(const Fiber * first, const Fiber * last) const
+{
+    const real ss = paintSlack * paintSlack;
+    size_t cnt = 0;
+    for ( const Fiber * fib = first; fib != last ; fib=fib->next() )
+    {
+        if ( fib->identity() >= paintRecords.size() )
+            return false;
+        PaintRecord const& rec = paintRecords[fib->identity()];
+        if ( rec.fib != fib || rec.cnt != fib->nbPoints() )
+            return false;
+        real const* ref = paintPoints.data() + rec.off;
+        for ( index_t p = 0; p < rec.cnt; ++p )
+        {
+            if ( ( fib->posP(p) - Vector(ref+DIM*p) ).normSqr() > ss )
+                return false;
         }
+        ++cnt;
+    }
+    return ( cnt == paintCount );
+}
+
+
+/**
+ A point located at distance `range` of a segment is also at distance
+ `range + slack` or less from the segment at its recorded position,
+ if each vertex of the segment has moved by `slack` or less.
+ Hence painting with `range + slack` remains valid until some vertex has moved
+ by more than `slack`. The Fibers must also be the same and have the same
+ number of vertices, since the grid refers to segments by their index.
+ */
+void FiberGrid::updateGrid(const Fiber * first, const Fiber * last, real range, real slack)
+{
+    if ( slack <= 0 )
+    {
+        paintGrid(first, last, range);
+        return;
     }
+    if ( paintRange == range + slack && paintSlack == slack && checkPositions(first, last) )
+        return;
+    paintGrid(first, last, range + slack);
+    recordPositions(first, last);
+    paintRange = range + slack;
+    paintSlack = slack;
 }
 
 
@@ -243,25 +471,41 @@ void FiberGrid::tryToAttach(Vector const& place, Hand& ha) const
     assert_true( hasGrid() );
     
     //get the cell index closest to the position in space:
-    const auto indx = fGrid.index(place, 0.5);
-    
-    //get the list of rods associated with this cell:
-    SegmentList & segments = fGrid.icell(indx);
+    attachInCell(fGrid.index(place, 0.5), place, ha);
+}
+
 
+/**
+ Test attachment of the Hand to the segments of cell `indx`, which must be
+ the cell containing `place`
+ */
+void FiberGrid::attachInCell(const index_t indx, Vector const& place, Hand& ha) const
+{
+    //get the list of rods associated with this cell:
+    const index_t S = slot(indx);
+    FiberSegment * inf = fSegments.data() + fStart[S];
+    FiberSegment * sup = fSegments.data() + fStart[S+1];
+    
     //randomize the list, to make attachments more fair:
-    if ( segments.size() > 1 )
+    if ( sup - inf > 1 )
     {
-        // randomize the list order
-        //std::random_shuffle(segments.begin(), segments.end());
-        segments.shuffle();
+        // randomize the list order, with a Fisher-Yates shuffle as Array::shuffle()
+        uint32_t jj = (uint32_t)( sup - inf ), kk;
+        while ( jj > 1 )
+        {
+            kk = RNG.pint32(jj);
+            --jj;
+            std::swap(inf[jj], inf[kk]);
+        }
     }
-    else if ( segments.empty() )
+    else if ( sup == inf )
         return;
     
-    //std::clog << "tryToAttach has " << segments.size() << " segments\n";
+    //std::clog << "tryToAttach has " << sup - inf << " segments\n";
     
-    for ( FiberSegment const& seg : segments )
+    for ( FiberSegment const* ptr = inf; ptr < sup; ++ptr )
     {
+        FiberSegment const& seg = *ptr;
         if ( RNG.test(ha.prop->binding_prob) )
         {
             real dis = INFINITY;
@@ -289,6 +533,75 @@ void FiberGrid::tryToAttach(Vector const& place, Hand& ha) const
 }
 
 
+/**
+ If batching is enabled by setBatch(), the query is recorded, to be processed
+ later by attachQueued(). Otherwise, tryToAttach() is called immediately.
+ */
+void FiberGrid::queueAttach(const index_t indx, Vector const& place, Hand& ha)
+{
+    assert_true( hasGrid() );
+    
+    if ( batchAttach )
+        fQueries.push_back(AttachQuery(indx, place, &ha));
+    else
+        attachInCell(indx, place, ha);
+}
+
+
+/**
+ Process all the queries recorded by queueAttach() since the last call.
+ 
+ The queries are shuffled and then sorted by cell with a stable counting sort,
+ such that the queries of the same cell are processed consecutively, while the
+ list of segments of this cell is in cache, in random order. The processing
+ starts at a random position in the sorted list, and continues cyclically.
+ 
+ Since attachments are delayed, a Hand may have been attached in the meantime,
+ and these queries are skipped.
+ */
+void FiberGrid::attachQueued()
+{
+    const index_t cnt = fQueries.size();
+    if ( cnt == 0 )
+        return;
+    
+    AttachQuery * qry = fQueries.data();
+    
+    // randomize the order, with a Fisher-Yates shuffle as Array::shuffle()
+    for ( uint32_t jj = cnt; jj > 1; )
+    {
+        uint32_t kk = RNG.pint32(jj);
+        --jj;
+        std::swap(qry[jj], qry[kk]);
+    }
+    
+    // count queries in each cell:
+    const index_t nbc = fGrid.nbCells();
+    fQueryStart.resize(nbc+1);
+    index_t * start = fQueryStart.data();
+    for ( index_t c = 0; c <= nbc; ++c )
+        start[c] = 0;
+    for ( index_t i = 0; i < cnt; ++i )
+        ++start[qry[i].cell+1];
+    for ( index_t c = 1; c <= nbc; ++c )
+        start[c] += start[c-1];
+    
+    // sort queries by cell, keeping the random order within each cell:
+    fSorted.resize(cnt);
+    for ( index_t i = 0; i < cnt; ++i )
+        fSorted[start[qry[i].cell]++] = qry[i];
+
+    const index_t off = RNG.pint32(cnt);
+    for ( index_t n = 0; n < cnt; ++n )
+    {
+        AttachQuery & Q = fSorted[(n+off)%cnt];
+        if ( Q.hand->unattached() )
+            attachInCell(Q.cell, Q.pos, *Q.hand);
+    }
+    fQueries.clear();
+}
+
+
 /**
  This function is limited to the range given in paintGrid();
  */
@@ -297,11 +610,12 @@ FiberGrid::SegmentList FiberGrid::nearbySegments(Vector const& place, const real
     SegmentList res;
     
     //get the grid node list index closest to the position in space:
-    const auto indx = fGrid.index(place, 0.5);
+    const index_t S = slot(fGrid.index(place, 0.5));
     
     //get the list of rods associated with this cell:
-    for ( FiberSegment const& seg : fGrid.icell(indx) )
+    for ( index_t i = fStart[S]; i < fStart[S+1]; ++i )
     {
+        FiberSegment const& seg = fSegments[i];
         if ( seg.fiber() != exclude )
         {
             real dis = INFINITY;
@@ -319,14 +633,15 @@ FiberGrid::SegmentList FiberGrid::nearbySegments(Vector const& place, const real
 FiberSegment FiberGrid::closestSegment(Vector const& place) const
 {
     //get the cell index from the position in space:
-    const auto indx = fGrid.index(place, 0.5);
+    const index_t S = slot(fGrid.index(place, 0.5));
     
     FiberSegment res(nullptr, 0);
     real hit = INFINITY;
     
     //get the list of rods associated with this cell:
-    for ( FiberSegment const& seg : fGrid.icell(indx) )
+    for ( index_t i = fStart[S]; i < fStart[S+1]; ++i )
     {
+        FiberSegment const& seg = fSegments[i];
         //we compute the distance from the hand to the candidate rod,
         //and compare it to the best we have so far.
         real dis = INFINITY;
@@ -366,11 +681,18 @@ Function testAttach() is given a position in space,
  - attachement has equal probability to all targets,
  - no target is missed,
  - attachment are not made to targets that are beyond binding_range
+ .
+ The targets are found by checking all the segments of `set`.
+ The Hand should have `binding_prob = 1`, such that every call attaches if
+ there is any target. The results are printed to `out` if some target received
+ less than half of the expected hits, or if an attachment was spurious.
  */
-void FiberGrid::testAttach(FILE* out, const Vector pos, FiberSet const& set, HandProp const* hp) const
+FiberGrid::AttachTest FiberGrid::testAttach(FILE* out, const Vector pos, FiberSet const& set,
+                                            HandProp const* hp, size_t cnt) const
 {
     typedef std::map < unsigned, int > map_type;
     map_type hits;
+    AttachTest res;
 
     // create a test Hand with a dummy HandMonitor:
     HandMonitor hm;
@@ -391,46 +713,63 @@ void FiberGrid::testAttach(FILE* out, const Vector pos, FiberSet const& set, Han
     }
     
     const size_t n_targets = hits.size();
-    // call tryTyAttach 100 times per target:
+    res.targets = n_targets;
+    // call tryTyAttach `cnt` times per target:
     for ( size_t n = 0; n < n_targets; ++n )
-    for ( size_t i = 0; i < 100; ++i )
+    for ( size_t i = 0; i < cnt; ++i )
     {
+        ++res.trials;
         tryToAttach(pos, ha);
         if ( ha.attached() )
         {
             Interpolation inter = ha.fiber()->interpolate(ha.abscissa());
             FiberSegment seg(ha.fiber(), inter.point1());
             
-            if ( hits.find(mingle(seg)) != hits.end() )
-                ++hits[mingle(seg)];
+            map_type::iterator h = hits.find(mingle(seg));
+            if ( h != hits.end() && h->second >= 0 )
+            {
+                ++h->second;
+                ++res.hits;
+            }
             else
-                hits[mingle(seg)] = -2;
+            {
+                hits[mingle(seg)] = -1;
+                ++res.spurious;
+            }
             //fprintf(out, "   attached to f%04d abscissa %7.3f\n", ha.fiber()->identity(), ha.abscissa());
             ha.detach();
         }
     }
     
     if ( hits.empty() )
-        return;
+        return res;
 
     //detect segments that have been missed or mistargeted:
-    int verbose = 0;
+    const real avg = real(res.hits) / real(n_targets);
+    int verbose = ( res.spurious > 0 );
     for ( auto const& i : hits )
     {
-        if ( i.second < 50 )
-            verbose = 1;
+        if ( i.second >= 0 )
+        {
+            res.chi2 += square(i.second - avg);
+            res.missed += ( i.second == 0 );
+            if ( 2 * size_t(i.second) < cnt )
+                verbose = 1;
+        }
     }
+    if ( avg > 0 )
+        res.chi2 /= avg;
     
-    if ( verbose )
+    if ( out && verbose )
     {
         // print a summary of all targets:
         fprintf(out, "FiberGrid::testAttach %lu target(s) within %.3f um of", n_targets, hp->binding_range);
         pos.println(out);
 #if ( 0 )
         //report content of grid's list
-        const auto indx = fGrid.index(pos, 0.5);
-        for ( FiberSegment const& seg : fGrid.icell(indx) )
-            fprintf(out, "    target f%04d:%02i\n", seg.fiber()->identity(), seg.point());
+        const index_t S = slot(fGrid.index(pos, 0.5));
+        for ( index_t i = fStart[S]; i < fStart[S+1]; ++i )
+            fprintf(out, "    target f%04d:%02i\n", fSegments[i].fiber()->identity(), fSegments[i].point());
 #endif
         //report for all the segments that were targeted:
         for ( auto const& hit : hits )
@@ -452,6 +791,7 @@ void FiberGrid::testAttach(FILE* out, const Vector pos, FiberSet const& set, Han
             fprintf(out, "\n");
         }
     }
+    return res;
 }
 
 //==============================================================================
@@ -6,12 +6,14 @@
 #include "dim.h"
 #include "vector.h"
 #include "array.h"
-#include "grid.h"
-//#include <vector>
+#include "small_array.h"
+#include "grid_base.h"
+#include "tiled_index.h"
+#include "fiber_segment.h"
+#include <vector>
 
 class Simul;
 class PropertyList;
-class FiberSegment;
 class FiberSet;
 class Modulo;
 class Space;
@@ -26,86 +28,228 @@ class Node;
 A divide-and-conquer algorithm is used to find all segments of fibers close to a given point:
  
  -# It uses a grid 'fGrid' covering the space, initialized by setGrid().
-    After initialization, each cell of the grid has an empty SegmentList (a list of FiberSegment*).
- -# clear() resets all lists on the grid
- -# paintGrid() distributes the segments specified in the arguments to the cell-associated SegmentList.
+    After initialization, each cell of the grid has an empty list of FiberSegment.
+ -# paintGrid() distributes the segments specified in the arguments to the lists of the cells.
     One of the argument specifies a maximum distance to be queried (`max_range`).
     After the distribution, tryToAttach() is able to find any segment
     located at a distance `max_range` or less from any given point, in linear time.
  -# The function tryToAttach(X, ...) finds the cell on fGrid that contain `X`. 
-    The associated SegmentList will then contains all the segments located at distance `max_range` or less from `X`. 
+    The associated list will then contains all the segments located at distance `max_range` or less from `X`. 
     tryToAttach() calls a function distanceSqr() sequentially for all the segments in this list,
     to calculate the exact Euclidian distance. 
     Finally, using a random number it tests the probability of attachment for the Hand given as argument.
  .
  
- @todo we could call paintGrid() only if the objects have moved by a certain threshold.
- This would work if we also extend the painted area around the rod, by the same threshold.
- we must also redo the paintGrid() when MT points are added or removed.
+ updateGrid() calls paintGrid() only if the objects have moved by more than
+ a threshold `slack`, since the painted area around the rods is extended by
+ this threshold. The grid is also repainted if any Fiber was added or removed,
+ or if the number of points of any Fiber has changed.
+ This leads to a CPU gain if calling clear() or paintGrid() is limiting,
+ which is the case in particular in 3D, because the number of grid-cells is large,
+ at the cost of more segments associated with each cell.
  
- Such algortihm should lead to large CPU gain, if calling clear() or paintGrid() is limiting,
- which is the case in particular in 3D, because the number of grid-cells is large.
+ The lists of all cells are stored contiguously in `fSegments`, and the list
+ of cell `i` is [ fStart[i], fStart[i+1] [.
+ With the sparse layout (setSparse), the cells are grouped in tiles, and only the
+ tiles covered by some segment have an entry in `fStart` (see TiledIndex).
+ The list of cell `i` is then [ fStart[s], fStart[s+1] [ with s = fTiles.slot(i). To build them, the Fibers are
+ divided between threads, and each thread records the cells covered by its
+ segments in a separate bin. The bins are then merged, using the counts
+ per cell, in the order of the threads, such that the result does not depend
+ on the number of threads.
+ 
+ With setBatch(true), queueAttach() only records the queries of the Hands,
+ and attachQueued() processes them later grouped by cell (see simul:binding_batch).
 */
 
 class FiberGrid 
 {
 public:
     
-    /// type for a list of FiberSegment
-    typedef Array<FiberSegment> SegmentList;
-    //typedef std::vector<FiberSegment> SegmentList;
+    /// type for a short list of FiberSegment
+    typedef SmallArray<FiberSegment, 8> SegmentList;
 
     /// type of grid
-    typedef Grid<SegmentList, DIM> grid_type;
+    typedef GridBase<DIM> grid_type;
     
     /// type of index
     typedef grid_type::index_t index_t;
     
+    /// a segment with the index of a cell that it covers
+    struct PaintItem
+    {
+        index_t      cell;
+        FiberSegment seg;
+        PaintItem() {}
+        PaintItem(index_t c, FiberSegment const& s) : cell(c), seg(s) {}
+    };
+    
+    /// list of PaintItem
+    typedef Array<PaintItem> PaintBin;
+    
 private:
     
     /// grid for divide-and-conquer strategies:
     grid_type fGrid;
     
+    /// index of the first segment of each list in `fSegments`
+    Array<index_t> fStart;
+    
+    /// if true, the lists are only allocated for the occupied tiles of the grid
+    bool    fSparse;
+    
+    /// map from cells to lists, used if `fSparse`
+    TiledIndex fTiles;
+    
+    /// index of the list of cell `c` in `fStart`
+    index_t slot(index_t c) const { return fSparse ? fTiles.slot(c) : c; }
+    
+    /// concatenated lists of segments of all cells
+    mutable Array<FiberSegment> fSegments;
+    
+    /// temporary bins used by paintGrid(), one per thread
+    std::vector<PaintBin> fBins;
+    
+    /// number of threads used by paintGrid()
+    int     nbThreads;
+    
+    /// incremented every time the dimensions of the grid are changed
+    unsigned fStamp;
+    
+    /// value of `max_step` given to setGrid() when the dimensions were set
+    real     fStep;
+    
+    /// position of the vertices of a Fiber, when the grid was painted
+    struct PaintRecord
+    {
+        Fiber const* fib;
+        index_t      off;
+        index_t      cnt;
+    };
+    
+    /// records of the painted Fibers, indexed by Fiber::identity()
+    Array<PaintRecord> paintRecords;
+    
+    /// coordinates of the vertices of all painted Fibers
+    Array<real> paintPoints;
+    
+    /// number of Fibers painted
+    size_t  paintCount;
+    
+    /// range used in the last paintGrid(), or -1 if the grid is not valid
+    real    paintRange;
+    
+    /// margin added to the range in the last paintGrid()
+    real    paintSlack;
+
+    /// a request to attach a Hand, recorded by queueAttach()
+    struct AttachQuery
+    {
+        index_t cell;
+        Vector  pos;
+        Hand *  hand;
+        AttachQuery() : cell(0), hand(nullptr) {}
+        AttachQuery(index_t c, Vector const& w, Hand* h) : cell(c), pos(w), hand(h) {}
+    };
+    
+    /// if true, queueAttach() records the queries instead of processing them
+    bool    batchAttach;
+    
+    /// queries recorded by queueAttach()
+    Array<AttachQuery> fQueries;
+    
+    /// queries sorted by cell
+    Array<AttachQuery> fSorted;
+    
+    /// cursors used to sort the queries
+    Array<index_t> fQueryStart;
+
+    /// test attachment of Hand to the segments of given cell
+    void         attachInCell(index_t, Vector const&, Hand&) const;
+
+    /// record positions of all Fibers
+    void         recordPositions(const Fiber * first, const Fiber * last);
+
+    /// true if all vertices are within `paintSlack` of their recorded position
+    bool         checkPositions(const Fiber * first, const Fiber * last) const;
+
 public:
     
     /// constructor
-    FiberGrid()  { }
+    FiberGrid() : fSparse(false), nbThreads(1), fStamp(0), fStep(0), paintCount(0), paintRange(-1), paintSlack(0), batchAttach(false) { }
    
     /// number of cells in grid
     index_t      nbCells() const { return fGrid.nbCells(); }
+    
+    /// size of the memory allocated for the lists, in bytes
+    size_t       memory() const;
 
     /// set a grid to cover the specified Space with cells of width `max_step` at most
     unsigned     setGrid(Space const*, real max_step);
     
+    /// select the sparse layout, which must be done before createCells()
+    void         setSparse(bool s) { fSparse = s; }
+    
     /// allocate memory for the grid, with the dimensions set by setGrid()
     void         createCells();
     
     /// true if the grid was initialized by calling setGrid()
     size_t       hasGrid() const;
     
+    /// set number of threads used in paintGrid(), following `simul:threads`
+    void         setThreads(int);
+    
     /// register the Fiber segments on the grid cells
-    void         paintGrid(const Fiber * first, const Fiber * last, real);
+    void         paintGrid(const Fiber * first, const Fiber * last, real range);
+    
+    /// call paintGrid() with `range+slack`, only if some Fiber has moved by more than `slack`
+    void         updateGrid(const Fiber * first, const Fiber * last, real range, real slack);
     
     /// given a position, find nearby Fiber segments and test attachement of the provided Hand
     void         tryToAttach(Vector const&, Hand&) const;
     
+    /// enable or disable batching of attachments
+    void         setBatch(bool b) { batchAttach = b; }
+    
+    /// call tryToAttach(), or record the query for attachQueued() if batching is enabled
+    void         queueAttach(Vector const& w, Hand& h) { queueAttach(cellIndex(w), w, h); }
+    
+    /// queueAttach() for a position `w` located in cell `c`, as given by cellIndex(w)
+    void         queueAttach(index_t c, Vector const& w, Hand&);
+    
+    /// index of the cell containing position `w`
+    index_t      cellIndex(Vector const& w) const { return fGrid.index(w, 0.5); }
+    
+    /// true if no segment is associated with cell `c`, in which case attachment cannot occur
+    bool         emptyCell(index_t c) const { index_t S = slot(c); return fStart[S] == fStart[S+1]; }
+    
+    /// value that changes whenever the cell indices are changed, to validate the results of cellIndex()
+    unsigned     stamp() const { return fStamp; }
+    
+    /// process the queries recorded by queueAttach(), grouped by cell
+    void         attachQueued();
+    
     
     /// return a list of all fiber segments located at a distance D or less from P, except those belonging to `exclude`
     SegmentList  nearbySegments(Vector const&, real disSqr, Fiber * exclude = nullptr) const;
 
-    SegmentList& segments(Vector const& pos) const
-    {
-        // get the cell index from the position in space:
-        const index_t indx = fGrid.index(pos, 0.5);
-        // get the list of rods associated with this cell:
-        return fGrid.icell(indx);
-    }
-    
     /// Among the segments closer than grid:range, return the closest one
     FiberSegment closestSegment(Vector const&) const;
     
-    /// test the results of tryToAttach(), at a particular position
-    void         testAttach(FILE *, Vector place, FiberSet const&, HandProp const*) const;
+    /// statistics collected by testAttach()
+    struct AttachTest
+    {
+        size_t targets;   ///< segments within range of the position, found by brute force
+        size_t trials;    ///< calls made to tryToAttach()
+        size_t hits;      ///< attachments to one of the targets
+        size_t missed;    ///< targets that were never attached
+        size_t spurious;  ///< attachments to segments that are beyond range
+        real   chi2;      ///< Pearson's statistic of the hits, for equiprobable targets
+        AttachTest() : targets(0), trials(0), hits(0), missed(0), spurious(0), chi2(0) {}
+    };
+
+    /// test the results of tryToAttach() at a particular position, calling it `cnt` times per target
+    AttachTest   testAttach(FILE *, Vector place, FiberSet const&, HandProp const*, size_t cnt = 100) const;
 
     /// OpenGL display function
     void         draw() const;
@@ -296,6 +296,7 @@ void FiberProp::clear()
     activity = "none";
     display = "";
     display_fresh = false;
+    drag_stamp = 0;
 
     used_polymer = 0;
     free_polymer = 1;
@@ -393,6 +394,10 @@ void FiberProp::read(Glossary &glos)
 
 void FiberProp::complete(Simul const &sim)
 {
+    // a unique value, such that all Fibers will recalculate their drag:
+    static unsigned stamp = 0;
+    drag_stamp = ++stamp;
+
     if (viscosity < 0)
         viscosity = sim.prop->viscosity;
 
@@ -501,6 +506,8 @@ void FiberProp::write_values(std::ostream &os) const
     write_value(os, "max_length", max_length);
     write_value(os, "total_polymer", total_polymer);
     write_value(os, "persistent", persistent);
+    write_value(os, "breaking", breaking);
+    write_value(os, "breaking_threshold", breaking_threshold);
     write_value(os, "viscosity", viscosity);
     write_value(os, "drag_radius", drag_radius);
     write_value(os, "drag_length", drag_length);
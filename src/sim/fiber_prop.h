@@ -278,6 +278,9 @@ public:
     /// pointer to actual confinement Space, derived from `confine_space`
     Space const *confine_space_ptr;
 
+    /// derived variable: changed by every call to complete(), see Fiber::setDragCoefficient()
+    unsigned drag_stamp;
+
 protected:
     /// maximum speed of shrinkage
     real max_chewing_speed_dt;
@@ -6,7 +6,7 @@
 #include "simul.h"
 #include "modulo.h"
 
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 //------------------------------------------------------------------------------
 //---------------- DISTANCE FROM A POINT TO A SECTION OF FIBER -----------------
@@ -13,7 +13,16 @@
 #include "treadmilling_fiber_prop.h"
 #include "clapack.h"
 #include "simul.h"
+#include "simul_prop.h"
 #include "sim.h"
+#include "philox.h"
+#include <algorithm>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+extern thread_local Modulo const* modulo;
 
 //#include "vecprint.h"
 
@@ -225,7 +234,7 @@ void FiberSet::write(Outputter &out) const
 
 /**
  Calculate the free monomer concentration.
- Calls step() once for every Fiber.
+ Steps every Fiber once, with stepParallel().
  */
 
 void FiberSet::step()
@@ -255,18 +264,66 @@ void FiberSet::step()
         }
     }
 
-    /*
-     We call step() here exactly once for every Fiber.
-     New Fiber may be created, for instance by Fiber::sever(), but they should
-     be linked at the start of the list, and thus not considered here.
-     */
-    Fiber *obj = first();
+    int nbt = 1;
+#ifdef _OPENMP
+    nbt = simul.prop->threads;
+    if (nbt <= 0)
+        nbt = omp_get_max_threads();
+#endif
+    stepParallel(nbt);
+}
 
-    while (obj)
+/**
+ Fiber::stepEnds() is called for all Fibers, in parallel with `nbt` threads.
+ The random numbers of each Fiber are drawn from its own Philox stream, keyed by
+ the step number and the identity of the Fiber, such that the result does not
+ depend on the number of threads, and the shared generator is not used.
+ The rest of the step, which may create or delete Fibers and detach Hands,
+ is then done sequentially in the order of the list.
+ New Fiber may be created, for instance by Fiber::sever(), but they are linked
+ at the start of the list, and are not stepped here.
+ */
+void FiberSet::stepParallel(int nbt)
+{
+    batch.clear();
+    for (Fiber *obj = first(); obj; obj = obj->next())
+        batch.push_back(obj);
+
+    const size_t cnt = batch.size();
+    batchKeep.resize(cnt);
+    Fiber **bat = batch.data();
+    int *keep = batchKeep.data();
+
+    const Philox gen(simul.prop->random_seed);
+    const uint32_t stp = (uint32_t)simul.nbSteps();
+    Modulo const *mod = modulo;
+
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(nbt) if (nbt > 1)
+#endif
     {
-        Fiber *nxt = obj->next();
-        obj->step();
-        obj = nxt;
+        // `modulo` and `localRNG` are thread_local:
+        modulo = mod;
+        Random *old = localRNG;
+        Random rng;
+        localRNG = &rng;
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (size_t i = 0; i < cnt; ++i)
+        {
+            rng.stream(gen, stp, bat[i]->identity(), Philox::ASSEMBLY);
+            keep[i] = bat[i]->stepEnds();
+        }
+        localRNG = old;
+    }
+
+    for (size_t i = 0; i < cnt; ++i)
+    {
+        if (keep[i])
+            bat[i]->stepFiber();
+        else
+            delete (bat[i]);
     }
 }
 
@@ -308,52 +365,128 @@ void FiberSet::foldPositions(Modulo const *m) const
         o->foldPosition(m);
 }
 
+/// integer coordinates of a cell, and index of a segment
+struct SegmentCell
+{
+    int c[3];
+    unsigned inx;
+
+    bool operator < (SegmentCell const& b) const
+    {
+        if ( c[0] != b.c[0] ) return c[0] < b.c[0];
+        if ( c[1] != b.c[1] ) return c[1] < b.c[1];
+        return c[2] < b.c[2];
+    }
+};
+
+/**
+ The segments are distributed according to their center, on a grid with cells
+ of size `range + L`, where L is the length of the longest segment.
+ Two segments closer than `range` have their centers separated by less than the
+ width of a cell, and are thus located in the same or in adjacent cells.
+ The candidate pairs (i, j) are returned with i < j, but in no particular order.
+ The distance between the segments is not calculated.
+ */
+void FiberSet::nearbyPairs(Array<FiberSegment> const &segs, const real range, Array<SegmentPair> &res)
+{
+    res.clear();
+    const unsigned cnt = segs.size();
+    if (cnt < 2)
+        return;
+
+    real len = 0;
+    for (FiberSegment const &seg : segs)
+        len = std::max(len, seg.diff().norm());
+    const real w = std::max(range + len, REAL_EPSILON);
+
+    // sort the segments by cell:
+    Array<SegmentCell> cells(cnt);
+    cells.resize(cnt);
+    for (unsigned i = 0; i < cnt; ++i)
+    {
+        Vector pos = segs[i].center();
+        SegmentCell &C = cells[i];
+        for (int d = 0; d < 3; ++d)
+            C.c[d] = d < DIM ? (int)std::floor(pos[d] / w) : 0;
+        C.inx = i;
+    }
+    std::stable_sort(cells.begin(), cells.end());
+
+    // check the cell of each segment and the adjacent cells:
+    const int zr = (DIM == 3);
+    const int yr = (DIM >= 2);
+    for (unsigned i = 0; i < cnt; ++i)
+    {
+        SegmentCell key = cells[i];
+        for (int dx = -1; dx <= 1; ++dx)
+        for (int dy = -yr; dy <= yr; ++dy)
+        for (int dz = -zr; dz <= zr; ++dz)
+        {
+            SegmentCell cen = key;
+            cen.c[0] += dx;
+            cen.c[1] += dy;
+            cen.c[2] += dz;
+            auto rng = std::equal_range(cells.begin(), cells.end(), cen);
+            // grow the array geometrically, since it can be large:
+            if (res.size() + (rng.second - rng.first) > res.capacity())
+                res.allocate(2 * res.capacity() + (rng.second - rng.first));
+            for (SegmentCell const *j = rng.first; j < rng.second; ++j)
+            {
+                if (key.inx < j->inx)
+                    res.push_back(SegmentPair(key.inx, j->inx));
+            }
+        }
+    }
+}
+
 /**
  Calculate intersection between all fibers,
  and report the corresponding abscissa in arrays 'res1' and 'res2'.
+ The candidate pairs of segments are found with nearbyPairs(), and sorted
+ to report the intersections in the order of the fibers and segments.
  */
 void FiberSet::allIntersections(Array<FiberSite> &res1, Array<FiberSite> &res2,
-                                const real max_distance) const
+                                const real max_distance, Array<real> *dis) const
 {
     const real sup = max_distance * max_distance;
     res1.clear();
     res2.clear();
+    if (dis)
+        dis->clear();
+
+    size_t cnt = 0;
+    for (Fiber *fib = first(); fib; fib = fib->next())
+        cnt += fib->nbSegments();
+
+    Array<FiberSegment> segs;
+    segs.allocate(cnt);
+    for (Fiber *fib = first(); fib; fib = fib->next())
+    {
+        for (unsigned s = 0; s < fib->nbSegments(); ++s)
+            segs.push_back(FiberSegment(fib, s));
+    }
+
+    Array<SegmentPair> pairs;
+    nearbyPairs(segs, max_distance, pairs);
+    std::sort(pairs.begin(), pairs.end());
 
-    for (Fiber *fib1 = first(); fib1; fib1 = fib1->next())
+    for (SegmentPair const &P : pairs)
     {
-        for (unsigned s1 = 0; s1 < fib1->nbSegments(); ++s1)
+        FiberSegment const &seg1 = segs[P.first];
+        FiberSegment const &seg2 = segs[P.second];
+        // exclude adjacent segments in the same fiber:
+        if (seg1.fiber() == seg2.fiber() && seg2.point() < seg1.point() + 2)
+            continue;
+        real abs1, abs2;
+        real dd = seg1.shortestDistance(seg2, abs1, abs2);
+        if (dd < sup)
         {
-            FiberSegment seg1(fib1, s1);
-            // check against other segments of this fiber
-            for (unsigned s2 = s1 + 2; s2 < fib1->nbSegments(); ++s2)
-            {
-                FiberSegment seg2(fib1, s2);
-                real abs1, abs2;
-                if (seg1.shortestDistance(seg2, abs1, abs2) < sup)
-                {
-                    if (seg1.within(abs1) & seg2.within(abs2))
-                    {
-                        res1.push_back(FiberSite(fib1, abs1 + fib1->abscissaPoint(s1)));
-                        res2.push_back(FiberSite(fib1, abs2 + fib1->abscissaPoint(s2)));
-                    }
-                }
-            }
-            // check against other fibers:
-            for (Fiber *fib2 = fib1->next(); fib2; fib2 = fib2->next())
+            if (seg1.within(abs1) & seg2.within(abs2))
             {
-                for (unsigned s2 = 0; s2 < fib2->nbSegments(); ++s2)
-                {
-                    FiberSegment seg2(fib2, s2);
-                    real abs1, abs2;
-                    if (seg1.shortestDistance(seg2, abs1, abs2) < sup)
-                    {
-                        if (seg1.within(abs1) & seg2.within(abs2))
-                        {
-                            res1.push_back(FiberSite(fib1, abs1 + fib1->abscissaPoint(s1)));
-                            res2.push_back(FiberSite(fib2, abs2 + fib2->abscissaPoint(s2)));
-                        }
-                    }
-                }
+                res1.push_back(FiberSite(const_cast<Fiber*>(seg1.fiber()), abs1 + seg1.abscissa1()));
+                res2.push_back(FiberSite(const_cast<Fiber*>(seg2.fiber()), abs2 + seg2.abscissa1()));
+                if (dis)
+                    dis->push_back(dd);
             }
         }
     }
@@ -1152,6 +1285,16 @@ void FiberSet::infoTension(unsigned &cnt, real &ten) const
     }
 }
 
+bool FiberSet::hasTensions() const
+{
+    for (Fiber const *fib = first(); fib; fib = fib->next())
+    {
+        if (!fib->hasTensions())
+            return false;
+    }
+    return true;
+}
+
 void FiberSet::infoRadius(unsigned &cnt, real &rad) const
 {
     real r = 0;
@@ -6,8 +6,11 @@
 #include "dim.h"
 #include "object_set.h"
 #include "fiber.h"
+#include "array.h"
+#include <utility>
 
 class FiberProp;
+class FiberSegment;
 class CoupleProp;
 class FiberSite;
 
@@ -23,6 +26,15 @@ class FiberSet : public ObjectSet
 private:
     
     FiberSet();
+    
+    /// Fibers stepped by stepParallel()
+    Array<Fiber*> batch;
+    
+    /// result of Fiber::stepEnds() for the Fibers in `batch`
+    Array<int> batchKeep;
+    
+    /// step the Fibers, using `nbt` threads and one random stream per Fiber for Fiber::stepEnds()
+    void stepParallel(int nbt);
 
 public:
     
@@ -78,8 +90,14 @@ public:
     /// bring all objects to centered image using periodic boundary conditions
     void foldPositions(Modulo const*) const;
     
-    /// find intersections between fibers in entire network, within given threshold
-    void allIntersections(Array<FiberSite>&, Array<FiberSite>&, real max_distance) const;
+    /// a pair of indices in an array of FiberSegment
+    typedef std::pair<unsigned, unsigned> SegmentPair;
+    
+    /// find pairs (i, j) of segments with i < j that may be closer than `range`, using a grid
+    static void nearbyPairs(Array<FiberSegment> const&, real range, Array<SegmentPair>&);
+
+    /// find intersections between fibers in entire network, within given threshold, optionally returning square of distances
+    void allIntersections(Array<FiberSite>&, Array<FiberSite>&, real max_distance, Array<real>* dis = nullptr) const;
 
     /// set random sites along the fibers, separated on average by `spread`
     void uniFiberSites(Array<FiberSite>&, real spread) const;
@@ -145,6 +163,9 @@ public:
     
     /// sum Lagrange multipliers for all fibers
     void  infoTension(unsigned&, real& hten) const;
+    
+    /// true if the tensions of all fibers correspond to their current vertices
+    bool  hasTensions() const;
 
     /// Calculate spindle indices
     void  infoSpindle(real& ixa, real& ixs, Vector const& n, real a, real m, real da) const;
@@ -60,7 +60,7 @@ void ClassicFiber::setDynamicStateP(state_t s)
  cf. `Dynamic instability of MTs is regulated by force`
  M.Janson, M. de Dood, M. Dogterom. JCB 2003, Figure 2 C.
  */
-void ClassicFiber::step()
+bool ClassicFiber::stepEnds()
 {
     constexpr int P = 0, M = 1;
     const real len = length();
@@ -159,8 +159,7 @@ void ClassicFiber::step()
         // the fiber is too short, we may delete it:
         if ( !prop->persistent )
         {
-            delete(this);
-            return;
+            return false;
         }
    
         // we may regrow:
@@ -188,7 +187,7 @@ void ClassicFiber::step()
         mGrowthP = 0;
     }
     
-    Fiber::step();
+    return true;
 }
 
 
@@ -204,6 +203,12 @@ void ClassicFiber::write(Outputter& out) const
     writeHeader(out, TAG_DYNAMIC);
     out.writeUInt16(mStateM);
     out.writeUInt16(mStateP);
+    // a checkpoint also records the assembly of the last step:
+    if ( out.precise() )
+    {
+        out.writeDouble(mGrowthM);
+        out.writeDouble(mGrowthP);
+    }
 }
 
 
@@ -235,6 +240,11 @@ void ClassicFiber::read(Inputter& in, Simul& sim, ObjectTag tag)
             setDynamicStateM(m);
             setDynamicStateP(p);
         }
+        if ( in.precise() )
+        {
+            mGrowthM = in.readDouble();
+            mGrowthP = in.readDouble();
+        }
     }
 #ifdef BACKWARD_COMPATIBILITY
     if ( tag != TAG_DYNAMIC || in.formatID() < 44 )
@@ -99,8 +99,8 @@ public:
     /// change state of PLUS_END
     void        setDynamicStateP(state_t s);
 
-    /// monte-carlo step
-    void        step();
+    /// simulate the assembly of the ends, returning false if the Fiber should be deleted
+    bool        stepEnds();
     
     //--------------------------------------------------------------------------
     
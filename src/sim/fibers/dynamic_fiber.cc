@@ -48,6 +48,28 @@ DynamicFiber::~DynamicFiber()
 //------------------------------------------------------------------------------
 #pragma mark -
 
+/**
+ Return the number of units removed during one time step, at `rate` units per step.
+ Shrinkage events do not change the state of the fiber end, and above a few events
+ per step, their count is drawn from a Poisson distribution in one call, instead
+ of drawing one exponential variable per event. The Gillespie timer `next` is then
+ left unchanged, which is valid because the exponential distribution is memoryless.
+ */
+static inline int shrinkUnits(real& next, const real rate)
+{
+    if ( rate > 4 )
+        return -(int)RNG.poisson(rate);
+    
+    int res = 0;
+    next -= rate;
+    while ( next <= 0 )
+    {
+        --res;
+        next += RNG.exponential();
+    }
+    return res;
+}
+
 
 state_t DynamicFiber::calculateStateM() const
 { 
@@ -82,7 +104,6 @@ void DynamicFiber::setDynamicStateM(state_t s)
 
 int DynamicFiber::stepMinusEnd()
 {
-    int res = 0;
     real chewing_rate = 0;
     
     // add chewing rate to stochastic off rate:
@@ -100,13 +121,7 @@ int DynamicFiber::stepMinusEnd()
     
 #endif
     
-    nextShrinkM -= prop->shrinking_rate_dt[1] + chewing_rate;
-    while ( nextShrinkM <= 0 )
-    {
-        --res;
-        nextShrinkM += RNG.exponential();
-    }
-    return res;
+    return shrinkUnits(nextShrinkM, prop->shrinking_rate_dt[1] + chewing_rate);
 }
 
 
@@ -174,12 +189,7 @@ int DynamicFiber::stepPlusEnd()
     
     if ( mStateP == STATE_RED )
     {
-        nextShrinkP -= prop->shrinking_rate_dt[0] + chewing_rate;
-        while ( nextShrinkP <= 0 )
-        {
-            --res;
-            nextShrinkP += RNG.exponential();
-        }
+        res = shrinkUnits(nextShrinkP, prop->shrinking_rate_dt[0] + chewing_rate);
     }
     else
     {
@@ -261,7 +271,7 @@ int DynamicFiber::stepPlusEnd()
 //------------------------------------------------------------------------------
 #pragma mark -
 
-void DynamicFiber::step()
+bool DynamicFiber::stepEnds()
 {
     // perform stochastic simulation:
     int incP = stepPlusEnd();
@@ -277,9 +287,7 @@ void DynamicFiber::step()
             // do something if the fiber is too short:
             if ( !prop->persistent )
             {
-                delete(this);
-                // exit to avoid doing anything with a dead object:
-                return;
+                return false;
             }
             // possibly rescue:
             if ( RNG.test(prop->rebirth_prob[0]) )
@@ -293,7 +301,7 @@ void DynamicFiber::step()
         }
     }
 
-    Fiber::step();
+    return true;
 }
 
 
@@ -311,6 +319,20 @@ void DynamicFiber::write(Outputter& out) const
     out.writeUInt8(unitM[1]);
     out.writeUInt8(unitP[0]);
     out.writeUInt8(unitP[1]);
+    // a checkpoint also records the Gillespie counters and the assembly of the last step:
+    if ( out.precise() )
+    {
+        out.writeUInt8(unitM[2]);
+        out.writeUInt8(unitP[2]);
+        out.writeDouble(nextGrowthM);
+        out.writeDouble(nextHydrolM);
+        out.writeDouble(nextShrinkM);
+        out.writeDouble(nextGrowthP);
+        out.writeDouble(nextHydrolP);
+        out.writeDouble(nextShrinkP);
+        out.writeDouble(mGrowthM);
+        out.writeDouble(mGrowthP);
+    }
 }
 
 
@@ -329,6 +351,20 @@ void DynamicFiber::read(Inputter& in, Simul& sim, ObjectTag tag)
         unitP[0] = in.readUInt8();
         unitP[1] = in.readUInt8();
         mStateP  = calculateStateP();
+
+        if ( in.precise() )
+        {
+            unitM[2] = in.readUInt8();
+            unitP[2] = in.readUInt8();
+            nextGrowthM = in.readDouble();
+            nextHydrolM = in.readDouble();
+            nextShrinkM = in.readDouble();
+            nextGrowthP = in.readDouble();
+            nextHydrolP = in.readDouble();
+            nextShrinkP = in.readDouble();
+            mGrowthM = in.readDouble();
+            mGrowthP = in.readDouble();
+        }
     }
 #ifdef BACKWARD_COMPATIBILITY
     if ( tag != TAG_DYNAMIC || in.formatID() < 44 )
@@ -152,8 +152,8 @@ public:
     /// simulate dynamic instability of MINUS_END
     int         stepMinusEnd();
     
-    /// monte-carlo step
-    void        step();
+    /// simulate the assembly of the ends, returning false if the Fiber should be deleted
+    bool        stepEnds();
     
     //--------------------------------------------------------------------------
     
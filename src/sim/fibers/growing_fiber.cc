@@ -49,7 +49,7 @@ void GrowingFiber::setDynamicStateP(state_t s)
 
 //------------------------------------------------------------------------------
 
-void GrowingFiber::step()
+bool GrowingFiber::stepEnds()
 {
     constexpr int P = 0, M = 1;
 
@@ -109,8 +109,7 @@ void GrowingFiber::step()
         if ( !prop->persistent )
         {
             // the fiber is too short, we delete it:
-            delete(this);
-            return;
+            return false;
         }
     }
     else if ( len + inc < prop->max_length )
@@ -131,7 +130,7 @@ void GrowingFiber::step()
         mGrowthP = 0;
     }
 
-    Fiber::step();
+    return true;
 }
 
 
@@ -94,8 +94,8 @@ public:
     real        freshAssemblyP() const { return mGrowthP; }
 
     
-    /// monte-carlo step
-    void        step();
+    /// simulate the assembly of the ends, returning false if the Fiber should be deleted
+    bool        stepEnds();
     
     //--------------------------------------------------------------------------
     
@@ -50,7 +50,7 @@ void TreadmillingFiber::setDynamicStateP(state_t s)
 
 //------------------------------------------------------------------------------
 
-void TreadmillingFiber::step()
+bool TreadmillingFiber::stepEnds()
 {    
     constexpr int P = 0, M = 1;
 
@@ -105,8 +105,7 @@ void TreadmillingFiber::step()
     if ( inc < 0  &&  len + inc < prop->min_length )
     {
         // the fiber is too short, we delete it:
-        delete(this);
-        return;
+        return false;
     }
     else if ( len + inc < prop->max_length )
     {
@@ -121,7 +120,7 @@ void TreadmillingFiber::step()
         if ( mGrowthP ) growP(inc*mGrowthP);
     }
 
-    Fiber::step();
+    return true;
 }
 
                   
@@ -137,6 +136,12 @@ void TreadmillingFiber::write(Outputter& out) const
     writeHeader(out, TAG_DYNAMIC);
     out.writeUInt16(mStateM);
     out.writeUInt16(mStateP);
+    // a checkpoint also records the assembly of the last step:
+    if ( out.precise() )
+    {
+        out.writeDouble(mGrowthM);
+        out.writeDouble(mGrowthP);
+    }
 }
 
 
@@ -150,6 +155,11 @@ void TreadmillingFiber::read(Inputter& in, Simul& sim, ObjectTag tag)
     {
         mStateM = in.readUInt16();
         mStateP = in.readUInt16();
+        if ( in.precise() )
+        {
+            mGrowthM = in.readDouble();
+            mGrowthP = in.readDouble();
+        }
     }
 #ifdef BACKWARD_COMPATIBILITY
     if ( tag != TAG_DYNAMIC || in.formatID() < 44 )
@@ -69,8 +69,8 @@ public:
     
     //--------------------------------------------------------------------------
     
-    /// monte-carlo step
-    void        step();
+    /// simulate the assembly of the ends, returning false if the Fiber should be deleted
+    bool        stepEnds();
     
     //--------------------------------------------------------------------------
     
@@ -7,17 +7,71 @@
 #include "cblas.h"
 #include "sim.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 
 /**
- Initialize the diffusion matrix using periodic boundary conditions
- if the underlying space is peridic
+ Build the list of cells involved in diffusion, and the table of their neighbors,
+ given the links between cells, as pairs of indices in the grid: ( lnk[2*i], lnk[2*i+1] ).
+ The cells are numbered in the order of the grid, and the values of the cells are
+ stored in this order in `fiTMP` during step(), such that the cost and the memory
+ scale with the number of cells inside the Space, rather than the size of the grid.
+ Each cell has 2 * DIM slots in `fiNeighbors`, and the unused slots refer to the cell
+ itself, since a missing link is equivalent to a link with a cell of same value.
  */
-void Field::prepareDiffusion(real theta)
+void Field::setDiffusionTable(Array<FieldGrid::index_t> const& lnk)
 {
     const FieldGrid::index_t nbc = mGrid.nbCells();
+    const FieldGrid::index_t none = ~0U;
+    Array<FieldGrid::index_t> map(nbc);
+    map.resize(nbc);
+    for ( FieldGrid::index_t c = 0; c < nbc; ++c )
+        map[c] = none;
+    for ( FieldGrid::index_t c : lnk )
+        map[c] = 0;
     
-    fiDiffusionMatrix.resize(nbc);
-    fiDiffusionMatrix.reset();
+    // number the cells that have at least one link:
+    fiCells.clear();
+    for ( FieldGrid::index_t c = 0; c < nbc; ++c )
+    {
+        if ( map[c] == 0 )
+        {
+            map[c] = fiCells.size();
+            fiCells.push_back(c);
+        }
+    }
+    
+    const FieldGrid::index_t cnt = fiCells.size();
+    Array<unsigned char> deg(cnt);
+    deg.resize(cnt);
+    fiNeighbors.resize(2*DIM*cnt);
+    for ( FieldGrid::index_t k = 0; k < cnt; ++k )
+    {
+        deg[k] = 0;
+        for ( int m = 0; m < 2*DIM; ++m )
+            fiNeighbors[2*DIM*k+m] = k;
+    }
+    for ( size_t i = 0; i+1 < lnk.size(); i += 2 )
+    {
+        FieldGrid::index_t a = map[lnk[i]];
+        FieldGrid::index_t b = map[lnk[i+1]];
+        assert_true( deg[a] < 2*DIM && deg[b] < 2*DIM );
+        fiNeighbors[2*DIM*a+deg[a]++] = b;
+        fiNeighbors[2*DIM*b+deg[b]++] = a;
+    }
+}
+
+
+/**
+ Initialize diffusion, using periodic boundary conditions if the underlying
+ space is peridic
+ */
+void Field::prepareDiffusion(real theta)
+{
+    const FieldGrid::index_t nbc = mGrid.nbCells();
+    Array<FieldGrid::index_t> lnk(2*DIM*nbc);
     
     for ( FieldGrid::index_t c = 0; c < nbc; ++c )
     {
@@ -27,23 +81,22 @@ void Field::prepareDiffusion(real theta)
                 
             if ( n != c )
             {
-                fiDiffusionMatrix(c, n) += theta;
-                fiDiffusionMatrix(c, c) -= theta;
-                fiDiffusionMatrix(n, n) -= theta;
+                lnk.push_back(c);
+                lnk.push_back(n);
+                if ( fiWeights )
+                {
+                    fiWeights[c+d*nbc] = theta;
+                    fiCyclic[d] |= ( n < c );
+                }
             }
         }
     }
-    fiDiffusionMatrix.prepareForMultiply(1);
-    
-    /*
-    std::clog << "tight Field has diffusion matrix with ";
-    std::clog << fiDiffusionMatrix.nbElements() << " elements" << std::endl;
-     */
+    setDiffusionTable(lnk);
 }
 
 
 /**
- Initialize the diffusion matrix.
+ Initialize diffusion.
  Diffusion is allowed between neighboring cells that are in the same domain:
 
      ( domain[c] > 0 ) && ( domain[c] == domain[n] )
@@ -52,9 +105,7 @@ void Field::prepareDiffusion(real theta)
 void Field::prepareDiffusion(real theta, unsigned char * domain)
 {
     const FieldGrid::index_t nbc = mGrid.nbCells();
-    
-    fiDiffusionMatrix.resize(nbc);
-    fiDiffusionMatrix.reset();
+    Array<FieldGrid::index_t> lnk(1024);
     
     for ( FieldGrid::index_t c = 0; c < nbc; ++c )
     {
@@ -66,19 +117,48 @@ void Field::prepareDiffusion(real theta, unsigned char * domain)
                 
                 if ( n < nbc  &&  domain[c] == domain[n] )
                 {
-                    fiDiffusionMatrix(c, n) += theta;
-                    fiDiffusionMatrix(c, c) -= theta;
-                    fiDiffusionMatrix(n, n) -= theta;
+                    lnk.push_back(c);
+                    lnk.push_back(n);
+                    // only the links within a line of the grid are used by diffuseLines():
+                    if ( fiWeights && ( c / mGrid.stride(d) ) % mGrid.breadth(d) + 1 < mGrid.breadth(d) )
+                        fiWeights[c+d*nbc] = theta;
                 }
             }
         }
     }
-    fiDiffusionMatrix.prepareForMultiply(1);
+    setDiffusionTable(lnk);
+}
+
+
+/**
+ Explicit diffusion of the cells listed in `fiCells`, using the table of neighbors:
+ 
+     field[c] <- field[c] + theta * sum( field[n] - field[c] ) for all neighbors `n` of `c`
+ 
+ The values are first gathered in `fiTMP`, in the order of `fiCells`.
+ */
+void Field::diffuseCells(real * field, const real theta)
+{
+    const FieldGrid::index_t cnt = fiCells.size();
+    FieldGrid::index_t const* cell = fiCells.data();
+    FieldGrid::index_t const* nbr = fiNeighbors.data();
+    real * val = fiTMP;
     
-    /*
-     std::clog << "Field has diffusion matrix with ";
-     std::clog << fiDiffusionMatrix.nbElements() << " elements" << std::endl;
-     */
+    for ( FieldGrid::index_t k = 0; k < cnt; ++k )
+        val[k] = field[cell[k]];
+    
+    for ( FieldGrid::index_t k = 0; k < cnt; ++k )
+    {
+        FieldGrid::index_t const* n = nbr + 2 * DIM * k;
+        real s = val[n[0]] + val[n[1]];
+#if ( DIM > 1 )
+        s += val[n[2]] + val[n[3]];
+#endif
+#if ( DIM > 2 )
+        s += val[n[4]] + val[n[5]];
+#endif
+        field[cell[k]] = val[k] + theta * ( s - 2 * DIM * val[k] );
+    }
 }
 
 
@@ -95,9 +175,19 @@ void Field::prepare()
     const FieldGrid::index_t nbc = mGrid.nbCells();
     assert_true( nbc > 0 );
     
-    free_real(fiTMP);
-    fiTMP = new_real(nbc);
-    fiTMPSize = nbc;
+    const bool implicit = ( prop->diffusion > 0 && prop->diffusion_scheme > 0 );
+
+    fiCells.clear();
+    fiNeighbors.clear();
+    free_real(fiWeights);
+    fiWeights = nullptr;
+    for ( int d = 0; d < 3; ++d )
+        fiCyclic[d] = false;
+    if ( implicit )
+    {
+        fiWeights = new_real(DIM*nbc);
+        zero_real(DIM*nbc, fiWeights);
+    }
 
     if ( prop->diffusion > 0 )
     {
@@ -133,6 +223,51 @@ void Field::prepare()
             delete[] domain;
         }
     }
+    
+    /*
+     The implicit diffusion needs two temporary arrays covering the grid,
+     and the explicit diffusion only needs to cover the cells in `fiCells`
+     */
+    size_t tmp = fiCells.size();
+    if ( implicit )
+        tmp = 2 * nbc;
+    free_real(fiTMP);
+    fiTMP = new_real(std::max(tmp, (size_t)1));
+    fiTMPSize = tmp;
+    
+    // the full diffusion writes to a second grid, which is then exchanged:
+    delete[] fiNext;
+    fiNext = nullptr;
+    if ( prop->full_diffusion > 0 )
+    {
+        fiNext = new FieldScalar[nbc];
+        advise_huge_pages(fiNext, nbc * sizeof(FieldScalar));
+    }
+}
+
+
+size_t Field::memory() const
+{
+    size_t res = mGrid.nbCells() * sizeof(value_type);
+    res += fiCells.memory() + fiNeighbors.memory();
+    res += fiTMPSize * sizeof(real);
+    if ( fiNext )
+        res += mGrid.nbCells() * sizeof(FieldScalar);
+    if ( fiWeights )
+        res += DIM * mGrid.nbCells() * sizeof(real);
+    return res;
+}
+
+
+void Field::setThreads(int nbt)
+{
+#ifdef _OPENMP
+    if ( nbt <= 0 )
+        nbt = omp_get_max_threads();
+    fiThreads = std::max(1, nbt);
+#else
+    fiThreads = 1;
+#endif
 }
 
 
@@ -140,150 +275,238 @@ void Field::prepare()
 #pragma mark - Diffusion
 
 
-void Field::diffuseX(real * field, real c)
+/**
+ Solve the diffusion along the lines of the grid in direction `d`:
+ 
+     ( I - a * L ) * X = ( I + b * L ) * field
+ 
+ where L is the diffusion operator in this direction, with coefficients `fiWeights`.
+ The system is tridiagonal for each line, and is solved with the Thomas algorithm,
+ without pivoting since the matrix is diagonally dominant. The grid is made of
+ blocks of `breadth(d)` planes, each containing `stride(d)` consecutive cells,
+ and all the lines of a block are processed together, such that the inner loops
+ run over consecutive cells and can be vectorized, except if `d == 0`.
+ If the diffusion wraps around the grid, the cyclic tridiagonal system is solved
+ with the Sherman-Morrison formula (see Numerical Recipes, section 2.7).
+ */
+void Field::diffuseLines(real * field, const int d, const real a, const real b)
 {
-    const auto nbc = mGrid.nbCells();
-
-    FieldGrid::index_t nx = mGrid.breadth(0);
-    FieldGrid::index_t nyz = nbc / nx;
-    FieldGrid::index_t ide = mGrid.stride(1);
-    
-    real * a = new_real(nyz);
-    real * b = new_real(nyz);
+    const FieldGrid::index_t nbc = mGrid.nbCells();
+    const FieldGrid::index_t S = mGrid.stride(d);
+    const FieldGrid::index_t N = mGrid.breadth(d);
+    const bool cyc = fiCyclic[d];
     
-    // diffusion in X-direction:
-    zero_real(nyz, a);
-    for ( FieldGrid::index_t x = 1; x < nx; ++x )
-    {
-        real * h = field + x - 1;
-        real * n = field + x;
-        // b = n - h
-        blas::xcopy(nyz,  n, ide, b, 1);
-        blas::xaxpy(nyz, -1, h, ide, b, 1);
-        // a = a - b
-        blas::xaxpy(nyz, -1, b, 1, a, 1);
-        // h = h - c * a
-        blas::xaxpy(nyz, -c, a, 1, h, ide);
-        // swap a and b
-        real * t = a;
-        a = b;
-        b = t;
-    }
-    real * h = field + nx - 1;
-    blas::xaxpy(nyz, -c, a, 1, h, ide);
+    if ( N < 2 )
+        return;
     
-    if ( prop->periodic )
+    for ( FieldGrid::index_t o = 0; o < nbc; o += S * N )
     {
-        real * n = field;
-        blas::xcopy(nyz,  n, ide, b, 1);
-        blas::xaxpy(nyz, -1, h, ide, b, 1);
-        blas::xaxpy(nyz,  c, b, 1, h, ide);
-        blas::xaxpy(nyz, -c, b, 1, n, ide);
+        real * X = field + o;
+        real * C = fiTMP + o;        // modified upper diagonal
+        real * Z = fiTMP + nbc + o;  // copy of X, and then vector of Sherman-Morrison
+        real const* W = fiWeights + d * nbc + o;
+        // links of the last plane, which wrap around the grid if `cyc`:
+        real const* E = W + S * ( N - 1 );
+        
+        if ( b > 0 )
+        {
+            // X <- X + b * L * X
+            copy_real(S*N, X, Z);
+            for ( FieldGrid::index_t i = 0; i+1 < N; ++i )
+            {
+                real * x = X + S * i;
+                real const* z = Z + S * i;
+                real const* w = W + S * i;
+                for ( FieldGrid::index_t j = 0; j < S; ++j )
+                {
+                    real f = b * w[j] * ( z[j+S] - z[j] );
+                    x[j] += f;
+                    x[j+S] -= f;
+                }
+            }
+            if ( cyc )
+            {
+                real * x = X + S * ( N - 1 );
+                real const* z = Z + S * ( N - 1 );
+                for ( FieldGrid::index_t j = 0; j < S; ++j )
+                {
+                    real f = b * E[j] * ( Z[j] - z[j] );
+                    x[j] += f;
+                    X[j] -= f;
+                }
+            }
+        }
+        
+        // forward elimination, with the diagonal term doubled if `cyc`:
+        for ( FieldGrid::index_t j = 0; j < S; ++j )
+        {
+            real dia = 1 + a * ( E[j] + W[j] );
+            real piv = cyc ? 2 * dia : dia;
+            C[j] = -a * W[j] / piv;
+            X[j] = X[j] / piv;
+            Z[j] = -dia / piv;
+        }
+        for ( FieldGrid::index_t i = 1; i < N; ++i )
+        {
+            real * x = X + S * i;
+            real * c = C + S * i;
+            real * z = Z + S * i;
+            real const* px = x - S;
+            real const* pc = c - S;
+            real const* pz = z - S;
+            real const* w = W + S * i;
+            real const* v = w - S;
+            const bool last = cyc && ( i + 1 == N );
+            for ( FieldGrid::index_t j = 0; j < S; ++j )
+            {
+                real l = -a * v[j];
+                real dia = 1 + a * ( v[j] + w[j] );
+                real u = 0;
+                if ( last )
+                {
+                    real dia0 = 1 + a * ( E[j] + W[j] );
+                    dia += a * a * E[j] * E[j] / dia0;
+                    u = -a * E[j];
+                }
+                real piv = dia - l * pc[j];
+                c[j] = -a * w[j] / piv;
+                x[j] = ( x[j] - l * px[j] ) / piv;
+                z[j] = ( u - l * pz[j] ) / piv;
+            }
+        }
+        
+        // back substitution:
+        for ( FieldGrid::index_t i = N-1; i-- > 0; )
+        {
+            real * x = X + S * i;
+            real * z = Z + S * i;
+            real const* c = C + S * i;
+            for ( FieldGrid::index_t j = 0; j < S; ++j )
+            {
+                x[j] -= c[j] * x[j+S];
+                z[j] -= c[j] * z[j+S];
+            }
+        }
+        
+        if ( cyc )
+        {
+            // Sherman-Morrison correction, with the factors stored in C:
+            real const* x = X + S * ( N - 1 );
+            real const* z = Z + S * ( N - 1 );
+            for ( FieldGrid::index_t j = 0; j < S; ++j )
+            {
+                real gam = -( 1 + a * ( E[j] + W[j] ));
+                real bet = -a * E[j];
+                C[j] = ( X[j] + bet * x[j] / gam ) / ( 1 + Z[j] + bet * z[j] / gam );
+            }
+            for ( FieldGrid::index_t i = 0; i < N; ++i )
+            {
+                real * x = X + S * i;
+                real const* z = Z + S * i;
+                for ( FieldGrid::index_t j = 0; j < S; ++j )
+                    x[j] -= C[j] * z[j];
+            }
+        }
     }
-    
-    free_real(a);
-    free_real(b);
 }
 
 
-void Field::laplacian(const real* field, real * mat) const
+/// index of the cell before `i` in a line of `n` cells
+static inline unsigned lower_cell(unsigned i, unsigned n, bool periodic)
 {
-    const FieldGrid::index_t nbc = mGrid.nbCells();
-    const real sc = 2 * DIM;
+    return ( i > 0 ) ? i - 1 : ( periodic ? n - 1 : 0 );
+}
 
-    for ( FieldGrid::index_t c = 0; c < nbc; ++c )
-        mat[c] = sc * field[c];
-    
-    const FieldGrid::index_t nx = mGrid.breadth(0);
-#if ( 1 )
-    // derivative in the X-direction:
-    const FieldGrid::index_t nyz = nbc / nx;
-    for ( FieldGrid::index_t xx = 1; xx < nx; ++xx )
-    {
-        blas::xaxpy(nyz, -1, field+xx-1, nx, mat+xx  , nx);
-        blas::xaxpy(nyz, -1, field+xx  , nx, mat+xx-1, nx);
-    }
-    // index of last valid X index:
-    int xx = mGrid.breadth(0) - 1;
-    
-    if ( prop->periodic )
-    {
-        blas::xaxpy(nyz, -1, field+xx, nx, mat   , nx);
-        blas::xaxpy(nyz, -1, field   , nx, mat+xx, nx);
-    }
-    else
-    {
-        blas::xaxpy(nyz, -1, field   , nx, mat   , nx);
-        blas::xaxpy(nyz, -1, field+xx, nx, mat+xx, nx);
-    }
-#endif
-    
-#if ( DIM == 2 )
-    // derivative in the Y-direction:
-    blas::xaxpy(nbc-nx, -1, field,    1, mat+nx, 1);
-    blas::xaxpy(nbc-nx, -1, field+nx, 1, mat,    1);
-    
-    FieldGrid::index_t yy = mGrid.breadth(1) - 1;
-    if ( prop->periodic )
-    {
-        blas::xaxpy(nx, -1, field+nx*yy, 1, mat      , 1);
-        blas::xaxpy(nx, -1, field      , 1, mat+nx*yy, 1);
-    }
-    else
-    {
-        blas::xaxpy(nx, -1, field      , 1, mat      , 1);
-        blas::xaxpy(nx, -1, field+nx*yy, 1, mat+nx*yy, 1);
-    }
-#endif
+/// index of the cell after `i` in a line of `n` cells
+static inline unsigned upper_cell(unsigned i, unsigned n, bool periodic)
+{
+    return ( i + 1 < n ) ? i + 1 : ( periodic ? 0 : n - 1 );
+}
 
-#if ( DIM == 3 )
-    // derivative in the Y-direction:
-    const FieldGrid::index_t ss = mGrid.stride(2);
-    for ( FieldGrid::index_t yy = 1; yy < mGrid.breadth(1); ++yy )
-    for ( FieldGrid::index_t zz = 0; zz < mGrid.breadth(2); ++zz )
+
+/// out <- A * f + B * ( sum of the neighbors of f ), for a row of `nx` cells along X
+template < int ORD >
+static void stencil_row(real * out, real const* f, real const* yl, real const* yu,
+                        real const* zl, real const* zu, unsigned nx, bool periodic, real A, real B)
+{
+    #pragma ivdep
+    #pragma vector always
+    for ( unsigned x = 1; x+1 < nx; ++x )
     {
-        blas::xaxpy(nx, -1, field+nx*(yy-1)+ss*zz, 1, mat+nx*(yy  )+ss*zz, 1);
-        blas::xaxpy(nx, -1, field+nx*(yy  )+ss*zz, 1, mat+nx*(yy-1)+ss*zz, 1);
+        real s = f[x-1] + f[x+1];
+        if ( ORD > 1 ) s += yl[x] + yu[x];
+        if ( ORD > 2 ) s += zl[x] + zu[x];
+        out[x] = A * f[x] + B * s;
     }
-    int yy = mGrid.breadth(1) - 1;
-    
-    if ( prop->periodic )
+    // the first and last cells, which may be the same:
+    for ( unsigned x : { 0U, nx-1 } )
     {
-        for ( FieldGrid::index_t zz = 0; zz < mGrid.breadth(2); ++zz )
-        {
-            blas::xaxpy(nx, -1, field+nx*yy+ss*zz, 1, mat      +ss*zz, 1);
-            blas::xaxpy(nx, -1, field      +ss*zz, 1, mat+nx*yy+ss*zz, 1);
-        }
+        real s = f[lower_cell(x, nx, periodic)] + f[upper_cell(x, nx, periodic)];
+        if ( ORD > 1 ) s += yl[x] + yu[x];
+        if ( ORD > 2 ) s += zl[x] + zu[x];
+        out[x] = A * f[x] + B * s;
     }
-    else
+}
+
+
+/**
+ Calculate `out = decay * ( in - c * laplacian(in) )`, on a grid of size
+ `dim[0] * dim[1] * dim[2]`, where the neighbors outside the grid are periodic
+ images if `periodic`, or otherwise equal to the cell itself (zero flux).
+ The rows along X are processed by vectorizable loops. The rows are grouped in
+ tiles of STENCIL_TILE rows along Y, which are processed for all Z in turn,
+ such that the neighboring rows are still in cache when they are used again.
+ The tiles are independent, and distributed between `nbt` threads.
+ */
+template < int ORD >
+static void stencil_diffusion(real const* in, real * out, FieldGrid const& grid,
+                              bool periodic, real c, real decay, int nbt)
+{
+    constexpr unsigned STENCIL_TILE = 8;
+    const unsigned nx = grid.breadth(0);
+    const unsigned ny = ( ORD > 1 ) ? grid.breadth(1) : 1;
+    const unsigned nz = ( ORD > 2 ) ? grid.breadth(2) : 1;
+    const size_t nxy = (size_t)nx * ny;
+    const real A = decay * ( 1 - 2 * ORD * c );
+    const real B = decay * c;
+    const int nbTiles = ( ny + STENCIL_TILE - 1 ) / STENCIL_TILE;
+    
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(nbt) schedule(static) if ( nbt > 1 )
+#endif
+    for ( int t = 0; t < nbTiles; ++t )
     {
-        for ( FieldGrid::index_t zz = 0; zz < mGrid.breadth(2); ++zz )
+        const unsigned y0 = t * STENCIL_TILE;
+        const unsigned y1 = std::min(ny, y0 + STENCIL_TILE);
+        for ( unsigned z = 0; z < nz; ++z )
         {
-            blas::xaxpy(nx, -1, field      +ss*zz, 1, mat      +ss*zz, 1);
-            blas::xaxpy(nx, -1, field+nx*yy+ss*zz, 1, mat+nx*yy+ss*zz, 1);
+            real const* pl = in + nxy * lower_cell(z, nz, periodic);
+            real const* pu = in + nxy * upper_cell(z, nz, periodic);
+            for ( unsigned y = y0; y < y1; ++y )
+            {
+                const size_t r = nx * y;
+                real const* yl = in + nxy * z + nx * lower_cell(y, ny, periodic);
+                real const* yu = in + nxy * z + nx * upper_cell(y, ny, periodic);
+                stencil_row<ORD>(out+nxy*z+r, in+nxy*z+r, yl, yu, pl+r, pu+r, nx, periodic, A, B);
+            }
         }
     }
-#endif
+}
 
-#if ( DIM == 3 )
-    // derivative in the Z-direction:
-    const FieldGrid::index_t nxy = nbc / mGrid.breadth(2);
-    assert_true( nxy == ss );
-    blas::xaxpy(nbc-nxy, -1, field,     1, mat+nxy, 1);
-    blas::xaxpy(nbc-nxy, -1, field+nxy, 1, mat,     1);
-    FieldGrid::index_t zz = mGrid.breadth(2) - 1;
-    
-    if ( prop->periodic )
-    {
-        blas::xaxpy(nxy, -1, field+ss*zz, 1, mat      , 1);
-        blas::xaxpy(nxy, -1, field      , 1, mat+ss*zz, 1);
-    }
-    else
-    {
-        blas::xaxpy(nxy, -1, field      , 1, mat      , 1);
-        blas::xaxpy(nxy, -1, field+ss*zz, 1, mat+ss*zz, 1);
-    }
-#endif
+
+/**
+ Apply `full_diffusion` to the entire grid, with zero-flux or periodic edges,
+ and the decay of the field: field <- decay * ( field - c * laplacian(field) )
+ The result is written to `fiNext`, which then replaces the cells of the grid,
+ such that the values are not copied.
+ */
+void Field::diffuseFull(real c, real decay)
+{
+    assert_true( fiNext );
+    real const* src = reinterpret_cast<real const*>(mGrid.data());
+    real * dst = reinterpret_cast<real*>(fiNext);
+    stencil_diffusion<DIM>(src, dst, mGrid, prop->periodic, c, decay, fiThreads);
+    mGrid.swapCells(fiNext);
 }
 
 
@@ -357,7 +580,7 @@ void Field::setEdgesZ(real * field, real val)
 
 
 /**
- //\todo implement Crank-Nicholson for diffusion
+ With `field:diffusion_scheme`, `diffusion` is calculated implicitly by diffuseLines()
  */
 void Field::step(FiberSet& fibers)
 {
@@ -368,40 +591,37 @@ void Field::step(FiberSet& fibers)
     real * field = reinterpret_cast<real*>(mGrid.data());
     const auto nbc = mGrid.nbCells();
     
-    real * dup = fiTMP;
 
-    // decay:
-    if ( prop->decay_rate > 0 )
-    {
-        // field = field * exp( - decay_rate * dt ):
-        blas::xscal(nbc, prop->decay_frac, field, 1);
-    }
-
-    // full grid diffusion:
+    // full grid diffusion, combined with the decay:
     if ( prop->full_diffusion > 0 )
     {
         real c = prop->full_diffusion * prop->time_step / ( prop->step * prop->step );
-
-#if ( DIM > 1 )
-        laplacian(field, dup);
-        blas::xaxpy(nbc, -c, dup, 1, field, 1);
-#else
-        diffuseX(field, c);
-#endif
+        diffuseFull(c, prop->decay_frac);
+        field = reinterpret_cast<real*>(mGrid.data());
+    }
+    else if ( prop->decay_rate > 0 )
+    {
+        // field = field * exp( - decay_rate * dt ):
+        blas::xscal(nbc, prop->decay_frac, field, 1);
     }
 
     // diffusion:
     if ( prop->diffusion > 0 )
     {
         assert_true( fiTMP );
-        assert_true( fiTMPSize == nbc );
-        assert_true( fiDiffusionMatrix.size() == nbc );
 
-        // dup = field:
-        blas::xcopy(nbc, field, 1, dup, 1);
-        
-        // field = field + fiDiffusionMatrix * dup:
-        fiDiffusionMatrix.vecMulAdd(dup, field);
+        if ( fiWeights )
+        {
+            // implicit diffusion, one direction after the other:
+            const real a = ( prop->diffusion_scheme == 2 ) ? 0.5 : 1.0;
+            for ( int d = 0; d < DIM; ++d )
+                diffuseLines(field, d, a, 1.0 - a);
+        }
+        else
+        {
+            real theta = prop->diffusion * prop->time_step / ( prop->step * prop->step );
+            diffuseCells(field, theta);
+        }
     }
 
     if ( prop->boundary_condition & 1 )
@@ -11,8 +11,7 @@
 #include "iowrapper.h"
 #include "messages.h"
 #include "exceptions.h"
-#include "matsparsesym1.h"
-#include "matsparsesym2.h"
+#include "array.h"
 #include "field_prop.h"
 #include "field_values.h"
 
@@ -67,8 +66,26 @@ private:
     /// allocated size of fiTMP
     unsigned fiTMPSize;
     
-    /// matrix for diffusion
-    MatrixSparseSymmetric1 fiDiffusionMatrix;
+    /// array of cells receiving the result of `full_diffusion`, exchanged with the grid
+    FieldScalar * fiNext;
+    
+    /// number of threads used to calculate `full_diffusion`
+    int      fiThreads;
+    
+    /// indices in the grid of the cells involved in diffusion
+    Array<FieldGrid::index_t> fiCells;
+    
+    /// for each cell of `fiCells`, the indices in `fiCells` of its 2*DIM neighbors
+    Array<FieldGrid::index_t> fiNeighbors;
+    
+    /// set `fiCells` and `fiNeighbors` from the pairs of linked cells
+    void setDiffusionTable(Array<FieldGrid::index_t> const&);
+    
+    /// coefficients of diffusion between cell `c` and the next cell in direction `d`, at `c+d*nbCells()`
+    real*    fiWeights;
+    
+    /// true if the diffusion in direction `d` wraps around the grid
+    bool     fiCyclic[3];
     
     /// initialize to cover the given Space with squares of size 'step'
     void setGrid(Vector inf, Vector sup, real step, bool tight)
@@ -124,12 +141,17 @@ public:
         prop      = p;
         fiTMP     = nullptr;
         fiTMPSize = 0;
+        fiNext    = nullptr;
+        fiWeights = nullptr;
+        fiThreads = 1;
     }
     
     /// destructor
     ~Field()
     {
         free_real(fiTMP);
+        free_real(fiWeights);
+        delete[] fiNext;
     }
     
     /// initialize with squares of size 'step'
@@ -175,7 +197,7 @@ public:
     value_type& cell(const real w[]) const { return mGrid.cell(w); }
     
     /// access to data
-    index_t nbCells() const { return mGrid.nbCells(); }
+    FieldGrid::index_t nbCells() const { return mGrid.nbCells(); }
 
     /// info
     void infoValues(value_type& s, value_type& n, value_type& x) const { return mGrid.infoValues(s, n, x); }
@@ -210,14 +232,17 @@ public:
     /// initialize Field
     void prepare();
 
+    /// set number of threads used in step(), given the value of `simul:threads`
+    void setThreads(int);
+
     /// simulation step
     void step(FiberSet&);
     
-    /// calculate second derivative of field
-    void laplacian(const real*, real*) const;
+    /// apply diffusion over the entire grid, and decay: field <- decay * ( field - c * laplacian(field) )
+    void diffuseFull(real c, real decay);
     
-    /// calculate second derivative of field
-    void diffuseX(real*, real);
+    /// implicit diffusion in direction `d`: field <- inverse( I - a * L ) * ( I + b * L ) * field
+    void diffuseLines(real*, int d, real a, real b);
     
     /// set values of field on its edges
     void setEdgesX(real*, real);
@@ -228,12 +253,18 @@ public:
     /// set values of field on its edges
     void setEdgesZ(real*, real);
     
-    /// initialize diffusion matrix (only for FieldScalar)
+    /// initialize diffusion over the entire grid (only for FieldScalar)
     void prepareDiffusion(real);
     
-    /// initialize diffusion matrix (only for FieldScalar)
+    /// initialize diffusion within the domains (only for FieldScalar)
     void prepareDiffusion(real, unsigned char *);
     
+    /// explicit diffusion of the cells in `fiCells`
+    void diffuseCells(real*, real theta);
+    
+    /// memory used by the grid and the diffusion tables, in bytes
+    size_t memory() const;
+    
     //------------------------------- object -----------------------------------
 #pragma mark -
     
@@ -40,6 +40,22 @@ public:
     /// diffusion constant
     real          full_diffusion;
     
+    /// method used to calculate `diffusion`
+    /**
+     can be:
+     - `explicit`       (default) forward Euler, limited by the stability condition
+     - `implicit`       backward Euler, solved direction by direction
+     - `crank_nicolson` Crank-Nicolson, solved direction by direction
+     .
+     With `implicit` or `crank_nicolson`, the diffusion along each direction
+     of the grid is solved with tridiagonal systems (alternating direction),
+     which is stable for any value of ( diffusion * time_step / step^2 ).
+     The backward Euler scheme also keeps all values positive, while
+     Crank-Nicolson is more accurate, but may oscillate if diffusion is fast.
+     The stability condition still applies to `full_diffusion`.
+     */
+    int           diffusion_scheme;
+    
     /// type of boundary condition
     /*
      can be:
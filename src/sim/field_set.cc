@@ -5,6 +5,7 @@
 #include "iowrapper.h"
 #include "glossary.h"
 #include "simul.h"
+#include "simul_prop.h"
 #include "field.h"
 
 
@@ -45,11 +46,44 @@ void FieldSet::step()
         if ( f->hasField() )
         {
             LOG_ONCE("!!!! Field is active\n");
+            f->setThreads(simul.prop->threads);
             f->step(simul.fibers);
         }
     }
 }
 
+/**
+ The diffusion of the Fields does not depend on the other objects, and if there
+ are many cells, it is done by another thread while the other objects are stepped.
+ A Field should not be accessed until finishStep() is called.
+ */
+void FieldSet::startStep()
+{
+    size_t cnt = 0;
+    for ( Field * f=first(); f; f=f->next() )
+    {
+        if ( f->hasField() )
+        {
+            LOG_ONCE("!!!! Field is active\n");
+            f->setThreads(simul.prop->threads);
+            cnt += f->nbCells();
+        }
+    }
+    if ( cnt > 4096 && !stepping_.valid() )
+    {
+        Field * head = first();
+        FiberSet * fibers = &simul.fibers;
+        stepping_ = std::async(std::launch::async, [head, fibers]()
+        {
+            for ( Field * f=head; f; f=f->next() )
+                if ( f->hasField() )
+                    f->step(*fibers);
+        });
+    }
+    else if ( cnt > 0 )
+        step();
+}
+
 //------------------------------------------------------------------------------
 #pragma mark -
 
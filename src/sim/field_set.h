@@ -4,6 +4,7 @@
 #define FIELD_SET_H
 
 #include "object_set.h"
+#include <future>
 
 class Simul;
 class Field;
@@ -15,6 +16,9 @@ class Field;
  */
 class FieldSet : public ObjectSet
 {
+    /// task calculating the step of the large Fields, started by startStep()
+    std::future<void> stepping_;
+
 public:
     
     /// creator
@@ -56,6 +60,12 @@ public:
     
     /// Monte-Carlo simulation step for every Object
     void        step();
+    
+    /// start step(), in the background if the Fields are large
+    void        startStep();
+    
+    /// wait for the step started by startStep() to complete
+    void        finishStep() { if ( stepping_.valid() ) stepping_.get(); }
 
 };
 
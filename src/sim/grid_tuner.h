@@ -0,0 +1,115 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef GRID_TUNER_H
+#define GRID_TUNER_H
+
+#include "real.h"
+#include <cmath>
+#include <initializer_list>
+
+
+/// Selects the cell size of a grid by measuring the CPU time of successive trials
+/**
+ The cell size is multiplied by the factors given to the constructor, each
+ during `period` steps, while the CPU time spent in the operations that depend
+ on the grid is accumulated. The factor that gave the shortest time is then
+ selected. The trials are started again if the density of objects, as given to
+ record(), has changed by more than 50% since the end of the last trials.
+
+ This is similar to the automatic selection of the preconditionner in Simul::solve_auto().
+ */
+class GridTuner
+{
+    /// maximum number of trials
+    static constexpr unsigned MAX = 8;
+
+    /// factors applied to the cell size
+    real     factor_[MAX];
+
+    /// CPU time of each trial
+    double   cpu_[MAX];
+
+    /// number of trials
+    unsigned nb_;
+
+    /// number of calls to record() since the start of the trials
+    unsigned counter_;
+
+    /// index of the factor currently in use
+    unsigned current_;
+
+    /// density of objects at the end of the trials
+    real     density_;
+
+public:
+
+    /// set the factors to be tried, starting with 1
+    GridTuner(std::initializer_list<real> facts)
+    : nb_(0), counter_(0), current_(0), density_(-1)
+    {
+        for ( real f : facts )
+            if ( nb_ < MAX )
+                factor_[nb_++] = f;
+        for ( unsigned i = 0; i < MAX; ++i )
+            cpu_[i] = 0;
+    }
+
+    /// factor currently applied to the cell size
+    real factor() const { return factor_[current_]; }
+
+    /// true if the trials are in progress
+    bool tuning() const { return density_ < 0; }
+
+    /// restart the trials
+    void restart()
+    {
+        counter_ = 0;
+        current_ = 0;
+        density_ = -1;
+        for ( unsigned i = 0; i < MAX; ++i )
+            cpu_[i] = 0;
+    }
+
+    /// record CPU time of one step, returning true if the factor has changed
+    bool record(double cpu, real density, unsigned period)
+    {
+        if ( !tuning() )
+        {
+            // restart the trials if the density has changed significantly:
+            if ( 2 * std::abs(density - density_) <= density_ )
+                return false;
+            unsigned old = current_;
+            restart();
+            return old != current_;
+        }
+        unsigned old = current_;
+        // the first step of a trial includes the cost of changing the grid:
+        if ( counter_ > 0 )
+            cpu_[current_] += cpu;
+        if ( ++counter_ >= period )
+        {
+            counter_ = 0;
+            if ( ++current_ >= nb_ )
+            {
+                // select the fastest trial:
+                current_ = 0;
+                for ( unsigned i = 1; i < nb_; ++i )
+                    if ( cpu_[i] < cpu_[current_] )
+                        current_ = i;
+                density_ = density;
+            }
+        }
+        return current_ != old;
+    }
+
+    /// CPU time of trial `i`
+    double cpu(unsigned i) const { return cpu_[i]; }
+
+    /// factor of trial `i`
+    real factor(unsigned i) const { return factor_[i]; }
+
+    /// number of trials
+    unsigned size() const { return nb_; }
+};
+
+#endif
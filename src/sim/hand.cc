@@ -7,9 +7,14 @@
 #include "iowrapper.h"
 #include "fiber_prop.h"
 #include "fiber_grid.h"
+#include "couple.h"
+#include "single.h"
 #include "simul.h"
 #include "sim.h"
 
+
+thread_local Slab Hand::slab("hand");
+
 //------------------------------------------------------------------------------
 
 Hand::Hand(HandProp const* p, HandMonitor* m)
@@ -100,6 +105,22 @@ void Hand::relocate(Fiber* f, const real a)
 }
 
 
+/**
+ The lists of Hands of the Fibers are not updated, as this is done by the caller
+ */
+void Hand::transfer(Fiber* f, const real a)
+{
+    assert_true(f);
+    fbFiber = f;
+#if FIBER_HAS_LATTICE
+    if ( fbLattice )
+        fbLattice = &f->lattice();
+#endif
+    fbAbs = a;
+    reinterpolate();
+}
+
+
 void Hand::moveToEnd(const FiberEnd end)
 {
     assert_true(fbFiber);
@@ -207,8 +228,22 @@ void Hand::locate(Fiber* f, real a)
     fbFiber = f;
     f->addHand(this);
     reinterpolate();
-    haMonitor->afterAttachment(this);
+    // call Couple or Single directly, if possible:
+    switch ( haMonitor->monitorKind() )
+    {
+        case HandMonitor::MONITOR_COUPLE:
+            static_cast<Couple*>(haMonitor)->Couple::afterAttachment(this);
+            break;
+        case HandMonitor::MONITOR_SINGLE:
+            static_cast<Single*>(haMonitor)->Single::afterAttachment(this);
+            break;
+        default:
+            haMonitor->afterAttachment(this);
+    }
     nextDetach = RNG.exponential();
+#if HAND_COUNTS_EVENTS
+    ++prop->events.attach;
+#endif
 }
 
 
@@ -228,7 +263,20 @@ void Hand::attach(FiberSite const& s)
 void Hand::detach()
 {
     assert_true( attached() );
-    haMonitor->beforeDetachment(this);
+#if HAND_COUNTS_EVENTS
+    ++prop->events.detach;
+#endif
+    switch ( haMonitor->monitorKind() )
+    {
+        case HandMonitor::MONITOR_COUPLE:
+            static_cast<Couple*>(haMonitor)->Couple::beforeDetachment(this);
+            break;
+        case HandMonitor::MONITOR_SINGLE:
+            static_cast<Single*>(haMonitor)->Single::beforeDetachment(this);
+            break;
+        default:
+            haMonitor->beforeDetachment(this);
+    }
     fbFiber->removeHand(this);
     fbFiber = nullptr;
 #if FIBER_HAS_LATTICE
@@ -267,7 +315,12 @@ void Hand::handleDisassemblyM()
     if ( RNG.test(prop->hold_shrinking_end) )
         relocateM();
     else
+    {
+#if HAND_COUNTS_EVENTS
+        ++prop->events.end_detach;
+#endif
         detach();
+    }
 }
 
 void Hand::handleDisassemblyP()
@@ -275,7 +328,12 @@ void Hand::handleDisassemblyP()
     if ( RNG.test(prop->hold_shrinking_end) )
         relocateP();
     else
+    {
+#if HAND_COUNTS_EVENTS
+        ++prop->events.end_detach;
+#endif
         detach();
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -288,7 +346,7 @@ void Hand::stepUnattached(Simul& sim, Vector const& pos)
 {
     assert_true( unattached() );
 
-    sim.fiberGrid.tryToAttach(pos, *this);
+    sim.fiberGrid.queueAttach(pos, *this);
 }
 
 
@@ -329,9 +387,23 @@ void Hand::write(Outputter& out) const
      since it is set when the Hand is created in class Single or Couple.
      */
     FiberSite::write(out);
+    // a checkpoint also records the Gillespie counter:
+    if ( out.precise() )
+    {
+        out.writeDouble(nextDetach);
+        writeCounters(out);
+    }
 }
 
 
+thread_local std::vector<Hand::Staged> * Hand::staging = nullptr;
+
+
+/**
+ The lists of Hands belong to the fibers, which are shared by Singles and Couples.
+ When these classes are read in parallel, the lists are updated later by unstage(),
+ which also draws the random numbers in the order in which the Hands were read.
+ */
 void Hand::read(Inputter& in, Simul& sim)
 {
 #ifdef BACKWARD_COMPATIBILITY
@@ -341,7 +413,19 @@ void Hand::read(Inputter& in, Simul& sim)
     
     Fiber * fib = fbFiber;
     FiberSite::read(in, sim);
-    resetTimers();
+    if ( in.precise() )
+    {
+        nextDetach = in.readDouble();
+        readCounters(in);
+    }
+    else if ( !staging )
+        resetTimers();
+    
+    if ( staging )
+    {
+        staging->push_back(Staged(this, fib));
+        return;
+    }
     
     // update fiber's lists:
     if ( fib != fbFiber )
@@ -353,6 +437,24 @@ void Hand::read(Inputter& in, Simul& sim)
     }
 }
 
+
+void Hand::unstage(std::vector<Staged> const& list, bool reset)
+{
+    for ( Staged const& s : list )
+    {
+        Hand * h = s.first;
+        if ( reset )
+            h->resetTimers();
+        if ( s.second != h->fbFiber )
+        {
+            if ( s.second )
+                s.second->removeHand(h);
+            if ( h->fbFiber )
+                h->fbFiber->addHand(h);
+        }
+    }
+}
+
 std::ostream& operator << (std::ostream& os, Hand const& obj)
 {
     os << "hand(" << obj.fiber()->reference() << ", " << obj.abscissa() << ")";
@@ -5,6 +5,8 @@
 
 #include "fiber_site.h"
 #include "hand_prop.h"
+#include "slab.h"
+#include <vector>
 
 class HandMonitor;
 class FiberGrid;
@@ -63,6 +65,26 @@ public:
     
     /// Property is constant, so we do not need to make it private
     HandProp const* prop;
+    
+    /// number of calls to testDetachment() that are needed to detach the Hand
+    real            detachmentSteps() const { return nextDetach / prop->unbinding_rate_dt; }
+    
+    /// set the Gillespie counter, such that the Hand detaches after `n` calls to testDetachment()
+    void            detachmentSteps(real n) { nextDetach = n * prop->unbinding_rate_dt; }
+    
+    /// advance the Gillespie counter as the basic stepLoaded(), returning true if the Hand should detach
+    /**
+     This does not detach the Hand and only modifies the Hand itself,
+     such that it can be called in parallel for different Hands.
+     */
+    bool            countdownLoaded(real force_norm)
+    {
+        if ( prop->unbinding_force_inv > 0 )
+            nextDetach -= prop->unbindingRateDt(force_norm);
+        else
+            nextDetach -= prop->unbinding_rate_dt;
+        return ( nextDetach <= 0 );
+    }
 
     /// Property
     HandProp const* property() const { return prop; }
@@ -81,6 +103,15 @@ public:
 
     /// destructor
     virtual ~Hand();
+    
+    /// memory of the Hands, which are allocated and deleted frequently
+    static thread_local Slab slab;
+    
+    /// allocate from `slab`
+    static void* operator new(size_t s) { return slab.allocate(s); }
+    
+    /// return memory to `slab`
+    static void operator delete(void* p, size_t s) { slab.release(p, s); }
 
 
     /// return next Hand in Fiber's list
@@ -101,6 +132,9 @@ public:
     
     /// move to a different fiber, at the given abscissa
     void           relocate(Fiber* f, real a);
+    
+    /// move to a different fiber, at the given abscissa, without updating the lists of Hands
+    void           transfer(Fiber* f, real a);
 
     /// relocate to the specified tip of the current fiber
     void           moveToEnd(FiberEnd);
@@ -164,12 +198,26 @@ public:
     real           linkStiffness() const;
 
     
+    /// a Hand that was read while staging, with the Fiber to which it was bound before
+    typedef std::pair<Hand*, Fiber*> Staged;
+    
+    /// if not null, read() records the Hands here, instead of updating the lists of the fibers
+    static thread_local std::vector<Staged> * staging;
+    
+    /// update the lists of the fibers for the Hands recorded by read(), and reset their counters if `reset`
+    static void    unstage(std::vector<Staged> const&, bool reset);
+
     /// read from file
     void           read(Inputter&, Simul&);
     
     /// write to file
     void           write(Outputter&) const;
     
+    /// write the counters of the derived class, which are only recorded in a checkpoint
+    virtual void   writeCounters(Outputter&) const {}
+    
+    /// read the values written by writeCounters()
+    virtual void   readCounters(Inputter&) {}
     
 protected:
     
@@ -206,9 +254,9 @@ protected:
         /*
          Attention: the exponential term can easily become numerically "infinite",
          which is problematic if 'unbinding_rate==0' and 'unbinding_force' is finite.
-         This issue is handled in HandProp::complete()
+         This issue is handled in HandProp::complete(), where the term may be tabulated
          */
-        nextDetach -= prop->unbinding_rate_dt * exp(force*prop->unbinding_force_inv);
+        nextDetach -= prop->unbindingRateDt(force);
         if ( nextDetach <= 0 )
         {
             detach();
@@ -27,6 +27,30 @@ class HandMonitor
 
 public:
     
+    /// values of monitorKind()
+    enum MonitorKind { MONITOR_ANY = 0, MONITOR_COUPLE = 1, MONITOR_SINGLE = 2 };
+    
+private:
+    
+    /// indicates the class implementing afterAttachment() and beforeDetachment()
+    /**
+     If this is not MONITOR_ANY, the Hand calls the implementations of Couple or
+     Single directly, without virtual call. A class deriving from Couple or Single
+     that redefines one of these functions must reset the kind to MONITOR_ANY.
+     */
+    MonitorKind monitorKind_;
+    
+public:
+    
+    /// constructor
+    HandMonitor() : monitorKind_(MONITOR_ANY) {}
+    
+    /// class implementing afterAttachment() and beforeDetachment()
+    MonitorKind  monitorKind() const { return monitorKind_; }
+    
+    /// set class implementing afterAttachment() and beforeDetachment()
+    void         monitorKind(MonitorKind k) { monitorKind_ = k; }
+    
     /// Returning `false` prevents the attachment (this is called before every attempt)
     virtual bool allowAttachment(FiberSite const&) { return true; }
     
@@ -154,6 +154,9 @@ void HandProp::clear()
     unbinding_rate     = 0;
     unbinding_force    = INFINITY;
     unbinding_force_inv = 0;
+    unbinding_error    = 0;
+    kramers_scale      = 0;
+    kramers_sup        = 0;
 
     bind_also_end      = 0;
     bind_only_end      = NO_END;
@@ -178,6 +181,7 @@ void HandProp::read(Glossary& glos)
     
     glos.set(unbinding_rate,  "unbinding_rate")  || glos.set(unbinding_rate,  "unbinding", 0);
     glos.set(unbinding_force, "unbinding_force") || glos.set(unbinding_force, "unbinding", 1);
+    glos.set(unbinding_error, "unbinding_error");
     
     
     glos.set(bind_also_end, "bind_also_end", {{"off",       NO_END},
@@ -277,6 +281,27 @@ void HandProp::complete(Simul const& sim)
     if ( unbinding_rate == 0 )
         unbinding_force_inv = 0;
 
+    if ( unbinding_error < 0 )
+        throw InvalidParameter(name()+":unbinding_error must be >= 0");
+
+    kramers_table.clear();
+    kramers_scale = 0;
+    kramers_sup = 0;
+    if ( unbinding_error > 0 && unbinding_force_inv > 0 )
+    {
+        // the relative error of the linear interpolation of exp() with step h is below h^2/8
+        real h = std::sqrt( 8 * unbinding_error );
+        size_t cnt = (size_t)std::ceil( KRAMERS_RANGE / h );
+        // limit the size of the table:
+        cnt = std::min(cnt, size_t(1<<16));
+        h = KRAMERS_RANGE / cnt;
+        kramers_table.resize(cnt+1);
+        for ( size_t i = 0; i <= cnt; ++i )
+            kramers_table[i] = unbinding_rate_dt * std::exp( i * h );
+        kramers_scale = unbinding_force_inv / h;
+        kramers_sup = cnt;
+    }
+
     //std::clog << name() << " unbinding_force_inv = " << unbinding_force_inv << std::endl;
 }
 
@@ -315,6 +340,8 @@ void HandProp::write_values(std::ostream& os) const
     write_value(os, "binding",            binding_rate, binding_range);
     write_value(os, "binding_key",        binding_key);
     write_value(os, "unbinding",          unbinding_rate, unbinding_force);
+    if ( unbinding_error > 0 )
+        write_value(os, "unbinding_error", unbinding_error);
     
     write_value(os, "bind_also_end",      bind_also_end);
     write_value(os, "hold_growing_end",   hold_growing_end);
@@ -6,11 +6,16 @@
 #include "real.h"
 #include "common.h"
 #include "property.h"
+#include <cmath>
+#include <vector>
 
 
 /// enables "bind_only_free_end" to limit binding of Hands to Fibers
 #define NEW_BIND_ONLY_FREE_END 0
 
+/// enables the counters of attachment/detachment events, reported by `report hand:event`
+#define HAND_COUNTS_EVENTS 1
+
 class Hand;
 class HandMonitor;
 class PointDisp;
@@ -112,6 +117,20 @@ public:
     real         unbinding_force;
     
     
+    /// maximum relative error of the tabulated force-dependent unbinding rate
+    /**
+     If `unbinding_error > 0`, the term `exp( FORCE / unbinding_force )` is not
+     calculated directly, but interpolated linearly from values tabulated
+     in HandProp::complete(), which is faster than calling `exp()`.
+     The step of the table is set such that the relative error remains below
+     `unbinding_error`, and the exact expression is used beyond the table,
+     for FORCE greater than `KRAMERS_RANGE * unbinding_force`.
+     
+     <em>default value = 0</em> (the exact expression is always used)
+     */
+    real         unbinding_error;
+    
+    
     /// if true, the Hand can also bind directly to the tip of fibers
     /**
      The value of `bind_also_end` affects Hands that are located at a position
@@ -202,16 +221,71 @@ public:
     /// derived variable = unbinding_rate * time_step;
     real   unbinding_rate_dt;
     
+    /// range of `FORCE / unbinding_force` covered by the table of unbinding rates
+    static constexpr real KRAMERS_RANGE = 20;
+    
+    /// derived variable: unbinding_rate_dt * exp(x) tabulated at regular values of x
+    std::vector<real> kramers_table;
+    
+    /// derived variable: 1 / ( unbinding_force * step of `kramers_table` )
+    real   kramers_scale;
+    
+    /// derived variable: largest value of `force * kramers_scale` covered by the table
+    real   kramers_sup;
+    
+    /// probability of detachment in one time step, under force `force >= 0`
+    /**
+     This is `unbinding_rate_dt * exp( force / unbinding_force )`,
+     possibly interpolated from `kramers_table` (see `unbinding_error`)
+     */
+    real   unbindingRateDt(real force) const
+    {
+        real x = force * kramers_scale;
+        if ( 0 <= x && x < kramers_sup )
+        {
+            size_t i = (size_t)x;
+            return kramers_table[i] + ( x - i ) * ( kramers_table[i+1] - kramers_table[i] );
+        }
+        return unbinding_rate_dt * std::exp(force*unbinding_force_inv);
+    }
+    
     /// flag to indicate that `display` has a new value
     bool   display_fresh;
     
+    /// number of events that occured to the Hands with this property
+    /**
+     The counters are incremented by the Hands, only in the sequential parts of
+     the simulation, and they do not need to be atomic.
+     They are reset by `report hand:event`.
+     */
+    struct Events
+    {
+        /// attachment to a fiber
+        size_t attach;
+        /// detachment, for any reason
+        size_t detach;
+        /// detachment caused by the disassembly of the fiber end
+        size_t end_detach;
+        /// movement along the fiber
+        size_t step;
+
+        Events() { reset(); }
+        void reset() { attach = 0; detach = 0; end_detach = 0; step = 0; }
+    };
+    
+    /// counters of events since `events_time`
+    mutable Events events;
+    
+    /// time at which the counters were last reset
+    mutable real   events_time;
+    
 public:
 
     /// the display parameters for this category of Hand
     PointDisp * disp;
     
     /// constructor
-    HandProp(const std::string& n) : Property(n), disp(nullptr) { clear(); }
+    HandProp(const std::string& n) : Property(n), events_time(0), disp(nullptr) { clear(); }
     
     /// destructor
     ~HandProp() { }
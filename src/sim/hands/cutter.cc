@@ -69,3 +69,14 @@ void Cutter::stepLoaded(Vector const& force, real force_norm)
     }
 }
 
+
+void Cutter::writeCounters(Outputter& out) const
+{
+    out.writeDouble(gspTime);
+}
+
+
+void Cutter::readCounters(Inputter& in)
+{
+    gspTime = in.readDouble();
+}
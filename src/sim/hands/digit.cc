@@ -70,6 +70,9 @@ void Digit::detach()
 void Digit::hop(lati_t s)
 {
     assert_true( attached() );
+#if HAND_COUNTS_EVENTS
+    ++prop->events.step;
+#endif
 #if FIBER_HAS_LATTICE
     dec();
     fbSite = s;
@@ -142,7 +145,12 @@ void Digit::handleDisassemblyM()
             detach();
     }
     else
+    {
+#if HAND_COUNTS_EVENTS
+        ++prop->events.end_detach;
+#endif
         detach();
+    }
 }
 
 
@@ -160,7 +168,12 @@ void Digit::handleDisassemblyP()
             detach();
     }
     else
+    {
+#if HAND_COUNTS_EVENTS
+        ++prop->events.end_detach;
+#endif
         detach();
+    }
 }
 
 
@@ -83,3 +83,14 @@ void Dynein::stepLoaded(Vector const& force, real force_norm)
     testKramersDetachment(force_norm);
 }
 
+
+void Dynein::writeCounters(Outputter& out) const
+{
+    out.writeDouble(nextStep);
+}
+
+
+void Dynein::readCounters(Inputter& in)
+{
+    nextStep = in.readDouble();
+}
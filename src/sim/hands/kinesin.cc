@@ -83,3 +83,14 @@ void Kinesin::stepLoaded(Vector const& force, real force_norm)
     testKramersDetachment(force_norm);
 }
 
+
+void Kinesin::writeCounters(Outputter& out) const
+{
+    out.writeDouble(nextStep);
+}
+
+
+void Kinesin::readCounters(Inputter& in)
+{
+    nextStep = in.readDouble();
+}
@@ -40,11 +40,26 @@ void Motor::stepUnloaded()
     }
 
     if ( !testDetachment() )
+    {
+#if HAND_COUNTS_EVENTS
+        ++prop->events.step;
+#endif
         moveTo(a);
+    }
 }
 
 
 void Motor::stepLoaded(Vector const& force, real force_norm)
+{
+    finishLoaded(advanceLoaded(force, force_norm));
+}
+
+
+/**
+ This only modifies the Motor, and can be called in parallel for different Motors.
+ The detachment counter is advanced here, but detachment is tested by finishLoaded().
+ */
+real Motor::advanceLoaded(Vector const& force, real force_norm)
 {
     assert_true( attached() );
     
@@ -61,8 +76,18 @@ void Motor::stepLoaded(Vector const& force, real force_norm)
         dab = std::min(dab, prop->max_dab);
     }
     
-    real a = fbAbs + dab;
+    // as in Hand::testKramersDetachment():
+    nextDetach -= prop->unbindingRateDt(force_norm);
     
+    return fbAbs + dab;
+}
+
+
+/**
+ This may use random numbers, if the Motor has reached the end of the Fiber.
+ */
+void Motor::finishLoaded(real a)
+{
     if ( a < fbFiber->abscissaM() )
     {
         if ( RNG.test_not(prop->hold_growing_end) )
@@ -83,10 +108,16 @@ void Motor::stepLoaded(Vector const& force, real force_norm)
         a = fbFiber->abscissaP();
     }
     
-    if ( testKramersDetachment(force_norm) )
+    if ( nextDetach <= 0 )
+    {
+        detach();
         return;
+    }
 
-    //std::cerr << this << " > " << fbAbs << "  " << dab << "\n";
+#if HAND_COUNTS_EVENTS
+    ++prop->events.step;
+#endif
+    //std::cerr << this << " > " << fbAbs << "\n";
     moveTo(a);
 }
 
@@ -54,6 +54,12 @@ public:
     /// simulate when `this` is attached and under load
     void   stepLoaded(Vector const& force, real force_norm);
     
+    /// first part of stepLoaded(): advance detachment counter and return the new abscissa
+    real   advanceLoaded(Vector const& force, real force_norm);
+    
+    /// second part of stepLoaded(): move to abscissa `a` given by advanceLoaded(), or detach
+    void   finishLoaded(real a);
+    
 };
 
 #endif
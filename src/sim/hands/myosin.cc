@@ -87,3 +87,14 @@ void Myosin::stepLoaded(Vector const& force, real force_norm)
         testDetachment();
 }
 
+
+void Myosin::writeCounters(Outputter& out) const
+{
+    out.writeDouble(nextStep);
+}
+
+
+void Myosin::readCounters(Inputter& in)
+{
+    nextStep = in.readDouble();
+}
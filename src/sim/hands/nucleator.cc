@@ -121,7 +121,7 @@ void Nucleator::stepUnattached(Simul& sim, Vector const& pos)
     {
         gspTime = RNG.exponential();
         try {
-            Glossary opt(prop->fiber_spec);
+            Glossary opt(prop->fiber_glos);
             makeFiber(sim, pos, prop->fiber_type, opt);
         }
         catch( Exception & e )
@@ -183,3 +183,14 @@ void Nucleator::detach()
     Hand::detach();
 }
 
+
+void Nucleator::writeCounters(Outputter& out) const
+{
+    out.writeDouble(gspTime);
+}
+
+
+void Nucleator::readCounters(Inputter& in)
+{
+    gspTime = in.readDouble();
+}
@@ -63,6 +63,12 @@ public:
     /// detach from Fiber
     void   detach();
 
+    /// write the Gillespie counter, in a checkpoint
+    void   writeCounters(Outputter&) const;
+    
+    /// read the Gillespie counter
+    void   readCounters(Inputter&);
+    
 };
 
 #endif
@@ -98,6 +98,7 @@ void NucleatorProp::complete(Simul const& sim)
         throw InvalidParameter("if set, hand:track_end should be equal to hold_end");
         
     rate_dt = rate * sim.time_step();
+    fiber_glos = Glossary(fiber_spec);
 }
 
 
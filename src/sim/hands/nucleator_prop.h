@@ -5,6 +5,7 @@
 
 #include "hand_prop.h"
 #include "common.h"
+#include "glossary.h"
 
 class FiberProp;
 class FiberSet;
@@ -103,6 +104,9 @@ private:
     
     real         rate_dt;
     
+    /// `fiber_spec` parsed once, and copied for each nucleation
+    Glossary     fiber_glos;
+    
     
 public:
     
@@ -1,6 +1,7 @@
 // Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
 #include "digit.h"
 #include "walker.h"
+#include "iowrapper.h"
 #include "walker_prop.h"
 #include "glossary.h"
 #include "lattice.h"
@@ -10,6 +11,8 @@
 Walker::Walker(WalkerProp const* p, HandMonitor* h)
 : Digit(p,h), nextStep(0), prop(p)
 {
+    // set here, since attach() is not called for a Walker read from file:
+    stride = std::copysign(1, prop->unloaded_speed);
 }
 
 
@@ -116,3 +119,14 @@ void Walker::stepLoaded(Vector const& force, real force_norm)
         testDetachment();
 }
 
+
+void Walker::writeCounters(Outputter& out) const
+{
+    out.writeDouble(nextStep);
+}
+
+
+void Walker::readCounters(Inputter& in)
+{
+    nextStep = in.readDouble();
+}
@@ -68,6 +68,12 @@ public:
     
     /// simulate when `this` is attached and under load
     void         stepLoaded(Vector const& force, real force_norm);
+
+    /// write the Gillespie counter, in a checkpoint
+    void   writeCounters(Outputter&) const;
+    
+    /// read the Gillespie counter
+    void   readCounters(Inputter&);
     
 };
 
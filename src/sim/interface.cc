@@ -13,7 +13,15 @@
 #include "simul.h"
 #include "event.h"
 #include "sim.h"
+#include "frame_index.h"
 #include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstring>
+#include <cerrno>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 
 // Use the second definition to get some verbose reports:
@@ -23,7 +31,7 @@
 //------------------------------------------------------------------------------
 
 Interface::Interface(Simul& s)
-: simul(s)
+: simul(s), runCount(0), resumeRun(0), resumeStep(0), resumeFrame(0), resumeSize(0), thumbnailPID(0)
 {
 }
 
@@ -64,8 +72,13 @@ Property* Interface::execute_set(std::string const& cat, std::string const& name
 
 void Interface::execute_change(Property * pp, Glossary& def)
 {
+    std::ostringstream old, now;
+    pp->write_values(old);
     pp->read(def);
-    pp->complete(simul);
+    pp->write_values(now);
+    // the derived values need to be updated only if the values were changed:
+    if ( old.str() != now.str() )
+        pp->complete(simul);
     
     /*
      Specific code to make 'change space:dimension' work.
@@ -149,6 +162,65 @@ void warn_trail(std::istream& is, std::string const& msg)
     throw InvalidSyntax("unexpected `"+str+"' in `"+StreamFunc::get_line(is, pos)+"'");
 }
 
+volatile std::sig_atomic_t Interface::canCheckpoint = 0;
+volatile std::sig_atomic_t Interface::signalReceived = 0;
+int Interface::commandChannel = -1;
+
+
+/**
+ The channel is a named pipe, which is created if it does not exist.
+ It is opened without blocking, such that reading it costs a single system call
+ if no command is waiting. Any process can then send commands to the simulation:
+ 
+     echo "change actin { rigidity = 0.1 }" > PATH
+ 
+ Returns 0 if successful.
+ */
+int Interface::open_channel(std::string const& path)
+{
+    if ( mkfifo(path.c_str(), 0600) && errno != EEXIST )
+        return 1;
+    // opening for writing as well, such that there is always a writer:
+    commandChannel = open(path.c_str(), O_RDWR|O_NONBLOCK);
+    return ( commandChannel < 0 );
+}
+
+
+/**
+ The commands are executed between steps, in the order in which they were
+ received. A line is executed only once it is complete, and errors are
+ printed without stopping the simulation.
+ */
+void Interface::read_channel()
+{
+    char buf[1024];
+    ssize_t n = read(commandChannel, buf, sizeof(buf));
+    if ( n <= 0 )
+        return;
+    do {
+        channelLine.append(buf, n);
+        n = read(commandChannel, buf, sizeof(buf));
+    } while ( n > 0 );
+    
+    std::string::size_type pos = channelLine.find('\n');
+    if ( pos == std::string::npos )
+        return;
+    simul.relax();
+    do {
+        std::string cmd = channelLine.substr(0, pos);
+        channelLine.erase(0, pos+1);
+        try {
+            execute_command(cmd);
+        }
+        catch( Exception & e ) {
+            std::cerr << e.brief() << ' ' << cmd << '\n';
+        }
+        pos = channelLine.find('\n');
+    } while ( pos != std::string::npos );
+    // the properties may have changed:
+    simul.prepare();
+}
+
 /**
  Define a placement = ( position, orientation ) from the parameters set in `opt'
  */
@@ -419,6 +491,9 @@ void Interface::execute_new(std::string const& name, unsigned cnt)
     Space const* spc = simul.spaces.master();
 
     Glossary opt;
+    
+    // the numbers of the new objects are allocated at once:
+    set->inventory.reserve(cnt);
 
     for ( unsigned n = 0; n < cnt; ++n )
     {
@@ -670,7 +745,7 @@ void Interface::execute_cut(std::string const& name, Glossary& opt)
 
 void reportCPUtime(int frame, real simtime)
 {
-    static int hour = -1;
+    thread_local static int hour = -1;
     int h = TicToc::hours_today();
     if ( hour != h )
     {
@@ -678,7 +753,7 @@ void reportCPUtime(int frame, real simtime)
         Cytosim::log << "% " << TicToc::date() << "\n";
     }
     
-    static double clk = 0;
+    thread_local static double clk = 0;
     double cpu = double(clock()) / CLOCKS_PER_SEC;
     Cytosim::log("F%-6i  %7.2fs   CPU %10.3fs  %10.0fs\n", frame, simtime, cpu-clk, cpu);
     clk = cpu;
@@ -720,9 +795,20 @@ void reportCPUtime(int frame, real simtime)
  `nb_steps`   |  1      | number of simulation steps
  `duration`   |  -      | when specified, `nb_steps` is set to `ceil(duration/time_step)`
  `solve`      |  `on`   | Define the type of method used for the mechanics
+ `solve_interval` | 1   | number of steps between two calls to the mechanics
  `event`      |  `none` | custom code executed stochastically with prescribed rate
  `nb_frames`  |  0      | number of states written to trajectory file
  `prune`      |  `true` | Print only parameters that are different from default
+ `binary`     |  `true` | Write the trajectory file in binary format
+ `report`     |  -      | report made at each frame, specified as `WHAT, FILE`
+ `write_objects` | `true` | if false, the objects are not written to the trajectory file
+ `adaptive`   |  1, 32  | maximum increase of time_step, and target number of iterations
+ `checkpoint` |  0, 0   | number of frames between checkpoints, and wall-clock seconds
+ `thumbnail`  |  0, `size=256` | number of frames between thumbnails, and options of `play`
+ `stop_check` |  100    | number of steps between tests of the stop conditions
+ `stop_fibers`|  -      | stop if the number of fibers is outside `MIN, MAX`
+ `stop_change`|  `false`| stop as soon as the number of fibers has changed
+ `stop_report`|  -      | stop when report `WHAT, EPSILON` has converged
  
  
  The parameter `solve` can be used to select alternative mechanical engines.
@@ -736,6 +822,23 @@ void reportCPUtime(int frame, real simtime)
  `auto`       | Same as 'on' but preconditionning method is set automatically.
  `horizontal` | The mechanics is solved only allowing motion in the X-direction. 
   
+ With `solve_interval = K`, the mechanics is solved once every K steps, for a
+ duration of `K * time_step`, while the Monte-Carlo part is done at every step.
+ Between two solves, the objects are immobile and the Hands see the forces of
+ their current positions. This is useful if the binding kinetics requires a time
+ step smaller than what is needed for the mechanics, but the user should check
+ that the results are unchanged by comparing with `solve_interval = 1`.
+ This cannot be combined with `adaptive`.
+ 
+ With `adaptive = FACTOR, ITERATIONS` and FACTOR > 1, the time step is adjusted
+ at every step between `time_step` and `FACTOR * time_step`. It is increased as long
+ as the solver converges in less than ITERATIONS / 2, and the binding and unbinding
+ probabilities of all Hands remain below `simul:acceptable_prob`. It is halved if the
+ solver needs more than ITERATIONS, and reset to `time_step` if the number of fibers
+ has changed, for instance after breaking or severing. The run covers the same duration
+ as `nb_steps * time_step`, and the frames are written at regular times, as they would
+ be with a fixed step. The original `time_step` is restored at the end of the run.
+ 
  If set, `event` defines an event occuring at a rate specified by the positive real `RATE`.
  The action is defined by CODE, a string enclosed with parenthesis containing cytosim commands.
  This code will be executed at stochastic times with the specified rate.
@@ -744,6 +847,75 @@ void reportCPUtime(int frame, real simtime)
 
      event = 10, ( new actin { position=(rectangle 1 6); length=0.1; } )
  
+ With `report = WHAT, FILE`, the report `WHAT` is made at the end of each frame
+ directly by the simulation, and appended to `FILE`, as done by the `report` command.
+ Multiple reports can be specified as `report1`, `report2`, etc.
+ The options of the reports (eg. `precision`) can be specified in the same block.
+ Together with `write_objects = 0`, this avoids writing the trajectory file:
+
+     run 1000 system
+     {
+        nb_frames = 100
+        report1 = fiber:length, length.txt
+        report2 = couple, couple.txt
+        write_objects = 0
+     }
+ 
+ With `thumbnail = N`, an image of the state is made every N frames, to monitor
+ the simulation without copying the trajectory. The state is written in the
+ directory `thumbnail`, where a separate process runs `play image` to create
+ `image0000.png`, with the options given as second value, for example:
+ 
+     run system
+     {
+        nb_steps = 100000
+        nb_frames = 1000
+        thumbnail = 10, ( size=128 )
+     }
+ 
+ The simulation only waits for the state to be written, and a thumbnail is skipped
+ if the previous one is not finished. The program `play` is searched first in the directory of `sim`.
+ 
+ With `checkpoint = N`, the complete state of the simulation is saved every N frames
+ in `checkpoint.cmo`, which replaces the previous checkpoint. This file includes all
+ values in double precision, the Gillespie counters of the Hands, and the state of the
+ random number generator, such that the simulation can be resumed after an interruption,
+ with `sim resume`, or `sim restart=checkpoint.cmo`. The configuration file is then executed again
+ to define the properties, but the `run` commands that were completed are skipped, as
+ well as all commands `report` and `export` preceding the interrupted run. The state is
+ restored from the checkpoint when this run is reached, and the trajectory file is
+ truncated to the size it had when the checkpoint was written. Checkpoints are not
+ written with an adaptive time step.
+
+     run 100000 system
+     {
+        nb_frames = 1000
+        checkpoint = 10
+     }
+ 
+ With `checkpoint = 0, 3600`, a checkpoint is saved every hour of computation,
+ independently of the frames. If `sim` receives SIGTERM or SIGINT during a run
+ that writes frames, a checkpoint is saved after the current step, and `sim`
+ stops. A checkpoint is only used if this is requested on the command line, and
+ a simulation started without `resume` ignores it. The checkpoint is deleted after
+ the simulation completed.
+ 
+ The run is terminated before `nb_steps` if one of the stop conditions is fulfilled,
+ when they are tested every `stop_check` steps. With `stop_change = 1`, it stops
+ at the first breaking or severing event, or if a fiber was created or deleted.
+ With `stop_report = WHAT, EPSILON`, the numbers of the report are compared with
+ those of the previous test, and the run stops if none has changed by more than
+ EPSILON, relative to its magnitude. The last state is written as a final frame,
+ and the reason of the termination is recorded in the messages:
+
+     run 1000000 system
+     {
+        nb_frames = 100
+        stop_check = 1000
+        stop_fibers = 0, 10
+        stop_report = fiber:tension, 0.01
+     }
+ 
  Calling `run` will not output the initial state, but this can be done with a separate command:
  
      export objects objects.cmo { append = 0 }
@@ -757,9 +929,15 @@ void reportCPUtime(int frame, real simtime)
 void Interface::execute_run(unsigned nb_steps, Glossary& opt, bool do_write)
 {
     size_t nb_frames = 0;
+    size_t checkpoint = 0;
     int    solve     = 1;
     bool   prune     = true;
-    bool   binary    = true;
+    FrameOutput output;
+    output.objects = true;
+    output.binary  = true;
+    output.options = &opt;
+    output.thumbnail = 0;
+    output.thumbnail_args = "size=256";
     
 #ifdef BACKWARD_COMPATIBILITY
     // check if 'event' is specified within the 'run' command,
@@ -785,61 +963,498 @@ void Interface::execute_run(unsigned nb_steps, Glossary& opt, bool do_write)
         case 3: solveFunc = &Simul::solveX;     break;
     }
 
+    unsigned interval = 1;
+    if ( opt.set(interval, "solve_interval") && interval < 1 )
+        throw InvalidParameter("run:solve_interval must be >= 1");
+
     opt.set(prune,     "prune");
-    opt.set(binary,    "binary");
+    opt.set(output.binary,  "binary");
+    opt.set(output.objects, "write_objects");
     opt.set(nb_frames, "nb_frames");
     
+    // in-situ reports, specified as 'report' or 'report1', 'report2', etc.
+    unsigned inp = 1;
+    std::string what, var = "report1";
+    if ( opt.has_key("report") )
+    {
+        var = "report";
+        inp = 0;
+    }
+    while ( opt.set(what, var) )
+    {
+        std::string file;
+        if ( !opt.set(file, var, 1) )
+            throw InvalidParameter("the file should be specified: `"+var+" = WHAT, FILE'");
+        output.reports.push_back(what);
+        output.reports.push_back(file);
+        var = "report" + std::to_string(++inp);
+    }
+    
+    real adaptive = 1;
+    unsigned iterations = 32;
+    opt.set(adaptive, "adaptive");
+    opt.set(iterations, "adaptive", 1);
+    opt.set(checkpoint, "checkpoint");
+    opt.set(output.thumbnail, "thumbnail");
+    opt.set(output.thumbnail_args, "thumbnail", 1);
+    size_t checkpoint_time = 0;
+    opt.set(checkpoint_time, "checkpoint", 1);
+    
+    StopCondition stop;
+    stop.interval   = 0;
+    stop.min_fibers = 0;
+    stop.max_fibers = ~0UL;
+    stop.nb_fibers  = simul.fibers.size();
+    stop.on_change  = false;
+    stop.epsilon    = 0;
+    bool has_stop = opt.set(stop.min_fibers, "stop_fibers");
+    opt.set(stop.max_fibers, "stop_fibers", 1);
+    has_stop |= opt.set(stop.on_change, "stop_change");
+    if ( opt.set(stop.report, "stop_report") )
+    {
+        if ( !opt.set(stop.epsilon, "stop_report", 1) || stop.epsilon <= 0 )
+            throw InvalidParameter("the threshold should be specified: `stop_report = WHAT, EPSILON'");
+        has_stop = true;
+    }
+    if ( has_stop )
+    {
+        stop.interval = 100;
+        opt.set(stop.interval, "stop_check");
+        if ( stop.interval < 1 )
+            throw InvalidParameter("run:stop_check must be >= 1");
+    }
+    bool halt = false;
+
     do_write &= ( nb_frames > 0 );
 
     size_t frame = 0;
+    size_t sss = 0;
     real   delta = real(nb_steps);
-    size_t check = nb_steps;
     
+    // skip the runs completed before the checkpoint:
+    if ( ++runCount < resumeRun )
+    {
+#ifdef BACKWARD_COMPATIBILITY
+        if ( event )
+            simul.events.erase(event);
+#endif
+        VLOG("+RUN SKIPPED " << runCount << '\n');
+        return;
+    }
+    
+    if ( runCount == resumeRun )
+    {
+        resume_run();
+        sss = resumeStep;
+        frame = resumeFrame;
+    }
+
     VLOG("+RUN START " << nb_steps << '\n');
 
     if ( do_write )
     {
         simul.writeProperties(nullptr, prune);
-        if ( simul.prop->clear_trajectory )
+        if ( simul.prop->clear_trajectory && output.objects )
         {
-            simul.writeObjects(TRAJECTORY, false, binary);
+            simul.writeObjects(TRAJECTORY, false, output.binary);
             simul.prop->clear_trajectory = false;
         }
         delta = real(nb_steps) / real(nb_frames);
-        check = size_t(delta);
     }
+    size_t check = size_t(delta*(frame+1));
     
     simul.prepare();
+    // expected time at the end of the run, reported in the status file:
+    simul.endTime = simul.time() + real(nb_steps - sss) * simul.time_step();
     
-    size_t sss = 0;
-    do {
-        while ( sss < check )
+    if ( adaptive > 1 )
+    {
+        if ( interval > 1 )
+            throw InvalidParameter("run:solve_interval cannot be combined with run:adaptive");
+        execute_run_adaptive(nb_steps, nb_frames, solveFunc, adaptive, iterations, do_write, output, stop);
+    }
+    else
+    {
+        time_t next_checkpoint = TicToc::seconds_since_1970() + checkpoint_time;
+        canCheckpoint = do_write;
+        do {
+            while ( sss < check )
+            {
+                hold();
+                if ( commandChannel >= 0 )
+                    read_channel();
+                //fprintf(stderr, "> step %6zu\n", sss);
+                if ( interval == 1 )
+                    (simul.*solveFunc)();
+                else if ( sss % interval == 0 )
+                    simul.solveSpan(solveFunc, std::min(size_t(interval), nb_steps-sss));
+                simul.step();
+                ++sss;
+                if ( stop.interval && sss % stop.interval == 0 && must_stop(stop) )
+                {
+                    halt = true;
+                    break;
+                }
+                if ( signalReceived )
+                {
+                    canCheckpoint = 0;
+                    write_checkpoint(sss, frame);
+                    throw Exception("stopped by signal "+std::to_string(signalReceived)+" at step "+std::to_string(sss)+", after saving `"+CHECKPOINT+"' (continue with `sim resume')");
+                }
+                if ( checkpoint_time > 0 && do_write && sss < check && TicToc::seconds_since_1970() >= next_checkpoint )
+                {
+                    write_checkpoint(sss, frame);
+                    next_checkpoint = TicToc::seconds_since_1970() + checkpoint_time;
+                }
+            }
+            ++frame;
+            // next check point:
+            check = size_t(delta*(frame+1));
+            
+            if ( do_write )
+            {
+                write_frame(frame, output);
+                if ( checkpoint > 0 && frame % checkpoint == 0 && sss < nb_steps && !halt )
+                    write_checkpoint(sss, frame);
+            }
+        } while ( sss < nb_steps && !halt );
+        canCheckpoint = 0;
+    }
+    
+#ifdef BACKWARD_COMPATIBILITY
+    if ( event )
+        simul.events.erase(event);
+#endif
+    wait_thumbnail();
+    simul.relax();
+    VLOG("+RUN END\n");
+}
+
+
+/**
+ Perform simulation steps with a variable time step, for the duration
+ corresponding to `nb_steps` steps of the original time step.
+ The frames are written at regular intervals of time.
+ */
+void Interface::execute_run_adaptive(unsigned nb_steps, size_t nb_frames,
+                                     void (Simul::* solveFunc)(),
+                                     real factor, unsigned iterations,
+                                     bool do_write, FrameOutput& output,
+                                     StopCondition& stop)
+{
+    const real dt_min = simul.time_step();
+    const real dt_max = factor * dt_min;
+    const real start = simul.time();
+    const real duration = nb_steps * dt_min;
+    // tolerance on time comparisons:
+    const real eps = 0.001 * dt_min;
+    
+    size_t cnt = 0;
+    size_t frame = 0;
+    size_t nb_chunks = std::max(nb_frames, size_t(1));
+    real dt = dt_min;
+    bool halt = false;
+    
+    while ( frame < nb_chunks && !halt )
+    {
+        const real check = start + duration * real(frame+1) / real(nb_chunks);
+        while ( simul.time() < check - eps )
         {
             hold();
-            //fprintf(stderr, "> step %6zu\n", sss);
+            if ( commandChannel >= 0 )
+                read_channel();
+            // do not step over the next check point:
+            simul.changeTimeStep(std::min(dt, check-simul.time()));
             (simul.*solveFunc)();
             simul.step();
-            ++sss;
+            dt = simul.adaptTimeStep(dt, dt_min, dt_max, iterations);
+            ++cnt;
+            if ( stop.interval && cnt % stop.interval == 0 && must_stop(stop) )
+            {
+                halt = true;
+                break;
+            }
         }
         ++frame;
-        // next check point:
-        check = size_t(delta*(frame+1));
-
+        
         if ( do_write )
+            write_frame(frame, output);
+    }
+    
+    simul.changeTimeStep(dt_min);
+    VLOG("+RUN ADAPTIVE " << cnt << " steps instead of " << nb_steps << "\n");
+}
+
+
+/// make a report obtained from Simul::compileReport(), as execute_report() does
+static void write_report(Simul const& simul, std::string const& file, Simul::CompiledReport const& rep,
+                         bool verbose, bool append)
+{
+    std::ostream * osp = &std::cout;
+    std::ofstream ofs;
+    
+    // a STAR designates the standard output:
+    if ( file != "*" )
+    {
+        ofs.open(file.c_str(), append ? std::ios_base::app : std::ios_base::out);
+        osp = &ofs;
+    }
+    
+    if ( verbose )
+        simul.report(*osp, rep);
+    else
+    {
+        std::stringstream ss;
+        simul.report(ss, rep);
+        StreamFunc::skip_lines(*osp, ss, '%');
+    }
+}
+
+
+/**
+ Write the objects to the trajectory file, and make the in-situ reports.
+ The reports are parsed at the first frame, and the options that they read
+ are thus evaluated only once, such that their usage counts do not grow with
+ the number of frames.
+ */
+void Interface::write_frame(size_t frame, FrameOutput& output)
+{
+    simul.relax();
+    if ( output.objects )
+        simul.writeObjects(TRAJECTORY, true, output.binary);
+    if ( output.makers.size() < output.reports.size() / 2 )
+    {
+        Glossary& opt = *output.options;
+        bool verbose = true, append = true;
+        opt.set(verbose, "verbose");
+        opt.set(append, "append");
+        for ( size_t i = 0; i+1 < output.reports.size(); i += 2 )
         {
-            simul.relax();
-            simul.writeObjects(TRAJECTORY, true, binary);
-            reportCPUtime(frame, simul.time());
-            simul.unrelax();
+            std::string const& file = output.reports[i+1];
+            Simul::CompiledReport rep = simul.compileReport(output.reports[i], opt);
+            output.makers.push_back([this, file, rep, verbose, append]()
+            {
+                if ( resumeRun == 0 )
+                    write_report(simul, file, rep, verbose, append);
+            });
         }
-    } while ( sss < nb_steps );
-    
-#ifdef BACKWARD_COMPATIBILITY
-    if ( event )
-        simul.events.erase(event);
-#endif
+    }
+    for ( std::function<void()> const& make : output.makers )
+        make();
+    if ( output.thumbnail > 0 && frame % output.thumbnail == 0 )
+        write_thumbnail(output.thumbnail_args);
+    reportCPUtime(frame, simul.time());
+    simul.unrelax();
+}
+
+
+/**
+ The state is written in directory `thumbnail`, and a child process is started
+ to execute `play` there, with the options `args`. This is skipped if the child
+ that made the previous thumbnail is still running.
+ 
+ Since the process may have other threads, the child only calls functions that
+ are safe after fork(), before executing `play`: the arguments are prepared by
+ the parent.
+ */
+void Interface::write_thumbnail(std::string const& args)
+{
+    if ( thumbnailPID > 0 )
+    {
+        if ( 0 == waitpid(thumbnailPID, nullptr, WNOHANG) )
+            return;
+        thumbnailPID = 0;
+    }
+    const char dir[] = "thumbnail";
+    try {
+        simul.writeState(dir);
+    }
+    catch( Exception & e ) {
+        std::cerr << "Error making thumbnail: " << e.what() << '\n';
+        return;
+    }
+    std::vector<std::string> str = { "play", "image", "frame=0" };
+    std::istringstream iss(args);
+    std::string tok;
+    while ( iss >> tok )
+        str.push_back(tok);
+    std::vector<char*> argv;
+    for ( std::string & s : str )
+        argv.push_back(&s[0]);
+    argv.push_back(nullptr);
+    // use `play` from the directory of the executable, or from the PATH:
+    char exe[4096] = { 0 };
+    ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe)-8);
+    if ( n > 0 )
+    {
+        exe[n] = 0;
+        char * slash = strrchr(exe, '/');
+        if ( slash )
+            strcpy(slash+1, "play");
+        else
+            exe[0] = 0;
+    }
+    else
+        exe[0] = 0;
+
+    pid_t pid = fork();
+    if ( pid < 0 )
+    {
+        Cytosim::warn << "could not fork process to make thumbnail\n";
+        return;
+    }
+    if ( pid > 0 )
+    {
+        thumbnailPID = pid;
+        return;
+    }
+    // in the child, silence the output of `play`:
+    if ( chdir(dir) )
+        _exit(EXIT_FAILURE);
+    int fd = open("/dev/null", O_WRONLY);
+    if ( fd >= 0 )
+        dup2(fd, STDOUT_FILENO);
+    if ( exe[0] )
+        execv(exe, argv.data());
+    execvp("play", argv.data());
+    _exit(127);
+}
+
+
+/**
+ This waits for the process making the last thumbnail, such that it does not
+ remain as a zombie process.
+ */
+void Interface::wait_thumbnail()
+{
+    if ( thumbnailPID > 0 )
+    {
+        waitpid(thumbnailPID, nullptr, 0);
+        thumbnailPID = 0;
+    }
+}
+
+
+/**
+ The numbers in the report, excluding comment lines, are compared with those
+ of the previous test. The report is only made every `stop_check` steps, and should be cheap to make.
+ */
+bool Interface::must_stop(StopCondition& stop)
+{
+    size_t cnt = simul.fibers.size();
+    if ( cnt < stop.min_fibers || stop.max_fibers < cnt )
+    {
+        Cytosim::log << "run stopped at time " << simul.time() << ": " << cnt << " fibers\n";
+        return true;
+    }
+    if ( stop.on_change && cnt != stop.nb_fibers )
+    {
+        Cytosim::log << "run stopped at time " << simul.time() << ": number of fibers changed from ";
+        Cytosim::log << stop.nb_fibers << " to " << cnt << "\n";
+        return true;
+    }
+    if ( stop.report.empty() )
+        return false;
+
+    std::stringstream ss;
+    Glossary opt;
     simul.relax();
-    VLOG("+RUN END\n");
+    simul.report(ss, stop.report, opt);
+    simul.unrelax();
+    std::vector<real> val;
+    std::string line, str;
+    while ( std::getline(ss, line) )
+    {
+        // skip comments, which include the time:
+        if ( line.empty() || line[0] == '%' )
+            continue;
+        std::istringstream iss(line);
+        while ( iss >> str )
+        {
+            char * end = nullptr;
+            real x = strtod(str.c_str(), &end);
+            if ( end != str.c_str() && *end == 0 )
+                val.push_back(x);
+        }
+    }
+    bool res = ( val.size() > 0 && val.size() == stop.values.size() );
+    for ( size_t i = 0; res && i < val.size(); ++i )
+    {
+        real a = val[i], b = stop.values[i];
+        res = ( abs_real(a-b) <= stop.epsilon * std::max(abs_real(a), abs_real(b)) );
+    }
+    stop.values.swap(val);
+    if ( res )
+        Cytosim::log << "run stopped at time " << simul.time() << ": `" << stop.report << "' has converged\n";
+    return res;
+}
+
+
+/**
+ The progress of the current run is recorded in the checkpoint, such that it
+ can be resumed by executing the same configuration file (see resume()).
+ */
+void Interface::write_checkpoint(size_t step, size_t frame)
+{
+    simul.relax();
+    std::string info = "run " + std::to_string(runCount) + " step " + std::to_string(step)
+                     + " frame " + std::to_string(frame);
+    try
+    {
+        simul.writeCheckpoint(CHECKPOINT, info);
+    }
+    catch( InvalidIO & e )
+    {
+        std::cerr << "Error writing checkpoint: " << e.what() << '\n';
+    }
+    simul.unrelax();
+}
+
+
+/**
+ Read the first line of the checkpoint, which indicates the run to resume.
+ The state of the simulation is only restored when this run is reached.
+ */
+void Interface::resume(std::string const& file)
+{
+    std::ifstream is(file);
+    std::string line, tok;
+    std::getline(is, line);
+    std::istringstream iss(line);
+    iss >> tok;
+    if ( tok != "#checkpoint" )
+        throw InvalidIO("`"+file+"' is not a checkpoint");
+    long long val = 0;
+    while ( iss >> tok >> val )
+    {
+        if ( tok == "run" ) resumeRun = val;
+        else if ( tok == "step" ) resumeStep = val;
+        else if ( tok == "frame" ) resumeFrame = val;
+        else if ( tok == "trajectory" ) resumeSize = val;
+    }
+    if ( resumeRun < 1 )
+        throw InvalidIO("invalid checkpoint `"+file+"'");
+    resumeFile = file;
+}
+
+
+void Interface::resume_run()
+{
+    simul.readCheckpoint(resumeFile);
+    // remove the frames written after the checkpoint:
+    struct stat st;
+    if ( resumeSize > 0 && 0 == stat(TRAJECTORY, &st) && st.st_size > resumeSize )
+    {
+        if ( truncate(TRAJECTORY, resumeSize) )
+            Cytosim::warn << "could not truncate `" << TRAJECTORY << "'\n";
+        FrameIndex index;
+        index.read(TRAJECTORY);
+        index.trim(resumeSize);
+        index.write(TRAJECTORY);
+    }
+    simul.prop->clear_trajectory = false;
+    Cytosim::log << "resuming run " << resumeRun << " at frame " << resumeFrame << " from `" << resumeFile << "'\n";
+    resumeRun = 0;
 }
 
 
@@ -849,6 +1464,10 @@ void Interface::execute_run(unsigned nb_steps, Glossary& opt, bool do_write)
 */
 void Interface::execute_run(unsigned nb_steps)
 {
+    if ( ++runCount < resumeRun )
+        return;
+    if ( runCount == resumeRun )
+        resume_run();
     VLOG("-RUN START " << nb_steps << '\n');
     simul.prepare();
     
@@ -885,13 +1504,14 @@ void Interface::execute_run(unsigned nb_steps)
 void Interface::execute_import(std::string const& file, std::string const& what, Glossary& opt)
 {
     // we could use the 'tag' to select a certain class of object
-    ObjectSet * subset = nullptr;
+    unsigned mask = Simul::ALL_SETS;
     
     if ( what != "all" && what != "objects" )
     {
-        subset = simul.findSet(what);
+        ObjectSet * subset = simul.findSet(what);
         if ( !subset )
             throw InvalidIO("expected class specifier (eg. `import all FILE' or `import fiber FILE')");
+        mask = simul.setBit(subset);
     }
 
     Inputter in(DIM, file.c_str(), true);
@@ -912,11 +1532,11 @@ void Interface::execute_import(std::string const& file, std::string const& what,
         if ( append )
         {
             real t = simul.prop->time;
-            simul.loadObjects(in, subset);
+            simul.loadObjects(in, mask);
             simul.prop->time = t;
         }
         else
-            simul.reloadObjects(in, subset);
+            simul.reloadObjects(in, mask);
         if ( cnt >= frm )
             break;
         ++cnt;
@@ -951,6 +1571,10 @@ void Interface::execute_export(std::string& file, std::string const& what, Gloss
     
     opt.set(append, "append");
     opt.set(binary, "binary");
+    
+    // this was done before the checkpoint:
+    if ( resumeRun > 0 )
+        return;
 
     VLOG("-EXPORT " << what << " to " << file << '\n');
     
@@ -983,6 +1607,10 @@ void Interface::execute_report(std::string& file, std::string const& what, Gloss
     bool verbose = true;
     opt.set(verbose, "verbose");
     std::string str;
+    
+    // this was done before the checkpoint:
+    if ( resumeRun > 0 )
+        return;
     VLOG("-WRITE " << what << " to " << file << '\n');
     
     std::ostream * osp = &std::cout;
@@ -4,6 +4,10 @@
 #define INTERFACE_H
 
 #include <iostream>
+#include <vector>
+#include <functional>
+#include <csignal>
+#include <sys/types.h>
 #include "isometry.h"
 #include "object.h"
 
@@ -23,16 +27,100 @@ private:
     /// disabled default constructor
     Interface();
 
+public:
+    
+    /// true while a `run` that can save a checkpoint is executing
+    static volatile std::sig_atomic_t canCheckpoint;
+    
+    /// signal received during such a `run`, which then saves a checkpoint and stops
+    static volatile std::sig_atomic_t signalReceived;
+    
+    /// file descriptor of the command channel read between steps, or -1
+    static int commandChannel;
+    
+    /// create the named pipe `path` from which commands are read during `run`
+    static int open_channel(std::string const& path);
+
 protected:
     
     /// associated Simul
     Simul& simul;
     
+    /// what is written at the end of each frame of `run`
+    struct FrameOutput
+    {
+        bool objects;                      ///< write the objects to the trajectory file
+        bool binary;                       ///< use the binary format for the objects
+        std::vector<std::string> reports;  ///< in-situ reports, as pairs (WHAT, FILE)
+        std::vector<std::function<void()>> makers; ///< in-situ reports, parsed at the first frame
+        Glossary * options;                ///< options of the reports
+        size_t thumbnail;                  ///< number of frames between thumbnails, or 0
+        std::string thumbnail_args;        ///< options given to `play` for the thumbnails
+    };
+    
+    /// write the objects and the reports at the end of a frame
+    void       write_frame(size_t frame, FrameOutput&);
+    
+    /// conditions to terminate `run` before the specified number of steps
+    struct StopCondition
+    {
+        size_t interval;             ///< number of steps between tests, or 0 if none
+        size_t min_fibers;           ///< minimum number of fibers
+        size_t max_fibers;           ///< maximum number of fibers
+        size_t nb_fibers;            ///< number of fibers at the start of the run
+        bool   on_change;            ///< stop if the number of fibers changed
+        std::string report;          ///< report tested for convergence
+        real   epsilon;              ///< threshold on the relative change of `report`
+        std::vector<real> values;    ///< values of `report` at the previous test
+    };
+    
+    /// return true if one of the conditions is fulfilled, after printing why
+    bool       must_stop(StopCondition&);
+    
+    /// number of `run` commands started
+    size_t     runCount;
+    
+    /// index of the `run` command to resume from a checkpoint, or 0
+    size_t     resumeRun;
+    
+    /// progress of the run to resume: number of steps and frames done
+    size_t     resumeStep, resumeFrame;
+    
+    /// size of the trajectory file when the checkpoint was written
+    long long  resumeSize;
+    
+    /// name of the checkpoint to resume from
+    std::string resumeFile;
+    
+    /// process making the last thumbnail, or 0
+    pid_t      thumbnailPID;
+    
+    /// render the current state to an image, in a separate process
+    void       write_thumbnail(std::string const& args);
+    
+    /// wait for the process making the last thumbnail
+    void       wait_thumbnail();
+    
+    /// write a checkpoint, recording the progress of the current run
+    void       write_checkpoint(size_t step, size_t frame);
+    
+    /// restore the state saved in the checkpoint, and truncate the trajectory file
+    void       resume_run();
+    
+    /// incomplete line received from the command channel
+    std::string channelLine;
+    
+    /// read the command channel, executing each complete line with execute_command()
+    void       read_channel();
+
 public:
     
     /// construct and associates with given Simul
     Interface(Simul&);
     
+    /// resume the simulation from a checkpoint, when the config file is executed
+    void       resume(std::string const& file);
+    
     //-------------------------------------------------------------------------------
     
     /// this is called between commands during the execution process
@@ -41,6 +129,9 @@ public:
      */
     virtual void hold() {}
     
+    /// execute a line received from the command channel during `run`
+    virtual void execute_command(std::string const&) {}
+    
     //-------------------------------------------------------------------------------
     
     /// create a new Property of category `cat` from values set in Glossary
@@ -91,6 +182,9 @@ public:
     /// perform `cnt` simulation steps, with no option
     void       execute_run(unsigned cnt);
 
+    /// perform simulation steps with adaptive time step, for a duration corresponding to `cnt` steps
+    void       execute_run_adaptive(unsigned cnt, size_t nb_frames, void (Simul::*)(), real factor, unsigned iter, bool write, FrameOutput&, StopCondition&);
+
     /// execute miscellaneous functions
     void       execute_call(std::string& func, Glossary&);
 
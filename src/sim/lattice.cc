@@ -1,54 +1,95 @@
 // Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
 
 #include "lattice.h"
+#include "lattice_bits.h"
+#include <algorithm>
 
 
-/// write data within [inf, sup[ to file
-template <>
-void Lattice<uint8_t>::write_data(Outputter& out, lati_t inf, lati_t sup) const
+thread_local RealArena lattice_arena("lattice");
+
+/**
+ Write integer values within [inf, sup[ with the smallest number of bytes that can
+ represent the maximum value. If all values are 0 or 1, they are packed in words
+ of 64 bits, corresponding to the format of LatticeBits::write().
+ */
+template <typename CELL>
+static void write_integers(Outputter& out, CELL const* site, int inf, int sup)
 {
+    CELL sup_val = 0;
+    for ( int s = inf; s < sup; ++s )
+        sup_val = std::max(sup_val, site[s]);
+
     out.writeUInt16(0);
     out.writeUInt8(0);
-    out.writeUInt8(1);
+    if ( sup_val <= 1 )
+    {
+        out.writeUInt8(LatticeBits::PACKED_BITS);
+        uint64_t w = 0;
+        for ( int s = inf; s < sup; ++s )
+        {
+            if ( site[s] )
+                w |= uint64_t(1) << (( s - inf ) & 63 );
+            if ( (( s - inf ) & 63 ) == 63 )
+            {
+                out.writeUInt64(w);
+                w = 0;
+            }
+        }
+        if ( ( sup - inf ) & 63 )
+            out.writeUInt64(w);
+    }
+    else if ( sup_val <= 0xFF )
+    {
+        out.writeUInt8(1);
+        for ( int s = inf; s < sup; ++s )
+            out.writeUInt8(site[s]);
+    }
+    else if ( sup_val <= 0xFFFF )
+    {
+        out.writeUInt8(2);
+        for ( int s = inf; s < sup; ++s )
+            out.writeUInt16(site[s]);
+    }
+    else if ( sup_val <= 0xFFFFFFFF )
+    {
+        out.writeUInt8(4);
+        for ( int s = inf; s < sup; ++s )
+            out.writeUInt32(site[s]);
+    }
+    else
+    {
+        out.writeUInt8(8);
+        for ( int s = inf; s < sup; ++s )
+            out.writeUInt64(site[s]);
+    }
+}
 
-    for ( lati_t s = inf; s < sup; ++s )
-        out.writeUInt8(laSite[s]);
+/// write data within [inf, sup[ to file
+template <>
+void Lattice<uint8_t>::write_data(Outputter& out, lati_t inf, lati_t sup) const
+{
+    write_integers(out, laSite, inf, sup);
 }
 
 /// write data within [inf, sup[ to file
 template <>
 void Lattice<uint16_t>::write_data(Outputter& out, lati_t inf, lati_t sup) const
 {
-    out.writeUInt16(0);
-    out.writeUInt8(0);
-    out.writeUInt8(2);
-
-    for ( lati_t s = inf; s < sup; ++s )
-        out.writeUInt16(laSite[s]);
+    write_integers(out, laSite, inf, sup);
 }
 
 /// write data within [inf, sup[ to file
 template <>
 void Lattice<uint32_t>::write_data(Outputter& out, lati_t inf, lati_t sup) const
 {
-    out.writeUInt16(0);
-    out.writeUInt8(0);
-    out.writeUInt8(4);
-
-    for ( lati_t s = inf; s < sup; ++s )
-        out.writeUInt32(laSite[s]);
+    write_integers(out, laSite, inf, sup);
 }
 
 /// write data within [inf, sup[ to file
 template <>
 void Lattice<uint64_t>::write_data(Outputter& out, lati_t inf, lati_t sup) const
 {
-    out.writeUInt16(0);
-    out.writeUInt8(0);
-    out.writeUInt8(8);
-    
-    for ( lati_t s = inf; s < sup; ++s )
-        out.writeUInt64(laSite[s]);
+    write_integers(out, laSite, inf, sup);
 }
 
 /// write data within [inf, sup[ to file
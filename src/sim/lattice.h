@@ -5,10 +5,12 @@
 
 #include <cmath>
 #include <iostream>
+#include <type_traits>
 #include "assert_macro.h"
 #include "exceptions.h"
 #include "iowrapper.h"
 #include "real.h"
+#include "real_arena.h"
 
 
 /// Array of discrete sites aligned with the abscissa of a Fiber
@@ -31,7 +33,13 @@
  
      density = value(index) / unit();
  
+ The sites of all Lattices are obtained from `lattice_arena`, which recycles the
+ arrays released when a Fiber is deleted, or when its Lattice is extended.
  */
+/// arrays used by all the Lattices, in the current thread
+extern thread_local RealArena lattice_arena;
+
+
 template <typename CELL>
 class Lattice
 {
@@ -75,7 +83,9 @@ private:
         //std::clog << this << " Lattice::allocate [" << inf << ", " << sup << "[\n";
         assert_true( inf <= sup );
         
-        cell_t * ptr = new cell_t[sup-inf];
+        static_assert(std::is_trivially_copyable<cell_t>::value, "cells are stored in an array of reals");
+        size_t cnt = ( ( sup - inf ) * sizeof(cell_t) + sizeof(real) - 1 ) / sizeof(real);
+        cell_t * ptr = reinterpret_cast<cell_t*>(lattice_arena.allocate(cnt));
         cell_t * mem = ptr - inf;
         
         // reset new array:
@@ -93,7 +103,7 @@ private:
             }
         }
         
-        delete[] laSite0;
+        lattice_arena.release(reinterpret_cast<real*>(laSite0));
 
         laInf = inf;
         laSup = sup;
@@ -130,7 +140,7 @@ private:
     void deallocate()
     {
         //std::clog<<"Lattice realeased\n";
-        delete[] laSite0;
+        lattice_arena.release(reinterpret_cast<real*>(laSite0));
         laSite0 = nullptr;
         laSite  = nullptr;
         laInf   = 0;
@@ -165,6 +175,9 @@ public:
         
         //copy member variables:
         laUnit = lat.laUnit;
+        laSite0 = nullptr;
+        laIndexM = lat.laIndexM;
+        laIndexP = lat.laIndexP;
 
         // allocate and copy lat's data:
         allocate_copy(lat.laInf, lat.laSup, lat.laSite, lat.laInf, lat.laSup);
@@ -449,7 +462,7 @@ public:
 
 #pragma mark - I/O
     
-    /// write data within [inf, sup[ to file
+    /// write data within [inf, sup[ to file, using as few bytes per site as possible
     void write_data(Outputter& out, lati_t inf, lati_t sup) const;
     
     /// write specified range to file
@@ -504,7 +517,18 @@ public:
         allocate(inf, sup, 0);
         clear();
         
-        if ( nbytes == 1 )
+        if ( nbytes == 128 )
+        {
+            // bit-packed values, as written by LatticeBits::write()
+            uint64_t w = 0;
+            for ( lati_t s = inf; s < sup; ++s )
+            {
+                if ( (( s - inf ) & 63 ) == 0 )
+                    w = in.readUInt64();
+                laSite[s] = ( w >> (( s - inf ) & 63 )) & 1;
+            }
+        }
+        else if ( nbytes == 1 )
         {
             for ( lati_t s = inf; s < sup; ++s )
                 laSite[s] = in.readUInt8();
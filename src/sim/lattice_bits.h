@@ -0,0 +1,297 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef LATTICE_BITS_H
+#define LATTICE_BITS_H
+
+#include <cmath>
+#include <cstdint>
+#include "assert_macro.h"
+#include "exceptions.h"
+#include "iowrapper.h"
+#include "real.h"
+
+
+/// Occupancy of discrete sites aligned with the abscissa of a Fiber, with one bit per site
+/**
+ LatticeBits follows the conventions of Lattice, for the indices of the sites
+ and their relation to the abscissa, but it only records if a site is occupied:
+
+     index = (lati_t) floor( abscissa / unit );
+
+ The sites are packed in 64-bit words, which reduces the memory by a factor 64
+ compared to Lattice<uint64_t>, and the first vacant site or the number of
+ occupied sites in a range are found by processing 64 sites at a time.
+
+ This is appropriate for Hands with a single footprint, that only need to know
+ if a site is free. The data are saved in the same format as Lattice::write(),
+ such that it can be read by Lattice::read(), with sites of value 0 or 1.
+ */
+class LatticeBits
+{
+public:
+
+    /// type used to index the Lattice
+    typedef int lati_t;
+
+    /// a word of 64 sites
+    typedef uint64_t word_t;
+
+    /// type-code in the file header indicating bit-packed data (see Lattice::read)
+    static constexpr int PACKED_BITS = 128;
+
+private:
+
+    /// lowest valid index, multiple of 64
+    lati_t     laInf;
+
+    /// highest valid index plus one, multiple of 64
+    lati_t     laSup;
+
+    /// distance between adjacent sites
+    real       laUnit;
+
+    /// words, such that site `s` is bit `(s-laInf)&63` of word `(s-laInf)>>6`
+    word_t *   laWord;
+
+    /// index of cell containing the MINUS_END
+    lati_t     laIndexM;
+
+    /// index of cell containing the PLUS_END
+    lati_t     laIndexP;
+
+    /// round down to a multiple of 64
+    static lati_t floor64(lati_t s) { return s & ~63; }
+
+    /// word containing site `s`
+    word_t& word(lati_t s) const { return laWord[(s-laInf)>>6]; }
+
+    /// bit representing site `s` in its word
+    static word_t bit(lati_t s) { return word_t(1) << ( s & 63 ); }
+
+    /// allocate for indices within [inf, sup[, conserving the existing sites
+    void allocate(lati_t inf, lati_t sup)
+    {
+        assert_true( inf <= sup );
+        if ( laWord && laInf <= inf && sup <= laSup )
+            return;
+        if ( laWord )
+        {
+            inf = std::min(inf, laInf);
+            sup = std::max(sup, laSup);
+        }
+        inf = floor64(inf);
+        sup = floor64(sup+63);
+
+        size_t cnt = ( sup - inf ) >> 6;
+        word_t * mem = new word_t[cnt];
+        for ( size_t i = 0; i < cnt; ++i )
+            mem[i] = 0;
+        if ( laWord )
+        {
+            size_t off = ( laInf - inf ) >> 6;
+            for ( lati_t i = 0; i < ( laSup - laInf ) >> 6; ++i )
+                mem[off+i] = laWord[i];
+            delete[] laWord;
+        }
+        laWord = mem;
+        laInf = inf;
+        laSup = sup;
+    }
+
+    /// disabled copy constructor
+    LatticeBits(LatticeBits const&);
+
+    /// disabled assignment operator
+    LatticeBits& operator = (LatticeBits const&);
+
+public:
+
+    /// Constructor
+    LatticeBits() : laInf(0), laSup(0), laUnit(0), laWord(nullptr), laIndexM(0), laIndexP(0) {}
+
+    /// Destructor
+    ~LatticeBits() { delete[] laWord; }
+
+    /// set distance betwen adjacent sites
+    void setUnit(real u)
+    {
+        if ( u < REAL_EPSILON )
+            throw InvalidParameter("lattice:unit must be > 0");
+        laUnit = u;
+    }
+
+    /// true if lattice unit size was set
+    bool ready() const { return laUnit > REAL_EPSILON; }
+
+    /// set the range of valid abscissa
+    void setRange(real a, real b)
+    {
+        assert_true( laUnit > REAL_EPSILON );
+        laIndexM = index(a);
+        laIndexP = index(b);
+        /* allocate with a safety margin of 8 cells */
+        allocate(laIndexM-8, laIndexP+9);
+    }
+
+    /// index of site containing the MINUS_END
+    lati_t  indexM() const { return laIndexM; }
+
+    /// index of site containing the PLUS_END
+    lati_t  indexP() const { return laIndexP; }
+
+    /// first valid index
+    lati_t  inf()    const { return laInf; }
+
+    /// last valid index plus one
+    lati_t  sup()    const { return laSup; }
+
+    /// distance between adjacent sites
+    real    unit()   const { return laUnit; }
+
+    /// index of the site containing abscissa `a`
+    lati_t  index(real a)    const { return (lati_t)floor(a/laUnit); }
+
+    /// abscissa of the beginning of site `s`
+    real    abscissa(real s) const { return s * laUnit; }
+
+    /// true if index 'i' is covered by the lattice allocated range
+    bool    valid(lati_t i)  const { return ( laInf <= i  &&  i < laSup ); }
+
+    /// true if site `s` is occupied
+    bool    occupied(lati_t s) const { assert_true(valid(s)); return word(s) & bit(s); }
+
+    /// true if site `s` is unoccupied
+    bool    vacant(lati_t s) const { assert_true(valid(s)); return !( word(s) & bit(s) ); }
+
+    /// mark site `s` as occupied
+    void    occupy(lati_t s) { assert_true(valid(s)); word(s) |= bit(s); }
+
+    /// mark site `s` as unoccupied
+    void    release(lati_t s) { assert_true(valid(s)); word(s) &= ~bit(s); }
+
+    /// mark all sites as unoccupied
+    void    clear()
+    {
+        for ( lati_t i = 0; i < ( laSup - laInf ) >> 6; ++i )
+            laWord[i] = 0;
+    }
+
+    /// index of the first vacant site in [s, e[, or `e` if all sites are occupied
+    lati_t  firstVacant(lati_t s, lati_t e) const
+    {
+        s = std::max(s, laInf);
+        e = std::min(e, laSup);
+        while ( s < e )
+        {
+            // invert the word to find a vacant site, ignoring the sites below `s`:
+            word_t w = ~word(s) & ( ~word_t(0) << ( s & 63 ));
+            if ( w )
+                return std::min(e, floor64(s) + __builtin_ctzll(w));
+            s = floor64(s) + 64;
+        }
+        return e;
+    }
+
+    /// index of the first occupied site in [s, e[, or `e` if all sites are vacant
+    lati_t  firstOccupied(lati_t s, lati_t e) const
+    {
+        s = std::max(s, laInf);
+        e = std::min(e, laSup);
+        while ( s < e )
+        {
+            word_t w = word(s) & ( ~word_t(0) << ( s & 63 ));
+            if ( w )
+                return std::min(e, floor64(s) + __builtin_ctzll(w));
+            s = floor64(s) + 64;
+        }
+        return e;
+    }
+
+    /// number of occupied sites in [s, e[
+    size_t  count(lati_t s, lati_t e) const
+    {
+        s = std::max(s, laInf);
+        e = std::min(e, laSup);
+        size_t res = 0;
+        while ( s < e )
+        {
+            lati_t n = floor64(s) + 64;
+            word_t w = word(s) & ( ~word_t(0) << ( s & 63 ));
+            if ( e < n )
+                w &= ~( ~word_t(0) << ( e & 63 ));
+            res += __builtin_popcountll(w);
+            s = n;
+        }
+        return res;
+    }
+
+    /// number of occupied sites
+    size_t  count() const { return count(laInf, laSup); }
+
+    /// write sites within [inf, sup[ to file, in the format of Lattice::write()
+    void write(Outputter& out, lati_t inf, lati_t sup) const
+    {
+        if ( sup < inf )
+            throw InvalidIO("incoherent Lattice boundaries");
+        if ( laUnit < REAL_EPSILON )
+            throw InvalidIO("incoherent Lattice unit value");
+
+        out.writeInt32(inf);
+        out.writeInt32(sup);
+        out.writeFloat(laUnit);
+        out.writeUInt16(0);
+        out.writeUInt8(0);
+        out.writeUInt8(PACKED_BITS);
+
+        word_t w = 0;
+        for ( lati_t s = inf; s < sup; ++s )
+        {
+            if ( valid(s) && occupied(s) )
+                w |= word_t(1) << (( s - inf ) & 63 );
+            if ( (( s - inf ) & 63 ) == 63 )
+            {
+                out.writeUInt64(w);
+                w = 0;
+            }
+        }
+        if ( ( sup - inf ) & 63 )
+            out.writeUInt64(w);
+    }
+
+    /// write all sites to file
+    void write(Outputter& out) const { write(out, laInf, laSup); }
+
+    /// clear all sites and read data from file written by write()
+    void read(Inputter& in)
+    {
+        lati_t inf = in.readInt32();
+        lati_t sup = in.readInt32();
+        real uni = in.readFloat();
+        in.readUInt16();
+        in.readUInt8();
+        int code = in.readUInt8();
+
+        if ( sup < inf )
+            throw InvalidIO("incoherent Lattice boundaries");
+        if ( uni < REAL_EPSILON )
+            throw InvalidIO("incoherent Lattice unit value");
+        if ( code != PACKED_BITS )
+            throw InvalidIO("LatticeBits can only read bit-packed data");
+
+        laUnit = uni;
+        allocate(inf, sup);
+        clear();
+
+        word_t w = 0;
+        for ( lati_t s = inf; s < sup; ++s )
+        {
+            if ( (( s - inf ) & 63 ) == 0 )
+                w = in.readUInt64();
+            if ( w & ( word_t(1) << (( s - inf ) & 63 )))
+                occupy(s);
+        }
+    }
+};
+
+#endif
+
@@ -14,6 +14,7 @@
  */
 
 #include <fstream>
+#include <algorithm>
 
 #include "meca.h"
 #include "mecable.h"
@@ -27,6 +28,7 @@
 #include "tictoc.h"
 #include "bicgstab.h"
 #include "gmres.h"
+#include "iowrapper.h"
 
 #include "meca_inter.cc"
 
@@ -57,17 +59,40 @@
 #define DEBUG_MECA 0
 
 
-/// number of threads running in parallel
-#define NUM_THREADS 1
+/**
+ With `precondition = 3`, the LU factorization of a block is reused, unless
+ its relative error on the current matrix block exceeds PRECOND_REFRESH_TOLERANCE,
+ or if it was calculated more than PRECOND_REFRESH_PERIOD steps ago.
+ */
+#define PRECOND_REFRESH_PERIOD 16
+#define PRECOND_REFRESH_TOLERANCE 0.1
+
+
+/**
+ With `precondition = 4`, the block preconditionner is combined with a coarse
+ correction acting on the translations of the Mecables. The coarse system is
+ solved directly, and it is skipped if its size exceeds MECA_COARSE_LIMIT.
+ */
+#define MECA_COARSE_LIMIT 4096
+
+
+/**
+ With `precondition = 5`, the entire matrix of the system is built and factorized,
+ such that the preconditionner is the inverse of the matrix. This is only done if
+ the dimension of the system does not exceed MECA_DIRECT_LIMIT, see directLimit()
+ */
+#define MECA_DIRECT_LIMIT 1024
 
 
-#if NUM_THREADS > 1
+#if MECA_USES_OPENMP
 /*
- Parallelization uses Intel's OpenMP.
- This requires a specific flag for the compiler, so adjust the makefile.inc
- CXXFLG := -std=gnu++14 -fopenmp
+ Parallelization uses OpenMP, see MECA_USES_OPENMP in meca.h
  */
 #include <omp.h>
+#ifdef __linux__
+#  include <sched.h>
+#  include <pthread.h>
+#endif
 #endif
 
 
@@ -86,9 +111,48 @@ Meca::Meca()
     vRND = nullptr;
     vRHS = nullptr;
     vFOR = nullptr;
+    vALT = nullptr;
     vTMP = nullptr;
     vMEM = nullptr;
+    vCOR = nullptr;
+    vALT = nullptr;
+    vOLD[0] = nullptr;
+    vOLD[1] = nullptr;
+    nbPtsOld[0] = 0;
+    nbPtsOld[1] = 0;
+    allocatedOld_ = 0;
+    coarseDim = 0;
+    coarseAllocated = 0;
+    mCoarse = nullptr;
+    vCoarse = nullptr;
+    coarsePivot = nullptr;
+    directDim = 0;
+    directAllocated = 0;
+    mDirect = nullptr;
+    directPivot = nullptr;
     useMatrixC = false;
+    useMatrixFree = false;
+    matrixKernel = 0;
+    kernelCounter = 0;
+    useInPlace = false;
+    sharedPoints = false;
+    reorderCounter = 0;
+    nbRanked = 0;
+    useIsolate = false;
+    isoObjs = 0;
+    isoSolved = 0;
+    isoPts = 0;
+    nbThreads = 1;
+    solverCount = 0;
+    solverResidual = 0;
+    solverNoise = 0;
+    solverTime[0] = 0;
+    solverTime[1] = 0;
+#if MECA_USES_OPENMP
+    allocatedThreads = 1;
+    pinnedThreads = 0;
+    strideMEM = 0;
+#endif
     drawLinks = false;
     time_step = 0;
 }
@@ -103,6 +167,66 @@ void allocate_vector(size_t s, real *& ptr, bool reset)
 }
 
 
+#if MECA_USES_OPENMP
+/**
+ Pin the threads of OpenMP to the CPUs available to the process, thread `t`
+ using the `t`-th CPU, such that a thread keeps accessing the memory that it
+ touched first, which is allocated by the system on the NUMA node of this CPU.
+ The placement set by the user with OMP_PROC_BIND or OMP_PLACES is respected.
+ */
+static void pinThreads(int nbt)
+{
+#ifdef __linux__
+    if ( getenv("OMP_PROC_BIND") || getenv("OMP_PLACES") )
+        return;
+    cpu_set_t all;
+    if ( sched_getaffinity(0, sizeof(all), &all) || CPU_COUNT(&all) < nbt )
+        return;
+    #pragma omp parallel num_threads(nbt)
+    {
+        int n = omp_get_thread_num();
+        for ( int c = 0; c < CPU_SETSIZE; ++c )
+        {
+            if ( CPU_ISSET(c, &all) && 0 == n-- )
+            {
+                cpu_set_t one;
+                CPU_ZERO(&one);
+                CPU_SET(c, &one);
+                pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+                break;
+            }
+        }
+    }
+#endif
+}
+#endif
+
+
+/**
+ Set the number of threads to be used, given the value of `simul:threads`.
+ If `nbt == 0`, the number is set by OpenMP, following the environment
+ variable OMP_NUM_THREADS if it is defined.
+ This has no effect if cytosim was not compiled with OpenMP.
+ */
+void Meca::setThreads(int nbt)
+{
+#if MECA_USES_OPENMP
+    if ( nbt <= 0 )
+        nbt = omp_get_max_threads();
+    nbThreads = std::max(1, nbt);
+    if ( nbThreads > 1 && nbThreads != pinnedThreads )
+    {
+        pinThreads(nbThreads);
+        pinnedThreads = nbThreads;
+    }
+#else
+    if ( nbt > 1 )
+        LOG_ONCE("Warning: simul:threads is ignored as cytosim was compiled without OpenMP\n");
+    nbThreads = 1;
+#endif
+}
+
+
 void Meca::allocate(size_t alc)
 {
     //allocate the vectors
@@ -113,22 +237,58 @@ void Meca::allocate(size_t alc)
         
         // pad with 4 doubles to allow SIMD instruction burr
         alc = DIM * allocated_ + 4;
-        allocate_vector(alc, vPTS, 1);
-        allocate_vector(alc, vSOL, 1);
+        if ( sharedPoints )
+        {
+            // the Mecables may be using the previous array, see sharePoints()
+            free_real(vALT);
+            vALT = vPTS;
+            vPTS = nullptr;
+        }
+        allocate_vector(alc, vPTS, !MECA_USES_OPENMP);
+        allocate_vector(alc, vSOL, !MECA_USES_OPENMP);
         allocate_vector(alc, vBAS, 0);
-        allocate_vector(alc, vRND, 1);
-        allocate_vector(alc, vRHS, 1);
-        allocate_vector(alc, vFOR, 1);
+        allocate_vector(alc, vRND, !MECA_USES_OPENMP);
+        allocate_vector(alc, vRHS, !MECA_USES_OPENMP);
+        allocate_vector(alc, vFOR, !MECA_USES_OPENMP);
         allocate_vector(alc, vTMP, 0);
-#if NUM_THREADS > 1
-        allocate_vector(alc, vMEM, 0);
+        allocate_vector(alc, vCOR, 0);
+#if MECA_USES_OPENMP
+        allocatedThreads = 1;
+        /*
+         The memory is placed on the NUMA node of the thread that first writes it.
+         Each thread zeroes the range of lines that it processes, see lineSplit().
+         */
+        real * vec[] = { vPTS, vSOL, vBAS, vRND, vRHS, vFOR, vTMP, vCOR };
+        #pragma omp parallel num_threads(nbThreads)
+        {
+            const int T = omp_get_num_threads();
+            const int t = omp_get_thread_num();
+            const index_t inf = lineSplit(alc, t, T);
+            const index_t sup = lineSplit(alc, t+1, T);
+            for ( real * v : vec )
+                zero_real(sup-inf, v+inf);
+        }
 #endif
     }
+#if MECA_USES_OPENMP
+    // thread-private accumulators used in calculateForces()
+    if ( nbThreads > allocatedThreads )
+    {
+        allocatedThreads = nbThreads;
+        strideMEM = chunk_real(DIM * allocated_ + 4);
+        allocate_vector(strideMEM*(nbThreads-1), vMEM, 0);
+    }
+    splitB.resize(nbThreads+1);
+    splitC.resize(nbThreads+1);
+    splitO.resize(nbThreads+1);
+#endif
 }
 
 
 void Meca::release()
 {
+    if ( noise_.valid() )
+        noise_.wait();
     //std::clog << "Meca::release()\n";
     free_real(vPTS);
     free_real(vSOL);
@@ -138,6 +298,20 @@ void Meca::release()
     free_real(vFOR);
     free_real(vTMP);
     free_real(vMEM);
+    free_real(vCOR);
+    free_real(vALT);
+    free_real(vOLD[0]);
+    free_real(vOLD[1]);
+    free_real(mCoarse);
+    free_real(vCoarse);
+    delete[] coarsePivot;
+    free_real(mDirect);
+    delete[] directPivot;
+#if MECA_USES_OPENMP
+    for ( Meca * S : stages )
+        delete S;
+    stages.clear();
+#endif
     vPTS = nullptr;
     vSOL = nullptr;
     vBAS = nullptr;
@@ -146,6 +320,21 @@ void Meca::release()
     vFOR = nullptr;
     vTMP = nullptr;
     vMEM = nullptr;
+    vCOR = nullptr;
+    vOLD[0] = nullptr;
+    vOLD[1] = nullptr;
+    nbPtsOld[0] = 0;
+    nbPtsOld[1] = 0;
+    allocatedOld_ = 0;
+    mCoarse = nullptr;
+    vCoarse = nullptr;
+    coarsePivot = nullptr;
+    coarseAllocated = 0;
+    coarseDim = 0;
+    mDirect = nullptr;
+    directPivot = nullptr;
+    directAllocated = 0;
+    directDim = 0;
 }
 
 
@@ -183,108 +372,158 @@ unsigned Meca::largestMecable() const
      F <- vBAS + mB * vPTS + mC * vPTS
 
  */
-#if NUM_THREADS > 1
+#if MECA_USES_OPENMP
+
+/**
+ Divide the columns of `mat` into `nbt` contiguous ranges, that contain
+ approximately the same number of elements, and thus the same amount of work
+ in the matrix-vector multiplication. The diagonal term is counted for all columns.
+ On return, range `t` is [ split[t], split[t+1] [
+ */
+template < typename MATRIX >
+static void balanceColumns(MATRIX const& mat, index_t size, int nbt, index_t split[])
+{
+    const size_t sum = size + mat.nbElements(0, size);
+    size_t cnt = 0;
+    int t = 1;
+    split[0] = 0;
+    for ( index_t j = 0; j < size && t < nbt; ++j )
+    {
+        cnt += 1 + mat.nbElements(j, j+1);
+        while ( t < nbt && cnt * nbt >= sum * t )
+            split[t++] = j + 1;
+    }
+    while ( t <= nbt )
+        split[t++] = size;
+}
+
+
+/**
+ The Mecables are divided in `nbThreads` contiguous ranges, such that range `t`
+ contains the Mecables whose first point is in the lines [ lineSplit(t), lineSplit(t+1) [.
+ The loops over the Mecables follow these ranges, and since the lines are also
+ the ones that were first touched by thread `t` in allocate(), each thread
+ mostly accesses memory located on its own NUMA node.
+ The ranges contain a similar number of points, and each Mecable keeps
+ the thread of its range, including for its block of the preconditionner.
+ */
+void Meca::balanceMecables()
+{
+    const index_t dim = dimension();
+    const index_t cnt = objs.size();
+    index_t i = 0;
+    splitO[0] = 0;
+    for ( int t = 1; t < nbThreads; ++t )
+    {
+        const index_t inf = lineSplit(dim, t, nbThreads);
+        while ( i < cnt && DIM * objs[i]->matIndex() < inf )
+            ++i;
+        splitO[t] = i;
+    }
+    splitO[nbThreads] = cnt;
+}
+
+
+/**
+ The columns of the matrices corresponding to the first `nbPts` points
+ are distributed equally between threads
+ */
+void Meca::balanceMatrices()
+{
+    if ( nbThreads > 1 )
+    {
+        balanceColumns(mB, nbPts, nbThreads, splitB.data());
+        if ( useMatrixC )
+            balanceColumns(mC, dimension(), nbThreads, splitC.data());
+    }
+}
+
+
+/**
+ calculate the forces into `F`, given the Mecable coordinates `X`:
+ 
+     F <- B + mB * X + mC * X
+
+ If B == 0, this term is ommited. With B = vBAS and X = vPTS, the procedure
+ calculates the forces in the system in `F`:
+ 
+     F <- vBAS + mB * vPTS + mC * vPTS
+
+ The columns of mB and mC are divided in `nbThreads` ranges of equal work,
+ set by prepareMatrices(). Since the matrices are symmetric and only the lower
+ triangle is stored, a column affects lines all over the vector, and each thread
+ accumulates its contribution in a private vector. Thread 0 uses `F` directly,
+ and the other threads use slices of `vMEM`. These vectors are summed up in
+ parallel at the end, with each thread handling a different range of lines.
+ */
 void Meca::calculateForces(const real* X, real const* B, real* F) const
 {
     assert_true( empty() || ( X != F && X != B && F != B ));
+    
+    const index_t dim = dimension();
+    
+    if ( nbThreads < 2 )
+    {
+        if ( B )
+            copy_real(dim, B, F);
+        else
+            zero_real(dim, F);
+        mB.VECMULADDISO(X, F, 0, nbPts);
+        if ( useMatrixC )
+            mC.vecMulAdd(X, F, 0, dim);
+        if ( mLinks.size() )
+            addLinkForces(X, F);
+        return;
+    }
+    
+    // OpenMP may provide less threads than requested:
+    int nbt = nbThreads;
 
-    /*
-    We partition the matrix into equal parts, assuming it is of constant density,
-    symmetric and stored in its lower triangle, such that columns of low index
-    have more elements: n_elements(inx) ~ ( size - inx )
-    Hence to split in two we use these ratios:
-        s = 1.0 - sqrt(1/2);
-    and to split in 3 equal parts:
-        s1 = 1.0 - sqrt(2/3);
-        s2 = 1.0 - sqrt(1/3);
-    or to split in 4 equal parts:
-        s1 = 1.0 - sqrt(3/4);
-        s2 = 1.0 - sqrt(2/4);
-        s3 = 1.0 - sqrt(1/4);
-     */
-    index_t dim = dimension();
-
-    if ( useMatrixC )
+    #pragma omp parallel num_threads(nbThreads)
     {
-        index_t spl1 = index_t( dim * 0.184 );
-        index_t spl2 = index_t( dim * 0.423 );
-#if ( 0 )
-        std::clog << " matrixC split [ 0 " << spl1 << " " << spl2 << " " << dim <<" ] :  ";
-        std::clog << mC.nbElements(0, spl1) << " " << mC.nbElements(spl1, spl2) << " " << mC.nbElements(spl2, siz) << "\n";
-#endif
-        #pragma omp parallel sections num_threads(4)
+        const int T = omp_get_num_threads();
+        const int t = omp_get_thread_num();
+        real * acc = F;
+        
+        if ( t > 0 )
         {
-            #pragma omp section
-            {
-                // F <- B + mB * X
-                if ( B )
-                    copy_real(dim, B, F);      //blas::xcopy(dimension(), B, 1, F, 1);
-                else
-                    zero_real(dim, F);
-                
-                mB.VECMULADDISO(X, F);
-            }
-            #pragma omp section
-            {
-                zero_real(dim, vRND);
-                mC.vecMulAdd(X, vRND, 0, spl1);
-            }
-            #pragma omp section
-            {
-                zero_real(dim, vTMP);
-                mC.vecMulAdd(X, vTMP, spl1, spl2);
-            }
-            #pragma omp section
-            {
-                zero_real(dim, vMEM);
-                mC.vecMulAdd(X, vMEM, spl2, dim);
-            }
+            acc = vMEM + strideMEM * ( t - 1 );
+            zero_real(dim, acc);
         }
-    }
-    else
-    {
-        index_t nbp = nbPts;
-        index_t spl1 = index_t( nbp * 0.134 );
-        index_t spl2 = index_t( nbp * 0.293 );
-        index_t spl3 = index_t( nbp * 0.5 );
-#if ( 0 )
-        std::clog << " matrixB split [ 0 " << spl1 << " " << spl2 << " " << spl3 << " " << nbp <<" ] :  ";
-        std::clog << mB.nbElements(0, spl1) << " " << mB.nbElements(spl1, spl2) << " ";
-        std::clog << mB.nbElements(spl2, spl3) << " " << mB.nbElements(spl3, siz) << "\n";
-#endif
-        #pragma omp parallel sections num_threads(4)
+        else if ( B )
+            copy_real(dim, B, F);
+        else
+            zero_real(dim, F);
+        
+        for ( int r = t; r < nbThreads; r += T )
         {
-            #pragma omp section
-            {
-                // F <- B + mB * X
-                if ( B )
-                    copy_real(dim, B, F);
-                else
-                    zero_real(dim, F);
-                mB.VECMULADDISO(X, F, 0, spl1);
-            }
-            #pragma omp section
-            {
-                zero_real(dim, vRND);
-                mB.VECMULADDISO(X, vRND, spl1, spl2);
-            }
-            #pragma omp section
-            {
-                zero_real(dim, vTMP);
-                mB.VECMULADDISO(X, vTMP, spl2, spl3);
-            }
-            #pragma omp section
-            {
-                zero_real(dim, vMEM);
-                mB.VECMULADDISO(X, vMEM, spl3, nbp);
-            }
+            // acc <- acc + mB * X
+            mB.VECMULADDISO(X, acc, splitB[r], splitB[r+1]);
+            
+            // acc <- acc + mC * X
+            if ( useMatrixC )
+                mC.vecMulAdd(X, acc, splitC[r], splitC[r+1]);
         }
-    }
+        
+        if ( t == 0 )
+            nbt = T;
 
-    // finally sum up all contributions into F
-    #pragma vector aligned
-    for ( index_t i = 0; i < dim; ++i )
-        F[i] = ( F[i] + vRND[i] ) + ( vTMP[i] + vMEM[i] );
+        #pragma omp barrier
+        
+        // sum up all contributions into F, each thread processing a range of lines
+        const index_t inf = lineSplit(dim, t, T);
+        const index_t sup = lineSplit(dim, t+1, T);
+        for ( int u = 1; u < nbt; ++u )
+        {
+            real const* src = vMEM + strideMEM * ( u - 1 );
+            #pragma vector aligned
+            for ( index_t i = inf; i < sup; ++i )
+                F[i] += src[i];
+        }
+    }
+    
+    if ( mLinks.size() )
+        addLinkForces(X, F);
 }
 
 #else
@@ -312,33 +551,71 @@ void Meca::calculateForces(const real* X, real const* B, real* F) const
     
     // F <- F + mB * X
 #if ( DIM == 1 )
-    mB.vecMulAdd(X, F);
+    mB.vecMulAdd(X, F, 0, nbPts);
 #elif ( DIM == 2 )
-    mB.vecMulAddIso2D(X, F);
+    mB.vecMulAddIso2D(X, F, 0, nbPts);
 #elif ( DIM == 3 )
-    mB.vecMulAddIso3D(X, F);
+    mB.vecMulAddIso3D(X, F, 0, nbPts);
 #endif
 
     if ( useMatrixC )
     {
         // F <- F + mC * X
-        mC.vecMulAdd(X, F);
+        mC.vecMulAdd(X, F, 0, dimension());
     }
+    
+    if ( mLinks.size() )
+        addLinkForces(X, F);
 }
 #endif
 
 
+/**
+ Apply the terms of the links that couple different Mecables, which are:
+ 
+     mB(i, j) -= weight * cof[i] * cof[j]
+ 
+ for `i` in { 0, 1 } and `j` in { 2, 3 }, and symmetrically.
+ */
+void Meca::addLinkForces(const real* X, real* F) const
+{
+    for ( MecaLink const& L : mLinks )
+    {
+        real const* x0 = X + DIM * L.inx[0];
+        real const* x1 = X + DIM * L.inx[1];
+        real const* x2 = X + DIM * L.inx[2];
+        real const* x3 = X + DIM * L.inx[3];
+        real * f0 = F + DIM * L.inx[0];
+        real * f1 = F + DIM * L.inx[1];
+        real * f2 = F + DIM * L.inx[2];
+        real * f3 = F + DIM * L.inx[3];
+        for ( int d = 0; d < DIM; ++d )
+        {
+            real a = L.weight * ( L.cof[0] * x0[d] + L.cof[1] * x1[d] );
+            real b = L.weight * ( L.cof[2] * x2[d] + L.cof[3] * x3[d] );
+            f0[d] -= L.cof[0] * b;
+            f1[d] -= L.cof[1] * b;
+            f2[d] -= L.cof[2] * a;
+            f3[d] -= L.cof[3] * a;
+        }
+    }
+}
+
+
 void Meca::addAllRigidity(const real* X, real* Y) const
 {
-#if NUM_THREADS > 1
-    #pragma omp parallel num_threads(NUM_THREADS)
+#if MECA_USES_OPENMP
+    #pragma omp parallel num_threads(nbThreads)
     {
-        Mecable ** mci = objs.begin() + omp_get_thread_num();
-        while ( mci < objs.end() )
+        const int T = omp_get_num_threads();
+        for ( int r = omp_get_thread_num(); r < nbThreads; r += T )
         {
-            const index_t inx = DIM * (*mci)->matIndex();
-            (*mci)->addRigidity(X+inx, Y+inx);
-            mci += NUM_THREADS;
+            Mecable ** end = objs.begin() + splitO[r+1];
+            for ( Mecable ** mci = objs.begin() + splitO[r]; mci < end; ++mci )
+            {
+                const index_t inx = DIM * (*mci)->matIndex();
+                (*mci)->addRigidity(X+inx, Y+inx);
+            }
         }
     }
 #else
@@ -351,57 +628,37 @@ void Meca::addAllRigidity(const real* X, real* Y) const
 }
 
 
-/**
- calculate the matrix vector product corresponding to 'mec'
- 
-     Y <- X + alpha * speed( Y + P' * X );
- 
- */
-inline void multiply1(Mecable const* mec, real alpha, const real* xxx, real* yyy)
-{
-#if ( DIM > 1 )
-    mec->addRigidity(xxx, yyy);
-#endif
-
-#if ADD_PROJECTION_DIFF
-    if ( mec->hasProjectionDiff() )
-        mec->addProjectionDiff(xxx, yyy);
-#endif
-
-    mec->projectForces(yyy, yyy);
-
-    // Y <- X + alpha * Y
-    blas::xpay(DIM*mec->nbPoints(), xxx, alpha*mec->leftoverMobility(), yyy);
-}
-
-
 /**
  calculate the matrix product needed for the conjugate gradient algorithm
  
      Y <- X - time_step * speed( mB + mC + P' ) * X;
  
+ The second part is done by Mecable::applyDynamics() for each object
  */
 void Meca::multiply(const real* X, real* Y) const
 {
     // Y <- ( mB + mC ) * X
     calculateForces(X, nullptr, Y);
     
-#if NUM_THREADS > 1
-    #pragma omp parallel num_threads(NUM_THREADS)
+#if MECA_USES_OPENMP
+    #pragma omp parallel num_threads(nbThreads)
     {
-        Mecable ** mci = objs.begin() + omp_get_thread_num();
-        while ( mci < objs.end() )
+        const int T = omp_get_num_threads();
+        for ( int r = omp_get_thread_num(); r < nbThreads; r += T )
         {
-            const index_t inx = DIM * (*mci)->matIndex();
-            multiply1(*mci, -time_step, X+inx, Y+inx);
-            mci += NUM_THREADS;
+            Mecable ** end = objs.begin() + splitO[r+1];
+            for ( Mecable ** mci = objs.begin() + splitO[r]; mci < end; ++mci )
+            {
+                const index_t inx = DIM * (*mci)->matIndex();
+                (*mci)->applyDynamics(-time_step, X+inx, Y+inx);
+            }
         }
     }
 #else
     for ( Mecable * mec : objs )
     {
         const index_t inx = DIM * mec->matIndex();
-        multiply1(mec, -time_step, X+inx, Y+inx);
+        mec->applyDynamics(-time_step, X+inx, Y+inx);
     }
 #endif
 }
@@ -454,14 +711,13 @@ static void expand_matrix(unsigned siz, real * mat)
 
 
 /**
- Get the total diagonal block corresponding to an Object, which is:
+ Get the stiffness block corresponding to an Object, which is:
  
-     I - time_step * P ( mB + mC + P' )
+     Rigidity + mB + mC
  
- The result is constructed by using functions from mB and mC
- This block is square but not symmetric!
+ This block is square and symmetric, and is returned in full.
  */
-void Meca::getBlock(real* res, const Mecable * mec) const
+void Meca::getStiffnessBlock(real* res, const Mecable * mec) const
 {
     const unsigned ps = mec->nbPoints();
     const unsigned bs = DIM * ps;
@@ -486,6 +742,22 @@ void Meca::getBlock(real* res, const Mecable * mec) const
     std::clog<<"mB+mC block:\n";
     VecPrint::print(std::clog, bs, bs, res, bs);
 #endif
+}
+
+
+/**
+ Get the total diagonal block corresponding to an Object, which is:
+ 
+     I - time_step * P ( mB + mC + P' )
+ 
+ The result is constructed by using functions from mB and mC
+ This block is square but not symmetric!
+ */
+void Meca::getBlock(real* res, const Mecable * mec) const
+{
+    const unsigned bs = DIM * mec->nbPoints();
+    
+    getStiffnessBlock(res, mec);
     
 #if ADD_PROJECTION_DIFF
     if ( mec->hasProjectionDiff() )
@@ -644,121 +916,839 @@ void Meca::checkBlock(const Mecable * mec, const real* blk)
 
 /**
 Compute block of the preconditionner corresponding to 'mec'
+ `wrk` should be of size `bs * bs`, where `bs = DIM * nbPoints()`
  */
-void Meca::computePreconditionner(Mecable* mec)
+void Meca::computePreconditionner(Mecable* mec, real* wrk)
 {
-    unsigned bs = DIM * mec->nbPoints();
-
+    const unsigned rk = mec->rigidRank();
+    if ( 0 < rk && 2 * rk < DIM * mec->nbPoints() && !mec->hasProjectionDiff() )
+    {
+        computeRigidPreconditionner(mec, wrk);
+        return;
+    }
+    
     mec->allocateBlock();
-    real* blk = mec->block();
  
     // extract diagonal matrix block corresponding to this Mecable:
-    getBlock(blk, mec);
+    getBlock(wrk, mec);
+
+    //verifyBlock(mec, wrk);
+    
+    factorizeBlock(mec, wrk);
+}
 
-    //verifyBlock(mec, blk);
 
+/**
+ Calculate the LU factorization of the block `wrk`, in double precision,
+ and copy the result to mec->block()
+ */
+void Meca::factorizeBlock(Mecable* mec, real* wrk)
+{
+    unsigned bs = DIM * mec->nbPoints();
+    
     // calculate LU factorization:
     int info = 0;
-    lapack::xgetf2(bs, bs, blk, bs, mec->pivot(), &info);
+    lapack::xgetf2(bs, bs, wrk, bs, mec->pivot(), &info);
     
     if ( info == 0 )
     {
+        copy_real(bs*bs, wrk, mec->block());
         mec->useBlock(1);
+        mec->blockAge(0);
         //testBlock(mec, blk);
         //std::clog << "Meca::computePreconditionner(" << mec->reference() << ")\n";
     }
     else
     {
         assert_true(mec->useBlock() == 0);
+        mec->blockAge(~0U);
         std::clog << "Meca::computePreconditionner failed (lapack::xgetf2, info " << info << ")\n";
     }
 }
 
 
-/// Compute all the blocks of the preconditionner
+#if MECABLE_FLOAT_BLOCK
+
 /**
- This is method 1, that should perform well and can be multithreaded
+ Solve A * X = Y, given the LU factors of A calculated by LAPACK's xgetf2(),
+ but stored in single precision. The vector is kept in double precision.
+ This follows LAPACK's xgetrs('N')
  */
-void Meca::computePreconditionner()
+static void solveLU(const int N, float const* A, int const* ipiv, real* Y)
 {
-#if NUM_THREADS > 1
-    #pragma omp parallel num_threads(NUM_THREADS)
+    // apply row interchanges:
+    for ( int i = 0; i < N; ++i )
     {
-        Mecable ** mci = objs.begin() + omp_get_thread_num();
-        while ( mci < objs.end() )
-        {
-            computePreconditionner(*mci);
-            mci += NUM_THREADS;
-        }
-        //printf("thread %i complete %i\n", omp_get_thread_num(), TicToc::microseconds());
+        const int k = ipiv[i] - 1;
+        if ( k != i )
+            std::swap(Y[i], Y[k]);
+    }
+    // solve L * X = Y, where L is unit lower triangular:
+    for ( int j = 0; j < N; ++j )
+    {
+        const real y = Y[j];
+        float const* col = A + N * j;
+        for ( int i = j+1; i < N; ++i )
+            Y[i] -= col[i] * y;
+    }
+    // solve U * X = Y, where U is upper triangular:
+    for ( int j = N-1; j >= 0; --j )
+    {
+        float const* col = A + N * j;
+        const real y = Y[j] / col[j];
+        Y[j] = y;
+        for ( int i = 0; i < j; ++i )
+            Y[i] -= col[i] * y;
     }
-#else
-    for ( Mecable * mec : objs )
-        computePreconditionner(mec);
-#endif
 }
 
 
-void Meca::precondition(const real* X, real* Y) const
-{    
-#if NUM_THREADS > 1
-    #pragma omp parallel num_threads(NUM_THREADS)
+/**
+ Solve A * X = Y, given the LU factors of the band matrix A, calculated by
+ LAPACK's xgbtrf() with KU = KL, but stored in single precision.
+ This follows LAPACK's xgbtrs('N')
+ */
+static void solveBandLU(const int N, const int KL, float const* AB, const int LDAB, int const* ipiv, real* Y)
+{
+    const int KD = 2 * KL;
+    // solve L * X = Y, applying row interchanges:
+    for ( int j = 0; j < N-1; ++j )
     {
-        int info;
-        Mecable ** mci = objs.begin() + omp_get_thread_num();
-        while ( mci < objs.end() )
-        {
-            Mecable const* mec = *mci;
-            const int bs = DIM * mec->nbPoints();
-            real const* xxx = X + DIM * mec->matIndex();
-            real * yyy = Y + DIM * mec->matIndex();
-            blas::xcopy(bs, xxx, 1, yyy, 1);
-            if ( mec->useBlock() )
-                lapack::xgetrs('N', bs, 1, mec->block(), bs, mec->pivot(), yyy, bs, &info);
-            mci += NUM_THREADS;
-        }
+        const int k = ipiv[j] - 1;
+        if ( k != j )
+            std::swap(Y[j], Y[k]);
+        const real y = Y[j];
+        const int sup = std::min(KL, N-1-j);
+        float const* col = AB + KD + LDAB * j;
+        for ( int i = 1; i <= sup; ++i )
+            Y[j+i] -= col[i] * y;
     }
-#else
-    blas::xcopy(dimension(), X, 1, Y, 1);
-    for ( Mecable const* mec : objs )
+    // solve U * X = Y, where U is upper triangular with KD off-diagonals:
+    for ( int j = N-1; j >= 0; --j )
     {
-        const int bs  = DIM * mec->nbPoints();
-        const int inx = DIM * mec->matIndex();
-        int info = 0;
-        if ( mec->useBlock() )
-            lapack::xgetrs('N', bs, 1, mec->block(), bs, mec->pivot(), Y+inx, bs, &info);
+        // A(i,j) is stored in AB[KD+i-j+LDAB*j]
+        float const* col = AB + LDAB * j + KD - j;
+        const real y = Y[j] / col[j];
+        Y[j] = y;
+        for ( int i = std::max(0, j-KD); i < j; ++i )
+            Y[i] -= col[i] * y;
     }
-#endif
 }
 
-
-//------------------------------------------------------------------------------
-#pragma mark - Solve
+#endif
 
 
-/// function to sort Mecables
-int smaller_mecable(const void * ap, const void * bp)
+/// apply the preconditionner block of `mec` to vector `Y`, in place
+static void applyBlock(Mecable const* mec, real* Y)
 {
-    Mecable const** a = (Mecable const**)(ap);
-    Mecable const** b = (Mecable const**)(bp);
-
-    if ( (*a)->nbPoints() > (*b)->nbPoints() ) return -1;
-    if ( (*a)->nbPoints() < (*b)->nbPoints() ) return  1;
-    return 0;
+    const int bs = DIM * mec->nbPoints();
+    if ( mec->useBlock() == 3 )
+    {
+        // Y <- Y - G * inverse( I + H * G ) * H * Y, see computeRigidPreconditionner()
+        const int rk = mec->rigidRank();
+        block_real const* H = mec->block();
+        real vec[6] = { 0 };
+        for ( int j = 0; j < bs; ++j )
+        {
+            const real y = Y[j];
+            for ( int k = 0; k < rk; ++k )
+                vec[k] -= H[k+rk*j] * y;
+        }
+#if MECABLE_FLOAT_BLOCK
+        solveLU(rk, H+rk*bs, mec->pivot(), vec);
+#else
+        int info = 0;
+        lapack::xgetrs('N', rk, 1, H+rk*bs, rk, mec->pivot(), vec, rk, &info);
+#endif
+        mec->addRigidMotion(vec, Y);
+    }
+    else if ( mec->useBlock() == 2 )
+    {
+        const int kl = DIM * ( mec->blockBandwidth() + 1 ) - 1;
+#if MECABLE_FLOAT_BLOCK
+        solveBandLU(bs, kl, mec->block(), 3*kl+1, mec->pivot(), Y);
+#else
+        int info = 0;
+        lapack::xgbtrs('N', bs, kl, kl, 1, mec->block(), 3*kl+1, mec->pivot(), Y, bs, &info);
+#endif
+    }
+    else if ( mec->useBlock() )
+    {
+#if MECABLE_FLOAT_BLOCK
+        solveLU(bs, mec->block(), mec->pivot(), Y);
+#else
+        int info = 0;
+        lapack::xgetrs('N', bs, 1, mec->block(), bs, mec->pivot(), Y, bs, &info);
+#endif
+    }
 }
 
 
 /**
- Allocate and reset matrices and vectors necessary for Meca::solve(),
- copy coordinates of Mecables into vPTS[]
+ Update the block of the preconditionner corresponding to 'mec', only if
+ the existing LU factorization does not approximate well the inverse of the
+ current matrix block, or if it was calculated more than
+ PRECOND_REFRESH_PERIOD steps ago.
+ 
+ The current block `M` is calculated in `wrk`, and the quality of the old
+ factorization `P` is estimated with the Gaussian random terms `v` of the
+ Mecable, from | P * M * v - v | / | v |.
+ This test and getBlock() are O(N^2), while the factorization is O(N^3),
+ which saves time for Mecables with many points.
+ The LU factors may then not correspond exactly to the current block, which
+ only decreases the efficiency of the preconditionner, but not the precision
+ of the solution, since the residual of the system is always monitored.
+ `wrk` should be of size `bs * ( bs + 2 )`, where `bs = DIM * nbPoints()`
  */
-void Meca::prepare(Simul const* sim)
+void Meca::renewPreconditionner(Mecable* mec, real* wrk)
 {
-    ready_ = 0;
-    objs.clear();
+    const unsigned bs = DIM * mec->nbPoints();
     
-    for ( Fiber  * f= sim->fibers.first(); f ; f=f->next() )
-        addMecable(f);
+    // the factorization can only be reused if the size is unchanged:
+    if ( mec->blockSize() != bs || mec->blockAge() >= PRECOND_REFRESH_PERIOD || mec->useBlock() == 3 )
+    {
+        computePreconditionner(mec, wrk);
+        return;
+    }
+    
+    getBlock(wrk, mec);
+
+    real * vec = wrk + bs * bs;
+    real * res = vec + bs;
+    copy_real(bs, vRND+DIM*mec->matIndex(), vec);
+    
+    // res <- P * M * vec - vec
+    blas::xgemv('N', bs, bs, 1.0, wrk, bs, vec, 1, 0.0, res, 1);
+    mec->useBlock(1);
+    applyBlock(mec, res);
+    blas::xaxpy(bs, -1.0, vec, 1, res, 1);
+    
+    real err = blas::nrm2(bs, res);
+    
+    if ( err < PRECOND_REFRESH_TOLERANCE * blas::nrm2(bs, vec) )
+    {
+        // keep the current factorization:
+        mec->blockAge(mec->blockAge()+1);
+    }
+    else
+    {
+        mec->useBlock(0);
+        factorizeBlock(mec, wrk);
+    }
+}
+
+
+/**
+ Compute the block of the preconditionner corresponding to 'mec', approximating
+ it by a band matrix with `mec->blockBandwidth()` vertices on each side of the
+ diagonal. The terms outside the band are small for a Mecafil, and discarding
+ them affects only the efficiency of the preconditionner.
+ The band matrix uses `N * ( 3 * KL + 1 )` scalars instead of `N^2`, and its
+ LU factorization costs `N * KL^2` instead of `N^3`, where N = DIM * nPoints
+ and KL = DIM * ( BW + 1 ) - 1.
+ The factorization is stored in LAPACK's band format, and `useBlock()==2`.
+ If the band is not significantly smaller than the block, a full block is used.
+ `wrk` should be of size `bs * ( bs + bs / 2 )`, where `bs = DIM * nbPoints()`
+ */
+void Meca::computeBandedPreconditionner(Mecable* mec, real* wrk)
+{
+    const int bs = DIM * mec->nbPoints();
+    const int kl = DIM * ( mec->blockBandwidth() + 1 ) - 1;
+    const int ldd = 3 * kl + 1;
+    
+    if ( mec->blockBandwidth() == 0 || 2 * ldd > bs )
+    {
+        computePreconditionner(mec, wrk);
+        return;
+    }
+    
+    getBlock(wrk, mec);
+
+    real * band = wrk + bs * bs;
+    zero_real(ldd*bs, band);
+    
+    // copy the band, with A(i,j) stored in band[2*kl+i-j+ldd*j]:
+    for ( int j = 0; j < bs; ++j )
+    {
+        const int inf = std::max(0, j-kl);
+        const int sup = std::min(bs, j+kl+1);
+        copy_real(sup-inf, wrk+inf+bs*j, band+2*kl+inf-j+ldd*j);
+    }
+    
+    mec->allocateBlock(ldd*bs);
+    
+    int info = 0;
+    lapack::xgbtrf(bs, bs, kl, kl, band, ldd, mec->pivot(), &info);
+    
+    // the band factors are not reused by renewPreconditionner():
+    mec->blockAge(~0U);
+    
+    if ( info == 0 )
+    {
+        copy_real(ldd*bs, band, mec->block());
+        mec->useBlock(2);
+    }
+    else
+        std::clog << "Meca::computeBandedPreconditionner failed (lapack::xgbtrf, info " << info << ")\n";
+}
+
+
+/**
+ For a Mecable that only moves as a rigid body, the projection has rank R and
+ factors as P = G * V, where V = rigidVelocity() and G = addRigidMotion().
+ The block is then a low-rank update of the identity:
+ 
+     M = I + G * H,   with H = -time_step * leftoverMobility * V * K
+ 
+ where K is the stiffness block, and by the Woodbury identity:
+ 
+     inverse(M) = I - G * inverse( I + H * G ) * H
+ 
+ The block stores H (R x N) followed by the LU factors of I + H * G (R x R),
+ and applying it costs O(R*N), instead of O(N^2) for the dense LU factors,
+ whose calculation costs O(N^3). The result is the same as computePreconditionner()
+ up to rounding errors. This is indicated by `useBlock()==3`.
+ `wrk` should be of size `bs * ( bs + bs / 2 )`, where `bs = DIM * nbPoints()`
+ */
+void Meca::computeRigidPreconditionner(Mecable* mec, real* wrk)
+{
+    const unsigned bs = DIM * mec->nbPoints();
+    const unsigned rk = mec->rigidRank();
+    assert_true( 2 * rk < bs );
+    
+    getStiffnessBlock(wrk, mec);
+    
+    // H = beta * V * K, calculated column by column since K is symmetric:
+    real * H = wrk + bs * bs;
+    const real beta = -time_step * mec->leftoverMobility();
+    for ( unsigned j = 0; j < bs; ++j )
+        mec->rigidVelocity(wrk+bs*j, H+rk*j);
+    for ( unsigned n = 0; n < rk*bs; ++n )
+        H[n] *= beta;
+    
+    // A = I + H * G, calculated column by column, reusing `wrk`:
+    real A[36], vec[6] = { 0 };
+    for ( unsigned k = 0; k < rk; ++k )
+    {
+        zero_real(bs, wrk);
+        vec[k] = 1.0;
+        mec->addRigidMotion(vec, wrk);
+        vec[k] = 0.0;
+        blas::xgemv('N', rk, bs, 1.0, H, rk, wrk, 1, 0.0, A+rk*k, 1);
+        A[k+rk*k] += 1.0;
+    }
+    
+    mec->allocateBlock(rk*(bs+rk));
+    mec->blockAge(0);
+    
+    int info = 0;
+    lapack::xgetf2(rk, rk, A, rk, mec->pivot(), &info);
+    if ( info == 0 )
+    {
+        block_real * blk = mec->block();
+        for ( unsigned n = 0; n < rk*bs; ++n )
+            blk[n] = H[n];
+        for ( unsigned n = 0; n < rk*rk; ++n )
+            blk[rk*bs+n] = A[n];
+        mec->useBlock(3);
+    }
+    else
+    {
+        mec->useBlock(0);
+        mec->blockAge(~0U);
+        std::clog << "Meca::computeRigidPreconditionner failed (lapack::xgetf2, info " << info << ")\n";
+    }
+}
+
+
+/// Compute all the blocks of the preconditionner
+/**
+ With `method = 1`, all blocks are computed.
+ With `method = 2`, blocks are calculated using computeBandedPreconditionner()
+ With `method = 3`, blocks are calculated using renewPreconditionner()
+ With `method = 5`, the full system is factorized by computeDirectFactorization(),
+ and if the system is too large, `method = 1` is used instead.
+ This can be multithreaded
+ */
+void Meca::computePreconditionner(int method)
+{
+    coarseDim = 0;
+    directDim = 0;
+    
+    if ( method == 5 && computeDirectFactorization() )
+        return;
+    
+    // allocate work space for each thread, large enough for all methods:
+    const size_t bs = DIM * largestMecable();
+    temporary.allocate(bs*(bs+bs/2+2), nbThreads);
+
+#if MECA_USES_OPENMP
+    #pragma omp parallel num_threads(nbThreads)
+    {
+        const int T = omp_get_num_threads();
+        real * wrk = temporary.bind(omp_get_thread_num());
+        // each block is computed by the thread that will apply it:
+        for ( int r = omp_get_thread_num(); r < nbThreads; r += T )
+        {
+            Mecable ** end = objs.begin() + splitO[r+1];
+            for ( Mecable ** mci = objs.begin() + splitO[r]; mci < end; ++mci )
+            {
+                if ( method == 2 )
+                    computeBandedPreconditionner(*mci, wrk);
+                else if ( method == 3 )
+                    renewPreconditionner(*mci, wrk);
+                else
+                    computePreconditionner(*mci, wrk);
+            }
+        }
+        //printf("thread %i complete %i\n", omp_get_thread_num(), TicToc::microseconds());
+    }
+#else
+    real * wrk = temporary.bind(0);
+    if ( method == 2 )
+    {
+        for ( Mecable * mec : objs )
+            computeBandedPreconditionner(mec, wrk);
+    }
+    else if ( method == 3 )
+    {
+        for ( Mecable * mec : objs )
+            renewPreconditionner(mec, wrk);
+    }
+    else
+    {
+        for ( Mecable * mec : objs )
+            computePreconditionner(mec, wrk);
+    }
+#endif
+    
+    if ( method == 4 )
+        computeCoarseCorrection();
+}
+
+
+/**
+ The coarse space is made of the translations of each Mecable, with DIM degrees
+ of freedom per Mecable. The Restriction (R) averages the vector over the vertices
+ of each Mecable, and the Prolongation (P) assigns to each vertex the value of its
+ Mecable. The coarse matrix is obtained by Galerkin projection:
+ 
+     A = R * M * P = I - time_step * mobility * R * ( mB + mC ) * P
+ 
+ Rigidity does not contribute since it is invariant by translation, and the projection
+ of a Fiber conserves the total force. The translational mobility of each Mecable
+ is measured by projecting a uniform force. The terms coupling different Mecables
+ are included, which is what the block preconditionner is missing.
+ */
+void Meca::computeCoarseCorrection()
+{
+    const index_t cd = DIM * objs.size();
+    if ( objs.size() < 2 || cd > MECA_COARSE_LIMIT )
+    {
+        coarseDim = 0;
+        return;
+    }
+    
+    if ( cd > coarseAllocated )
+    {
+        free_real(mCoarse);
+        free_real(vCoarse);
+        delete[] coarsePivot;
+        coarseAllocated = chunk_real(cd);
+        mCoarse = new_real(coarseAllocated*coarseAllocated);
+        vCoarse = new_real(coarseAllocated);
+        coarsePivot = new int[coarseAllocated];
+    }
+    
+    // map each vertex to its Mecable:
+    coarseMap.resize(nbPts);
+    for ( index_t i = 0; i < objs.size(); ++i )
+    {
+        Mecable const* mec = objs[i];
+        for ( index_t p = 0; p < mec->nbPoints(); ++p )
+            coarseMap[mec->matIndex()+p] = i;
+    }
+    
+    // sum the matrix elements over the vertices of each Mecable:
+    zero_real(cd*cd, mCoarse);
+    mB.addAggregated(mCoarse, cd, coarseMap.data(), DIM);
+    if ( useMatrixC )
+        mC.addAggregated(mCoarse, cd, coarseMap.data());
+    if ( mLinks.size() )
+        addLinkAggregated(mCoarse, cd);
+    
+    for ( index_t i = 0; i < objs.size(); ++i )
+    {
+        Mecable const* mec = objs[i];
+        const index_t nbp = mec->nbPoints();
+        // measure the translational mobility with a uniform force along X:
+        real * tmp = vTMP + DIM * mec->matIndex();
+        for ( index_t p = 0; p < DIM*nbp; ++p )
+            tmp[p] = ( p % DIM == 0 );
+        mec->projectForces(tmp, tmp);
+        real mob = 0;
+        for ( index_t p = 0; p < DIM*nbp; p += DIM )
+            mob += tmp[p];
+        mob *= mec->leftoverMobility() / real(nbp*nbp);
+        // scale the lines of this Mecable, and add identity:
+        for ( index_t d = DIM*i; d < DIM*(i+1); ++d )
+        {
+            for ( index_t j = 0; j < cd; ++j )
+                mCoarse[d+cd*j] *= -time_step * mob;
+            mCoarse[d+cd*d] += 1.0;
+        }
+    }
+    
+    int info = 0;
+    lapack::xgetrf(cd, cd, mCoarse, cd, coarsePivot, &info);
+    if ( info )
+    {
+        std::clog << "Meca::computeCoarseCorrection failed (lapack::xgetrf, info " << info << ")\n";
+        coarseDim = 0;
+        return;
+    }
+    coarseDim = cd;
+}
+
+
+/// the largest dimension for which the direct method `precondition = 5` is used
+size_t Meca::directLimit()
+{
+    return MECA_DIRECT_LIMIT;
+}
+
+
+/**
+ Build the full matrix of the system, following the same steps as getBlock():
+ 
+     I - time_step * P ( mB + mC + P' )
+ 
+ and calculate its LU factorization. The preconditionner is then the inverse of
+ the matrix, such that the iterative solver should converge immediately.
+ The matrix is dense, and this is only efficient for small systems, for which
+ the cost of the factorization, in dimension^3, remains moderate.
+ Returns false if the system is too large, or if the factorization failed.
+ */
+bool Meca::computeDirectFactorization()
+{
+    const index_t dim = dimension();
+    if ( dim == 0 || dim > MECA_DIRECT_LIMIT )
+        return false;
+    
+    if ( dim > directAllocated )
+    {
+        free_real(mDirect);
+        delete[] directPivot;
+        directAllocated = chunk_real(dim);
+        mDirect = new_real(directAllocated*directAllocated);
+        directPivot = new int[directAllocated];
+    }
+    
+    real * mat = mDirect;
+    zero_real(dim*dim, mat);
+    
+#if ( DIM > 1 )
+    for ( Mecable const* mec : objs )
+    {
+        const index_t off = DIM * mec->matIndex();
+        mec->addRigidityUpper(mat+off+dim*off, dim);
+    }
+#endif
+    
+    mB.addTriangularBlock(mat, dim, 0, nbPts, DIM);
+    
+    expand_matrix(dim, mat);
+    
+    if ( useMatrixC )
+        mC.addDiagonalBlock(mat, dim, 0, dim);
+    
+    // add the links that are not stored in mB:
+    for ( MecaLink const& L : mLinks )
+    {
+        for ( int a = 0; a < 4; ++a )
+        for ( int b = 0; b < 4; ++b )
+        {
+            const real w = L.weight * L.cof[a] * L.cof[b];
+            for ( int d = 0; d < DIM; ++d )
+                mat[DIM*L.inx[a]+d+dim*(DIM*L.inx[b]+d)] -= w;
+        }
+    }
+
+    for ( Mecable const* mec : objs )
+    {
+        const index_t off = DIM * mec->matIndex();
+        const index_t bs = DIM * mec->nbPoints();
+#if ADD_PROJECTION_DIFF
+        if ( mec->hasProjectionDiff() )
+        {
+            // include the corrections P' vector by vector, as in getBlock()
+            real* tmp = vTMP + off;
+            zero_real(bs, tmp);
+            for ( index_t ii = 0; ii < bs; ++ii )
+            {
+                tmp[ii] = 1.0;
+                mec->addProjectionDiff(tmp, mat+off+dim*(off+ii));
+                tmp[ii] = 0.0;
+            }
+        }
+#endif
+        // apply projection and scaling to the lines of this Mecable:
+        const real beta = -time_step * mec->leftoverMobility();
+        for ( index_t j = 0; j < dim; ++j )
+        {
+            real * col = mat + off + dim * j;
+            mec->projectForces(col, col);
+            for ( index_t i = 0; i < bs; ++i )
+                col[i] *= beta;
+        }
+    }
+    
+    // add Identity matrix:
+    for ( index_t i = 0; i < dim; ++i )
+        mat[i+dim*i] += 1.0;
+
+    int info = 0;
+    lapack::xgetrf(dim, dim, mat, dim, directPivot, &info);
+    if ( info )
+    {
+        std::clog << "Meca::computeDirectFactorization failed (lapack::xgetrf, info " << info << ")\n";
+        return false;
+    }
+    directDim = dim;
+    return true;
+}
+
+
+void Meca::addLinkAggregated(real* mat, unsigned ldd) const
+{
+    for ( MecaLink const& L : mLinks )
+    {
+        const index_t a = DIM * coarseMap[L.inx[0]];
+        const index_t b = DIM * coarseMap[L.inx[2]];
+        const real w = L.weight * ( L.cof[0] + L.cof[1] ) * ( L.cof[2] + L.cof[3] );
+        for ( int d = 0; d < DIM; ++d )
+        {
+            mat[a+d+ldd*(b+d)] -= w;
+            mat[b+d+ldd*(a+d)] -= w;
+        }
+    }
+}
+
+
+void Meca::coarseCorrection(const real* X, real* Y) const
+{
+    // restriction:
+    zero_real(coarseDim, vCoarse);
+    for ( index_t p = 0; p < nbPts; ++p )
+    {
+        real * c = vCoarse + DIM * coarseMap[p];
+        for ( int d = 0; d < DIM; ++d )
+            c[d] += X[DIM*p+d];
+    }
+    for ( index_t i = 0; i < objs.size(); ++i )
+    {
+        const real s = 1.0 / objs[i]->nbPoints();
+        for ( int d = 0; d < DIM; ++d )
+            vCoarse[DIM*i+d] *= s;
+    }
+    
+    int info = 0;
+    lapack::xgetrs('N', coarseDim, 1, mCoarse, coarseDim, coarsePivot, vCoarse, coarseDim, &info);
+    assert_true(info==0);
+    
+    // prolongation:
+    for ( index_t p = 0; p < nbPts; ++p )
+    {
+        real const* c = vCoarse + DIM * coarseMap[p];
+        for ( int d = 0; d < DIM; ++d )
+            Y[DIM*p+d] = c[d];
+    }
+}
+
+
+/// number of preconditionner blocks that were not factorized in the last call to computePreconditionner()
+size_t Meca::nbReusedBlocks() const
+{
+    size_t cnt = 0;
+    for ( Mecable const* mec : objs )
+        cnt += ( mec->useBlock() && mec->blockAge() > 0 );
+    return cnt;
+}
+
+
+/**
+ With the coarse correction, the preconditionner is applied multiplicatively:
+ 
+     Y = C * X + B * ( X - M * C * X )
+ 
+ where C is the coarse correction, B the block preconditionner and M the matrix.
+ */
+void Meca::precondition(const real* X, real* Y) const
+{
+    if ( directDim > 0 )
+    {
+        int info = 0;
+        blas::xcopy(directDim, X, 1, Y, 1);
+        lapack::xgetrs('N', directDim, 1, mDirect, directDim, directPivot, Y, directDim, &info);
+        assert_true(info==0);
+    }
+    else if ( coarseDim > 0 )
+    {
+        coarseCorrection(X, vTMP);
+        multiply(vTMP, vCOR);
+        blas::xpay(dimension(), X, -1.0, vCOR);
+        blockPrecondition(vCOR, Y);
+        blas::add(dimension(), vTMP, Y);
+    }
+    else
+        blockPrecondition(X, Y);
+}
+
+
+void Meca::blockPrecondition(const real* X, real* Y) const
+{
+#if MECA_USES_OPENMP
+    #pragma omp parallel num_threads(nbThreads)
+    {
+        const int T = omp_get_num_threads();
+        for ( int r = omp_get_thread_num(); r < nbThreads; r += T )
+        {
+            Mecable ** end = objs.begin() + splitO[r+1];
+            for ( Mecable ** mci = objs.begin() + splitO[r]; mci < end; ++mci )
+            {
+                Mecable const* mec = *mci;
+                const int bs = DIM * mec->nbPoints();
+                real const* xxx = X + DIM * mec->matIndex();
+                real * yyy = Y + DIM * mec->matIndex();
+                blas::xcopy(bs, xxx, 1, yyy, 1);
+                applyBlock(mec, yyy);
+            }
+        }
+    }
+#else
+    blas::xcopy(dimension(), X, 1, Y, 1);
+    for ( Mecable const* mec : objs )
+        applyBlock(mec, Y+DIM*mec->matIndex());
+#endif
+}
+
+
+//------------------------------------------------------------------------------
+#pragma mark - Solve
+
+
+/// function to sort Mecables
+int ordered_mecable(const void * ap, const void * bp)
+{
+    Mecable const** a = (Mecable const**)(ap);
+    Mecable const** b = (Mecable const**)(bp);
+    
+    if ( (*a)->orderKey() < (*b)->orderKey() ) return -1;
+    if ( (*a)->orderKey() > (*b)->orderKey() ) return  1;
+    return 0;
+}
+
+
+/// interleave the lowest 21 bits of the integer coordinates
+static size_t morton_code(const size_t c[])
+{
+    size_t res = 0;
+    for ( int b = 20; b >= 0; --b )
+        for ( int d = 0; d < DIM; ++d )
+            res = ( res << 1 ) | (( c[d] >> b ) & 1 );
+    return res;
+}
+
+
+/**
+ The keys are obtained by quantizing the center of each Mecable in the bounding box
+ of all centers, and interleaving the bits of the coordinates, such that objects
+ that are close in space are likely to get close keys.
+ After sorting, the key of each Mecable is replaced by its rank plus one,
+ which is used by restoreOrder() until the next call.
+ */
+void Meca::setOrderKeys()
+{
+    nbRanked = 0;
+    if ( objs.size() < 2 )
+        return;
+    
+    Vector inf = objs[0]->posP(0), sup = inf;
+    for ( Mecable const* mec : objs )
+    {
+        Vector cen = mec->posP(mec->nbPoints()/2);
+        for ( int d = 0; d < DIM; ++d )
+        {
+            inf[d] = std::min(inf[d], cen[d]);
+            sup[d] = std::max(sup[d], cen[d]);
+        }
+    }
+    
+    const real range = std::max(( sup - inf ).norm_inf(), REAL_EPSILON);
+    const real scale = real( 1 << 21 ) / range;
+    
+    for ( Mecable * mec : objs )
+    {
+        Vector cen = mec->posP(mec->nbPoints()/2);
+        size_t c[3] = { 0 };
+        for ( int d = 0; d < DIM; ++d )
+            c[d] = std::min(size_t(scale * ( cen[d] - inf[d] )), size_t(( 1 << 21 ) - 1 ));
+        mec->orderKey(morton_code(c));
+    }
+    objs.sort(ordered_mecable);
+    
+    for ( Mecable * mec : objs )
+        mec->orderKey(++nbRanked);
+}
+
+
+/**
+ The Mecables are placed in the order set by the last call to setOrderKeys(),
+ which is done in linear time since their ranks are known. The Mecables created
+ since then have a key of zero, and are placed at the end in the order of `objs`.
+ Hence the matrix indices only change if Mecables were deleted or resized.
+ */
+void Meca::restoreOrder()
+{
+    ranked.clear();
+    ranked.resize(nbRanked);
+    for ( size_t i = 0; i < nbRanked; ++i )
+        ranked[i] = nullptr;
+    
+    size_t cnt = 0;
+    for ( Mecable * mec : objs )
+    {
+        const size_t k = mec->orderKey();
+        if ( 0 < k && k <= nbRanked && !ranked[k-1] )
+            ranked[k-1] = mec;
+        else
+            objs[cnt++] = mec;
+    }
+    // shift the new Mecables to the end:
+    const size_t nb = objs.size();
+    for ( size_t i = cnt; i-- > 0; )
+        objs[nb-cnt+i] = objs[i];
+    size_t n = 0;
+    for ( Mecable * mec : ranked )
+        if ( mec ) objs[n++] = mec;
+    assert_true( n + cnt == nb );
+}
+
+
+/**
+ Allocate and reset matrices and vectors necessary for Meca::solve(),
+ copy coordinates of Mecables into vPTS[]
+ */
+void Meca::prepare(Simul const* sim)
+{
+    // `vRND` may be reallocated:
+    if ( noise_.valid() )
+        noise_.get();
+    ready_ = 0;
+    objs.clear();
+    
+    for ( Fiber  * f= sim->fibers.first(); f ; f=f->next() )
+        addMecable(f);
     for ( Solid  * s= sim->solids.first(); s ; s=s->next() )
         addMecable(s);
     for ( Sphere * o=sim->spheres.first(); o ; o=o->next() )
@@ -766,143 +1756,682 @@ void Meca::prepare(Simul const* sim)
     for ( Bead   * b=  sim->beads.first(); b ; b=b->next() )
         addMecable(b);
 
+    setThreads(sim->prop->threads);
+
+    useInPlace = sim->prop->in_place;
+    if ( sharedPoints && !useInPlace )
+        ownPoints();
+
+    /*
+     Order the Mecables to improve memory locality in the sparse matrices:
+     the keys are updated periodically, and kept in between
+     */
+    if ( sim->prop->reorder > 0 )
+    {
+        if ( 0 == reorderCounter++ % sim->prop->reorder )
+            setOrderKeys();
+        else
+            restoreOrder();
+    }
+    
+    /*
+     Place the Mecables that were isolated at the previous step at the end,
+     such that they can be excluded from the iterative solver by solve()
+     */
+    useIsolate = sim->prop->isolate;
+    isoObjs = objs.size();
+    if ( useIsolate )
+    {
+        Mecable ** mid = std::stable_partition(objs.begin(), objs.end(),
+                                               [](Mecable const* m) { return !m->isolated(); });
+        isoObjs = mid - objs.begin();
+    }
+    
+    /*
+     Attributes the position in the vector/matrix to each Mecable
+     */
+    index_t cnt = 0;
+    for ( Mecable * mec : objs )
+    {
+        mec->matIndex(cnt);
+        cnt += mec->nbPoints();
+    }
+    nbPts = cnt;
+    real const* pts = vPTS;
+    allocate(cnt);
+    if ( useInPlace )
+        sharePoints(vPTS != pts);
+#if MECA_USES_OPENMP
+    balanceMecables();
+#endif
+    
+    //allocate the sparse matrices:
+    mB.resize(cnt);
+    mB.reset();
+
+    mC.resize(DIM*cnt);
+    mC.reset();
+    
+    useMatrixFree = sim->prop->matrix_free;
+    if ( matrixKernel != sim->prop->matrix_kernel )
+    {
+        matrixKernel = sim->prop->matrix_kernel;
+        mB.setKernel(matrixKernel);
+        kernelCounter = 0;
+    }
+    mLinks.clear();
+    
+    // reset base:
+    zero_real(DIM*cnt, vBAS);
+    
+#if MECA_USES_OPENMP
+    #pragma omp parallel num_threads(nbThreads)
+    {
+        const int T = omp_get_num_threads();
+        for ( int r = omp_get_thread_num(); r < nbThreads; r += T )
+        {
+            Mecable ** end = objs.begin() + splitO[r+1];
+            for ( Mecable ** mci = objs.begin() + splitO[r]; mci < end; ++mci )
+            {
+                Mecable * mec = *mci;
+                mec->putPoints(vPTS+DIM*mec->matIndex());
+                mec->prepareMecable();
+                mec->useBlock(0);
+            }
+        }
+    }
+#else
+    for ( Mecable * mec : objs )
+    {
+        mec->putPoints(vPTS+DIM*mec->matIndex());
+        mec->prepareMecable();
+        mec->useBlock(0);
+    }
+#endif
+}
+
+
+/**
+ With `SimulProp::in_place`, the Mecables store their points in `vPTS`, at the
+ place given by their matIndex(), such that Meca can use the points directly,
+ without copying them in prepare() and apply().
+ If all Mecables are still at their place, nothing is done. Otherwise, if a
+ Mecable was created or destroyed, or if the number of points or the order of
+ the Mecables changed, all the points are copied to an array that is not used,
+ which becomes `vPTS`. The previous array is kept in `vALT` for the next time.
+ If `fresh`, `vPTS` was just allocated and is not used by any Mecable.
+ */
+void Meca::sharePoints(bool fresh)
+{
+    bool moved = false;
+    for ( Mecable const* mec : objs )
+        moved |= ( mec->data() != vPTS + DIM * mec->matIndex() );
+    
+    if ( moved )
+    {
+        if ( !fresh )
+        {
+            if ( !vALT )
+                allocate_vector(DIM * allocated_ + 4, vALT, 1);
+            std::swap(vPTS, vALT);
+        }
+        for ( Mecable * mec : objs )
+        {
+            real * ptr = vPTS + DIM * mec->matIndex();
+            mec->putPoints(ptr);
+            mec->sharePoints(ptr);
+        }
+        // the previous array was smaller than `vPTS`:
+        if ( fresh )
+        {
+            free_real(vALT);
+            vALT = nullptr;
+        }
+    }
+    sharedPoints = true;
+}
+
+
+/**
+ This is needed before `vPTS` is modified independently of the Mecables
+ */
+void Meca::ownPoints()
+{
+    for ( Mecable * mec : objs )
+        mec->ownPoints();
+    sharedPoints = false;
+}
+
+
+#if MECA_USES_OPENMP
+/**
+ The thread-private Meca have their own matrices mB and mC and vector vBAS,
+ and they use the points of this Meca, such that any function setting an
+ interaction can be called with `stage(t)`, from the thread processing range `t`.
+ This should be called after prepare(), and followed by closeStages().
+ */
+void Meca::openStages()
+{
+    while ( stages.size() + 1 < (size_t)nbThreads )
+        stages.push_back(new Meca);
+    
+    const index_t dim = dimension();
+    #pragma omp parallel for num_threads(nbThreads)
+    for ( int t = 1; t < nbThreads; ++t )
+    {
+        Meca * S = stages[t-1];
+        if ( S->allocated_ < allocated_ )
+        {
+            S->allocated_ = allocated_;
+            allocate_vector(DIM * allocated_ + 4, S->vBAS, 0);
+        }
+        zero_real(dim, S->vBAS);
+        S->mB.resize(nbPts);
+        S->mB.reset();
+        S->mC.resize(dim);
+        S->mC.clear();
+        S->nbPts = nbPts;
+        S->vPTS = vPTS;
+        S->useMatrixFree = useMatrixFree;
+        S->mLinks.clear();
+        S->drawLinks = false;
+    }
+}
+
+
+/**
+ The elements of the thread-private matrices are added in parallel, with each
+ thread processing a different range of columns, and the vectors are summed
+ up with each thread processing a different range of lines.
+ The stages are added in order, such that the result does not depend on the
+ number of threads provided by OpenMP, given the value of `nbThreads`.
+ */
+void Meca::closeStages()
+{
+    const index_t dim = dimension();
+    const int nbs = std::min((int)stages.size(), nbThreads-1);
+    
+    #pragma omp parallel num_threads(nbThreads)
+    {
+        const int T = omp_get_num_threads();
+        const int t = omp_get_thread_num();
+        index_t inf = lineSplit(nbPts, t, T);
+        index_t sup = lineSplit(nbPts, t+1, T);
+        for ( int u = 0; u < nbs; ++u )
+            mB.add(stages[u]->mB, inf, sup);
+
+        inf = lineSplit(dim, t, T);
+        sup = lineSplit(dim, t+1, T);
+        for ( int u = 0; u < nbs; ++u )
+        {
+            mC.add(stages[u]->mC, inf, sup);
+            real const* src = stages[u]->vBAS;
+            for ( index_t i = inf; i < sup; ++i )
+                vBAS[i] += src[i];
+        }
+    }
+    
+    for ( int u = 0; u < nbs; ++u )
+    {
+        Meca * S = stages[u];
+        for ( MecaLink const& L : S->mLinks )
+            mLinks.push_back(L);
+        // the points belong to this Meca:
+        S->vPTS = nullptr;
+    }
+}
+#endif
+
+
+/**
+ Prepare matrices mB and mC for multiplication
+ This should be called after setInteractions()
+ */
+void Meca::prepareMatrices()
+{
+    /*
+     Release the memory of columns that were filled by a transient burst of
+     interactions, with a margin to avoid reallocating them at every step.
+     The unused elements of mC are removed by prepareForMultiply()
+     */
+    mB.compact();
+    mB.prepareForMultiply(DIM);
+#if ( DIM == 2 )
+    // the kernels are compared again periodically, as the matrix evolves:
+    if ( matrixKernel == 4 && kernelCounter++ % 256 == 0 )
+        selectKernel();
+#endif
+    
+    if ( mC.nonZero() )
+    {
+        useMatrixC = true;
+        mC.prepareForMultiply(1);
+    }
+    else
+        useMatrixC = false;
+    mC.compact();
+
+#if MECA_USES_OPENMP
+    balanceMatrices();
+#endif
+}
+
+
+/**
+ Each kernel available is timed over a few multiplications of `mB` by `vPTS`,
+ and the fastest one is kept. This uses `vTMP`, which is free at this stage.
+ */
+void Meca::selectKernel()
+{
+    const index_t dim = dimension();
+    const int REP = 4;
+    int best = 0;
+    double best_time = INFINITY;
+    for ( int k = 1; k < 4; ++k )
+    {
+        if ( !MatrixSparseSymmetric1::hasKernel(k) )
+            continue;
+        mB.setKernel(k);
+        zero_real(dim, vTMP);
+        double time = TicToc::milliseconds();
+        for ( int n = 0; n < REP; ++n )
+            mB.vecMulAddIso2D(vPTS, vTMP, 0, nbPts);
+        time = TicToc::milliseconds() - time;
+        if ( time < best_time )
+        {
+            best_time = time;
+            best = k;
+        }
+    }
+    mB.setKernel(best);
+}
+
+
+/**
+ Calculates forces due to external links, without adding Thermal motion,
+ and also excluding bending elasticity of Fibers.
+ 
+ Mecable::getForces will also sets the Lagrange multipliers for the Fiber.
+ 
+ The function will not change the positions of any Mecable.
+ */
+void Meca::computeForces()
+{
+    prepareMatrices();
+    
+    // vFOR <- external forces
+    calculateForces(vPTS, vBAS, vFOR);
+
+    for ( Mecable * mec : objs )
+    {
+        mec->getForces(vFOR+DIM*mec->matIndex());
+    }
+}
+
+
+/**
+This preforms:
+ 
+    fff <- fff + Brownian
+    rhs <- time_step * P * fff:
+ 
+ Also prepare Projection diff is requested
+
+ 'rhs' and 'fff' are output. Input 'rnd' is a set of independent random numbers
+*/
+real brownian1(Mecable* mec, real const* rnd, real alpha, real* fff, real beta, real* rhs)
+{
+    // fff <- fff + Brownian, and rhs <- beta * P * fff, resulting in time_step * P * fff:
+    real n = mec->projectBrownianForces(rnd, alpha, fff, beta, rhs);
 
-#if NUM_THREADS > 1
     /*
-     Sorting Mecables can improve multithreaded performance by distributing
-     the work more equally between threads. Note that his operation is not free
-     and for large systems random partitionning may not be so bad. Moreover for
-     homogeneous systems (if all filaments have the same length) this is useless.
-    */
-    objs.sort(smaller_mecable);
+     At this stage, `fff` contains the external forces in each vertex but also
+     internal force such as bending elasticity terms, and the Lagrange multipliers
+     do not represent the true tension in the filaments.
+     Hence we do not call 'computeTensions(fff)' here
+     */
+
+#if ADD_PROJECTION_DIFF
+    mec->makeProjectionDiff(fff);
+#endif
+    
+    return n;
+}
+
+
+/**
+ Set the initial guess of the iterative solver in `vSOL`, using the solutions
+ obtained at the previous time steps for each Mecable:
+ - mode = 1 : the displacement of the previous step,
+ - mode = 2 : the linear extrapolation `2 * S1 - S2` from the two previous steps.
+ .
+ As Mecables are considered in random order, their location in the vectors
+ change, and the previous solutions are collected Mecable by Mecable.
+ Zero is used for Mecables that are new, or that have changed size.
+ */
+void Meca::setInitialGuess(const int mode)
+{
+    zero_real(dimension(), vSOL);
     
     /*
+     oldMatIndex() is ~0U for a Mecable that is new or has changed its number
+     of points, and the bounds are checked without adding to the index,
+     which could wrap around:
+     */
+    auto valid = [](index_t i, index_t n, index_t sup)
+    { return i != ~0U && n <= sup && i <= sup - n; };
+    
     for ( Mecable const* mec : objs )
-        std::clog << mec->reference() << " " << mec->nbPoints() << "\n";
+    {
+        const index_t nbp = mec->nbPoints();
+        const index_t i0 = mec->oldMatIndex(0);
+        if ( valid(i0, nbp, nbPtsOld[0]) )
+        {
+            const index_t bs = DIM * nbp;
+            real * sol = vSOL + DIM * mec->matIndex();
+            copy_real(bs, vOLD[0]+DIM*i0, sol);
+            const index_t i1 = mec->oldMatIndex(1);
+            if ( mode > 1 && valid(i1, nbp, nbPtsOld[1]) )
+            {
+                // sol <- 2 * sol - old
+                blas::xscal(bs, 2.0, sol, 1);
+                blas::xaxpy(bs, -1.0, vOLD[1]+DIM*i1, 1, sol, 1);
+            }
+        }
+    }
+}
+
+
+/**
+ Save the current solution for setInitialGuess(), and
+ record the index of the Mecables in the current vectors
+ */
+void Meca::keepSolution()
+{
+    const size_t dim = dimension();
+    if ( dim > allocatedOld_ )
+    {
+        allocatedOld_ = DIM * allocated_;
+        allocate_vector(allocatedOld_, vOLD[0], 0);
+        allocate_vector(allocatedOld_, vOLD[1], 0);
+        nbPtsOld[0] = 0;
+    }
+    std::swap(vOLD[0], vOLD[1]);
+    nbPtsOld[1] = nbPtsOld[0];
+    copy_real(dim, vSOL, vOLD[0]);
+    nbPtsOld[0] = nbPts;
+    
+    for ( Mecable * mec : objs )
+        mec->keepMatIndex();
+}
+
+
+/**
+ Calculate the forces `vFOR` from the positions `vPTS` and the random numbers
+ `vRND`, and the right-hand-side of the system `vRHS`:
+
+     vFOR <- M * vPTS + B + Noise
+     vRHS <- time_step * P * vFOR
+
+ The return value is the magnitude of the smallest Brownian contribution,
+ multiplied by `time_step`
+ */
+real Meca::setRightHandSide(const real alpha)
+{
+    // calculate external forces in vFOR:
+    calculateForces(vPTS, vBAS, vFOR);
+    
+#if ( DIM > 1 )
+    addAllRigidity(vPTS, vFOR);
+#endif
+ 
+    real noiseLevel = INFINITY;
+    
+    /*
+     Add Brownian contributions and calculate Minimum value of it
+      vFOR <- vFOR + Noise
+      vRHS <- P * vFOR:
      */
+#if MECA_USES_OPENMP
+    #pragma omp parallel num_threads(nbThreads)
+    {
+        real local = INFINITY;
+        const int T = omp_get_num_threads();
+        for ( int r = omp_get_thread_num(); r < nbThreads; r += T )
+        {
+            Mecable ** end = objs.begin() + splitO[r+1];
+            for ( Mecable ** mci = objs.begin() + splitO[r]; mci < end; ++mci )
+            {
+                const index_t inx = DIM * (*mci)->matIndex();
+                real n = brownian1(*mci, vRND+inx, alpha, vFOR+inx, time_step, vRHS+inx);
+                local = std::min(local, n);
+            }
+        }
+        //printf("thread %i min: %f\n", omp_get_thread_num(), local);
+    #pragma omp critical
+        noiseLevel = std::min(noiseLevel, local);
+    }
+#else
+    for ( Mecable * mec : objs )
+    {
+        const index_t inx = DIM * mec->matIndex();
+        real n = brownian1(mec, vRND+inx, alpha, vFOR+inx, time_step, vRHS+inx);
+        noiseLevel = std::min(noiseLevel, n);
+    }
 #endif
+
+    // scale minimum noise level to serve as a measure of required precision
+    return noiseLevel * time_step;
+}
+
+
+/**
+ Add the solution `vSOL` to `vPTS`, and recalculate the forces in `vFOR`
+ */
+void Meca::setSolution(const real alpha)
+{
+    //add the solution (the displacement) to update the Mecable's vertices
+    blas::add(dimension(), vSOL, vPTS);
     
     /*
-     Attributes the position in the vector/matrix to each Mecable
+     Re-calculate forces with the new coordinates, excluding bending elasticity.
+     In this way the forces returned to the fibers do not sum-up to zero, and
+     are appropriate for example to calculate the effect of force on assembly.
      */
-    index_t cnt = 0;
+    calculateForces(vPTS, vBAS, vFOR);
+    
+    // add Brownian terms:
     for ( Mecable * mec : objs )
     {
-        mec->matIndex(cnt);
-        cnt += mec->nbPoints();
+        const size_t inx = DIM * mec->matIndex();
+        mec->addBrownianForces(vRND+inx, alpha, vFOR+inx);
+        //fprintf(stderr, "\n  "); VecPrint::print(stderr, DIM*mec->nbPoints(), vFOR+inx, 2, DIM);
+    }
+
+    ready_ = 1;
+}
+
+
+/**
+ The Gaussian random numbers needed by solve() are generated by another thread,
+ while the interactions are set. The numbers are drawn from the generator of
+ the calling thread, which must not be used until solve() is called, and are
+ thus identical to those that solve() would have generated itself.
+ For small systems, the numbers are generated by solve(), as starting a
+ thread would cost more time than it saves.
+ */
+void Meca::startNoise()
+{
+    const size_t dim = dimension();
+    if ( dim > 4096 && !noise_.valid() )
+    {
+        Random * rng = localRNG;
+        real * vec = vRND;
+        noise_ = std::async(std::launch::async, [rng, vec, dim]() { rng->gauss_set(vec, dim); });
     }
-    nbPts = cnt;
-    allocate(cnt);
-    
-    //allocate the sparse matrices:
-    mB.resize(cnt);
-    mB.reset();
+}
 
-    mC.resize(DIM*cnt);
-    mC.reset();
-    
-    // reset base:
-    zero_real(DIM*cnt, vBAS);
+
+//------------------------------------------------------------------------------
+#pragma mark - Isolated Mecables
+
+
+/// index in `objs` of the Mecable containing point `p`, given that `objs` is ordered by matIndex()
+static index_t owner(Array<Mecable*> const& objs, index_t p)
+{
+    Mecable ** i = std::upper_bound(objs.begin(), objs.end(), p,
+                                    [](index_t p, Mecable const* m) { return p < m->matIndex(); });
+    return (index_t)( i - objs.begin() ) - 1;
+}
+
+
+/**
+ A Mecable is isolated if the matrices have no term linking it to another Mecable,
+ and if it is not involved in any MecaLink. Since only the lower triangle of the
+ matrices is stored, the lines of the elements in the columns of each Mecable are
+ compared to its range of points, and both Mecables are marked if this is outside.
+ The result is recorded with Mecable::isolated(), to be used at the next step.
+ */
+bool Meca::findIsolated()
+{
+    const index_t cnt = objs.size();
+    for ( Mecable * mec : objs )
+        mec->isolated(true);
     
-#if NUM_THREADS > 1
-    #pragma omp parallel num_threads(NUM_THREADS)
+    for ( Mecable * mec : objs )
     {
-        Mecable ** mci = objs.begin() + omp_get_thread_num();
-        while ( mci < objs.end() )
+        const index_t inf = mec->matIndex();
+        const index_t sup = inf + mec->nbPoints();
+        for ( index_t j = inf; j < sup; ++j )
+        {
+            // the lines of mB are in increasing order:
+            for ( size_t n = mB.columnSize(j); n-- > 0; )
+            {
+                const index_t i = mB.columnLine(j, n);
+                if ( i < sup )
+                    break;
+                mec->isolated(false);
+                objs[owner(objs, i)]->isolated(false);
+            }
+        }
+        if ( useMatrixC )
         {
-            Mecable * mec = *mci;
-            mec->putPoints(vPTS+DIM*mec->matIndex());
-            mec->prepareMecable();
-            mec->useBlock(0);
-            mci += NUM_THREADS;
+            for ( index_t j = DIM*inf; j < DIM*sup; ++j )
+            {
+                for ( size_t n = 0; n < mC.columnSize(j); ++n )
+                {
+                    const index_t i = mC.columnLine(j, n);
+                    if ( i >= DIM*sup )
+                    {
+                        mec->isolated(false);
+                        objs[owner(objs, i/DIM)]->isolated(false);
+                    }
+                }
+            }
         }
     }
-#else
-    for ( Mecable * mec : objs )
+    
+    // a MecaLink always couples two different Mecables:
+    for ( MecaLink const& L : mLinks )
     {
-        mec->putPoints(vPTS+DIM*mec->matIndex());
-        mec->prepareMecable();
-        mec->useBlock(0);
+        objs[owner(objs, L.inx[0])]->isolated(false);
+        objs[owner(objs, L.inx[2])]->isolated(false);
     }
-#endif
+    
+    bool res = ( isoObjs < cnt );
+    for ( index_t k = isoObjs; k < cnt; ++k )
+        res &= objs[k]->isolated();
+    return res;
 }
 
 
 /**
- Prepare matrices mB and mC for multiplication
- This should be called after setInteractions()
+ Set the solution of an isolated Mecable, using the LU factorization of its
+ diagonal block, which is exact in this case. Returns 1 if the factorization failed.
  */
-void Meca::prepareMatrices()
+int Meca::solveBlock(Mecable* mec, real* wrk)
 {
-    mB.prepareForMultiply(DIM);
-    
-    if ( mC.nonZero() )
+    computePreconditionner(mec, wrk);
+    if ( !mec->useBlock() )
     {
-        useMatrixC = true;
-        mC.prepareForMultiply(1);
+        mec->isolated(false);
+        return 1;
     }
-    else
-        useMatrixC = false;
+    real * sol = vSOL + DIM * mec->matIndex();
+    copy_real(DIM * mec->nbPoints(), vRHS + DIM * mec->matIndex(), sol);
+    applyBlock(mec, sol);
+    return 0;
 }
 
 
 /**
- Calculates forces due to external links, without adding Thermal motion,
- and also excluding bending elasticity of Fibers.
- 
- Mecable::getForces will also sets the Lagrange multipliers for the Fiber.
- 
- The function will not change the positions of any Mecable.
+ If the Mecables objs[ isoObjs ... ] are not coupled to the rest of the system,
+ their part of the solution is obtained directly from the factorization of their
+ diagonal block. They are then excluded from the system, by reducing `nbPts`
+ and the list of Mecables, such that the iterative solver only handles the
+ Mecables that are coupled. These Mecables are at the end of the vectors,
+ since they were placed there by prepare().
+ If any of these Mecables is coupled, nothing is excluded and `isoSolved = 0`.
  */
-void Meca::computeForces()
+void Meca::solveIsolated()
 {
-    prepareMatrices();
+    isoSolved = 0;
+    if ( MECABLE_FLOAT_BLOCK || !findIsolated() )
+        return;
     
-    // vFOR <- external forces
-    calculateForces(vPTS, vBAS, vFOR);
-
-    for ( Mecable * mec : objs )
+    const index_t cnt = objs.size();
+    const size_t bs = DIM * largestMecable();
+    temporary.allocate(bs*(bs+bs/2+2), nbThreads);
+    int fail = 0;
+    
+#if MECA_USES_OPENMP
+    #pragma omp parallel num_threads(nbThreads) reduction(+:fail)
     {
-        mec->getForces(vFOR+DIM*mec->matIndex());
+        const int T = omp_get_num_threads();
+        real * wrk = temporary.bind(omp_get_thread_num());
+        for ( int r = omp_get_thread_num(); r < nbThreads; r += T )
+        {
+            const index_t end = splitO[r+1];
+            for ( index_t k = std::max(splitO[r], isoObjs); k < end; ++k )
+                fail += solveBlock(objs[k], wrk);
+        }
     }
+#else
+    real * wrk = temporary.bind(0);
+    for ( index_t k = isoObjs; k < cnt; ++k )
+        fail += solveBlock(objs[k], wrk);
+#endif
+    
+    if ( fail )
+        return;
+
+    isoSolved = cnt - isoObjs;
+    isoPts = nbPts;
+    nbPts = objs[isoObjs]->matIndex();
+    objs.truncate(isoObjs);
+#if MECA_USES_OPENMP
+    balanceMecables();
+    balanceMatrices();
+#endif
 }
 
 
 /**
-This preforms:
- 
-    fff <- fff + Brownian
-    rhs <- time_step * P * fff:
- 
- Also prepare Projection diff is requested
-
- 'rhs' and 'fff' are output. Input 'rnd' is a set of independent random numbers
-*/
-real brownian1(Mecable* mec, real const* rnd, real alpha, real* fff, real beta, real* rhs)
+ This must be called after solveIsolated() excluded some Mecables,
+ before the solution is used
+ */
+void Meca::restoreIsolated()
 {
-    real n = mec->addBrownianForces(rnd, alpha, fff);
-    
-    // Calculate the right-hand-side of the system in vRHS:
-    mec->projectForces(fff, rhs);
-    
-    // rhs <- beta * rhs, resulting in time_step * P * fff:
-    blas::xscal(DIM*mec->nbPoints(), beta*mec->leftoverMobility(), rhs, 1);
-
-    /*
-     At this stage, `fff` contains the external forces in each vertex but also
-     internal force such as bending elasticity terms, and the Lagrange multipliers
-     do not represent the true tension in the filaments.
-     Hence we do not call 'computeTensions(fff)' here
-     */
-
-#if ADD_PROJECTION_DIFF
-    mec->makeProjectionDiff(fff);
+    objs.resize(isoObjs + isoSolved);
+    nbPts = isoPts;
+#if MECA_USES_OPENMP
+    balanceMecables();
+    balanceMatrices();
 #endif
-    
-    return n;
 }
 
 
+
 /**
  This solves the equation:
  
@@ -957,21 +2486,15 @@ void Meca::solve(SimulProp const* prop, const int precond)
 
     prepareMatrices();
     
-    // calculate external forces in vFOR:
-    calculateForces(vPTS, vBAS, vFOR);
-    
-#if ( DIM > 1 )
-    addAllRigidity(vPTS, vFOR);
-#endif
- 
     /* 
-     Fill `vRND` with Gaussian random numbers 
-     This operation can be done in parallel, in a separate thread
+     Fill `vRND` with Gaussian random numbers, here or in a separate thread
      */
-    RNG.gauss_set(vRND, dimension());
+    if ( noise_.valid() )
+        noise_.get();
+    else
+        RNG.gauss_set(vRND, dimension());
     
     /*
-     Add Brownian motions to 'vFOR', and calculate vRHS by multiplying by mobilities.
      As Brownian terms are added, we record the magnitude of the typical smallest
      scalar contribution in `noiseLevel`. The dynamics will later be solved with 
      a residual that is proportional to this level:
@@ -980,42 +2503,8 @@ void Meca::solve(SimulProp const* prop, const int precond)
      level of numerical error is small with respect to the Brownian noise in
      the system, and the results should be physically appropriate.
      */
-    
-    real noiseLevel = INFINITY;
     const real alpha = prop->kT/time_step;
-    
-    /*
-     Add Brownian contributions and calculate Minimum value of it
-      vFOR <- vFOR + Noise
-      vRHS <- P * vFOR:
-     */
-#if NUM_THREADS > 1
-    #pragma omp parallel num_threads(NUM_THREADS)
-    {
-        real local = INFINITY;
-        Mecable ** mci = objs.begin() + omp_get_thread_num();
-        while ( mci < objs.end() )
-        {
-            const index_t inx = DIM * (*mci)->matIndex();
-            real n = brownian1(*mci, vRND+inx, alpha, vFOR+inx, time_step, vRHS+inx);
-            local = std::min(local, n);
-            mci += NUM_THREADS;
-        }
-        //printf("thread %i min: %f\n", omp_get_thread_num(), local);
-    #pragma omp critical
-        noiseLevel = std::min(noiseLevel, local);
-    }
-#else
-    for ( Mecable * mec : objs )
-    {
-        const index_t inx = DIM * mec->matIndex();
-        real n = brownian1(mec, vRND+inx, alpha, vFOR+inx, time_step, vRHS+inx);
-        noiseLevel = std::min(noiseLevel, n);
-    }
-#endif
-
-    // scale minimum noise level to serve as a measure of required precision
-    noiseLevel *= time_step;
+    real noiseLevel = setRightHandSide(alpha);
     
     //printf("noiseLeveld = %8.2e   variance(vRHS) / estimate = %8.4f\n",
     //       noiseLevel, blas::nrm2(dimension(), vRHS) / (noiseLevel * sqrt(dimension())) );
@@ -1053,12 +2542,25 @@ void Meca::solve(SimulProp const* prop, const int precond)
      Choose the initial guess for the solution of the system (Xnew - Xold):
      we could use the solution at the previous step, or a vector of zeros.
      Using the previous solution could be advantageous if the speed were 
-     somehow continuous. However, the system is without inertia. In addition,
-     objects are considered in a random order to build the linear system, such
-     that the blocks from two consecutive iterations do not match.
-     From this, using zero for the initial guess seems safer:
+     somehow continuous. However, the system is without inertia, and the
+     Brownian terms are not correlated between time steps.
+     Using zero for the initial guess seems safer, and is the default,
+     but the solutions of previous steps can be used with `simul:initial_guess`.
+     Since objects are considered in a random order to build the linear system,
+     the previous solutions are reordered by setInitialGuess()
      */
-    zero_real(dimension(), vSOL);
+    if ( prop->initial_guess > 0 )
+        setInitialGuess(prop->initial_guess);
+    else
+        zero_real(dimension(), vSOL);
+
+    /*
+     With `simul:isolate`, the Mecables that are not coupled to other Mecables
+     are solved directly, and excluded from the system solved iteratively
+     */
+    isoSolved = 0;
+    if ( useIsolate )
+        solveIsolated();
 
     /*
      We now solve the system MAT * vSOL = vRHS  by an iterative method:
@@ -1086,13 +2588,18 @@ void Meca::solve(SimulProp const* prop, const int precond)
 
     //------- call the iterative solver:
 
+    double cpu = TicToc::milliseconds();
     if ( precond )
     {
-        computePreconditionner();
+        computePreconditionner(precond);
+        solverTime[0] = TicToc::milliseconds() - cpu;
         LinearSolvers::BCGSP(*this, vRHS, vSOL, monitor, allocator);
     }
     else
+    {
+        solverTime[0] = 0;
         LinearSolvers::BCGS(*this, vRHS, vSOL, monitor, allocator);
+    }
 
 #if ( 0 )
     fprintf(stderr, "System size %6i precondition %i", dimension(), precond);
@@ -1151,7 +2658,7 @@ void Meca::solve(SimulProp const* prop, const int precond)
             else
             {
                 // try with a preconditioner
-                computePreconditionner();
+                computePreconditionner(1);
                 LinearSolvers::GMRES(*this, vRHS, vSOL, 127, monitor, allocator, mH, mV, temporary);
                 Cytosim::out("    GMRES: count %4u residual %.2e\n", monitor.count(), monitor.residual());
                 if ( !monitor.converged() )
@@ -1174,6 +2681,8 @@ void Meca::solve(SimulProp const* prop, const int precond)
             
             if ( !monitor.converged() )
             {
+                if ( isoSolved )
+                    restoreIsolated();
                 // if the solver did not converge, its result cannot be used!
                 throw Exception("no convergence after ",monitor.count()," iterations, residual ",monitor.residual());
             }
@@ -1194,25 +2703,18 @@ void Meca::solve(SimulProp const* prop, const int precond)
     
 #endif
     
-    //add the solution (the displacement) to update the Mecable's vertices
-    blas::add(dimension(), vSOL, vPTS);
-    
-    /*
-     Re-calculate forces with the new coordinates, excluding bending elasticity.
-     In this way the forces returned to the fibers do not sum-up to zero, and
-     are appropriate for example to calculate the effect of force on assembly.
-     */
-    calculateForces(vPTS, vBAS, vFOR);
+    if ( isoSolved )
+        restoreIsolated();
     
-    // add Brownian terms:
-    for ( Mecable * mec : objs )
-    {
-        const size_t inx = DIM * mec->matIndex();
-        mec->addBrownianForces(vRND+inx, alpha, vFOR+inx);
-        //fprintf(stderr, "\n  "); VecPrint::print(stderr, DIM*mec->nbPoints(), vFOR+inx, 2, DIM);
-    }
+    solverTime[1] = TicToc::milliseconds() - cpu - solverTime[0];
+    solverCount = monitor.count();
+    solverResidual = monitor.residual();
+    solverNoise = noiseLevel;
 
-    ready_ = 1;
+    if ( prop->initial_guess > 0 )
+        keepSolution();
+    
+    setSolution(alpha);
     
     // report on the matrix type and size, sparsity, and the number of iterations
     if ( prop->verbose )
@@ -1222,7 +2724,17 @@ void Meca::solve(SimulProp const* prop, const int precond)
         oss << " brick " << largestMecable();
         oss << " " << mB.what();
         if ( useMatrixC ) oss << " " << mC.what();
+        if ( useMatrixFree ) oss << " links " << mLinks.size();
+        if ( isoSolved ) oss << " isolated " << isoSolved;
         oss << " precond " << precond;
+        if ( precond == 3 )
+            oss << " reuse " << nbReusedBlocks() << "/" << objs.size();
+        if ( coarseDim > 0 )
+            oss << " coarse " << coarseDim;
+        if ( directDim > 0 )
+            oss << " direct " << directDim;
+        if ( prop->initial_guess > 0 )
+            oss << " guess " << prop->initial_guess;
         oss << " count " << monitor.count();
         //oss << " flag " << monitor.flag();
         oss << " residual " << monitor.residual() << "\n";
@@ -1233,27 +2745,125 @@ void Meca::solve(SimulProp const* prop, const int precond)
 }
 
 
+/**
+ This prepares an inexact Newton correction of the last solution, for systems
+ in which some interactions are nonlinear (eg. addLongLink, addSideLink).
+ These interactions were linearized at the initial positions `Xold`, and
+ the solution can be improved by linearizing them again around `Xnew`.
+
+ The Mecables are moved to `Xnew` temporarily, the matrices are cleared,
+ and `vPTS` is reset to `Xold`. The caller should then recalculate the
+ interactions with `Simul::setAllInteractions()`, and call correct().
+ The positions of the Mecables are finally set by apply() as usual.
+ */
+void Meca::relinearize()
+{
+    assert_true(ready_);
+    if ( sharedPoints )
+        ownPoints();
+    for ( Mecable * mec : objs )
+        mec->getPoints(vPTS+DIM*mec->matIndex());
+
+    // restore the initial positions:
+    blas::xaxpy(dimension(), -1.0, vSOL, 1, vPTS, 1);
+
+    mB.reset();
+    mC.reset();
+    mLinks.clear();
+    zero_real(dimension(), vBAS);
+    ready_ = 0;
+}
+
+
+/**
+ Solve the system again with the new linearization of the interactions,
+ using the same Brownian terms `vRND`, the previous solution as initial guess,
+ and the preconditioner calculated by the last call to solve(), which is not
+ updated. This is an inexact Newton iteration with a frozen Jacobian.
+ 
+ Returns true if the solution changed by more than the tolerance of the solver,
+ such that another correction may be useful.
+ */
+bool Meca::correct(SimulProp const* prop, const int precond)
+{
+    assert_true(ready_==0);
+    const size_t dim = dimension();
+    const real alpha = prop->kT/time_step;
+
+    prepareMatrices();
+    real noiseLevel = setRightHandSide(alpha);
+    
+    real abstol = noiseLevel * prop->tolerance;
+    if ( prop->kT == 0 )
+        abstol = prop->tolerance;
+
+    // keep the previous solution:
+    real * old = new_real(dim);
+    copy_real(dim, vSOL, old);
+
+    // the coarse or direct preconditionners were set without the isolated Mecables:
+    if ( isoSolved && ( coarseDim || directDim ))
+        computePreconditionner(precond);
+
+    LinearSolvers::Monitor monitor(2*dim, abstol);
+    if ( precond )
+        LinearSolvers::BCGSP(*this, vRHS, vSOL, monitor, allocator);
+    else
+        LinearSolvers::BCGS(*this, vRHS, vSOL, monitor, allocator);
+
+    real delta = 0;
+    if ( monitor.converged() )
+    {
+        for ( size_t i = 0; i < dim; ++i )
+            delta = std::max(delta, abs_real(vSOL[i]-old[i]));
+    }
+    else
+    {
+        // revert to the previous solution, which was converged:
+        Cytosim::out("Newton correction failed: count %4u residual %.2e\n", monitor.count(), monitor.residual());
+        copy_real(dim, old, vSOL);
+    }
+    free_real(old);
+
+    solverCount += monitor.count();
+    setSolution(alpha);
+    
+    if ( prop->verbose )
+        Cytosim::out("Meca newton count %u residual %.3e correction %.3e\n", monitor.count(), monitor.residual(), delta);
+
+    return delta > abstol;
+}
+
+
 // transfer newly calculated point coordinates back to Mecables
 void Meca::apply()
 {
     if ( ready_ )
     {
-#if NUM_THREADS > 1
-#pragma omp parallel num_threads(NUM_THREADS)
+        sharedPoints |= useInPlace;
+#if MECA_USES_OPENMP
+        #pragma omp parallel num_threads(nbThreads)
         {
-            Mecable ** mci = objs.begin() + omp_get_thread_num();
-            while ( mci < objs.end() )
+            const int T = omp_get_num_threads();
+            for ( int r = omp_get_thread_num(); r < nbThreads; r += T )
             {
-                Mecable * mec = *mci;
-                mec->getForces(vFOR+DIM*mec->matIndex());
-                mec->getPoints(vPTS+DIM*mec->matIndex());
-                mci += NUM_THREADS;
+                Mecable ** end = objs.begin() + splitO[r+1];
+                for ( Mecable ** mci = objs.begin() + splitO[r]; mci < end; ++mci )
+                {
+                    Mecable * mec = *mci;
+                    if ( useInPlace )
+                        mec->sharePoints(vPTS+DIM*mec->matIndex());
+                    mec->getForces(vFOR+DIM*mec->matIndex());
+                    mec->getPoints(vPTS+DIM*mec->matIndex());
+                }
             }
         }
 #else
         for ( Mecable * mec : objs )
         {
             size_t off = DIM * mec->matIndex();
+            if ( useInPlace )
+                mec->sharePoints(vPTS+off);
             mec->getPoints(vPTS+off);
             mec->getForces(vFOR+off);
         }
@@ -1271,6 +2881,42 @@ void Meca::apply()
 #pragma mark - Debug/Output Functions
 
 
+/**
+ Print on one line:
+ dimension, elements in mB and mC, preconditionning method,
+ iterations, residual, noise level and time spent in solve()
+ */
+void Meca::writeStatistics(FILE* file, int precond) const
+{
+    fprintf(file, " %8lu %9lu %9lu %1i", dimension(), mB.nbElements(), useMatrixC?mC.nbElements():0, precond);
+    fprintf(file, " %5u %10.3e %10.3e", solverCount, solverResidual, solverNoise);
+    fprintf(file, " %9.3f %9.3f", solverTime[0], solverTime[1]);
+}
+
+
+/**
+ The memory of the blocks used for preconditionning, which belongs to the
+ Mecables, is not included in `pre`.
+ */
+void Meca::memory(size_t& vec, size_t& matB, size_t& matC, size_t& pre) const
+{
+    // vPTS, vSOL, vBAS, vRND, vRHS, vFOR, vTMP and vCOR:
+    size_t cnt = 8 * ( DIM * allocated_ + 4 );
+    if ( vALT )
+        cnt += DIM * allocated_ + 4;
+    cnt += 2 * allocatedOld_;
+#if MECA_USES_OPENMP
+    if ( vMEM )
+        cnt += strideMEM * ( allocatedThreads - 1 );
+#endif
+    vec = cnt * sizeof(real) + allocator.memory() + temporary.memory();
+    matB = mB.memory();
+    matC = mC.memory();
+    pre  = ( coarseAllocated * ( coarseAllocated + 1 )) * sizeof(real) + coarseAllocated * sizeof(int);
+    pre += directAllocated * directAllocated * sizeof(real) + directAllocated * sizeof(int);
+}
+
+
 /**
  Count number of non-zero entries in the entire system
  */
@@ -1375,6 +3021,38 @@ void Meca::saveRHS(FILE * file) const
 }
 
 
+/**
+ Save the lower triangle of `mB`, of size nbPoints(), in Matrix Market format.
+ This matrix is applied isotropically in each dimension, and can be read by
+ `test_sparse` to compare the implementations of the sparse matrices.
+ */
+void Meca::saveElasticity(FILE * file) const
+{
+    fprintf(file, "%%%%MatrixMarket matrix coordinate real symmetric\n");
+    fprintf(file, "%% This is the isotropic matrix of a system produced by Cytosim\n");
+    fprintf(file, "%% dimension %i\n", DIM);
+
+    size_t cnt = 0;
+    for ( index_t j = 0; j < nbPts; ++j )
+        for ( size_t n = 0; n < mB.columnSize(j); ++n )
+        {
+            real * v = mB.addr(mB.columnLine(j, n), j);
+            cnt += ( v && *v != 0 );
+        }
+    fprintf(file, "%u %u %lu\n", nbPts, nbPts, cnt);
+    
+    // indices start at 0, as in saveMatrix():
+    for ( index_t j = 0; j < nbPts; ++j )
+        for ( size_t n = 0; n < mB.columnSize(j); ++n )
+        {
+            index_t i = mB.columnLine(j, n);
+            real * v = mB.addr(i, j);
+            if ( v && *v != 0 )
+                fprintf(file, "%u %u %.15g\n", i, j, *v);
+        }
+}
+
+
 void Meca::saveSystem(const char dirname[]) const
 {
     std::string cwd = FilePath::get_cwd();
@@ -1391,6 +3069,12 @@ void Meca::saveSystem(const char dirname[]) const
         saveRHS(f);
         fclose(f);
     }
+    f = fopen("elasticity.mtx", "w");
+    if ( f && ~ferror(f) )
+    {
+        saveElasticity(f);
+        fclose(f);
+    }
     fprintf(stderr, "Cytosim saved its matrix in `%s'\n", dirname);
     FilePath::change_dir(cwd);
 }
@@ -1522,6 +3206,45 @@ void Meca::dumpPreconditionner(FILE * file) const
 }
 
 
+/**
+ The solutions of the two previous time steps are written as raw values,
+ preceded by a line "#meca N0 N1" giving the number of points of each.
+ These values are needed to resume a simulation using `simul:initial_guess`.
+ */
+void Meca::writeGuess(Outputter& out) const
+{
+    index_t n0 = vOLD[0] ? nbPtsOld[0] : 0;
+    index_t n1 = vOLD[1] ? nbPtsOld[1] : 0;
+    fprintf(out, "#meca %u %u %zu\n", n0, n1, reorderCounter);
+    if ( n0 && DIM*n0 != fwrite(vOLD[0], sizeof(real), DIM*n0, out) )
+        throw InvalidIO("failed to write Meca solution");
+    if ( n1 && DIM*n1 != fwrite(vOLD[1], sizeof(real), DIM*n1, out) )
+        throw InvalidIO("failed to write Meca solution");
+}
+
+
+void Meca::readGuess(Inputter& in)
+{
+    unsigned n0 = 0, n1 = 0;
+    std::string line = in.get_line();
+    if ( 3 != sscanf(line.c_str(), "#meca %u %u %zu", &n0, &n1, &reorderCounter) )
+        throw InvalidIO("missing Meca solution");
+    size_t alc = DIM * std::max(std::max(n0, n1), (unsigned)allocated_);
+    if ( alc > allocatedOld_ )
+    {
+        allocatedOld_ = alc;
+        allocate_vector(allocatedOld_, vOLD[0], 0);
+        allocate_vector(allocatedOld_, vOLD[1], 0);
+    }
+    if ( sizeof(real)*DIM*n0 != in.read(vOLD[0], sizeof(real)*DIM*n0) )
+        throw InvalidIO("failed to read Meca solution");
+    if ( sizeof(real)*DIM*n1 != in.read(vOLD[1], sizeof(real)*DIM*n1) )
+        throw InvalidIO("failed to read Meca solution");
+    nbPtsOld[0] = n0;
+    nbPtsOld[1] = n1;
+}
+
+
 void Meca::dumpObjectID(FILE * file) const
 {
     real * vec = new_real(largestMecable());
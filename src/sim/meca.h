@@ -11,6 +11,7 @@
 #include "matsparsesym1.h"
 #include "matsparsesymblk.h"
 #include "allocator.h"
+#include <future>
 
 
 class Mecable;
@@ -19,6 +20,8 @@ class Interpolation;
 class SimulProp;
 class Modulo;
 class Simul;
+class Inputter;
+class Outputter;
 
 /// MatrixBlock is an alias to a matrix class of size DIM * DIM
 class Matrix11;
@@ -41,6 +44,18 @@ typedef Matrix33 MatrixBlock;
 #define DRAW_MECA_LINKS 0
 
 
+/**
+ Multithreaded code is compiled if OpenMP is enabled, which requires a specific
+ flag for the compiler. Adjust the makefile.inc: CXXFLG := -std=gnu++14 -fopenmp
+ The number of threads is then set at run time by `simul:threads`
+ */
+#ifdef _OPENMP
+#   define MECA_USES_OPENMP 1
+#else
+#   define MECA_USES_OPENMP 0
+#endif
+
+
 /// A class to calculate the motion of objects in Cytosim
 /**
 Meca solves the motion of objects defined by points (i.e. Mecable),
@@ -77,6 +92,10 @@ The equation is formulated using linear-algebra:
  
  - Matrix mC is the non-isotropic part obtained after linearization of the forces.
    mC is square of size DIM*nbPoints(), symmetric and sparse.
+ 
+ - With `simul:matrix_free`, the terms of addLink(Interpolation, Interpolation)
+   that couple two different Mecables do not go into mB, but are recorded in a
+   list of MecaLink, which is applied directly by calculateForces().
  .
  
  Typically, mB and mC will inherit the stiffness coefficients of the interactions, 
@@ -107,6 +126,15 @@ The equation is formulated using linear-algebra:
 
  */
 
+/// a zero-resting length link between two Interpolations, applied without matrix
+struct MecaLink
+{
+    index_t inx[4];  ///< matrix indices of the vertices
+    real    cof[4];  ///< interpolation coefficients, negative for the second point
+    real    weight;  ///< stiffness of the link
+};
+
+
 class Meca
 {
 public:
@@ -142,6 +170,20 @@ private:
     real*  vFOR;         ///< the calculated forces, with Brownian components
     real*  vTMP;         ///< intermediate of calculus
     real*  vMEM;         ///< another temporary array
+    real*  vCOR;         ///< temporary array used by the coarse correction
+    real*  vALT;         ///< alternative array of coordinates, if useInPlace == true
+    
+    /// solutions obtained at the two previous calls to solve()
+    real*  vOLD[2];
+    
+    /// task filling `vRND` in the background, started by startNoise()
+    std::future<void> noise_;
+    
+    /// number of points in vOLD[]
+    index_t nbPtsOld[2];
+    
+    /// size allocated for vOLD[]
+    size_t allocatedOld_;
     
     //--------------------------------------------------------------------------
 
@@ -156,6 +198,156 @@ private:
     
     /// true if the matrix mC is non-zero
     bool   useMatrixC;
+    
+    /// if true, links between Mecables are recorded in `mLinks` instead of `mB`
+    bool   useMatrixFree;
+    
+    /// links that are applied without matrix, if useMatrixFree == true
+    Array<MecaLink> mLinks;
+    
+    /// kernel used to multiply `mB` in 2D, or 4 to select it automatically
+    int    matrixKernel;
+    
+    /// number of calls to prepareMatrices() since the kernel was last selected
+    unsigned kernelCounter;
+    
+    /// select the fastest kernel to multiply `mB`, by timing each of them
+    void   selectKernel();
+    
+    /// if true, the Mecables store their points directly in `vPTS`
+    bool   useInPlace;
+    
+    /// true if the Mecables may be using `vPTS` or `vALT` to store their points
+    bool   sharedPoints;
+    
+    /// copy the points of the Mecables to `vPTS` if needed, and let them use it
+    void   sharePoints(bool fresh);
+    
+    /// give the Mecables their own memory to store their points
+    void   ownPoints();
+    
+    /// number of calls to prepare(), used to reorder the Mecables periodically
+    size_t reorderCounter;
+    
+    /// sort the Mecables along a Morton curve, and set Mecable::orderKey() to their rank
+    void   setOrderKeys();
+    
+    /// number of Mecables ranked by the last call to setOrderKeys()
+    size_t nbRanked;
+    
+    /// place the Mecables in the order of their ranks, followed by the new Mecables
+    void   restoreOrder();
+    
+    /// temporary list of Mecables used by restoreOrder()
+    Array<Mecable*> ranked;
+
+    /// if true, the Mecables that are not coupled to other Mecables are solved directly
+    bool   useIsolate;
+    
+    /// the Mecables that were isolated at the previous step are objs[ isoObjs ... ]
+    index_t isoObjs;
+    
+    /// number of Mecables that were solved directly in the last solve()
+    index_t isoSolved;
+    
+    /// total number of points, while the isolated Mecables are excluded from the system
+    index_t isoPts;
+    
+    /// set Mecable::isolated(), and return true if objs[ isoObjs ... ] are all isolated
+    bool   findIsolated();
+    
+    /// set the solution of an isolated Mecable directly, returning 1 if this failed
+    int    solveBlock(Mecable*, real* tmp);
+    
+    /// solve the system for objs[ isoObjs ... ], and exclude them from the system
+    void   solveIsolated();
+    
+    /// include the Mecables excluded by solveIsolated() in the system again
+    void   restoreIsolated();
+
+    /// number of threads used in the parallel sections
+    int    nbThreads;
+    
+    /// number of iterations and residual achieved in the last solve()
+    unsigned solverCount;
+    real     solverResidual;
+    
+    /// level of Brownian noise estimated in the last solve()
+    real     solverNoise;
+    
+    /// CPU time (milliseconds) spent in computing the preconditionner and in the iterations
+    double   solverTime[2];
+
+    //--------------------------------------------------------------------------
+    // Coarse correction of the preconditionner (precondition = 4)
+    
+    /// size of the coarse system ( DIM * number of Mecables ), or 0 if not used
+    index_t  coarseDim;
+    
+    /// memory allocated for mCoarse[]
+    size_t   coarseAllocated;
+    
+    /// LU factorization of the coarse system, acting on translations of the Mecables
+    real *   mCoarse;
+    
+    /// vector of size coarseDim
+    real *   vCoarse;
+    
+    /// pivots associated with mCoarse[]
+    int  *   coarsePivot;
+    
+    /// index of the Mecable to which each vertex belongs
+    Array<index_t> coarseMap;
+    
+    //--------------------------------------------------------------------------
+    // Direct factorization of the system (precondition = 5)
+    
+    /// size of the factorized system, or 0 if not used
+    index_t  directDim;
+    
+    /// memory allocated for mDirect[]
+    size_t   directAllocated;
+    
+    /// LU factorization of the full matrix of the system
+    real *   mDirect;
+    
+    /// pivots associated with mDirect[]
+    int  *   directPivot;
+
+#if MECA_USES_OPENMP
+    /// number of thread-private accumulators allocated in vMEM
+    int    allocatedThreads;
+    
+    /// distance between the thread-private accumulators stored in vMEM
+    size_t  strideMEM;
+    
+    /// columns of mB assigned to range 't' are [ splitB[t], splitB[t+1] [
+    Array<index_t> splitB;
+    
+    /// columns of mC assigned to range 't' are [ splitC[t], splitC[t+1] [
+    Array<index_t> splitC;
+    
+    /// Mecables assigned to range 't' are objs[ splitO[t] ... splitO[t+1]-1 ]
+    Array<index_t> splitO;
+    
+    /// number of threads that were pinned to a CPU
+    int    pinnedThreads;
+    
+    /// thread-private Meca in which range `t` sets its interactions, for t > 0
+    Array<Meca*> stages;
+    
+    /// first line of range `t` among `T`, for a vector of size `dim`
+    static index_t lineSplit(index_t dim, int t, int T)
+    {
+        return std::min(dim, (index_t)chunk_real(dim * (size_t)t / T));
+    }
+    
+    /// divide the Mecables in ranges matching the ranges of lines
+    void balanceMecables();
+
+    /// distribute the columns of the matrices equally between threads
+    void balanceMatrices();
+#endif
 
 public:
 
@@ -246,23 +438,53 @@ public:
     /// add block 'alpha*T' to mC at position (i, j)
     void add_block(index_t i, index_t j, real alpha, MatrixBlock const& T);
 
+    /// add to mB the terms of a zero-resting length link between `N` weighted points
+    template < size_t N >
+    void addLinkTerms(const index_t inx[N], const real coef[N], const real ww[N]);
+    
+    /// add to vBAS the periodic correction of a link between `N` weighted points
+    template < size_t N >
+    void addLinkOffset(const index_t inx[N], const real coef[N], const real ww[N]);
+    
+    /// linear force of stiffness `weight` between `N` points with coefficients summing to zero
+    template < size_t N >
+    void addLinkN(const index_t inx[N], const real coef[N], real weight);
+
 private:
     
     /// allocate memory
     void allocate(size_t);
     
+    /// set number of threads used in parallel sections
+    void setThreads(int);
+    
     /// release memory
     void release();
     
     /// prepare matrices for 'solve'
     void prepareMatrices();
+    
+    /// set initial guess in vSOL, using the solutions of the previous steps
+    void setInitialGuess(int mode);
+    
+    /// record vSOL to be used as initial guess in the next steps
+    void keepSolution();
 
     /// calculate the linear part of forces:  Y <- B + ( mB + mC ) * X
     void calculateForces(const real* X, const real* B, real* Y) const;
     
     /// add forces due to bending elasticity
     void addAllRigidity(const real* X, real* Y) const;
+    
+    /// calculate vFOR and vRHS, returning the level of Brownian noise
+    real setRightHandSide(real alpha);
+    
+    /// add vSOL to vPTS and calculate final forces
+    void setSolution(real alpha);
 
+    /// compute the stiffness block ( Rigidity + mB + mC ) corresponding to a Mecable
+    void getStiffnessBlock(real* res, const Mecable*) const;
+    
     /// compute the matrix diagonal block corresponding to a Mecable
     void getBlock(real* res, const Mecable*) const;
     
@@ -276,10 +498,40 @@ private:
     void checkBlock(const Mecable*, const real*);
     
     /// compute the preconditionner block corresponding to given Mecable
-    void computePreconditionner(Mecable*);
+    void computePreconditionner(Mecable*, real* tmp);
+    
+    /// calculate LU factorization of the block given in `tmp`, and save it in the Mecable
+    void factorizeBlock(Mecable*, real* tmp);
+    
+    /// update the preconditionner block of given Mecable, if its matrix block has changed
+    void renewPreconditionner(Mecable*, real* tmp);
     
-    /// compute all blocks of the preconditionner (method=1)
-    void computePreconditionner();
+    /// compute the preconditionner block of given Mecable, as a band matrix if possible
+    void computeBandedPreconditionner(Mecable*, real* tmp);
+    
+    /// compute the preconditionner block of a rigid Mecable, in its generalized coordinates
+    void computeRigidPreconditionner(Mecable*, real* tmp);
+
+    /// compute all blocks of the preconditionner (method = 1, 2, 3, 4 or 5)
+    void computePreconditionner(int method);
+    
+    /// build and factorize the coarse system for precondition = 4
+    void computeCoarseCorrection();
+    
+    /// build and factorize the full matrix of the system for precondition = 5
+    bool computeDirectFactorization();
+    
+    /// apply the coarse correction: Y <- Prolongation * inverse(Coarse) * Restriction * X
+    void coarseCorrection(const real* X, real* Y) const;
+
+    /// add the contributions of `mLinks`: F <- F + Links * X
+    void addLinkForces(const real* X, real* F) const;
+    
+    /// add the contributions of `mLinks` to the coarse matrix
+    void addLinkAggregated(real* mat, unsigned ldd) const;
+    
+    /// apply the block preconditionner: Y <- P*X
+    void blockPrecondition(const real* X, real* Y) const;
 
 public:
     
@@ -297,6 +549,35 @@ public:
     
     /// Number of points in the Mecable that has the most number of points
     unsigned largestMecable() const;
+    
+    /// number of threads used in parallel sections
+    int      nbThreadsUsed() const { return nbThreads; }
+    
+#if MECA_USES_OPENMP
+    /// Meca in which the interactions of range `t` should be set, between openStages() and closeStages()
+    Meca&    stage(int t) { return t > 0 ? *stages[t-1] : *this; }
+    
+    /// prepare `nbThreadsUsed()-1` thread-private Meca, to set interactions in parallel
+    void     openStages();
+    
+    /// add the interactions set in the thread-private Meca to this Meca
+    void     closeStages();
+#endif
+    
+    /// number of preconditionner blocks that were reused in the last solve()
+    size_t   nbReusedBlocks() const;
+    
+    /// number of iterations needed by the iterative solver in the last solve()
+    unsigned nbIterations() const { return solverCount; }
+    
+    /// CPU time (milliseconds) spent in the last solve(), computing the preconditionner (0) or iterating (1)
+    double   solveTime(int i) const { return solverTime[i]; }
+    
+    /// print statistics of the last solve() on a single line, without newline
+    void     writeStatistics(FILE*, int precond) const;
+    
+    /// memory allocated for the vectors, the matrices and the preconditionners, in bytes
+    void     memory(size_t& vec, size_t& matB, size_t& matC, size_t& pre) const;
 
     /// true if system does not contain any object
     bool     empty() const { return nbPts == 0; }
@@ -307,6 +588,9 @@ public:
     /// Implementation of LinearOperator::size()
     size_t dimension() const { return DIM * nbPts; }
     
+    /// largest dimension of the system for which `precondition = 5` is effective
+    static size_t directLimit();
+    
     /// calculate Y <- M*X, where M is the matrix associated with the system
     void multiply(const real* X, real* Y) const;
 
@@ -493,9 +777,18 @@ public:
     /// Allocate the memory necessary to solve(). This must be called after the last add()
     void prepare(Simul const*);
     
+    /// start filling the Gaussian random numbers used by solve(), in a separate thread
+    void startNoise();
+    
     /// Calculate motion of all Mecables in the system
     void solve(SimulProp const*, int precondition);
     
+    /// clear interactions and move Mecables to the last solution, before a Newton correction
+    void relinearize();
+    
+    /// solve again after the interactions were set around the last solution
+    bool correct(SimulProp const*, int precondition);
+    
     /// transfer newly calculated point coordinates back to Mecables
     void apply();
 
@@ -515,7 +808,10 @@ public:
     /// Save right-hand-side vector
     void saveRHS(FILE *) const;
     
-    /// Output vectors and matrices, in a format that can be imported in MATLAB
+    /// Save the isotropic matrix `mB` in Matrix Market format
+    void saveElasticity(FILE *) const;
+    
+    /// Save the matrices and the right-hand-side vector in Matrix Market format
     void saveSystem(const char dirname[]) const;
 
     /// Save complete matrix in binary format
@@ -536,6 +832,12 @@ public:
     /// Save the object ID associated with each degree of freedom
     void dumpObjectID(FILE *) const;
     
+    /// write the solutions kept for setInitialGuess(), in native binary format
+    void writeGuess(Outputter&) const;
+    
+    /// restore the solutions kept for setInitialGuess(), written by writeGuess()
+    void readGuess(Inputter&);
+    
     /// Output vectors and matrices, in a format that can be imported in MATLAB
     void dump() const;
  
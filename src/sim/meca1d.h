@@ -21,6 +21,11 @@
  If you are curious about understanding how cytosim works, this is a good place to start!
  This is a bare-bone solver, which should be easy to understand.
  Meca does essentially the same in N-dimension.
+ 
+ The clamps are stored separately from the links, in the diagonal vector 'vDIA'.
+ If there are no links, the Mecables are all independent and the system is solved
+ directly, in a single vectorizable pass over all objects. This makes it possible
+ to simulate many replicas of a 1D system within the same simulation cheaply.
  */
 class Meca1D
 {
@@ -28,6 +33,8 @@ class Meca1D
     
     int    ready_;                ///< true if the solution is contained in 'vSOL'
     
+    size_t nbLinks_;              ///< number of links between different objects
+    
 public:
    
     Array<Mecable *> objs;       ///< list of mobile objects
@@ -36,6 +43,7 @@ public:
     real * vBAS;                 ///< base points of forces and intermediate of calculus
     real * vMOB;                 ///< the mobility coefficients of the objects
     real * vRHS;                 ///< right-hand side term of the equation
+    real * vDIA;                 ///< diagonal terms of the matrix, from the clamps
 
     /// matrix containing the elasticity coefficients
     MatrixSparseSymmetric1   mA;
@@ -47,10 +55,12 @@ public:
     {
         allocated_ = 0;
         ready_ = -1;
+        nbLinks_ = 0;
         vSOL = nullptr;
         vBAS = nullptr;
         vMOB = nullptr;
         vRHS = nullptr;
+        vDIA = nullptr;
     }
     
     ~Meca1D()
@@ -65,11 +75,13 @@ public:
         free_real(vSOL);
         free_real(vMOB);
         free_real(vRHS);
+        free_real(vDIA);
         allocated_ = 0;
         vBAS = nullptr;
         vSOL = nullptr;
         vMOB = nullptr;
         vRHS = nullptr;
+        vDIA = nullptr;
     }
 
     void prepare(Simul const* sim, real time_step, real kT)
@@ -91,18 +103,22 @@ public:
             free_real(vSOL);
             free_real(vMOB);
             free_real(vRHS);
+            free_real(vDIA);
             
             vBAS = new_real(allocated_);
             vSOL = new_real(allocated_);
             vMOB = new_real(allocated_);
             vRHS = new_real(allocated_);
+            vDIA = new_real(allocated_);
         }
         
         mA.resize(dim);
         mA.reset();
+        nbLinks_ = 0;
 
         zero_real(dim, vBAS);
         zero_real(dim, vRHS);
+        zero_real(dim, vDIA);
 
         size_t ii = 0;
         for ( Mecable * mec : objs )
@@ -119,13 +135,14 @@ public:
     /// add a clamp between point at index 'ii' to position 'dx'
     void addClamp(index_t ii, real w, real dx)
     {
-        mA(ii, ii) -= w;
-        vBAS[ii]   += w * dx;
+        vDIA[ii] -= w;
+        vBAS[ii] += w * dx;
     }
     
     /// add a link between points 'ii' and 'jj' with a position shift 'dx'
     void addLink(index_t ii, index_t jj, real w, real dx)
     {
+        ++nbLinks_;
         mA(ii, ii) -= w;
         mA(ii, jj) += w;
         mA(jj, jj) -= w;
@@ -173,10 +190,20 @@ public:
      
          vSOL = newPOS - oldPOS
 
+     Without links, the matrix is diagonal and the solution is calculated directly.
      */
     void solve(real precision)
     {
         assert_true(ready_==0);
+        if ( nbLinks_ == 0 )
+        {
+            const size_t dim = objs.size();
+            #pragma ivdep
+            for ( size_t ii = 0; ii < dim; ++ii )
+                vSOL[ii] = vRHS[ii] / ( 1.0 - vMOB[ii] * vDIA[ii] );
+            ready_ = 1;
+            return;
+        }
         mA.prepareForMultiply(1);
         LinearSolvers::Monitor monitor(dimension(), precision);
         LinearSolvers::BCGS(*this, vRHS, vSOL, monitor, allocator);
@@ -210,7 +237,7 @@ public:
         mA.vecMulAdd(X, vBAS);
         
         for( size_t ii = 0; ii < objs.size(); ++ii )
-            Y[ii] = X[ii] - vMOB[ii] * vBAS[ii];
+            Y[ii] = X[ii] - vMOB[ii] * ( vBAS[ii] + vDIA[ii] * X[ii] );
     }
 };
 
@@ -14,7 +14,7 @@
 
 //#include "vecprint.h"
 
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 /// set TRUE to update matrix mC using block directives
 /** This is significantly faster */
@@ -446,6 +446,65 @@ void Meca::addTorquePoliti(const Interpolation & pt1,
 //------------------------------------------------------------------------------
 
 
+/**
+ Add the terms of a link between `N` points, of indices `inx[]`, weighted by
+ `coef[]` whose sum is zero, and `ww[] = weight * coef[]`.
+ Diagonal and lower elements of mB are set.
+ Since `N` is known at compile time, the loops are fully unrolled.
+ */
+template < size_t N >
+void Meca::addLinkTerms(const index_t inx[N], const real coef[N], const real ww[N])
+{
+    for ( size_t j = 0; j < N; ++j )
+    for ( size_t i = j; i < N; ++i )
+        mB(inx[i], inx[j]) -= ww[i] * coef[j];
+}
+
+
+/**
+ With periodic boundary conditions, add to vBAS the correction corresponding to
+ the link between `N` points, which is calculated from the weighted sum of
+ their positions.
+ */
+template < size_t N >
+void Meca::addLinkOffset(const index_t inx[N], const real coef[N], const real ww[N])
+{
+    Vector pos(0, 0, 0);
+    for ( size_t i = 0; i < N; ++i )
+        pos += coef[i] * Vector(vPTS+DIM*inx[i]);
+    Vector off = modulo->offset(pos);
+    if ( off.is_not_zero() )
+    {
+        for ( size_t i = 0; i < N; ++i )
+            off.add_to(ww[i], vBAS+DIM*inx[i]);
+    }
+}
+
+
+/**
+ Linear force of stiffness `weight` between `N` vertices of indices `inx[]`,
+ with coefficients `coef[]` whose sum is zero. This is used by all the links
+ of zero resting length below, for which:
+ 
+     force_A = weight * ( B - A )
+     force_B = weight * ( A - B )
+ 
+ corresponds to positive coefficients for A and negative ones for B.
+ */
+template < size_t N >
+void Meca::addLinkN(const index_t inx[N], const real coef[N], const real weight)
+{
+    real ww[N];
+    for ( size_t i = 0; i < N; ++i )
+        ww[i] = weight * coef[i];
+    
+    addLinkTerms<N>(inx, coef, ww);
+    
+    if ( modulo )
+        addLinkOffset<N>(inx, coef, ww);
+}
+
+
 /**
  Link `pta` (A) and `ptb` (B)
  The force is linear with a zero resting length:
@@ -480,36 +539,13 @@ void Meca::addLink(const Mecapoint & pta,
 {
     assert_true( weight >= 0 );
     
-    const index_t ii0 = pta.matIndex();
-    const index_t ii1 = ptb.matIndex();
+    const index_t inx[] = { pta.matIndex(), ptb.matIndex() };
 
-    if ( ii0 == ii1 )
+    if ( inx[0] == inx[1] )
         return;
 
-    mB(ii0, ii0) -= weight;
-    mB(ii1, ii1) -= weight;
-    mB(ii0, ii1) += weight;
-
-    if ( modulo )
-    {
-        const real ww[] = { weight, -weight };
-#if ( 1 )
-        Vector off = modulo->offset(pta.pos() - ptb.pos());
-        if ( off.is_not_zero() )
-        {
-            off.add_to(ww[0], vBAS+DIM*ii0);
-            off.add_to(ww[1], vBAS+DIM*ii1);
-        }
-#else
-        const index_t inx[] = { DIM*ii0, DIM*ii1 };
-        Vector off = modulo->offset(position2(inx, ww));
-        if ( off.is_not_zero() )
-        {
-            off.add_to(vBAS+DIM*ii0);
-            off.sub_to(vBAS+DIM*ii1);
-        }
-#endif
-    }
+    const real cc[] = { 1.0, -1.0 };
+    addLinkN<2>(inx, cc, weight);
     
 #if DRAW_MECA_LINKS
     if ( drawLinks )
@@ -537,39 +573,14 @@ void Meca::addLink(const Interpolation & pti,
     assert_true( weight >= 0 );
     
     //index in the matrix mB:
-    const index_t ii0 = pti.matIndex1();
-    const index_t ii1 = pti.matIndex2();
-    const index_t ii2 = pte.matIndex();
+    const index_t inx[] = { pti.matIndex1(), pti.matIndex2(), pte.matIndex() };
     
-    if ( any_equal(ii0, ii1, ii2) )
+    if ( any_equal(inx[0], inx[1], inx[2]) )
         return;
 
     //coefficients on the points:
-    const real cc[] = { pti.coef2(),   pti.coef1(),    -1.0 };
-    const real ww[] = { weight*cc[0], weight*cc[1], -weight };
-    
-    mB(ii0, ii0) -= ww[0] * cc[0];
-    mB(ii1, ii0) -= ww[1] * cc[0];
-    mB(ii2, ii0) += ww[0];         // since cc[2] == -1
-    mB(ii1, ii1) -= ww[1] * cc[1];
-    mB(ii2, ii1) += ww[1];         // since cc[2] == -1
-    mB(ii2, ii2) += ww[2];         // since cc[2] == -1
- 
-    if ( modulo )
-    {
-#if ( 1 )
-        Vector off = modulo->offset(pti.pos() - pte.pos());
-#else
-        const index_t inx[] = { DIM*ii0, DIM*ii1, DIM*ii2 };
-        Vector off = modulo->offset(position3(inx, cc));
-#endif
-        if ( off.is_not_zero() )
-        {
-            off.add_to(ww[0], vBAS+DIM*ii0);
-            off.add_to(ww[1], vBAS+DIM*ii1);
-            off.add_to(ww[2], vBAS+DIM*ii2);
-        }
-    }
+    const real cc[] = { pti.coef2(), pti.coef1(), -1.0 };
+    addLinkN<3>(inx, cc, weight);
     
 #if DRAW_MECA_LINKS
     if ( drawLinks )
@@ -597,41 +608,14 @@ void Meca::addLink(const Mecapoint & pte,
     assert_true( weight >= 0 );
     
     //index in the matrix mB:
-    const index_t ii0 = pte.matIndex();
-    const index_t ii1 = pti.matIndex1();
-    const index_t ii2 = pti.matIndex2();
+    const index_t inx[] = { pte.matIndex(), pti.matIndex1(), pti.matIndex2() };
     
-    if ( any_equal(ii0, ii1, ii2) )
+    if ( any_equal(inx[0], inx[1], inx[2]) )
         return;
     
     //coefficients on the points:
-    const real cc[] = {    1.0, -pti.coef2(), -pti.coef1() };
-    const real ww[] = { weight, weight*cc[1], weight*cc[2] };
-    
-    mB(ii0, ii0) -= ww[0];  // since cc[0]==1
-    mB(ii1, ii0) -= ww[1];  // since cc[0]==1
-    mB(ii2, ii0) -= ww[2];  // since cc[0]==1
-    
-    mB(ii1, ii1) -= ww[1] * cc[1];
-    mB(ii2, ii1) -= ww[2] * cc[1];
-    
-    mB(ii2, ii2) -= ww[2] * cc[2];
-  
-    if ( modulo )
-    {
-#if ( 1 )
-        Vector off = modulo->offset(pte.pos() - pti.pos());
-#else
-        const index_t inx[] = { DIM*ii0, DIM*ii1, DIM*ii2 };
-        Vector off = modulo->offset(position3(inx, cc));
-#endif
-        if ( off.is_not_zero() )
-        {
-            off.add_to(ww[0], vBAS+DIM*ii0);
-            off.add_to(ww[1], vBAS+DIM*ii1);
-            off.add_to(ww[2], vBAS+DIM*ii2);
-        }
-    }
+    const real cc[] = { 1.0, -pti.coef2(), -pti.coef1() };
+    addLinkN<3>(inx, cc, weight);
     
 #if DRAW_MECA_LINKS
     if ( drawLinks )
@@ -659,49 +643,35 @@ void Meca::addLink(const Interpolation & pta,
     assert_true( weight >= 0 );
     
     //index in the matrix mB:
-    const index_t ii0 = pta.matIndex1();
-    const index_t ii1 = pta.matIndex2();
-    const index_t ii2 = ptb.matIndex1();
-    const index_t ii3 = ptb.matIndex2();
+    const index_t inx[] = { pta.matIndex1(), pta.matIndex2(), ptb.matIndex1(), ptb.matIndex2() };
     
-    if ( any_equal(ii0, ii1, ii2, ii3) )
+    if ( any_equal(inx[0], inx[1], inx[2], inx[3]) )
         return;
     
     //interpolation coefficients:
     const real cc[] = {  pta.coef2(),  pta.coef1(), -ptb.coef2(), -ptb.coef1() };
     const real ww[] = { weight*cc[0], weight*cc[1], weight*cc[2], weight*cc[3] };
     
-    mB(ii0, ii0) -= ww[0] * cc[0];
-    mB(ii1, ii0) -= ww[1] * cc[0];
-    mB(ii2, ii0) -= ww[2] * cc[0];
-    mB(ii3, ii0) -= ww[3] * cc[0];
-    
-    mB(ii1, ii1) -= ww[1] * cc[1];
-    mB(ii2, ii1) -= ww[2] * cc[1];
-    mB(ii3, ii1) -= ww[3] * cc[1];
-    
-    mB(ii2, ii2) -= ww[2] * cc[2];
-    mB(ii3, ii2) -= ww[3] * cc[2];
-    
-    mB(ii3, ii3) -= ww[3] * cc[3];
-    
-    if ( modulo )
+    if ( useMatrixFree && pta.mecable() != ptb.mecable() )
     {
-#if ( 1 )
-        Vector off = modulo->offset(pta.pos() - ptb.pos());
-#else
-        const index_t inx[] = { DIM*ii0, DIM*ii1, DIM*ii2, DIM*ii3 };
-        Vector off = modulo->offset(position4(inx, cc));
-#endif
-        if ( off.is_not_zero() )
-        {
-            off.add_to(ww[0], vBAS+DIM*ii0);
-            off.add_to(ww[1], vBAS+DIM*ii1);
-            off.add_to(ww[2], vBAS+DIM*ii2);
-            off.add_to(ww[3], vBAS+DIM*ii3);
-        }
+        /*
+         The terms within each Mecable are stored in mB, such that they are
+         included in the preconditionner, but the terms coupling the two
+         Mecables are recorded in `mLinks`, to be applied by calculateForces()
+         */
+        addLinkTerms<2>(inx, cc, ww);
+        addLinkTerms<2>(inx+2, cc+2, ww+2);
+        
+        mLinks.push_back(MecaLink{{inx[0], inx[1], inx[2], inx[3]}, {cc[0], cc[1], cc[2], cc[3]}, weight});
+    }
+    else
+    {
+        addLinkTerms<4>(inx, cc, ww);
     }
     
+    if ( modulo )
+        addLinkOffset<4>(inx, cc, ww);
+    
 #if DRAW_MECA_LINKS
     if ( drawLinks )
     {
@@ -734,36 +704,13 @@ void Meca::addLink1(const Interpolation & pti,
     assert_true( weight >= 0 );
     
     //index in the matrix mB:
-    const index_t ii0 = pts;
-    const index_t ii1 = pti.matIndex1();
-    const index_t ii2 = pti.matIndex2();
+    const index_t inx[] = { pts, pti.matIndex1(), pti.matIndex2() };
     
-    if ( any_equal(ii0, ii1, ii2) )
+    if ( any_equal(inx[0], inx[1], inx[2]) )
         return;
     
-    const real cc[] = {    1.0, -pti.coef2(), -pti.coef1() };
-    const real ww[] = { weight, weight*cc[1], weight*cc[2] };
-    
-    mB(ii0, ii0) -= ww[0]; // since cc[0] == 1.0
-    mB(ii1, ii0) -= ww[1]; // since cc[0] == 1.0
-    mB(ii2, ii0) -= ww[2]; // since cc[0] == 1.0
-    
-    mB(ii1, ii1) -= ww[1] * cc[1];
-    mB(ii2, ii1) -= ww[2] * cc[1];
-    
-    mB(ii2, ii2) -= ww[2] * cc[2];
-    
-    if ( modulo )
-    {
-        const index_t inx[] = { DIM*ii0, DIM*ii1, DIM*ii2 };
-        Vector off = modulo->offset(position3(inx, cc));
-        if ( off.is_not_zero() )
-        {
-            off.add_to(ww[0], vBAS+DIM*ii0);
-            off.add_to(ww[1], vBAS+DIM*ii1);
-            off.add_to(ww[2], vBAS+DIM*ii2);
-        }
-    }
+    const real cc[] = { 1.0, -pti.coef2(), -pti.coef1() };
+    addLinkN<3>(inx, cc, weight);
 }
 
 
@@ -786,38 +733,15 @@ void Meca::addLink2(const Mecapoint & pte,
     assert_true( weight >= 0 );
     
     //index in the matrix mB:
-    const index_t ii0 = pte.matIndex();
-    const index_t ii1 = pts[0];
-    const index_t ii2 = pts[1];
+    const index_t inx[] = { pte.matIndex(), pts[0], pts[1] };
     
-    if ( any_equal(ii0, ii1, ii2) )
+    if ( any_equal(inx[0], inx[1], inx[2]) )
         return;
 
-    const real cc[] = {    1.0,      -coef[0],     -coef[1] };
-    const real ww[] = { weight,  weight*cc[1], weight*cc[2] };
-    
     assert_small(coef[0]+coef[1]-1.0);
     
-    mB(ii0, ii0) -= ww[0]; // since cc[0] == 1.0
-    mB(ii1, ii0) -= ww[1]; // since cc[0] == 1.0
-    mB(ii2, ii0) -= ww[2]; // since cc[0] == 1.0
-    
-    mB(ii1, ii1) -= ww[1] * cc[1];
-    mB(ii2, ii1) -= ww[2] * cc[1];
-    
-    mB(ii2, ii2) -= ww[2] * cc[2];
-    
-    if ( modulo )
-    {
-        const index_t inx[] = { DIM*ii0, DIM*ii1, DIM*ii2 };
-        Vector off = modulo->offset(position3(inx, cc));
-        if ( off.is_not_zero() )
-        {
-            off.add_to(ww[0], vBAS+DIM*ii0);
-            off.add_to(ww[1], vBAS+DIM*ii1);
-            off.add_to(ww[2], vBAS+DIM*ii2);
-        }
-    }
+    const real cc[] = { 1.0, -coef[0], -coef[1] };
+    addLinkN<3>(inx, cc, weight);
 }
 
 /**
@@ -839,42 +763,12 @@ void Meca::addLink2(const Interpolation & pti,
     assert_true( weight >= 0 );
     
     //index in the matrix mB:
-    const index_t ii0 = pti.matIndex1();
-    const index_t ii1 = pti.matIndex2();
-    const index_t ii2 = pts[0];
-    const index_t ii3 = pts[1];
+    const index_t inx[] = { pti.matIndex1(), pti.matIndex2(), pts[0], pts[1] };
     
-    const real cc[] = { -pti.coef2(), -pti.coef1(),      coef[0],      coef[1] };
-    const real ww[] = { weight*cc[0], weight*cc[1], weight*cc[2], weight*cc[3] };
-
     assert_small(coef[0]+coef[1]-1.0);
     
-    mB(ii0, ii0) -= ww[0] * cc[0];
-    mB(ii1, ii0) -= ww[1] * cc[0];
-    mB(ii2, ii0) -= ww[2] * cc[0];
-    mB(ii3, ii0) -= ww[3] * cc[0];
-
-    mB(ii1, ii1) -= ww[1] * cc[1];
-    mB(ii2, ii1) -= ww[2] * cc[1];
-    mB(ii3, ii1) -= ww[3] * cc[1];
-
-    mB(ii2, ii2) -= ww[2] * cc[2];
-    mB(ii3, ii2) -= ww[3] * cc[2];
-
-    mB(ii3, ii3) -= ww[3] * cc[3];
-    
-    if ( modulo )
-    {
-        const index_t inx[] = { DIM*ii0, DIM*ii1, DIM*ii2, DIM*ii3 };
-        Vector off = modulo->offset(position4(inx, cc));
-        if ( off.is_not_zero() )
-        {
-            off.add_to(ww[0], vBAS+DIM*ii0);
-            off.add_to(ww[1], vBAS+DIM*ii1);
-            off.add_to(ww[2], vBAS+DIM*ii2);
-            off.add_to(ww[3], vBAS+DIM*ii3);
-        }
-    }
+    const real cc[] = { -pti.coef2(), -pti.coef1(), coef[0], coef[1] };
+    addLinkN<4>(inx, cc, weight);
 }
 
 
@@ -897,42 +791,12 @@ void Meca::addLink3(const Mecapoint & pte,
     assert_true( weight >= 0 );
     
     //index in the matrix mB:
-    const index_t ii0 = pte.matIndex();
-    const index_t ii1 = pts[0];
-    const index_t ii2 = pts[1];
-    const index_t ii3 = pts[2];
-
-    const real cc[] = {    1.0,     -coef[0],     -coef[1],     -coef[2] };
-    const real ww[] = { weight, weight*cc[1], weight*cc[2], weight*cc[3] };
+    const index_t inx[] = { pte.matIndex(), pts[0], pts[1], pts[2] };
 
     assert_small(coef[0]+coef[1]+coef[2]-1.0);
     
-    mB(ii0, ii0) -= ww[0];
-    mB(ii1, ii0) -= ww[1];
-    mB(ii2, ii0) -= ww[2];
-    mB(ii3, ii0) -= ww[3];
-    
-    mB(ii1, ii1) -= ww[1] * cc[1];
-    mB(ii2, ii1) -= ww[2] * cc[1];
-    mB(ii3, ii1) -= ww[3] * cc[1];
-    
-    mB(ii2, ii2) -= ww[2] * cc[2];
-    mB(ii3, ii2) -= ww[3] * cc[2];
-    
-    mB(ii3, ii3) -= ww[3] * cc[3];
-    
-    if ( modulo )
-    {
-        const index_t inx[] = { DIM*ii0, DIM*ii1, DIM*ii2, DIM*ii3 };
-        Vector off = modulo->offset(position4(inx, cc));
-        if ( off.is_not_zero() )
-        {
-            off.add_to(ww[0], vBAS+DIM*ii0);
-            off.add_to(ww[1], vBAS+DIM*ii1);
-            off.add_to(ww[2], vBAS+DIM*ii2);
-            off.add_to(ww[3], vBAS+DIM*ii3);
-        }
-    }
+    const real cc[] = { 1.0, -coef[0], -coef[1], -coef[2] };
+    addLinkN<4>(inx, cc, weight);
 }
 
 
@@ -955,50 +819,12 @@ void Meca::addLink3(const Interpolation & pti,
     assert_true( weight >= 0 );
     
     //index in the matrix mB:
-    const index_t ii0 = pti.matIndex1();
-    const index_t ii1 = pti.matIndex2();
-    const index_t ii2 = pts[0];
-    const index_t ii3 = pts[1];
-    const index_t ii4 = pts[2];
+    const index_t inx[] = { pti.matIndex1(), pti.matIndex2(), pts[0], pts[1], pts[2] };
 
-    const real cc[] = { -pti.coef2(), -pti.coef1(),      coef[0],      coef[1],      coef[2] };
-    const real ww[] = { weight*cc[0], weight*cc[1], weight*cc[2], weight*cc[3], weight*cc[4] };
-    
     assert_small(coef[0]+coef[1]+coef[2]-1.0);
     
-    mB(ii0, ii0) -= ww[0] * cc[0];
-    mB(ii1, ii0) -= ww[1] * cc[0];
-    mB(ii2, ii0) -= ww[2] * cc[0];
-    mB(ii3, ii0) -= ww[3] * cc[0];
-    mB(ii4, ii0) -= ww[4] * cc[0];
-    
-    mB(ii1, ii1) -= ww[1] * cc[1];
-    mB(ii2, ii1) -= ww[2] * cc[1];
-    mB(ii3, ii1) -= ww[3] * cc[1];
-    mB(ii4, ii1) -= ww[4] * cc[1];
-    
-    mB(ii2, ii2) -= ww[2] * cc[2];
-    mB(ii3, ii2) -= ww[3] * cc[2];
-    mB(ii4, ii2) -= ww[4] * cc[2];
-    
-    mB(ii3, ii3) -= ww[3] * cc[3];
-    mB(ii4, ii3) -= ww[4] * cc[3];
-    
-    mB(ii4, ii4) -= ww[4] * cc[4];
-    
-    if ( modulo )
-    {
-        const index_t inx[] = { DIM*ii0, DIM*ii1, DIM*ii2, DIM*ii3, DIM*ii4 };
-        Vector off = modulo->offset(position5(inx, cc));
-        if ( off.is_not_zero() )
-        {
-            off.add_to(ww[0], vBAS+DIM*ii0);
-            off.add_to(ww[1], vBAS+DIM*ii1);
-            off.add_to(ww[2], vBAS+DIM*ii2);
-            off.add_to(ww[3], vBAS+DIM*ii3);
-            off.add_to(ww[4], vBAS+DIM*ii4);
-        }
-    }
+    const real cc[] = { -pti.coef2(), -pti.coef1(), coef[0], coef[1], coef[2] };
+    addLinkN<5>(inx, cc, weight);
 }
 
 /**
@@ -1020,50 +846,12 @@ void Meca::addLink4(const Mecapoint & pte,
     assert_true( weight >= 0 );
 
     //index in the matrix mB:
-    const index_t ii0 = pte.matIndex();
-    const index_t ii1 = pts[0];
-    const index_t ii2 = pts[1];
-    const index_t ii3 = pts[2];
-    const index_t ii4 = pts[3];
+    const index_t inx[] = { pte.matIndex(), pts[0], pts[1], pts[2], pts[3] };
 
-    const real cc[] = {    1.0,     -coef[0],     -coef[1],     -coef[2],     -coef[3] };
-    const real ww[] = { weight, weight*cc[1], weight*cc[2], weight*cc[3], weight*cc[4] };
-    
     assert_small(coef[0]+coef[1]+coef[2]+coef[3]-1.0);
     
-    mB(ii0, ii0) -= ww[0];
-    mB(ii1, ii0) -= ww[1];
-    mB(ii2, ii0) -= ww[2];
-    mB(ii3, ii0) -= ww[3];
-    mB(ii4, ii0) -= ww[4];
-    
-    mB(ii1, ii1) -= ww[1] * cc[1];
-    mB(ii2, ii1) -= ww[2] * cc[1];
-    mB(ii3, ii1) -= ww[3] * cc[1];
-    mB(ii4, ii1) -= ww[4] * cc[1];
-    
-    mB(ii2, ii2) -= ww[2] * cc[2];
-    mB(ii3, ii2) -= ww[3] * cc[2];
-    mB(ii4, ii2) -= ww[4] * cc[2];
-    
-    mB(ii3, ii3) -= ww[3] * cc[3];
-    mB(ii4, ii3) -= ww[4] * cc[3];
-    
-    mB(ii4, ii4) -= ww[4] * cc[4];
-    
-    if ( modulo )
-    {
-        const index_t inx[] = { DIM*ii0, DIM*ii1, DIM*ii2, DIM*ii3, DIM*ii4 };
-        Vector off = modulo->offset(position5(inx, cc));
-        if ( off.is_not_zero() )
-        {
-            off.add_to(ww[0], vBAS+DIM*ii0);
-            off.add_to(ww[1], vBAS+DIM*ii1);
-            off.add_to(ww[2], vBAS+DIM*ii2);
-            off.add_to(ww[3], vBAS+DIM*ii3);
-            off.add_to(ww[4], vBAS+DIM*ii4);
-        }
-    }
+    const real cc[] = { 1.0, -coef[0], -coef[1], -coef[2], -coef[3] };
+    addLinkN<5>(inx, cc, weight);
 }
 
 
@@ -1086,59 +874,12 @@ void Meca::addLink4(const Interpolation & pti,
     assert_true( weight >= 0 );
     
     //index in the matrix mB:
-    const index_t ii0 = pti.matIndex1();
-    const index_t ii1 = pti.matIndex2();
-    const index_t ii2 = pts[0];
-    const index_t ii3 = pts[1];
-    const index_t ii4 = pts[2];
-    const index_t ii5 = pts[3];
+    const index_t inx[] = { pti.matIndex1(), pti.matIndex2(), pts[0], pts[1], pts[2], pts[3] };
 
-    const real cc[] = { -pti.coef2(), -pti.coef1(),      coef[0],      coef[1],      coef[2],      coef[3] };
-    const real ww[] = { weight*cc[0], weight*cc[1], weight*cc[2], weight*cc[3], weight*cc[4], weight*cc[5] };
-    
     assert_small(coef[0]+coef[1]+coef[2]+coef[3]-1.0);
     
-    mB(ii0, ii0) -= ww[0] * cc[0];
-    mB(ii1, ii0) -= ww[1] * cc[0];
-    mB(ii2, ii0) -= ww[2] * cc[0];
-    mB(ii3, ii0) -= ww[3] * cc[0];
-    mB(ii4, ii0) -= ww[4] * cc[0];
-    mB(ii5, ii0) -= ww[5] * cc[0];
-    
-    mB(ii1, ii1) -= ww[1] * cc[1];
-    mB(ii2, ii1) -= ww[2] * cc[1];
-    mB(ii3, ii1) -= ww[3] * cc[1];
-    mB(ii4, ii1) -= ww[4] * cc[1];
-    mB(ii5, ii1) -= ww[5] * cc[1];
-    
-    mB(ii2, ii2) -= ww[2] * cc[2];
-    mB(ii3, ii2) -= ww[3] * cc[2];
-    mB(ii4, ii2) -= ww[4] * cc[2];
-    mB(ii5, ii2) -= ww[5] * cc[2];
-    
-    mB(ii3, ii3) -= ww[3] * cc[3];
-    mB(ii4, ii3) -= ww[4] * cc[3];
-    mB(ii5, ii3) -= ww[5] * cc[3];
-    
-    mB(ii4, ii4) -= ww[4] * cc[4];
-    mB(ii5, ii4) -= ww[5] * cc[4];
-
-    mB(ii5, ii5) -= ww[5] * cc[5];
-
-    if ( modulo )
-    {
-        const index_t inx[] = { DIM*ii0, DIM*ii1, DIM*ii2, DIM*ii3, DIM*ii4, DIM*ii5 };
-        Vector off = modulo->offset(position6(inx, cc));
-        if ( off.is_not_zero() )
-        {
-            off.add_to(ww[0], vBAS+DIM*ii0);
-            off.add_to(ww[1], vBAS+DIM*ii1);
-            off.add_to(ww[2], vBAS+DIM*ii2);
-            off.add_to(ww[3], vBAS+DIM*ii3);
-            off.add_to(ww[4], vBAS+DIM*ii4);
-            off.add_to(ww[5], vBAS+DIM*ii5);
-        }
-    }
+    const real cc[] = { -pti.coef2(), -pti.coef1(), coef[0], coef[1], coef[2], coef[3] };
+    addLinkN<6>(inx, cc, weight);
 }
 
 //------------------------------------------------------------------------------
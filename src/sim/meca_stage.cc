@@ -0,0 +1,26 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#include "meca_stage.h"
+#include "meca.h"
+
+
+void MecaStage::commit(Meca& meca) const
+{
+    for ( Record const* R = rec_.begin(); R < rec_.end(); ++R )
+    {
+        switch ( R->kind )
+        {
+            case LINK_MM: meca.addLink(R->pa, R->pb, R->weight); break;
+            case LINK_IM: meca.addLink(R->ia, R->pb, R->weight); break;
+            case LINK_MI: meca.addLink(R->pa, R->ib, R->weight); break;
+            case LINK_II: meca.addLink(R->ia, R->ib, R->weight); break;
+            case LONG_MM: meca.addLongLink(R->pa, R->pb, R->len, R->weight); break;
+            case LONG_MI: meca.addLongLink(R->pa, R->ib, R->len, R->weight); break;
+            case LONG_II: meca.addLongLink(R->ia, R->ib, R->len, R->weight); break;
+            case SIDE_SLIDING_IM: meca.addSideSlidingLink(R->ia, R->pb, R->len, R->weight); break;
+            case SIDE_SLIDING_II: meca.addSideSlidingLink(R->ia, R->ib, R->len, R->weight); break;
+            case CLAMP_M: meca.addPointClamp(R->pa, R->pos, R->weight); break;
+            case CLAMP_I: meca.addPointClamp(R->ia, R->pos, R->weight); break;
+        }
+    }
+}
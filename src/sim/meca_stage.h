@@ -0,0 +1,144 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+#ifndef MECA_STAGE_H
+#define MECA_STAGE_H
+
+#include "real.h"
+#include "vector.h"
+#include "array.h"
+#include "mecapoint.h"
+#include "interpolation.h"
+
+class Meca;
+
+
+/// Records interactions, to be entered later into Meca
+/**
+ MecaStage offers a subset of the interface of Meca, with the same
+ names and arguments, but the interactions are only recorded.
+
+ This is used to calculate interactions in parallel: each thread fills
+ its own MecaStage, and the records are then transfered to Meca by a single
+ thread with commit(). If the stages are committed in the order in which the
+ work was distributed to the threads, the result is identical to a serial
+ calculation, since the interactions are entered into Meca in the same order.
+
+ A function that adds interactions can be written as a template of the
+ destination type, to accept either Meca or MecaStage as argument.
+ */
+class MecaStage
+{
+    /// types of interactions
+    enum { LINK_MM, LINK_IM, LINK_MI, LINK_II,
+           LONG_MM, LONG_MI, LONG_II,
+           SIDE_SLIDING_IM, SIDE_SLIDING_II,
+           CLAMP_M, CLAMP_I };
+
+    /// an interaction between two points
+    struct Record
+    {
+        int           kind;
+        real          len;
+        real          weight;
+        Vector        pos;
+        Mecapoint     pa, pb;
+        Interpolation ia, ib;
+
+        Record() : kind(0), len(0), weight(0) {}
+    };
+
+    /// list of interactions, in the order in which they were added
+    Array<Record> rec_;
+
+    /// add a new record
+    Record& next(int k, real len, real weight)
+    {
+        Record& R = rec_.new_val();
+        R.kind = k;
+        R.len = len;
+        R.weight = weight;
+        return R;
+    }
+
+public:
+
+    /// constructor
+    MecaStage() {}
+
+    /// number of recorded interactions
+    size_t size() const { return rec_.size(); }
+
+    /// remove all records
+    void clear() { rec_.clear(); }
+
+    /// enter all records into `meca`, in the order in which they were added
+    void commit(Meca& meca) const;
+
+    /// record Meca::addLink()
+    void addLink(Mecapoint const& a, Mecapoint const& b, real w)
+    {
+        Record& R = next(LINK_MM, 0, w); R.pa = a; R.pb = b;
+    }
+
+    /// record Meca::addLink()
+    void addLink(Interpolation const& a, Mecapoint const& b, real w)
+    {
+        Record& R = next(LINK_IM, 0, w); R.ia = a; R.pb = b;
+    }
+
+    /// record Meca::addLink()
+    void addLink(Mecapoint const& a, Interpolation const& b, real w)
+    {
+        Record& R = next(LINK_MI, 0, w); R.pa = a; R.ib = b;
+    }
+
+    /// record Meca::addLink()
+    void addLink(Interpolation const& a, Interpolation const& b, real w)
+    {
+        Record& R = next(LINK_II, 0, w); R.ia = a; R.ib = b;
+    }
+
+    /// record Meca::addLongLink()
+    void addLongLink(Mecapoint const& a, Mecapoint const& b, real len, real w)
+    {
+        Record& R = next(LONG_MM, len, w); R.pa = a; R.pb = b;
+    }
+
+    /// record Meca::addLongLink()
+    void addLongLink(Mecapoint const& a, Interpolation const& b, real len, real w)
+    {
+        Record& R = next(LONG_MI, len, w); R.pa = a; R.ib = b;
+    }
+
+    /// record Meca::addLongLink()
+    void addLongLink(Interpolation const& a, Interpolation const& b, real len, real w)
+    {
+        Record& R = next(LONG_II, len, w); R.ia = a; R.ib = b;
+    }
+
+    /// record Meca::addSideSlidingLink()
+    void addSideSlidingLink(Interpolation const& a, Mecapoint const& b, real len, real w)
+    {
+        Record& R = next(SIDE_SLIDING_IM, len, w); R.ia = a; R.pb = b;
+    }
+
+    /// record Meca::addSideSlidingLink()
+    void addSideSlidingLink(Interpolation const& a, Interpolation const& b, real len, real w)
+    {
+        Record& R = next(SIDE_SLIDING_II, len, w); R.ia = a; R.ib = b;
+    }
+
+    /// record Meca::addPointClamp()
+    void addPointClamp(Mecapoint const& a, Vector g, real w)
+    {
+        Record& R = next(CLAMP_M, 0, w); R.pa = a; R.pos = g;
+    }
+
+    /// record Meca::addPointClamp()
+    void addPointClamp(Interpolation const& a, Vector g, real w)
+    {
+        Record& R = next(CLAMP_I, 0, w); R.ia = a; R.pos = g;
+    }
+};
+
+#endif
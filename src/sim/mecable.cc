@@ -8,6 +8,9 @@
 #include "space.h"
 
 
+thread_local RealArena Mecable::arena("mecable");
+
+
 //------------------------------------------------------------------------------
 /**
 clear pointers
@@ -15,15 +18,24 @@ clear pointers
 void Mecable::clearMecable()
 {
     pAllocated = 0;
+    pShared    = 0;
     nPoints    = 0;
     pBlock     = nullptr;
     pPivot     = nullptr;
     pBlockAlc  = 0;
+    pPivotAlc  = 0;
     pBlockUse  = false;
     pBlockSize = 0;
+    pBlockAge  = ~0U;
     pPos       = nullptr;
     pForce     = nullptr;
     pIndex     = -1;  // that is an invalid value
+    pIndexOld[0] = 0;
+    pIndexOld[1] = 0;
+    nPointsOld[0] = 0;
+    nPointsOld[1] = 0;
+    pOrder     = 0;
+    pIsolated  = false;
 }
 
 
@@ -52,22 +64,27 @@ Mecable& Mecable::operator =(const Mecable& o)
  object is probably growing.
 
  */
-void Mecable::allocateBlock()
+void Mecable::allocateBlock(size_t len)
 {
     pBlockSize = DIM * nPoints;
     
-    if ( pBlockSize > pBlockAlc )
+    if ( len > pBlockAlc )
+    {
+        arena.release(reinterpret_cast<real*>(pBlock));
+        // the block is allocated as reals, since block_real may be float:
+        size_t all = chunk_real(( len * sizeof(block_real) + sizeof(real) - 1 ) / sizeof(real));
+        //std::clog << "Mecable("<<reference()<<")::allocateBlock " << all << "\n";
+        real * mem = arena.allocate(all);
+        pBlock = reinterpret_cast<block_real*>(mem);
+        pBlockAlc = RealArena::capacity(mem) * sizeof(real) / sizeof(block_real);
+    }
+    
+    if ( pBlockSize > pPivotAlc )
     {
-        free_real(pBlock);
         delete[] pPivot;
-        size_t bum = chunk_real(pBlockSize);
-        //std::clog << "Mecable("<<reference()<<")::allocateBlock " << bum << "\n";
-   
-        pBlock = new_real(bum*bum);
-        pPivot = new int[bum];
-        pBlockAlc = bum;
-        
-        //zero_real(bum*bum, pBlock);
+        size_t all = chunk_real(pBlockSize);
+        pPivot = new int[all];
+        pPivotAlc = all;
     }
 }
 
@@ -81,41 +98,83 @@ size_t Mecable::allocateMecable(const size_t nbp)
     pForce = nullptr;
     if ( pAllocated < nbp )
     {
-        size_t all = chunk_real(nbp);
+        // allocate memory, using all the capacity, in multiples of 4 points:
+        real * mem = arena.allocate(DIM*chunk_real(nbp));
+        size_t all = ( RealArena::capacity(mem) / DIM ) & ~size_t(3);
         // std::clog << "mecable(" << reference() << ") allocates " << all << '\n';
-        
-        // allocate memory:
-        real * mem = new_real(DIM*all);
 
         // retain existing data:
         if ( pPos )
         {
             copy_real(DIM*nPoints, pPos, mem);
-            free_real(pPos);
+            if ( !pShared )
+                arena.release(pPos);
         }
         pPos = mem;
+        pShared = 0;
         pAllocated = all;
         return all;
     }
     
+    // the array provided by Meca only holds the points that it had:
+    if ( pShared && pShared < nbp )
+        ownPoints();
+    
     return 0;
 }
 
 
+/**
+ This is called by Meca if SimulProp::in_place is true, with an array that
+ already holds the coordinates of the points, and which is used until the
+ number of points increases, or Meca arranges its vectors differently.
+ The capacity `pAllocated` is not changed, such that the other arrays of the
+ derived classes that are allocated with the same size remain valid.
+ */
+void Mecable::sharePoints(real * ptr)
+{
+    if ( ptr != pPos )
+    {
+        if ( !pShared )
+            arena.release(pPos);
+        pPos = ptr;
+    }
+    pShared = nPoints;
+}
+
+
+/**
+ Copy the points to an array of capacity `pAllocated` that belongs to the object
+ */
+void Mecable::ownPoints()
+{
+    if ( pShared )
+    {
+        real * mem = arena.allocate(DIM*pAllocated);
+        copy_real(DIM*nPoints, pPos, mem);
+        pPos = mem;
+        pShared = 0;
+    }
+}
+
+
 void Mecable::release()
 {
-    free_real(pBlock);
+    arena.release(reinterpret_cast<real*>(pBlock));
     pBlock = nullptr;
     delete[] pPivot;
     pPivot = nullptr;
     
     pBlockAlc  = 0;
+    pPivotAlc  = 0;
     pBlockSize = 0;
     
-    free_real(pPos);
+    if ( !pShared )
+        arena.release(pPos);
     pPos = nullptr;
     
     pForce = nullptr;
+    pShared = 0;
     pAllocated = 0;
     nPoints = 0;
 }
@@ -196,6 +255,37 @@ void Mecable::resetPoints()
 }
 
 
+/**
+ This is the default implementation, calling the different steps in turn.
+ */
+void Mecable::applyDynamics(real alpha, const real* X, real* Y) const
+{
+#if ( DIM > 1 )
+    addRigidity(X, Y);
+#endif
+    
+    if ( hasProjectionDiff() )
+        addProjectionDiff(X, Y);
+    
+    projectForces(Y, Y);
+    
+    // Y <- X + alpha * Y
+    blas::xpay(DIM*nPoints, X, alpha*leftoverMobility(), Y);
+}
+
+
+real Mecable::projectBrownianForces(real const* rnd, real alpha, real* F, real beta, real* R) const
+{
+    real n = addBrownianForces(rnd, alpha, F);
+    
+    projectForces(F, R);
+    
+    // R <- beta * leftoverMobility() * R
+    blas::xscal(DIM*nPoints, beta*leftoverMobility(), R, 1);
+    return n;
+}
+
+
 void Mecable::addNoise(const real amount)
 {
     for ( unsigned int p = 0; p < DIM*nPoints; ++p )
@@ -223,13 +313,15 @@ void Mecable::rotate(Rotation const& T)
 
 void Mecable::putPoints(real * ptr) const
 {
-    copy_real(DIM*nPoints, pPos, ptr);
+    if ( ptr != pPos )
+        copy_real(DIM*nPoints, pPos, ptr);
 }
 
 
 void Mecable::getPoints(const real * ptr)
 {
-    copy_real(DIM*nPoints, ptr, pPos);
+    if ( ptr != pPos )
+        copy_real(DIM*nPoints, ptr, pPos);
 }
 
 
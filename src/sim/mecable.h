@@ -9,11 +9,30 @@
 #include "matrix.h"
 #include "buddy.h"
 #include "sim.h"
+#include "real_arena.h"
 
 class Meca;
 class MatrixSparseSymmetric1;
 
 
+/**
+ Set to 1 to store the blocks of the preconditionner in single precision.
+ The blocks are calculated and factorized in double precision, and the
+ iterative solver in Meca::solve() still works on double precision vectors,
+ but this halves the memory used by the preconditionner, and the memory
+ bandwidth needed to apply it at each iteration.
+ */
+#define MECABLE_FLOAT_BLOCK 0
+
+#if MECABLE_FLOAT_BLOCK
+/// type of the scalars used to store the preconditionner blocks
+typedef float block_real;
+#else
+/// type of the scalars used to store the preconditionner blocks
+typedef real block_real;
+#endif
+
+
 /// Can be simulated using a Meca.
 /**
  A Mecable is an Object made of points that can can be simulated in a Meca.
@@ -52,8 +71,11 @@ private:
     /// Currently allocated size of arrays pPos[]
     size_t      pAllocated;
 
+    /// Number of points that pPos[] can hold, if it belongs to Meca, or zero
+    size_t      pShared;
+
     /// Matrix block used for preconditionning in Meca::solve()
-    real *      pBlock;
+    block_real* pBlock;
     
     /// Pivot indices for LAPACK
     int *       pPivot;
@@ -61,18 +83,41 @@ private:
     /// Allocated size of pBlock[]
     size_t      pBlockAlc;
     
+    /// Allocated size of pPivot[]
+    size_t      pPivotAlc;
+    
     /// Current size of pBlock[]
     unsigned    pBlockSize;
     
     /// Flag that pBlock[] is used for preconditionning
     int         pBlockUse;
     
+    /// Number of calls to Meca::solve() since pBlock[] was factorized
+    unsigned    pBlockAge;
+    
     /// Index that Object coordinates occupy in the matrices and vectors of Meca
     index_t     pIndex;
+    
+    /// Index occupied at the two previous calls to Meca::solve()
+    index_t     pIndexOld[2];
+    
+    /// Number of points at the two previous calls to Meca::solve()
+    unsigned    nPointsOld[2];
+
+    /// Key used by Meca to order the Mecables (see SimulProp::reorder)
+    size_t      pOrder;
+
+    /// True if the Mecable did not interact with any other Mecable at the last call to Meca::solve()
+    bool        pIsolated;
 
     /// Clear pointers
     void        clearMecable();
     
+public:
+    
+    /// memory of the arrays of all Mecables, which grow and shrink frequently
+    static thread_local RealArena arena;
+
 public:
 
     /// The constructor resets the pointers to memory
@@ -128,6 +173,21 @@ public:
     /// replace current coordinates by values from the given array
     virtual void    getPoints(real const*);
     
+    /// use the given array, which holds the current coordinates, to store the points
+    void            sharePoints(real*);
+    
+    /// store the points in memory that belongs to the object
+    void            ownPoints();
+    
+    /// true if the points are stored in memory that belongs to Meca
+    bool            sharedPoints() const { return pShared; }
+    
+    /// size of the block used for preconditionning, which is obtained from `arena`, in bytes
+    size_t          blockMemory() const { return pBlockAlc * sizeof(block_real); }
+    
+    /// size of the pivots used for preconditionning, in bytes
+    size_t          pivotMemory() const { return pPivotAlc * sizeof(int); }
+    
     /// Add a point and expand the object, returning the array index that was used
     unsigned        addPoint(Vector const& w);
     
@@ -272,8 +332,42 @@ public:
      */
     index_t         matIndex()           const { return pIndex; }
     
+    /// Record current matIndex() and nbPoints(), shifting the values from previous call
+    void            keepMatIndex() { pIndexOld[1] = pIndexOld[0]; nPointsOld[1] = nPointsOld[0]; pIndexOld[0] = pIndex; nPointsOld[0] = nPoints; }
+    
+    /// Index that was recorded by the last `n+1` call to keepMatIndex(), or ~0 if nbPoints() has changed since then
+    index_t         oldMatIndex(int n)   const { return ( nPointsOld[n] == nPoints ) ? pIndexOld[n] : ~0U; }
+    
+    /// copy the values recorded by keepMatIndex() into `idx[4]`
+    void            getOldMatIndex(uint32_t idx[4]) const { idx[0] = pIndexOld[0]; idx[1] = nPointsOld[0]; idx[2] = pIndexOld[1]; idx[3] = nPointsOld[1]; }
+    
+    /// restore the values recorded by keepMatIndex(), from `idx[4]`
+    void            setOldMatIndex(uint32_t const idx[4]) { pIndexOld[0] = idx[0]; nPointsOld[0] = idx[1]; pIndexOld[1] = idx[2]; nPointsOld[1] = idx[3]; }
+    
+    /// Key used to order the Mecables in Meca
+    size_t          orderKey()           const { return pOrder; }
+    
+    /// set key used to order the Mecables in Meca
+    void            orderKey(size_t k) { pOrder = k; }
+    
+    /// true if the Mecable was not coupled to other Mecables at the last step (see SimulProp::isolate)
+    bool            isolated()           const { return pIsolated; }
+    
+    /// set flag indicating that the Mecable is not coupled to other Mecables
+    void            isolated(bool b) { pIsolated = b; }
+
     /// Allocates pBlock[] to hold a `N x N` full matrix, where N = DIM * nbPoints()
-    void            allocateBlock();
+    void            allocateBlock() { allocateBlock(DIM*nPoints*DIM*nPoints); }
+    
+    /// Allocates pBlock[] to hold `len` scalars, and pivot() for `N = DIM * nbPoints()`
+    void            allocateBlock(size_t len);
+    
+    /// Number of neighboring points that are significantly coupled in the preconditionner block
+    /**
+     This is used to approximate the preconditionner block by a band matrix.
+     The default value (0) indicates that the block should be treated as dense.
+     */
+    virtual unsigned blockBandwidth()    const { return 0; }
     
     /// True if preconditionner block is 'in use'
     int             useBlock()           const { return pBlockUse; }
@@ -285,10 +379,16 @@ public:
     unsigned        blockSize()          const { return pBlockSize; }
     
     /// Returns address of memory allocated for preconditionning
-    real *          block()              const { return pBlock; }
+    block_real *    block()              const { return pBlock; }
     
     /// Returns address of memory allocated for preconditionning (pivot)
     int *           pivot()              const { return pPivot; }
+    
+    /// Number of calls to Meca::solve() since the preconditionner block was factorized
+    unsigned        blockAge()           const { return pBlockAge; }
+    
+    /// Set the age of the preconditionner block
+    void            blockAge(unsigned a)       { pBlockAge = a; }
 
     //--------------------------------------------------------------------------
     
@@ -335,6 +435,41 @@ public:
     
     /// Return drag coefficient that was not applied by projectForces()
     virtual real    leftoverMobility() const { return 1.0; }
+    
+    /// Number of generalized velocities of a Mecable that only moves as a rigid body, or 0
+    /**
+     If this is `R > 0`, the projection has rank R and is factored as
+     
+         projectForces(X) = G * rigidVelocity(X)
+     
+     where `G` maps the R generalized velocities to the motion of the points,
+     as calculated by addRigidMotion(). Meca then calculates the preconditionner
+     block in these reduced coordinates, instead of factorizing a dense block.
+     */
+    virtual unsigned rigidRank() const { return 0; }
+    
+    /// Calculate the `rigidRank()` generalized velocities `V` resulting from the forces `X`
+    virtual void    rigidVelocity(const real* X, real* V) const {}
+    
+    /// Add the motion of the points resulting from the generalized velocities: Y <- Y + G * V
+    virtual void    addRigidMotion(const real* V, real* Y) const {}
+    
+    /// Calculate Y <- X + alpha * leftoverMobility() * projectForces( Y + Rigidity * X + P' * X )
+    /**
+     This combines addRigidity(), addProjectionDiff(), projectForces() and the
+     scaling by leftoverMobility(), as needed for the Matrix * Vector in Meca.
+     A derived class may override this to perform the same steps in fewer sweeps.
+     */
+    virtual void    applyDynamics(real alpha, const real* X, real* Y) const;
+    
+    /// Add Brownian forces to `F`, and calculate R <- beta * leftoverMobility() * projectForces(F)
+    /**
+     This combines addBrownianForces(), projectForces() and the scaling by
+     leftoverMobility(), as needed to set the right-hand side of the system in Meca.
+     A derived class may override this to perform the same steps in fewer sweeps.
+     Returns the value given by addBrownianForces().
+     */
+    virtual real    projectBrownianForces(real const* rnd, real alpha, real* F, real beta, real* R) const;
 
     //--------------------------------------------------------------------------
 
@@ -8,6 +8,22 @@
 #include "matsparsesym1.h"
 #include "random.h"
 #include "vecprint.h"
+#include "simd.h"
+
+/**
+ Use explicit SIMD implementations of the rigidity (SSE3/NEON or AVX).
+ With -march=native, the compiler's vectorization of add_rigidityF() is
+ currently faster, as measured with `test_code`, hence this is off by default.
+ */
+#define RIGIDITY_USES_SIMD 0
+
+#define RIGIDITY_USES_SSE ( RIGIDITY_USES_SIMD && VEC2_IS_AVAILABLE && REAL_IS_DOUBLE )
+
+#if RIGIDITY_USES_SIMD && defined(__AVX__) && REAL_IS_DOUBLE
+#  define RIGIDITY_USES_AVX 1
+#else
+#  define RIGIDITY_USES_AVX 0
+#endif
 
 //------------------------------------------------------------------------------
 Mecafil::Mecafil()
@@ -19,13 +35,14 @@ Mecafil::Mecafil()
     rfLag  = nullptr;
     rfLLG  = nullptr;
     rfVTP  = nullptr;
+    rfLagValid = false;
 }
 
 
 Mecafil::~Mecafil()
 {
     destroyProjection();
-    free_real(rfDiff);
+    arena.release(rfDiff);
     rfDiff = nullptr;
     rfLag  = nullptr;
     rfLLG  = nullptr;
@@ -60,9 +77,9 @@ size_t Mecafil::allocateMecable(const size_t nbp)
         allocateProjection(ms);
         
         // allocate memory:
-        free_real(rfDiff);
+        arena.release(rfDiff);
         
-        rfDiff = new_real(ms*(2*DIM+1));
+        rfDiff = arena.allocate(ms*(2*DIM+1));
         rfLag  = rfDiff + ms*DIM;
         rfLLG  = rfLag + ms;
         
@@ -74,7 +91,7 @@ size_t Mecafil::allocateMecable(const size_t nbp)
 
 void Mecafil::release()
 {
-    free_real(rfDiff);
+    arena.release(rfDiff);
     rfDiff = nullptr;
 }
 
@@ -149,7 +166,7 @@ void Mecafil::projectForces(const real* X, real* Y) const
         Y[ii] = sum;
 }
 
-void Mecafil::computeTensions(const real*) {} //DIM == 1
+void Mecafil::computeTensions(const real*) { rfLagValid = true; } //DIM == 1
 void Mecafil::makeProjectionDiff(const real*) {} //DIM == 1
 void Mecafil::addProjectionDiff(const real*, real*) const {} //DIM == 1
 
@@ -246,13 +263,29 @@ void add_rigidity0(const unsigned nbt, const real* X, const real rigid, real* Y)
     }
 }
 
+/// terms of the first two points, and of the last two points
+inline void add_rigidity_edges(const unsigned nbt, const real* X, const real R1, real* Y)
+{
+    const real R2 = R1 * 2;
+    const real R4 = R1 * 4;
+    real      * Z = Y + nbt + DIM;
+    real const* E = X + nbt + DIM;
+    #pragma ivdep
+    for ( int d = 0; d < DIM; ++d )
+    {
+        Y[d    ] -= R1 * (X[d+DIM*2]+X[d]) - R2 * X[d+DIM];
+        Y[d+DIM] -= R1 * (X[d+DIM]+X[d+DIM*3]) + R4 * (X[d+DIM]-X[d+DIM*2]) - R2 * X[d];
+        Z[d-DIM] -= R1 * (E[d-DIM]+E[d-DIM*3]) + R4 * (E[d-DIM]-E[d-DIM*2]) - R2 * E[d];
+        Z[d    ] -= R1 * (E[d-DIM*2]+E[d]) - R2 * E[d-DIM];
+    }
+}
+
 /*
  This is an optimized implementation
  */
 void add_rigidityF(const unsigned nbt, const real* X, const real R1, real* Y)
 {
     assert_true(nbt > DIM);
-    const real R2 = R1 * 2;
     const real R4 = R1 * 4;
     const real R6 = R1 * 6;
     
@@ -262,17 +295,68 @@ void add_rigidityF(const unsigned nbt, const real* X, const real R1, real* Y)
         Y[i] += R4 * (X[i-DIM]+X[i+DIM]) - R1 * (X[i-DIM*2]+X[i+DIM*2]) - R6 * X[i];
     
     // special cases near the edges:
-    real      * Z = Y + nbt + DIM;
-    real const* E = X + nbt + DIM;
-    #pragma ivdep
-    for ( int d = 0; d < DIM; ++d )
+    add_rigidity_edges(nbt, X, R1, Y);
+}
+
+
+#if RIGIDITY_USES_SSE
+/*
+ Implementation with 2 scalars per SIMD register.
+ Since the offsets are multiples of DIM known at compile time, the same code
+ applies in any dimension, with unaligned accesses if DIM is odd.
+ The operations are done in the same order as in add_rigidityF()
+ */
+void add_rigiditySSE(const unsigned nbt, const real* X, const real R1, real* Y)
+{
+    assert_true(nbt > DIM);
+    const vec2 R1s = set2(R1);
+    const vec2 R4s = set2(R1 * 4);
+    const vec2 R6s = set2(R1 * 6);
+    
+    int i = DIM*2;
+    const int end = nbt;
+    for ( ; i+1 < end; i += 2 )
     {
-        Y[d    ] -= R1 * (X[d+DIM*2]+X[d]) - R2 * X[d+DIM];
-        Y[d+DIM] -= R1 * (X[d+DIM]+X[d+DIM*3]) + R4 * (X[d+DIM]-X[d+DIM*2]) - R2 * X[d];
-        Z[d-DIM] -= R1 * (E[d-DIM]+E[d-DIM*3]) + R4 * (E[d-DIM]-E[d-DIM*2]) - R2 * E[d];
-        Z[d    ] -= R1 * (E[d-DIM*2]+E[d]) - R2 * E[d-DIM];
+        vec2 s = mul2(R4s, add2(loadu2(X+i-DIM), loadu2(X+i+DIM)));
+        s = sub2(s, mul2(R1s, add2(loadu2(X+i-DIM*2), loadu2(X+i+DIM*2))));
+        s = sub2(s, mul2(R6s, loadu2(X+i)));
+        storeu2(Y+i, add2(loadu2(Y+i), s));
     }
+    if ( i < end )
+        Y[i] += R1 * 4 * (X[i-DIM]+X[i+DIM]) - R1 * (X[i-DIM*2]+X[i+DIM*2]) - R1 * 6 * X[i];
+    
+    add_rigidity_edges(nbt, X, R1, Y);
 }
+#endif
+
+
+#if RIGIDITY_USES_AVX
+/*
+ Implementation with 4 scalars per SIMD register, see add_rigiditySSE()
+ */
+void add_rigidityAVX(const unsigned nbt, const real* X, const real R1, real* Y)
+{
+    assert_true(nbt > DIM);
+    const vec4 R1s = set4(R1);
+    const vec4 R4s = set4(R1 * 4);
+    const vec4 R6s = set4(R1 * 6);
+    
+    int i = DIM*2;
+    const int end = nbt;
+    for ( ; i+3 < end; i += 4 )
+    {
+        vec4 s = mul4(R4s, add4(loadu4(X+i-DIM), loadu4(X+i+DIM)));
+        s = sub4(s, mul4(R1s, add4(loadu4(X+i-DIM*2), loadu4(X+i+DIM*2))));
+        s = sub4(s, mul4(R6s, loadu4(X+i)));
+        storeu4(Y+i, add4(loadu4(Y+i), s));
+    }
+    for ( ; i < end; ++i )
+        Y[i] += R1 * 4 * (X[i-DIM]+X[i+DIM]) - R1 * (X[i-DIM*2]+X[i+DIM*2]) - R1 * 6 * X[i];
+    
+    add_rigidity_edges(nbt, X, R1, Y);
+}
+#endif
+
 
 /**
  Add rigidity terms between three points {A, B, C}
@@ -299,7 +383,13 @@ void Mecafil::addRigidity(const real* X, real* Y) const
 {
     if ( nPoints > 3 )
     {
+#if RIGIDITY_USES_AVX
+        add_rigidityAVX(DIM*(nPoints-2), X, rfRigidity, Y);
+#elif RIGIDITY_USES_SSE
+        add_rigiditySSE(DIM*(nPoints-2), X, rfRigidity, Y);
+#else
         add_rigidityF(DIM*(nPoints-2), X, rfRigidity, Y);
+#endif
     
 #if NEW_FIBER_LOOP
         if ( rfRigidityLoop )
@@ -321,3 +411,179 @@ void Mecafil::addRigidity(const real* X, real* Y) const
     }
 }
 
+
+#if ( DIM > 1 )
+
+/**
+ Calculates Y <- X + alpha * mobility * projectForces( Y + Rigidity * X + P' * X )
+ 
+ This is equivalent to Mecable::applyDynamics(), but with fewer sweeps:
+ - the projection correction, Y <- Y + P' * X, the first half of the projection,
+   lag <- J * Y, and the forward substitution of the tridiagonal solve
+   lag <- inv( J * Jt ) * lag are done together in one forward sweep,
+ - the backward substitution, the second half of the projection, Y <- Y + Jt * lag,
+   and the final scaling are done together in one backward sweep.
+ .
+ The operations are performed in the same order as in lapack::xptts2(),
+ and the multipliers are left in rfLLG, as with projectForces().
+ */
+void Mecafil::applyDynamics(real alpha, const real* X, real* Y) const
+{
+    const unsigned nbs = nbSegments();
+    if ( nbs < 2 )
+    {
+        Mecable::applyDynamics(alpha, X, Y);
+        return;
+    }
+    
+    const real * dif = rfDiff;
+    const real * E = mtJJtU;
+    real * lag = rfLLG;
+
+    addRigidity(X, Y);
+    
+    const real * mul = ( useProjectionDiff ? mtJJtiJforce : nullptr );
+    real pw[DIM] = { 0 };
+    real L = 0;
+    
+    // Y <- Y + P' * X, for the first vertex
+    if ( mul )
+    {
+        for ( int d = 0; d < DIM; ++d )
+        {
+            pw[d] = mul[0] * ( X[d+DIM] - X[d] );
+            Y[d] += pw[d];
+        }
+    }
+    
+    for ( unsigned jj = 1; jj <= nbs; ++jj )
+    {
+        real * y = Y + DIM * jj;
+        
+        // Y <- Y + P' * X
+        if ( mul )
+        {
+            real const* x = X + DIM * jj;
+            for ( int d = 0; d < DIM; ++d )
+            {
+                real w = ( jj < nbs ? mul[jj] * ( x[d+DIM] - x[d] ) : 0 );
+                y[d] += w - pw[d];
+                pw[d] = w;
+            }
+        }
+        
+        // lag <- J * Y, with forward substitution
+        const real * e = dif + DIM * jj - DIM;
+        real T = e[0] * ( y[0] - y[-DIM] )
+               + e[1] * ( y[1] - y[1-DIM] )
+#if ( DIM > 2 )
+               + e[2] * ( y[2] - y[2-DIM] )
+#endif
+        ;
+        L = ( jj > 1 ? T - L * E[jj-2] : T );
+        lag[jj-1] = L;
+    }
+    
+    // backward substitution, followed by Y <- X + beta * ( Y + Jt * lag )
+    const real * D = mtJJt;
+    const real beta = alpha * rfPointMobility;
+    
+    L = L / D[nbs-1];
+    lag[nbs-1] = L;
+    for ( unsigned d = 0, e = DIM*nbs; d < DIM; ++d, ++e )
+        Y[e] = X[e] + beta * ( Y[e] - dif[e-DIM] * L );
+    
+    for ( unsigned jj = nbs-1; jj > 0; --jj )
+    {
+        const real P = lag[jj-1] / D[jj-1] - L * E[jj-1];
+        lag[jj-1] = P;
+        const unsigned kk = DIM*jj;
+        Y[kk  ] = X[kk  ] + beta * ( Y[kk  ] + dif[kk  ] * L - dif[kk-DIM  ] * P );
+        Y[kk+1] = X[kk+1] + beta * ( Y[kk+1] + dif[kk+1] * L - dif[kk-DIM+1] * P );
+#if ( DIM > 2 )
+        Y[kk+2] = X[kk+2] + beta * ( Y[kk+2] + dif[kk+2] * L - dif[kk-DIM+2] * P );
+#endif
+        L = P;
+    }
+    
+    for ( int d = 0; d < DIM; ++d )
+        Y[d] = X[d] + beta * ( Y[d] + dif[d] * L );
+}
+
+
+/**
+ Calculates F <- F + Brownian, and R <- beta * mobility * projectForces(F)
+ 
+ This is equivalent to Mecable::projectBrownianForces(), but with fewer sweeps:
+ - the addition of the Brownian forces, the first half of the projection,
+   lag <- J * F, and the forward substitution of the tridiagonal solve
+   are done together in one forward sweep,
+ - the backward substitution, the second half of the projection, R <- F + Jt * lag,
+   and the scaling are done together in one backward sweep.
+ .
+ The multipliers are left in rfLLG, as with projectForces().
+ */
+real Mecafil::projectBrownianForces(real const* rnd, real alpha, real* F, real beta, real* R) const
+{
+    const unsigned nbs = nbSegments();
+    if ( nbs < 2 )
+        return Mecable::projectBrownianForces(rnd, alpha, F, beta, R);
+    
+    const real * dif = rfDiff;
+    const real * E = mtJJtU;
+    real * lag = rfLLG;
+    const real b = sqrt( 2 * alpha / rfPointMobility );
+    
+    for ( int d = 0; d < DIM; ++d )
+        F[d] += b * rnd[d];
+    
+    real L = 0;
+    for ( unsigned jj = 1; jj <= nbs; ++jj )
+    {
+        real * f = F + DIM * jj;
+        real const* r = rnd + DIM * jj;
+        for ( int d = 0; d < DIM; ++d )
+            f[d] += b * r[d];
+        
+        // lag <- J * F, with forward substitution
+        const real * e = dif + DIM * jj - DIM;
+        real T = e[0] * ( f[0] - f[-DIM] )
+               + e[1] * ( f[1] - f[1-DIM] )
+#if ( DIM > 2 )
+               + e[2] * ( f[2] - f[2-DIM] )
+#endif
+        ;
+        L = ( jj > 1 ? T - L * E[jj-2] : T );
+        lag[jj-1] = L;
+    }
+    
+    // backward substitution, followed by R <- beta * ( F + Jt * lag )
+    const real * D = mtJJt;
+    const real s = beta * rfPointMobility;
+    
+    L = L / D[nbs-1];
+    lag[nbs-1] = L;
+    for ( unsigned d = 0, e = DIM*nbs; d < DIM; ++d, ++e )
+        R[e] = s * ( F[e] - dif[e-DIM] * L );
+    
+    for ( unsigned jj = nbs-1; jj > 0; --jj )
+    {
+        const real P = lag[jj-1] / D[jj-1] - L * E[jj-1];
+        lag[jj-1] = P;
+        const unsigned kk = DIM*jj;
+        R[kk  ] = s * ( F[kk  ] + dif[kk  ] * L - dif[kk-DIM  ] * P );
+        R[kk+1] = s * ( F[kk+1] + dif[kk+1] * L - dif[kk-DIM+1] * P );
+#if ( DIM > 2 )
+        R[kk+2] = s * ( F[kk+2] + dif[kk+2] * L - dif[kk-DIM+2] * P );
+#endif
+        L = P;
+    }
+    
+    for ( int d = 0; d < DIM; ++d )
+        R[d] = s * ( F[d] + dif[d] * L );
+    
+    return b * rfPointMobility;
+}
+
+#endif
+
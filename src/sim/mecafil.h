@@ -7,6 +7,9 @@
 
 class Matrix;
 
+/// number of neighboring vertices retained in the banded preconditionner (precondition=2)
+#define MECAFIL_BANDWIDTH 16
+
 /// incompressible Filament with bending elasticity
 /**
  Implements the methods of a Mecable for the Chain:
@@ -43,6 +46,9 @@ private:
     /// true if all elements of mtJJtiJforce[] are null
     bool        useProjectionDiff;
     
+    /// true if rfLag[] corresponds to the current vertices
+    bool        rfLagValid;
+    
 protected:
     
     /// mobility of the points (all points have the same drag coefficient)
@@ -93,6 +99,12 @@ public:
     /// compute Lagrange multipliers associated with length constraints, given the force
     void        computeTensions(const real* force);
     
+    /// true if the tensions were calculated for the current vertices
+    bool        hasTensions() const { return rfLagValid; }
+    
+    /// signal that the tensions should not be used, as the vertices have changed
+    void        invalidateTensions() { rfLagValid = false; }
+    
     /// debug output
     void        printTensions(FILE *, char = ' ') const;
     
@@ -137,6 +149,14 @@ public:
     /// calculate the speeds from the forces, including projection
     void        projectForces(const real* X, real* Y) const;
     
+#if ( DIM > 1 )
+    /// fused implementation of rigidity, projection and mobility, for Meca::multiply()
+    void        applyDynamics(real alpha, const real* X, real* Y) const;
+    
+    /// fused implementation of Brownian forces, projection and mobility, for Meca::setRightHandSide()
+    real        projectBrownianForces(real const* rnd, real alpha, real* F, real beta, real* R) const;
+#endif
+    
     /// print projection matrix
     void        printProjection(std::ostream&) const;
 
@@ -147,6 +167,9 @@ public:
     
     /// add rigidity terms to upper side of matrix
     void        addRigidityUpper(real*, unsigned) const;
+    
+    /// the rigidity couples vertices that are 2 apart, but the projection extends this range
+    unsigned    blockBandwidth() const { return MECAFIL_BANDWIDTH; }
 
 };
 
@@ -2,6 +2,7 @@
 
 #include "exceptions.h"
 #include "vecprint.h"
+#include "simd.h"
 
 
 void Mecafil::buildProjection()
@@ -15,8 +16,8 @@ void Mecafil::buildProjection()
 void Mecafil::allocateProjection(const size_t ms)
 {
     //std::clog << reference() << "allocateProjection(" << nbp << ")\n";
-    free_real(mtJJt);
-    real * mem = new_real(4*ms);
+    arena.release(mtJJt);
+    real * mem = arena.allocate(4*ms);
     //zero_real(4*ms, mem);
     mtJJt        = mem;
     mtJJtU       = mem + ms * 2;
@@ -27,7 +28,7 @@ void Mecafil::allocateProjection(const size_t ms)
 void Mecafil::destroyProjection()
 {
     //std::clog << reference() << "destroyProjection\n";
-    free_real(mtJJt);
+    arena.release(mtJJt);
     mtJJt        = nullptr;
     mtJJtU       = nullptr;
     mtJJtiJforce = nullptr;
@@ -35,58 +36,69 @@ void Mecafil::destroyProjection()
 
 
 
-/// standard version with isotropic drag coefficient
+/**
+ Standard version with isotropic drag coefficient.
+ This sets the diagonal and off-diagonal of J*J', and factorizes this symmetric
+ tridiagonal matrix in the same sweep, with the operations of lapack::xpttrf()
+ */
 void Mecafil::makeProjection()
 {
     assert_true( nbPoints() >= 2 );
 
-    //set the diagonal and off-diagonal of J*J'
     const unsigned nbu = nbPoints() - 2;
     const real*const dif = rfDiff;
+    real off = 0;
 
-    for ( unsigned jj = 0; jj < nbu; ++jj )
+    for ( unsigned jj = 0; jj <= nbu; ++jj )
     {
         const real* X = dif + DIM * jj;
+        // the diagonal term should be nearly equal to 2, since dif[] vectors are normalized
 #if ( DIM == 2 )
-        real xn = X[0]*X[2] + X[1]*X[3];
+        real D = 2.0 * ( X[0]*X[0] + X[1]*X[1] );
 #else
-        real xn = X[0]*X[3] + X[1]*X[4] + X[2]*X[5];
+        real D = 2.0 * ( X[0]*X[0] + X[1]*X[1] + X[2]*X[2] );
 #endif
+        if ( jj > 0 )
+            D -= mtJJtU[jj-1] * off;
+        
+        if ( D <= 0 )
+        {
+            std::clog << "Mecafil::makeProjection failed (" << jj+1 << ")\n";
+            throw Exception("could not build Fiber's projection matrix");
+        }
+        mtJJt[jj] = D;
         
+        if ( jj < nbu )
+        {
 #if ( DIM == 2 )
-        mtJJt[jj] = 2.0 * ( X[0]*X[0] + X[1]*X[1] );
+            off = -( X[0]*X[2] + X[1]*X[3] );
 #else
-        mtJJt[jj] = 2.0 * ( X[0]*X[0] + X[1]*X[1] + X[2]*X[2] );
+            off = -( X[0]*X[3] + X[1]*X[4] + X[2]*X[5] );
 #endif
-        // the diagonal term should be nearly equal to 2, since dif[] vectors are normalized
-        //mtJJt[jj]  = 2.0;
-        mtJJtU[jj] = -xn;
+            mtJJtU[jj] = off / D;
+        }
     }
-    
-    const real* X = dif + DIM*nbu;
-#if ( DIM == 2 )
-    mtJJt[nbu] = 2.0 * ( X[0]*X[0] + X[1]*X[1] );
-#else
-    mtJJt[nbu] = 2.0 * ( X[0]*X[0] + X[1]*X[1] + X[2]*X[2] );
-#endif
-    // the diagonal term should be nearly equal to 2, since dif[] vectors are normalized
-    //mtJJt[nbu] = 2.0;
-
-    int info = 0;
-    lapack::xpttrf(nbu+1, mtJJt, mtJJtU, &info);
 
     if ( 0 )
     {
         std::clog << "D "; VecPrint::print(std::clog, nbu+1, mtJJt, 3);
         std::clog << "E "; VecPrint::print(std::clog, nbu, mtJJtU, 3);
-        //std::clog << "X="; VecPrint::print(std::clog, DIM*(nbu+2), pPos);
     }
+}
 
-    if ( info )
-    {
-        std::clog << "Mecafil::makeProjection failed (" << info << ")\n";
-        throw Exception("could not build Fiber's projection matrix");
-    }
+
+/**
+ Solve the tridiagonal system factorized by makeProjection(),
+ with the operations of lapack::xptts2(), for one right-hand side
+ */
+static inline void solveProjection(const unsigned N, const real* D, const real* E, real* B)
+{
+    for ( unsigned i = 1; i < N; ++i )
+        B[i] -= B[i-1] * E[i-1];
+    
+    B[N-1] /= D[N-1];
+    for ( unsigned i = N-1; i-- > 0; )
+        B[i] = B[i] / D[i] - B[i+1] * E[i];
 }
 
 //------------------------------------------------------------------------------
@@ -181,7 +193,7 @@ void projectForcesD__(unsigned nbs, const real* dif,
 }
 
 
-#if ( DIM == 2 ) && defined(__SSE3__) && REAL_IS_DOUBLE
+#if ( DIM == 2 ) && VEC2_IS_AVAILABLE && REAL_IS_DOUBLE
 
 #include "simd.h"
 
@@ -502,7 +514,7 @@ void projectForcesD_PTR(unsigned nbs, const real* dif,
 #    warning "Using AVX implementation"
 #    define projectForcesU projectForcesU_AVX
 #    define projectForcesD projectForcesD_AVX
-#  elif defined(__SSE3__)
+#  elif VEC2_IS_AVAILABLE
 #    warning "Using SSE3 implementation"
 #    define projectForcesU projectForcesU_SSE
 #    define projectForcesD projectForcesD_SSE
@@ -525,7 +537,7 @@ void Mecafil::projectForces(const real* X, real* Y) const
     projectForcesU(nbs, rfDiff, X, rfLLG);
 
     // rfLLG <- inv( J * Jt ) * rfLLG to find the Lagrange multipliers
-    lapack::xptts2(nbs, 1, mtJJt, mtJJtU, rfLLG, nbs);
+    solveProjection(nbs, mtJJt, mtJJtU, rfLLG);
     
     // set Y, using values in X and rfLLG
     projectForcesD(nbs, rfDiff, X, rfLLG, Y);
@@ -541,7 +553,8 @@ void Mecafil::computeTensions(const real* force)
     projectForcesU(nbs, rfDiff, force, rfLag);
     
     // tmp <- inv( J * Jt ) * tmp to find the multipliers
-    lapack::xptts2(nbs, 1, mtJJt, mtJJtU, rfLag, nbs);
+    solveProjection(nbs, mtJJt, mtJJtU, rfLag);
+    rfLagValid = true;
 }
 
 
@@ -705,7 +718,7 @@ inline void add_projectiondiffF(const unsigned nbs, const real* mul, const real*
 #endif
 }
 
-#if ( DIM == 2 ) && defined(__SSE3__) && REAL_IS_DOUBLE
+#if ( DIM == 2 ) && VEC2_IS_AVAILABLE && REAL_IS_DOUBLE
 
 #include "simd.h"
 
@@ -782,7 +795,7 @@ void Mecafil::addProjectionDiff(const real* X, real* Y) const
     add_projectiondiff(nbSegments(), mtJJtiJforce, X, vec);
 #endif
 
-#if ( DIM == 2 ) && defined(__SSE3__) && REAL_IS_DOUBLE
+#if ( DIM == 2 ) && VEC2_IS_AVAILABLE && REAL_IS_DOUBLE
     add_projectiondiffSSE(nbSegments(), mtJJtiJforce, X, Y);
     //add_projectiondiff(nbSegments(), mtJJtiJforce, X, Y);
     //add_projectiondiffAVX(nbSegments(), mtJJtiJforce, X, Y);
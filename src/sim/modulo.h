@@ -22,16 +22,19 @@ class Modulo
 {
 private:
     
-    /// the period in each dimension
+    /// the period in each dimension, or zero if it is not periodic
     real  mSize[4];
     
+    /// the inverse of the period in each dimension, or zero if it is not periodic
+    real  mInv[4];
+    
     /// bitfield indicating the dimensions that are periodic
     int   mMode;
 
 public:
     
     /// set as non periodic
-    void reset() { mMode = 0; for (int d=0; d<4; ++d) mSize[d] = 0; }
+    void reset() { mMode = 0; for (int d=0; d<4; ++d) { mSize[d] = 0; mInv[d] = 0; } }
     
     /// constructor
     Modulo() { reset(); }
@@ -40,7 +43,7 @@ public:
     ~Modulo() {}
     
     /// disable periodicity in all dimensions
-    void disable() { mMode = 0; }
+    void disable() { reset(); }
     
     /// enable periodicity in dimension 'd'
     void enable(size_t d, real size);
@@ -55,13 +58,26 @@ public:
     Vector period(size_t d) const;
     
     /// shift `pos` to its canonical image, which is the one closest to the origin
-    void   fold(Vector& pos) const;
+    /**
+     This is branchless: in the dimensions that are not periodic, mInv[d] = 0
+     and mSize[d] = 0, such that the coordinate is unchanged.
+     */
+    void   fold(Vector& pos) const
+    {
+        for ( int d = 0; d < DIM; ++d )
+            pos[d] -= mSize[d] * std::nearbyint(pos[d] * mInv[d]);
+    }
     
     /// shift `pos` to its image which is closest to `ref`
     void   fold(Vector& pos, Vector const& ref) const;
     
     /// return translation necessary to bring `pos` to its canonical image
-    Vector offset(Vector const& pos) const;
+    Vector offset(Vector const& pos) const
+    {
+        Vector img = pos;
+        fold(img);
+        return pos - img;
+    }
     
     /// set `pos` to its canonical image, and return offset = pos - fold(pos)
     void   foldOffset(Vector& pos, Vector& off) const;
@@ -96,36 +96,20 @@ std::string Object::reference() const
 
 
 /**
- Two binary formats are used:
- - A slim format:
+ In binary mode, a reference is written as:
      - 1 byte for the tag()
-     - 2 bytes for the identity
-     .
- - A fat format:
-     - 1 byte containing tag() + 128
-     - 4 bytes for the identity
+     - the identity, on 1 to 5 bytes (see Outputter::writeVarUInt)
      .
- .
+ Before format 53, the identity was written on 2 bytes, or on 4 bytes after
+ a tag() + 128 if it did not fit on 2 bytes.
  The ascii based format always the same.
  All formats are read by Simul::readReference()
  */
 void Object::writeReference(Outputter& out, ObjectTag g, ObjectID id)
 {
     assert_true( id > 0 );
-
-    if ( id > 65535 )
-    {
-        // long format (5 bytes)
-        // set the highest bit of the byte, which is not used by ASCII codes
-        out.writeChar(g, 128);
-        out.writeUInt32(id, 0);
-    }
-    else
-    {
-        // short format (3 bytes)
-        out.put_char(g);
-        out.writeUInt16(id, 0);
-    }
+    out.put_char(g);
+    out.writeVarUInt(id, 0);
 }
 
 
@@ -150,35 +134,37 @@ Writes the info that is common to all objects to file
  - A slim format:
      - 1 byte for the tag()
      - 1 byte for the index of the property
-     - 2 bytes for the identity
+     - the identity, on 1 to 5 bytes
      .
  - A fat format:
-     - the character '$' in binary mode
-     - 1 byte for the tag()
-     - 2 bytes for the index of the property
-     - 4 bytes for the identity
-     - 4 bytes for the mark
+     - 1 byte for the tag() + 128
+     - the index of the property, on 1 to 5 bytes
+     - the identity, on 1 to 5 bytes
+     - the mark, on 1 to 10 bytes
      .
  .
+ The integers are written with Outputter::writeVarUInt(), since format 53.
+ Before, the slim format used 2 bytes for the identity, and the fat format
+ 2 bytes for the property index, and 4 bytes for the identity and the mark.
  The ascii based format is invariant.
  */
 void Object::writeHeader(Outputter& out, ObjectTag g) const
 {
     if ( ! out.binary() )
         out.put_char('\n');
-    if ( identity() > 65535 || property()->number() > 255 || mark() )
+    if ( property()->number() > 255 || mark() )
     {
         // set the highest bit of the byte, which is not used by ASCII codes
         out.writeChar(g, 128);
-        out.writeUInt16(property()->number(), 0);
-        out.writeUInt32(identity(), ':');
-        out.writeUInt32(mark(), ':');
+        out.writeVarUInt(property()->number(), 0);
+        out.writeVarUInt(identity(), ':');
+        out.writeVarUInt(mark(), ':');
     }
     else
     {
         out.put_char(g);
         out.writeUInt8(property()->number(), 0);
-        out.writeUInt16(identity(), ':');
+        out.writeVarUInt(identity(), ':');
     }
 }
 
@@ -188,7 +174,21 @@ void Object::readHeader(Inputter& in, bool fat, unsigned& ix, ObjectID& id, Obje
     if ( in.binary() )
     {
         // read header in binary format
-        if ( fat )
+        if ( in.formatID() > 52 )
+        {
+            if ( fat )
+            {
+                ix = (unsigned)in.readVarUInt();
+                id = (ObjectID)in.readVarUInt();
+                mk = in.readVarUInt();
+            }
+            else
+            {
+                ix = in.readUInt8();
+                id = (ObjectID)in.readVarUInt();
+            }
+        }
+        else if ( fat )
         {
             ix = in.readUInt16();
             id = in.readUInt32();
@@ -210,19 +210,13 @@ void Object::readHeader(Inputter& in, bool fat, unsigned& ix, ObjectID& id, Obje
     else
     {
         // read header in text format
-        FILE * file = in.file();
-        if ( 1 != fscanf(file, "%u", &ix) )
-            throw InvalidIO("invalid Object header");
+        ix = in.readUInt32();
         if ( in.get_char() != ':' )
             throw InvalidIO("invalid Object header");
-        if ( 1 != fscanf(file, "%u", &id) )
-            throw InvalidIO("invalid Object header");
+        id = in.readUInt32();
         int c = in.get_char();
         if ( c == ':' )
-        {
-            if ( 1 != fscanf(file, "%lu", &mk) )
-            throw InvalidIO("invalid Object header");
-        }
+            mk = in.readUInt64();
         else
             in.unget(c);
     }
@@ -4,13 +4,14 @@
 #include "object_set.h"
 #include "exceptions.h"
 #include "iowrapper.h"
+#include "delta_filter.h"
 #include "glossary.h"
 #include "modulo.h"
 #include "space.h"
 #include "simul.h"
 #include <errno.h>
 
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 //------------------------------------------------------------------------------
 
@@ -353,6 +354,71 @@ Object* ObjectSet::findObject(std::string spec, const std::string& title) const
 }
 
 
+bool ObjectSet::mixNow()
+{
+    if ( mixMethod <= 0 || ++mixCounter < mixPeriod )
+        return false;
+    mixCounter = 0;
+    return true;
+}
+
+
+bool ObjectSet::sortNow()
+{
+    if ( sortPeriod == 0 || ++sortCounter < sortPeriod )
+        return false;
+    sortCounter = 0;
+    return true;
+}
+
+
+/**
+ The order of the cells, and the order of the Objects within each cell are random.
+ */
+void ObjectSet::sortByCell(NodeList& list, uint32_t salt) const
+{
+    FiberGrid const& grid = simul.fiberGrid;
+    if ( !grid.hasGrid() || list.size() < 2 )
+        return;
+    std::vector<unsigned long long> key(list.size());
+    for ( size_t i = 0; i < list.size(); ++i )
+    {
+        Object const* obj = static_cast<Object const*>(list.node(i));
+        key[i] = sortKey(grid.cellIndex(obj->position()), salt);
+    }
+    list.sort_keys(key.data());
+}
+
+
+/**
+ The methods are:
+ - 1: NodeList::shuffle(), which moves a random portion of the list, and
+   requires to traverse the list up to two random positions,
+ - 2: NodeList::shuffle_all(), a complete Fisher-Yates permutation,
+   using one random number per Object, 
+ - 3: NodeList::rotate(), which starts the list at a random Object, in
+   constant time, followed by NodeList::reverse() with probability 1/2.
+ .
+ */
+void ObjectSet::mix(NodeList& list) const
+{
+    switch ( mixMethod )
+    {
+        case 1:
+            list.shuffle();
+            break;
+        case 2:
+            list.shuffle_all();
+            break;
+        case 3:
+            list.rotate();
+            if ( RNG.flip() )
+                list.reverse();
+            break;
+    }
+}
+
+
 /**
  return the first object encountered with the given property,
  but it can be any one of them, since the lists are regularly
@@ -460,15 +526,22 @@ void ObjectSet::prune(NodeList const& list, ObjectFlag f, ObjectFlag g)
 
 /**
  Write Reference and Object's data, for all Objects in `list`
+ If the Outputter has a DeltaFilter, the records are identified by tag and identity,
+ and those that are identical to the previous frame are omitted.
  */
 void ObjectSet::writeNodes(Outputter& out, NodeList const& list)
 {
+    DeltaFilter * filter = out.filter();
     for ( Node const* n=list.front(); n; n=n->next() )
     {
         Object const* o = static_cast<const Object*>(n);
         //std::clog << "writeObject " << o->reference() << '\n';
+        if ( filter )
+            filter->begin(out, ( uint64_t(o->tag()) << 32 ) | o->identity());
         o->writeHeader(out, o->tag());
         o->write(out);
+        if ( filter )
+            filter->end(out);
     }
 }
 
@@ -499,6 +572,8 @@ void ObjectSet::loadObject(Inputter& in, const ObjectTag tag, bool fat, bool dis
             std::clog << "Property mismatch: " << P->name() << "' is " << P->category() << P->number();
             std::clog << " but loaded object has property #" << ix << '\n';
 #endif
+            // this may update the lists of Hands of the fibers (see Simul::readParallel):
+            #pragma omp critical (erase_object)
             erase(obj);
             obj = nullptr;
         }
@@ -7,6 +7,7 @@
 #include "object.h"
 #include "node_list.h"
 #include "inventory.h"
+#include "random.h"
 #include <vector>
 
 class Outputter;
@@ -35,6 +36,12 @@ class Simul;
  - simulation: step(), shuffle().
  - I/O: loadObject(), read(), write(), freeze(), thaw().
  .
+ 
+ The lists are only modified by one thread. The parallel sections, such as
+ FiberSet::stepParallel() and CoupleSet::stepAABatch(), record the outcome for
+ each object in an array indexed like the batch of objects, and the changes of
+ the lists (deletion, cut, detachment) are then made sequentially in the order
+ of the batch, which is reproducible without a queue of deferred changes.
  */
 class ObjectSet
 {
@@ -75,6 +82,39 @@ protected:
     
     /// print a list of the content (nb of objects, class)
     void              writeAssets(std::ostream&, const std::string& title) const;
+    
+    /// method used by shuffle() to randomize the lists (see SimulProp::shuffle)
+    int               mixMethod;
+    
+    /// the lists are randomized once every `mixPeriod` calls to shuffle()
+    unsigned          mixPeriod;
+    
+    /// number of calls to shuffle()
+    unsigned          mixCounter;
+    
+    /// true if the lists should be randomized at the current call to shuffle()
+    bool              mixNow();
+    
+    /// randomize the order of Objects in given list, using `mixMethod`
+    void              mix(NodeList&) const;
+    
+    /// the lists are sorted once every `sortPeriod` calls to sortNow(), if `sortPeriod > 0`
+    unsigned          sortPeriod;
+    
+    /// number of calls to sortNow()
+    unsigned          sortCounter;
+    
+    /// true if the lists should be sorted at the current call to shuffle()
+    bool              sortNow();
+    
+    /// sort the Objects in `list` by the cell of the FiberGrid containing their position
+    void              sortByCell(NodeList& list, uint32_t salt) const;
+    
+    /// key to sort Objects by group `g`, with the groups and the Objects of each group in random order
+    static unsigned long long sortKey(uint32_t g, uint32_t salt)
+    {
+        return ((unsigned long long)( g * salt ) << 32) | RNG.pint32();
+    }
 
 public:
     
@@ -111,7 +151,7 @@ public:
 public:
     
     /// creator
-    ObjectSet(Simul& s) : simul(s) { }
+    ObjectSet(Simul& s) : simul(s), mixMethod(1), mixPeriod(1), mixCounter(0), sortPeriod(0), sortCounter(0) { }
     
     /// destructor
     virtual ~ObjectSet() { erase(); }    
@@ -160,7 +200,22 @@ public:
     virtual size_t     size()             const { return nodes.size(); }
 
     /// mix the order of elements in the doubly linked list nodes
-    virtual void       shuffle()                { nodes.shuffle(); }
+    virtual void       shuffle()                { if ( mixNow() ) mix(nodes); }
+    
+    /// reverse the order of the elements, which is inverted by reading them from a file
+    virtual void       reverse()                { nodes.reverse(); }
+    
+    /// copy the counters of mixNow() and sortNow() into `cnt[2]`
+    void               getCounters(unsigned cnt[2]) const { cnt[0] = mixCounter; cnt[1] = sortCounter; }
+    
+    /// restore the counters of mixNow() and sortNow(), from `cnt[2]`
+    void               setCounters(unsigned const cnt[2]) { mixCounter = cnt[0]; sortCounter = cnt[1]; }
+    
+    /// set method and period used to randomize the lists
+    void               setShuffle(int method, unsigned period) { mixMethod = method; mixPeriod = period; }
+    
+    /// set period at which the lists are sorted spatially, if this is implemented
+    void               setSorting(unsigned period) { sortPeriod = period; }
     
     /// first Object in the list
     Object *           first()            const { return static_cast<Object*>(nodes.front()); }
@@ -28,7 +28,7 @@ void Aster::step()
     {
         if ( !fiber(ii) &&  RNG.test(prop->fiber_prob) )
         {
-            Glossary opt(prop->fiber_spec);
+            Glossary opt(prop->fiber_glos);
             sim.add(makeFiber(sim, ii, prop->fiber_type, opt));
             if ( opt.has_warning(std::cerr, 1) )
                 std::cerr << " in aster:nucleate[1]";
@@ -550,6 +550,9 @@ void Aster::write(Outputter& out) const
     {
         out.writeSoftNewline();
         asLinks[ii].write(out);
+        // a checkpoint also records the length, which is otherwise derived from the Solid:
+        if ( out.precise() )
+            out.writeDouble(asLinks[ii].len);
     }
 }
 
@@ -601,6 +604,8 @@ void Aster::read(Inputter& in, Simul& sim, ObjectTag tag)
 #endif
         asLinks[i].read(in);
         asLinks[i].len *= asRadius;
+        if ( in.precise() )
+            asLinks[i].len = in.readDouble();
         if ( asLinks[i].prime + asLinks[i].rank >= sol->nbPoints() )
             throw InvalidIO("invalid AsterLink index");
     }
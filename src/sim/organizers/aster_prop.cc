@@ -57,6 +57,7 @@ void AsterProp::complete(Simul const& sim)
     }
  
     fiber_prob = -std::expm1( -fiber_rate * sim.time_step() );
+    fiber_glos = Glossary(fiber_spec);
 }
 
 
@@ -6,6 +6,7 @@
 #include "real.h"
 #include "property.h"
 #include "common.h"
+#include "glossary.h"
 
 class FiberSet;
 
@@ -57,6 +58,9 @@ private:
     
     /// probability of nucleation
     real         fiber_prob;
+    
+    /// `fiber_spec` parsed once, and copied for each nucleation
+    Glossary     fiber_glos;
 
 public:
     
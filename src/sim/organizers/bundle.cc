@@ -20,7 +20,7 @@ void Bundle::step()
     {
         if ( !organized(ii)  &&  RNG.test(prop->fiber_prob) )
         {
-            Glossary opt(prop->fiber_spec);
+            Glossary opt(prop->fiber_glos);
             ObjectList objs = sim.fibers.newObjects(prop->fiber_type, opt);
             if ( objs.size() )
             {
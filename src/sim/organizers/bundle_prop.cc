@@ -43,6 +43,7 @@ void BundleProp::complete(Simul const& sim)
     }
 
     fiber_prob = -std::expm1( -fiber_rate * sim.time_step() );
+    fiber_glos = Glossary(fiber_spec);
 
     if ( overlap < 0 )
         throw InvalidParameter("bundle:overlap must be specified and >= 0");
@@ -10,6 +10,8 @@
 #include "simul_prop.h"
 #include "simul.h"
 #include <fstream>
+#include <sstream>
+#include <sys/wait.h>
 
 
 // Use the second definition to get some reports:
@@ -30,6 +32,9 @@
 Parser::Parser(Simul& sim, bool s, bool c, bool n, bool r, bool w)
 : Interface(sim), do_set(s), do_change(c), do_new(n), do_run(r), do_write(w)
 {
+    variant_ = 0;
+    radix_ = 1;
+    setupStream_ = nullptr;
 }
 
 /// check for unused values in Glossary and issue a warning
@@ -42,6 +47,125 @@ void check_warnings(Glossary& opt, std::istream& is, std::streampos ipos, size_t
     }
 }
 
+//------------------------------------------------------------------------------
+#pragma mark - Snippets
+
+/**
+ A value in a block of options can be generated when the config file is read,
+ by a snippet of code surrounded by double square brackets:
+ 
+     [[ randint(INTEGER, INTEGER) ]]  random integer, within the bounds included
+     [[ uniform(REAL, REAL) ]]        random real number, uniformly distributed
+     [[ choice(VALUE, VALUE, ...) ]]  one of the values, randomly chosen
+     [[ sweep(VALUE, VALUE, ...) ]]   one of the values, selected by the variant
+ 
+ The random values are drawn from the generator of the simulation, which is
+ seeded first, if necessary, with `simul:random_seed`.
+ The values of all the `sweep()` in the file are enumerated as combinations,
+ the first `sweep()` varying fastest, and the combination is selected by the
+ index given to setVariant(), as for example with `sim variant=INTEGER`.
+ With `sim ensemble=N`, the replicas use combinations 0 to N-1.
+ The substitutions are recorded in the messages.
+ 
+ Example:
+ 
+     set fiber microtubule
+     {
+         rigidity = [[ sweep(5, 10, 20) ]]
+         segmentation = [[ choice(0.25, 0.5) ]]
+     }
+ 
+ */
+std::string Parser::evaluate_snippet(std::string const& code)
+{
+    size_t p = code.find('(');
+    size_t q = code.rfind(')');
+    if ( p == std::string::npos || q == std::string::npos || q < p )
+        throw InvalidSyntax("unexpected snippet `[[ "+code+" ]]'");
+    std::string fun = Tokenizer::trim(code.substr(0, p));
+    
+    std::vector<std::string> args;
+    std::istringstream iss(code.substr(p+1, q-p-1));
+    std::string str;
+    while ( std::getline(iss, str, ',') )
+        args.push_back(Tokenizer::trim(str));
+    if ( args.empty() || args[0].empty() )
+        throw InvalidSyntax("missing arguments in snippet `[[ "+code+" ]]'");
+
+    if ( fun == "sweep" )
+    {
+        size_t n = args.size();
+        size_t i = ( variant_ / radix_ ) % n;
+        radix_ *= n;
+        return args[i];
+    }
+    
+    // the random values are drawn from the generator of the simulation:
+    if ( !RNG.seeded() )
+    {
+        if ( simul.prop->random_seed )
+            RNG.seed(simul.prop->random_seed);
+        else
+            simul.prop->random_seed = RNG.seed();
+    }
+    
+    if ( fun == "choice" )
+        return args[RNG.pint32(args.size())];
+
+    if ( args.size() != 2 )
+        throw InvalidSyntax("expected 2 arguments in snippet `[[ "+code+" ]]'");
+    char * end0 = nullptr, * end1 = nullptr;
+    if ( fun == "randint" )
+    {
+        long a = strtol(args[0].c_str(), &end0, 10);
+        long b = strtol(args[1].c_str(), &end1, 10);
+        if ( *end0 || *end1 || b < a )
+            throw InvalidSyntax("invalid bounds in snippet `[[ "+code+" ]]'");
+        return std::to_string(a + (long)RNG.pint32(uint32_t(b-a+1)));
+    }
+    if ( fun == "uniform" )
+    {
+        real a = strtod(args[0].c_str(), &end0);
+        real b = strtod(args[1].c_str(), &end1);
+        if ( *end0 || *end1 || b < a )
+            throw InvalidSyntax("invalid bounds in snippet `[[ "+code+" ]]'");
+        std::ostringstream oss;
+        oss << a + ( b - a ) * RNG.preal();
+        return oss.str();
+    }
+    throw InvalidSyntax("unknown function `"+fun+"' in snippet `[[ "+code+" ]]'");
+}
+
+
+/// replace the snippets `[[ CODE ]]` in `str` by their values
+std::string Parser::substitute(std::string const& str)
+{
+    size_t s = str.find("[[");
+    if ( s == std::string::npos )
+        return str;
+    std::string res = str.substr(0, s);
+    while ( s != std::string::npos )
+    {
+        size_t e = str.find("]]", s+2);
+        if ( e == std::string::npos )
+            throw InvalidSyntax("missing `]]' after `[['");
+        std::string code = str.substr(s+2, e-s-2);
+        std::string val = evaluate_snippet(code);
+        Cytosim::log << "[[" << code << "]] = " << val << '\n';
+        res.append(val);
+        s = str.find("[[", e+2);
+        res.append(str, e+2, s == std::string::npos ? s : s-e-2);
+    }
+    return res;
+}
+
+
+/// read a block of options, and replace the snippets `[[ CODE ]]` by their values
+std::string Parser::get_options(std::istream& is, bool or_die)
+{
+    return substitute(Tokenizer::get_block(is, '{', or_die));
+}
+
 //------------------------------------------------------------------------------
 #pragma mark - Parse
 
@@ -98,7 +222,7 @@ void Parser::parse_set(std::istream& is)
     if ( cat == "simul" )
     {
         name = Tokenizer::get_symbol(is);
-        blok = Tokenizer::get_block(is, '{', true);
+        blok = get_options(is, true);
 
         if ( do_change )
         {
@@ -121,7 +245,7 @@ void Parser::parse_set(std::istream& is)
          define a new Property
          */
         name = Tokenizer::get_symbol(is);
-        blok = Tokenizer::get_block(is, '{', true);
+        blok = get_options(is, true);
 
         if ( do_set )
         {
@@ -174,7 +298,7 @@ void Parser::parse_set(std::istream& is)
         }
         
         // set NAME { PARAMETER = VALUE }
-        blok = Tokenizer::get_block(is, '{', true);
+        blok = get_options(is, true);
         
         if ( do_change )
         {
@@ -282,7 +406,7 @@ void Parser::parse_change(std::istream& is)
     }
 
     //change NAME { VALUE }
-    std::string blok = Tokenizer::get_block(is, '{', true);
+    std::string blok = get_options(is, true);
     
     Glossary opt;
     if ( do_change )
@@ -374,7 +498,7 @@ void Parser::parse_new(std::istream& is)
     
     if ( blok.empty() )
     {
-        blok = Tokenizer::get_block(is, '{');
+        blok = get_options(is);
         opt.read(blok);
     }
     else {
@@ -532,7 +656,7 @@ void Parser::parse_delete(std::istream& is)
         cnt = ~0U; // this is very large
         name = Tokenizer::get_symbol(is);
     }
-    std::string blok = Tokenizer::get_block(is, '{');
+    std::string blok = get_options(is);
     
     if ( do_new )
     {
@@ -581,7 +705,7 @@ void Parser::parse_mark(std::istream& is)
 #endif
     if ( !has_cnt  &&  name == "all" )
         name = Tokenizer::get_symbol(is);
-    std::string blok = Tokenizer::get_block(is, '{');
+    std::string blok = get_options(is);
     
     if ( do_new )
     {
@@ -624,7 +748,7 @@ void Parser::parse_cut(std::istream& is)
         str = Tokenizer::get_symbol(is);
     }
     
-    std::string blok = Tokenizer::get_block(is, '{', true);
+    std::string blok = get_options(is, true);
     
     if ( do_run )
     {
@@ -673,7 +797,7 @@ void Parser::parse_run(std::istream& is)
     if ( name != "*"  &&  name != simul.prop->name() )
         throw InvalidSyntax("unknown simul name `"+name+"'");
 
-    std::string blok = Tokenizer::get_block(is, '{');
+    std::string blok = get_options(is);
     
     if ( do_run )
     {
@@ -733,7 +857,7 @@ void Parser::parse_read(std::istream& is)
     if ( file.empty() )
         throw InvalidSyntax("missing/invalid file name after 'read'");
     
-    std::string blok = Tokenizer::get_block(is, '{');
+    std::string blok = get_options(is);
     if ( ! blok.empty() )
     {
         Glossary opt(blok);
@@ -797,7 +921,7 @@ void Parser::parse_import(std::istream& is)
     if ( file.empty() )
         throw InvalidSyntax("missing/invalid file name (use `import all FILENAME')");
     
-    std::string blok = Tokenizer::get_block(is, '{');
+    std::string blok = get_options(is);
     
     if ( do_new )
     {
@@ -845,7 +969,7 @@ void Parser::parse_export(std::istream& is)
     if ( file.empty() )
         throw InvalidSyntax("missing/invalid file name (use `export all FILENAME')");
 
-    std::string blok = Tokenizer::get_block(is, '{');
+    std::string blok = get_options(is);
     
     if ( do_write )
     {
@@ -890,7 +1014,7 @@ void Parser::parse_report(std::istream& is)
     if ( file.empty() )
         throw InvalidSyntax("missing file name. Expected 'report WHAT FILE'");
     
-    std::string blok = Tokenizer::get_block(is, '{');
+    std::string blok = get_options(is);
     
     if ( do_run && ( do_write || file == "*" ))
     {
@@ -919,7 +1043,7 @@ void Parser::parse_call(std::istream& is)
     if ( str.empty() )
         throw InvalidSyntax("missing function name after 'call'");
     
-    std::string blok = Tokenizer::get_block(is, '{');
+    std::string blok = get_options(is);
     
     if ( do_run )
     {
@@ -946,9 +1070,13 @@ void Parser::parse_repeat(std::istream& is)
 
     std::string code = Tokenizer::get_block(is, '{');
     
+    // the same stream is rewound, to avoid copying the code at each iteration:
+    std::istringstream iss(code);
     for ( unsigned c = 0; c < cnt; ++c )
     {
-        evaluate(code);
+        iss.clear();
+        iss.seekg(0);
+        evaluate(iss);
     }
 }
 
@@ -991,17 +1119,133 @@ void Parser::parse_for(std::istream& is)
     
     std::string code = Tokenizer::get_block(is, '{');
     
+    if ( var.empty() )
+        throw InvalidSyntax("missing variable name in command 'for'");
+
+    // split the code at the occurences of the Variable name, once for all iterations:
+    std::vector<std::string> pieces;
+    size_t pos = 0, fnd = code.find(var);
+    while ( fnd != std::string::npos )
+    {
+        pieces.push_back(code.substr(pos, fnd-pos));
+        pos = fnd + var.size();
+        fnd = code.find(var, pos);
+    }
+    pieces.push_back(code.substr(pos));
+    
+    std::string sub;
+    sub.reserve(code.size() + 16 * pieces.size());
     for ( size_t c = start; c < end; ++c )
     {
-        std::string sub = code;
         // substitute Variable name for this iteration:
-        StreamFunc::find_and_replace(sub, var, std::to_string(c));
+        std::string val = std::to_string(c);
+        sub = pieces[0];
+        for ( size_t i = 1; i < pieces.size(); ++i )
+            sub.append(val).append(pieces[i]);
         // execute code:
         evaluate(sub);
         //hold();
     }
 }
 
+//------------------------------------------------------------------------------
+/**
+ Continue the simulation in parallel branches, which differ by the value of a variable
+
+     sweep VAR = VALUE, VALUE, ... { CODE }
+
+ The process is forked once for each VALUE, and the branches thus start from the
+ state reached at this point, sharing the memory pages until they are modified.
+ Each branch executes CODE, after replacing any occurence of VAR by its VALUE,
+ and then continues with the rest of the config file.
+ All branches start with the same state of the random number generator.
+ Branch `i` writes its files in a subdirectory `sweepXX`, or if a RunStore is
+ used, appends its output as run `ID.sweepXX` where ID is the identity of the run.
+ The parent process waits for all the branches to finish, and stops.
+ 
+ Example:
+ 
+     run 10000 system { nb_frames = 0 }
+     sweep RIGID = 10, 20, 40 {
+       change microtubule { rigidity = RIGID }
+     }
+     run 10000 system { nb_frames = 10 }
+ 
+ This command should not be used inside a block of code (`repeat`, `for`, etc.)
+ */
+int Parser::parse_sweep(std::istream& is)
+{
+    std::string var = Tokenizer::get_symbol(is);
+    if ( var.empty() )
+        throw InvalidSyntax("missing variable name after 'sweep'");
+    
+    if ( Tokenizer::get_token(is) != "=" )
+        throw InvalidSyntax("missing '=' in command 'sweep'");
+    
+    std::string str;
+    while ( is.good() && is.peek() != '{' && is.peek() != EOF )
+        str.push_back((char)is.get());
+    
+    std::vector<std::string> values;
+    std::istringstream iss(str);
+    while ( std::getline(iss, str, ',') )
+    {
+        str = Tokenizer::trim(str);
+        if ( str.empty() )
+            throw InvalidSyntax("missing value in command 'sweep'");
+        values.push_back(str);
+    }
+    if ( values.empty() )
+        throw InvalidSyntax("missing values after 'sweep "+var+" ='");
+
+    std::string code = Tokenizer::get_block(is, '{');
+    
+    if ( !do_run )
+        return 0;
+    
+    size_t failed = 0;
+    std::vector<pid_t> pids;
+    for ( size_t i = 0; i < values.size(); ++i )
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "sweep%02lu", i);
+        bool file = Cytosim::out.is_open();
+        pid_t pid = simul.branch(name);
+        if ( pid < 0 )
+        {
+            Cytosim::warn << "could not fork branch `" << name << "'\n";
+            ++failed;
+        }
+        else if ( pid == 0 )
+        {
+            // the branch continues with its own messages:
+            if ( file )
+            {
+                Cytosim::out.close();
+                Cytosim::out.open("messages.cmo");
+            }
+            Cytosim::out << "sweep branch " << name << " : " << var << " = " << values[i] << '\n';
+            std::string sub = code;
+            StreamFunc::find_and_replace(sub, var, values[i]);
+            evaluate(sub);
+            return 0;
+        }
+        else
+            pids.push_back(pid);
+    }
+    
+    for ( size_t i = 0; i < pids.size(); ++i )
+    {
+        int status = 0;
+        if ( waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) )
+            ++failed;
+    }
+    Cytosim::out << "sweep of " << values.size() << " branches: " << failed << " failed\n";
+    if ( failed )
+        throw Exception(std::to_string(failed)+" branches of `sweep' failed");
+    return 2;
+}
+
 //------------------------------------------------------------------------------
 
 /**
@@ -1104,6 +1348,8 @@ int Parser::evaluate_one(std::istream& is)
         parse_repeat(is);
     else if ( tok == "for" )
         parse_for(is);
+    else if ( tok == "sweep" )
+        return parse_sweep(is);
     else if ( tok == "restart" )
     {
         // reset simulation and rewind config file, repeating forever
@@ -1165,6 +1411,17 @@ void Parser::evaluate(std::istream& is)
             ipos = is.tellg();
             //StreamFunc::print_lines(std::clog, is, ipos, ipos);
             
+            // save the state before the first `run` of the config file:
+            if ( &is == setupStream_ && do_run )
+            {
+                if ( Tokenizer::get_token(is) == "run" )
+                {
+                    save_setup(ipos);
+                    setupStream_ = nullptr;
+                }
+                is.seekg(ipos);
+            }
+            
             if ( evaluate_one(is) )
                 break;
         }
@@ -1184,6 +1441,127 @@ void Parser::evaluate(std::string const& code)
 }
 
 
+/**
+ This is called between the steps of a `run`, which cannot be nested
+ */
+void Parser::execute_command(std::string const& code)
+{
+    std::istringstream is(code);
+    std::string tok = Tokenizer::get_symbol(is);
+    if ( tok == "run" )
+        throw InvalidSyntax("`run' cannot be sent during a run");
+    evaluate(code);
+}
+
+
+//------------------------------------------------------------------------------
+#pragma mark - Setup
+
+/**
+ The setup file holds the properties, and the objects in binary format,
+ preceded by a line:
+ 
+     #cytosim setup KEY POSITION SIZE
+ 
+ where KEY identifies the config file and the variant, POSITION is the position
+ of the first `run` command in the config file, and SIZE is the size of the
+ properties in bytes. The line specifying `random_seed` is not saved, such that
+ the runs sharing the setup file are seeded independently.
+ */
+void Parser::save_setup(std::streampos pos)
+{
+    std::ostringstream oss;
+    simul.writeProperties(oss, true);
+    std::string str, props;
+    std::istringstream iss(oss.str());
+    while ( std::getline(iss, str) )
+    {
+        if ( str.find(" random_seed ") == std::string::npos )
+            props.append(str).push_back('\n');
+    }
+    
+    std::string tmp = setupFile_ + ".tmp";
+    Outputter out(tmp.c_str(), false, true);
+    if ( ! out.good() )
+        throw InvalidIO("could not open file `"+tmp+"' for writing");
+    out.precise(true);
+    fprintf(out, "#cytosim setup %s %lli %zu\n", setupKey_.c_str(), (long long)pos, props.size());
+    fwrite(props.data(), 1, props.size(), out);
+    simul.writeObjects(out);
+    out.close();
+    if ( rename(tmp.c_str(), setupFile_.c_str()) )
+        throw InvalidIO("could not write `"+setupFile_+"'");
+    Cytosim::log << "saved setup `" << setupFile_ << "'\n";
+}
+
+
+/**
+ Return true if the setup file corresponds to the config file and variant,
+ after restoring the properties and the objects it contains.
+ */
+bool Parser::load_setup(std::string const& file, size_t& pos)
+{
+    FILE * f = fopen(file.c_str(), "rb");
+    if ( !f )
+        return false;
+    char key[64];
+    long long ipos = 0;
+    size_t size = 0;
+    if ( 3 != fscanf(f, "#cytosim setup %63s %lli %zu", key, &ipos, &size) || setupKey_ != key || fgetc(f) != '\n' )
+    {
+        fclose(f);
+        return false;
+    }
+    long start = ftell(f);
+    fseek(f, 0, SEEK_END);
+    long end = ftell(f);
+    fseek(f, start, SEEK_SET);
+    std::string str(end-start, 0);
+    bool okay = ( size <= str.size() && str.size() == fread(&str[0], 1, str.size(), f) );
+    fclose(f);
+    if ( !okay )
+        return false;
+
+    Parser(simul, 1, 1, 0, 0, 0).evaluate(str.substr(0, size));
+    Inputter in(DIM);
+    in.memory(str.data()+size, str.size()-size);
+    if ( simul.readObjects(in, Simul::ALL_SETS) )
+        throw InvalidIO("invalid objects in setup `"+file+"'");
+    pos = (size_t)ipos;
+    Cytosim::log << "restored setup `" << file << "'\n";
+    return true;
+}
+
+
+/**
+ The commands preceding the first `run` are skipped if the setup file can be
+ restored, and they are executed otherwise, saving the state reached
+ in the setup file, when the first `run` is found.
+ The setup file is only used if it was made from the same config file,
+ and with the same variant if the file contains snippets (see evaluate_snippet).
+ */
+void Parser::evaluate(std::string const& code, std::string const& file)
+{
+    std::ostringstream oss;
+    oss << std::hex << std::hash<std::string>()(code);
+    // the variant matters only if the config file has snippets:
+    if ( code.find("[[") != std::string::npos )
+        oss << "." << std::dec << variant_;
+    setupKey_ = oss.str();
+    size_t pos = 0;
+    if ( load_setup(file, pos) && pos <= code.size() )
+    {
+        evaluate(code.substr(pos));
+        return;
+    }
+    setupFile_ = file;
+    std::istringstream is(code);
+    setupStream_ = &is;
+    evaluate(is);
+    setupStream_ = nullptr;
+}
+
+
 void Parser::readConfig(std::string const& filename)
 {
     std::ifstream is(filename.c_str(), std::ifstream::in);
@@ -32,6 +32,40 @@ private:
     /// control switch to enable command 'write' (write files)
     bool      do_write;
     
+    /// index of the combination of values selected by the `sweep()` snippets
+    size_t    variant_;
+    
+    /// number of combinations of the `sweep()` snippets already evaluated
+    size_t    radix_;
+    
+    //--------------------------------------------------------------------------
+    
+    /// return the value of the snippet `[[ code ]]`
+    std::string evaluate_snippet(std::string const& code);
+    
+    /// replace the snippets in `str` by their values
+    std::string substitute(std::string const& str);
+    
+    /// read a block of options surrounded by `{ }`, substituting snippets
+    std::string get_options(std::istream&, bool or_die = false);
+    
+    //--------------------------------------------------------------------------
+    
+    /// file in which the state reached before the first `run` is saved
+    std::string setupFile_;
+    
+    /// identifies the config file and the variant in the setup file
+    std::string setupKey_;
+    
+    /// stream of the config file, in which the first `run` is detected
+    std::istream* setupStream_;
+    
+    /// save the properties and objects, with the position `pos` of the first `run`
+    void      save_setup(std::streampos pos);
+    
+    /// restore the state saved by save_setup(), returning the position of the first `run`
+    bool      load_setup(std::string const& file, size_t& pos);
+    
     //--------------------------------------------------------------------------
     
     /// parse command `set
@@ -76,6 +110,9 @@ private:
     /// parse command `for`
     void      parse_for(std::istream&);
     
+    /// parse command `sweep`
+    int       parse_sweep(std::istream&);
+
     /// parse command `end`
     void      parse_end(std::istream&);
     
@@ -92,6 +129,9 @@ public:
     /// construct a Parser with given permissions
     Parser(Simul&, bool Set, bool Change, bool New, bool Run, bool Write);
 
+    /// select the combination of values of the `sweep()` snippets
+    void      setVariant(size_t i) { variant_ = i; radix_ = 1; }
+
     /// Parse next command in stream, advance stream pointer, return 0 if success
     int       evaluate_one(std::istream&);
     
@@ -100,6 +140,12 @@ public:
 
     /// Parse code in string, and report errors
     void      evaluate(std::string const&);
+    
+    /// Parse a command received from the command channel, excluding `run`
+    void      execute_command(std::string const&);
+    
+    /// Parse code in string, restoring or saving the state reached before the first `run`
+    void      evaluate(std::string const&, std::string const& setup);
 
     /// Open and parse the config file with the given name
     void      readConfig(std::string const& name);
@@ -7,12 +7,16 @@
 #include "space.h"
 #include "meca.h"
 
-extern Modulo const* modulo;
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+extern thread_local Modulo const* modulo;
 
 //------------------------------------------------------------------------------
 
 PointGrid::PointGrid()
-: max_diameter(0)
+: pStep(0), max_diameter(0), sparse(false), nbThreads(1), skin(0), pairsValid(false), sorted(false), large(0)
 {
 }
 
@@ -26,6 +30,8 @@ size_t PointGrid::setGrid(Space const* spc, real min_step)
     spc->boundaries(inf, sup);
     
     int n_cell[3];
+    bool periodic[3] = { false, false, false };
+    bool same = pGrid.hasDimensions() && ( min_step == pStep );
     for ( int d = 0; d < DIM; ++d )
     {
         real n = ( sup[d] - inf[d] ) / min_step;
@@ -33,13 +39,14 @@ size_t PointGrid::setGrid(Space const* spc, real min_step)
         if ( n < 0 )
             throw InvalidParameter("invalid space:boundaries");
         
-        if ( modulo  &&  modulo->isPeriodic(d) )
+        periodic[d] = ( modulo  &&  modulo->isPeriodic(d) );
+        same &= ( periodic[d] == pGrid.isPeriodic(d) );
+        if ( periodic[d] )
         {
             //adjust the grid to match the edges
             n_cell[d] = (int)floor(n);
             if ( n_cell[d] <= 0 )
                 n_cell[d] = 1;
-            pGrid.setPeriodic(d, true);
         }
         else
         {
@@ -52,14 +59,30 @@ size_t PointGrid::setGrid(Space const* spc, real min_step)
         }
     }
     
+    // keep the current grid if it still covers the Space, as in FiberGrid::setGrid()
+    if ( same && pGrid.covers(inf, sup) )
+        return pGrid.nbCells();
+    
+    for ( int d = 0; d < DIM; ++d )
+        pGrid.setPeriodic(d, periodic[d]);
+
     //create the grid using the calculated dimensions:
     pGrid.setDimensions(inf, sup, n_cell);
+    pStep = min_step;
     return pGrid.nbCells();
 }
 
 void PointGrid::createCells()
 {
-    pGrid.createCells();
+    // with the sparse layout, all lists share the empty list at index 0:
+    const index_t nbs = sparse ? 0 : pGrid.nbCells()*NB_STERIC_PANES;
+    if ( sparse )
+        tiles.resize(pGrid.nbCells()*NB_STERIC_PANES);
+    pointStart.resize(nbs+2);
+    segmentStart.resize(nbs+2);
+    pointStart.zero(0);
+    segmentStart.zero(0);
+    pairsValid = false;
 
     //Create side regions suitable for pairwise interactions:
     pGrid.createSideRegions(1);
@@ -73,6 +96,173 @@ void PointGrid::createCells()
 }
 
 
+size_t PointGrid::memory() const
+{
+    size_t res = pointAdded.memory() + segmentAdded.memory() + largeAdded.memory();
+    res += pointSlot.memory() + segmentSlot.memory();
+    res += points.memory() + segments.memory() + tiles.memory();
+    res += pointStart.memory() + segmentStart.memory() + segmentR.memory();
+    for ( int d = 0; d < DIM; ++d )
+        res += segmentX[d].memory();
+    res += nearby.memory() + pairs.memory() + pointIndex.memory() + segmentIndex.memory();
+    res += pointRef.memory() + segmentRef.memory() + segmentPos.memory();
+    return res;
+}
+
+
+void PointGrid::clear()
+{
+    pointAdded.clear();
+    pointSlot.clear();
+    segmentAdded.clear();
+    segmentSlot.clear();
+    largeAdded.clear();
+    sorted = false;
+}
+
+
+/**
+ Counting sort of the FatPoint and FatSegment by list.
+ This is stable: within each list, objects are kept in the order of addition
+ */
+void PointGrid::sortObjects()
+{
+    index_t nbs = pGrid.nbCells() * NB_STERIC_PANES;
+    
+    // with the sparse layout, only the occupied tiles are allocated:
+    if ( sparse )
+    {
+        tiles.clear();
+        for ( index_t i = 0; i < pointSlot.size(); ++i )
+            tiles.mark(pointSlot[i]);
+        for ( index_t i = 0; i < segmentSlot.size(); ++i )
+            tiles.mark(segmentSlot[i]);
+        nbs = tiles.allocate();
+        pointStart.resize(nbs+2);
+        segmentStart.resize(nbs+2);
+    }
+    
+    // count the objects in each list:
+    index_t * pst = pointStart.data();
+    index_t * sst = segmentStart.data();
+    for ( index_t s = 0; s <= nbs; ++s )
+    {
+        pst[s] = 0;
+        sst[s] = 0;
+    }
+    for ( index_t i = 0; i < pointSlot.size(); ++i )
+        ++pst[list(pointSlot[i])+1];
+    for ( index_t i = 0; i < segmentSlot.size(); ++i )
+        ++sst[list(segmentSlot[i])+1];
+    
+    // cumulate, to get the start of each list:
+    for ( index_t s = 1; s <= nbs; ++s )
+    {
+        pst[s] += pst[s-1];
+        sst[s] += sst[s-1];
+    }
+    
+    // move the objects into place, using pst[] and sst[] as cursors:
+    points.resize(pointAdded.size());
+    pointIndex.resize(pointAdded.size());
+    for ( index_t i = 0; i < pointAdded.size(); ++i )
+    {
+        index_t j = pst[list(pointSlot[i])]++;
+        points[j] = pointAdded[i];
+        pointIndex[j] = i;
+    }
+    
+    segments.resize(segmentAdded.size());
+    segmentIndex.resize(segmentAdded.size());
+    for ( index_t i = 0; i < segmentAdded.size(); ++i )
+    {
+        index_t j = sst[list(segmentSlot[i])]++;
+        segments[j] = segmentAdded[i];
+        segmentIndex[j] = i;
+    }
+    
+    // the cursors now point to the start of the next list:
+    for ( index_t s = nbs; s > 0; --s )
+    {
+        pst[s] = pst[s-1];
+        sst[s] = sst[s-1];
+    }
+    pst[0] = 0;
+    sst[0] = 0;
+    // the list at index `nbs` is empty:
+    pst[nbs+1] = pst[nbs];
+    sst[nbs+1] = sst[nbs];
+    
+    // copy the bounding spheres of the segments:
+    const index_t nbl = segments.size();
+    for ( int d = 0; d < DIM; ++d )
+        segmentX[d].resize(nbl);
+    segmentR.resize(nbl);
+    nearby.resize(nbl*nbThreads);
+    for ( index_t i = 0; i < nbl; ++i )
+    {
+        FatSegment const& S = segments[i];
+        Vector w = S.seg.center();
+        for ( int d = 0; d < DIM; ++d )
+            segmentX[d][i] = w[d];
+        segmentR[i] = 0.5 * S.seg.diff().norm() + std::max(S.range, S.radius) + REAL_EPSILON;
+    }
+    sorted = true;
+}
+
+
+/**
+ Set nearby[j] for the segments `j` in [inf, sup[ that may be closer than
+ `ext` from the range of interaction of segment `i`, and reset it for the others.
+ The test compares the distance between the centers of the segments
+ with the sum of the radii of their bounding spheres, plus `ext`.
+ This loop is written to be vectorized by the compiler.
+ */
+void PointGrid::markNearby(uint8_t * flg, index_t i, index_t inf, index_t sup, real ext) const
+{
+    if ( modulo )
+    {
+        // the distance would need to be folded: no selection
+        for ( index_t j = inf; j < sup; ++j )
+            flg[j] = 1;
+        return;
+    }
+    const real * R = segmentR.data();
+    const real Ri = R[i] + ext;
+#if ( DIM == 1 )
+    const real * X = segmentX[0].data();
+    const real xi = X[i];
+    for ( index_t j = inf; j < sup; ++j )
+    {
+        real r = Ri + R[j];
+        real x = X[j] - xi;
+        flg[j] = ( x * x <= r * r );
+    }
+#elif ( DIM == 2 )
+    const real * X = segmentX[0].data();
+    const real * Y = segmentX[1].data();
+    const real xi = X[i], yi = Y[i];
+    for ( index_t j = inf; j < sup; ++j )
+    {
+        real r = Ri + R[j];
+        real x = X[j] - xi, y = Y[j] - yi;
+        flg[j] = ( x * x + y * y <= r * r );
+    }
+#else
+    const real * X = segmentX[0].data();
+    const real * Y = segmentX[1].data();
+    const real * Z = segmentX[2].data();
+    const real xi = X[i], yi = Y[i], zi = Z[i];
+    for ( index_t j = inf; j < sup; ++j )
+    {
+        real r = Ri + R[j];
+        real x = X[j] - xi, y = Y[j] - yi, z = Z[j] - zi;
+        flg[j] = ( x * x + y * y + z * z <= r * r );
+    }
+#endif
+}
+
+
 //------------------------------------------------------------------------------
 #pragma mark -
 
@@ -82,13 +272,13 @@ void PointGrid::createCells()
 
 #if ( NB_STERIC_PANES != 1 )
 
-void PointGrid::add(unsigned pan, Mecapoint const& pe, real rd, real rg) const
+void PointGrid::add(unsigned pan, Mecapoint const& pe, real rd, real rg)
 {
     if ( pan == 0 || pan > NB_STERIC_PANES )
         throw InvalidParameter("object:steric is out-of-range");
 
     Vector w = pe.pos();
-    point_list(w, pan).new_val().set(pe, rd, rg, w);
+    addPoint(slot(pGrid.index(w), pan), pe, rd, rg, w);
     
 #if ( CHECK_RANGE )
     //we check that the grid would correctly detect collision of two particles
@@ -103,14 +293,13 @@ void PointGrid::add(unsigned pan, Mecapoint const& pe, real rd, real rg) const
 }
 
 
-void PointGrid::add(unsigned pan, FiberSegment const& fl, real rd, real rg) const
+void PointGrid::add(unsigned pan, FiberSegment const& fl, real rd, real rg)
 {
     if ( pan == 0 || pan > NB_STERIC_PANES )
         throw InvalidParameter("object:steric is out-of-range");
 
     // link in the cell containing the middle of the segment:
-    Vector w = fl.center();
-    segment_list(w, pan).new_val().set(fl, rd, rg);
+    addSegment(slot(pGrid.index(fl.center()), pan), fl, rd, rg);
     
 #if ( CHECK_RANGE )
     //we check that the grid would correctly detect collision of two segments
@@ -131,6 +320,32 @@ void PointGrid::add(unsigned pan, FiberSegment const& fl, real rd, real rg) cons
 #endif
 
 
+void PointGrid::setThreads(int nbt)
+{
+#ifdef _OPENMP
+    if ( nbt <= 0 )
+        nbt = omp_get_max_threads();
+    nbThreads = std::max(1, nbt);
+#else
+    nbThreads = 1;
+#endif
+}
+
+
+/**
+ With `skin > 0`, a list of pairs is built including all pairs that are closer
+ than their range of interaction plus `skin`, and this list is reused until
+ an object has moved by more than `skin/2`. The grid must then be created
+ with cells that are wider by `skin`.
+ This is only supported with one steric pane.
+ */
+void PointGrid::setSkin(real s)
+{
+    skin = std::max(real(0), s);
+    pairsValid = false;
+}
+
+
 //------------------------------------------------------------------------------
 #pragma mark - Steric functions
 
@@ -142,7 +357,8 @@ void PointGrid::add(unsigned pan, FiberSegment const& fl, real rd, real rg) cons
  The force is applied if the objects are closer than the
  sum of their radiuses.
  */
-void PointGrid::checkPP(Meca& meca, PointGridParam const& pam,
+template < typename MECA >
+void PointGrid::checkPP(MECA& meca, PointGridParam const& pam,
                         FatPoint const& aa, FatPoint const& bb) const
 {
     //std::clog << "   PP- " << bb.pnt << " " << aa.pnt << std::endl;
@@ -163,7 +379,8 @@ void PointGrid::checkPP(Meca& meca, PointGridParam const& pam,
  
  The force is applied if the objects are closer than the sum of their radiuses.
  */
-void PointGrid::checkPL(Meca& meca, PointGridParam const& pam,
+template < typename MECA >
+void PointGrid::checkPL(MECA& meca, PointGridParam const& pam,
                         FatPoint const& aa, FatSegment const& bb) const
 {
     //std::clog << "   PL- " << bb.seg << " " << aa.pnt << std::endl;
@@ -218,7 +435,8 @@ void PointGrid::checkPL(Meca& meca, PointGridParam const& pam,
  
  The interaction is applied only if the vertex projects 'inside' the segment.
  */
-void PointGrid::checkLL1(Meca& meca, PointGridParam const& pam,
+template < typename MECA >
+void PointGrid::checkLL1(MECA& meca, PointGridParam const& pam,
                          FatSegment const& aa, FatSegment const& bb) const
 {
     //std::clog << "   LL1 " << aa.seg << " " << bb.point1() << std::endl;
@@ -295,7 +513,8 @@ void PointGrid::checkLL1(Meca& meca, PointGridParam const& pam,
  
  The interaction is applied only if the vertex projects 'inside' the segment.
  */
-void PointGrid::checkLL2(Meca& meca, PointGridParam const& pam,
+template < typename MECA >
+void PointGrid::checkLL2(MECA& meca, PointGridParam const& pam,
                          FatSegment const& aa, FatSegment const& bb) const
 {
     //std::clog << "   LL2 " << aa.seg << " " << bb.point2() << std::endl;
@@ -376,7 +595,8 @@ void PointGrid::checkLL2(Meca& meca, PointGridParam const& pam,
  This is used to check two FiberSegment, that each represent a segment of a Fiber.
  The segments are tested for intersection in 3D.
  */
-void PointGrid::checkLL(Meca& meca, PointGridParam const& pam,
+template < typename MECA >
+void PointGrid::checkLL(MECA& meca, PointGridParam const& pam,
                         FatSegment const& aa, FatSegment const& bb) const
 {
     //std::clog << "LL " << aa.seg << " " << bb.seg << std::endl;
@@ -448,27 +668,40 @@ inline bool adjacent(FatSegment const* a, FatSegment const* b)
 #pragma mark - Check all possible object pairs from two Cells
 
 /**
- This will consider once all pairs of objects from the given lists
+ This will consider once all pairs of objects from the given list
  */
-void PointGrid::setInteractions(Meca& meca, PointGridParam const& stiff,
-                                FatPointList & pots, FatSegmentList & locs) const
+template < typename MECA >
+void PointGrid::setInteractions(MECA& meca, PointGridParam const& stiff,
+                                uint8_t * flg, index_t S) const
 {
-    for ( FatPoint* ii = pots.begin(); ii < pots.end(); ++ii )
+    FatPoint const* pots = points.data() + pointStart[S];
+    FatPoint const* pend = points.data() + pointStart[S+1];
+    const index_t linf = segmentStart[S];
+    const index_t lsup = segmentStart[S+1];
+    FatSegment const* locs = segments.data() + linf;
+    FatSegment const* lend = segments.data() + lsup;
+
+    for ( FatPoint const* ii = pots; ii < pend; ++ii )
     {
-        for ( FatPoint* jj = ii+1; jj < pots.end(); ++jj )
+        for ( FatPoint const* jj = ii+1; jj < pend; ++jj )
             if ( !adjacent(ii, jj) )
                 checkPP(meca, stiff, *ii, *jj);
         
-        for ( FatSegment* kk = locs.begin(); kk < locs.end(); ++kk )
+        for ( FatSegment const* kk = locs; kk < lend; ++kk )
             if ( !adjacent(ii, kk) )
                 checkPL(meca, stiff, *ii, *kk);
     }
     
-    for ( FatSegment* ii = locs.begin(); ii < locs.end(); ++ii )
+    for ( index_t i = linf; i < lsup; ++i )
     {
-        for ( FatSegment* jj = ii+1; jj < locs.end(); ++jj )
-            if ( !adjacent(ii, jj) )
+        markNearby(flg, i, i+1, lsup, 0);
+        FatSegment const* ii = segments.data() + i;
+        for ( index_t j = i+1; j < lsup; ++j )
+        {
+            FatSegment const* jj = segments.data() + j;
+            if ( flg[j] && !adjacent(ii, jj) )
                 checkLL(meca, stiff, *ii, *jj);
+        }
     }
 }
 
@@ -477,33 +710,46 @@ void PointGrid::setInteractions(Meca& meca, PointGridParam const& stiff,
  This will consider once all pairs of objects from the given lists,
  assuming that the list are different and no object is repeated
  */
-void PointGrid::setInteractions(Meca& meca, PointGridParam const& pam,
-                                FatPointList & pots1, FatSegmentList & locs1,
-                                FatPointList & pots2, FatSegmentList & locs2) const
+template < typename MECA >
+void PointGrid::setInteractions(MECA& meca, PointGridParam const& pam,
+                                uint8_t * flg, index_t S1, index_t S2) const
 {
-    assert_true( &pots1 != &pots2 );
-    assert_true( &locs1 != &locs2 );
+    assert_true( S1 != S2 );
     
-    for ( FatPoint* ii = pots1.begin(); ii < pots1.end(); ++ii )
+    FatPoint const* pots1 = points.data() + pointStart[S1];
+    FatPoint const* pend1 = points.data() + pointStart[S1+1];
+    FatPoint const* pots2 = points.data() + pointStart[S2];
+    FatPoint const* pend2 = points.data() + pointStart[S2+1];
+    const index_t linf1 = segmentStart[S1];
+    const index_t lsup1 = segmentStart[S1+1];
+    const index_t linf2 = segmentStart[S2];
+    const index_t lsup2 = segmentStart[S2+1];
+    FatSegment const* locs2 = segments.data() + linf2;
+    FatSegment const* lend2 = segments.data() + lsup2;
+
+    for ( FatPoint const* ii = pots1; ii < pend1; ++ii )
     {
-        for ( FatPoint* jj = pots2.begin(); jj < pots2.end(); ++jj )
+        for ( FatPoint const* jj = pots2; jj < pend2; ++jj )
             if ( !adjacent(ii, jj) )
                 checkPP(meca, pam, *ii, *jj);
         
-        for ( FatSegment* kk = locs2.begin(); kk < locs2.end(); ++kk )
+        for ( FatSegment const* kk = locs2; kk < lend2; ++kk )
             if ( !adjacent(ii, kk) )
                 checkPL(meca, pam, *ii, *kk);
     }
     
-    for ( FatSegment* ii = locs1.begin(); ii < locs1.end(); ++ii )
+    for ( index_t i = linf1; i < lsup1; ++i )
     {
-        for ( FatPoint* jj = pots2.begin(); jj < pots2.end(); ++jj )
+        FatSegment const* ii = segments.data() + i;
+        for ( FatPoint const* jj = pots2; jj < pend2; ++jj )
             if ( !adjacent(jj, ii) )
                 checkPL(meca, pam, *jj, *ii);
         
-        for ( FatSegment* kk = locs2.begin(); kk < locs2.end(); ++kk )
+        markNearby(flg, i, linf2, lsup2, 0);
+        for ( index_t k = linf2; k < lsup2; ++k )
         {
-            if ( !adjacent(ii, kk)  )
+            FatSegment const* kk = segments.data() + k;
+            if ( flg[k] && !adjacent(ii, kk) )
                 checkLL(meca, pam, *ii, *kk);
         }
     }
@@ -513,71 +759,436 @@ void PointGrid::setInteractions(Meca& meca, PointGridParam const& pam,
 #if ( NB_STERIC_PANES == 1 )
 
 /**
- Check interactions between objects contained in the grid.
+ Check interactions between objects contained in cells [inf, sup[,
+ and the objects of the neighboring cells.
  */
-void  PointGrid::setInteractions(Meca& meca, PointGridParam const& pam) const
+template < typename MECA >
+void PointGrid::scanCells(MECA& meca, PointGridParam const& pam,
+                          uint8_t * flg, index_t inf, index_t sup) const
 {
-    assert_true(pam.stiff_push >= 0);
-    assert_true(pam.stiff_pull >= 0);
-    //std::clog << "----" << std::endl;
-
-    // scan all cells to examine each pair of particles:
-    for ( unsigned inx = 0; inx < pGrid.nbCells(); ++inx )
+    for ( index_t inx = inf; inx < sup; ++inx )
     {
+        // skip the empty tiles:
+        if ( sparse && !tiles.occupied(inx) )
+        {
+            inx |= TiledIndex::TILE - 1;
+            continue;
+        }
         int * region;
         int nr = pGrid.getRegion(region, inx);
         assert_true(region[0] == 0);
         
         // We consider each pair of objects (ii, jj) only once:
+        const index_t S = list(inx);
+        setInteractions(meca, pam, flg, S);
+        
+        for ( int reg = 1; reg < nr; ++reg )
+            setInteractions(meca, pam, flg, S, list(inx+region[reg]));
+    }
+}
+
+
+/**
+ Returns the first cell `c` such that the number of objects in cells [0, c[
+ is at least `num / den` of the total.
+ */
+PointGrid::index_t PointGrid::splitCells(index_t num, index_t den) const
+{
+    const index_t nbc = pGrid.nbCells();
+    const size_t goal = ( points.size() + segments.size() ) * num / den;
+    if ( sparse )
+    {
+        // split at the first occupied tile reaching the goal:
+        for ( index_t t = 0; t < tiles.nbTiles(); ++t )
+        {
+            if ( tiles.occupiedTile(t) )
+            {
+                index_t s = list(t*TiledIndex::TILE);
+                if ( pointStart[s] + segmentStart[s] >= goal )
+                    return t*TiledIndex::TILE;
+            }
+        }
+        return nbc;
+    }
+    index_t a = 0, b = nbc;
+    while ( a < b )
+    {
+        index_t c = ( a + b ) / 2;
+        if ( pointStart[c] + segmentStart[c] < goal )
+            a = c + 1;
+        else
+            b = c;
+    }
+    return a;
+}
+
+
+//------------------------------------------------------------------------------
+#pragma mark - Verlet list of pairs
+
+/**
+ Record pairs from one list, in the order used by setInteractions()
+ */
+void PointGrid::recordPairs(index_t S)
+{
+    const index_t pinf = pointStart[S];
+    const index_t psup = pointStart[S+1];
+    const index_t linf = segmentStart[S];
+    const index_t lsup = segmentStart[S+1];
+    uint8_t * flg = nearby.data();
+
+    for ( index_t i = pinf; i < psup; ++i )
+    {
+        for ( index_t j = i+1; j < psup; ++j )
+            if ( !adjacent(&points[i], &points[j]) )
+                pairs.push_back(StericPair(pointIndex[i], pointIndex[j], PAIR_PP));
         
-        FatPointList & baseP = point_list(inx);
-        FatSegmentList & baseL = segment_list(inx);
+        for ( index_t k = linf; k < lsup; ++k )
+            if ( !adjacent(&points[i], &segments[k]) )
+                pairs.push_back(StericPair(pointIndex[i], segmentIndex[k], PAIR_PL));
+    }
+    
+    for ( index_t i = linf; i < lsup; ++i )
+    {
+        markNearby(flg, i, i+1, lsup, skin);
+        for ( index_t j = i+1; j < lsup; ++j )
+            if ( flg[j] && !adjacent(&segments[i], &segments[j]) )
+                pairs.push_back(StericPair(segmentIndex[i], segmentIndex[j], PAIR_LL));
+    }
+}
+
+
+/**
+ Record pairs from two different lists, in the order used by setInteractions()
+ */
+void PointGrid::recordPairs(index_t S1, index_t S2)
+{
+    const index_t pinf1 = pointStart[S1];
+    const index_t psup1 = pointStart[S1+1];
+    const index_t pinf2 = pointStart[S2];
+    const index_t psup2 = pointStart[S2+1];
+    const index_t linf1 = segmentStart[S1];
+    const index_t lsup1 = segmentStart[S1+1];
+    const index_t linf2 = segmentStart[S2];
+    const index_t lsup2 = segmentStart[S2+1];
+    uint8_t * flg = nearby.data();
+
+    for ( index_t i = pinf1; i < psup1; ++i )
+    {
+        for ( index_t j = pinf2; j < psup2; ++j )
+            if ( !adjacent(&points[i], &points[j]) )
+                pairs.push_back(StericPair(pointIndex[i], pointIndex[j], PAIR_PP));
+        
+        for ( index_t k = linf2; k < lsup2; ++k )
+            if ( !adjacent(&points[i], &segments[k]) )
+                pairs.push_back(StericPair(pointIndex[i], segmentIndex[k], PAIR_PL));
+    }
+    
+    for ( index_t i = linf1; i < lsup1; ++i )
+    {
+        for ( index_t j = pinf2; j < psup2; ++j )
+            if ( !adjacent(&points[j], &segments[i]) )
+                pairs.push_back(StericPair(pointIndex[j], segmentIndex[i], PAIR_PL));
         
-        setInteractions(meca, pam, baseP, baseL);
+        markNearby(flg, i, linf2, lsup2, skin);
+        for ( index_t k = linf2; k < lsup2; ++k )
+            if ( flg[k] && !adjacent(&segments[i], &segments[k]) )
+                pairs.push_back(StericPair(segmentIndex[i], segmentIndex[k], PAIR_LL));
+    }
+}
+
+
+/**
+ Find all pairs of objects that are within their range of interaction
+ plus `skin`, and record the current positions of the objects.
+ */
+void PointGrid::buildPairs()
+{
+    sortObjects();
+    pairs.clear();
+    
+    for ( index_t inx = 0; inx < pGrid.nbCells(); ++inx )
+    {
+        // skip the empty tiles:
+        if ( sparse && !tiles.occupied(inx) )
+        {
+            inx |= TiledIndex::TILE - 1;
+            continue;
+        }
+        int * region;
+        int nr = pGrid.getRegion(region, inx);
+        assert_true(region[0] == 0);
         
+        const index_t S = list(inx);
+        recordPairs(S);
         for ( int reg = 1; reg < nr; ++reg )
+            recordPairs(S, list(inx+region[reg]));
+    }
+    
+    pointRef = pointAdded;
+    segmentRef = segmentAdded;
+    segmentPos.resize(2*segmentAdded.size());
+    for ( index_t i = 0; i < segmentAdded.size(); ++i )
+    {
+        segmentPos[2*i  ] = segmentAdded[i].seg.pos1();
+        segmentPos[2*i+1] = segmentAdded[i].seg.pos2();
+    }
+    pairsValid = true;
+}
+
+
+/**
+ The list of pairs remains valid if the same objects were added in the same
+ order as when the list was built, and if none has moved by more than skin/2.
+ The positions of the vertices are compared, without folding them.
+ */
+bool PointGrid::checkPairs() const
+{
+    if ( !pairsValid )
+        return false;
+    if ( pointAdded.size() != pointRef.size() || segmentAdded.size() != segmentRef.size() )
+        return false;
+    
+    const real lim = 0.25 * skin * skin;
+    for ( index_t i = 0; i < pointAdded.size(); ++i )
+    {
+        FatPoint const& P = pointAdded[i];
+        FatPoint const& R = pointRef[i];
+        if ( P.pnt.mecable() != R.pnt.mecable() || P.pnt.point() != R.pnt.point() )
+            return false;
+        if ( ( P.pos - R.pos ).normSqr() > lim )
+            return false;
+    }
+    for ( index_t i = 0; i < segmentAdded.size(); ++i )
+    {
+        FiberSegment const& S = segmentAdded[i].seg;
+        FiberSegment const& R = segmentRef[i].seg;
+        if ( S.fiber() != R.fiber() || S.point() != R.point() )
+            return false;
+        if ( ( S.pos1() - segmentPos[2*i] ).normSqr() > lim )
+            return false;
+        if ( ( S.pos2() - segmentPos[2*i+1] ).normSqr() > lim )
+            return false;
+    }
+    return true;
+}
+
+
+/**
+ Check the pairs of objects in [inf, sup[ of the Verlet list,
+ using the current positions of the objects
+ */
+template < typename MECA >
+void PointGrid::scanPairs(MECA& meca, PointGridParam const& pam, index_t inf, index_t sup) const
+{
+    for ( index_t n = inf; n < sup; ++n )
+    {
+        StericPair const& P = pairs[n];
+        switch ( P.kind )
         {
-            FatPointList & sideP = point_list(inx+region[reg]);
-            FatSegmentList & sideL = segment_list(inx+region[reg]);
-            
-            setInteractions(meca, pam, baseP, baseL, sideP, sideL);
+            case PAIR_PP: checkPP(meca, pam, pointAdded[P.a], pointAdded[P.b]); break;
+            case PAIR_PL: checkPL(meca, pam, pointAdded[P.a], segmentAdded[P.b]); break;
+            case PAIR_LL: checkLL(meca, pam, segmentAdded[P.a], segmentAdded[P.b]); break;
         }
     }
 }
 
 
+/**
+ Check `big` against the objects from the cells that are within `reach` of its
+ center, in each dimension. With periodic boundaries, each cell is visited once.
+ */
+void PointGrid::checkLarge(Meca& meca, PointGridParam const& pam, FatPoint const& big, real reach) const
+{
+    int inf[3] = { 0, 0, 0 };
+    int sup[3] = { 0, 0, 0 };
+    for ( int d = 0; d < DIM; ++d )
+    {
+        const int n = pGrid.breadth(d);
+        int i = (int)std::floor(( big.pos[d] - reach - pGrid.inf(d) ) * pGrid.delta(d));
+        int s = (int)std::floor(( big.pos[d] + reach - pGrid.inf(d) ) * pGrid.delta(d));
+        if ( pGrid.isPeriodic(d) )
+        {
+            if ( s - i + 1 >= n )
+            {
+                i = 0;
+                s = n - 1;
+            }
+        }
+        else
+        {
+            // the objects outside the grid are in the edge cells:
+            i = std::min(std::max(i, 0), n-1);
+            s = std::min(std::max(s, 0), n-1);
+        }
+        inf[d] = i;
+        sup[d] = s;
+    }
+    
+    const real rad = std::max(big.radius, big.range);
+    int c[3];
+    for ( c[2] = inf[2]; c[2] <= sup[2]; ++c[2] )
+    for ( c[1] = inf[1]; c[1] <= sup[1]; ++c[1] )
+    for ( c[0] = inf[0]; c[0] <= sup[0]; ++c[0] )
+    {
+        const index_t S = list(pGrid.pack(c));
+        
+        for ( index_t i = pointStart[S]; i < pointStart[S+1]; ++i )
+            if ( !adjacent(&big, &points[i]) )
+                checkPP(meca, pam, big, points[i]);
+        
+        for ( index_t k = segmentStart[S]; k < segmentStart[S+1]; ++k )
+        {
+            if ( !modulo )
+            {
+                // skip segments that are too far, using their bounding sphere:
+                Vector dx = segments[k].seg.center() - big.pos;
+                const real r = rad + segmentR[k];
+                if ( dx.normSqr() > r * r )
+                    continue;
+            }
+            if ( !adjacent(&big, &segments[k]) )
+                checkPL(meca, pam, big, segments[k]);
+        }
+    }
+}
+
+
+/**
+ Check the large FatPoints against the objects on the grid, and against each other.
+ This is done by one thread, after the interactions between the objects on the grid.
+ */
+void PointGrid::setLargeInteractions(Meca& meca, PointGridParam const& pam)
+{
+    // the lists of the grid are needed, even if the Verlet list is used:
+    if ( !sorted )
+        sortObjects();
+    
+    // maximum distance from its cell at which an object of the grid may interact:
+    real ext = 0;
+    for ( FatPoint const& P : points )
+        ext = std::max(ext, std::max(P.radius, P.range));
+    for ( index_t k = 0; k < segmentR.size(); ++k )
+        ext = std::max(ext, segmentR[k]);
+    
+    for ( FatPoint const* ii = largeAdded.begin(); ii < largeAdded.end(); ++ii )
+    {
+        checkLarge(meca, pam, *ii, std::max(ii->radius, ii->range) + ext);
+        
+        for ( FatPoint const* jj = ii+1; jj < largeAdded.end(); ++jj )
+            if ( !adjacent(ii, jj) )
+                checkPP(meca, pam, *ii, *jj);
+    }
+}
+
+
+/**
+ Check interactions between all objects, that are on the grid or large.
+ */
+void PointGrid::setInteractions(Meca& meca, PointGridParam const& pam)
+{
+    setGridInteractions(meca, pam);
+    
+    if ( largeAdded.size() )
+        setLargeInteractions(meca, pam);
+}
+
+
+/**
+ Check interactions between objects contained in the grid.
+ 
+ With multiple threads, the cells are divided into contiguous ranges containing
+ similar numbers of objects. Each thread records the interactions in a MecaStage,
+ and the stages are transfered to Meca in the order of the cells, such that the
+ result does not depend on the number of threads.
+ */
+void PointGrid::setGridInteractions(Meca& meca, PointGridParam const& pam)
+{
+    assert_true(pam.stiff_push >= 0);
+    assert_true(pam.stiff_pull >= 0);
+    //std::clog << "----" << std::endl;
+    
+    if ( skin > 0 )
+    {
+        if ( !checkPairs() )
+            buildPairs();
+        
+        const index_t nbp = pairs.size();
+#ifdef _OPENMP
+        if ( nbThreads > 1 && nbp > 256 )
+        {
+            stages.resize(nbThreads);
+            for ( MecaStage & S : stages )
+                S.clear();
+            #pragma omp parallel num_threads(nbThreads)
+            {
+                const index_t T = omp_get_num_threads();
+                const index_t t = omp_get_thread_num();
+                scanPairs(stages[t], pam, nbp*t/T, nbp*(t+1)/T);
+            }
+            for ( MecaStage const& S : stages )
+                S.commit(meca);
+            return;
+        }
+#endif
+        scanPairs(meca, pam, 0, nbp);
+        return;
+    }
+    
+    if ( !sorted )
+        sortObjects();
+    
+    const index_t nbc = pGrid.nbCells();
+#ifdef _OPENMP
+    if ( nbThreads > 1 && segments.size() + points.size() > 256 )
+    {
+        stages.resize(nbThreads);
+        for ( MecaStage & S : stages )
+            S.clear();
+        const index_t nbl = segments.size();
+        nearby.resize(nbl*nbThreads);
+        #pragma omp parallel num_threads(nbThreads)
+        {
+            const index_t T = omp_get_num_threads();
+            const index_t t = omp_get_thread_num();
+            const index_t sup = ( t+1 < T ) ? splitCells(t+1, T) : nbc;
+            scanCells(stages[t], pam, nearby.data()+t*nbl, splitCells(t, T), sup);
+        }
+        for ( MecaStage const& S : stages )
+            S.commit(meca);
+        return;
+    }
+#endif
+    scanCells(meca, pam, nearby.data(), 0, nbc);
+}
+
+
 #else
 
 /**
  Check interactions between the FatPoints contained in Pane `pan`.
  */
 void  PointGrid::setInteractions(Meca& meca, PointGridParam const& pam,
-                                 const unsigned pan) const
+                                 const unsigned pan)
 {
     assert_true(pam.stiff_push >= 0);
     assert_true(pam.stiff_pull >= 0);
     
+    if ( !sorted )
+        sortObjects();
+
     // scan all cells to examine each pair of particles:
-    for ( unsigned inx = 0; inx < pGrid.nbCells(); ++inx )
+    for ( index_t inx = 0; inx < pGrid.nbCells(); ++inx )
     {
         int * region;
         int nr = pGrid.getRegion(region, inx);
         assert_true(region[0] == 0);
         
         // We consider each pair of objects (ii, jj) only once:
-        
-        FatPointList & baseP = point_list(inx, pan);
-        FatSegmentList & baseL = segment_list(inx, pan);
-        
-        setInteractions(meca, pam, baseP, baseL);
+        setInteractions(meca, pam, nearby.data(), list(slot(inx, pan)));
 
         for ( int reg = 1; reg < nr; ++reg )
-        {
-            FatPointList & sideP = point_list(inx+region[reg], pan);
-            FatSegmentList & sideL = segment_list(inx+region[reg], pan);
-            
-            setInteractions(meca, pam, baseP, baseL, sideP, sideL);
-        }
+            setInteractions(meca, pam, nearby.data(), list(slot(inx, pan)), list(slot(inx+region[reg], pan)));
     }
 }
 
@@ -587,42 +1198,28 @@ void  PointGrid::setInteractions(Meca& meca, PointGridParam const& pam,
  where ( pan1 != pan2 )
  */
 void  PointGrid::setInteractions(Meca& meca, PointGridParam const& pam,
-                                 const unsigned pan1, const unsigned pan2) const
+                                 const unsigned pan1, const unsigned pan2)
 {
     assert_true(pam.stiff_push >= 0);
     assert_true(pam.stiff_pull >= 0);
     assert_true(pan1 != pan2);
     
+    if ( !sorted )
+        sortObjects();
+
     // scan all cells to examine each pair of particles:
-    for ( unsigned inx = 0; inx < pGrid.nbCells(); ++inx )
+    for ( index_t inx = 0; inx < pGrid.nbCells(); ++inx )
     {
         int * region;
         int nr = pGrid.getRegion(region, inx);
         assert_true(region[0] == 0);
 
         // We consider each pair of objects (ii, jj) only once:
-        
-        FatPointList & baseP = point_list(inx, pan1);
-        FatSegmentList & baseL = segment_list(inx, pan1);
-
         for ( int reg = 0; reg < nr; ++reg )
-        {
-            FatPointList & sideP = point_list(inx+region[reg], pan2);
-            FatSegmentList & sideL = segment_list(inx+region[reg], pan2);
-
-            setInteractions(meca, pam, baseP, baseL, sideP, sideL);
-        }
-        
-        FatPointList & baseP2 = point_list(inx, pan2);
-        FatSegmentList & baseL2 = segment_list(inx, pan2);
+            setInteractions(meca, pam, nearby.data(), list(slot(inx, pan1)), list(slot(inx+region[reg], pan2)));
         
         for ( int reg = 1; reg < nr; ++reg )
-        {
-            FatPointList & sideP = point_list(inx+region[reg], pan1);
-            FatSegmentList & sideL = segment_list(inx+region[reg], pan1);
-            
-            setInteractions(meca, pam, baseP2, baseL2, sideP, sideL);
-        }
+            setInteractions(meca, pam, nearby.data(), list(slot(inx, pan2)), list(slot(inx+region[reg], pan1)));
     }
 }
 
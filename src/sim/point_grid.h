@@ -2,12 +2,15 @@
 #ifndef POINT_GRID_H
 #define POINT_GRID_H
 
-#include "grid.h"
+#include "grid_base.h"
+#include "tiled_index.h"
 #include "dim.h"
 #include "vector.h"
 #include "mecapoint.h"
 #include "fiber_segment.h"
 #include "array.h"
+#include "meca_stage.h"
+#include <vector>
 
 class Space;
 class Modulo;
@@ -129,85 +132,6 @@ typedef Array<FatSegment> FatSegmentList;
 #define NB_STERIC_PANES 1
 
 
-/// a set of lists associated with the same location
-class PointGridCell
-{
-    friend class PointGrid;
-    
-#if ( NB_STERIC_PANES == 1 )
-    
-    /// unique steric pane
-    FatPointList point_pane;
-    
-    /// unique steric pane
-    FatSegmentList segment_pane;
-
-#else
-
-    /// different steric panes
-    FatPointList point_panes_0[NB_STERIC_PANES];
-
-    /// different steric panes
-    FatSegmentList segment_panes_0[NB_STERIC_PANES];
-
-    /// alias to the array of panes, with index 1 refering to point_panes_0[0]
-    FatPointList * point_panes;
-
-    /// alias to the array of panes, with index 1 refering to segment_panes_0[0]
-    FatSegmentList * segment_panes;
-
-#endif
-    
-public:
-    
-#if ( NB_STERIC_PANES == 1 )
-    
-    PointGridCell()
-    {
-    }
-    
-    /// clear all panes
-    void clear()
-    {
-        point_pane.clear();
-        segment_pane.clear();
-    }
-
-#else
-    
-    PointGridCell() : point_panes(point_panes_0), segment_panes(segment_panes_0)
-    {
-        --point_panes;
-        --segment_panes;
-    }
-    
-    /// clear all panes
-    void clear()
-    {
-        for ( unsigned p = 1; p <= NB_STERIC_PANES; ++p )
-        {
-            point_panes[p].clear();
-            segment_panes[p].clear();
-        }
-    }
-    
-    FatPointList& point_list(unsigned p)
-    {
-        assert_true( 0 < p && p <= NB_STERIC_PANES );
-        return point_panes[p];
-    }
-    
-    
-    FatSegmentList& segment_list(unsigned p)
-    {
-        assert_true( 0 < p && p <= NB_STERIC_PANES );
-        return segment_panes[p];
-    }
-
-#endif
-};
-
-
 /// Contains the stiffness parameters for the steric engine
 class PointGridParam
 {
@@ -227,106 +151,243 @@ public:
 /**
  A divide-and-conquer algorithm is used to find FatPoints that overlap:
  - It uses a grid 'pGrid' covering the space, initialized by setGrid()
- To each point on pGrid is associated a list of FatPoint* of class PointGridCell.
+ To each cell of pGrid is associated a list of FatPoint and a list of FatSegment.
  - The functions 'add()' position the given FatPoints on the grid
  - Function setStericInteraction() uses pGrid to find pairs of FatPoints that may overlap.
  It then calculates their actual distance, and set a interaction from Meca if necessary
  .
+ 
+ The objects are recorded by add() in the order of the calls, with the index
+ of their cell. Before the interactions are calculated, sortObjects() reorders
+ them by cell using a counting sort, such that the objects of each cell are
+ contiguous in memory: the points of cell `c` are [ pointStart[c], pointStart[c+1] [
+ in `points`, and similarly for segments. The order of the objects within a cell
+ is the order in which they were added.
+ 
+ The centers of the segments, and a radius that bounds the segment with its range
+ of interaction, are also copied into separate arrays (struct-of-arrays), such
+ that pairs of segments that are too far apart to interact can be skipped
+ with a vectorizable loop before calling checkLL().
+ 
+ With multiple panes (NB_STERIC_PANES > 1), each cell has one list per pane.
+ 
+ With the sparse layout (setSparse), the lists are grouped in tiles, and only the
+ tiles containing some object have an entry in `pointStart` and `segmentStart`
+ (see TiledIndex). The empty tiles are skipped when the cells are scanned.
+ 
+ If a radius is specified with setLarge(), the FatPoints that are larger are not
+ placed on the grid, since a uniform grid cannot be adapted at the same time to
+ objects of very different sizes. Each large FatPoint is instead checked against
+ the objects of all the cells that it overlaps, and against the other large FatPoints.
+ The cells then only need to be adapted to the small objects.
 */
 class PointGrid
 {
+public:
+    
+    /// type of grid
+    typedef GridBase<DIM> grid_type;
+    
+    /// type of index
+    typedef grid_type::index_t index_t;
+    
 private:
     
     /// grid for divide-and-conquer strategies:
-    Grid<PointGridCell, DIM> pGrid;
+    grid_type pGrid;
+    
+    /// value of `min_step` given to setGrid() when the dimensions were set
+    real pStep;
     
     /// max radius that can be included
     real max_diameter;
     
-private:
+    /// FatPoint in the order in which they were added
+    FatPointList   pointAdded;
     
-    /// check two Spheres
-    void checkPP(Meca&, PointGridParam const&, FatPoint const&, FatPoint const&) const;
+    /// FatSegment in the order in which they were added
+    FatSegmentList segmentAdded;
     
-    /// check Sphere against Line segment
-    void checkPL(Meca&, PointGridParam const&, FatPoint const&, FatSegment const&) const;
+    /// list (cell and pane) of each FatPoint in `pointAdded`
+    Array<index_t> pointSlot;
     
-    /// check Line segment against Sphere
-    void checkLL1(Meca&, PointGridParam const&, FatSegment const&, FatSegment const&) const;
+    /// list (cell and pane) of each FatSegment in `segmentAdded`
+    Array<index_t> segmentSlot;
     
-    /// check Line segment against Sphere
-    void checkLL2(Meca&, PointGridParam const&, FatSegment const&, FatSegment const&) const;
+    /// FatPoint sorted by list
+    FatPointList   points;
     
-    /// check two Line segments
-    void checkLL(Meca&, PointGridParam const&, FatSegment const&, FatSegment const&) const;
-
-    /// check all interacting pairs between the two lists
-    void setInteractions(Meca&, PointGridParam const&,
-                         FatPointList &, FatSegmentList &) const;
-    
-    /// check all interacting pairs between the two lists
-    void setInteractions(Meca&, PointGridParam const&,
-                         FatPointList &, FatSegmentList &,
-                         FatPointList &, FatSegmentList &) const;
-
-#if ( NB_STERIC_PANES == 1 )
+    /// FatSegment sorted by list
+    FatSegmentList segments;
+    
+    /// if true, the lists are only allocated for the occupied tiles of the grid
+    bool           sparse;
+    
+    /// map from slots to lists, used if `sparse`
+    TiledIndex     tiles;
+    
+    /// index in `points` of the first FatPoint of each list
+    Array<index_t> pointStart;
+    
+    /// index in `segments` of the first FatSegment of each list
+    Array<index_t> segmentStart;
 
-    /// cell corresponding to position `w`, and pane `p`
-    FatPointList& point_list(Vector const& w) const
-    {
-        return pGrid.cell(w).point_pane;
-    }
+    /// coordinates of the centers of the sorted FatSegment
+    Array<real>    segmentX[DIM];
+    
+    /// half length of the sorted FatSegment plus maximum range of interaction
+    Array<real>    segmentR;
+    
+    /// flags set by markNearby(), for each thread
+    Array<uint8_t> nearby;
+    
+    /// interactions found by each thread
+    std::vector<MecaStage> stages;
+    
+    /// number of threads used to find the interactions
+    int            nbThreads;
+    
+    /// types of pairs in the Verlet list
+    enum { PAIR_PP, PAIR_PL, PAIR_LL };
 
-    /// cell corresponding to position `w`, and pane `p`
-    FatSegmentList& segment_list(Vector const& w) const
+    /// a pair of objects that may interact, as indices in `pointAdded` or `segmentAdded`
+    struct StericPair
     {
-        return pGrid.cell(w).segment_pane;
-    }
+        index_t a, b;
+        int kind;
+        StericPair() : a(0), b(0), kind(0) {}
+        StericPair(index_t x, index_t y, int k) : a(x), b(y), kind(k) {}
+    };
+    
+    /// extra distance used to build the list of pairs
+    real           skin;
+    
+    /// list of pairs that may interact (Verlet list), valid if `pairsValid`
+    Array<StericPair> pairs;
+    
+    /// true if `pairs` was built
+    bool           pairsValid;
+    
+    /// index in `pointAdded` of the sorted FatPoint
+    Array<index_t> pointIndex;
+    
+    /// index in `segmentAdded` of the sorted FatSegment
+    Array<index_t> segmentIndex;
+    
+    /// copy of `pointAdded` when the list of pairs was built
+    FatPointList   pointRef;
+    
+    /// copy of `segmentAdded` when the list of pairs was built
+    FatSegmentList segmentRef;
+    
+    /// position of the vertices of the FatSegment when the list of pairs was built
+    Array<Vector>  segmentPos;
+    
+    /// true if the objects have been sorted since the last add()
+    bool           sorted;
+    
+    /// radius above which a FatPoint is not placed on the grid, if positive
+    real           large;
+    
+    /// FatPoint larger than `large`, in the order in which they were added
+    FatPointList   largeAdded;
 
-    /// cell corresponding to index `w`, and pane `p`
-    FatPointList& point_list(const unsigned w) const
+private:
+    
+    /// index of the list corresponding to cell `c` and pane `p`
+    static index_t slot(index_t c, unsigned p)
     {
-        return pGrid.icell(w).point_pane;
+        return c * NB_STERIC_PANES + ( p - 1 );
     }
     
-    /// cell corresponding to index `w`, and pane `p`
-    FatSegmentList& segment_list(const unsigned w) const
+    /// index of the list corresponding to slot `s`, in `pointStart` and `segmentStart`
+    index_t list(index_t s) const
     {
-        return pGrid.icell(w).segment_pane;
+        return sparse ? tiles.slot(s) : s;
     }
     
-#else
+    /// sort the objects by list, using a counting sort
+    void sortObjects();
     
-    /// cell corresponding to position `w`, and pane `p`
-    FatPointList& point_list(Vector const& w, const unsigned p) const
-    {
-        assert_true( 0 < p && p <= NB_STERIC_PANES );
-        return pGrid.cell(w).point_panes[p];
-    }
+    /// set flag for all segments in [inf, sup[ that may be close enough from segment `i`
+    void markNearby(uint8_t*, index_t i, index_t inf, index_t sup, real ext) const;
     
-    /// cell corresponding to position `w`, and pane `p`
-    FatSegmentList& segment_list(Vector const& w, const unsigned p) const
-    {
-        assert_true( 0 < p && p <= NB_STERIC_PANES );
-        return pGrid.cell(w).segment_panes[p];
-    }
+    /// check two Spheres
+    template < typename MECA >
+    void checkPP(MECA&, PointGridParam const&, FatPoint const&, FatPoint const&) const;
+    
+    /// check Sphere against Line segment
+    template < typename MECA >
+    void checkPL(MECA&, PointGridParam const&, FatPoint const&, FatSegment const&) const;
+    
+    /// check Line segment against Sphere
+    template < typename MECA >
+    void checkLL1(MECA&, PointGridParam const&, FatSegment const&, FatSegment const&) const;
+    
+    /// check Line segment against Sphere
+    template < typename MECA >
+    void checkLL2(MECA&, PointGridParam const&, FatSegment const&, FatSegment const&) const;
+    
+    /// check two Line segments
+    template < typename MECA >
+    void checkLL(MECA&, PointGridParam const&, FatSegment const&, FatSegment const&) const;
+
+    /// check all interacting pairs within one list
+    template < typename MECA >
+    void setInteractions(MECA&, PointGridParam const&, uint8_t*, index_t) const;
+    
+    /// check all interacting pairs between two different lists
+    template < typename MECA >
+    void setInteractions(MECA&, PointGridParam const&, uint8_t*, index_t, index_t) const;
+    
+    /// check all interacting pairs involving the cells in [inf, sup[
+    template < typename MECA >
+    void scanCells(MECA&, PointGridParam const&, uint8_t*, index_t inf, index_t sup) const;
+    
+    /// index of the cell where the objects in the grid are split into equal parts
+    index_t splitCells(index_t, index_t) const;
+    
+    /// record the pairs of objects from one list that may interact
+    void recordPairs(index_t);
     
-    /// cell corresponding to index `c`, and pane `p`
-    FatPointList& point_list(const unsigned c, const unsigned p) const
+    /// record the pairs of objects from two lists that may interact
+    void recordPairs(index_t, index_t);
+    
+    /// build the Verlet list of pairs
+    void buildPairs();
+    
+    /// true if no object was added, removed or has moved by more than skin/2
+    bool checkPairs() const;
+    
+    /// check the pairs in [inf, sup[ of the list
+    template < typename MECA >
+    void scanPairs(MECA&, PointGridParam const&, index_t inf, index_t sup) const;
+    
+    /// check the objects placed on the grid against each other
+    void setGridInteractions(Meca&, PointGridParam const&);
+    
+    /// check large FatPoint against the objects of the cells located within `reach`
+    void checkLarge(Meca&, PointGridParam const&, FatPoint const&, real reach) const;
+    
+    /// check the large FatPoints against all other objects
+    void setLargeInteractions(Meca&, PointGridParam const&);
+
+    /// record a FatPoint
+    void addPoint(index_t s, Mecapoint const& p, real rd, real rg, Vector const& w)
     {
-        assert_true( 0 < p && p <= NB_STERIC_PANES );
-        return pGrid.icell(c).point_panes[p];
+        pointAdded.new_val().set(p, rd, rg, w);
+        pointSlot.push_back(s);
+        sorted = false;
     }
     
-    /// cell corresponding to index `c`, and pane `p`
-    FatSegmentList& segment_list(const unsigned c, const unsigned p) const
+    /// record a FatSegment
+    void addSegment(index_t s, FiberSegment const& p, real rd, real rg)
     {
-        assert_true( 0 < p && p <= NB_STERIC_PANES );
-        return pGrid.icell(c).segment_panes[p];
+        segmentAdded.new_val().set(p, rd, rg);
+        segmentSlot.push_back(s);
+        sorted = false;
     }
 
-#endif
-    
 public:
     
     /// creator
@@ -335,48 +396,68 @@ public:
     /// define grid covering specified Space, with cell of size min_step at least
     size_t setGrid(Space const*, real min_step);
     
+    /// select the sparse layout, which must be done before createCells()
+    void setSparse(bool s) { sparse = s; }
+    
     /// allocate memory for grid
     void createCells();
     
+    /// number of cells in the grid
+    index_t nbCells() const { return pGrid.nbCells(); }
+    
+    /// size of the memory allocated for the lists, in bytes
+    size_t memory() const;
+    
+    /// set number of threads
+    void setThreads(int);
+    
+    /// set extra distance used to build the list of pairs, or disable it with zero
+    void setSkin(real);
+    
+    /// set radius above which the points are not placed on the grid, or disable with zero
+    void setLarge(real r) { large = r; }
+    
     /// true if the grid was initialized by calling setGrid()
-    size_t hasGrid() const  { return pGrid.hasCells(); }
+    size_t hasGrid() const  { return pointStart.size(); }
     
     /// clear the grid
-    void clear()            { pGrid.clear(); }
+    void clear();
     
 #if ( NB_STERIC_PANES == 1 )
     
     /// place Mecapoint on the grid
-    void add(Mecapoint const& p, real radius, real extra_range) const
+    void add(Mecapoint const& p, real radius, real extra_range)
     {
         Vector w = p.pos();
-        point_list(w).new_val().set(p, radius, extra_range, w);
+        if ( 0 < large  &&  large < radius )
+            largeAdded.new_val().set(p, radius, extra_range, w);
+        else
+            addPoint(pGrid.index(w), p, radius, extra_range, w);
     }
     
     /// place FiberSegment on the grid
-    void add(FiberSegment const& p, real radius, real extra_range) const
+    void add(FiberSegment const& p, real radius, real extra_range)
     {
         //we use the middle of the segment (interpolation coefficient is ignored)
-        Vector w = p.center();
-        segment_list(w).new_val().set(p, radius, extra_range);
+        addSegment(pGrid.index(p.center()), p, radius, extra_range);
     }
     
     /// enter interactions into Meca with given stiffness
-    void setInteractions(Meca&, PointGridParam const& pam) const;
+    void setInteractions(Meca&, PointGridParam const& pam);
 
 #else
  
     /// place Mecapoint on the grid
-    void add(unsigned pane, Mecapoint const&, real radius, real extra_range) const;
+    void add(unsigned pane, Mecapoint const&, real radius, real extra_range);
     
     /// place FiberSegment on the grid
-    void add(unsigned pane, FiberSegment const&, real radius, real extra_range) const;
+    void add(unsigned pane, FiberSegment const&, real radius, real extra_range);
     
     /// enter interactions into Meca in one panes with given parameters
-    void setInteractions(Meca&, PointGridParam const& pam, unsigned pan) const;
+    void setInteractions(Meca&, PointGridParam const& pam, unsigned pan);
 
     /// enter interactions into Meca between two panes with given parameters
-    void setInteractions(Meca&, PointGridParam const& pam, unsigned pan1, unsigned pan2) const;
+    void setInteractions(Meca&, PointGridParam const& pam, unsigned pan1, unsigned pan2);
 
 #endif
     
@@ -1,7 +1,9 @@
 // Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
 
 #include "simul.h"
+#include "simul_prop.h"
 #include "parser.h"
+#include "interface.h"
 #include "messages.h"
 #include "glossary.h"
 #include "exceptions.h"
@@ -9,7 +11,14 @@
 #include "filepath.h"
 #include "splash.h"
 #include "tictoc.h"
+#include "run_store.h"
+#include "report_average.h"
 #include <csignal>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <map>
+#include <sys/wait.h>
 #include "unistd.h"
 
 
@@ -17,6 +26,20 @@ void help(std::ostream& os)
 {
     os << "sim [OPTIONS] [FILE]\n";
     os << "  FILE    run specified config file (FILE must end with `.cym')\n";
+    os << "  restart=CHECKPOINT  resume the simulation from a checkpoint file\n";
+    os << "  resume  resume the simulation from `checkpoint.cmo' in the working directory\n";
+    os << "  store=FILE  append trajectory, properties and messages to a shared file\n";
+    os << "  run=NAME    identity of the run in the shared file (default: random seed)\n";
+    os << "  ensemble=N  run N replicas with different seeds, in subdirectories `runXXXX'\n";
+    os << "  threads=T   with `ensemble', number of replicas running at the same time\n";
+    os << "  seed=INT    with `ensemble', master seed from which the seeds are derived\n";
+    os << "  task=K,M    with `ensemble', run only the replicas `i' such that i % M == K\n";
+    os << "  scratch=DIR with `store', write to a local store in DIR, copied at the end\n";
+    os << "  aggregate=FILE,...  with `ensemble', average the reports FILE of the replicas\n";
+    os << "  keep=INT    with `aggregate', number of replica directories to keep (default 0)\n";
+    os << "  variant=INT select combination INT of the `[[ sweep() ]]' in the config\n";
+    os << "  setup=FILE  save the state reached before the first `run', or restore it\n";
+    os << "  channel=PATH  execute commands written to the named pipe PATH during `run'\n";
     os << "  *       print messages to terminal (and not `messages.cmo')\n";
     os << "  info    print build options\n";
     os << "  help    print this message\n";
@@ -38,56 +61,87 @@ void handle_signal(int sig)
 }
 
 
+/// during a run, the first signal leads to a checkpoint, and a second one to exit
 void handle_interrupt(int sig)
 {
+    if ( Interface::canCheckpoint && !Interface::signalReceived )
+    {
+        Interface::signalReceived = sig;
+        return;
+    }
     Cytosim::out << "killed " << sig << "\n" << std::endl;
     _exit(sig);
 }
 
-//------------------------------------------------------------------------------
-//=================================  MAIN  =====================================
 //------------------------------------------------------------------------------
 
-int main(int argc, char* argv[])
+/// value of the environment variable `var`, or `def` if it is not defined
+long env_value(const char var[], long def)
 {
-    // register callback to catch interrupting signals:
-    if ( signal(SIGINT, handle_interrupt) )
-        std::cerr << "Could not register SIGINT handler\n";
-    if ( signal(SIGTERM, handle_interrupt) )
-        std::cerr << "Could not register SIGTERM handler\n";
-    if ( signal(SIGSEGV, handle_signal) )
-        std::cerr << "Could not register SIGSEGV handler\n";
-    if ( signal(SIGILL,  handle_signal) )
-        std::cerr << "Could not register SIGILL handler\n";
-    if ( signal(SIGABRT, handle_signal) )
-        std::cerr << "Could not register SIGABRT handler\n";
-
-    Glossary arg;
+    const char * str = getenv(var);
+    if ( str && *str )
+        return strtol(str, nullptr, 10);
+    return def;
+}
 
-    //parse the command line:
-    if ( arg.read_strings(argc-1, argv+1) )
-        return EXIT_FAILURE;
 
-    if ( arg.use_key("help") || arg.use_key("--help") )
+/// append the local store `local` to `store`, and delete it
+int stage_out(std::string const& local, std::string const& store)
+{
+    if ( RunStore::transfer(local, store) )
     {
-        splash(std::cout);
-        help(std::cout);
-        return EXIT_SUCCESS;
+        std::cerr << "Error: could not copy `" << local << "' to `" << store << "'\n";
+        return EXIT_FAILURE;
     }
+    remove(local.c_str());
+    return EXIT_SUCCESS;
+}
 
-    if ( arg.use_key("info") || arg.use_key("--version")  )
+//------------------------------------------------------------------------------
+
+/// send the messages to `messages.cmo`, or to `mem` if they are sent to a RunStore
+void open_messages(Glossary& arg, bool store, std::ostringstream& mem)
+{
+    if ( arg.use_key("+") )
+        return;
+    if ( store )
+        Cytosim::out.redirect(mem);
+    else
+        Cytosim::out.open("messages.cmo");
+    Cytosim::log.redirect(Cytosim::out);
+    Cytosim::warn.redirect(Cytosim::out);
+}
+
+
+/**
+ Run one simulation, reading the configuration file, or executing `config`
+ if it is not empty. If `seed > 0`, the random generator is seeded with it,
+ and any `random_seed` specified in the configuration is ignored.
+ With `scratch=DIR`, the chunks are written to a store in DIR, which is
+ usually a disk local to the node, and copied to the shared store at the end.
+ */
+int simulate(Glossary& arg, std::string const& config, uint32_t seed)
+{
+    // the messages are kept in memory if they are sent to a RunStore:
+    std::string store, run, scratch, shared;
+    std::ostringstream messages;
+    if ( arg.set(store, "store") )
     {
-        splash(std::cout);
-        print_version(std::cout);
-        return EXIT_SUCCESS;
+        arg.set(run, "run");
+        if ( arg.set(scratch, "scratch") )
+        {
+            shared = store;
+            store = scratch + "/cytosim" + std::to_string(getpid()) + ".cms";
+            if ( shared[0] != '/' )
+                shared = FilePath::get_cwd() + "/" + shared;
+        }
     }
-    
-    if ( ! arg.use_key("+") )
+    else if ( arg.has_key("scratch") )
     {
-        Cytosim::out.open("messages.cmo");
-        Cytosim::log.redirect(Cytosim::out);
-        Cytosim::warn.redirect(Cytosim::out);
+        std::cerr << "Error: `scratch' can only be used with `store'\n";
+        return EXIT_FAILURE;
     }
+    open_messages(arg, store.size(), messages);
     
     // change working directory if specified:
     if ( arg.has_key("directory") )
@@ -102,9 +156,40 @@ int main(int argc, char* argv[])
     Cytosim::out << "CYTOSIM PI\n";
 #endif
 
+    // resume from a checkpoint only if requested, since it may be a leftover:
+    std::string restart;
+    if ( arg.use_key("resume") && !arg.has_key("restart") )
+    {
+        if ( !FilePath::is_file(CHECKPOINT) )
+        {
+            std::cerr << "Error: could not find `" << CHECKPOINT << "' to resume from\n";
+            return EXIT_FAILURE;
+        }
+        restart = CHECKPOINT;
+    }
+    else if ( !arg.set(restart, "restart") && FilePath::is_file(CHECKPOINT) )
+        std::clog << "sim: ignoring `" << CHECKPOINT << "' (use `sim resume' to continue from it)\n";
+    size_t variant = 0;
+    arg.set(variant, "variant");
+    std::string setup;
+    arg.set(setup, "setup");
+    std::string channel;
+    if ( arg.set(channel, "channel") && Interface::open_channel(channel) )
+    {
+        std::cerr << "Error: could not open the command channel `" << channel << "'\n";
+        return EXIT_FAILURE;
+    }
+
     Simul simul;
     try {
+        if ( store.size() )
+            simul.storeRun(store, run);
         simul.initialize(arg);
+        if ( seed )
+        {
+            RNG.seed(seed);
+            simul.prop->random_seed = seed;
+        }
     }
     catch( Exception & e ) {
         print_magenta(std::cerr, e.brief());
@@ -120,21 +205,293 @@ int main(int argc, char* argv[])
     time_t sec = TicToc::seconds_since_1970();
     
     try {
-        Parser(simul, 1, 1, 1, 1, 1).readConfig();
+        Parser parser(simul, 1, 1, 1, 1, 1);
+        parser.setVariant(variant);
+        if ( restart.size() )
+            parser.resume(restart);
+        if ( setup.size() && restart.empty() )
+        {
+            std::string code = config;
+            if ( code.empty() )
+            {
+                std::ifstream is(simul.prop->config_file.c_str());
+                code.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+                if ( code.empty() )
+                    throw InvalidIO("could not find or read `"+simul.prop->config_file+"'");
+            }
+            parser.evaluate(code, setup);
+        }
+        else if ( config.size() )
+            parser.evaluate(config);
+        else
+            parser.readConfig();
     }
     catch( Exception & e ) {
         print_magenta(std::cerr, e.brief());
         std::cerr << '\n' << e.info() << '\n';
+        if ( shared.size() )
+            stage_out(store, shared);
         return EXIT_FAILURE;
     }
     catch(...) {
         std::cerr << "\nError: an unknown exception occurred\n";
+        if ( shared.size() )
+            stage_out(store, shared);
         return EXIT_FAILURE;
     }
     
+    // the checkpoint of a completed simulation should not be resumed:
+    if ( FilePath::is_file(CHECKPOINT) )
+        remove(CHECKPOINT);
+    
     Cytosim::out << "% " << TicToc::date() << "\n";
     sec = TicToc::seconds_since_1970() - sec;
     Cytosim::out << "end  " << sec << " s ( " << (real)( sec / 60 ) / 60.0 << " h )\n";
     Cytosim::out.close();
+    if ( store.size() && messages.tellp() > 0 )
+    {
+        try {
+            simul.writeStored("messages", messages.str().data(), messages.str().size());
+        }
+        catch( Exception & e ) {
+            print_magenta(std::cerr, e.brief());
+            return EXIT_FAILURE;
+        }
+    }
+    if ( shared.size() )
+        return stage_out(store, shared);
     return EXIT_SUCCESS;
 }
+
+
+//------------------------------------------------------------------------------
+
+/// seed of replica `i`, derived from `master` by a 'splitmix' hash
+uint32_t replica_seed(uint32_t master, unsigned i)
+{
+    uint64_t z = ((uint64_t)master << 32 | i) + 0x9E3779B97F4A7C15ULL;
+    z = ( z ^ ( z >> 30 )) * 0xBF58476D1CE4E5B9ULL;
+    z = ( z ^ ( z >> 27 )) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return (uint32_t)z ? (uint32_t)z : 1;
+}
+
+
+/// wait for one replica to finish, setting its `pid` and returning 1 if it failed
+int wait_replica(pid_t& pid)
+{
+    int status = 0;
+    pid = wait(&status);
+    if ( pid < 0 )
+        return 1;
+    return !( WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS );
+}
+
+
+/// include the reports `files` of the replica in `dir`, and delete `dir` unless `keep`
+void aggregate(std::string const& dir, std::vector<std::string> const& files,
+               std::vector<ReportAverage>& avg, bool keep)
+{
+    for ( size_t i = 0; i < files.size(); ++i )
+    {
+        if ( avg[i].add(dir+"/"+files[i]) )
+            std::cerr << "Warning: missing report `" << dir << "/" << files[i] << "'\n";
+    }
+    if ( !keep && FilePath::remove_dir(dir.c_str()) )
+        std::cerr << "Warning: could not delete `" << dir << "'\n";
+}
+
+
+/**
+ Run `cnt` replicas of the simulation, at most `nbt` at the same time.
+ The configuration file is read once, and each replica runs in a process
+ forked from this one, with its own random seed derived from a master seed.
+ Each replica writes its files in its own subdirectory `runXXXX`, or if a
+ RunStore is specified, appends its output to the store as run `runXXXX`.
+ Replica `i` uses the combination `i` of the values of the `[[ sweep() ]]`
+ snippets of the configuration (see Parser::evaluate_snippet).
+ Processes are used rather than threads, because the random generator
+ and the message streams are global.
+
+ With `aggregate=FILE`, the report files `FILE` made by the replicas are combined
+ as the replicas finish, and the mean and standard deviation of their numbers are
+ written to `FILE.mean` and `FILE.std` (see ReportAverage). The directories
+ of the replicas are then deleted, except the first `keep`.
+
+ With `task=K,M`, only the replicas `i` such that `i % M == K` are run, such
+ that the replicas can be distributed over M jobs. Inside a SLURM job array,
+ K and M are derived from SLURM_ARRAY_TASK_ID and SLURM_ARRAY_TASK_COUNT,
+ the number of replicas running at the same time from SLURM_CPUS_PER_TASK,
+ and the master seed from SLURM_ARRAY_JOB_ID, which is shared by all tasks.
+ */
+int ensemble(Glossary& arg, unsigned cnt)
+{
+    unsigned nbt = env_value("SLURM_CPUS_PER_TASK", 1);
+    arg.set(nbt, "threads");
+    arg.clear("threads");
+    if ( nbt < 1 )
+        nbt = std::max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+    
+    uint32_t master = env_value("SLURM_ARRAY_JOB_ID", 0);
+    arg.set(master, "seed");
+    if ( !master )
+        master = RNG.seed();
+    
+    long task = env_value("SLURM_ARRAY_TASK_ID", 0) - env_value("SLURM_ARRAY_TASK_MIN", 0);
+    long nbtasks = env_value("SLURM_ARRAY_TASK_COUNT", 1);
+    if ( arg.set(task, "task") )
+    {
+        nbtasks = 1;
+        arg.set(nbtasks, "task", 1);
+    }
+    if ( nbtasks < 1 || task < 0 || task >= nbtasks )
+    {
+        std::cerr << "Error: invalid task " << task << " of " << nbtasks << '\n';
+        return EXIT_FAILURE;
+    }
+    
+    if ( arg.has_key("restart") || arg.has_key("resume") || arg.has_key("directory") )
+    {
+        std::cerr << "Error: `restart', `resume' and `directory' cannot be used with `ensemble'\n";
+        return EXIT_FAILURE;
+    }
+    
+    std::string file = "config.cym";
+    arg.peek(file, "config") || arg.peek(file, ".cytosim") || arg.peek(file, ".cym");
+    std::ifstream is(file.c_str());
+    std::string config((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+    if ( config.empty() )
+    {
+        std::cerr << "Error: could not read `" << file << "'\n";
+        return EXIT_FAILURE;
+    }
+    bool store = arg.has_key("store");
+    unsigned running = 0, failed = 0, nbr = 0;
+    
+    std::vector<std::string> files;
+    std::string str;
+    for ( size_t i = 0; arg.set(str, "aggregate", i); ++i )
+        files.push_back(str);
+    unsigned keep = 0;
+    arg.set(keep, "keep");
+    if ( store && files.size() )
+    {
+        std::cerr << "Error: `aggregate' cannot be used with `store'\n";
+        return EXIT_FAILURE;
+    }
+    std::vector<ReportAverage> avg(files.size());
+    std::map<pid_t, unsigned> replicas;
+    
+    // wait for one replica to finish, and include its reports:
+    auto finish = [&]()
+    {
+        pid_t pid = 0;
+        int err = wait_replica(pid);
+        failed += err;
+        --running;
+        if ( files.size() && replicas.count(pid) )
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "run%04u", replicas[pid]);
+            // a replica that failed is not included, and kept for inspection:
+            if ( !err )
+                aggregate(name, files, avg, replicas[pid] < keep);
+            replicas.erase(pid);
+        }
+    };
+    
+    // the setup file is shared by the replicas:
+    std::string setup;
+    if ( arg.set(setup, "setup") && setup[0] != '/' )
+        arg.define("setup", FilePath::get_cwd()+"/"+setup);
+    
+    std::cout << "ensemble of " << cnt << " replicas, seed " << master;
+    if ( nbtasks > 1 )
+        std::cout << ", task " << task << " of " << nbtasks;
+    std::cout << std::endl;
+    for ( unsigned i = task; i < cnt; i += nbtasks )
+    {
+        ++nbr;
+        if ( running >= nbt )
+            finish();
+        char name[32];
+        snprintf(name, sizeof(name), "run%04u", i);
+        fflush(nullptr);
+        pid_t pid = fork();
+        if ( pid < 0 )
+        {
+            perror("fork");
+            ++failed;
+        }
+        else if ( pid == 0 )
+        {
+            arg.define("variant", std::to_string(i));
+            if ( store )
+                arg.define("run", name);
+            else if ( FilePath::change_dir(name, true) < 0 )
+                exit(EXIT_FAILURE);
+            exit(simulate(arg, config, replica_seed(master, i)));
+        }
+        else
+        {
+            replicas[pid] = i;
+            ++running;
+        }
+    }
+    while ( running > 0 )
+        finish();
+    for ( size_t i = 0; i < files.size(); ++i )
+    {
+        std::ofstream mean((files[i]+".mean").c_str());
+        avg[i].write(mean, false);
+        std::ofstream dev((files[i]+".std").c_str());
+        avg[i].write(dev, true);
+    }
+    std::cout << "ensemble of " << nbr << " replicas: " << failed << " failed" << std::endl;
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//=================================  MAIN  =====================================
+//------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    // register callback to catch interrupting signals:
+    if ( signal(SIGINT, handle_interrupt) )
+        std::cerr << "Could not register SIGINT handler\n";
+    if ( signal(SIGTERM, handle_interrupt) )
+        std::cerr << "Could not register SIGTERM handler\n";
+    if ( signal(SIGSEGV, handle_signal) )
+        std::cerr << "Could not register SIGSEGV handler\n";
+    if ( signal(SIGILL,  handle_signal) )
+        std::cerr << "Could not register SIGILL handler\n";
+    if ( signal(SIGABRT, handle_signal) )
+        std::cerr << "Could not register SIGABRT handler\n";
+
+    Glossary arg;
+
+    //parse the command line:
+    if ( arg.read_strings(argc-1, argv+1) )
+        return EXIT_FAILURE;
+
+    if ( arg.use_key("help") || arg.use_key("--help") )
+    {
+        splash(std::cout);
+        help(std::cout);
+        return EXIT_SUCCESS;
+    }
+
+    if ( arg.use_key("info") || arg.use_key("--version")  )
+    {
+        splash(std::cout);
+        print_version(std::cout);
+        return EXIT_SUCCESS;
+    }
+    
+    unsigned cnt = 0;
+    if ( arg.set(cnt, "ensemble") && cnt > 0 )
+        return ensemble(arg, cnt);
+
+    return simulate(arg, std::string(), 0);
+}
@@ -8,8 +8,19 @@
 #include "simul_prop.h"
 #include "backtrace.h"
 #include "modulo.h"
-
-extern Modulo const* modulo;
+#include "event_log.h"
+#include "frame_writer.h"
+#include "status_writer.h"
+#include "anomaly_monitor.h"
+#include "shared_frame.h"
+#include "delta_filter.h"
+#include "tictoc.h"
+
+extern thread_local Modulo const* modulo;
+
+#if MECA_USES_OPENMP
+#  include <omp.h>
+#endif
 
 #include "simul_step.cc"
 #include "simul_file.cc"
@@ -71,12 +82,27 @@ singles(*this), couples(*this), organizers(*this), events(*this)
 {
     pMeca1D       = nullptr;
     sReady        = false;
-    precondCPU[0] = 0;
-    precondCPU[1] = 0;
-    precondCPU[2] = 0;
-    precondCPU[3] = 0;
+    for ( int i = 0; i < 6; ++i )
+        precondCPU[i] = 0;
     precondMethod = 1;
     precondCounter = 0;
+    solverLog     = nullptr;
+    solverCounter = 0;
+    eventLog      = nullptr;
+    frameWriter   = nullptr;
+    statusWriter  = nullptr;
+    statusSteps   = 0;
+    anomalyMonitor = nullptr;
+    anomalyClock  = 0;
+    sharedFrame   = nullptr;
+    publishClock  = 0;
+    endTime       = 0;
+    deltaFilter   = nullptr;
+    deltaLoaded   = 0;
+    adaptNbFibers = 0;
+    properties_mtime = 0;
+    properties_size = 0;
+    properties_hash = 0;
     
     prop = new SimulProp("undefined");
 }
@@ -86,6 +112,14 @@ Simul::~Simul()
     erase();
     delete(pMeca1D);
     delete(prop);
+    if ( solverLog )
+        fclose(solverLog);
+    delete(eventLog);
+    delete(frameWriter);
+    delete(statusWriter);
+    delete(anomalyMonitor);
+    delete(sharedFrame);
+    delete(deltaFilter);
 }
 
 //------------------------------------------------------------------------------
@@ -324,6 +358,48 @@ ObjectSet * Simul::findSet(const std::string& cat)
 }
 
 
+/**
+ Each ObjectSet is represented by one bit in the mask given to loadObjects()
+ */
+unsigned Simul::setBit(ObjectSet const* set) const
+{
+    if ( set == &spaces )     return 1 << 0;
+    if ( set == &fields )     return 1 << 1;
+    if ( set == &fibers )     return 1 << 2;
+    if ( set == &beads )      return 1 << 3;
+    if ( set == &solids )     return 1 << 4;
+    if ( set == &spheres )    return 1 << 5;
+    if ( set == &singles )    return 1 << 6;
+    if ( set == &couples )    return 1 << 7;
+    if ( set == &organizers ) return 1 << 8;
+    if ( set == &events )     return 1 << 9;
+    return 0;
+}
+
+
+/**
+ The names of the classes are separated by ','.
+ Spaces and Fields are always included, and since Singles, Couples and Organizers
+ refer to other objects, all the Mecables are then also included.
+ */
+unsigned Simul::setMask(std::string const& str)
+{
+    unsigned res = setBit(&spaces) | setBit(&fields);
+    std::istringstream iss(str);
+    std::string name;
+    while ( std::getline(iss, name, ',') )
+    {
+        ObjectSet * set = findSet(name);
+        if ( !set )
+            throw InvalidParameter("unknown class `"+name+"'");
+        res |= setBit(set);
+        if ( set == &singles || set == &couples || set == &organizers )
+            res |= setBit(&fibers) | setBit(&beads) | setBit(&solids) | setBit(&spheres);
+    }
+    return res;
+}
+
+
 /**
  This is used primarily to read the binary trajectory file,
  using a single character to refer to each class in Cytosim
@@ -7,6 +7,7 @@
 #include <string>
 #include <stack>
 #include <map>
+#include <functional>
 
 #include "single_set.h"
 #include "couple_set.h"
@@ -23,13 +24,24 @@
 #include "property_list.h"
 #include "field_values.h"
 #include "meca.h"
+#include "grid_tuner.h"
+#include "profiler.h"
 
 class Meca1D;
 class SimulProp;
+class EventLog;
+class FrameWriter;
+class StatusWriter;
+class AnomalyMonitor;
+class SharedFrame;
+class DeltaFilter;
 
 /// default name for output trajectory file
 const char TRAJECTORY[] = "objects.cmo";
 
+/// default name of the checkpoint file
+const char CHECKPOINT[] = "checkpoint.cmo";
+
 /// Simulator class containing all Objects
 class Simul
 {
@@ -57,10 +69,79 @@ private:
     unsigned int precondCounter;
 
     /// stores cpu time to automatically set the preconditionning option
-    double precondCPU[4];
+    double precondCPU[6];
+
+    /// file in which solver statistics are recorded (see SimulProp::solver_log)
+    FILE * solverLog;
+    
+    /// number of calls to solve(), used to sample the solver statistics
+    size_t solverCounter;
+    
+    /// binary record of fiber events (see SimulProp::event_log)
+    EventLog * eventLog;
+    
+    /// phases of the time step measured by `profiler` (see SimulProp::profile)
+    enum { PRO_SHUFFLE, PRO_EVENTS, PRO_ORGANIZERS, PRO_SPACES, PRO_SPHERES,
+        PRO_BEADS, PRO_SOLIDS, PRO_FIBERS, PRO_GRID, PRO_COUPLES, PRO_FIELDS,
+        PRO_SINGLES, PRO_ATTACH, PRO_PREPARE, PRO_INTERACTIONS, PRO_STERIC,
+        PRO_PRECOND, PRO_ITERATE, PRO_APPLY, PRO_OUTPUT, PRO_COUNT };
+    
+    /// measures the time spent in the phases of the time step
+    mutable Profiler profiler;
+    
+    /// background writer of the trajectory (see SimulProp::write_async)
+    mutable FrameWriter * frameWriter;
+    
+    /// periodic writer of the progress of the simulation (see SimulProp::status)
+    StatusWriter * statusWriter;
+    
+    /// number of steps performed, reported by `statusWriter` and `simul:allocations`
+    size_t statusSteps;
+    
+    /// detection of the steps that are much slower than usual (see SimulProp::anomaly)
+    AnomalyMonitor * anomalyMonitor;
+    
+    /// wall-time at the last call to checkAnomaly(), in milliseconds
+    double anomalyClock;
+    
+    /// shared memory segment receiving the state (see SimulProp::publish)
+    SharedFrame * sharedFrame;
+    
+    /// wall-time at which the state should be published next, in milliseconds
+    double publishClock;
+    
+    /// filter used to write delta frames (see SimulProp::delta_frames)
+    mutable DeltaFilter * deltaFilter;
+    
+    /// distance of the last frame read to its complete frame, or 0
+    unsigned deltaLoaded;
+    
+    /// number of fibers at the last call to adaptTimeStep()
+    size_t adaptNbFibers;
+    
+    /// automatic selection of the cell size of the FiberGrid (see SimulProp::grid_tune)
+    GridTuner bindingTuner { 1, 0.5, M_SQRT1_2, M_SQRT2, 2 };
+    
+    /// automatic selection of the cell size of the PointGrid (see SimulProp::grid_tune)
+    mutable GridTuner stericTuner { 1, M_SQRT2, 2 };
 
     /// a copy of the properties as they were stored to file
     mutable std::string properties_saved;
+    
+    /// modification time of the property file read by loadProperties()
+    time_t properties_mtime;
+    
+    /// size of the property file read by loadProperties()
+    off_t properties_size;
+    
+    /// hash of the content of the property file read by loadProperties()
+    size_t properties_hash;
+    
+    /// name of the RunStore receiving the output, if not empty
+    std::string runStore;
+    
+    /// identity of the run in the RunStore
+    mutable std::string runName;
 
 public:
     /// Global cytosim parameters
@@ -99,6 +180,9 @@ public:
     /// list of Events in the Simulation
     EventSet events;
 
+    /// simulated time at which the current `run` ends, to estimate the remaining time
+    real endTime;
+
     //--------------------------------------------------------------------------
 
     /// constructor
@@ -146,6 +230,12 @@ public:
 
     /// perform one Monte-Carlo step, corresponding to `time_step`
     void step();
+    
+    /// give the current progress to `statusWriter`
+    void writeStatus();
+    
+    /// copy the properties and the objects to `sharedFrame`
+    void publishFrame();
 
     /// time in the simulated world (shortcut to `prop->time`)
     real time() const;
@@ -153,6 +243,9 @@ public:
     /// shortcut to prop->time_step;
     real time_step() const;
 
+    /// number of steps performed, which is recorded in checkpoints
+    size_t nbSteps() const { return statusSteps; }
+
     /// this is called after a sequence of `step()` have been done
     void relax();
 
@@ -171,6 +264,12 @@ public:
     /// bring all objects to centered image using periodic boundary conditions
     void foldPositions() const;
 
+    /// change `time_step` and update all derived parameters
+    void changeTimeStep(real);
+    
+    /// return a new time step within [dt_min, dt_max], given the conditions of the last step
+    real adaptTimeStep(real dt, real dt_min, real dt_max, unsigned iterations);
+
     /// simulate the mechanics of the system and move Mecables accordingly, corresponding to `time_step`
     void solve();
 
@@ -182,6 +281,9 @@ public:
 
     /// calculate the motion of objects, but only in the X-direction
     void solveX();
+    
+    /// call `func` to simulate the mechanics over `cnt` consecutive time steps
+    void solveSpan(void (Simul::* func)(), unsigned cnt);
 
     /// calculate Forces and Lagrange multipliers on the Mecables, but do not move them
     void computeForces() const;
@@ -191,13 +293,34 @@ public:
 
     /// dump system matrix and vector in sparse text format
     void saveSystem(const char dirname[]) const;
+    
+    /// record an event affecting a fiber, if `simul:event_log` is enabled
+    void recordEvent(unsigned kind, ObjectID fiber, real abscissa, real tension, ObjectID fragment = 0);
 
 private:
+    /// like 'solve' but recording timings and statistics in `solver.txt`, returning the time spent in Meca::solve()
+    double solve_logged(int precond);
+    
+    /// recalculate nonlinear interactions around the solution and solve again, `simul:newton` times
+    void solve_newton(int precond);
+    
+    /// call Meca::solve(), saving the system with saveAnomaly() if it fails
+    void solve_meca(int precond);
+    
+    /// record the iterations and time of the last step, and call saveAnomaly() if they were excessive
+    void checkAnomaly();
+    
+    /// save the system of Meca and a description of the last step, in a subdirectory of `simul:anomaly_dir`
+    void saveAnomaly(std::string const& reason) const;
+    
     /// give an estimate of the cell size of the FiberGrid
     real estimateFiberGridStep() const;
 
     /// set FiberGrid and StericGrid over the given space
     void setFiberGrid(Space const *) const;
+    
+    /// record CPU time for the automatic selection of the cell size of the FiberGrid
+    void tuneFiberGrid(double cpu);
 
     /// give an estimate for the cell size of the PointGrid used for steric interactions
     real estimateStericRange() const;
@@ -278,34 +401,94 @@ public:
     /// export all Properties to a new file with specified name
     void writeProperties(char const *filename, bool prune) const;
 
-    /// load the properties contained in the standard output property file
+    /// load the properties contained in the standard output property file, if it was modified
     void loadProperties();
 
     //---------------------------- LOAD OBJECTS --------------------------------
 
     /// current file format
-    const static int currentFormatID = 52;
+    const static int currentFormatID = 53;
 
     /// class for reading trajectory file
     class InputLock;
 
+    /// mask selecting all the ObjectSets in loadObjects()
+    static constexpr unsigned ALL_SETS = ~0U;
+
+    /// bit representing `set` in the mask of loadObjects()
+    unsigned setBit(ObjectSet const* set) const;
+
+    /// mask selecting the classes listed in `str` (eg. 'fiber,couple'), and the classes they depend on
+    unsigned setMask(std::string const& str);
+
     /// read objects from file, and add them to the simulation state
-    int readObjects(Inputter &, ObjectSet *subset);
+    int readObjects(Inputter &, unsigned mask);
+    
+    /// read the sections of Singles and Couples in parallel, returning true if this was done
+    bool readParallel(Inputter &, unsigned mask);
+    
+    /// clear the flags of the objects before reading a delta frame
+    void thawObjects(unsigned mask);
+
+    /// read the compressed content of a frame (see writeCompressed)
+    void readCompressed(Inputter &, size_t len, size_t cnt, unsigned mask);
 
     /// load objects from a file, adding them to the simulation state
-    int loadObjects(Inputter &, ObjectSet *subset = nullptr);
+    int loadObjects(Inputter &, unsigned mask = ALL_SETS);
 
     /// load sim-world from the named file
     int loadObjects(char const *filename);
 
     /// import objects from file, and delete objects that were not referenced in the file
-    int reloadObjects(Inputter &, ObjectSet *subset = nullptr);
+    int reloadObjects(Inputter &, unsigned mask = ALL_SETS);
+    
+    /// 0 if the last frame read was complete, or its distance to the complete frame it depends on
+    unsigned frameDelta() const { return deltaLoaded; }
+
+    /// write the objects of the current frame
+    void writeContent(Outputter &) const;
+    
+    /// write the objects of the current frame as one compressed chunk
+    void writeCompressed(Outputter &) const;
+
+    /// write the line that starts a frame
+    void writeFrameHead(Outputter &) const;
+
+    /// write the line that ends a frame
+    void writeFrameTail(Outputter &) const;
+
+    /// write a frame with its content not compressed, which is within [head, end[
+    void writeSnapshot(Outputter &, size_t &head, size_t &end) const;
+    
+    /// write the identities of the objects deleted since the previous frame
+    void writeDeleted(Outputter &, DeltaFilter const&) const;
 
     /// write sim-world to specified file
     void writeObjects(Outputter &) const;
 
     /// write sim-world in binary or text mode, appending to existing file or creating new file
     void writeObjects(std::string const &filename, bool append, bool binary) const;
+    
+    /// send the trajectory, the properties and the messages to the RunStore `store`, as run `name`
+    void storeRun(std::string const &store, std::string const &name);
+    
+    /// identity of the run in the RunStore, or empty string if a RunStore is not used
+    std::string const &runIdentity() const;
+    
+    /// append a chunk to the RunStore
+    void writeStored(const char kind[], const char *data, size_t size) const;
+    
+    /// fork the process, such that the child continues in directory `name`, or as run `name` of the RunStore
+    pid_t branch(std::string const &name);
+
+    /// write the properties and the current state in directory `name`
+    void writeState(std::string const &name) const;
+
+    /// write the complete state of the simulation to file, with `info` on the first line
+    void writeCheckpoint(std::string const &filename, std::string const &info) const;
+    
+    /// restore the state saved by writeCheckpoint(), returning `info`
+    std::string readCheckpoint(std::string const &filename);
 
     //----------------------------- REPORTING ----------------------------------
 
@@ -315,12 +498,36 @@ public:
     /// call one of the report function
     void report0(std::ostream &, std::string const &, Glossary &) const;
 
+    /// a function making one report
+    typedef std::function<void(std::ostream &)> ReportFunc;
+
+    /// a report parsed once by compileReport(), to be made repeatedly
+    struct CompiledReport
+    {
+        std::string name;               ///< the reports, as given to compileReport()
+        int precision;                  ///< number of digits of the values
+        int width;                      ///< width of the columns
+        std::vector<ReportFunc> parts;  ///< one function for each report
+    };
+
+    /// return the function that report0() would call for `arg`
+    ReportFunc compileReport0(std::string const &, Glossary &) const;
+
+    /// parse the arguments of report() once, to make the same report repeatedly
+    CompiledReport compileReport(std::string, Glossary &) const;
+
+    /// make a report obtained from compileReport(), with the same output as report()
+    void report(std::ostream &, CompiledReport const &) const;
+
     /// print time
     void reportTime(std::ostream &) const;
 
     /// give a short inventory of the simulation state, obtained from ObjectSet::report()
     void reportInventory(std::ostream &) const;
 
+    /// report memory used by the different parts of the simulation
+    void reportMemory(std::ostream &) const;
+
     /// give a summary of the System
     void reportSystem(std::ostream &) const;
 
@@ -382,6 +589,9 @@ public:
     /// print Fiber tensions along certain planes defined in `opt`
     void reportFiberTension(std::ostream &, Glossary &) const;
 
+    /// print histogram of the tension of fiber segments
+    void reportFiberTensionHistogram(std::ostream &, Glossary &) const;
+
     /// print sum of all bending energy
     void reportFiberBendingEnergy(std::ostream &) const;
 
@@ -430,6 +640,9 @@ public:
     /// print state of Couples
     void reportCoupleAnatomy(std::ostream &) const;
 
+    /// print number of attachment/detachment events for each class of Hand
+    void reportHandEvents(std::ostream &, Glossary &) const;
+
     /// print position of Couples
     void reportCoupleState(std::ostream &) const;
 
@@ -469,6 +682,15 @@ public:
     /// print force on Spaces
     void reportSpaceForce(std::ostream &) const;
 
+    /// print the time spent in the phases of the time step
+    void reportSimulProfile(std::ostream &) const;
+
+    /// print the allocations made in the phases of the time step
+    void reportSimulAllocations(std::ostream &) const;
+
+    /// print the load of the slabs obtained by partitioning the Space
+    void reportSpacePartition(std::ostream &, Glossary &) const;
+
     /// print something about Fields
     void reportField(std::ostream &) const;
 
@@ -2,8 +2,18 @@
 #include "dim.h"
 #include "sim.h"
 #include <fstream>
+#include <sstream>
+#include <algorithm>
 #include <unistd.h>
+#include <sys/stat.h>
+#include <cerrno>
 #include "filepath.h"
+#include "frame_index.h"
+#include "frame_writer.h"
+#include "run_store.h"
+#include "hand.h"
+#include "delta_filter.h"
+#include "zipper.h"
 #include "messages.h"
 #include "parser.h"
 #include "print_color.h"
@@ -14,6 +24,7 @@
  This is the initial value to Inputter::formatID()
  History of changes in file format:
 
+ 53: 14/10/2026 Identities and property indices are variable-length integers in binary
  52: 18/10/2019 Space's shape is stored always on 16 characters
  51: 03/03/2019 Storing number of Aster links
  50: 19/12/2018 Fiber's birth time moved to Filament (now Chain)
@@ -55,16 +66,10 @@
 #pragma mark - Write Objects
 
 /**
- This writes all objects of the current state to a trajectory file
-*/
-void Simul::writeObjects(Outputter& out) const
+ This writes the objects, between the header and the end of a frame
+ */
+void Simul::writeContent(Outputter& out) const
 {
-    // write a line identifying a new frame:
-    fprintf(out, "\n\n#Cytosim  %i  %s", getpid(), TicToc::date());
-    
-    // record file format:
-    fprintf(out, "\n#format %i dim %i", currentFormatID, DIM);
-    
     // identify the file as binary, with its endianess:
     if ( out.binary() )
     {
@@ -77,7 +82,10 @@ void Simul::writeObjects(Outputter& out) const
      For example, Aster is written after Fiber, Couple after Fiber...
      This makes it easier to reconstruct the state during input.
      */
-    fprintf(out, "\n#time %.6f sec", prop->time);
+    if ( out.precise() )
+        fprintf(out, "\n#precise\n#time %.17g sec", prop->time);
+    else
+        fprintf(out, "\n#time %.6f sec", prop->time);
 
     spaces.write(out);
     fields.write(out);
@@ -90,20 +98,233 @@ void Simul::writeObjects(Outputter& out) const
     organizers.write(out);
     //events.write(out);
     
+    if ( out.filter() && !out.filter()->keyFrame() )
+        writeDeleted(out, *out.filter());
+
     out.put_line("\n#section end");
+}
+
+
+/**
+ In a delta frame, the objects that were deleted since the previous frame are
+ listed on lines `#delete TAG ID ID ...`, in the order in which they should be
+ erased: Organizers, Couples and Singles before the objects they are attached to.
+ */
+void Simul::writeDeleted(Outputter& out, DeltaFilter const& filter) const
+{
+    std::vector<uint64_t> keys;
+    filter.deleted(keys);
+    if ( keys.empty() )
+        return;
+    std::sort(keys.begin(), keys.end());
+    
+    ObjectSet const* order[] = { &organizers, &couples, &singles, &beads, &solids,
+                                 &spheres, &fibers, &spaces, &fields };
+    for ( ObjectSet const* set : order )
+    {
+        ObjectTag tag = 0;
+        for ( uint64_t k : keys )
+        {
+            ObjectTag t = (ObjectTag)( k >> 32 );
+            if ( const_cast<Simul*>(this)->findSetT(t) != set )
+                continue;
+            if ( t != tag )
+            {
+                fprintf(out, "\n#delete %c", (char)t);
+                tag = t;
+            }
+            fprintf(out, " %u", (ObjectID)( k & 0xFFFFFFFF ));
+        }
+    }
+}
+
+
+/**
+ The content of the frame is serialized in memory and compressed as one chunk,
+ which is written after a line `#deflate SIZE CHUNK`, where SIZE is the size
+ of the content before compression, and CHUNK the number of compressed bytes.
+ The header, the time and the end of the frame are not compressed, such that
+ the frames can be located without decompression. readObjects() inflates the chunk.
+ */
+void Simul::writeCompressed(Outputter& out) const
+{
+    char * buf = nullptr;
+    size_t len = 0;
+    FILE * mem = open_memstream(&buf, &len);
+    if ( !mem )
+        throw InvalidIO("could not allocate memory to compress frame");
+    try
+    {
+        Outputter tmp(mem, out.binary());
+        tmp.quantum(prop->frame_quantum);
+        tmp.filter(out.filter());
+        tmp.precise(out.precise());
+        writeContent(tmp);
+        tmp.close();
+    }
+    catch( Exception & e )
+    {
+        free(buf);
+        throw;
+    }
+    std::string zip;
+    int err = Zipper::deflate(zip, buf, len, prop->frame_compression);
+    if ( !err )
+    {
+        fprintf(out, "\n#time %.6f sec", prop->time);
+        fprintf(out, "\n#deflate %lu %lu\n", len, zip.size());
+        if ( zip.size() != fwrite(zip.data(), 1, zip.size(), out) )
+            err = 1;
+    }
+    free(buf);
+    if ( err )
+        throw InvalidIO("failed to write compressed frame");
+}
+
+
+/**
+ This writes all objects of the current state to a trajectory file
+*/
+void Simul::writeObjects(Outputter& out) const
+{
+    writeFrameHead(out);
+    
+    if ( prop->frame_compression > 0 )
+        writeCompressed(out);
+    else
+    {
+        out.quantum(prop->frame_quantum);
+        writeContent(out);
+    }
+    
+    writeFrameTail(out);
+}
+
+
+void Simul::writeFrameHead(Outputter& out) const
+{
+    // write a line identifying a new frame:
+    fprintf(out, "\n\n#Cytosim  %i  %s", getpid(), TicToc::date());
+    
+    // record file format:
+    fprintf(out, "\n#format %i dim %i", currentFormatID, DIM);
+    
+    // a delta frame only contains the objects that have changed:
+    if ( out.filter() && !out.filter()->keyFrame() )
+        fprintf(out, "\n#delta %u", out.filter()->count());
+}
+
+
+void Simul::writeFrameTail(Outputter& out) const
+{
     out.put_line("\n#end cytosim");
     fprintf(out, " %s\n\n", TicToc::date());
 }
 
 
+/**
+ The content of the frame is serialized in memory, but not compressed: this is
+ a snapshot of the state, which the writer thread compresses and saves while
+ the simulation proceeds. The frame in the file is as made by writeObjects().
+ */
+void Simul::writeSnapshot(Outputter& out, size_t& head, size_t& end) const
+{
+    writeFrameHead(out);
+    head = ftello(out);
+    out.quantum(prop->frame_quantum);
+    writeContent(out);
+    end = ftello(out);
+    writeFrameTail(out);
+}
+
+
 /**
  This writes the current state to a trajectory file called `name`.
  If this file does not exist, it is created de novo.
  If `append == true` the state is added to the file, otherwise it is cleared.
  If `binary == true` a binary format is used, otherwise a text-format is used.
+ The position of the frame is recorded in the index file `name.idx` (see FrameIndex)
+ If `prop->write_async`, the frame is written by a background thread (see FrameWriter),
+ which also compresses it if `prop->frame_compression > 0` (see writeSnapshot)
+ If `prop->delta_frames > 1`, the frames are filtered to only include the objects
+ that have changed, except for one frame every `delta_frames` (see DeltaFilter).
 */
 void Simul::writeObjects(std::string const& name, bool append, bool binary) const
 {
+    Profiler::Scope scope(profiler, PRO_OUTPUT);
+    // the frames of the trajectory are sent to the RunStore, if specified:
+    if ( runStore.size() && name == prop->trajectory_file )
+    {
+        char * buf = nullptr;
+        size_t len = 0;
+        FILE * mem = open_memstream(&buf, &len);
+        if ( !mem )
+            throw InvalidIO("could not allocate memory to write frame");
+        try
+        {
+            Outputter out(mem, binary);
+            writeObjects(out);
+            out.close();
+            writeStored("frame", buf, len);
+        }
+        catch( InvalidIO & e )
+        {
+            std::cerr << "Error writing trajectory file: " << e.what() << '\n';
+        }
+        free(buf);
+        return;
+    }
+
+    DeltaFilter * filter = nullptr;
+    if ( prop->delta_frames > 1 )
+    {
+        if ( !deltaFilter )
+            deltaFilter = new DeltaFilter;
+        if ( 0 <= deltaFilter->start(name, append, binary, prop->delta_frames) )
+            filter = deltaFilter;
+    }
+
+    if ( prop->write_async )
+    {
+        char * buf = nullptr;
+        size_t len = 0, head = 0, end = 0;
+        FILE * mem = open_memstream(&buf, &len);
+        if ( mem )
+        {
+            try
+            {
+                Outputter out(mem, binary);
+                out.filter(filter);
+                if ( prop->frame_compression > 0 )
+                    writeSnapshot(out, head, end);
+                else
+                    writeObjects(out);
+                out.close();
+            }
+            catch( InvalidIO & e )
+            {
+                std::cerr << "Error writing trajectory file: " << e.what() << '\n';
+                if ( filter )
+                    filter->cancel();
+                free(buf);
+                return;
+            }
+            if ( filter )
+                filter->finish();
+            if ( !frameWriter )
+                frameWriter = new FrameWriter;
+            if ( end > head )
+                frameWriter->submit(name, append, buf, len, prop->time, nbObjects(), head, len-end, prop->frame_compression);
+            else
+                frameWriter->submit(name, append, buf, len, prop->time, nbObjects());
+            return;
+        }
+    }
+    
+    // preserve the order of the frames:
+    if ( frameWriter )
+        frameWriter->flush();
+    
     Outputter out(name.c_str(), append, binary);
     
     if ( ! out.good() )
@@ -112,13 +333,307 @@ void Simul::writeObjects(std::string const& name, bool append, bool binary) cons
     try
     {
         out.lock();
+        out.filter(filter);
+        fseeko(out, 0, SEEK_END);
+        off_t pos = ftello(out);
         writeObjects(out);
         out.unlock();
+        if ( filter )
+            filter->finish();
+        if ( pos >= 0 && 0 == fflush(out) )
+            FrameIndex::append(name, pos, prop->time, nbObjects());
     }
     catch( InvalidIO & e )
     {
         std::cerr << "Error writing trajectory file: " << e.what() << '\n';
+        if ( filter )
+            filter->cancel();
+    }
+}
+
+
+/**
+ After this is called, the frames of the trajectory, the properties, and the
+ messages written by `sim` are appended to the RunStore `store`, instead of
+ creating the files `objects.cmo`, `properties.cmo` and `messages.cmo`.
+ If `name` is empty, the run is identified by the seed of the random generator.
+ Delta frames are not supported: all the frames are complete.
+ */
+void Simul::storeRun(std::string const& store, std::string const& name)
+{
+    if ( name.find_first_of(" \t\n") != std::string::npos )
+        throw InvalidParameter("the identity of the run should not contain spaces");
+    runStore = store;
+    runName = name;
+}
+
+
+std::string const& Simul::runIdentity() const
+{
+    if ( runStore.size() && runName.empty() )
+        runName = std::to_string(prop->random_seed);
+    return runName;
+}
+
+
+void Simul::writeStored(const char kind[], const char* data, size_t size) const
+{
+    if ( RunStore::append(runStore, runIdentity(), kind, data, size) )
+        throw InvalidIO("could not write to `"+runStore+"'");
+}
+
+
+/**
+ Fork the process, returning the value returned by fork().
+ The frames waiting to be written are written first, since the thread of the
+ FrameWriter does not exist in the child. The child then sends its output to
+ the RunStore as run `ID.name`, or to the directory `name`, which is created if
+ necessary. Its trajectory starts with the state reached at the branch point.
+ */
+pid_t Simul::branch(std::string const& name)
+{
+    if ( frameWriter )
+        frameWriter->flush();
+    Cytosim::out.flush();
+    std::cout.flush();
+    fflush(nullptr);
+    
+    pid_t pid = fork();
+    if ( pid == 0 )
+    {
+        // the copy of the FrameWriter cannot be used, and is left aside:
+        frameWriter = nullptr;
+        delete(deltaFilter);
+        deltaFilter = nullptr;
+        if ( runStore.size() )
+            runName = runIdentity() + "." + name;
+        else if ( FilePath::change_dir(name, true) < 0 )
+            throw InvalidIO("could not enter directory `"+name+"'");
+        prop->clear_trajectory = true;
     }
+    return pid;
+}
+
+
+/**
+ Write the properties and the objects to `properties.cmo` and `objects.cmo` in
+ directory `name`, which is created if necessary. This writes directly, without
+ the RunStore, the FrameWriter or the DeltaFilter, which are not affected.
+ */
+void Simul::writeState(std::string const& name) const
+{
+    if ( FilePath::make_dir(name.c_str()) && errno != EEXIST )
+        throw InvalidIO("could not create directory `"+name+"'");
+    std::ofstream os(name+"/"+prop->property_file);
+    writeProperties(os, true);
+    os.close();
+    Outputter out((name+"/"+prop->trajectory_file).c_str(), false, true);
+    if ( !out.good() )
+        throw InvalidIO("could not write in directory `"+name+"'");
+    writeObjects(out);
+    out.close();
+}
+
+
+/**
+ A checkpoint contains the objects with double precision values, together with
+ the Gillespie counters of the Hands, the state of the random number generator,
+ the solutions kept by Meca for `simul:initial_guess`, and the step counters. This is written in the
+ native binary format, and a checkpoint should be read on the same architecture.
+ 
+ The first line contains `info` and the size of the trajectory file.
+ The file is written under a temporary name, and renamed when it is complete,
+ such that a previous checkpoint is not lost if writing is interrupted.
+ */
+void Simul::writeCheckpoint(std::string const& name, std::string const& info) const
+{
+    // the trajectory should be complete before its size is recorded:
+    if ( frameWriter )
+        frameWriter->flush();
+    off_t traj = 0;
+    FILE * f = fopen(TRAJECTORY, "r");
+    if ( f )
+    {
+        if ( 0 == fseeko(f, 0, SEEK_END) )
+            traj = ftello(f);
+        fclose(f);
+    }
+
+    std::string tmp = name + ".tmp";
+    Outputter out(tmp.c_str(), false, true);
+    if ( ! out.good() )
+        throw InvalidIO("could not open file `"+tmp+"' for writing");
+    out.precise(true);
+    
+    fprintf(out, "#checkpoint %s trajectory %lli", info.c_str(), (long long)traj);
+    fprintf(out, "\n\n#Cytosim  %i  %s", getpid(), TicToc::date());
+    fprintf(out, "\n#format %i dim %i", currentFormatID, DIM);
+    writeContent(out);
+    out.put_line("\n#end cytosim\n");
+
+    // random number generator:
+    std::vector<char> rng(Random::state_size());
+    RNG.save_state(rng.data());
+    fprintf(out, "#random %zu\n", rng.size());
+    fwrite(rng.data(), 1, rng.size(), out);
+
+    // solutions kept for the initial guess, and indices of the Mecables:
+    sMeca.writeGuess(out);
+    ObjectSet const* sets[] = { &fibers, &solids, &beads, &spheres };
+    size_t cnt = 0;
+    for ( ObjectSet const* set : sets )
+        cnt += set->size();
+    fprintf(out, "#mecables %zu\n", cnt);
+    for ( ObjectSet const* set : sets )
+    {
+        for ( Object const* obj = set->first(); obj; obj = obj->next() )
+        {
+            uint32_t rec[6] = { (uint32_t)obj->tag(), obj->identity() };
+            static_cast<Mecable const*>(obj)->getOldMatIndex(rec+2);
+            fwrite(rec, sizeof(uint32_t), 6, out);
+        }
+    }
+    
+    // number of steps, and the counters that schedule the mixing of the lists:
+    ObjectSet const* all[] = { &organizers, &fibers, &singles, &couples, &spheres,
+                               &beads, &solids, &fields, &spaces };
+    fprintf(out, "#counters %zu", statusSteps);
+    for ( ObjectSet const* set : all )
+    {
+        unsigned cnt[2];
+        set->getCounters(cnt);
+        fprintf(out, " %u %u", cnt[0], cnt[1]);
+    }
+    out.put_line("\n#end checkpoint\n");
+    
+    if ( ferror(out) )
+    {
+        out.close();
+        ::remove(tmp.c_str());
+        throw InvalidIO("failed to write checkpoint `"+name+"'");
+    }
+    out.close();
+    if ( ::rename(tmp.c_str(), name.c_str()) )
+        throw InvalidIO("could not rename checkpoint `"+tmp+"'");
+}
+
+
+/**
+ All objects are deleted, except the Events, and replaced by those of the checkpoint.
+ The properties are not stored in the checkpoint, and should have been
+ defined before, for instance by executing the same configuration file.
+ */
+std::string Simul::readCheckpoint(std::string const& name)
+{
+    Inputter in(DIM, name.c_str(), true);
+    if ( ! in.good() )
+        throw InvalidIO("could not open checkpoint `"+name+"'");
+
+    std::string info = in.get_line();
+    if ( info.compare(0, 12, "#checkpoint ") )
+        throw InvalidIO("`"+name+"' is not a checkpoint");
+    info = info.substr(12);
+
+    // the objects are recreated, such that the lists follow the order of the file:
+    relax();
+    organizers.erase();
+    fibers.erase();
+    singles.erase();
+    couples.erase();
+    spheres.erase();
+    beads.erase();
+    solids.erase();
+    fields.erase();
+    spaces.erase();
+
+    if ( loadObjects(in) || !in.precise() )
+        throw InvalidIO("incomplete checkpoint `"+name+"'");
+    
+    // restore the order of the lists, which was inverted by reading:
+    ObjectSet * all[] = { &organizers, &fibers, &singles, &couples, &spheres,
+                          &beads, &solids, &fields, &spaces };
+    for ( ObjectSet * set : all )
+        set->reverse();
+    if ( in.binary() != 1 )
+        throw InvalidIO("checkpoint `"+name+"' was written on a different architecture");
+
+    std::string line;
+    do
+        line = in.get_line();
+    while ( line.empty() && in.good() );
+    size_t len = 0;
+    if ( 1 != sscanf(line.c_str(), "#random %zu", &len) || len != Random::state_size() )
+        throw InvalidIO("invalid random generator state in checkpoint");
+    std::vector<char> rng(len);
+    if ( len != in.read(rng.data(), len) )
+        throw InvalidIO("invalid random generator state in checkpoint");
+
+    sMeca.readGuess(in);
+    line = in.get_line();
+    size_t cnt = 0;
+    if ( 1 != sscanf(line.c_str(), "#mecables %zu", &cnt) )
+        throw InvalidIO("invalid Mecable indices in checkpoint");
+    for ( size_t i = 0; i < cnt; ++i )
+    {
+        uint32_t rec[6];
+        if ( sizeof(rec) != in.read(rec, sizeof(rec)) )
+            throw InvalidIO("invalid Mecable indices in checkpoint");
+        ObjectSet * set = findSetT((ObjectTag)rec[0]);
+        Object * obj = set ? set->findID(rec[1]) : nullptr;
+        if ( obj )
+            static_cast<Mecable*>(obj)->setOldMatIndex(rec+2);
+    }
+    
+    line = in.get_line();
+    std::istringstream iss(line);
+    std::string tok;
+    if ( !(iss >> tok >> statusSteps) || tok != "#counters" )
+        throw InvalidIO("invalid counters in checkpoint");
+    for ( ObjectSet * set : all )
+    {
+        unsigned cnt[2];
+        if ( !(iss >> cnt[0] >> cnt[1]) )
+            throw InvalidIO("invalid counters in checkpoint");
+        set->setCounters(cnt);
+    }
+    
+    // the random generator is restored last, as reading may have used it:
+    RNG.load_state(rng.data());
+    return info;
+}
+
+/**
+ The system is saved by Meca::saveSystem(), in a directory named after the step,
+ which can be read by `test_sparse`. The file `anomaly.txt` gives the reason,
+ the statistics of the solver in the format of `solver.txt`, and the profile
+ of the phases of the step.
+ */
+void Simul::saveAnomaly(std::string const& reason) const
+{
+    FilePath::make_dir(prop->anomaly_dir.c_str());
+    char str[32];
+    snprintf(str, sizeof(str), "/step%08lu", statusSteps);
+    std::string dir = prop->anomaly_dir + str;
+    sMeca.saveSystem(dir.c_str());
+    
+    FILE * f = fopen((dir+"/anomaly.txt").c_str(), "w");
+    if ( !f )
+        return;
+    fprintf(f, "%% %s\n", reason.c_str());
+    fprintf(f, "%% time %.6f step %lu\n", prop->time, statusSteps);
+    if ( anomalyMonitor )
+    {
+        fprintf(f, "%% median of %lu steps: %.3f ms, %.1f iterations\n", std::min(anomalyMonitor->steps(),
+                AnomalyMonitor::WINDOW), anomalyMonitor->medianTime(), anomalyMonitor->medianIterations());
+        fprintf(f, "%% reports %lu skipped %lu\n", anomalyMonitor->reports(), anomalyMonitor->skipped());
+    }
+    fprintf(f, "%% dimension  elements_B  elements_C  precond  count  residual  noise  cpu_precond  cpu_iterate\n");
+    sMeca.writeStatistics(f, prop->precondition);
+    std::ostringstream oss;
+    profiler.reportStep(oss);
+    fprintf(f, "%s\n", oss.str().c_str());
+    fclose(f);
+    Cytosim::warn << reason << ", saved in `" << dir << "'\n";
 }
 
 //------------------------------------------------------------------------------
@@ -174,7 +689,11 @@ Object * Simul::readReference(Inputter& in, ObjectTag& tag)
 
     if ( in.binary() )
     {
-        if ( fat )
+        if ( in.formatID() > 52 )
+        {
+            id = (ObjectID)in.readVarUInt();
+        }
+        else if ( fat )
         {
             // long format
 #ifdef BACKWARD_COMPATIBILITY
@@ -206,33 +725,25 @@ Object * Simul::readReference(Inputter& in, ObjectTag& tag)
     }
     else
     {
-        FILE * file = in.file();
 #ifdef BACKWARD_COMPATIBILITY
         // skip property index
         if ( in.formatID() < 49 )
         {
-            unsigned u;
-            if ( 1 != fscanf(file, "%u", &u) )
-                throw InvalidIO("readReference (compatibility) failed");
+            in.readUInt32();
             if ( in.get_char() != ':' )
                 throw InvalidSyntax("missing ':'");
         }
 #endif
-        if ( 1 != fscanf(file, "%u", &id) )
-            throw InvalidIO("readReference failed");
+        id = in.readUInt32();
 #ifdef BACKWARD_COMPATIBILITY
         if ( in.formatID() < 49 )
         {
             // skip ObjectMark which is not used
             int h = in.get_char();
             if ( h == ':' )
-            {
-                unsigned long u;
-                if ( 1 != fscanf(file, "%lu", &u) )
-                throw InvalidIO("readReference (compatibility) failed");
-            }
+                in.readUInt64();
             else
-            in.unget(h);
+                in.unget(h);
         }
 #endif
     }
@@ -336,6 +847,21 @@ public:
 };
 
 
+/**
+ Clear the flags set by InputLock, for all the classes selected by `mask`.
+ This is used for a delta frame, in which the objects that are not listed
+ are unchanged, and should not be deleted.
+ */
+void Simul::thawObjects(unsigned mask)
+{
+    ObjectSet * all[] = { &organizers, &couples, &singles, &beads, &solids,
+                          &spheres, &fibers, &spaces, &fields };
+    for ( ObjectSet * set : all )
+        if ( mask & setBit(set) )
+            set->thaw();
+}
+
+
 /**
  This will update the current state to make it identical to what has been saved
  in the file.
@@ -351,13 +877,13 @@ public:
  - 1 = EOF
  .
  */
-int Simul::reloadObjects(Inputter& in, ObjectSet* subset)
+int Simul::reloadObjects(Inputter& in, unsigned mask)
 {
     // set flag to erase any object that was not updated
     InputLock lock(this);
 
     // if no error occurred, erase objects that have not been updated
-    if ( 0 == loadObjects(in, subset) )
+    if ( 0 == loadObjects(in, mask) )
         lock.prune();
 
     return in.eof();
@@ -368,14 +894,14 @@ int Simul::reloadObjects(Inputter& in, ObjectSet* subset)
  Read Objects from a file:
  update the ones that were already present in the simulation world,
  and otherwise create new ones. The Simulation worlds is augmented.
- If 'subset!=0' only objects from this class will be imported.
+ Only the objects of the classes selected by `mask` are imported (see setBit()).
  
  @returns
  - 0 = success
  - 1 = EOF
  .
  */
-int Simul::loadObjects(Inputter& in, ObjectSet* subset)
+int Simul::loadObjects(Inputter& in, unsigned mask)
 {
     if ( in.eof() )
         return 1;
@@ -388,7 +914,7 @@ int Simul::loadObjects(Inputter& in, ObjectSet* subset)
     in.lock();
     try
     {
-        res = readObjects(in, subset);
+        res = readObjects(in, mask);
         //std::clog << "loadObjects returns " << res << std::endl;
     }
     catch(Exception & e)
@@ -407,6 +933,10 @@ int Simul::loadObjects(Inputter& in, ObjectSet* subset)
  */
 int Simul::loadObjects(char const* filename)
 {
+    // the file might be the trajectory being written:
+    if ( frameWriter )
+        frameWriter->flush();
+    
     Inputter in(DIM, filename, true);
 
     if ( ! in.good() )
@@ -421,7 +951,8 @@ int Simul::loadObjects(char const* filename)
 /**
  Read file, updating existing objects, and creating new ones for those not 
  already present in the Simul.
- If 'subset!=0' only objects from this class will be imported.
+ Only the objects of the classes selected by `mask` are imported, and the
+ sections of the other classes are skipped without being parsed.
  The Inputter should be locked in a multithreaded application
  
  @returns
@@ -430,7 +961,7 @@ int Simul::loadObjects(char const* filename)
  - 2 : the file does not appear to be a valid cytosim archive
  
   */
-int Simul::readObjects(Inputter& in, ObjectSet* subset)
+int Simul::readObjects(Inputter& in, unsigned mask)
 {
     ObjectSet * objset = nullptr;
     std::string section, line;
@@ -488,6 +1019,12 @@ int Simul::readObjects(Inputter& in, ObjectSet* subset)
                 objset = findSet(section);
                 if ( !objset && section != "end" )
                     std::clog << " warning: unknown section |" << section << "|\n";
+                // skip the sections of the classes that are not needed:
+                if ( objset && !( mask & setBit(objset) ))
+                    in.skip_until("#section ");
+                // the Singles and the Couples that follow can be read in parallel:
+                else if ( objset == &singles && prop->threads != 1 && !prop->skip_free_couple )
+                    readParallel(in, mask);
             }
             // frame start
             else if ( tok == "Cytosim" || tok == "cytosim" || tok == "frame" )
@@ -495,12 +1032,48 @@ int Simul::readObjects(Inputter& in, ObjectSet* subset)
                 if ( has_frame )
                     return 2;
                 has_frame = 1;
+                deltaLoaded = 0;
+                in.precise(false);
+            }
+            // delta frame "#delta 3": the objects not listed are unchanged
+            else if ( tok == "delta" )
+            {
+                iss >> deltaLoaded;
+                thawObjects(mask);
+            }
+            // objects deleted since the previous frame "#delete TAG ID ID..."
+            else if ( tok == "delete" )
+            {
+                iss >> tok;
+                ObjectSet * set = findSetT(tok[0]);
+                ObjectID id = 0;
+                if ( set && ( mask & setBit(set) ))
+                {
+                    while ( iss >> id )
+                    {
+                        Object * obj = set->findID(id);
+                        if ( obj )
+                            set->erase(obj);
+                    }
+                }
+            }
+            // values stored with double precision, in a checkpoint
+            else if ( tok == "precise" )
+            {
+                in.precise(true);
             }
             //binary signature
             else if ( tok == "binary" )
             {
                 in.setEndianess(line.substr(7).c_str());
             }
+            // compressed content "#deflate SIZE CHUNK"
+            else if ( tok == "deflate" )
+            {
+                size_t len = 0, cnt = 0;
+                iss >> len >> cnt;
+                readCompressed(in, len, cnt, mask);
+            }
             // info line "#format 48 dim 2"
             else if ( tok == "format" )
             {
@@ -547,7 +1120,15 @@ int Simul::readObjects(Inputter& in, ObjectSet* subset)
             {
                 iss >> tok;
                 if ( tok == "cytosim" )
+                {
+                    // the Hands of unchanged objects may be bound to modified fibers:
+                    if ( deltaLoaded )
+                    {
+                        for ( Fiber const* fib = fibers.first(); fib; fib = fib->next() )
+                            fib->updateHands();
+                    }
                     return 0;
+                }
 #ifdef BACKWARD_COMPATIBILITY
                 if ( tok == "frame" )
                     return 0;
@@ -597,7 +1178,7 @@ int Simul::readObjects(Inputter& in, ObjectSet* subset)
                 {
                     // check that we are using the correct ObjectSet:
                     assert_true( objset == findSetT(tag) );
-                    const bool discard = ( subset && subset!=objset );
+                    const bool discard = !( mask & setBit(objset) );
                     objset->loadObject(in, tag, fat, discard, true);
                 }
                 else
@@ -606,7 +1187,7 @@ int Simul::readObjects(Inputter& in, ObjectSet* subset)
                     ObjectSet * set = findSetT(tag);
                     if ( set )
                     {
-                        const bool discard = ( subset && subset!=set );
+                        const bool discard = !( mask & setBit(set) );
                         set->loadObject(in, tag, fat, discard, true);
                     }
                 }
@@ -628,6 +1209,127 @@ int Simul::readObjects(Inputter& in, ObjectSet* subset)
 }
 
 
+/// start of the first section after `ptr` that does not hold class `name`, or nullptr
+static const char * sectionEnd(const char * ptr, const char * end, const char * name)
+{
+    const char tag[] = "#section ";
+    const size_t n = strlen(name);
+    while ( ptr < end )
+    {
+        ptr = std::search(ptr, end, tag, tag+9);
+        if ( ptr == end )
+            break;
+        const char * s = ptr + 9;
+        if ( (size_t)( end - s ) <= n || strncmp(s, name, n) || !isspace(s[n]) )
+            return ptr;
+        ptr = s;
+    }
+    return nullptr;
+}
+
+
+/**
+ Read the sections of Singles and Couples concurrently, starting at the current
+ position of `in`, which should follow the first line "#section single".
+ This is only possible when reading from memory and if the Couples follow the
+ Singles directly, and returns `false` without reading anything otherwise.
+ 
+ The two classes only refer to the objects that were read before (Fibers,
+ Solids, etc.) and are stored in different ObjectSets. The lists of Hands of the
+ Fibers, which are updated by both classes, are updated after the threads have
+ completed, in the order of the file, such that the result is the same as
+ reading the sections sequentially (see Hand::unstage).
+ */
+bool Simul::readParallel(Inputter& in, unsigned mask)
+{
+    // reading in parallel is only worth it for large sections:
+    const ptrdiff_t min_size = 1 << 16;
+    
+    const char * ptr = in.cursor();
+    const char * end = in.bound();
+    if ( !ptr || Hand::staging || in.formatID() < 50 || !( mask & setBit(&couples) ))
+        return false;
+    
+    const char * mid = sectionEnd(ptr, end, "single");
+    if ( !mid || mid - ptr < min_size || strncmp(mid, "#section couple ", 16) )
+        return false;
+    const char * sup = sectionEnd(mid, end, "couple");
+    if ( !sup || sup - mid < min_size )
+        return false;
+    
+    Inputter subS(DIM), subC(DIM);
+    subS.memory(ptr, mid-ptr);
+    subC.memory(mid, sup-mid);
+    subS.configure(in);
+    subC.configure(in);
+    Inputter * sub[2] = { &subS, &subC };
+    std::vector<Hand::Staged> staged[2];
+    std::string error[2];
+    
+    #pragma omp parallel for num_threads(2)
+    for ( int i = 0; i < 2; ++i )
+    {
+        Hand::staging = &staged[i];
+        try {
+            readObjects(*sub[i], mask);
+        }
+        catch( Exception & e ) {
+            error[i] = e.what();
+        }
+        Hand::staging = nullptr;
+    }
+    
+    // continue after the Couples:
+    in.seek(in.pos() + ( sup - ptr ));
+    
+    Hand::unstage(staged[0], !in.precise());
+    Hand::unstage(staged[1], !in.precise());
+    
+    for ( int i = 0; i < 2; ++i )
+        if ( error[i].size() )
+            throw InvalidIO(error[i]);
+    return true;
+}
+
+
+/**
+ Read the content of a frame written by writeCompressed(), which is a
+ chunk of `cnt` bytes that inflates to `len` bytes
+ */
+void Simul::readCompressed(Inputter& in, size_t len, size_t cnt, unsigned mask)
+{
+    std::string zip(cnt, 0);
+    if ( cnt != in.read(&zip[0], cnt) )
+        throw InvalidIO("unexpected end of file in compressed frame");
+    
+    char * buf = (char*)malloc(len+1);
+    if ( !buf )
+        throw InvalidIO("could not allocate memory to inflate frame");
+    if ( Zipper::inflate(buf, len, zip.data(), cnt) )
+    {
+        free(buf);
+        throw InvalidIO("corrupted compressed frame");
+    }
+    
+    try
+    {
+        Inputter sub(DIM);
+        sub.memory(buf, len);
+        sub.formatID(in.formatID());
+        sub.vectorSize(in.vectorSize());
+        // this reads until the end of the content, which is not an error here:
+        if ( 2 == readObjects(sub, mask) )
+            throw InvalidIO("invalid compressed frame");
+    }
+    catch( Exception & e )
+    {
+        free(buf);
+        throw;
+    }
+    free(buf);
+}
+
+
 //------------------------------------------------------------------------------
 #pragma mark - Write/Read Properties
 
@@ -667,6 +1369,13 @@ void Simul::writeProperties(char const* name, bool prune) const
     {
         properties_saved = oss.str();
 
+        // the properties are sent to the RunStore, if specified:
+        if ( runStore.size() && ( !name || *name==0 || prop->property_file == name ))
+        {
+            writeStored("properties", properties_saved.data(), properties_saved.size());
+            return;
+        }
+
         // use default file name if 'name' is empty or not provided
         if ( !name || *name==0 )
             name = prop->property_file.c_str();
@@ -680,7 +1389,37 @@ void Simul::writeProperties(char const* name, bool prune) const
 }
 
 
+/**
+ The property file is parsed only if it was modified since the last call,
+ as indicated by its modification time and size, and if its content is different.
+ The first call creates the properties. In the following calls, the properties
+ are changed, and only the properties whose values were modified are completed
+ (see Interface::execute_change). Hence, loading a trajectory with identical
+ properties, or reading repeatedly a file that is not modified, costs nothing.
+ */
 void Simul::loadProperties()
 {
-    Parser(*this, 1, 1, 0, 0, 0).readConfig(prop->property_file);
+    std::string const& file = prop->property_file;
+    struct stat s;
+    if ( stat(file.c_str(), &s) )
+        throw InvalidIO("could not find or read `"+file+"'");
+    bool fresh = properties.empty();
+    if ( !fresh && s.st_mtime == properties_mtime && s.st_size == properties_size )
+        return;
+    properties_mtime = s.st_mtime;
+    properties_size = s.st_size;
+
+    std::ifstream is(file.c_str(), std::ifstream::in);
+    std::string str((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+    if ( !is.good() && !is.eof() )
+        throw InvalidIO("could not find or read `"+file+"'");
+    size_t h = std::hash<std::string>()(str);
+    if ( !fresh && h == properties_hash )
+        return;
+    properties_hash = h;
+
+    if ( fresh )
+        Parser(*this, 1, 1, 0, 0, 0).evaluate(str);
+    else
+        Parser(*this, 0, 1, 0, 0, 0).evaluate(str);
 }
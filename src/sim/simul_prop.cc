@@ -10,6 +10,7 @@
 #include "property_list.h"
 #include "filepath.h"
 #include "random.h"
+#include "profiler.h"
 
 
 //------------------------------------------------------------------------------
@@ -25,6 +26,15 @@ void SimulProp::clear()
     tolerance         = 0.05;
     acceptable_prob   = 0.5;
     precondition      = 1;
+    initial_guess     = 0;
+    newton            = 0;
+    matrix_free       = false;
+    matrix_kernel     = 0;
+    in_place          = false;
+    isolate           = false;
+    huge_pages        = 0;
+    reorder           = 0;
+    threads           = 1;
     random_seed       = 0;
     steric            = 0;
     
@@ -34,9 +44,44 @@ void SimulProp::clear()
     steric_stiffness_pull[1] = 100;
 
     steric_max_range  = -1;
+    steric_skin       = 0;
+    steric_grid_sparse = false;
+    steric_large      = 0;
     binding_grid_step = -1;
+    binding_grid_slack = 0;
+    binding_grid_sparse = false;
+    binding_batch     = false;
+    couple_batch      = false;
+    detach_queue      = false;
+    shuffle           = 1;
+    shuffle_period    = 1;
+    couple_shuffle    = -1;
+    couple_shuffle_period = 0;
+    single_shuffle    = -1;
+    single_shuffle_period = 0;
+    spatial_sort      = 0;
+    grid_tune         = 0;
     
     verbose           = 0;
+    solver_log        = 0;
+    event_log         = false;
+    write_async       = false;
+    frame_compression = 0;
+    frame_quantum     = 0;
+    delta_frames      = 0;
+    profile           = 0;
+    profile_trace     = false;
+    profile_counters  = 0;
+    profile_alloc     = 0;
+    profile_random    = false;
+    status            = 0;
+    status_file       = "status.prom";
+    anomaly           = 0;
+    anomaly_dir       = "anomaly";
+    anomaly_limit     = 8;
+    anomaly_gap       = 100;
+    publish           = 0;
+    publish_name      = "cytosim";
 
     config_file       = "config.cym";
     property_file     = "properties.cmo";
@@ -74,6 +119,15 @@ void SimulProp::read(Glossary& glos)
     glos.set(tolerance,         "tolerance");
     glos.set(acceptable_prob,   "acceptable_prob");
     glos.set(precondition,      "precondition");
+    glos.set(initial_guess,     "initial_guess");
+    glos.set(newton,            "newton");
+    glos.set(matrix_free,       "matrix_free");
+    glos.set(matrix_kernel,     "matrix_kernel");
+    glos.set(in_place,          "in_place");
+    glos.set(isolate,           "isolate");
+    glos.set(huge_pages,        "huge_pages");
+    glos.set(reorder,           "reorder");
+    glos.set(threads,           "threads");
     
     glos.set(steric,                   "steric", {{"off", 0}, {"on", 1}});
     glos.set(steric_stiffness_push[0], "steric", 1);
@@ -81,11 +135,58 @@ void SimulProp::read(Glossary& glos)
     glos.set(steric_stiffness_push, 2, "steric_stiffness_push");
     glos.set(steric_stiffness_pull, 2, "steric_stiffness_pull");
     glos.set(steric_max_range,         "steric_max_range");
+    glos.set(steric_skin,              "steric_skin");
+    glos.set(steric_grid_sparse,       "steric_grid_sparse");
+    glos.set(steric_large,             "steric_large");
 
     glos.set(binding_grid_step, "binding_grid_step");
+    glos.set(binding_grid_slack, "binding_grid_slack");
+    glos.set(binding_grid_sparse, "binding_grid_sparse");
+    glos.set(binding_batch,     "binding_batch");
+    glos.set(couple_batch,      "couple_batch");
+    glos.set(detach_queue,      "detach_queue");
+    
+    Glossary::dict_type<int> shuffles{{"off", 0}, {"partial", 1}, {"full", 2}, {"rotate", 3}};
+    glos.set(shuffle,           "shuffle", shuffles);
+    glos.set(shuffle_period,    "shuffle", 1);
+    glos.set(couple_shuffle,    "couple_shuffle", shuffles);
+    glos.set(couple_shuffle_period, "couple_shuffle", 1);
+    glos.set(single_shuffle,    "single_shuffle", shuffles);
+    glos.set(single_shuffle_period, "single_shuffle", 1);
+    glos.set(spatial_sort,      "spatial_sort");
+    glos.set(grid_tune,         "grid_tune");
     
     // these parameters are not written:
     glos.set(verbose,           "verbose");
+    glos.set(solver_log,        "solver_log");
+    glos.set(event_log,         "event_log");
+    glos.set(write_async,       "write_async");
+    glos.set(frame_compression, "frame_compression");
+    glos.set(frame_quantum,     "frame_quantum");
+    glos.set(delta_frames,      "delta_frames");
+    glos.set(profile,           "profile");
+    glos.set(profile_trace,     "profile", 1);
+    glos.set(profile_alloc,     "profile_alloc");
+    glos.set(profile_random,    "profile_random");
+    glos.set(status,            "status");
+    glos.set(status_file,       "status", 1);
+    glos.set(anomaly,           "anomaly");
+    glos.set(anomaly_dir,       "anomaly", 1);
+    glos.set(anomaly_limit,     "anomaly_limit");
+    glos.set(anomaly_gap,       "anomaly_limit", 1);
+    glos.set(publish,           "publish");
+    glos.set(publish_name,      "publish", 1);
+    if ( glos.has_key("profile_counters") )
+    {
+        profile_counters = 0;
+        for ( unsigned i = 0; i < glos.nb_values("profile_counters"); ++i )
+        {
+            unsigned c = 0;
+            glos.set(c, "profile_counters", i, {{"none", 0}, {"cache", Profiler::COUNT_CACHE},
+                {"branch", Profiler::COUNT_BRANCH}, {"ipc", Profiler::COUNT_IPC}});
+            profile_counters |= c;
+        }
+    }
     
     // names of files and path:
     glos.set(config_file,       "config");
@@ -130,6 +231,12 @@ void SimulProp::complete(Simul const& sim)
             random_seed = RNG.seed();
     }
     
+    if ( frame_compression < 0 || frame_compression > 9 )
+        throw InvalidParameter("simul:frame_compression must be in [0, 9]");
+    
+    if ( frame_quantum < 0 )
+        throw InvalidParameter("simul:frame_quantum must be >= 0");
+
     if ( sim.ready() )
     {
         if ( viscosity <= 0 )
@@ -143,7 +250,16 @@ void SimulProp::complete(Simul const& sim)
         
         if ( kT == 0 && tolerance > 0.01 )
             throw InvalidParameter("if simul:kT==0, simul:tolerance must be set small");
+        
+        if ( threads < 0 )
+            throw InvalidParameter("simul:threads must be >= 0");
+        
+        if ( matrix_kernel < 0 || matrix_kernel > 4 )
+            throw InvalidParameter("simul:matrix_kernel must be in [0, 4]");
     }
+    // this applies to the arrays allocated from now on:
+    huge_page_threshold() = (size_t)huge_pages << 20;
+
     /*
      If the Global parameters have changed, we update all derived parameters.
      To avoid an infinite recurence, the main SimulProp (*this) was
@@ -167,12 +283,55 @@ void SimulProp::write_values(std::ostream& os) const
     write_value(os, "tolerance",       tolerance);
     write_value(os, "acceptable_prob", acceptable_prob);
     write_value(os, "precondition",    precondition);
+    write_value(os, "initial_guess",   initial_guess);
+    write_value(os, "newton",          newton);
+    write_value(os, "matrix_free",     matrix_free);
+    write_value(os, "matrix_kernel",   matrix_kernel);
+    write_value(os, "in_place",        in_place);
+    write_value(os, "isolate",         isolate);
+    write_value(os, "huge_pages",      huge_pages);
+    write_value(os, "reorder",         reorder);
+    write_value(os, "threads",         threads);
     write_value(os, "random_seed",     random_seed);
     std::endl(os);
     write_value(os, "steric", steric, steric_stiffness_push[0], steric_stiffness_pull[0]);
     write_value(os, "steric_max_range",  steric_max_range);
+    write_value(os, "steric_skin",       steric_skin);
+    write_value(os, "steric_grid_sparse", steric_grid_sparse);
+    write_value(os, "steric_large",      steric_large);
     write_value(os, "binding_grid_step", binding_grid_step);
+    write_value(os, "binding_grid_slack", binding_grid_slack);
+    write_value(os, "binding_grid_sparse", binding_grid_sparse);
+    write_value(os, "binding_batch",     binding_batch);
+    write_value(os, "couple_batch",      couple_batch);
+    write_value(os, "detach_queue",      detach_queue);
+    write_value(os, "shuffle",           shuffle, shuffle_period);
+    write_value(os, "couple_shuffle",    couple_shuffle, couple_shuffle_period);
+    write_value(os, "single_shuffle",    single_shuffle, single_shuffle_period);
+    write_value(os, "spatial_sort",      spatial_sort);
+    write_value(os, "grid_tune",         grid_tune);
     write_value(os, "verbose", verbose);
+    write_value(os, "solver_log", solver_log);
+    write_value(os, "event_log", event_log);
+    write_value(os, "write_async", write_async);
+    write_value(os, "frame_compression", frame_compression);
+    write_value(os, "frame_quantum", frame_quantum);
+    write_value(os, "delta_frames", delta_frames);
+    write_value(os, "profile", profile, profile_trace);
+    write_value(os, "status", status, status_file);
+    write_value(os, "anomaly", anomaly, anomaly_dir);
+    write_value(os, "anomaly_limit", anomaly_limit, anomaly_gap);
+    write_value(os, "publish", publish, publish_name);
+    if ( profile_counters )
+    {
+        std::string str;
+        if ( profile_counters & Profiler::COUNT_CACHE )  str += ", cache";
+        if ( profile_counters & Profiler::COUNT_BRANCH ) str += ", branch";
+        if ( profile_counters & Profiler::COUNT_IPC )    str += ", ipc";
+        write_value(os, "profile_counters", str.substr(2));
+    }
+    write_value(os, "profile_alloc", profile_alloc);
+    write_value(os, "profile_random", profile_random);
     std::endl(os);
     write_value(os, "display", "("+display+")");
 }
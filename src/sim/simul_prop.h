@@ -168,6 +168,13 @@ public:
      to try the different accepted values of `precondition`:
      - 0 : do not use preconditionning
      - 1 : use a block preconditionner
+     - 2 : use a block preconditionner, approximating the blocks of long fibers by band matrices
+     - 3 : use a block preconditionner, recalculating the LU factorization of a block
+           only if the matrix block has changed significantly since the last factorization
+     - 4 : use a block preconditionner, combined with a coarse correction that
+           accounts for the coupling between the translations of different objects
+     - 5 : build and factorize the full matrix of the system, which is only done
+           if the system is small (see MECA_DIRECT_LIMIT), and otherwise use 1
      .
      
      With `precondition = 1`, Cytosim calculates a matrix (the preconditionner)
@@ -182,11 +189,152 @@ public:
      
      If there is only one filament in the system, `precondition=0` should perform best.
      With many filaments, trying `precondition = [0, 1]' is the recommended strategy.
+     `precondition = 2` can save time and memory if the fibers have many vertices.
+     `precondition = 3` can save time if the objects have many vertices and change slowly.
+     `precondition = 4` can save time if many objects are linked into a network.
+     `precondition = 5` can save time for small systems that are strongly coupled.
      <em>default value = 0</em>
      */
     int       precondition;
 
     
+    /// If true, the links between objects are applied without storing them in a matrix
+    /**
+     With `matrix_free = 1`, the Hookean links of zero resting length between two
+     different objects (typically made by Couples) are recorded in a compact list
+     and applied directly when the matrix of the system is multiplied by a vector.
+     The terms that are internal to each object are still assembled, such that the
+     preconditionner is not affected. This should produce the same results as the
+     assembled system, up to numerical round-off. <em>default value = 0</em>
+     */
+    bool      matrix_free;
+    
+    
+    /// Method used to multiply the isotropic matrix in 2D
+    /**
+     The isotropic part of the matrix of the system is multiplied by a vector
+     at each iteration of the solver, using one of these kernels:
+     - 0 : the fastest kernel compiled, which uses AVX or SSE if available,
+     - 1 : a scalar kernel, which can be faster if the columns are short,
+     - 2 : the SSE kernel,
+     - 3 : the AVX kernel,
+     - 4 : automatic selection, by timing the kernels on the current matrix periodically.
+     .
+     This only affects 2D simulations. <em>default value = 0</em>
+     */
+    int       matrix_kernel;
+    
+    
+    /// If true, the coordinates of the objects are stored in the vector used by the solver
+    /**
+     With `in_place = 1`, the points of Fibers, Solids, Spheres and Beads are stored
+     directly in the vector of coordinates of the system, in the order in which
+     they are numbered, such that the points are not copied before and after
+     solving the system. The points are copied only at the steps where the
+     numbering changes, because objects were created or deleted, or because
+     the number of points of an object changed. This saves two passes over the
+     coordinates at each time step, which matters for systems with many points
+     if the objects do not change much. The results are otherwise identical.
+     <em>default value = 0</em>
+     */
+    bool      in_place;
+    
+    
+    /// If true, the objects that do not interact with other objects are solved directly
+    /**
+     With `isolate = 1`, the objects (typically passive filaments) that are not
+     connected to any other object by Couples, steric interactions or Organizers
+     are excluded from the iterative solver. The block of the system corresponding
+     to each of these objects is factorized, and their motion is calculated directly,
+     such that the iterative solver only deals with the objects that are coupled.
+     The objects found to be isolated at one time step are placed at the end of the
+     vectors at the next step, and if any of them is found to be coupled, the entire
+     system is solved iteratively as usual. This is worthwhile if most objects are free,
+     and the results are identical up to the tolerance of the iterative solver.
+     <em>default value = 0</em>
+     */
+    bool      isolate;
+    
+    
+    /// Arrays larger than this size, in MB, are backed by huge pages of memory
+    /**
+     With `huge_pages = 4` for example, the vectors of the solver, the matrices,
+     the vectors of the iterative solver and the grids of the Fields that are
+     larger than 4 MB are aligned to 2 MB and the system is asked to back them
+     with huge pages, using madvise(MADV_HUGEPAGE) on Linux.
+     This reduces the misses of the translation lookaside buffer (TLB) for systems
+     with millions of degrees of freedom, at the cost of some unused memory.
+     It requires transparent huge pages to be enabled, in `madvise` or `always` mode.
+     The memory backed by huge pages is given by `report memory`.
+     <em>default value = 0 (disabled)</em>
+     */
+    unsigned  huge_pages;
+    
+    
+    /// Period at which the objects are renumbered to improve memory locality
+    /**
+     By default, the objects are numbered in the matrices and vectors of the system
+     in the order in which they are stored, which is unrelated to their positions,
+     such that strongly coupled objects may occupy distant places in memory.
+     If `reorder = N > 0`, the objects are sorted every N steps along a Morton
+     (Z-order) curve obtained from their central positions, and this order is
+     kept until the next sort, with the objects created meanwhile placed at the end.
+     This can accelerate the multiplication of the sparse
+     matrices, as measured by `cpu_iterate` in the output of `solver_log`.
+     This overrides the sorting by size done in multithreaded mode.
+     <em>default value = 0</em>
+     */
+    unsigned  reorder;
+    
+    
+    /// Method used to set the initial guess of the iterative solver
+    /**
+     The dynamics is solved iteratively, starting from an initial guess of the displacements:
+     - 0 : start from zero (no displacement)
+     - 1 : start from the displacement of each object at the previous time step
+     - 2 : extrapolate linearly from the displacements of the two previous time steps
+     .
+     Options 1 and 2 can reduce the number of iterations if the motion is dominated
+     by deterministic forces, but not if Brownian motion dominates, as the random
+     terms are not correlated between time steps. The number of iterations is
+     reported by `verbose = 1` (see `count` in file `messages.cmo`).
+     <em>default value = 0</em>
+     */
+    int       initial_guess;
+    
+    
+    /// Maximum number of Newton corrections applied after solving the system
+    /**
+     Some interactions are nonlinear (eg. links with a non-zero resting length)
+     and they are linearized around the positions at the start of the time step.
+     If `newton = N > 0`, these interactions are linearized again around the
+     positions calculated by the solver, and the system is solved again,
+     using the previous solution as the initial guess and the same preconditioner.
+     This is repeated up to N times, or until the solution changes by less than
+     the tolerance of the solver. This can reduce errors due to large time steps.
+     <em>default value = 0</em>
+     */
+    unsigned  newton;
+    
+    
+    /// Number of threads used to solve the system of equations
+    /**
+     This is only effective if cytosim was compiled with OpenMP (see meca.h).
+     Threads are also used to paint the FiberGrid, to find steric interactions,
+     and to step the bridging Couples with basic Hands or Motors (see CoupleSet::step).
+     The ends of the Fibers are stepped in parallel with one random stream per Fiber,
+     such that their dynamics does not depend on `threads` (see FiberSet::stepParallel).
+     If `threads != 1`, the Singles and Couples of a frame are read concurrently (see Simul::readParallel).
+     The same executable can then run with a number of threads adapted to the machine:
+     - 1 : the calculation is done sequentially
+     - N : use N threads in the parallel sections of Meca
+     - 0 : use the default number of threads of OpenMP, which follows the environment variable `OMP_NUM_THREADS`
+     .
+     <em>default value = 1</em>
+     */
+    int       threads;
+
+    
     /// A flag to control the engine that implement steric interactions between objects
     int       steric;
     
@@ -220,6 +368,39 @@ public:
      */
     real      steric_max_range;
     
+    /// Extra distance used to build a list of neighboring pairs for steric interactions
+    /**
+     If `steric_skin > 0`, PointGrid records the pairs of objects that are closer
+     than their range of interaction plus `steric_skin` (a Verlet list).
+     At the following time steps, only these pairs are tested, until an object has
+     moved by more than `steric_skin/2`, or objects were added or removed.
+     The cells of the grid are enlarged by `steric_skin`.
+     
+     <em>default value = 0</em> (the pairs are found at every time step)
+     */
+    real      steric_skin;
+    
+    /// if true, the steric grid only allocates memory for the occupied regions
+    /**
+     With `steric_grid_sparse = 1`, the cells of the grid used for steric interactions
+     are grouped in tiles, and only the tiles that contain objects are allocated and
+     scanned. This is useful if the objects occupy a small part of the Space.
+     <em>default value = 0</em>
+     */
+    bool      steric_grid_sparse;
+    
+    /// radius above which a Sphere, Bead or Solid point is not placed on the steric grid
+    /**
+     If `steric_large > 0`, the spherical objects with a radius greater than `steric_large`,
+     such as the envelope of a Nucleus, are handled separately from the grid:
+     each is tested against the objects of the cells that it overlaps, and against
+     the other large objects. These objects are then ignored to calculate the size
+     of the cells, which can remain adapted to the small objects.
+     This is only used with one steric pane.
+     <em>default value = 0</em> (all objects are placed on the grid)
+     */
+    real      steric_large;
+    
     
     /// Lattice size used to determine the attachment of Hand to Fiber
     /**
@@ -236,8 +417,294 @@ public:
      */
     real      binding_grid_step;
     
+    
+    /// Margin used to avoid updating the FiberGrid at every time step
+    /**
+     If `binding_grid_slack > 0`, the segments of the fibers are distributed on the
+     grid with a range extended by this margin, and the grid is only updated when some
+     vertex of a fiber has moved by more than the margin, or if fibers were added,
+     deleted, or if their number of vertices has changed.
+     This can save time if the fibers move slowly, at the cost of more segments
+     associated with each cell. It does not affect the results statistically.
+     <em>default value = 0</em>
+     */
+    real      binding_grid_slack;
+    
+    /// if true, the FiberGrid only allocates memory for the regions covered by fibers
+    /**
+     With `binding_grid_sparse = 1`, the cells of the FiberGrid are grouped in tiles,
+     and the lists of segments are only allocated for the tiles that are covered by
+     some fiber. This saves memory and time if the fibers occupy a small part of the
+     Space, for example if they are concentrated at the periphery of a large cell.
+     <em>default value = 0</em>
+     */
+    bool      binding_grid_sparse;
+    
+    /// if true, the attachments of Hands are processed in batches sorted by position
+    /**
+     If `binding_batch = 1`, the unattached Hands do not immediately search for
+     Fibers. Their queries are recorded, and processed after all Couples and Singles
+     were stepped, grouped by cell of the FiberGrid and in random order within each cell.
+     This improves the use of memory caches if there are many unattached Hands.
+     The attachment rates are not changed, but the random numbers are used in a
+     different order, and the results are thus not identical to the default method.
+     <em>default value = 0</em>
+     */
+    bool      binding_batch;
+    
+    /// if true, the free Couples are stepped in batches, grouped by property
+    /**
+     If `couple_batch = 1`, the positions of the free Couples are copied into a
+     contiguous array, in which they are moved by diffusion all together.
+     The confinement and the attachment of all free Couples are then processed
+     in successive passes. The results are statistically equivalent to the default
+     method, but the random numbers are used in a different order.
+     The bridging Couples made of basic Hands and Motors are also stepped in
+     two passes, which are together identical to the default method.
+     <em>default value = 0</em>
+     */
+    bool      couple_batch;
+    
+    /// if true, the detachment of some attached Singles is scheduled in a priority queue
+    /**
+     If `detach_queue = 1`, an attached Single without force, whose Hand has the basic
+     activity `bind`, is not stepped any more after its first step: the time step at which
+     its Hand will detach spontaneously is calculated from the Gillespie counter,
+     and recorded in a queue ordered by time. The Hand is detached when this time is due,
+     or earlier if the fiber is disassembled. Such Singles are listed after the other
+     attached Singles, which changes the order in which they are saved.
+     <em>default value = 0</em>
+     */
+    bool      detach_queue;
+    
+    /// method used to randomize the order of the objects in their lists, at each step
+    /**
+     The lists of objects are randomized at the start of the time step, to avoid
+     any bias deriving from the order in which the objects are considered.
+     The possible values are:
+     - `off` (0): the lists are not randomized,
+     - `partial` (1): a random portion of the list is moved to its start or end,
+       which requires traversing the list up to two random positions,
+     - `full` (2): a complete Fisher-Yates permutation, using one random number per object,
+     - `rotate` (3): the list is started at an object chosen randomly, in constant time,
+       and the list is reversed with probability 1/2.
+     .
+     With `shuffle = METHOD, K`, the lists are only randomized once every K steps.
+     <em>default value = partial, 1</em>
+     */
+    int       shuffle;
+    
+    /// the lists are randomized once every `shuffle_period` steps (this is `shuffle[1]`)
+    unsigned  shuffle_period;
+    
+    /// method used to randomize the lists of Couples (see `shuffle`)
+    /**
+     By default, `couple_shuffle` is equal to `shuffle`.
+     With `couple_shuffle = METHOD, K`, the lists are randomized once every K steps.
+     */
+    int       couple_shuffle;
+    
+    /// the lists of Couples are randomized once every `couple_shuffle_period` steps
+    unsigned  couple_shuffle_period;
+    
+    /// method used to randomize the lists of Singles (see `shuffle`)
+    /**
+     By default, `single_shuffle` is equal to `shuffle`.
+     With `single_shuffle = METHOD, K`, the lists are randomized once every K steps.
+     */
+    int       single_shuffle;
+    
+    /// the lists of Singles are randomized once every `single_shuffle_period` steps
+    unsigned  single_shuffle_period;
+    
+    /// if > 0, the lists of Singles and Couples are sorted spatially every `spatial_sort` steps
+    /**
+     If `spatial_sort = K > 0`, every K steps the attached Singles and Couples are
+     grouped by the Fiber to which they are attached, and the free ones by the cell
+     of the FiberGrid that contains them, instead of being randomized as specified
+     by `shuffle`. The order of the groups, and the order within each group, are random.
+     This improves the locality of memory accesses, as the objects are stepped
+     in the order of the lists.
+     <em>default value = 0</em> (disabled)
+     */
+    unsigned  spatial_sort;
+    
+    /// number of steps of each trial, to automatically select the cell size of the grids
+    /**
+     If `grid_tune = K > 0`, the cell size of the FiberGrid is multiplied successively
+     by 1, 1/2, 1/sqrt(2), sqrt(2) and 2, each during K steps, while measuring the CPU time
+     spent in painting the grid and in the attachment of the Hands. The fastest setting
+     is then kept, until the total length of the fibers changes by more than 50%,
+     which triggers new trials.
+     Similarly, the cells of the grid used for steric interactions are enlarged by
+     1, sqrt(2) and 2, measuring the time spent in finding the steric interactions.
+     Since the grids affect the order in which random numbers are used, the results
+     are not reproducible with this option.
+     <em>default value = 0</em> (disabled)
+     */
+    unsigned      grid_tune;
+    
     /// level of verbosity
     int           verbose;
+    
+    /// period at which solver statistics are recorded in file `solver.txt` (<em>default = 0</em>)
+    /**
+     If `solver_log = N > 0`, a line is appended to `solver.txt` every N calls to solve(),
+     with the size of the linear system, the number of elements in the sparse matrices,
+     the number of iterations and the final residual of the iterative solver, the level
+     of Brownian noise that sets the convergence tolerance, and the CPU time (in ms)
+     spent in the successive phases of the solve (prepare, interactions, preconditionner,
+     iterations, apply). This is disabled with `solver_log = 0`.
+     */
+    unsigned      solver_log;
+    
+    /// if `true`, breaking and severing of fibers are recorded in file `events.bin` (<em>default = false</em>)
+    /**
+     Each event is stored as a binary EventRecord, containing the time, the identity
+     of the fiber, the abscissa, the tension and the identity of the new fragment.
+     The records are written by a background thread, and `tools/events` converts
+     the file to text.
+     */
+    bool          event_log;
+    
+    /// if `true`, the frames of the trajectory are written to disk by a background thread (<em>default = false</em>)
+    /**
+     Each frame is serialized in memory by the simulation thread, and a separate
+     thread appends it to `trajectory_file`, such that the simulation proceeds
+     without waiting for the disk. At most two frames are held in memory, and
+     the simulation waits if the writer is late. The pending frames are written
+     before the program ends normally, but they can be lost if it is interrupted.
+     */
+    bool          write_async;
+    
+    /// if > 0, the content of each frame of the trajectory is compressed at this level (<em>default = 0</em>)
+    /**
+     The objects of each frame are compressed as an independent chunk with the
+     DEFLATE algorithm, at a level between 1 (fastest) and 9 (smallest).
+     The frames can still be located without decompression, and they are
+     decompressed automatically when the trajectory is read.
+     This is most effective with the binary format and `frame_quantum`.
+     */
+    int           frame_compression;
+    
+    /// if > 0, the coordinates are rounded to a multiple of this distance in binary frames (<em>default = 0</em>)
+    /**
+     The values stored in single precision are rounded to the nearest multiple of
+     the largest power of 2 that is smaller than `frame_quantum`. This is a lossy
+     fixed-point representation, but the trailing bits of the values are zero,
+     which improves the compression of the frames considerably.
+     For example, `frame_quantum = 0.001` keeps a resolution of 0.98 nm if the
+     length unit is the micrometer.
+     */
+    real          frame_quantum;
+    
+    /// if > 1, only one frame in `delta_frames` is complete in the trajectory (<em>default = 0</em>)
+    /**
+     The other frames are 'delta frames' that only contain the objects that have
+     changed since the previous frame, and the identities of the deleted objects.
+     A frame is reconstructed by reading the preceding complete frame and all the
+     delta frames up to it, which FrameReader does automatically. Frames cannot
+     be extracted individually from such a trajectory, for example by `frametool`.
+     */
+    unsigned      delta_frames;
+
+    /// if `profile = N > 0`, the time spent in the phases of the steps is measured over periods of N steps (<em>default = 0</em>)
+    /**
+     The wall-time spent in stepping each class of object, updating the grid,
+     attaching, preparing the system, setting the interactions, calculating the
+     preconditionner, iterating the solver, applying the results and writing the
+     trajectory is accumulated. The last complete period is reported by
+     `report simul:profile`. If `profile = N, 1` the measurements are also written
+     to file `profile.json`, which can be viewed in `chrome://tracing`.
+     */
+    unsigned      profile;
+    
+    /// if `true`, the measurements of `profile` are written to file `profile.json` (<em>default = false</em>)
+    bool          profile_trace;
+    
+    /// hardware counters attached to the phases measured by `profile` (<em>default = none</em>)
+    /**
+     This can be a combination of `cache` (cache misses), `branch` (branch mispredictions)
+     and `ipc` (instructions per cycle), for example `profile_counters = cache, branch`.
+     The counters use the perf_event interface of Linux, and only count the main thread.
+     */
+    unsigned      profile_counters;
+
+    /// if `profile_alloc = N > 0`, the allocations are counted in each phase measured by `profile` (<em>default = 0</em>)
+    /**
+     The number of allocations and the bytes requested from the global operator new
+     are counted for each phase, and the call-stack of one allocation in N is
+     recorded to identify the most frequent call-sites. With `profile_alloc = 1`,
+     every call-stack is recorded, which is slow. The results are given by
+     `report simul:allocations`.
+     */
+    unsigned      profile_alloc;
+
+    /// if `true`, the state of the random generator is recorded after each phase measured by `profile` (<em>default = false</em>)
+    /**
+     A fingerprint of the shared random number generator is written to file
+     `profile_random.txt` after each phase, with one line per step. Two runs with
+     the same `random_seed` can thus be compared, to check that they followed the
+     same trajectory, or find the first phase in which they drew different numbers.
+     The values recorded during the solve may vary, because Meca can generate
+     its random noise concurrently, but they are deterministic at the end of a step.
+     This is used by `python/run/regress.py` to compare the profiles of two executables.
+     */
+    bool          profile_random;
+
+    /// if `status = T > 0`, a file describing the progress is rewritten every T seconds of wall-time (<em>default = 0</em>)
+    /**
+     A background thread periodically writes the simulated time, the number of
+     steps performed and their rate, the number of objects of each class, the
+     iterations of the solver, the peak memory and an estimate of the wall-time
+     needed to complete the current `run`. The file is in the text format of
+     Prometheus, and it is replaced atomically, such that it can be read at any
+     time, for example by the 'textfile' collector of `node_exporter`.
+     The name of the file can be given as second value: `status = 60, run.prom`.
+     */
+    real          status;
+    
+    /// name of the file written if `status > 0` (<em>default = status.prom</em>)
+    std::string   status_file;
+
+    /// if `anomaly = F > 0`, the steps that are F times slower than usual are reported (<em>default = 0</em>)
+    /**
+     A step is anomalous if the number of iterations of the solver, or the
+     wall-time of the step, exceeds F times the median of the last 64 steps.
+     For each anomalous step, the linear system is saved as with the command
+     `save`, in a subdirectory of `anomaly_dir` named after the step, together
+     with a file `anomaly.txt` describing the step and the profile of its phases.
+     If the solver fails to converge, the system is also saved before the
+     simulation stops. The directory can be given as second value:
+     `anomaly = 10, diagnostics`. The saved systems can be read by `test_sparse`.
+     */
+    real          anomaly;
+    
+    /// directory receiving the reports if `anomaly > 0` (<em>default = anomaly</em>)
+    std::string   anomaly_dir;
+    
+    /// maximum number of reports made if `anomaly > 0` (<em>default = 8</em>)
+    /**
+     The second value is the minimum number of steps between two reports:
+     `anomaly_limit = 8, 1000`.
+     */
+    unsigned      anomaly_limit;
+    
+    /// minimum number of steps between two reports made if `anomaly > 0` (<em>default = 100</em>)
+    unsigned      anomaly_gap;
+
+    /// if `publish = T > 0`, the state is copied to shared memory every T seconds of wall-time (<em>default = 0</em>)
+    /**
+     The properties and the objects are written, as in `properties.cmo` and
+     `objects.cmo`, to a POSIX shared memory segment, which can be displayed
+     live by `play attach=NAME`, on the same machine. The simulation does not
+     wait for the viewer, which only sees the last state published.
+     The name of the segment can be given as second value: `publish = 0.1, run1`.
+     */
+    real          publish;
+    
+    /// name of the shared memory segment written if `publish > 0` (<em>default = cytosim</em>)
+    std::string   publish_name;
 
     /// Name of configuration file (<em>default = config.cym</em>)
     std::string   config_file;
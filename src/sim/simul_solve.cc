@@ -9,6 +9,9 @@
  
  We assume that Fiber::adjustSegmentation() is used, ensuring that
  ( actual segmentation ) < ( 4/3 * FiberProp::segmentation ).
+ 
+ The objects larger than SimulProp::steric_large are not placed on the grid,
+ and are ignored here.
  */
 real Simul::estimateStericRange() const
 {
@@ -44,16 +47,18 @@ real Simul::estimateStericRange() const
      */
     ran =  len + 2*ran;
     
+    // objects that are not placed on the grid:
+    const real big = ( prop->steric_large > 0 ) ? prop->steric_large : INFINITY;
     
     for ( Sphere const* sp=spheres.first(); sp; sp=sp->next() )
     {
-        if ( sp->prop->steric )
+        if ( sp->prop->steric && sp->radius() <= big )
             ran = std::max(ran, 2 * sp->radius() + sp->prop->steric_range);
     }
     
     for ( Bead const* bd=beads.first(); bd; bd=bd->next() )
     {
-        if ( bd->prop->steric )
+        if ( bd->prop->steric && bd->radius() <= big )
             ran = std::max(ran, 2 * bd->radius() + bd->prop->steric_range);
     }
     
@@ -62,7 +67,8 @@ real Simul::estimateStericRange() const
         if ( so->prop->steric )
         {
             for ( unsigned p = 0; p < so->nbPoints(); ++p )
-                ran = std::max(ran, 2 * so->radius(p) + so->prop->steric_range);
+                if ( so->radius(p) <= big )
+                    ran = std::max(ran, 2 * so->radius(p) + so->prop->steric_range);
         }
     }
     
@@ -84,8 +90,14 @@ void Simul::setStericGrid(Space const* spc) const
     if ( res <= 0 )
         throw InvalidParameter("simul:steric_max_range must be defined");
 
+    // the cells are enlarged to include the skin of the Verlet list:
+    const real skin = std::max(real(0), prop->steric_skin);
+
+    // factor selected by the automatic tuning:
+    const real fac = prop->grid_tune ? stericTuner.factor() : 1;
+
     const size_t sup = 1 << 17;
-    while ( pointGrid.setGrid(spc, res) > sup )
+    while ( pointGrid.setGrid(spc, (res+skin)*fac) > sup )
         res *= M_SQRT2;
 
     if ( res != prop->steric_max_range )
@@ -93,7 +105,13 @@ void Simul::setStericGrid(Space const* spc) const
         Cytosim::log("adjusting simul:steric_max_range = %.3f\n", res);
         prop->steric_max_range = res;
     }
+    pointGrid.setSparse(prop->steric_grid_sparse);
     pointGrid.createCells();
+    pointGrid.setThreads(prop->threads);
+#if ( NB_STERIC_PANES == 1 )
+    pointGrid.setSkin(skin);
+    pointGrid.setLarge(prop->steric_large);
+#endif
 }
 
 
@@ -124,6 +142,8 @@ void Simul::setStericInteractions(Meca& meca) const
             return;
         setStericGrid(spaces.master());
     }
+    
+    const double cpu = prop->grid_tune ? TicToc::milliseconds() : 0;
 
     // clear grid
     pointGrid.clear();
@@ -207,24 +227,87 @@ void Simul::setStericInteractions(Meca& meca) const
         pointGrid.setInteractions(meca, pam, p);
 
 #endif
+    
+    // change the cell size of the grid, as decided by `stericTuner`
+    if ( prop->grid_tune )
+    {
+        const bool was = stericTuner.tuning();
+        if ( stericTuner.record(TicToc::milliseconds()-cpu, fibers.totalLength(), prop->grid_tune) )
+            setStericGrid(spaces.master());
+        if ( was && !stericTuner.tuning() && prop->verbose )
+        {
+            for ( unsigned i = 0; i < stericTuner.size(); ++i )
+                std::clog << " steric grid x " << stericTuner.factor(i) << " time " << stericTuner.cpu(i) << "\n";
+            std::clog << " ----> x " << stericTuner.factor() << std::endl;
+        }
+    }
 }
 
 
 //------------------------------------------------------------------------------
+#if MECA_USES_OPENMP
+/**
+ Call setInteractions() for the objects of the list starting with `obj`, using
+ the threads of Meca. The objects are divided in `nbThreadsUsed()` contiguous
+ ranges, and range `r` sets its interactions in `meca.stage(r)`.
+ */
+template < typename OBJ >
+static void setInteractionsParallel(OBJ const* obj, Meca & meca)
+{
+    std::vector<OBJ const*> vec;
+    for ( ; obj; obj = obj->next() )
+        vec.push_back(obj);
+    
+    const size_t cnt = vec.size();
+    const int nbt = meca.nbThreadsUsed();
+    Modulo const* mod = modulo;
+    
+    #pragma omp parallel num_threads(nbt)
+    {
+        const int T = omp_get_num_threads();
+        // `modulo` is thread_local:
+        modulo = mod;
+        for ( int r = omp_get_thread_num(); r < nbt; r += T )
+        {
+            Meca & stage = meca.stage(r);
+            const size_t sup = cnt * ( r + 1 ) / nbt;
+            for ( size_t i = cnt * r / nbt; i < sup; ++i )
+                vec[i]->setInteractions(stage);
+        }
+    }
+}
+#endif
+
+
 /**
  This will:
  - Register all Mecables in the Meca: Fiber Solid Bead and Sphere
  - call setInteractions() for all objects in the system,
  - call setStericInteractions() if prop->steric is true.
  .
+ With multiple threads, the Fibers, the attached Singles, the bridging
+ Couples and the Organizers are processed in parallel, with each thread accumulating its
+ interactions in a private Meca, which are all added before the system is solved.
+ The other objects are processed sequentially.
  */
 void Simul::setAllInteractions(Meca & meca) const
 {
     for ( Space * s=spaces.first(); s; s=s->next() )
         s->setInteractions(meca, fibers);
     
-    for ( Fiber * f=fibers.first(); f ; f=f->next() )
-        f->setInteractions(meca);
+#if MECA_USES_OPENMP
+    const bool parallel = ( meca.nbThreadsUsed() > 1 && !meca.drawLinks );
+    if ( parallel )
+    {
+        meca.openStages();
+        setInteractionsParallel(fibers.first(), meca);
+    }
+    else
+#endif
+    {
+        for ( Fiber * f=fibers.first(); f ; f=f->next() )
+            f->setInteractions(meca);
+    }
     
     for ( Solid * s=solids.first(); s ; s=s->next() )
         s->setInteractions(meca);
@@ -235,21 +318,36 @@ void Simul::setAllInteractions(Meca & meca) const
     for ( Bead * b=beads.first(); b ; b=b->next() )
         b->setInteractions(meca);
 
-    for ( Single * i=singles.firstA(); i ; i=i->next() )
-        i->setInteractions(meca);
-
-    for ( Couple * c=couples.firstAA(); c ; c=c->next() )
-        c->setInteractions(meca);
-    
-    for ( Organizer * a = organizers.first(); a; a=a->next() )
-        a->setInteractions(meca);
+#if MECA_USES_OPENMP
+    if ( parallel )
+    {
+        setInteractionsParallel(singles.firstA(), meca);
+        setInteractionsParallel(couples.firstAA(), meca);
+        setInteractionsParallel(organizers.first(), meca);
+        meca.closeStages();
+    }
+    else
+#endif
+    {
+        for ( Single * i=singles.firstA(); i ; i=i->next() )
+            i->setInteractions(meca);
+        
+        for ( Couple * c=couples.firstAA(); c ; c=c->next() )
+            c->setInteractions(meca);
+        
+        for ( Organizer * a = organizers.first(); a; a=a->next() )
+            a->setInteractions(meca);
+    }
 
     //for ( Event * e = events.first(); e; e=e->next() )
     //    e->setInteractions(meca);
 
     // add steric interactions
     if ( prop->steric )
+    {
+        Profiler::Scope scope(profiler, PRO_STERIC);
         setStericInteractions(meca);
+    }
     
     
     // ALL THE FORCES BELOW WERE DONE FOR TESTING PURPOSES:
@@ -302,13 +400,109 @@ void Simul::setAllInteractions(Meca & meca) const
 }
 
 
-/// solve the system
-void Simul::solve()
+/**
+ Solve the system, recording the CPU time spent in the different phases,
+ and append a line of statistics to the file 'solver.txt'
+ */
+double Simul::solve_logged(int precond)
 {
+    double cpu[5];
+    cpu[0] = TicToc::milliseconds();
     sMeca.prepare(this);
+    sMeca.startNoise();
+    cpu[1] = TicToc::milliseconds();
     setAllInteractions(sMeca);
-    sMeca.solve(prop, prop->precondition);
+    cpu[2] = TicToc::milliseconds();
+    solve_meca(precond);
+    solve_newton(precond);
+    cpu[3] = TicToc::milliseconds();
     sMeca.apply();
+    cpu[4] = TicToc::milliseconds();
+
+    if ( !solverLog )
+    {
+        solverLog = fopen("solver.txt", "w");
+        if ( !solverLog )
+            throw InvalidIO("could not open file `solver.txt'");
+        fprintf(solverLog, "%% time  dimension  elements_B  elements_C  precond  count  residual  noise");
+        fprintf(solverLog, "  cpu_precond  cpu_iterate  cpu_prepare  cpu_interactions  cpu_solve  cpu_apply\n");
+    }
+    fprintf(solverLog, "%10.4f", prop->time);
+    sMeca.writeStatistics(solverLog, precond);
+    for ( int i = 0; i < 4; ++i )
+        fprintf(solverLog, " %9.3f", cpu[i+1]-cpu[i]);
+    fprintf(solverLog, "\n");
+    
+    return cpu[3] - cpu[2];
+}
+
+
+/**
+ If the solver fails to converge, Meca::solve() throws an Exception, which
+ normally stops the simulation. With `simul:anomaly`, the system is saved first.
+ */
+void Simul::solve_meca(int precond)
+{
+    try {
+        sMeca.solve(prop, precond);
+    }
+    catch( Exception & e ) {
+        if ( anomalyMonitor )
+            saveAnomaly(e.brief());
+        throw;
+    }
+}
+
+
+/**
+ Improve the solution by Newton's method: the interactions are linearized
+ again around the positions calculated by Meca::solve(), and the system
+ is solved again, reusing the same preconditioner.
+ This is only useful if nonlinear interactions have a significant effect.
+ */
+void Simul::solve_newton(int precond)
+{
+    for ( unsigned n = 0; n < prop->newton; ++n )
+    {
+        sMeca.relinearize();
+        setAllInteractions(sMeca);
+        if ( !sMeca.correct(prop, precond) )
+            break;
+    }
+}
+
+
+/// solve the system
+void Simul::solve()
+{
+    if ( prop->solver_log && 0 == solverCounter++ % prop->solver_log )
+    {
+        solve_logged(prop->precondition);
+        return;
+    }
+    {
+        Profiler::Scope scope(profiler, PRO_PREPARE);
+        sMeca.prepare(this);
+        sMeca.startNoise();
+    }
+    {
+        Profiler::Scope scope(profiler, PRO_INTERACTIONS);
+        setAllInteractions(sMeca);
+    }
+    const double start = profiler.enabled() ? profiler.now() : 0;
+    solve_meca(prop->precondition);
+    if ( profiler.enabled() )
+    {
+        // Meca measures the time of its phases in milliseconds:
+        const double pre = 1000 * sMeca.solveTime(0);
+        profiler.record(PRO_PRECOND, start, pre);
+        profiler.record(PRO_ITERATE, start + pre, 1000 * sMeca.solveTime(1));
+    }
+    solve_newton(prop->precondition);
+    {
+        Profiler::Scope scope(profiler, PRO_APPLY);
+        sMeca.apply();
+    }
 #if ( 0 )
     // check that recalculating gives similar forces
     fibers.firstID()->printTensions(stderr, 47);
@@ -319,23 +513,50 @@ void Simul::solve()
 }
 
 
+/**
+ The mechanics is solved once for `cnt * time_step`, such that the motion
+ corresponds to `cnt` steps during which the forces are held constant.
+ Only Meca uses `time_step` during the solve, and the properties are not
+ completed again, since they are unchanged for the Monte-Carlo steps.
+ */
+void Simul::solveSpan(void (Simul::* func)(), unsigned cnt)
+{
+    const real dt = prop->time_step;
+    prop->time_step = cnt * dt;
+    (this->*func)();
+    prop->time_step = dt;
+}
+
+
 /*
  Solve the system, and automatically select the fastest preconditionning method
  */
 void Simul::solve_auto()
 {
-    sMeca.prepare(this);
-    setAllInteractions(sMeca);
-    
-    // solve the system, recording time:
-    double cpu = TicToc::milliseconds();
-    sMeca.solve(prop, precondMethod);
-    cpu = TicToc::milliseconds() - cpu;
-    
-    sMeca.apply();
+    double cpu;
+    if ( prop->solver_log && 0 == solverCounter++ % prop->solver_log )
+    {
+        cpu = solve_logged(precondMethod);
+    }
+    else
+    {
+        sMeca.prepare(this);
+        sMeca.startNoise();
+        setAllInteractions(sMeca);
+        
+        // solve the system, recording time:
+        cpu = TicToc::milliseconds();
+        solve_meca(precondMethod);
+        solve_newton(precondMethod);
+        cpu = TicToc::milliseconds() - cpu;
+        
+        sMeca.apply();
+    }
 
     // Automatic selection of preconditionning method:
-    const unsigned N_TEST = 6;
+    // the direct method is only tried if the system is small
+    const bool direct = ( sMeca.dimension() <= Meca::directLimit() );
+    const unsigned N_TEST = direct ? 10 : 8;
     const unsigned PERIOD = 32;
     
     //automatically select the preconditionning mode:
@@ -355,27 +576,37 @@ void Simul::solve_auto()
                 precondMethod = 1;
             if ( precondCPU[precondMethod] > precondCPU[2] + 10 )
                 precondMethod = 2;
+            if ( precondCPU[precondMethod] > precondCPU[3] + 10 )
+                precondMethod = 3;
+            if ( direct && precondCPU[precondMethod] > precondCPU[5] + 10 )
+                precondMethod = 5;
             
             if ( prop->verbose )
             {
                 std::clog << " precond 0 time " << precondCPU[0] << "\n";
                 std::clog << "         1 time " << precondCPU[1] << "\n";
                 std::clog << "         2 time " << precondCPU[2] << "\n";
+                std::clog << "         3 time " << precondCPU[3] << "\n";
+                if ( direct )
+                    std::clog << "         5 time " << precondCPU[5] << "\n";
                 std::clog << " ----> " << precondMethod << std::endl;
             }
         }
         else
         {
-            //alternate betwen methods { 0, 1, 2 }
-            precondMethod = ( 1 + precondMethod ) % 3;
+            //alternate betwen methods { 0, 1, 2, 3 } and also 5 if possible
+            if ( precondMethod < 3 )
+                ++precondMethod;
+            else if ( precondMethod == 3 && direct )
+                precondMethod = 5;
+            else
+                precondMethod = 0;
         }
     }
     else if ( precondCounter > PERIOD )
     {
-        precondCPU[0] = 0;
-        precondCPU[1] = 0;
-        precondCPU[2] = 0;
-        precondCPU[3] = 0;
+        for ( int i = 0; i < 6; ++i )
+            precondCPU[i] = 0;
         precondCounter = 0;
     }
 }
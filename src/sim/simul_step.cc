@@ -49,9 +49,20 @@ void Simul::setFiberGrid(Space const* spc) const
     }
     prop->binding_grid_step = step;
     //std::clog << "simul:binding_grid_step = " << prop->binding_grid_step << "\n";
+    
+    // apply the factor selected by the automatic tuning:
+    if ( prop->grid_tune && bindingTuner.factor() != 1 )
+    {
+        if ( fiberGrid.setGrid(spc, step*bindingTuner.factor()) > sup )
+            fiberGrid.setGrid(spc, step);
+        else
+            step *= bindingTuner.factor();
+    }
 
     // create the grid cells:
+    fiberGrid.setSparse(prop->binding_grid_sparse);
     fiberGrid.createCells();
+    fiberGrid.setThreads(prop->threads);
 
     //Cytosim::log("simul:binding_grid_step %.3f\n", prop->binding_grid_step);
     Cytosim::log(" BindingGrid has %i cells of size %.3f um\n", fiberGrid.nbCells(), step);
@@ -59,6 +70,31 @@ void Simul::setFiberGrid(Space const* spc) const
 }
 
 
+/**
+ Record the CPU time spent in painting the FiberGrid and attaching the Hands,
+ and change the cell size of the grid, as decided by `bindingTuner`
+ */
+void Simul::tuneFiberGrid(double cpu)
+{
+    const bool was = bindingTuner.tuning();
+    if ( bindingTuner.record(cpu, fibers.totalLength(), prop->grid_tune) )
+        setFiberGrid(spaces.master());
+    if ( was && !bindingTuner.tuning() && prop->verbose )
+    {
+        for ( unsigned i = 0; i < bindingTuner.size(); ++i )
+            std::clog << " binding_grid_step x " << bindingTuner.factor(i) << " time " << bindingTuner.cpu(i) << "\n";
+        std::clog << " ----> x " << bindingTuner.factor() << std::endl;
+    }
+}
+
+
+/// fingerprint of the shared random generator, recorded by the Profiler
+static unsigned long long randomFingerprint()
+{
+    return sharedRNG.fingerprint();
+}
+
+
 /**
  Will pepare the simulation engine to make it ready to make a step():
  - set FiberGrid used for attachment of Hands,
@@ -73,6 +109,9 @@ void Simul::prepare()
     if ( !spaces.master() )
         throw InvalidSyntax("A space must be defined first!");
 
+    // the boundary conditions are set in the thread running the simulation:
+    spaces.setMaster(spaces.master());
+
     // make sure properties are ready for simulations:
     sReady = true;
     prop->complete(*this);
@@ -80,12 +119,149 @@ void Simul::prepare()
     // prepare grid for attachments:
     setFiberGrid(spaces.master());
     
+    // the grid for steric interactions is otherwise made by the first solve():
+    if ( pointGrid.hasGrid() )
+        setStericGrid(spaces.master());
+    
+    // this is necessary for space:distance_map
+    spaces.prepare();
+    
     // this is necessary for diffusion in Field:
     fields.prepare();
     
     // this prepares for 'fast_diffusion':
     singles.prepare(properties);
     couples.prepare(properties);
+    
+    // set the methods used to randomize the lists of objects:
+    ObjectSet * sets[] = { &events, &organizers, &beads, &solids, &fibers, &spheres, &spaces };
+    for ( ObjectSet * set : sets )
+        set->setShuffle(prop->shuffle, prop->shuffle_period);
+    if ( prop->couple_shuffle < 0 )
+        couples.setShuffle(prop->shuffle, prop->shuffle_period);
+    else
+        couples.setShuffle(prop->couple_shuffle, std::max(1U, prop->couple_shuffle_period));
+    if ( prop->single_shuffle < 0 )
+        singles.setShuffle(prop->shuffle, prop->shuffle_period);
+    else
+        singles.setShuffle(prop->single_shuffle, std::max(1U, prop->single_shuffle_period));
+    couples.setSorting(prop->spatial_sort);
+    singles.setSorting(prop->spatial_sort);
+    
+    // the profile of the phases is also needed to describe the anomalous steps:
+    if ( ( prop->profile || prop->anomaly > 0 ) && !profiler.enabled() )
+    {
+        static const char * const names[] = { "shuffle", "events", "organizers",
+            "spaces", "spheres", "beads", "solids", "fibers", "grid", "couples",
+            "fields", "singles", "attach", "prepare", "interactions", "steric",
+            "precondition", "iterations", "apply", "output" };
+        static_assert(sizeof(names)/sizeof(*names) == PRO_COUNT, "phase names");
+        const unsigned period = prop->profile ? prop->profile : 1024;
+        profiler.enable(period, names, PRO_COUNT, prop->profile_trace ? "profile.json" : nullptr);
+        if ( prop->profile_counters )
+            profiler.enableCounters(prop->profile_counters);
+        if ( prop->profile_random )
+            profiler.enableProbe(randomFingerprint, "profile_random.txt");
+    }
+    
+    if ( prop->profile_alloc && !alloc_tracked() )
+        alloc_tracking(prop->profile_alloc);
+    
+    if ( prop->status > 0 && !statusWriter )
+        statusWriter = new StatusWriter(prop->status_file, prop->status);
+    
+    if ( prop->anomaly > 0 && !anomalyMonitor )
+        anomalyMonitor = new AnomalyMonitor(prop->anomaly, prop->anomaly_limit, prop->anomaly_gap);
+    // the time spent between two runs is not counted:
+    anomalyClock = TicToc::milliseconds();
+    
+    if ( prop->publish > 0 && !sharedFrame )
+    {
+        sharedFrame = new SharedFrame;
+        if ( sharedFrame->create(prop->publish_name) )
+            throw InvalidIO("could not create shared memory `"+prop->publish_name+"'");
+    }
+    
+    if ( prop->event_log && !eventLog )
+    {
+        eventLog = new EventLog;
+        if ( !eventLog->open("events.bin") )
+            Cytosim::warn << "could not open file `events.bin'\n";
+    }
+}
+
+
+void Simul::recordEvent(unsigned kind, ObjectID fiber, real abscissa, real tension, ObjectID fragment)
+{
+    if ( eventLog )
+    {
+        EventRecord rec;
+        rec.time = prop->time;
+        rec.abscissa = abscissa;
+        rec.tension = (float)tension;
+        rec.kind = kind;
+        rec.fiber = fiber;
+        rec.fragment = fragment;
+        eventLog->record(rec);
+    }
+}
+
+
+/**
+ The properties are completed again, to update the parameters that depend on time_step.
+ This is limited to the categories of Property that derive rates from time_step:
+ the Properties of Space, Solid, Sphere, Bead, Nucleus, Fake and Event do not.
+ */
+void Simul::changeTimeStep(real dt)
+{
+    if ( dt != prop->time_step )
+    {
+        prop->time_step = dt;
+        for ( Property * p : properties )
+        {
+            std::string const& c = p->category();
+            if ( c == "hand" || c == "single" || c == "couple" || c == "fiber"
+                || c == "field" || c == "aster" || c == "bundle" )
+                p->complete(*this);
+        }
+        fields.prepare();
+        singles.prepare(properties);
+        couples.prepare(properties);
+    }
+}
+
+
+/**
+ The time step is increased by 25% if the solver converged in less than `iterations/2`,
+ halved if it took more than `iterations`, and reset to `dt_min` if the number of fibers
+ has changed. It is also limited such that ( rate * time_step < acceptable_prob ) for
+ the binding and unbinding rates of all Hands.
+ */
+real Simul::adaptTimeStep(real dt, real dt_min, real dt_max, unsigned iterations)
+{
+    const unsigned cnt = sMeca.nbIterations();
+    
+    if ( fibers.size() != adaptNbFibers )
+    {
+        adaptNbFibers = fibers.size();
+        dt = dt_min;
+    }
+    else if ( cnt > iterations )
+        dt = 0.5 * dt;
+    else if ( 2 * cnt < iterations )
+        dt = 1.25 * dt;
+    
+    // limit the probability of binding and unbinding:
+    real rate = 0;
+    for ( Property const* i : properties.find_all("hand") )
+    {
+        HandProp const* hp = static_cast<HandProp const*>(i);
+        rate = std::max(rate, std::max(hp->binding_rate, hp->unbinding_rate));
+    }
+    if ( rate > 0 )
+        dt = std::min(dt, prop->acceptable_prob / rate);
+    
+    return std::max(dt_min, std::min(dt, dt_max));
 }
 
 
@@ -99,42 +275,55 @@ void Simul::prepare()
  */
 void Simul::step()
 {
+    // the previous step and the following solve are complete:
+    if ( anomalyMonitor )
+        checkAnomaly();
+    
     // increment time:
     prop->time += prop->time_step;
     //printf("\n------ time is %8.3f\n", prop->time);
+    profiler.step();
 
     // mix object lists
-    events.shuffle();
-    organizers.shuffle();
-    beads.shuffle();
-    solids.shuffle();
-    fibers.shuffle();
-    spheres.shuffle();
-    couples.shuffle();
-    singles.shuffle();
-    spaces.shuffle();
+    {
+        Profiler::Scope scope(profiler, PRO_SHUFFLE);
+        events.shuffle();
+        organizers.shuffle();
+        beads.shuffle();
+        solids.shuffle();
+        fibers.shuffle();
+        spheres.shuffle();
+        couples.shuffle();
+        singles.shuffle();
+        spaces.shuffle();
+    }
     
     // Monte-Carlo step for all objects
-    events.step();
-    organizers.step();
-    fields.step();
-    spaces.step();
-    spheres.step();
-    beads.step();
-    solids.step();
-    fibers.step();
+    { Profiler::Scope scope(profiler, PRO_EVENTS); events.step(); }
+    { Profiler::Scope scope(profiler, PRO_ORGANIZERS); organizers.step(); }
+    fields.startStep();
+    { Profiler::Scope scope(profiler, PRO_SPACES); spaces.step(); }
+    { Profiler::Scope scope(profiler, PRO_SPHERES); spheres.step(); }
+    { Profiler::Scope scope(profiler, PRO_BEADS); beads.step(); }
+    { Profiler::Scope scope(profiler, PRO_SOLIDS); solids.step(); }
+    { Profiler::Scope scope(profiler, PRO_FIBERS); fibers.step(); }
     
     // calculate grid range from Hand's binding range:
     real range = 0.0;
     for ( Property * i : properties.find_all("hand") )
         range = std::max(range, static_cast<HandProp const*>(i)->binding_range);
 
+    const double cpu = prop->grid_tune ? TicToc::milliseconds() : 0;
+
     // distribute Fibers over a grid for binding of Hands:
-    fiberGrid.paintGrid(fibers.first(), nullptr, range);
+    {
+        Profiler::Scope scope(profiler, PRO_GRID);
+        fiberGrid.updateGrid(fibers.first(), nullptr, range, prop->binding_grid_slack);
+    }
     
 #if ( 0 )
     
-    // This code continuously tests the binding algorithm.
+    // This code continuously tests the binding algorithm (see also test_attach).
     
     if ( fiberGrid.hasGrid() )
     {
@@ -155,10 +344,93 @@ void Simul::step()
 #endif
     
     // step Hand-containing objects, giving them a possibility to attach Fibers:
-    couples.step();
-    singles.step();
+    fiberGrid.setBatch(prop->binding_batch);
+    { Profiler::Scope scope(profiler, PRO_COUPLES); couples.step(); }
+    // the Singles may bind according to a Field:
+    { Profiler::Scope scope(profiler, PRO_FIELDS); fields.finishStep(); }
+    { Profiler::Scope scope(profiler, PRO_SINGLES); singles.step(); }
+    { Profiler::Scope scope(profiler, PRO_ATTACH); fiberGrid.attachQueued(); }
+    
+    ++statusSteps;
+    if ( statusWriter && statusWriter->wanted() )
+        writeStatus();
+    
+    if ( sharedFrame && TicToc::milliseconds() >= publishClock )
+        publishFrame();
+    
+    if ( prop->grid_tune )
+        tuneFiberGrid(TicToc::milliseconds() - cpu);
+}
+
+
+/**
+ The objects are counted for each Property, which could be expensive, but this
+ is only done when the StatusWriter requests it, every `simul:status` seconds.
+ */
+void Simul::writeStatus()
+{
+    StatusWriter::Status s;
+    s.time = prop->time;
+    s.end = endTime;
+    s.steps = statusSteps;
+    s.iterations = sMeca.nbIterations();
+    for ( Property const* p : properties )
+    {
+        ObjectSet * set = findSet(p->category());
+        if ( set )
+            s.objects.emplace_back(p->category()+":"+p->name(), set->count(match_property, p));
+    }
+    statusWriter->submit(s);
+}
+
+
+/**
+ The frame is written in binary format to memory, and copied to `sharedFrame`
+ with the properties. A failure is reported but does not stop the simulation.
+ */
+void Simul::publishFrame()
+{
+    Profiler::Scope scope(profiler, PRO_OUTPUT);
+    publishClock = TicToc::milliseconds() + 1000 * prop->publish;
+
+    std::ostringstream props;
+    writeProperties(props, true);
+
+    char * buf = nullptr;
+    size_t len = 0;
+    FILE * mem = open_memstream(&buf, &len);
+    if ( !mem )
+        return;
+    Outputter out(mem, true);
+    writeObjects(out);
+    out.close();
+    if ( sharedFrame->publish(props.str(), buf, len) )
+        Cytosim::warn << "could not publish state to shared memory\n";
+    free(buf);
+}
+
+
+/**
+ The time of a step is the wall-time since the previous call, excluding the
+ time spent writing the trajectory, which is usually done periodically.
+ This is called before the Profiler starts a new step, such that the profile
+ of the phases corresponds to the step, and the system of Meca is still valid.
+ */
+void Simul::checkAnomaly()
+{
+    const double now = TicToc::milliseconds();
+    const double cpu = now - anomalyClock - 1e-3 * profiler.stepTime(PRO_OUTPUT);
+    anomalyClock = now;
     
-    //printf("     ::attach   %16llu\n", (__rdtsc()-rdtsc)>>3);
+    int res = anomalyMonitor->check(sMeca.nbIterations(), cpu);
+    if ( res )
+    {
+        char str[256];
+        snprintf(str, sizeof(str), "step %lu took %.3f ms and %u iterations, %.1f times and %.1f times the medians",
+                 statusSteps, cpu, sMeca.nbIterations(), cpu / std::max(anomalyMonitor->medianTime(), 1e-6),
+                 sMeca.nbIterations() / std::max(anomalyMonitor->medianIterations(), 1.0));
+        saveAnomaly(str);
+    }
 }
 
 
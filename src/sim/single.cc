@@ -11,15 +11,19 @@
 #include "modulo.h"
 #include "meca.h"
 
-extern Modulo const* modulo;
+
+thread_local Slab Single::slab("single");
+
+extern thread_local Modulo const* modulo;
 
 //------------------------------------------------------------------------------
 Single::Single(SingleProp const* p, Vector const& w)
-: sPos(w), sHand(nullptr), prop(p)
+: sDue(0), sPos(w), sHand(nullptr), prop(p)
 {
     assert_true(prop->hand_prop);
     sHand = prop->hand_prop->newHand(this);
     assert_true(sHand);
+    monitorKind(MONITOR_SINGLE);
 }
 
 
@@ -115,7 +119,7 @@ void Single::stepF(Simul& sim)
     // confinement:
     if ( prop->confine == CONFINE_INSIDE )
     {
-        if ( !prop->confine_space_ptr->inside(sPos) )
+        if ( !prop->confine_space_ptr->isInside(sPos) )
             sPos = prop->confine_space_ptr->bounce(sPos);
         if ( modulo )
             modulo->fold(sPos);
@@ -142,6 +146,20 @@ void Single::stepA()
     sHand->stepUnloaded();
 }
 
+/**
+ This is true for a Single without force, with a Hand of the basic class,
+ for which stepA() calls Hand::testDetachment() and does nothing else.
+ */
+bool Single::schedulable() const
+{
+#if NEW_MOBILE_SINGLE
+    return false;
+#else
+    return !hasForce() && sHand->prop->activity == "bind";
+#endif
+}
+
+
 /**
  Add confinement force to the bound fiber
  */
@@ -10,6 +10,7 @@
 #include "mecapoint.h"
 #include "single_prop.h"
 #include "hand.h"
+#include "slab.h"
 
 
 class Fiber;
@@ -45,8 +46,16 @@ class PointDisp;
 
 class Single : public Object, public HandMonitor
 {
+    friend class SingleSet;
+    
+    /// to call afterAttachment() and beforeDetachment() without virtual call
+    friend class Hand;
+    
 private:
     
+    /// step at which the Hand is scheduled to detach, or zero if the Single is stepped normally
+    size_t    sDue;
+    
     /// specialization of HandMonitor
     void      afterAttachment(Hand const*);
     /// specialization of HandMonitor
@@ -79,6 +88,15 @@ public:
     /// destructor
     virtual ~Single();
     
+    /// memory of the Singles, which are allocated and deleted frequently
+    static thread_local Slab slab;
+    
+    /// allocate from `slab`
+    static void* operator new(size_t s) { return slab.allocate(s); }
+    
+    /// return memory to `slab`
+    static void operator delete(void* p, size_t s) { slab.release(p, s); }
+    
     //--------------------------------------------------------------------------
     
     /// associated Hand
@@ -157,6 +175,9 @@ public:
     /// Monte-Carlo step if the Hand is attached
     virtual void    stepA();
     
+    /// true if stepA() only counts down to the spontaneous detachment of the Hand
+    bool            schedulable() const;
+    
     /// add interactions to a Meca
     virtual void    setInteractions(Meca &) const;
     
@@ -72,9 +72,26 @@ public:
      - 3: attach Single only near the edge of the Space.
      .
 
+     With `fast_diffusion = 1`, the concentration of free Singles can be made
+     non-uniform with `fast_diffusion_field` (see below).
      */
     int          fast_diffusion;
     
+    /// name of a Field giving the spatial distribution of the free Singles with `fast_diffusion = 1`
+    /**
+     If this is set, the free Singles are assumed to be distributed in proportion to
+     the values of the Field, instead of uniformly over the Space. The total number of
+     free Singles is kept, and the local concentration at position X is:
+     
+         count * field(X) / ( sum_of_field_values * cell_volume )
+     
+     The attachment sites are drawn for the highest concentration, and kept with a
+     probability equal to the ratio between the value of the field and its maximum.
+     Negative values are treated as zero.
+     <em>default value = none</em>
+     */
+    std::string  fast_diffusion_field;
+    
 #if NEW_MOBILE_SINGLE
     /// constant drift
     Vector       speed;
@@ -1,12 +1,14 @@
 // Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
 #include "single_set.h"
 #include "single_prop.h"
+#include "simul_prop.h"
 #include "glossary.h"
 #include "iowrapper.h"
 
 #include "simul.h"
 #include "wrist.h"
 #include "wrist_long.h"
+#include "field.h"
 
 //------------------------------------------------------------------------------
 /**
@@ -45,17 +47,41 @@ void SingleSet::step()
     //Cytosim::log("SingleSet::step entry : F %5i A %5i\n", fList.size(), aList.size());
     
     
+    ++stepCount;
+    if ( simul.prop->detach_queue )
+    {
+        detachDue();
+    }
+    else if ( !queue.empty() )
+        unschedule();
+    
     Single *const fHead = firstF();
     Single * obj, * nxt;
     
-    obj = firstA();
-    while ( obj )
+    if ( simul.prop->detach_queue )
     {
-        nxt = obj->next();
-        obj->stepA();
-        if ( ! nxt ) break;
-        obj = nxt->next();
-        nxt->stepA();
+        // the scheduled Singles are at the end of the list:
+        obj = firstA();
+        while ( obj && !obj->sDue )
+        {
+            nxt = obj->next();
+            obj->stepA();
+            if ( obj->attached() && obj->schedulable() )
+                schedule(obj);
+            obj = nxt;
+        }
+    }
+    else
+    {
+        obj = firstA();
+        while ( obj )
+        {
+            nxt = obj->next();
+            obj->stepA();
+            if ( ! nxt ) break;
+            obj = nxt->next();
+            nxt->stepA();
+        }
     }
     
     obj = fHead;
@@ -70,6 +96,79 @@ void SingleSet::step()
 }
 
 
+/**
+ The Hand was just stepped, and will detach after `n` more calls to testDetachment(),
+ which would be made at the steps `stepCount+1` to `stepCount+n`.
+ */
+void SingleSet::schedule(Single * obj)
+{
+    const real n = std::ceil(obj->hand()->detachmentSteps());
+    
+    if ( n < (real)( SIZE_MAX / 2 ) )
+    {
+        obj->sDue = stepCount + (size_t)std::max(real(1), n);
+        queue.push(Event{obj->sDue, obj->identity()});
+    }
+    else
+    {
+        // the Hand will not detach spontaneously:
+        obj->sDue = SIZE_MAX;
+    }
+    aList.pop(obj);
+    aList.push_back(obj);
+}
+
+
+void SingleSet::detachDue()
+{
+    while ( !queue.empty() && queue.top().due <= stepCount )
+    {
+        Event e = queue.top();
+        queue.pop();
+        Single * obj = findID(e.id);
+        if ( obj && obj->sDue == e.due && obj->attached() )
+            obj->detach();
+    }
+}
+
+
+/**
+ This restores the Gillespie counters of the Hands, and the normal order of the lists
+ */
+void SingleSet::unschedule()
+{
+    Single * obj = firstA();
+    while ( obj )
+    {
+        Single * nxt = obj->next();
+        if ( obj->sDue )
+        {
+            if ( obj->sDue < SIZE_MAX )
+                obj->hand()->detachmentSteps(real(obj->sDue - stepCount) + 1);
+            obj->sDue = 0;
+        }
+        obj = nxt;
+    }
+    queue = decltype(queue)();
+}
+
+
+void SingleSet::sortScheduled()
+{
+    size_t cnt = aList.size();
+    Single * obj = firstA();
+    for ( size_t i = 0; i < cnt; ++i )
+    {
+        Single * nxt = obj->next();
+        if ( obj->sDue )
+        {
+            aList.pop(obj);
+            aList.push_back(obj);
+        }
+        obj = nxt;
+    }
+}
+
 //------------------------------------------------------------------------------
 #pragma mark -
 
@@ -173,6 +272,7 @@ ObjectList SingleSet::newObjects(const std::string& name, Glossary& opt)
 
 void SingleSet::relinkA(Single * obj)
 {
+    obj->sDue = 0;
     fList.pop(obj);
     aList.push_front(obj);
 }
@@ -180,6 +280,7 @@ void SingleSet::relinkA(Single * obj)
 
 void SingleSet::relinkD(Single * obj)
 {
+    obj->sDue = 0;
     aList.pop(obj);
     fList.push_front(obj);
 }
@@ -227,10 +328,38 @@ void SingleSet::foldPositions(Modulo const* m) const
 }
 
 
+/**
+ The groups, and the Singles within each group, are in random order.
+ This improves the locality of memory accesses in step().
+ */
+void SingleSet::sortLists()
+{
+    const uint32_t salt = RNG.pint32() | 1;
+    std::vector<unsigned long long> key(aList.size());
+    
+    for ( size_t i = 0; i < aList.size(); ++i )
+        key[i] = sortKey(static_cast<Single*>(aList.node(i))->fiber()->identity(), salt);
+    aList.sort_keys(key.data());
+    
+    sortByCell(fList, salt);
+}
+
+
 void SingleSet::shuffle()
 {
-    aList.shuffle();
-    fList.shuffle();
+    if ( sortNow() )
+    {
+        sortLists();
+        if ( !queue.empty() )
+            sortScheduled();
+    }
+    else if ( mixNow() )
+    {
+        mix(aList);
+        mix(fList);
+        if ( !queue.empty() )
+            sortScheduled();
+    }
 }
 
 
@@ -240,6 +369,7 @@ void SingleSet::erase()
     ObjectSet::erase(fList);
     ObjectSet::erase(aList);
     inventory.clear();
+    queue = decltype(queue)();
 }
 
 
@@ -573,7 +703,7 @@ void SingleSet::uniAttach(FiberSet const& fibers)
                 real dis = vol / ( cnt * p->hand_prop->bindingSectionRate() );
                 fibers.newFiberSitesP(loc, dis);
             }
-            else
+            else if ( !uniFieldSites(loc, fibers, p, cnt) )
             {
                 real dis = vol / ( cnt * p->hand_prop->bindingSectionProb() );
                 fibers.uniFiberSites(loc, dis);
@@ -585,6 +715,56 @@ void SingleSet::uniAttach(FiberSet const& fibers)
 }
 
 
+/**
+ Set sites for the attachment of `cnt` Singles distributed in proportion to the
+ values of the Field specified by single:fast_diffusion_field.
+ The sites are first drawn uniformly on the fibers for the maximum concentration,
+ and each site is then kept with a probability set by the local value of the Field.
+ Returns false if no Field is specified, or if it does not contain positive values.
+ */
+bool SingleSet::uniFieldSites(Array<FiberSite>& loc, FiberSet const& fibers,
+                              SingleProp const* p, size_t cnt) const
+{
+    if ( p->fast_diffusion_field.empty() )
+        return false;
+    
+    Field const* fld = nullptr;
+    for ( Field const* f = simul.fields.first(); f; f = f->next() )
+    {
+        if ( f->prop->name() == p->fast_diffusion_field )
+        {
+            fld = f;
+            break;
+        }
+    }
+    if ( !fld )
+        throw InvalidParameter("unknown single:fast_diffusion_field `"+p->fast_diffusion_field+"'");
+    if ( !fld->hasField() )
+        return false;
+    
+    Field::value_type sum, low, top;
+    fld->infoValues(sum, low, top);
+    const real high = top;
+    if ( high <= 0 || (real)sum <= 0 )
+        return false;
+    
+    // highest concentration = cnt * high / ( sum * cellVolume )
+    real dis = (real)sum * fld->cellVolume() / ( cnt * high * p->hand_prop->bindingSectionProb() );
+    fibers.uniFiberSites(loc, dis);
+    
+    // keep each site with probability field / high:
+    size_t n = 0;
+    for ( size_t i = 0; i < loc.size(); ++i )
+    {
+        const real val = fld->cell(loc[i].pos());
+        if ( RNG.preal() * high < val )
+            loc[n++] = loc[i];
+    }
+    loc.truncate(n);
+    return true;
+}
+
+
 /**
  
  Return true if at least one single:fast_diffusion is true,
@@ -4,6 +4,8 @@
 
 #include "object_set.h"
 #include "single.h"
+#include <queue>
+#include <cstdint>
 
 
 /// a list of pointers to Single
@@ -22,6 +24,12 @@ typedef Array<Single *> SingleList;
  
  A Single is automatically transfered to the appropriate list,
  if its Hand binds or unbinds. This is done by the HandMonitor.
+ 
+ With `simul:detach_queue`, the attached Singles for which Single::schedulable()
+ is true are placed at the end of aList after their first step, and are not stepped
+ anymore. The step at which their Hand will detach is recorded in a priority queue.
+ The entries of the queue refer to the Singles by identity, and an entry is ignored
+ if the Single was deleted or has detached in the mean time.
  */
 class SingleSet: public ObjectSet
 {
@@ -56,13 +64,45 @@ private:
     /// couple:fast_diffusion attachment algorithm; assumes free Singles are uniformly distributed
     void          uniAttach(FiberSet const&);
     
+    /// attachment sites for `cnt` Singles distributed according to the given Field
+    bool          uniFieldSites(Array<FiberSite>&, FiberSet const&, SingleProp const*, size_t cnt) const;
+    
     /// return Couples in uniLists to the normal lists
     void          uniRelax();
+    
+    /// a scheduled detachment
+    struct Event
+    {
+        size_t   due;
+        ObjectID id;
+        bool operator > (Event const& e) const { return due > e.due; }
+    };
+    
+    /// scheduled detachments, with the earliest on top
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> queue;
+    
+    /// number of calls to step()
+    size_t        stepCount;
+    
+    /// schedule the detachment of an attached Single, and move it to the end of aList
+    void          schedule(Single *);
+    
+    /// detach the Hands that are due
+    void          detachDue();
+    
+    /// return all scheduled Singles to normal stepping
+    void          unschedule();
+    
+    /// move the scheduled Singles to the end of aList
+    void          sortScheduled();
+    
+    /// group the attached Singles by Fiber, and the free ones by cell of the FiberGrid
+    void          sortLists();
 
 public:
         
     ///creator
-    SingleSet(Simul& s) : ObjectSet(s) {}
+    SingleSet(Simul& s) : ObjectSet(s), uni(false), stepCount(0) {}
     
     //--------------------------
 
@@ -149,6 +189,9 @@ public:
     
     /// mix order of elements
     void          shuffle();
+    
+    /// reverse order of elements
+    void          reverse() { fList.reverse(); aList.reverse(); }
 
     /// prepare for step()
     void          prepare(PropertyList const& properties);
@@ -5,12 +5,15 @@
 #include "modulo.h"
 
 
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 
 Picket::Picket(SingleProp const* p, Vector const& w)
-: Single(p, w)
+: Single(p, w), pCell(0), pStamp(0)
 {
+    pQueue = ( p->hand_prop->activity != "nucleate" );
+    // Picket::beforeDetachment() must be called virtually:
+    monitorKind(MONITOR_ANY);
 #if ( 0 )
     if ( p->diffusion > 0 )
         throw InvalidParameter("single:diffusion cannot be > 0 if activity=fixed");
@@ -34,11 +37,30 @@ void Picket::beforeDetachment(Hand const*)
 }
 
 
+/**
+ Since the Picket does not move, the index of its cell in the FiberGrid is
+ calculated once, and the attachment is only attempted if this cell contains
+ some fiber segments. Random numbers are only used for the non-empty cells,
+ and the results are thus the same as calling Hand::stepUnattached().
+ */
 void Picket::stepF(Simul& sim)
 {
     assert_false( sHand->attached() );
 
-    sHand->stepUnattached(sim, sPos);
+    if ( pQueue )
+    {
+        FiberGrid& grid = sim.fiberGrid;
+        if ( pStamp != grid.stamp() || pCellPos != sPos )
+        {
+            pCell = grid.cellIndex(sPos);
+            pCellPos = sPos;
+            pStamp = grid.stamp();
+        }
+        if ( !grid.emptyCell(pCell) )
+            grid.queueAttach(pCell, sPos, *sHand);
+    }
+    else
+        sHand->stepUnattached(sim, sPos);
 }
 
 
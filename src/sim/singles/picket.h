@@ -17,6 +17,18 @@ class Picket : public Single
 {
 public:
     
+    /// index of the FiberGrid cell containing sPos
+    unsigned pCell;
+    
+    /// FiberGrid::stamp() when `pCell` was calculated, or 0
+    unsigned pStamp;
+    
+    /// position for which `pCell` was calculated
+    Vector   pCellPos;
+    
+    /// true if the Hand uses the default Hand::stepUnattached()
+    bool     pQueue;
+
     /// sPos should never change
     void    beforeDetachment(Hand const*);
     /// stiffness of the interaction
@@ -5,7 +5,7 @@
 #include "modulo.h"
 
 
-extern Modulo const* modulo;
+extern thread_local Modulo const* modulo;
 
 
 Wrist::Wrist(SingleProp const* sp, Mecable const* mec, const unsigned pti)
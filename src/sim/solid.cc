@@ -12,6 +12,7 @@
 #include "simul.h"
 #include "space.h"
 #include "wrist.h"
+#include "small_array.h"
 
 #if ( DIM >= 3 )
 #   include "quaternion.h"
@@ -56,32 +57,20 @@ void Solid::setInteractions(Meca & meca) const
         switch ( prop->confine )
         {
             case CONFINE_INSIDE:
-                for ( unsigned i = 0; i < nPoints; ++i )
-                {
-                    const real rad = soRadius[i];
-                    // confine all massive points:
-                    if ( rad > 0 )
-                    {
-                        Vector pos = posP(i);
-                        if ( ! spc->inside(pos) )
-                            spc->setInteraction(pos, Mecapoint(this, i), meca, prop->confine_stiffness);
-                    }
-                }
-                break;
-                
             case CONFINE_OUTSIDE:
+            {
+                // test all the points with one call:
+                SmallArray<bool, 64> ins;
+                ins.resize(nPoints);
+                spc->insideMany(pPos, nPoints, ins.data());
+                const bool out = ( prop->confine == CONFINE_OUTSIDE );
                 for ( unsigned i = 0; i < nPoints; ++i )
                 {
-                    const real rad = soRadius[i];
                     // confine all massive points:
-                    if ( rad > 0 )
-                    {
-                        Vector pos = posP(i);
-                        if ( spc->inside(pos) )
-                            spc->setInteraction(pos, Mecapoint(this, i), meca, prop->confine_stiffness);
-                    }
+                    if ( soRadius[i] > 0 && ins[i] == out )
+                        spc->setInteraction(posP(i), Mecapoint(this, i), meca, prop->confine_stiffness);
                 }
-                break;
+            } break;
                 
             case CONFINE_ALL_INSIDE:
                 for ( unsigned i = 0; i < nPoints; ++i )
@@ -954,13 +943,25 @@ void Solid::makeProjection()
 {
 }
 
-void Solid::projectForces(const real* X, real* Y) const
+void Solid::rigidVelocity(const real* X, real* V) const
 {
     real T = 0;
     for ( unsigned p = 0; p < nPoints; ++p )
         T += X[p];
     
-    T *= 1.0 / ( prop->viscosity * soDrag );
+    V[0] = T / ( prop->viscosity * soDrag );
+}
+
+void Solid::addRigidMotion(const real* V, real* Y) const
+{
+    for ( unsigned p = 0; p < nPoints; ++p )
+        Y[p] += V[0];
+}
+
+void Solid::projectForces(const real* X, real* Y) const
+{
+    real T;
+    rigidVelocity(X, &T);
     
     for ( unsigned p = 0; p < nPoints; ++p )
         Y[p] = T;
@@ -1006,7 +1007,7 @@ void Solid::makeProjection()
 }
 
 
-void Solid::projectForces(const real* X, real* Y) const
+void Solid::rigidVelocity(const real* X, real* V) const
 {
     Vector T(0.0,0.0);  // Translation
     real R = 0;         // Infinitesimal Rotation (a vector in Z)
@@ -1028,13 +1029,37 @@ void Solid::projectForces(const real* X, real* Y) const
     R = A * ( R + cross(T,soCenter) );
     T = B * T + cross(soCenter,R);
     
+    V[0] = T.XX;
+    V[1] = T.YY;
+    V[2] = R;
+}
+
+
+void Solid::addRigidMotion(const real* V, real* Y) const
+{
+    for ( unsigned p = 0; p < nPoints; ++p )
+    {
+        real const* pos = pPos + DIM * p;
+        real * yyy = Y + DIM * p;
+        
+        yyy[0] += V[0] - V[2] * pos[1];
+        yyy[1] += V[1] + V[2] * pos[0];
+    }
+}
+
+
+void Solid::projectForces(const real* X, real* Y) const
+{
+    real V[3];
+    rigidVelocity(X, V);
+    
     for ( unsigned p = 0; p < nPoints; ++p )
     {
         real const* pos = pPos + DIM * p;
         real * yyy = Y + DIM * p;
         
-        yyy[0] = T.XX - R * pos[1];
-        yyy[1] = T.YY + R * pos[0];
+        yyy[0] = V[0] - V[2] * pos[1];
+        yyy[1] = V[1] + V[2] * pos[0];
     }
 }
 
@@ -1111,14 +1136,11 @@ void Solid::makeProjection()
 
 
 /**
- This calculated Y <- P * X, where
- P is the projection associated with the constraints of motion without
- deformation (solid object)
- 
  This calculates the total force and momentum in the center of mobility,
- scale to get speed, and distribute according to solid motion mechanics.
+ and scale them to get the speeds of translation and rotation,
+ which are stored in V = { T, R }.
 */
-void Solid::projectForces(const real* X, real* Y) const
+void Solid::rigidVelocity(const real* X, real* V) const
 {
     Vector T(0,0,0);    //Translation
     Vector R(0,0,0);    //Rotation
@@ -1139,16 +1161,54 @@ void Solid::projectForces(const real* X, real* Y) const
         R.ZZ += pos[0] * xxx[1] - pos[1] * xxx[0];
     }
     
-    Vector V = R + cross(T, soCenter);
+    Vector W = R + cross(T, soCenter);
     
     const real A = 1.0 / ( prop->viscosity );
     const real B = 1.0 / ( prop->viscosity * soDrag );
 
-    R = A * ( soMomentum * V );
+    R = A * ( soMomentum * W );
 
     // reduce Torque to center of mobility:
     T = B * T + cross(soCenter, R);
     
+    T.store(V);
+    R.store(V+3);
+}
+
+
+/**
+ Y <- Y + T + cross(R, pos), for V = { T, R }
+ */
+void Solid::addRigidMotion(const real* V, real* Y) const
+{
+    const Vector T(V), R(V+3);
+    
+    for ( unsigned p = 0; p < nPoints; ++p )
+    {
+        real const* pos = pPos + DIM * p;
+        real * yyy = Y + DIM * p;
+        
+        yyy[0] += T.XX + R.YY * pos[2] - R.ZZ * pos[1];
+        yyy[1] += T.YY + R.ZZ * pos[0] - R.XX * pos[2];
+        yyy[2] += T.ZZ + R.XX * pos[1] - R.YY * pos[0];
+    }
+}
+
+
+/**
+ This calculated Y <- P * X, where
+ P is the projection associated with the constraints of motion without
+ deformation (solid object)
+ 
+ This calculates the total force and momentum in the center of mobility,
+ scale to get speed, and distribute according to solid motion mechanics.
+*/
+void Solid::projectForces(const real* X, real* Y) const
+{
+    real V[6];
+    rigidVelocity(X, V);
+    const Vector T(V), R(V+3);
+    
     for ( unsigned p = 0; p < nPoints; ++p )
     {
         real const* pos = pPos + DIM * p;
@@ -1176,6 +1236,14 @@ void Solid::write(Outputter& out) const
         out.writeSoftSpace(2);
         out.writeFloat(soRadius[p]);
     }
+    // a checkpoint also records the reference shape, and when it is applied next:
+    if ( out.precise() )
+    {
+        out.writeUInt16(soShapeSize);
+        out.writeDoubles(soShape, DIM*soShapeSize, '\n');
+        out.writeDouble(soShapeSqr);
+        out.writeUInt16(soReshapeTimer);
+    }
 }
 
 
@@ -1190,6 +1258,18 @@ void Solid::read(Inputter& in, Simul&, ObjectTag)
             in.readFloats(pPos+DIM*i, DIM);
             soRadius[i] = in.readFloat();
         }
+        if ( in.precise() )
+        {
+            unsigned nbs = in.readUInt16();
+            if ( nbs > nbp )
+                throw InvalidIO("invalid Solid shape");
+            soShapeSize = nbs;
+            for ( unsigned i = 0; i < DIM * nbs; ++i )
+                soShape[i] = in.readDouble();
+            soShapeSqr = in.readDouble();
+            soReshapeTimer = in.readUInt16();
+            return;
+        }
     }
     catch( Exception & e )
     {
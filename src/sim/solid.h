@@ -124,6 +124,15 @@ public:
     /// calculates the speed of points in Y, for the forces given in X
     void        projectForces(const real* X, real* Y) const;
     
+    /// number of generalized velocities: translation and rotation
+    unsigned    rigidRank() const { return ( nPoints < 2 ) ? 0 : ( DIM == 3 ? 6 : ( DIM == 2 ? 3 : 1 )); }
+    
+    /// calculates the speed of translation and rotation (in this order) for the forces given in X
+    void        rigidVelocity(const real* X, real* V) const;
+    
+    /// adds the speed of the points resulting from the translation and rotation V
+    void        addRigidMotion(const real* V, real* Y) const;
+    
     /// add contribution of Brownian forces
     real        addBrownianForces(real const* rnd, real sc, real* rhs) const;
     
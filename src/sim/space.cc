@@ -8,10 +8,12 @@
 #include "messages.h"
 #include "iowrapper.h"
 #include "meca.h"
+#include <cstdio>
+#include <cstdlib>
 
 
 Space::Space(SpaceProp const* p) 
-: prop(p)
+: sMapLimit(0), prop(p)
 {
     assert_true(prop);
 }
@@ -138,6 +140,16 @@ bool Space::allOutside(Vector const& cen, const real rad) const
     return ( distanceToEdgeSqr(cen) >= rad * rad );
 }
 
+/**
+ This calls isInside() for each position. Shapes with a simple inside() test
+ implement this function with a loop that can be vectorized by the compiler.
+ */
+void Space::insideMany(const real pos[], size_t cnt, bool res[]) const
+{
+    for ( size_t i = 0; i < cnt; ++i )
+        res[i] = isInside(Vector(pos+DIM*i));
+}
+
 //------------------------------------------------------------------------------
 #pragma mark - Project
 
@@ -329,6 +341,82 @@ real  Space::signedDistanceToEdge(Vector const& pos) const
 }
 
 
+//------------------------------------------------------------------------------
+#pragma mark - Distance Map
+
+/**
+ The Space is identified by the data that write() would save to file, together
+ with its boundaries and volume, to avoid calculating the same map at every `run`.
+ 
+ The signed distance to the edge is a 1-Lipschitz function of position,
+ and its sign is therefore constant within a cell if the value at the center of
+ the cell exceeds the distance from the center to the corners of the cell.
+ Values smaller than the full diagonal of the cell are not used, which is twice
+ this bound, such that an approximate projection does not affect the results.
+ */
+void Space::prepareMap()
+{
+    const real h = prop->distance_map;
+    if ( h <= 0 )
+    {
+        sMap.destroy();
+        sMapKey.clear();
+        return;
+    }
+
+    std::string key = std::to_string(h);
+    char * buf = nullptr;
+    size_t len = 0;
+    FILE * mem = open_memstream(&buf, &len);
+    if ( mem )
+    {
+        Outputter out(mem, true);
+        write(out);
+        out.close();
+        key.append(buf, len);
+    }
+    free(buf);
+    Vector inf, sup;
+    boundaries(inf, sup);
+    char str[256];
+    snprintf(str, sizeof(str), " %a %a %a %a %a %a %a", inf.x(), inf.y(), inf.z(), sup.x(), sup.y(), sup.z(), volume());
+    key.append(str);
+    if ( sMap.hasCells() && key == sMapKey )
+        return;
+
+    int size[3] = { 1, 1, 1 };
+    for ( int d = 0; d < DIM; ++d )
+    {
+        // cover the Space with one cell to spare on each side:
+        size[d] = 2 + (int)std::ceil(( sup[d] - inf[d] ) / h);
+        real mid = 0.5 * ( inf[d] + sup[d] );
+        inf[d] = mid - 0.5 * h * size[d];
+        sup[d] = mid + 0.5 * h * size[d];
+    }
+    sMap.destroy();
+    sMap.setDimensions(inf, sup, size);
+    sMap.createCells();
+    
+    try {
+        for ( size_t c = 0; c < sMap.nbCells(); ++c )
+        {
+            Vector pos;
+            sMap.setPositionFromIndex(pos, c, 0.5);
+            sMap.icell(c) = (float)signedDistanceToEdge(pos);
+        }
+    }
+    catch( Exception & e )
+    {
+        sMap.destroy();
+        sMapKey.clear();
+        Cytosim::warn << "space:distance_map ignored for `" << prop->name() << "': " << e.what() << '\n';
+        return;
+    }
+    sMapLimit = sMap.diagonalLength();
+    sMapKey = key;
+    Cytosim::log << "space `" << prop->name() << "' has a distance map of " << sMap.nbCells() << " cells\n";
+}
+
 //------------------------------------------------------------------------------
 #pragma mark - Interactions
 
@@ -11,6 +11,7 @@
 #include "object.h"
 #include "common.h"
 #include "modulo.h"
+#include "grid.h"
 #include "space_prop.h"
 
 
@@ -34,6 +35,17 @@ The edges are considered to be inside.
 */
 class Space : public Object
 {
+private:
+    
+    /// signed distance to the edge at the center of each cell (see space:distance_map)
+    Grid<float, DIM> sMap;
+    
+    /// values of `sMap` closer to zero than this are not used
+    real        sMapLimit;
+    
+    /// description of the Space for which `sMap` was calculated
+    std::string sMapKey;
+    
 protected:
     
     /// read numbers from file
@@ -79,6 +91,9 @@ public:
     /// true if `point` is inside or on the edge of this Space
     virtual bool   inside(Vector const&) const { return true; }
     
+    /// set `res[i]` for the `cnt` positions stored contiguously in `pos`, with DIM values each
+    virtual void   insideMany(const real pos[], size_t cnt, bool res[]) const;
+    
     /// set `proj` as the point on the edge that is closest to `point`
     /*
      If the edge is a smooth surface, this should correspond to the usual orthogonal projection.
@@ -107,8 +122,20 @@ public:
     /// returns the maximum absolute value of any coordinate
     real           max_extension() const;
 
-    /// true if `point` is outside this Space ( defined as !inside(point) )
-    bool           outside(Vector const& pos)  const { return ! inside(pos); }
+    /// true if `point` is inside, calling inside() only if the distance map cannot tell
+    bool           isInside(Vector const& pos) const
+    {
+        if ( sMap.hasCells() && sMap.inside(pos) )
+        {
+            const real d = sMap.cell(pos);
+            if ( abs_real(d) > sMapLimit )
+                return ( d < 0 );
+        }
+        return inside(pos);
+    }
+    
+    /// true if `point` is outside this Space ( defined as !isInside(point) )
+    bool           outside(Vector const& pos)  const { return ! isInside(pos); }
     
     /// project `point` on this Space deflated by `radius`, putting the result in `proj`
     Vector         projectDeflated(Vector const&, real rad) const;
@@ -144,6 +171,12 @@ public:
 
     //------------------------------ SIMULATION ---------------------------------
     
+    /// calculate the distance map if `space:distance_map > 0` and the Space has changed
+    void           prepareMap();
+    
+    /// grid of signed distances used by isInside()
+    Grid<float, DIM> const& distanceMap() const { return sMap; }
+    
     /// one Monte-Carlo simulation step
     virtual void   step() {}
     
@@ -155,6 +155,7 @@ Space * SpaceProp::newSpace(Glossary& opt) const
 void SpaceProp::clear()
 {
     shape         = "";
+    distance_map  = 0;
     display       = "";
     display_fresh = false;
 }
@@ -181,6 +182,8 @@ void SpaceProp::read(Glossary& glos)
 #endif
     }
     
+    glos.set(distance_map, "distance_map");
+
     if ( glos.set(display, "display") )
         display_fresh = true;
 }
@@ -191,6 +194,9 @@ void SpaceProp::complete(Simul const& sim)
 {
     if ( shape.empty() )
         throw InvalidParameter("space:shape must be defined");
+
+    if ( distance_map < 0 )
+        throw InvalidParameter("space:distance_map must be >= 0");
 }
 
 //------------------------------------------------------------------------------
@@ -199,6 +205,7 @@ void SpaceProp::write_values(std::ostream& os) const
 {
     //write_value(os, "geometry",   geometry);
     write_value(os, "shape",      shape);
+    write_value(os, "distance_map", distance_map);
     write_value(os, "display",    "("+display+")");
 }
 
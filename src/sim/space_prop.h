@@ -32,6 +32,18 @@ public:
     /// primitive (e.g. `rectangle`)
     std::string  shape;
     
+    /// if > 0, width of the cells of a grid storing the distance to the edge
+    /**
+     The signed distance to the edge is calculated at the center of each cell
+     of a grid covering the Space, when a `run` starts.
+     A position is then found inside or outside from the value of its cell,
+     and inside() is only called near the edge, where this value is too small.
+     This helps with shapes for which inside() is expensive, such as `polygon`,
+     `banana`, `torus` or `ellipse`, that confine many fibers or couples.
+     The grid is calculated again only if the dimensions of the Space changed.
+     */
+    real         distance_map;
+    
     /// display string (see @ref PointDispPar)
     std::string  display;
     
@@ -11,14 +11,13 @@
 
 /**
  This is a global variable that is initialized in Simul
- It is used to implement periodic boundary conditions
+ It is used to implement periodic boundary conditions.
+ It is local to each thread, such that simulations running in different
+ threads can have different boundary conditions (see Simul::prepare)
  */
-Modulo const* modulo = nullptr;
+thread_local Modulo const* modulo = nullptr;
 
 
-/// static variable of SpaceSet:
-Space const* SpaceSet::master_ = nullptr;
-
 /**
  set current Space to `spc`. (spc==NULL is a valid argument).
  */
@@ -52,6 +51,13 @@ Property * SpaceSet::newProperty(const std::string& cat,const std::string& nom,
 }
 
 
+void SpaceSet::prepare()
+{
+    for ( Space * sp = first(); sp; sp=sp->next() )
+        sp->prepareMap();
+}
+
+
 void SpaceSet::step()
 {
     for ( Space * sp = first(); sp; sp=sp->next() )
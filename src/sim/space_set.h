@@ -9,19 +9,19 @@ class Simul;
 ///a list of Space
 class SpaceSet : public ObjectSet
 {
-    /// the master space
-    static Space const* master_;
+    /// the master space of this simulation
+    Space const* master_;
 
 public:
 
     /// return master
-    static Space const* master() { return master_; }
+    Space const* master() const { return master_; }
 
     /// change master
     void setMaster(Space const* s);
 
     /// constructor
-    SpaceSet(Simul& s) : ObjectSet(s) {}
+    SpaceSet(Simul& s) : ObjectSet(s), master_(nullptr) {}
     
     //--------------------------
     
@@ -54,6 +54,9 @@ public:
     /// erase all Object and all Property
     void erase();
     
+    /// calculate the distance maps of the Spaces (see space:distance_map)
+    void prepare();
+    
     /// Monte-Carlo step for every Space
     void step();
     
@@ -59,9 +59,7 @@ void SpaceBanana::update()
     bEnd[0] = bRadius * sin(bAngle);
     bEnd[1] = 0.5*bRadius*(1-cos(bAngle));
     
-    bCenter[0] = 0;
-    bCenter[1] = bRadius - bEnd[1];
-    bCenter[2] = 0;
+    bCenter.set(0, bRadius - bEnd[1], 0);
 }
 
 
@@ -61,6 +61,19 @@ bool SpaceCapsule::inside(Vector const& w) const
 }
 
 
+void SpaceCapsule::insideMany(const real pos[], size_t cnt, bool res[]) const
+{
+    for ( size_t i = 0; i < cnt; ++i )
+    {
+        real n = 0;
+        for ( int d = 1; d < DIM; ++d )
+            n += pos[DIM*i+d] * pos[DIM*i+d];
+        n += square(std::max((real)0, fabs(pos[DIM*i])-length_));
+        res[i] = ( n <= radiusSqr_ );
+    }
+}
+
+
 bool SpaceCapsule::allInside(Vector const& w, const real rad) const
 {
     assert_true( rad >= 0 );
@@ -64,6 +64,22 @@ bool SpaceCylinder::inside(Vector const& w) const
 }
 
 
+void SpaceCylinder::insideMany(const real pos[], size_t cnt, bool res[]) const
+{
+    for ( size_t i = 0; i < cnt; ++i )
+    {
+#if ( DIM > 2 )
+        const real RT = pos[3*i+1] * pos[3*i+1] + pos[3*i+2] * pos[3*i+2];
+        res[i] = ( fabs(pos[3*i]) < length_ ) & ( RT <= radius_ * radius_ );
+#elif ( DIM > 1 )
+        res[i] = ( fabs(pos[2*i]) < length_ ) & ( fabs(pos[2*i+1]) <= radius_ );
+#else
+        res[i] = false;
+#endif
+    }
+}
+
+
 bool SpaceCylinder::allInside(Vector const& w, const real rad) const
 {
     assert_true( rad >= 0 );
@@ -51,6 +51,9 @@ public:
     /// true if the point is inside the Space
     bool        inside(Vector const&) const;
     
+    /// set `res[i]` for positions `pos[DIM*i]`, in a loop that can be vectorized
+    void        insideMany(const real pos[], size_t cnt, bool res[]) const;
+    
     /// true if the bead is inside the Space
     bool        allInside(Vector const&, real rad) const;
     
@@ -43,6 +43,13 @@ void SpacePeriodic::boundaries(Vector& inf, Vector& sup) const
     sup.set( length_[0], length_[1], length_[2]);
 }
 
+
+void SpacePeriodic::insideMany(const real[], size_t cnt, bool res[]) const
+{
+    for ( size_t i = 0; i < cnt; ++i )
+        res[i] = true;
+}
+
 //------------------------------------------------------------------------------
 #pragma mark -
 
@@ -49,6 +49,9 @@ public:
     /// true if the point is inside the Space
     bool        inside(Vector const&) const;
     
+    /// set `res[i]` for positions `pos[DIM*i]`, in a loop that can be vectorized
+    void        insideMany(const real pos[], size_t cnt, bool res[]) const;
+    
     /// set `proj` as the point on the edge that is closest to `point`
     Vector      project(Vector const& pos) const;
     
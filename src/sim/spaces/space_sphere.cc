@@ -51,6 +51,18 @@ bool SpaceSphere::inside(Vector const& pos) const
     return pos.normSqr() <= radiusSqr_;
 }
 
+
+void SpaceSphere::insideMany(const real pos[], size_t cnt, bool res[]) const
+{
+    for ( size_t i = 0; i < cnt; ++i )
+    {
+        real n = pos[DIM*i] * pos[DIM*i];
+        for ( int d = 1; d < DIM; ++d )
+            n += pos[DIM*i+d] * pos[DIM*i+d];
+        res[i] = ( n <= radiusSqr_ );
+    }
+}
+
 Vector SpaceSphere::project(Vector const& pos) const
 {
     real n = pos.normSqr();
@@ -48,6 +48,9 @@ public:
     /// true if the point is inside the Space
     bool        inside(Vector const&) const;
     
+    /// set `res[i]` for positions `pos[DIM*i]`, in a loop that can be vectorized
+    void        insideMany(const real pos[], size_t cnt, bool res[]) const;
+    
     /// a random position inside the volume
     Vector      randomPlace() const { return Vector::randB(radius_); }
     
@@ -44,6 +44,18 @@ void SpaceSquare::boundaries(Vector& inf, Vector& sup) const
     sup.set( length_[0], length_[1], length_[2]);
 }
 
+
+void SpaceSquare::insideMany(const real pos[], size_t cnt, bool res[]) const
+{
+    for ( size_t i = 0; i < cnt; ++i )
+    {
+        bool in = fabs(pos[DIM*i]) <= length_[0];
+        for ( int d = 1; d < DIM; ++d )
+            in &= fabs(pos[DIM*i+d]) <= length_[d];
+        res[i] = in;
+    }
+}
+
 //------------------------------------------------------------------------------
 #pragma mark - DIM=1
 
@@ -40,6 +40,9 @@ public:
     
     /// true if the point is inside the Space
     bool        inside(Vector const&) const;
+    
+    /// set `res[i]` for positions `pos[DIM*i]`, in a loop that can be vectorized
+    void        insideMany(const real pos[], size_t cnt, bool res[]) const;
 
     /// true if a sphere (center, radius) fits in the space, edges included
     bool        allInside(Vector const&, real rad) const;
@@ -219,7 +219,7 @@ void Sphere::setInteractions(Meca & meca) const
             case CONFINE_INSIDE:
             {
                 Vector cen(pPos);
-                if ( ! spc->inside(cen) )
+                if ( ! spc->isInside(cen) )
                     spc->setInteraction(cen, Mecapoint(this, 0), meca, prop->confine_stiffness);
             } break;
                 
@@ -331,6 +331,7 @@ size_t Sphere::allocateMecable(size_t nbp)
     size_t ms = Mecable::allocateMecable(nbp);
     if ( ms )
     {
+        // one array per dimension, see makeProjection()
         free_real(sRad);
         sRad = new_real(DIM*ms);
     }
@@ -468,27 +469,91 @@ void Sphere::orthogonalize(unsigned i)
 }
 
 
+/**
+ Return true if the reference vectors are not orthogonal and of norm spRadius,
+ within `reshapeTolerance`
+ */
+bool Sphere::frameDrifted() const
+{
+#if ( DIM == 3 )
+    const Vector cen(pPos);
+    const Vector X = posP(1) - cen;
+    const Vector Y = posP(2) - cen;
+    const Vector Z = posP(3) - cen;
+    const real R2 = spRadius * spRadius;
+    real e = std::max(std::abs(dot(X, Y)), std::max(std::abs(dot(Y, Z)), std::abs(dot(Z, X))));
+    e = std::max(e, std::abs(X.normSqr()-R2));
+    e = std::max(e, std::abs(Y.normSqr()-R2));
+    e = std::max(e, std::abs(Z.normSqr()-R2));
+    return e > 2 * reshapeTolerance * R2;
+#elif ( DIM == 2 )
+    const real R2 = spRadius * spRadius;
+    return std::abs(( posP(1) - Vector(pPos) ).normSqr() - R2) > 2 * reshapeTolerance * R2;
+#else
+    return false;
+#endif
+}
+
+
 /**
  we get rid of finite-step errors but conserve the shape
  by projecting back onto the sphere,
- without changing the position of point zero (the center)
+ without changing the position of point zero (the center).
+ 
+ Since the points move tangentially to the surface, their distance to the
+ center only drifts slowly, and only the points that are further than
+ `reshapeTolerance * spRadius` from the surface are moved.
+ This is detected first without square root, and points are rarely moved.
 */
 void Sphere::reshape()
 {
     assert_true( nPoints > 0 );
     assert_true( spRadius > 0 );
-    Vector axis;
-    Vector cen(pPos);
+    const real R2 = spRadius * spRadius;
+    const real tol = 2 * reshapeTolerance * R2;
+    real const* cen = pPos;
     
-    for ( unsigned j = 1; j < nPoints; ++j )
+    // find the largest deviation, in a loop that can be vectorized:
+    real dev = 0;
+    #pragma ivdep
+    for ( unsigned j = nbRefPoints; j < nPoints; ++j )
     {
-        axis = ( posP(j) - cen ).normalized(spRadius);
-        setPoint(j, cen + axis);
+        real const* pos = pPos + DIM * j;
+        real n = 0;
+        for ( int i = 0; i < DIM; ++i )
+            n += ( pos[i] - cen[i] ) * ( pos[i] - cen[i] );
+        dev = std::max(dev, std::abs(n - R2));
     }
     
+    if ( dev > tol )
+    {
+        for ( unsigned j = nbRefPoints; j < nPoints; ++j )
+        {
+            real * pos = pPos + DIM * j;
+            real d[DIM], n = 0;
+            for ( int i = 0; i < DIM; ++i )
+            {
+                d[i] = pos[i] - cen[i];
+                n += d[i] * d[i];
+            }
+            if ( std::abs(n - R2) > tol )
+            {
+                n = spRadius / std::sqrt(n);
+                for ( int i = 0; i < DIM; ++i )
+                    pos[i] = cen[i] + n * d[i];
+            }
+        }
+    }
+    
+    if ( frameDrifted() )
+    {
 #if ( DIM == 3 )
-    orthogonalize(RNG.pint32(3));
+        orthogonalize(RNG.pint32(3));
+#else
+        for ( unsigned j = 1; j < nbRefPoints; ++j )
+            setPoint(j, Vector(cen) + ( posP(j) - Vector(cen) ).normalized(spRadius));
 #endif
+    }
 }
 
 
@@ -505,20 +570,26 @@ void Sphere::projectForces(const real* X, real* Y) const {}
 #else
 
 /**
- prepare variables for the projection 
+ prepare variables for the projection:
+ the radial vectors of the surface points are stored in `sRad`,
+ with one array per dimension, such that projectForces() can be vectorized.
+ They are normalized within `reshapeTolerance`, see reshape()
  */
 void Sphere::makeProjection()
 {
     assert_true( nPoints >= nbRefPoints );
+    const size_t all = allocated();
+    const real curv = 1.0 / spRadius;
+    real const* cen = pPos;
     
-    // calculate radial vectors from center:
-    real curv = 1.0 / spRadius;
-    for ( unsigned p = nbRefPoints; p < nPoints; ++p )
+    for ( int d = 0; d < DIM; ++d )
     {
-        real * ppp = sRad + DIM * p;
-        real * pos = pPos + DIM * p;
-        for ( int d = 0; d < DIM; ++d )
-            ppp[d] = curv * ( pos[d] - pPos[d] );
+        real * rad = sRad + all * d;
+        real const* pos = pPos + d;
+        const real c = cen[d];
+        #pragma ivdep
+        for ( unsigned p = nbRefPoints; p < nPoints; ++p )
+            rad[p] = curv * ( pos[DIM*p] - c );
     }
 }
 
@@ -527,48 +598,49 @@ void Sphere::makeProjection()
 void Sphere::projectForces(const real* X, real* Y) const
 {
     // total force:
-    Vector F(0,0,0);
+    real FX = 0, FY = 0;
     
     // total torque:
-#if   ( DIM == 2 )
-    real T = 0;
+#if ( DIM == 2 )
+    real TZ = 0;
 #elif ( DIM >= 3 )
-    Vector T(0,0,0);
+    real FZ = 0, TX = 0, TY = 0, TZ = 0;
 #endif
     
+    #pragma ivdep
     for ( unsigned p = 0; p < nPoints; ++p )
     {
-        real * pos = pPos + DIM * p;
+        real const* pos = pPos + DIM * p;
         real const* xxx = X + DIM * p;
         
-        F.XX += xxx[0];
-        F.YY += xxx[1];
-#if   ( DIM == 2 )
-        T    += pos[0] * xxx[1] - pos[1] * xxx[0];
-#elif ( DIM >= 3 )
-        F.ZZ += xxx[2];
-        T.XX += pos[1] * xxx[2] - pos[2] * xxx[1];
-        T.YY += pos[2] * xxx[0] - pos[0] * xxx[2];
-        T.ZZ += pos[0] * xxx[1] - pos[1] * xxx[0];
+        FX += xxx[0];
+        FY += xxx[1];
+#if ( DIM >= 3 )
+        FZ += xxx[2];
+        TX += pos[1] * xxx[2] - pos[2] * xxx[1];
+        TY += pos[2] * xxx[0] - pos[0] * xxx[2];
 #endif
+        TZ += pos[0] * xxx[1] - pos[1] * xxx[0];
     }
     
     Vector cen(pPos);
+#if ( DIM == 2 )
+    Vector F(FX, FY);
+    real T = TZ;
+#else
+    Vector F(FX, FY, FZ);
+    Vector T(TX, TY, TZ);
+#endif
 
     T -= cross(cen, F);       // reduce the torque to the center of mass
     T *= 1.0/spDragRot;       // multiply by the mobility
     F  = F*(1.0/spDrag) + cross(cen, T);
     
-    //scale by point mobility:
-    real mob = prop->point_mobility;
-
     for ( unsigned p = 0; p < nbRefPoints; ++p )
     {
         real * yyy = Y + DIM * p;
-        real * pos = pPos + DIM * p;
-
-        for ( int d = 0; d < DIM; ++d )
-#if   ( DIM == 2 )
+        real const* pos = pPos + DIM * p;
+#if ( DIM == 2 )
         yyy[0] = F.XX - T * pos[1];
         yyy[1] = F.YY + T * pos[0];
 #elif ( DIM >= 3 )
@@ -578,21 +650,39 @@ void Sphere::projectForces(const real* X, real* Y) const
 #endif
     }
     
+    //scale by point mobility:
+    const real mob = prop->point_mobility;
+    const size_t all = allocated();
+    real const* RX = sRad;
+    real const* RY = sRad + all;
+#if ( DIM == 2 )
+    const real fx = F.XX, fy = F.YY, tz = T;
+#else
+    real const* RZ = sRad + all * 2;
+    const real fx = F.XX, fy = F.YY, fz = F.ZZ;
+    const real tx = T.XX, ty = T.YY, tz = T.ZZ;
+#endif
+
+    #pragma ivdep
     for ( unsigned p = nbRefPoints; p < nPoints; ++p )
     {
         real * yyy = Y + DIM * p;
-        real * pos = pPos + DIM * p;
-        real * rad = sRad + DIM * p;
+        real const* pos = pPos + DIM * p;
         real const* xxx = X + DIM * p;
-#if   ( DIM == 2 )
-        real a = rad[0] * xxx[0] + rad[1] * xxx[1];
-        yyy[0] = F.XX - T * pos[1] + mob * ( xxx[0] - a * rad[0] );
-        yyy[1] = F.YY + T * pos[0] + mob * ( xxx[1] - a * rad[1] );
+#if ( DIM == 2 )
+        real a = RX[p] * xxx[0] + RY[p] * xxx[1];
+        real y0 = fx - tz * pos[1] + mob * ( xxx[0] - a * RX[p] );
+        real y1 = fy + tz * pos[0] + mob * ( xxx[1] - a * RY[p] );
+        yyy[0] = y0;
+        yyy[1] = y1;
 #elif ( DIM >= 3 )
-        real a = rad[0] * xxx[0] + rad[1] * xxx[1] + rad[2] * xxx[2];
-        yyy[0] = F.XX + T.YY * pos[2] - T.ZZ * pos[1] + mob * ( xxx[0] - a * rad[0] );
-        yyy[1] = F.YY + T.ZZ * pos[0] - T.XX * pos[2] + mob * ( xxx[1] - a * rad[1] );
-        yyy[2] = F.ZZ + T.XX * pos[1] - T.YY * pos[0] + mob * ( xxx[2] - a * rad[2] );
+        real a = RX[p] * xxx[0] + RY[p] * xxx[1] + RZ[p] * xxx[2];
+        real y0 = fx + ty * pos[2] - tz * pos[1] + mob * ( xxx[0] - a * RX[p] );
+        real y1 = fy + tz * pos[0] - tx * pos[2] + mob * ( xxx[1] - a * RY[p] );
+        real y2 = fz + tx * pos[1] - ty * pos[0] + mob * ( xxx[2] - a * RZ[p] );
+        yyy[0] = y0;
+        yyy[1] = y1;
+        yyy[2] = y2;
 #endif
     }
 }
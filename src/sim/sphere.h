@@ -38,6 +38,9 @@ public:
     
     /// number of reference points, including center: 1, 2, 4 for DIM = 1, 2 and 3
     static constexpr unsigned nbRefPoints = DIM+(DIM==3);
+    
+    /// relative distance to the surface above which reshape() moves a point
+    static constexpr real reshapeTolerance = 1e-6;
 
 private:
     
@@ -49,7 +52,7 @@ private:
         
     //--------------------------------------------------------------------------
     
-    /// used for projecting forces
+    /// radial unit vectors of the surface points, with one array per dimension
     real *           sRad;
 
 public:
@@ -114,9 +117,11 @@ public:
     /// add contribution of Brownian forces
     real        addBrownianForces(real const* rnd, real sc, real* rhs) const;
 
-    /// bring all surface points at distance spRadius from center, by moving them radially
+    /// bring the surface points that have drifted back at distance spRadius from center, by moving them radially
     void        reshape();
     
+    /// true if the reference points are not orthonormal, within reshapeTolerance
+    bool        frameDrifted() const;
     
     /// move the reference points such as to restore a orthogonal reference
     void        orthogonalize(unsigned i);
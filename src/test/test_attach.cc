@@ -0,0 +1,245 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+/*
+ Benchmark of the binding engine, FiberGrid::tryToAttach()
+
+ Fibers are placed randomly in a spherical Space, and for every combination
+ of the number of fibers, the grid step and the binding range, `test_attach`:
+ - paints a FiberGrid, as done by Simul::step(),
+ - times `queries` calls to tryToAttach(), from random positions in the Space,
+ - times the same queries done by brute force, checking all segments,
+ - checks that the grid attached exactly from the positions where brute force
+   finds a segment within range,
+ - calls FiberGrid::testAttach() from `verify` random positions, to check that
+   no target is missed, that no segment beyond range is attached, and that
+   all the targets are equiprobable.
+
+ The Hand has an infinite binding rate, such that attachment is certain if
+ any segment is within range. Equiprobability is tested with Pearson's statistic,
+ summed over positions: `chi2/dof` should be close to 1, and `z` is the
+ deviation from this expectation in units of its standard deviation.
+
+     test_attach fibers=100,1000 step=0.25,0.5,1 range=0.05,0.1 queries=100000
+
+ Other parameters: length (of fibers), segmentation, radius (of Space),
+ sparse (binding_grid_sparse), seed, and verify (number of positions).
+*/
+
+#include <cmath>
+#include <vector>
+
+#include "dim.h"
+#include "tictoc.h"
+#include "random.h"
+#include "glossary.h"
+#include "messages.h"
+#include "exceptions.h"
+#include "print_color.h"
+#include "simul.h"
+#include "simul_prop.h"
+#include "hand.h"
+#include "hand_prop.h"
+#include "hand_monitor.h"
+
+
+/// parameters of the benchmark
+struct Setup
+{
+    std::vector<size_t> fibers;
+    std::vector<real> steps;
+    std::vector<real> ranges;
+    real length = 5;
+    real segmentation = 0.5;
+    real radius = 10;
+    bool sparse = false;
+    size_t queries = 100000;
+    size_t verify = 64;
+};
+
+
+/// read all the values of `key` into `vec`, keeping the defaults if none is given
+template < typename T >
+void readList(Glossary& arg, std::string const& key, std::vector<T>& vec)
+{
+    size_t cnt = arg.nb_values(key);
+    if ( cnt > 0 )
+    {
+        vec.resize(cnt);
+        for ( size_t i = 0; i < cnt; ++i )
+            arg.set(vec[i], key, i);
+    }
+}
+
+
+/// return the number of positions from which some segment is within `range`
+size_t bruteForce(FiberSet const& set, std::vector<Vector> const& pos, real range)
+{
+    const real sup = range * range;
+    size_t res = 0;
+    for ( Vector const& w : pos )
+    {
+        bool found = false;
+        for ( Fiber const* fib = set.first(); fib && !found; fib = fib->next() )
+        {
+            for ( unsigned p = 0; p < fib->nbSegments(); ++p )
+            {
+                real dis = INFINITY;
+                FiberSegment(fib, p).projectPoint(w, dis);
+                if ( dis < sup )
+                {
+                    found = true;
+                    break;
+                }
+            }
+        }
+        res += found;
+    }
+    return res;
+}
+
+
+void benchmark(Simul& simul, Setup const& set, real step, real range)
+{
+    Space const* spc = simul.spaces.master();
+    FiberSet const& fibers = simul.fibers;
+
+    HandProp hp("test_binding");
+    hp.binding_rate  = INFINITY;
+    hp.binding_range = range;
+    hp.bind_also_end = BOTH_ENDS;
+    hp.complete(simul);
+
+    FiberGrid grid;
+    grid.setGrid(spc, step);
+    grid.setSparse(set.sparse);
+    grid.createCells();
+
+    double t0 = TicToc::milliseconds();
+    grid.paintGrid(fibers.first(), nullptr, range);
+    double paint = TicToc::milliseconds() - t0;
+
+    std::vector<Vector> pos(set.queries);
+    for ( Vector & w : pos )
+        w = spc->randomPlace();
+
+    HandMonitor hm;
+    Hand ha(&hp, &hm);
+    size_t hits = 0;
+    t0 = TicToc::milliseconds();
+    for ( Vector const& w : pos )
+    {
+        grid.tryToAttach(w, ha);
+        if ( ha.attached() )
+        {
+            ++hits;
+            ha.detach();
+        }
+    }
+    double grd = TicToc::milliseconds() - t0;
+
+    // brute force is slow, and is only applied to a fraction of the positions:
+    std::vector<Vector> sub(pos.begin(), pos.begin()+std::min(pos.size(), 1+pos.size()/16));
+    t0 = TicToc::milliseconds();
+    size_t found = bruteForce(fibers, sub, range);
+    double brt = TicToc::milliseconds() - t0;
+    
+    // with binding_prob = 1, the grid must attach from the same positions:
+    size_t cnt = 0;
+    for ( Vector const& w : sub )
+    {
+        grid.tryToAttach(w, ha);
+        if ( ha.attached() )
+        {
+            ++cnt;
+            ha.detach();
+        }
+    }
+    size_t lost = std::max(found, cnt) - std::min(found, cnt);
+
+    FiberGrid::AttachTest sum;
+    size_t dof = 0;
+    for ( size_t i = 0; i < set.verify; ++i )
+    {
+        FiberGrid::AttachTest res = grid.testAttach(stdout, spc->randomPlace(), fibers, &hp);
+        sum.targets  += res.targets;
+        sum.trials   += res.trials;
+        sum.hits     += res.hits;
+        sum.missed   += res.missed;
+        sum.spurious += res.spurious;
+        sum.chi2     += res.chi2;
+        if ( res.targets > 1 )
+            dof += res.targets - 1;
+    }
+    real chi = dof ? sum.chi2 / dof : 0;
+    real zed = dof ? ( sum.chi2 - dof ) / std::sqrt(2.0*dof) : 0;
+
+    printf("%7lu %6.3f %6.3f %9u %9lu %8.2f %10.0f %10.0f %7.4f %5lu",
+           fibers.size(), step, range, grid.nbCells(), grid.memory()>>10, paint,
+           1000 * pos.size() / grd, 1000 * sub.size() / brt,
+           hits / real(pos.size()), lost);
+    printf(" %7lu %6lu %6lu %7.3f %+6.2f", sum.targets, sum.missed, sum.spurious, chi, zed);
+    if ( lost || sum.missed || sum.spurious || std::abs(zed) > 4 )
+        printf("  FAILED");
+    printf("\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+    Glossary arg;
+    if ( arg.read_strings(argc-1, argv+1) )
+        return EXIT_FAILURE;
+
+    Setup set;
+    set.fibers = { 100, 1000 };
+    set.steps = { 0.25, 0.5, 1 };
+    set.ranges = { 0.05, 0.1 };
+    readList(arg, "fibers", set.fibers);
+    readList(arg, "step", set.steps);
+    readList(arg, "range", set.ranges);
+    arg.set(set.length, "length");
+    arg.set(set.segmentation, "segmentation");
+    arg.set(set.radius, "radius");
+    arg.set(set.sparse, "sparse");
+    arg.set(set.queries, "queries");
+    arg.set(set.verify, "verify");
+    unsigned long seed = 1;
+    arg.set(seed, "seed");
+    if ( arg.has_key("help") || set.queries < 1 )
+    {
+        printf("Syntax: test_attach [fibers=INT,...] [step=REAL,...] [range=REAL,...] [queries=INT]\n");
+        printf("                    [length=REAL] [segmentation=REAL] [radius=REAL] [sparse=0/1] [verify=INT]\n");
+        return EXIT_SUCCESS;
+    }
+    arg.print_warning(std::cerr, 1, " on command line\n");
+    Cytosim::all_silent();
+    RNG.seed(seed);
+
+    printf("Binding engine benchmark in %iD --- %s\n", DIM, __VERSION__);
+    printf("%7s %6s %6s %9s %9s %8s %10s %10s %7s %5s", "fibers", "step", "range",
+           "cells", "memory/kB", "paint/ms", "grid/s", "brute/s", "attach", "lost");
+    printf(" %7s %6s %6s %7s %6s\n", "targets", "missed", "beyond", "chi2/dof", "z");
+
+    for ( size_t nf : set.fibers )
+    {
+        Simul simul;
+        try {
+            char str[512];
+            snprintf(str, sizeof(str), "set simul system { time_step = 0.01; random_seed = %lu; }\n"
+                     "set space cell { shape = sphere; }\n"
+                     "new cell { radius = %.6f; }\n"
+                     "set fiber filament { rigidity = 20; segmentation = %.6f; confine = inside, 100; }\n"
+                     "new %lu filament { length = %.6f; }\n",
+                     seed, set.radius, set.segmentation, nf, set.length);
+            simul.evaluate(str);
+        }
+        catch( Exception & e ) {
+            print_magenta(std::cerr, e.brief());
+            std::cerr << '\n' << e.info() << '\n';
+            return EXIT_FAILURE;
+        }
+        for ( real step : set.steps )
+            for ( real range : set.ranges )
+                benchmark(simul, set, step, range);
+    }
+    return EXIT_SUCCESS;
+}
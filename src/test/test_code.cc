@@ -2,7 +2,9 @@
 
 #include <sys/time.h>
 
-#define DIM 3
+#ifndef DIM
+#  define DIM 3
+#endif
 
 #include "real.h"
 #include "timer.h"
@@ -419,6 +421,76 @@ void add_rigidityF(const unsigned nbt, const real* X, const real R1, real* Y)
 }
 
 
+/// edges of add_rigidityF(), used by the SIMD versions below
+inline void add_rigidity_edges(const unsigned nbt, const real* X, const real R1, real* Y)
+{
+    const real R4 = R1 * 4;
+    const real R2 = R1 * 2;
+    real      * Z = Y + nbt + DIM;
+    real const* E = X + nbt + DIM;
+    #pragma ivdep
+    for ( int d = 0; d < DIM; ++d )
+    {
+        Y[d    ] -= R1 * (X[d+DIM*2]+X[d]) - R2 * X[d+DIM];
+        Y[d+DIM] -= R1 * (X[d+DIM]+X[d+DIM*3]) + R4 * (X[d+DIM]-X[d+DIM*2]) - R2 * X[d];
+        Z[d-DIM] -= R1 * (E[d-DIM]+E[d-DIM*3]) + R4 * (E[d-DIM]-E[d-DIM*2]) - R2 * E[d];
+        Z[d    ] -= R1 * (E[d-DIM*2]+E[d]) - R2 * E[d-DIM];
+    }
+}
+
+#if VEC2_IS_AVAILABLE
+
+/// same as add_rigiditySSE() in mecafil.cc, valid in any dimension
+void add_rigidityFS(const unsigned nbt, const real* X, const real R1, real* Y)
+{
+    const vec2 R1s = set2(R1);
+    const vec2 R4s = set2(R1 * 4);
+    const vec2 R6s = set2(R1 * 6);
+    
+    int i = DIM*2;
+    const int end = nbt;
+    for ( ; i+1 < end; i += 2 )
+    {
+        vec2 s = mul2(R4s, add2(loadu2(X+i-DIM), loadu2(X+i+DIM)));
+        s = sub2(s, mul2(R1s, add2(loadu2(X+i-DIM*2), loadu2(X+i+DIM*2))));
+        s = sub2(s, mul2(R6s, loadu2(X+i)));
+        storeu2(Y+i, add2(loadu2(Y+i), s));
+    }
+    if ( i < end )
+        Y[i] += R1 * 4 * (X[i-DIM]+X[i+DIM]) - R1 * (X[i-DIM*2]+X[i+DIM*2]) - R1 * 6 * X[i];
+    
+    add_rigidity_edges(nbt, X, R1, Y);
+}
+
+#endif
+
+#ifdef __AVX__
+
+/// same as add_rigidityAVX() in mecafil.cc, valid in any dimension
+void add_rigidityFA(const unsigned nbt, const real* X, const real R1, real* Y)
+{
+    const vec4 R1s = set4(R1);
+    const vec4 R4s = set4(R1 * 4);
+    const vec4 R6s = set4(R1 * 6);
+    
+    int i = DIM*2;
+    const int end = nbt;
+    for ( ; i+3 < end; i += 4 )
+    {
+        vec4 s = mul4(R4s, add4(loadu4(X+i-DIM), loadu4(X+i+DIM)));
+        s = sub4(s, mul4(R1s, add4(loadu4(X+i-DIM*2), loadu4(X+i+DIM*2))));
+        s = sub4(s, mul4(R6s, loadu4(X+i)));
+        storeu4(Y+i, add4(loadu4(Y+i), s));
+    }
+    for ( ; i < end; ++i )
+        Y[i] += R1 * 4 * (X[i-DIM]+X[i+DIM]) - R1 * (X[i-DIM*2]+X[i+DIM*2]) - R1 * 6 * X[i];
+    
+    add_rigidity_edges(nbt, X, R1, Y);
+}
+
+#endif
+
+
 inline void testRigidity(unsigned cnt, void (*func)(const unsigned, const real*, real, real*), char const* str)
 {
     real * x = nullptr, * y = nullptr, * z = nullptr;
@@ -457,6 +529,12 @@ void testRigidity(unsigned cnt)
     testRigidity(cnt, add_rigidityE,    "E  ");
     testRigidity(cnt, add_rigidityF,    "F  ");
     testRigidity(cnt, add_rigidityE,    "E  ");
+#if VEC2_IS_AVAILABLE
+    testRigidity(cnt, add_rigidityFS,   "FS ");
+#endif
+#ifdef __AVX__
+    testRigidity(cnt, add_rigidityFA,   "FA ");
+#endif
 #if defined __SSE__ & ( DIM == 2 )
     testRigidity(cnt, add_rigidity_SSO, "SSO");
     testRigidity(cnt, add_rigidity_SSE, "SSE");
@@ -962,7 +1040,7 @@ int main(int argc, char* argv[])
     setFilament(NBS+1, pos, 1.0, 2.0);
     setRandom(NBS+1, force, 1.0);
 
-    //testRigidity(1<<18);
+    testRigidity(1<<18);
     testProjectionU(1<<20);
     testProjectionD(1<<20);
 
@@ -1,8 +1,10 @@
 // Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
 
 #include "random.h"
+#include "philox.h"
 #include <cstdio>
 #include <cstring>
+#include <ctime>
 #include "timer.h"
 
 
@@ -559,6 +561,90 @@ void test_gaussian(int cnt)
 
 
 //==========================================================================
+/// compare with the known answers of the reference implementation, and time
+void test_philox()
+{
+    uint32_t c[4] = { 0, 0, 0, 0 };
+    Philox(0).encrypt(c);
+    printf("philox %08x %08x %08x %08x (expected 6627e8d5 e169c58d bc57ac4c 9b00dbd8)\n", c[0], c[1], c[2], c[3]);
+    uint32_t d[4] = { ~0U, ~0U, ~0U, ~0U };
+    Philox(~0ULL).encrypt(d);
+    printf("philox %08x %08x %08x %08x (expected 408f276d 41c83b0e a20bc7c6 6d5451fd)\n", d[0], d[1], d[2], d[3]);
+    
+    const size_t cnt = 1 << 20;
+    real * vec = new real[3*cnt];
+    Philox gen(RNG.pint32());
+    tic();
+    gen.gauss_set<3>(vec, cnt, 1.0, 1, 0, Philox::BROWNIAN);
+    printf("philox gauss_set %5.2f\n", toc(3*cnt));
+    real sum = 0, sum2 = 0;
+    for ( size_t i = 0; i < 3*cnt; ++i )
+    {
+        sum += vec[i];
+        sum2 += vec[i] * vec[i];
+    }
+    printf("philox mean %+.5f variance %.5f\n", sum/(3*cnt), sum2/(3*cnt));
+    delete[] vec;
+    
+    // a Random drawing from a stream matches Philox::Stream:
+    Random rng;
+    rng.stream(gen, 7, 3, Philox::MISC);
+    Philox::Stream str(gen, 7, 3, Philox::MISC);
+    unsigned diff = 0;
+    for ( int i = 0; i < 1000; ++i )
+        diff += ( rng.pint32() != str.pint32() );
+    printf("philox stream %u differences (expected 0)\n", diff);
+}
+
+
+/// throughput of the bounded integers and of the Bernoulli trials
+void test_bernoulli()
+{
+    const size_t cnt = 1 << 26;
+    uint32_t u = 0;
+    tic();
+    for ( size_t j = 0; j < cnt; ++j )
+        u += RNG.pint32(1000);
+    printf("pint32(n)   %5.2f  (%u)\n", toc(cnt), u);
+    tic();
+    for ( size_t j = 0; j < cnt; ++j )
+        u += RNG.pint32_slow(999);
+    printf("pint32_slow %5.2f  (%u)\n", toc(cnt), u);
+    tic();
+    for ( size_t j = 0; j < cnt; ++j )
+        u += RNG.flip();
+    printf("flip        %5.2f  (%u)\n", toc(cnt), u);
+    tic();
+    for ( size_t j = 0; j < cnt; ++j )
+        u += RNG.test(0.25);
+    printf("test        %5.2f  (%u)\n", toc(cnt), u);
+
+    const size_t n = 1024;
+    real prob[n];
+    bool res[n];
+    for ( size_t i = 0; i < n; ++i )
+        prob[i] = 0.25;
+    tic();
+    for ( size_t j = 0; j < cnt; j += n )
+    {
+        RNG.test_many(n, prob, res);
+        for ( size_t i = 0; i < n; ++i )
+            u += res[i];
+    }
+    printf("test_many   %5.2f  (%u)\n", toc(cnt), u);
+    
+    // histogram of pint32(n), which should be flat:
+    const uint32_t m = 3;
+    size_t hist[m] = { 0 };
+    for ( size_t j = 0; j < cnt; ++j )
+        ++hist[RNG.pint32(m)];
+    printf("pint32(%u) frequencies:", m);
+    for ( uint32_t i = 0; i < m; ++i )
+        printf("  %.5f", hist[i] / double(cnt));
+    printf("\n");
+}
+
+
 int main(int argc, char* argv[])
 {
     int mode = 4;
@@ -609,6 +695,14 @@ int main(int argc, char* argv[])
         case 7:
             test_gaussian(1<<18);
             break;
+            
+        case 8:
+            test_philox();
+            break;
+            
+        case 9:
+            test_bernoulli();
+            break;
     }
     
     printf("done\n");
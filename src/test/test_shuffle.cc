@@ -0,0 +1,83 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+// Compares the methods used to randomize the lists of objects at each time step
+
+#include <cstdio>
+#include <cstdlib>
+#include "node_list.h"
+#include "random.h"
+#include "timer.h"
+
+
+/// a Node carrying some data, to mimic the memory layout of the objects
+class Item : public Node
+{
+public:
+    double data[32];
+    Item() { data[0] = RNG.preal(); }
+    Item * next() const { return static_cast<Item*>(nNext); }
+};
+
+
+/// traverse the list, as done by the step() functions of the simulation
+double traverse(NodeList const& list)
+{
+    double sum = 0;
+    for ( Item * i = static_cast<Item*>(list.front()); i; i = i->next() )
+        sum += i->data[0];
+    return sum;
+}
+
+
+/// randomize the list `cnt` times with method `mth` and traverse it, printing the time
+void bench(NodeList& list, int mth, const char str[], size_t cnt)
+{
+    double mix = 0, run = 0, sum = 0;
+    for ( size_t n = 0; n < cnt; ++n )
+    {
+        tic();
+        switch ( mth )
+        {
+            case 1: list.shuffle(); break;
+            case 2: list.shuffle_all(); break;
+            case 3: list.rotate(); if ( RNG.flip() ) list.reverse(); break;
+        }
+        mix += toc();
+        tic();
+        sum += traverse(list);
+        run += toc();
+    }
+    if ( list.bad() )
+        printf("error: inconsistent list with `%s'\n", str);
+    printf("    %-8s  shuffle %10.1f us   then step %10.1f us  (%.0f)\n",
+           str, mix/cnt, run/cnt, sum/cnt);
+}
+
+
+int main(int argc, char* argv[])
+{
+    RNG.seed();
+    size_t sup = 1 << 20;
+    if ( argc > 1 )
+        sup = strtoul(argv[1], nullptr, 10);
+
+    for ( size_t nbo = 1024; nbo <= sup; nbo *= 8 )
+    {
+        Item * items = new Item[nbo];
+        NodeList list;
+        for ( size_t i = 0; i < nbo; ++i )
+            list.push_back(items+i);
+
+        const size_t cnt = std::max(size_t(8), ( 1 << 24 ) / nbo);
+        printf("%lu objects:\n", nbo);
+        bench(list, 0, "off", cnt);
+        bench(list, 1, "partial", cnt);
+        bench(list, 2, "full", cnt);
+        // traversing the list after a full shuffle is slow, since memory is accessed randomly:
+        bench(list, 0, "off", cnt);
+        bench(list, 3, "rotate", cnt);
+
+        list.clear();
+        delete[] items;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,369 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+/*
+ Timing of the sparse matrix classes on systems saved by Cytosim
+
+ A system is saved by the command `save DIRECTORY` in a config file, which calls
+ Meca::saveSystem() to write, in this directory:
+     elasticity.mtx  the isotropic matrix `mB`, of size nbPoints()
+     matrix.mtx      the complete linear system, of size DIM * nbPoints()
+     rhs.mtx         the right-hand-side vector of the system
+
+ For each directory given on the command line, `test_sparse` loads `mB` into
+ every implementation of the sparse matrices, and times the multiplication
+ of a vector, with the kernels selected at compile time (scalar, SSE or AVX).
+ The complete system is then solved with BCGS and GMRES, with and without
+ a Jacobi preconditionner.
+
+     test_sparse DIRECTORY [DIRECTORY...]
+
+ This must be compiled with the same DIM as `sim`.
+*/
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "real.h"
+#include "dim.h"
+#include "tictoc.h"
+#include "cblas.h"
+#include "monitor.h"
+#include "allocator.h"
+#include "linear_operator.h"
+#include "bicgstab.h"
+#include "gmres.h"
+
+#include "matsparse.h"
+#include "matsparsesym.h"
+#include "matsparsesym1.h"
+#include "matsparsesym2.h"
+#include "matsparsesymblk.h"
+
+/// number of multiplications timed
+const int N_MUL = 256;
+
+/// number of solves timed
+const int N_SOLVE = 4;
+
+
+/// a matrix element read from file
+struct Entry
+{
+    index_t i, j;
+    real    v;
+};
+
+
+/// read Matrix Market file, with indices starting at 0 as written by Meca::saveMatrix()
+bool readMatrix(std::string const& path, index_t& size, std::vector<Entry>& vec)
+{
+    std::ifstream is(path);
+    if ( !is.good() )
+        return false;
+    std::string line;
+    // skip the comments:
+    while ( std::getline(is, line) && line[0] == '%' );
+    size_t nbl = 0, nbc = 0, cnt = 0;
+    std::istringstream(line) >> nbl >> nbc >> cnt;
+    size = nbl;
+    vec.clear();
+    vec.reserve(cnt);
+    Entry e;
+    while ( is >> e.i >> e.j >> e.v )
+        vec.push_back(e);
+    if ( vec.size() != cnt )
+        fprintf(stderr, "Warning: `%s' has %lu elements instead of %lu\n", path.c_str(), vec.size(), cnt);
+    return true;
+}
+
+
+/// read vector saved by Meca::saveRHS()
+bool readVector(std::string const& path, index_t size, real * vec)
+{
+    std::ifstream is(path);
+    if ( !is.good() )
+        return false;
+    std::string line;
+    while ( std::getline(is, line) && line[0] == '%' );
+    size_t cnt = 0;
+    std::istringstream(line) >> cnt;
+    if ( cnt != size )
+        return false;
+    for ( index_t i = 0; i < size; ++i )
+        is >> vec[i];
+    return !is.fail();
+}
+
+
+real checksum(index_t size, real const* vec)
+{
+    real s = 0;
+    for ( index_t i = 0; i < size; ++i )
+        s += vec[i] * ( 1 + ( i & 7 ));
+    return s;
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - Isotropic matrix
+
+/// MatrixSparse does not need to be prepared
+void prepare(MatrixSparse&, int) {}
+
+template <typename MATRIX>
+void prepare(MATRIX& mat, int dim) { mat.prepareForMultiply(dim); }
+
+
+/// fill lower triangle, or both triangles for the non-symmetric MatrixSparse
+template <typename MATRIX>
+void fill(MATRIX& mat, std::vector<Entry> const& vec, bool full)
+{
+    for ( Entry const& e : vec )
+    {
+        mat(e.i, e.j) += e.v;
+        if ( full && e.i != e.j )
+            mat(e.j, e.i) += e.v;
+    }
+}
+
+
+/// time the scalar and isotropic multiplications of `mat`
+template <typename MATRIX>
+void timeIsotropic(MATRIX& mat, index_t size, std::vector<Entry> const& vec,
+                   real const* X, real * Y, bool full)
+{
+    mat.resize(size);
+    double t0 = TicToc::milliseconds();
+    mat.reset();
+    fill(mat, vec, full);
+    prepare(mat, 1);
+    double t1 = TicToc::milliseconds();
+
+    zero_real(size, Y);
+    for ( int n = 0; n < N_MUL; ++n )
+        mat.vecMulAdd(X, Y);
+    double t2 = TicToc::milliseconds();
+    real sum1 = checksum(size, Y);
+
+    prepare(mat, DIM);
+    zero_real(DIM*size, Y);
+    double t3 = TicToc::milliseconds();
+    for ( int n = 0; n < N_MUL; ++n )
+    {
+#if ( DIM >= 3 )
+        mat.vecMulAddIso3D(X, Y);
+#elif ( DIM == 2 )
+        mat.vecMulAddIso2D(X, Y);
+#else
+        mat.vecMulAdd(X, Y);
+#endif
+    }
+    double t4 = TicToc::milliseconds();
+    real sum2 = checksum(DIM*size, Y);
+
+    printf("\n %28s : set %9.3f  mul %9.4f  iso %9.4f ms", mat.what().c_str(),
+           t1-t0, (t2-t1)/N_MUL, (t4-t3)/N_MUL);
+    printf("  check %+.6e %+.6e", sum1, sum2);
+}
+
+
+/// time MatrixSparseSymmetricBlock, filled with `DIM` copies of the isotropic matrix
+void timeBlock(index_t size, std::vector<Entry> const& vec, real const* X, real * Y)
+{
+    MatrixSparseSymmetricBlock mat;
+    mat.resize(DIM*size);
+    double t0 = TicToc::milliseconds();
+    mat.reset();
+    for ( Entry const& e : vec )
+        for ( int d = 0; d < DIM; ++d )
+            mat(DIM*e.i+d, DIM*e.j+d) += e.v;
+    mat.prepareForMultiply(DIM);
+    double t1 = TicToc::milliseconds();
+
+    zero_real(DIM*size, Y);
+    for ( int n = 0; n < N_MUL; ++n )
+        mat.vecMulAdd(X, Y);
+    double t2 = TicToc::milliseconds();
+    real sum = checksum(DIM*size, Y);
+
+    printf("\n %28s : set %9.3f  mul %9s  iso %9.4f ms", mat.what().c_str(), t1-t0, "", (t2-t1)/N_MUL);
+    printf("  check %16s %+.6e", "", sum);
+}
+
+
+void testIsotropic(std::string const& dir)
+{
+    index_t size = 0;
+    std::vector<Entry> vec;
+    if ( !readMatrix(dir+"/elasticity.mtx", size, vec) )
+    {
+        fprintf(stderr, "could not read `%s/elasticity.mtx'\n", dir.c_str());
+        return;
+    }
+    printf("\n%s: isotropic matrix of size %u with %lu elements", dir.c_str(), size, vec.size());
+
+    real * X = new_real(DIM*size);
+    real * Y = new_real(DIM*size);
+    for ( index_t i = 0; i < DIM*size; ++i )
+        X[i] = real(1) / ( 1 + ( i % 13 ));
+
+    MatrixSparse           mat0;
+    MatrixSparseSymmetric  mat1;
+    MatrixSparseSymmetric1 mat2;
+    MatrixSparseSymmetric2 mat3;
+    timeIsotropic(mat0, size, vec, X, Y, true);
+    timeIsotropic(mat1, size, vec, X, Y, false);
+    timeIsotropic(mat2, size, vec, X, Y, false);
+    timeIsotropic(mat3, size, vec, X, Y, false);
+    timeBlock(size, vec, X, Y);
+    printf("\n");
+
+    free_real(Y);
+    free_real(X);
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - Complete system
+
+/// the complete linear system, with a Jacobi preconditionner
+class System : public LinearSolvers::LinearOperator
+{
+public:
+
+    /// the matrix, which is not symmetric
+    MatrixSparse mat;
+
+    /// inverse of the diagonal, or nullptr if preconditionning is disabled
+    real * inv;
+
+    System() : inv(nullptr) {}
+    ~System() { free_real(inv); }
+
+    int dimension() const { return mat.size(); }
+
+    void multiply(const real* X, real* Y) const
+    {
+        zero_real(mat.size(), Y);
+        mat.vecMulAdd(X, Y);
+    }
+
+    void precondition(const real* X, real* Y) const
+    {
+        if ( inv )
+        {
+            for ( index_t i = 0; i < mat.size(); ++i )
+                Y[i] = inv[i] * X[i];
+        }
+        else
+            copy_real(mat.size(), X, Y);
+    }
+};
+
+
+/// solve `N_SOLVE` times and print the average time of one solve
+template <typename SOLVER>
+void timeSolve(const char name[], System const& sys, real const* rhs, real * sol,
+               real tol, SOLVER solve)
+{
+    LinearSolvers::Monitor monitor(2*sys.dimension(), tol);
+    double t0 = TicToc::milliseconds();
+    for ( int n = 0; n < N_SOLVE; ++n )
+    {
+        monitor.reset();
+        zero_real(sys.dimension(), sol);
+        solve(monitor);
+    }
+    double t1 = TicToc::milliseconds();
+    printf("\n %28s : count %5lu  residual %.3e  solve %9.3f ms", name,
+           monitor.count(), monitor.residual(), (t1-t0)/N_SOLVE);
+}
+
+
+void testSystem(std::string const& dir)
+{
+    index_t size = 0;
+    std::vector<Entry> vec;
+    if ( !readMatrix(dir+"/matrix.mtx", size, vec) )
+    {
+        fprintf(stderr, "could not read `%s/matrix.mtx'\n", dir.c_str());
+        return;
+    }
+    printf("\n%s: system of size %u with %lu elements", dir.c_str(), size, vec.size());
+
+    real * rhs = new_real(size);
+    real * sol = new_real(size);
+    if ( !readVector(dir+"/rhs.mtx", size, rhs) )
+    {
+        fprintf(stderr, "could not read `%s/rhs.mtx'\n", dir.c_str());
+        free_real(rhs);
+        free_real(sol);
+        return;
+    }
+
+    System sys;
+    sys.mat.resize(size);
+    sys.mat.reset();
+    fill(sys.mat, vec, false);
+
+    // tolerance relative to the magnitude of the right-hand side:
+    const real tol = 1e-6 * std::max(blas::nrm8(size, rhs), real(1e-9));
+    LinearSolvers::Allocator allocator, temporary;
+    LinearSolvers::Matrix H, V;
+
+    for ( int pre = 0; pre < 2; ++pre )
+    {
+        if ( pre )
+        {
+            sys.inv = new_real(size);
+            for ( index_t i = 0; i < size; ++i )
+            {
+                real * d = sys.mat.addr(i, i);
+                sys.inv[i] = ( d && *d != 0 ) ? 1 / *d : 1;
+            }
+            double t0 = TicToc::milliseconds();
+            for ( int n = 0; n < N_MUL; ++n )
+                sys.precondition(rhs, sol);
+            double t1 = TicToc::milliseconds();
+            printf("\n %28s : apply %9.4f ms", "Jacobi preconditionner", (t1-t0)/N_MUL);
+        }
+        timeSolve(pre?"BCGSP":"BCGS", sys, rhs, sol, tol, [&](LinearSolvers::Monitor& mon)
+                  {
+                      if ( pre )
+                          LinearSolvers::BCGSP(sys, rhs, sol, mon, allocator);
+                      else
+                          LinearSolvers::BCGS(sys, rhs, sol, mon, allocator);
+                  });
+        for ( int RS : { 32, 64 } )
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "GMRES-%i%s", RS, pre?" preconditionned":"");
+            timeSolve(name, sys, rhs, sol, tol, [&](LinearSolvers::Monitor& mon)
+                      {
+                          LinearSolvers::GMRES(sys, rhs, sol, RS, mon, allocator, H, V, temporary);
+                      });
+        }
+    }
+    printf("\n");
+
+    free_real(sol);
+    free_real(rhs);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    if ( argc < 2 )
+    {
+        printf("Syntax: test_sparse DIRECTORY [DIRECTORY...]\n");
+        printf("    where DIRECTORY was written by the command `save DIRECTORY'\n");
+        return EXIT_FAILURE;
+    }
+    printf("Sparse matrix timing code in %iD --- %s\n", DIM, __VERSION__);
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        testIsotropic(argv[i]);
+        testSystem(argv[i]);
+    }
+    return EXIT_SUCCESS;
+}
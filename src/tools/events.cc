@@ -0,0 +1,94 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+/**
+ 'events' converts the binary file of fiber events `events.bin`,
+ recorded by `sim` if `simul:event_log = 1`, into text.
+
+ Each line contains:
+     time  kind  fiber  abscissa  tension  fragment
+ where `kind` is `break` or `sever`, and `fragment` is the identity of
+ the fiber created by the event, or zero.
+
+ Usage:
+ > events
+ > events events.bin
+ > events events.bin break
+
+ The last argument selects one kind of event.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include "event_log.h"
+
+
+void help(FILE * out)
+{
+    fprintf(out, "Convert Cytosim's binary record of fiber events to text.\n");
+    fprintf(out, "Usage:\n");
+    fprintf(out, "      events [FILE] [break|sever]\n");
+}
+
+
+const char* kind_name(unsigned k)
+{
+    switch ( k )
+    {
+        case EventRecord::BREAK: return "break";
+        case EventRecord::SEVER: return "sever";
+    }
+    return "unknown";
+}
+
+
+int main(int argc, char* argv[])
+{
+    const char * name = "events.bin";
+    unsigned kind = 0;
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        if ( !strcmp(argv[i], "help") || !strcmp(argv[i], "--help") )
+        {
+            help(stdout);
+            return 0;
+        }
+        else if ( !strcmp(argv[i], "break") )
+            kind = EventRecord::BREAK;
+        else if ( !strcmp(argv[i], "sever") )
+            kind = EventRecord::SEVER;
+        else
+            name = argv[i];
+    }
+
+    FILE * file = fopen(name, "rb");
+    if ( !file || ferror(file) )
+    {
+        fprintf(stderr, "Could not open file `%s'\n", name);
+        return 1;
+    }
+
+    char line[64] = { 0 };
+    if ( !fgets(line, sizeof(line), file) || strcmp(line, EventLog::MAGIC) )
+    {
+        fprintf(stderr, "File `%s' is not a record of events\n", name);
+        fclose(file);
+        return 1;
+    }
+
+    printf("%% time kind fiber abscissa tension fragment\n");
+    EventRecord rec[256];
+    size_t cnt;
+    while (( cnt = fread(rec, sizeof(EventRecord), 256, file) ))
+    {
+        for ( size_t i = 0; i < cnt; ++i )
+        {
+            EventRecord const& R = rec[i];
+            if ( kind == 0 || R.kind == kind )
+                printf("%12.6f %s %6u %10.5f %10.4f %6u\n", R.time, kind_name(R.kind),
+                       R.fiber, R.abscissa, R.tension, R.fragment);
+        }
+    }
+    fclose(file);
+    return 0;
+}
@@ -6,6 +6,11 @@
  
  It only uses the START and END tags of frames, and does not care
  about the organization of the data contained between these tags.
+ The index file `objects.cmo.idx` is used to locate the frames directly,
+ and it is created if needed (see FrameIndex). The frames are then copied
+ as ranges of bytes, without parsing, using copy_file_range() or sendfile()
+ on Linux, such that the data does not transit through user space.
+ Older files that cannot be indexed are processed line by line.
  
  'Frametool' can extract frames from the file, which is useful
  for example to reduce the size of 'objects.cmo' by dropping some frames.
@@ -18,6 +23,7 @@
  allowing finer manipulation of the simulation frames.
 */
 
+#include "frame_index.h"
 #include <errno.h>
 #include <cstdio>
 #include <ctype.h>
@@ -26,6 +32,9 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#ifdef __linux__
+#  include <sys/sendfile.h>
+#endif
 
 
 enum { COUNT, COPY, LAST, SIZE, EPID, SPLIT };
@@ -109,6 +118,59 @@ int whatline(FILE* in, FILE* out)
 }
 
 
+/**
+ Copy bytes [start, end) of the file descriptor `fd` to `out`.
+ The kernel copies the data directly if possible, and otherwise the bytes
+ are read and written by large blocks. Returns 0 if successful.
+ */
+int copy_range(int fd, off_t start, off_t end, FILE* out)
+{
+    off_t pos = start;
+    fflush(out);
+#ifdef __linux__
+    int ofd = fileno(out);
+    // this fails if the output is not a regular file, or with O_APPEND:
+    while ( pos < end )
+    {
+        ssize_t n = copy_file_range(fd, &pos, ofd, nullptr, (size_t)(end-pos), 0);
+        if ( n <= 0 )
+            break;
+    }
+    while ( pos < end )
+    {
+        ssize_t n = sendfile(ofd, fd, &pos, (size_t)(end-pos));
+        if ( n <= 0 )
+            break;
+    }
+#endif
+    const size_t len = 1 << 20;
+    char * tmp = nullptr;
+    if ( pos < end )
+        tmp = (char*)malloc(len);
+    while ( pos < end )
+    {
+        size_t cnt = (size_t)( end - pos );
+        ssize_t n = pread(fd, tmp, ( cnt < len ? cnt : len ), pos);
+        if ( n <= 0 || (size_t)n != fwrite(tmp, 1, (size_t)n, out) )
+            break;
+        pos += n;
+    }
+    free(tmp);
+    return ( pos < end );
+}
+
+
+/// copy frame `frm` of `in` to `out`, returning 0 if successful
+int copy_frame(FILE* in, size_t frm, FrameIndex const& index, FILE* out)
+{
+    if ( copy_range(fileno(in), index.offset(frm), index.end(frm), out) )
+    {
+        fprintf(stderr, "error while copying frame %lu\n", frm);
+        return 1;
+    }
+    return 0;
+}
+
 //=============================================================================
 
 
@@ -177,6 +239,11 @@ public:
         return 0 == ( n - s ) % i;
     }
     
+    size_t first()
+    {
+        return s;
+    }
+
     unsigned last()
     {
         return e;
@@ -185,17 +252,9 @@ public:
 
 //=============================================================================
 
-void countFrame(const char str[], FILE* in)
+void countFrame(const char str[], FrameIndex const& index)
 {
-    size_t frm = 0;
-    int code = 0;
-    do {
-        code = whatline(in, nullptr);
-        if ( code == FRAME_END )
-            ++frm;
-    } while ( code != EOF );
-    
-    printf("%40s: %lu frames\n", str, frm);
+    printf("%40s: %lu frames\n", str, index.size());
 }
 
 
@@ -225,11 +284,23 @@ void sizeFrame(FILE* in)
 }
 
 
-void extract(FILE* in, FILE* out, Slice sli)
+void extract(FILE* in, FILE* out, Slice sli, FrameIndex const& index)
 {
     size_t frm = 0;
     int code = 0;
-    FILE * file = sli.match(0) ? out : nullptr;
+    
+    // copy the frames directly, using the index:
+    if ( index.size() )
+    {
+        for ( frm = sli.first(); frm < index.size() && frm <= sli.last(); ++frm )
+        {
+            if ( sli.match(frm) && copy_frame(in, frm, index, out) )
+                return;
+        }
+        return;
+    }
+
+    FILE * file = sli.match(frm) ? out : nullptr;
 
     while ( code != EOF )
     {
@@ -269,43 +340,37 @@ void extract_pid(FILE* in, unsigned long pid)
 }
 
 
-void extractLast(FILE* in)
+void extractLast(FILE* in, FrameIndex const& index)
 {
-    fpos_t pos, start;
-    fgetpos(in, &start);
-
-    int code = 0;
-    while ( code != EOF )
-    {
-        code = whatline(in, nullptr);
-        if ( code == FRAME_END )
-        {
-            start = pos;
-            fgetpos(in, &pos);
-        }
-    }
-    
-    clearerr(in);
-    fsetpos(in, &start);
-    
-    int c = 0;
-    while ( 1 )
-    {
-        c = getc_unlocked(in);
-        if ( c == EOF )
-            break;
-        putchar(c);
-    }
-    
-    putchar('\n');
+    if ( index.empty() )
+        return;
+    copy_frame(in, index.size()-1, index, output);
 }
 
 
-void split(FILE * in)
+void split(FILE * in, FrameIndex const& index)
 {
     size_t frm = 0;
     int code = 0;
     char name[128] = { 0 };
+
+    // copy each frame to its own file, using the index:
+    if ( index.size() )
+    {
+        for ( frm = 0; frm < index.size(); ++frm )
+        {
+            snprintf(name, sizeof(name), "objects%04lu.cmo", frm);
+            FILE * out = openfile(name, "wb");
+            if ( !out )
+                return;
+            int err = copy_frame(in, frm, index, out);
+            fclose(out);
+            if ( err )
+                return;
+        }
+        return;
+    }
+
     snprintf(name, sizeof(name), "objects%04lu.cmo", frm);
     FILE * out = fopen(name, "w");
    
@@ -459,9 +524,15 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
     flockfile(file);
+    
+    // load or build the index of frames:
+    FrameIndex index;
+    if ( mode == COUNT || mode == COPY || mode == LAST || mode == SPLIT )
+        index.load(file, file_in);
+    rewind(file);
 
     if ( mode == COUNT )
-        countFrame(file_in, file);
+        countFrame(file_in, index);
     else if ( mode == SIZE )
         sizeFrame(file);
     else
@@ -476,13 +547,13 @@ int main(int argc, char* argv[])
             }
         }
         if ( mode == COPY )
-            extract(file, output, Slice(cmd));
+            extract(file, output, Slice(cmd), index);
         else if ( mode == LAST )
-            extractLast(file);
+            extractLast(file, index);
         else if ( mode == EPID )
             extract_pid(file, pid);
         else if ( mode == SPLIT )
-            split(file);
+            split(file, index);
         if ( output != stdout )
             fclose(output);
     }
@@ -6,8 +6,14 @@
 
 #include <fstream>
 #include <sstream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <map>
 
 #include "stream_func.h"
+#include "column_writer.h"
 #include "frame_reader.h"
 #include "iowrapper.h"
 #include "glossary.h"
@@ -18,7 +24,9 @@
 
 int verbose = 1;
 int prefix = 0;
-size_t cnt = 0;
+int columns = 0;
+unsigned load_mask = Simul::ALL_SETS;
+std::atomic<size_t> cnt(0);
 
 
 void help(std::ostream& os)
@@ -33,6 +41,10 @@ void help(std::ostream& os)
     os << "       verbose=0\n";
     os << "       frame=INTEGER[,INTEGER[,INTEGER[,INTEGER]]]\n";
     os << "       period=INTEGER\n";
+    os << "       threads=INTEGER\n";
+    os << "       load=CLASS[,CLASS]\n";
+    os << "       format=columns\n";
+    os << "       cache=0\n";
     os << "       input=FILE_NAME\n";
     os << "       output=FILE_NAME\n";
     os << "\n";
@@ -43,8 +55,20 @@ void help(std::ostream& os)
     os << "  By default, all frames in the file are processed in order, but a frame index,\n";
     os << "  or multiple indices can be specified (the first frame has index 0).\n";
     os << "  A periodicity can also be specified (ignored if multiple frames are specified).\n";
+    os << "  With `threads`, the frames are loaded and reported by parallel threads,\n";
+    os << "  and the results are printed in order. This should not be used for reports\n";
+    os << "  that depend on the previous frames, such as `fiber:displacement`, and the\n";
+    os << "  order of the objects within a frame may differ from the sequential mode.\n";
     os << "  The input trajectory file is `objects.cmo` unless otherwise specified.\n";
     os << "  The result is sent to standard output unless a file is specified as `output`\n";
+    os << "  With `load`, only the objects of the given classes are read from the file,\n";
+    os << "  together with the objects they depend on, which can be much faster.\n";
+    os << "  With `format=columns`, the data is saved in binary as tables of typed columns,\n";
+    os << "  one per frame, which can be read with `python/look/read_columns.py`.\n";
+    os << "  Some summary reports (time, inventory, fiber:length, fiber:energy, single,\n";
+    os << "  couple) are saved for every frame loaded in a sidecar file `objects.cmo.rep`.\n";
+    os << "  They are then answered from the sidecar, without reading the trajectory.\n";
+    os << "  With `cache=0`, the sidecar file is neither read nor written.\n";
     os << "  Attention: there should be no whitespace in any of the option.\n";
     os << "\n";
     os << "Examples:\n";
@@ -52,71 +76,420 @@ void help(std::ostream& os)
     os << "       report fiber:points frame=10 > fibers.txt\n";
     os << "       report fiber:points frame=10,20 > fibers.txt\n";
     os << "       report fiber:points period=8 > fibers.txt\n";
+    os << "       report fiber:tension threads=8 > tension.txt\n";
+    os << "       report fiber:length load=fiber > length.txt\n";
+    os << "       report fiber:points format=columns output=fibers.tab\n";
 }
 
 //------------------------------------------------------------------------------
 
-void report_raw(Simul const& simul, std::ostream& os, std::string const& what, int frm, Glossary& opt)
+void report_raw(std::ostream& os, std::string const& text, int frm)
 {
     if ( verbose > 0 )
-    {
-        os << "\n% frame   " << frm;
-        simul.report(os, what, opt);
-    }
+        os << "\n% frame   " << frm << text;
     else
     {
-        std::stringstream ss;
-        simul.report(ss, what, opt);
+        std::istringstream ss(text);
         StreamFunc::skip_lines(os, ss, '%');
     }
 }
 
 
-void report_prefix(Simul const& simul, std::ostream& os, std::string const& what, int frm, Glossary& opt)
+void report_prefix(std::ostream& os, std::string const& text, int frm, double time)
 {
     char str[256] = { 0 };
     size_t str_len = 0;
     
     if ( prefix & 1 )
-        str_len += snprintf(str, sizeof(str), "%9.3f ", simul.time());
+        str_len += snprintf(str, sizeof(str), "%9.3f ", time);
     
     if ( prefix & 2 )
         str_len += snprintf(str+str_len, sizeof(str)-str_len, "%9i ", frm);
     
-    std::stringstream ss;
+    std::istringstream ss(text);
  
     if ( verbose )
     {
         os << "% frame   " << frm << '\n';
-        simul.report(ss, what, opt);
         StreamFunc::prefix_lines(os, ss, str, '%', 0);
     }
     else
     {
-        simul.report(ss, what, opt);
         StreamFunc::prefix_lines(os, ss, str, 0, '%');
     }
 }
 
 
-void report(Simul const& simul, std::ostream& os, std::string const& what, int frm, Glossary& opt)
+/// print the report `text` of frame `frm`, in the format selected by the options
+void print(std::ostream& os, std::string const& text, int frm, double time)
 {
     ++cnt;
+    if ( columns )
+        ColumnWriter(os).write_frame(frm, time, text); // tables of typed columns
+    else if ( prefix )
+        report_prefix(os, text, frm, time);
+    else
+        report_raw(os, text, frm);
+}
+
+
+void report(Simul const& simul, std::ostream& os, std::string const& what, int frm, Glossary& opt)
+{
+    std::ostringstream ss;
     try
     {
-        if ( prefix )
-            report_prefix(simul, os, what, frm, opt);
-        else
-            report_raw(simul, os, what, frm, opt);
+        simul.report(ss, what, opt);
     }
     catch( Exception & e )
     {
+        os << ss.str();
         std::cerr << "Aborted: " << e.what() << '\n';
         exit(EXIT_FAILURE);
     }
+    print(os, ss.str(), frm, simul.time());
 }
 
 
+//------------------------------------------------------------------------------
+#pragma mark -
+
+/*
+ Some summary reports are cheap to calculate, compared to the cost of reading
+ a frame. Each frame loaded completely (ie. without `load`) is thus summarized
+ by all the reports listed in `CACHED`, and these summaries are saved in a
+ sidecar file (`objects.cmo.rep`), next to the index of frames (see FrameIndex).
+ Any later request for one of these reports is answered from the sidecar,
+ without reading the trajectory, if the sidecar covers all the requested frames.
+
+ The sidecar is valid as long as the first frame of the trajectory is the same,
+ and each cached frame is found at the position recorded in the index: frames
+ can thus be appended to the trajectory. The sidecar holds, for each frame:
+
+     #frame INDEX OFFSET TIME
+     #report WHAT SIZE
+     SIZE bytes of text, as produced by Simul::report()
+ 
+ The summaries are calculated with the default options, and the sidecar is not
+ used if `precision` or `column` is specified.
+ */
+
+/// the reports that are saved in the sidecar
+const char * CACHED[] = { "time", "inventory", "fiber:length", "fiber:energy", "single", "couple" };
+
+const size_t NB_CACHED = sizeof(CACHED) / sizeof(char*);
+
+
+class ReportCache
+{
+    /// the summaries of one frame
+    struct Frame
+    {
+        off_t offset;
+        double time;
+        std::string text[NB_CACHED];
+    };
+
+    /// name of the sidecar file
+    std::string path_;
+    
+    /// first line of the first frame of the trajectory
+    std::string signature_;
+    
+    /// summaries of the frames
+    std::map<size_t, Frame> frames_;
+    
+    /// true if frames were added since the sidecar was read
+    bool dirty_;
+    
+    /// protects `frames_` in the parallel mode
+    std::mutex mutex_;
+
+public:
+
+    /// index of `what` in CACHED, or -1
+    static int find(std::string const& what)
+    {
+        for ( size_t i = 0; i < NB_CACHED; ++i )
+            if ( what == CACHED[i] )
+                return (int)i;
+        return -1;
+    }
+    
+    /// constructor
+    ReportCache() : dirty_(false) {}
+    
+    /// read the sidecar of `input`, keeping only the frames that match `index`
+    void open(std::string const& input, FrameIndex const& index)
+    {
+        path_ = input + ".rep";
+        frames_.clear();
+        dirty_ = false;
+        if ( index.empty() )
+            return;
+        // read the first line of the first frame:
+        std::ifstream cmo(input.c_str(), std::ios::binary);
+        cmo.seekg(index.offset(0));
+        while ( cmo.good() && signature_.empty() )
+            std::getline(cmo, signature_);
+        
+        std::ifstream is(path_.c_str(), std::ios::binary);
+        std::string line;
+        if ( !std::getline(is, line) || line != "#cytosim report cache " + std::to_string(DIM) )
+            return;
+        if ( !std::getline(is, line) || line != "#signature " + signature_ )
+            return;
+        Frame * frm = nullptr;
+        while ( std::getline(is, line) )
+        {
+            std::istringstream iss(line);
+            std::string tag, arg;
+            iss >> tag;
+            if ( tag == "#frame" )
+            {
+                size_t f;
+                long long off;
+                double time;
+                if ( !( iss >> f >> off >> time ))
+                    break;
+                frm = nullptr;
+                if ( f < index.size() && index.offset(f) == (off_t)off )
+                {
+                    frm = &frames_[f];
+                    frm->offset = (off_t)off;
+                    frm->time = time;
+                }
+            }
+            else if ( tag == "#report" )
+            {
+                size_t len = 0;
+                if ( !( iss >> arg >> len ))
+                    break;
+                std::string str(len, 0);
+                if ( !is.read(&str[0], len) )
+                    break;
+                int i = find(arg);
+                if ( frm && i >= 0 )
+                    frm->text[i].swap(str);
+            }
+            else if ( line.size() )
+                break;
+        }
+    }
+    
+    /// summarize frame `f` loaded in `simul`, if it is not known yet
+    void store(Simul const& simul, size_t f, FrameIndex const& index)
+    {
+        if ( path_.empty() || f >= index.size() )
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if ( frames_.count(f) )
+                return;
+        }
+        Frame frm;
+        frm.offset = index.offset(f);
+        frm.time = simul.time();
+        for ( size_t i = 0; i < NB_CACHED; ++i )
+        {
+            Glossary opt;
+            std::ostringstream ss;
+            try {
+                simul.report(ss, CACHED[i], opt);
+            }
+            catch( Exception & ) {
+                return;
+            }
+            frm.text[i] = ss.str();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        frames_[f] = frm;
+        dirty_ = true;
+    }
+    
+    /// summaries of frame `f`, or null if unknown
+    Frame const* get(size_t f) const
+    {
+        auto i = frames_.find(f);
+        return ( i == frames_.end() ) ? nullptr : &i->second;
+    }
+    
+    /// print report `r` of frame `f`, returning 0 if successful
+    int print(std::ostream& os, size_t f, int r) const
+    {
+        Frame const* frm = get(f);
+        if ( !frm )
+            return 1;
+        ::print(os, frm->text[r], f, frm->time);
+        return 0;
+    }
+    
+    /// save the sidecar, if frames were added
+    void write() const
+    {
+        if ( !dirty_ || signature_.empty() )
+            return;
+        std::ofstream os(path_.c_str(), std::ios::binary);
+        os << "#cytosim report cache " << DIM << '\n';
+        os << "#signature " << signature_ << '\n';
+        char str[64];
+        for ( auto const& i : frames_ )
+        {
+            snprintf(str, sizeof(str), " %lli %.17g\n", (long long)i.second.offset, i.second.time);
+            os << "#frame " << i.first << str;
+            for ( size_t r = 0; r < NB_CACHED; ++r )
+            {
+                os << "#report " << CACHED[r] << ' ' << i.second.text[r].size() << '\n';
+                os << i.second.text[r];
+            }
+        }
+        if ( !os.good() )
+            std::cerr << "Warning: could not write `" << path_ << "'\n";
+    }
+};
+
+
+/// the summaries of the frames, if enabled
+ReportCache * cache = nullptr;
+
+
+/// summarize frame `f` loaded in `simul`, if the cache is enabled
+void summarize(Simul const& simul, FrameReader const& reader, size_t f)
+{
+    if ( cache && load_mask == Simul::ALL_SETS )
+        cache->store(simul, f, reader.frames());
+}
+
+
+/// print report `r` from the cache for frames `frm`, returning 0 if successful
+int report_cached(std::ostream& os, std::vector<size_t> const& frm, int r)
+{
+    for ( size_t f : frm )
+    {
+        if ( !cache->get(f) )
+            return 1;
+    }
+    for ( size_t f : frm )
+        cache->print(os, f, r);
+    return 0;
+}
+
+
+//------------------------------------------------------------------------------
+#pragma mark -
+
+/*
+ In the parallel mode, the frames following the first one are divided into blocks,
+ which are handed to the threads in order. Each thread has its own Simul and
+ FrameReader, and the report of each block is collected in a string, which is
+ printed by the main thread as soon as all the preceding blocks were printed.
+ */
+
+/// number of frames in a block
+const size_t BLOCK = 16;
+
+std::mutex              block_mutex;
+std::condition_variable block_cond;
+std::vector<std::string> block_text;
+std::vector<char>        block_done;
+size_t                   block_next = 0;
+
+
+/// load and report the frames of the blocks, until none is left
+void worker(Simul * simul, std::string input, std::string what, Glossary opt,
+            size_t first, size_t last, unsigned period)
+{
+    FrameReader reader;
+    try {
+        reader.openFile(input);
+        reader.selectClasses(load_mask);
+    }
+    catch( Exception & e )
+    {
+        std::cerr << "Aborted: " << e.what() << '\n';
+        exit(EXIT_FAILURE);
+    }
+    while ( 1 )
+    {
+        size_t b;
+        {
+            std::lock_guard<std::mutex> lock(block_mutex);
+            b = block_next++;
+        }
+        if ( b >= block_text.size() )
+            break;
+        std::ostringstream ss;
+        size_t s = first + 1 + b * BLOCK * period;
+        size_t e = std::min(s + BLOCK * period, last + 1);
+        for ( size_t f = s; f < e; ++f )
+        {
+            if ( f % period != first % period )
+                continue;
+            if ( reader.loadFrame(*simul, f) )
+            {
+                std::cerr << "Error: missing frame " << f << '\n';
+                break;
+            }
+            summarize(*simul, reader, f);
+            report(*simul, ss, what, f, opt);
+        }
+        {
+            std::lock_guard<std::mutex> lock(block_mutex);
+            block_text[b] = ss.str();
+            block_done[b] = 1;
+        }
+        block_cond.notify_all();
+    }
+}
+
+
+/// report frames `first+1` to `last` with `nbt` threads, printing to `os`
+int report_parallel(std::ostream& os, std::string const& input, std::string const& what,
+                    Glossary const& opt, size_t first, size_t last, unsigned period, unsigned nbt)
+{
+    size_t nbb = 0;
+    if ( last > first )
+        nbb = ( last - first + BLOCK * period - 1 ) / ( BLOCK * period );
+    block_text.resize(nbb);
+    block_done.resize(nbb, 0);
+
+    std::vector<Simul*> sims;
+    std::vector<std::thread> pool;
+    try
+    {
+        for ( unsigned t = 0; t < nbt; ++t )
+        {
+            Simul * sim = new Simul;
+            sim->loadProperties();
+            sims.push_back(sim);
+        }
+    }
+    catch( Exception & e )
+    {
+        std::cerr << "Aborted: " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    for ( unsigned t = 0; t < nbt; ++t )
+        pool.emplace_back(worker, sims[t], input, what, opt, first, last, period);
+
+    // print the blocks in order:
+    for ( size_t b = 0; b < nbb; ++b )
+    {
+        std::string str;
+        {
+            std::unique_lock<std::mutex> lock(block_mutex);
+            block_cond.wait(lock, [b]{ return block_done[b]; });
+            str.swap(block_text[b]);
+        }
+        os << str;
+    }
+
+    for ( std::thread & t : pool )
+        t.join();
+    for ( Simul * sim : sims )
+        delete(sim);
+    return EXIT_SUCCESS;
+}
+
 //------------------------------------------------------------------------------
 
 
@@ -166,6 +539,7 @@ int main(int argc, char* argv[])
     
     unsigned frame = 0;
     unsigned period = 1;
+    unsigned threads = 1;
 
     arg.set(input, ".cmo") || arg.set(input, "input");
     arg.set(verbose, "verbose");
@@ -179,6 +553,14 @@ int main(int argc, char* argv[])
         RNG.seed();
         simul.loadProperties();
         reader.openFile(input);
+        if ( arg.has_key("load") )
+        {
+            std::string list;
+            for ( unsigned i = 0; arg.set(str, "load", i); ++i )
+                list += ( i ? "," : "" ) + str;
+            load_mask = simul.setMask(list);
+            reader.selectClasses(load_mask);
+        }
     }
     catch( Exception & e )
     {
@@ -205,6 +587,49 @@ int main(int argc, char* argv[])
     if ( arg.set(frame, "frame") )
         period = 0;
     arg.set(period, "period");
+    arg.set(threads, "threads");
+    if ( arg.set(str, "format") )
+    {
+        if ( str != "columns" )
+        {
+            std::cerr << "Error: unknown format `" << str << "'\n";
+            return EXIT_FAILURE;
+        }
+        columns = 1;
+        ColumnWriter(*osp).start();
+    }
+    
+    bool use_cache = true;
+    arg.set(use_cache, "cache");
+    ReportCache reportCache;
+    if ( use_cache )
+    {
+        cache = &reportCache;
+        cache->open(input, reader.frames());
+        int r = ReportCache::find(what);
+        if ( r >= 0 && !arg.has_key("precision") && !arg.has_key("column") && !arg.has_key("width") )
+        {
+            // list the requested frames:
+            std::vector<size_t> frm(1, frame);
+            if ( arg.nb_values("frame") > 1 )
+            {
+                for ( unsigned s = 1; arg.set(frame, "frame", s); ++s )
+                    frm.push_back(frame);
+            }
+            else if ( period > 0 )
+            {
+                for ( size_t f = frame + period; f <= reader.lastKnownFrame(); f += period )
+                    frm.push_back(f);
+            }
+            if ( 0 == report_cached(*osp, frm, r) )
+            {
+                if ( ofs.is_open() )
+                    ofs.close();
+                arg.print_warning(std::cerr, cnt, "\n");
+                return EXIT_SUCCESS;
+            }
+        }
+    }
     
     // process first record, at index 'frame':
     if ( reader.loadFrame(simul, frame) )
@@ -218,6 +643,7 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
+    summarize(simul, reader, frame);
     report(simul, *osp, what, frame, arg);
 
     if ( arg.nb_values("frame") > 1 )
@@ -228,7 +654,10 @@ int main(int argc, char* argv[])
         {
             // try to load the specified frame:
             if ( 0 == reader.loadFrame(simul, frame) )
+            {
+                summarize(simul, reader, frame);
                 report(simul, *osp, what, frame, arg);
+            }
             else
             {
                 std::cerr << "Error: missing frame " << frame << '\n';
@@ -237,6 +666,12 @@ int main(int argc, char* argv[])
             ++s;
         }
     }
+    else if ( period > 0 && threads > 1 )
+    {
+        // the index gives the number of frames in the file:
+        if ( report_parallel(*osp, input, what, arg, frame, reader.lastKnownFrame(), period, threads) )
+            return EXIT_FAILURE;
+    }
     else if ( period > 0 )
     {
         // process every 'period' record:
@@ -244,11 +679,14 @@ int main(int argc, char* argv[])
         while ( 0 == reader.loadNextFrame(simul)  )
         {
             ++f;
+            summarize(simul, reader, f);
             if ( f % period == frame % period )
                 report(simul, *osp, what, f, arg);
         }
     }
     
+    if ( cache )
+        cache->write();
     if ( ofs.is_open() )
         ofs.close();
 
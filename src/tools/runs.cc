@@ -0,0 +1,186 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+/**
+ 'runs' reads a file shared by many simulations (see RunStore), which is
+ created by calling `sim store=FILE run=NAME` repeatedly.
+ It can list the runs, extract the files of one run, and report on all runs.
+ */
+
+#include "simul.h"
+#include "parser.h"
+#include "glossary.h"
+#include "messages.h"
+#include "exceptions.h"
+#include "stream_func.h"
+#include "run_store.h"
+#include <fstream>
+#include <sstream>
+
+
+void help()
+{
+    printf("Cytosim-runs %iD\n", DIM);
+    printf("    file version %i built on %s\n", Simul::currentFormatID, __DATE__);
+    printf("Synopsis:\n");
+    printf("   `runs` reads a file holding the output of many runs, made with `sim store=FILE`\n");
+    printf("\n");
+    printf("Usage:\n");
+    printf("    runs FILE                   list the runs\n");
+    printf("    runs FILE extract RUN       write the files of the run in the current directory\n");
+    printf("    runs FILE report WHAT       report on one frame of every run\n");
+    printf("\n");
+    printf("Possible options for `report`:\n");
+    printf("    frame=INDEX    frame to report (default: last frame of each run)\n");
+    printf("    and any option of Simul::report()\n");
+    printf("  Each line of the report is prefixed by the identity of the run\n");
+    printf("\n");
+    printf("Example:\n");
+    printf("    runs sweep.cms report fiber:length frame=10\n");
+    printf("    runs sweep.cms extract 1234\n");
+}
+
+
+/// print the runs with their number of frames
+int list(RunStore const& store)
+{
+    printf("%% %16s %9s %12s\n", "run", "frames", "bytes");
+    for ( std::string const& run : store.runs() )
+    {
+        size_t cnt = 0, sum = 0;
+        for ( RunStore::Chunk const& c : store.chunks() )
+        {
+            if ( c.run == run )
+            {
+                cnt += ( c.kind == "frame" );
+                sum += c.size;
+            }
+        }
+        printf("%18s %9lu %12lu\n", run.c_str(), cnt, sum);
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/// write the chunks of `kind` to file `name`, returning the number of chunks
+size_t extract(RunStore const& store, std::string const& run, std::string const& kind, std::string const& name)
+{
+    std::vector<RunStore::Chunk> list = store.find(run, kind);
+    if ( list.empty() )
+        return 0;
+    FILE * out = fopen(name.c_str(), "wb");
+    if ( !out )
+        throw InvalidIO("could not open `"+name+"' for writing");
+    std::string str;
+    for ( RunStore::Chunk const& c : list )
+    {
+        // only the last version of the properties is needed:
+        if ( kind == "properties" && &c != &list.back() )
+            continue;
+        if ( store.read(c, str) || str.size() != fwrite(str.data(), 1, str.size(), out) )
+        {
+            fclose(out);
+            throw InvalidIO("could not copy chunk of run `"+run+"'");
+        }
+    }
+    if ( fclose(out) )
+        throw InvalidIO("could not write `"+name+"'");
+    return list.size();
+}
+
+
+/// write the trajectory, properties and messages of `run`
+int extract(RunStore const& store, std::string const& run)
+{
+    try {
+        if ( !extract(store, run, "properties", "properties.cmo") )
+        {
+            std::cerr << "Error: unknown run `" << run << "'\n";
+            return EXIT_FAILURE;
+        }
+        size_t cnt = extract(store, run, "frame", TRAJECTORY);
+        extract(store, run, "messages", "messages.cmo");
+        std::clog << "runs: extracted " << cnt << " frames of run `" << run << "'\n";
+    }
+    catch( Exception & e ) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/// report frame `frm` of every run, or their last frame if `frm < 0`
+int report(RunStore const& store, std::string const& what, long frm, Glossary& opt)
+{
+    std::string str;
+    std::ostream& os = std::cout;
+    for ( std::string const& run : store.runs() )
+    {
+        std::vector<RunStore::Chunk> props = store.find(run, "properties");
+        std::vector<RunStore::Chunk> frames = store.find(run, "frame");
+        size_t f = ( frm < 0 ) ? frames.size() - 1 : (size_t)frm;
+        if ( props.empty() || f >= frames.size() )
+        {
+            std::clog << "runs: skipped run `" << run << "' without frame " << frm << '\n';
+            continue;
+        }
+        try {
+            Simul simul;
+            if ( store.read(props.back(), str) )
+                throw InvalidIO("could not read properties");
+            Parser(simul, 1, 1, 0, 0, 0).evaluate(str);
+            if ( store.read(frames[f], str) )
+                throw InvalidIO("could not read frame");
+            Inputter in(DIM);
+            in.memory(str.data(), str.size());
+            if ( simul.readObjects(in, Simul::ALL_SETS) )
+                throw InvalidIO("invalid frame");
+            std::stringstream ss;
+            simul.report(ss, what, opt);
+            os << "% run " << run << " frame " << f << '\n';
+            StreamFunc::prefix_lines(os, ss, (run+" ").c_str(), '%', 0);
+        }
+        catch( Exception & e ) {
+            std::cerr << "Error in run `" << run << "': " << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+
+int main(int argc, char* argv[])
+{
+    if ( argc < 2 || strstr(argv[1], "help") )
+    {
+        help();
+        return EXIT_SUCCESS;
+    }
+
+    RunStore store;
+    if ( !store.scan(argv[1]) )
+    {
+        std::cerr << "Error: no run found in `" << argv[1] << "'\n";
+        return EXIT_FAILURE;
+    }
+    if ( argc < 3 )
+        return list(store);
+
+    std::string cmd = argv[2];
+    if ( cmd == "extract" && argc == 4 )
+        return extract(store, argv[3]);
+    if ( cmd == "report" && argc > 3 )
+    {
+        Glossary arg;
+        if ( arg.read_strings(argc-4, argv+4) )
+            return EXIT_FAILURE;
+        long frm = -1;
+        arg.set(frm, "frame");
+        Cytosim::all_silent();
+        int res = report(store, argv[3], frm, arg);
+        arg.print_warning(std::cerr, 1, "\n");
+        return res;
+    }
+    help();
+    return EXIT_FAILURE;
+}
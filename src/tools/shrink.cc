@@ -0,0 +1,265 @@
+// Cytosim was created by Francois Nedelec. Copyright 2021 Cambridge University
+
+/**
+ 'shrink' makes a reduced copy of a trajectory file, by selecting frames,
+ classes of objects, and optionally the objects located inside a box.
+
+ The frames are located with the index of frames (see FrameIndex), and the
+ frames that are not selected are not read. Without a box, the selected frames
+ are copied section by section, without decoding the objects (see SectionFilter),
+ such that the file is processed at the speed of the disk.
+ With a box, the positions of the objects are needed, and each selected frame
+ is loaded in memory, filtered and written in the current format.
+
+ The classes needed to interpret the selected classes are always kept:
+ Space and Field, and the Fibers, Beads, Solids and Spheres to which the
+ Singles, Couples and Organizers may be attached.
+ */
+
+#include "simul.h"
+#include "glossary.h"
+#include "exceptions.h"
+#include "frame_index.h"
+#include "frame_reader.h"
+#include "section_filter.h"
+#include <algorithm>
+#include <sstream>
+
+
+void help()
+{
+    printf("Cytosim-shrink %iD\n", DIM);
+    printf("    file version %i built on %s\n", Simul::currentFormatID, __DATE__);
+    printf("Synopsis:\n");
+    printf("   `shrink` makes a reduced copy of a cytosim trajectory file.\n");
+    printf("   The output file is overwritten.\n");
+    printf("\n");
+    printf("Usage:\n");
+    printf("    shrink input_file output_file [options]\n\n");
+    printf("Possible options:\n");
+    printf("    frame=INDEX    first frame to copy (default 0)\n");
+    printf("    period=INT     copy one frame in INT (default 1)\n");
+    printf("    last=INDEX     last frame to copy (default: last frame in file)\n");
+    printf("    keep=WHAT,...  keep only the objects of the given classes\n");
+    printf("    skip=WHAT,...  remove the objects of the given classes\n");
+    printf("    box=XMIN,XMAX,YMIN,YMAX,ZMIN,ZMAX\n");
+    printf("                   keep only the objects located inside this box\n");
+    printf("    binary=0       with a box, generate output in text format\n");
+    printf("\n");
+    printf("Example:\n");
+    printf("    shrink objects.cmo small.cmo period=10 keep=fiber\n");
+    printf("    shrink objects.cmo small.cmo box=-1,1,-1,1 skip=couple\n");
+}
+
+
+/// add to the comma-separated list of classes `str` the classes needed to read them
+std::string dependencies(std::string const& str)
+{
+    std::string res = str + ",space,field";
+    if ( str.find("single") != std::string::npos ||
+         str.find("couple") != std::string::npos ||
+         str.find("organizer") != std::string::npos )
+        res += ",fiber,bead,solid,sphere";
+    return res;
+}
+
+
+/// return true if `frame` is a delta frame, which depends on the previous frame
+bool isDelta(std::string const& frame)
+{
+    size_t t = frame.find("\n#time ");
+    return frame.find("\n#delta ") < t;
+}
+
+
+/// copy the selected frames, without decoding the objects
+int stream(std::string const& input, std::string const& output, SectionFilter const& filter,
+           size_t start, size_t period, size_t last)
+{
+    FILE * in = fopen(input.c_str(), "rb");
+    if ( !in )
+    {
+        std::cerr << "Error opening input file `" << input << "'\n";
+        return EXIT_FAILURE;
+    }
+    FrameIndex index;
+    index.load(in, input);
+
+    FILE * out = fopen(output.c_str(), "wb");
+    if ( !out )
+    {
+        fclose(in);
+        std::cerr << "Error opening output file `" << output << "'\n";
+        return EXIT_FAILURE;
+    }
+
+    int res = EXIT_SUCCESS;
+    size_t cnt = 0;
+    std::string buf, str;
+    for ( size_t frm = start; frm < index.size() && frm <= last; frm += period )
+    {
+        buf.resize(index.end(frm) - index.offset(frm));
+        if ( fseeko(in, index.offset(frm), SEEK_SET) || buf.size() != fread(&buf[0], 1, buf.size(), in) )
+        {
+            std::clog << "Error reading frame " << frm << '\n';
+            res = EXIT_FAILURE;
+            break;
+        }
+        // a delta frame can only follow the frame on which it is based:
+        if ( isDelta(buf) && ( period > 1 || cnt == 0 ))
+        {
+            std::clog << "Error: frame " << frm << " is a delta frame, which cannot be copied alone\n";
+            std::clog << "       Specify a box to reconstruct the frames\n";
+            res = EXIT_FAILURE;
+            break;
+        }
+        str.clear();
+        if ( filter.filterFrame(str, buf) )
+        {
+            std::clog << "Error in compressed frame " << frm << '\n';
+            res = EXIT_FAILURE;
+            break;
+        }
+        if ( str.size() != fwrite(str.data(), 1, str.size(), out) )
+        {
+            std::clog << "Error writing `" << output << "'\n";
+            res = EXIT_FAILURE;
+            break;
+        }
+        ++cnt;
+    }
+    fclose(out);
+    fclose(in);
+    std::clog << "shrink: copied " << cnt << " frames\n";
+    return res;
+}
+
+
+/// true if the position of `obj` is inside the box `val`
+bool inside(Object const* obj, void const* val)
+{
+    real const* box = static_cast<real const*>(val);
+    if ( !( obj->mobile() & 1 ))
+        return true;
+    Vector pos = obj->position();
+    for ( int d = 0; d < DIM; ++d )
+    {
+        if ( pos[d] < box[2*d] || box[2*d+1] < pos[d] )
+            return false;
+    }
+    return true;
+}
+
+
+/// delete the objects of `set` that are located outside the box
+void crop(ObjectSet * set, real const box[])
+{
+    ObjectList list = set->collect();
+    for ( Object * obj : list )
+    {
+        if ( !inside(obj, box) )
+            set->erase(obj);
+    }
+}
+
+
+/// load the selected frames, and write the objects that are inside the box
+int load(std::string const& input, std::string const& output, std::string const& keep,
+         std::string const& skip, real const box[], bool binary,
+         size_t start, size_t period, size_t last)
+{
+    Simul simul;
+    FrameReader reader;
+    std::vector<ObjectSet*> removed;
+    try {
+        simul.loadProperties();
+        reader.openFile(input);
+        if ( keep.size() )
+            reader.selectClasses(simul.setMask(keep));
+        std::istringstream iss(skip);
+        std::string name;
+        while ( std::getline(iss, name, ',') )
+        {
+            ObjectSet * set = simul.findSet(name);
+            if ( !set )
+                throw InvalidParameter("unknown class `"+name+"'");
+            removed.push_back(set);
+        }
+    }
+    catch( Exception & e ) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    // objects are erased before those they may refer to:
+    ObjectSet * order[] = { &simul.organizers, &simul.couples, &simul.singles, &simul.beads,
+                            &simul.solids, &simul.spheres, &simul.fibers };
+    remove(output.c_str());
+    size_t cnt = 0;
+    for ( size_t frm = start; frm <= last; frm += period )
+    {
+        try {
+            if ( reader.loadFrame(simul, frm) )
+                break;
+            for ( ObjectSet * set : order )
+            {
+                if ( std::count(removed.begin(), removed.end(), set) )
+                    set->erase();
+                else
+                    crop(set, box);
+            }
+            simul.writeObjects(output, true, binary);
+        }
+        catch( Exception & e ) {
+            std::clog << "Error in frame " << frm << ":\n";
+            std::clog << "    " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        ++cnt;
+    }
+    std::clog << "shrink: copied " << cnt << " frames\n";
+    return EXIT_SUCCESS;
+}
+
+
+int main(int argc, char* argv[])
+{
+    if ( argc < 3 || strstr(argv[1], "help") )
+    {
+        help();
+        return EXIT_SUCCESS;
+    }
+
+    Glossary arg;
+    std::string input  = argv[1];
+    std::string output = argv[2];
+    if ( arg.read_strings(argc-3, argv+3) )
+        return EXIT_FAILURE;
+
+    size_t start = 0, period = 1, last = ~0UL;
+    std::string keep, skip;
+    bool binary = true;
+    arg.set(start, "frame");
+    arg.set(period, "period");
+    arg.set(last, "last");
+    arg.set(keep, "keep");
+    arg.set(skip, "skip");
+    arg.set(binary, "binary");
+    if ( period < 1 )
+    {
+        std::cerr << "Error: period should be >= 1\n";
+        return EXIT_FAILURE;
+    }
+
+    if ( arg.has_key("box") )
+    {
+        real box[6] = { -INFINITY, INFINITY, -INFINITY, INFINITY, -INFINITY, INFINITY };
+        for ( int i = 0; i < 2*DIM; ++i )
+            arg.set(box[i], "box", i);
+        return load(input, output, keep, skip, box, binary, start, period, last);
+    }
+
+    if ( keep.size() )
+        return stream(input, output, SectionFilter(dependencies(keep), true), start, period, last);
+    return stream(input, output, SectionFilter(skip, false), start, period, last);
+}
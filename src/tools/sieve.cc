@@ -6,6 +6,10 @@
 #include "iowrapper.h"
 #include "exceptions.h"
 #include "simul_prop.h"
+#include "frame_reader.h"
+#include "frame_index.h"
+#include "section_filter.h"
+#include <algorithm>
 
 
 void help()
@@ -27,10 +31,85 @@ void help()
     printf("    binary=1     generate output in binary format\n");
     printf("    skip=WHAT    remove all objects of class WHAT\n");
     printf("    frame=INDEX  process only specified frame\n");
+    printf("    stream=1     copy the frames without loading the objects\n");
+    printf("\n");
+    printf("   With stream=1, the sections of class WHAT are removed from the frames,\n");
+    printf("   which are otherwise copied without change. Compressed frames are inflated.\n");
     printf("\n");
     printf("Example:\n");
     printf("    sieve objects.cmo objects.txt binary=0\n");
     printf("    sieve objects.cmo objects.txt binary=0 skip=couple\n");
+    printf("    sieve objects.cmo fibers.cmo stream=1 skip=couple\n");
+}
+
+
+/**
+ Copy the frames of trajectory `input` to `output`, removing the sections of
+ class `skip`. The frames are located with the index of frames, and only the
+ "#section" tags are parsed, such that the objects are not reconstructed.
+ If `frame >= 0` only this frame is copied.
+ */
+int stream(std::string const& input, std::string const& output, std::string const& skip, long frame)
+{
+    FILE * in = fopen(input.c_str(), "rb");
+    if ( !in )
+    {
+        std::cerr << "Error opening input file `" << input << "'\n";
+        return EXIT_FAILURE;
+    }
+    FrameIndex index;
+    index.load(in, input);
+    
+    size_t sup = index.size();
+    size_t frm = 0;
+    if ( frame >= 0 )
+    {
+        frm = frame;
+        sup = std::min(sup, frm+1);
+    }
+    
+    FILE * out = fopen(output.c_str(), "ab");
+    if ( !out )
+    {
+        fclose(in);
+        std::cerr << "Error opening output file `" << output << "'\n";
+        return EXIT_FAILURE;
+    }
+    
+    SectionFilter filter(skip, false);
+    int res = EXIT_SUCCESS;
+    std::string buf, str;
+    for ( ; frm < sup; ++frm )
+    {
+        buf.resize(index.end(frm) - index.offset(frm));
+        if ( fseeko(in, index.offset(frm), SEEK_SET) || buf.size() != fread(&buf[0], 1, buf.size(), in) )
+        {
+            std::clog << "Error reading frame " << frm << '\n';
+            res = EXIT_FAILURE;
+            break;
+        }
+        str.clear();
+        if ( filter.filterFrame(str, buf) )
+        {
+            std::clog << "Error in compressed frame " << frm << '\n';
+            res = EXIT_FAILURE;
+            break;
+        }
+        if ( str.size() != fwrite(str.data(), 1, str.size(), out) )
+        {
+            std::clog << "Error writing `" << output << "'\n";
+            res = EXIT_FAILURE;
+            break;
+        }
+    }
+    if ( res == EXIT_SUCCESS && frame >= 0 && frm <= (size_t)frame )
+    {
+        std::clog << "Error: could not find frame " << frame << std::endl;
+        res = EXIT_FAILURE;
+    }
+    fclose(out);
+    fclose(in);
+    return res;
 }
 
 
@@ -42,7 +121,6 @@ int main(int argc, char* argv[])
         return EXIT_SUCCESS;
     }
 
-    Simul simul;
     Glossary arg;
     
     std::string input  = argv[1];
@@ -50,6 +128,17 @@ int main(int argc, char* argv[])
     if ( arg.read_strings(argc-3, argv+3) )
         return EXIT_FAILURE;
     
+    // copy the frames without loading the objects:
+    if ( arg.value_is("stream", 0, "1") )
+    {
+        std::string skip;
+        long frame = -1;
+        arg.set(skip, "skip");
+        arg.set(frame, "frame");
+        return stream(input, output, skip, frame);
+    }
+
+    Simul simul;
     ObjectSet * skip_set = nullptr;
     std::string skip;
     if ( arg.set(skip, "skip") )
@@ -77,6 +166,29 @@ int main(int argc, char* argv[])
     // a frame index can be specified:
     bool has_frame = arg.set(frame, "frame");
     
+    // access the frame directly, using the index of frames:
+    if ( has_frame )
+    {
+        FrameReader reader;
+        try {
+            reader.openFile(input);
+            if ( reader.loadFrame(simul, frame) )
+            {
+                std::clog << "Error: could not load frame " << frame << std::endl;
+                return EXIT_FAILURE;
+            }
+            if ( skip_set )
+                skip_set->erase();
+            simul.writeObjects(output, true, binary);
+        }
+        catch( Exception & e ) {
+            std::clog << "Error in frame " << frame << ":\n";
+            std::clog << "    " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    
     while ( in.good() )
     {
         try {
@@ -97,16 +209,13 @@ int main(int argc, char* argv[])
         */
         
         try {
-            if ( !has_frame || ( frm == frame ) )
-                simul.writeObjects(output, true, binary);
+            simul.writeObjects(output, true, binary);
         }
         catch( Exception & e ) {
             std::clog << "Error writing `" << output << "' :\n";
             std::clog << "    " << e.what() << std::endl;
             return EXIT_FAILURE;
         }
-        if ( has_frame && frm == frame )
-            break;
         ++frm;
     }
     return 0;